@@ -31,7 +31,8 @@ public class Compushady : ModuleRules
                 "UMG",
                 "AudioExtensions",
                 "AudioMixer",
-                "SignalProcessing"
+                "SignalProcessing",
+                "ImageWrapper"
             }
             );
 
@@ -40,6 +41,21 @@ public class Compushady : ModuleRules
             PrivateDependencyModuleNames.Add("Projects");
         }
 
+        // streaming inflate for compressed NRRD volumes
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+        // EXR encodings the ImageWrapper does not expose (PIZ, ZIPS, RG/RGB channels), same platforms as the EXR ImageWrapper
+        // (the OpenEXR calls live in their own module, the only one built with exceptions)
+        if (Target.Platform == UnrealTargetPlatform.Win64 || Target.Platform == UnrealTargetPlatform.Linux || Target.Platform == UnrealTargetPlatform.Mac)
+        {
+            PrivateDependencyModuleNames.Add("CompushadyOpenEXR");
+            PrivateDefinitions.Add("COMPUSHADY_OPENEXR=1");
+        }
+        else
+        {
+            PrivateDefinitions.Add("COMPUSHADY_OPENEXR=0");
+        }
+
         string ThirdPartyDirectory = System.IO.Path.Combine(ModuleDirectory, "..", "ThirdParty");
 
         string ThirdPartyDirectoryIncludePath = ThirdPartyDirectory;
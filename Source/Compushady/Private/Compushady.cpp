@@ -23,6 +23,9 @@ DEFINE_LOG_CATEGORY(LogCompushady);
 #endif
 
 #include "ShaderCore.h"
+#include "CompushadyCompileWorker.h"
+#include "CompushadyShaderRegistry.h"
+#include "CompushadyRayTracer.h"
 
 namespace Compushady
 {
@@ -159,10 +162,30 @@ void FCompushadyModule::StartupModule()
 
 	PropertyModule.NotifyCustomizationModuleChanged();
 #endif
+
+	// -CompushadyCompileWorkers=N moves shader compilation to N child processes (0 means one per core)
+	// -CompushadyCompileWorkerExecutable= and -CompushadyCompileWorkerArguments= select a standalone worker (required outside of the editor)
+	int32 NumCompileWorkers = -1;
+	if (FParse::Value(FCommandLine::Get(), TEXT("CompushadyCompileWorkers="), NumCompileWorkers) && NumCompileWorkers >= 0 && !IsRunningCommandlet())
+	{
+		Compushady::FCompushadyCompileWorkerConfig CompileWorkerConfig;
+		CompileWorkerConfig.NumWorkers = NumCompileWorkers;
+		FParse::Value(FCommandLine::Get(), TEXT("CompushadyCompileWorkerExecutable="), CompileWorkerConfig.Executable);
+		FParse::Value(FCommandLine::Get(), TEXT("CompushadyCompileWorkerArguments="), CompileWorkerConfig.ExtraArguments);
+
+		FString ErrorMessages;
+		if (!Compushady::CompileWorker::Enable(CompileWorkerConfig, ErrorMessages))
+		{
+			UE_LOG(LogCompushady, Error, TEXT("Unable to enable the shader compile workers: %s"), *ErrorMessages);
+		}
+	}
 }
 
 void FCompushadyModule::ShutdownModule()
 {
+	Compushady::CompileWorker::Disable();
+	Compushady::RayTracerPipelineCache::Flush();
+	Compushady::ShaderRegistry::Flush();
 	Compushady::DXCTeardown();
 }
 
@@ -0,0 +1,797 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyAccelerationStructure.h"
+#include "Compushady.h"
+#include "CompushadySRV.h"
+
+// GPU builds are based on the RHI acceleration structures api of 5.3+ (the TLAS initializer and build params changed in 5.5)
+#define COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS (COMPUSHADY_UE_VERSION >= 53 && RHI_RAYTRACING)
+
+void Compushady::AccelerationStructure::PackInstance(const FCompushadyAccelerationStructureInstance& Instance, const uint64 AccelerationStructureAddress, FCompushadyInstanceDesc& InstanceDesc)
+{
+	// Unreal matrices are row-vector based, native descriptors expect a row-major 3x4 (column-vector) matrix
+	const FMatrix Matrix = Instance.Transform.ToMatrixWithScale();
+	for (int32 Row = 0; Row < 3; Row++)
+	{
+		for (int32 Column = 0; Column < 4; Column++)
+		{
+			InstanceDesc.Transform[Row][Column] = static_cast<float>(Matrix.M[Column][Row]);
+		}
+	}
+
+	uint32 Flags = 0;
+	if (Instance.bTriangleCullDisable)
+	{
+		Flags |= InstanceFlagTriangleCullDisable;
+	}
+	if (Instance.bForceOpaque)
+	{
+		Flags |= InstanceFlagForceOpaque;
+	}
+
+	InstanceDesc.InstanceIDAndMask = (static_cast<uint32>(Instance.InstanceID) & MaxInstanceID) | (static_cast<uint32>(Instance.Mask) << 24);
+	InstanceDesc.HitGroupIndexAndFlags = (static_cast<uint32>(Instance.HitGroupIndex) & MaxHitGroupIndex) | (Flags << 24);
+	InstanceDesc.AccelerationStructureAddress = AccelerationStructureAddress;
+}
+
+bool Compushady::AccelerationStructure::ValidateTriangles(const FCompushadyAccelerationStructureTriangles& Triangles, const int64 VertexBufferSize, const int64 IndexBufferSize, const int32 IndexStride, FString& ErrorMessages)
+{
+	if (Triangles.NumVertices <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of vertices %d"), Triangles.NumVertices);
+		return false;
+	}
+
+	if (Triangles.VertexStride < 12 || Triangles.VertexStride % 4 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid vertex stride %d (must be at least 12 and a multiple of 4)"), Triangles.VertexStride);
+		return false;
+	}
+
+	if (Triangles.VertexOffset < 0 || Triangles.VertexOffset % 4 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid vertex offset %lld (must be a multiple of 4)"), Triangles.VertexOffset);
+		return false;
+	}
+
+	const int64 RequiredVertexBufferSize = Triangles.VertexOffset + static_cast<int64>(Triangles.NumVertices - 1) * Triangles.VertexStride + 12;
+	if (RequiredVertexBufferSize > VertexBufferSize)
+	{
+		ErrorMessages = FString::Printf(TEXT("Vertex buffer too small (%lld bytes required, %lld available)"), RequiredVertexBufferSize, VertexBufferSize);
+		return false;
+	}
+
+	// non indexed
+	if (Triangles.NumIndices == 0)
+	{
+		if (Triangles.NumVertices % 3 != 0)
+		{
+			ErrorMessages = FString::Printf(TEXT("Invalid number of vertices %d for a non indexed geometry (must be a multiple of 3)"), Triangles.NumVertices);
+			return false;
+		}
+		return true;
+	}
+
+	if (IndexStride != 2 && IndexStride != 4)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid index stride %d (must be 2 or 4)"), IndexStride);
+		return false;
+	}
+
+	if (Triangles.NumIndices < 0 || Triangles.NumIndices % 3 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of indices %d (must be a multiple of 3)"), Triangles.NumIndices);
+		return false;
+	}
+
+	if (Triangles.IndexOffset < 0 || Triangles.IndexOffset % (IndexStride * 3) != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid index offset %lld (must be aligned to a triangle)"), Triangles.IndexOffset);
+		return false;
+	}
+
+	const int64 RequiredIndexBufferSize = Triangles.IndexOffset + static_cast<int64>(Triangles.NumIndices) * IndexStride;
+	if (RequiredIndexBufferSize > IndexBufferSize)
+	{
+		ErrorMessages = FString::Printf(TEXT("Index buffer too small (%lld bytes required, %lld available)"), RequiredIndexBufferSize, IndexBufferSize);
+		return false;
+	}
+
+	return true;
+}
+
+bool Compushady::AccelerationStructure::ValidateAABBs(const FCompushadyAccelerationStructureAABBs& AABBs, const int64 AABBBufferSize, FString& ErrorMessages)
+{
+	if (AABBs.NumAABBs <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of AABBs %d"), AABBs.NumAABBs);
+		return false;
+	}
+
+	if (AABBs.Stride < 24 || AABBs.Stride % 8 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid AABB stride %d (must be at least 24 and a multiple of 8)"), AABBs.Stride);
+		return false;
+	}
+
+	if (AABBs.Offset < 0 || AABBs.Offset % 8 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid AABB offset %lld (must be a multiple of 8)"), AABBs.Offset);
+		return false;
+	}
+
+	const int64 RequiredAABBBufferSize = AABBs.Offset + static_cast<int64>(AABBs.NumAABBs - 1) * AABBs.Stride + 24;
+	if (RequiredAABBBufferSize > AABBBufferSize)
+	{
+		ErrorMessages = FString::Printf(TEXT("AABB buffer too small (%lld bytes required, %lld available)"), RequiredAABBBufferSize, AABBBufferSize);
+		return false;
+	}
+
+	return true;
+}
+
+bool Compushady::AccelerationStructure::ValidateInstance(const FCompushadyAccelerationStructureInstance& Instance, FString& ErrorMessages)
+{
+	if (!Instance.BLAS)
+	{
+		ErrorMessages = "Invalid BLAS";
+		return false;
+	}
+
+	if (Instance.BLAS->IsTLAS())
+	{
+		ErrorMessages = "A TLAS cannot be instanced";
+		return false;
+	}
+
+	if (Instance.InstanceID < 0 || static_cast<uint32>(Instance.InstanceID) > MaxInstanceID)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid InstanceID %d (must be between 0 and %u)"), Instance.InstanceID, MaxInstanceID);
+		return false;
+	}
+
+	if (Instance.HitGroupIndex < 0 || static_cast<uint32>(Instance.HitGroupIndex) > MaxHitGroupIndex)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid HitGroupIndex %d (must be between 0 and %u)"), Instance.HitGroupIndex, MaxHitGroupIndex);
+		return false;
+	}
+
+	return true;
+}
+
+bool Compushady::AccelerationStructure::ValidateInstanceBuffer(const int64 InstanceBufferSize, const int64 Offset, const int32 NumInstances, FString& ErrorMessages)
+{
+	if (NumInstances <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of instances %d"), NumInstances);
+		return false;
+	}
+
+	if (Offset < 0 || Offset % 16 != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid instance buffer offset %lld (must be a multiple of 16)"), Offset);
+		return false;
+	}
+
+	const int64 RequiredInstanceBufferSize = Offset + static_cast<int64>(NumInstances) * sizeof(FCompushadyInstanceDesc);
+	if (RequiredInstanceBufferSize > InstanceBufferSize)
+	{
+		ErrorMessages = FString::Printf(TEXT("Instance buffer too small (%lld bytes required, %lld available)"), RequiredInstanceBufferSize, InstanceBufferSize);
+		return false;
+	}
+
+	return true;
+}
+
+bool UCompushadyAccelerationStructure::IsSupported(FString& ErrorMessages)
+{
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+	if (!GRHISupportsRayTracing)
+	{
+		ErrorMessages = "The current RHI does not support RayTracing";
+		return false;
+	}
+	return true;
+#else
+	ErrorMessages = "RayTracing Acceleration Structures builds require Unreal Engine 5.3+ with RHI_RAYTRACING";
+	return false;
+#endif
+}
+
+bool UCompushadyAccelerationStructure::InitializeBLASFromTriangles(const TArray<FCompushadyAccelerationStructureTriangles>& Geometries, const bool bInAllowUpdate, FString& ErrorMessages)
+{
+	if (!IsSupported(ErrorMessages))
+	{
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		ErrorMessages = "The AccelerationStructure is already running";
+		return false;
+	}
+
+	if (Geometries.Num() == 0)
+	{
+		ErrorMessages = "No geometries specified";
+		return false;
+	}
+
+	UCompushadyResource* IndexBuffer = nullptr;
+	for (int32 GeometryIndex = 0; GeometryIndex < Geometries.Num(); GeometryIndex++)
+	{
+		const FCompushadyAccelerationStructureTriangles& Geometry = Geometries[GeometryIndex];
+		if (!Geometry.VertexBuffer || !Geometry.VertexBuffer->IsValidBuffer())
+		{
+			ErrorMessages = FString::Printf(TEXT("Invalid vertex buffer for geometry %d"), GeometryIndex);
+			return false;
+		}
+
+		if (Geometry.NumIndices > 0)
+		{
+			if (!Geometry.IndexBuffer || !Geometry.IndexBuffer->IsValidBuffer())
+			{
+				ErrorMessages = FString::Printf(TEXT("Invalid index buffer for geometry %d"), GeometryIndex);
+				return false;
+			}
+
+			// the RHI supports a single index buffer per BLAS
+			if (IndexBuffer && IndexBuffer != Geometry.IndexBuffer)
+			{
+				ErrorMessages = "All of the geometries must share the same index buffer";
+				return false;
+			}
+			IndexBuffer = Geometry.IndexBuffer;
+		}
+
+		if (!Compushady::AccelerationStructure::ValidateTriangles(Geometry, Geometry.VertexBuffer->GetBufferSize(), Geometry.IndexBuffer ? Geometry.IndexBuffer->GetBufferSize() : 0, Geometry.IndexBuffer ? Geometry.IndexBuffer->GetBufferStride() : 0, ErrorMessages))
+		{
+			return false;
+		}
+	}
+
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+	FRayTracingGeometryInitializer Initializer;
+	Initializer.DebugName = FName(TEXT("CompushadyBLAS"));
+	Initializer.GeometryType = RTGT_Triangles;
+	Initializer.bFastBuild = false;
+	Initializer.bAllowUpdate = bInAllowUpdate;
+	Initializer.IndexBuffer = IndexBuffer ? IndexBuffer->GetBufferRHI() : nullptr;
+	Initializer.IndexBufferOffset = 0;
+
+	Inputs.Empty();
+	uint32 TotalPrimitiveCount = 0;
+	for (const FCompushadyAccelerationStructureTriangles& Geometry : Geometries)
+	{
+		FRayTracingGeometrySegment Segment;
+		Segment.VertexBuffer = Geometry.VertexBuffer->GetBufferRHI();
+		Segment.VertexBufferElementType = VET_Float3;
+		Segment.VertexBufferOffset = static_cast<uint32>(Geometry.VertexOffset);
+		Segment.VertexBufferStride = static_cast<uint32>(Geometry.VertexStride);
+		Segment.MaxVertices = static_cast<uint32>(Geometry.NumVertices);
+		Segment.FirstPrimitive = Geometry.NumIndices > 0 ? static_cast<uint32>(Geometry.IndexOffset / (Geometry.IndexBuffer->GetBufferStride() * 3)) : 0;
+		Segment.NumPrimitives = static_cast<uint32>((Geometry.NumIndices > 0 ? Geometry.NumIndices : Geometry.NumVertices) / 3);
+		Segment.bForceOpaque = Geometry.bOpaque;
+		Initializer.Segments.Add(Segment);
+		TotalPrimitiveCount += Segment.NumPrimitives;
+
+		Inputs.Add(Geometry.VertexBuffer);
+		if (Geometry.IndexBuffer)
+		{
+			Inputs.AddUnique(Geometry.IndexBuffer);
+		}
+	}
+	Initializer.TotalPrimitiveCount = TotalPrimitiveCount;
+
+	// the geometry is created on the render thread, failures are reported by the first Build
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRayTracingGeometry)(
+		[this, Initializer, ScratchName = FString::Printf(TEXT("%s__Scratch"), *GetName())](FRHICommandListImmediate& RHICmdList)
+		{
+			GeometryRHIRef = RHICreateRayTracingGeometry(Initializer);
+			ScratchBufferRHIRef = nullptr;
+			if (GeometryRHIRef.IsValid())
+			{
+				const FRayTracingAccelerationStructureSize SizeInfo = GeometryRHIRef->GetSizeInfo();
+				ScratchBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*ScratchName, FMath::Max(SizeInfo.BuildScratchSize, SizeInfo.UpdateScratchSize), EBufferUsageFlags::RayTracingScratch, 0, ERHIAccess::UAVCompute);
+			}
+		});
+
+	bIsTLAS = false;
+	bAllowUpdate = bInAllowUpdate;
+	bBuilt = false;
+	bInitialized = true;
+	return true;
+#else
+	return IsSupported(ErrorMessages);
+#endif
+}
+
+bool UCompushadyAccelerationStructure::InitializeBLASFromAABBs(const TArray<FCompushadyAccelerationStructureAABBs>& Geometries, const bool bInAllowUpdate, FString& ErrorMessages)
+{
+	if (!IsSupported(ErrorMessages))
+	{
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		ErrorMessages = "The AccelerationStructure is already running";
+		return false;
+	}
+
+	if (Geometries.Num() == 0)
+	{
+		ErrorMessages = "No geometries specified";
+		return false;
+	}
+
+	for (int32 GeometryIndex = 0; GeometryIndex < Geometries.Num(); GeometryIndex++)
+	{
+		const FCompushadyAccelerationStructureAABBs& Geometry = Geometries[GeometryIndex];
+		if (!Geometry.AABBBuffer || !Geometry.AABBBuffer->IsValidBuffer())
+		{
+			ErrorMessages = FString::Printf(TEXT("Invalid AABB buffer for geometry %d"), GeometryIndex);
+			return false;
+		}
+
+		if (!Compushady::AccelerationStructure::ValidateAABBs(Geometry, Geometry.AABBBuffer->GetBufferSize(), ErrorMessages))
+		{
+			return false;
+		}
+	}
+
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+	FRayTracingGeometryInitializer Initializer;
+	Initializer.DebugName = FName(TEXT("CompushadyBLAS"));
+	Initializer.GeometryType = RTGT_Procedural;
+	Initializer.bFastBuild = false;
+	Initializer.bAllowUpdate = bInAllowUpdate;
+
+	Inputs.Empty();
+	uint32 TotalPrimitiveCount = 0;
+	for (const FCompushadyAccelerationStructureAABBs& Geometry : Geometries)
+	{
+		// procedural segments use the vertex buffer as the AABBs buffer
+		FRayTracingGeometrySegment Segment;
+		Segment.VertexBuffer = Geometry.AABBBuffer->GetBufferRHI();
+		Segment.VertexBufferOffset = static_cast<uint32>(Geometry.Offset);
+		Segment.VertexBufferStride = static_cast<uint32>(Geometry.Stride);
+		Segment.NumPrimitives = static_cast<uint32>(Geometry.NumAABBs);
+		Segment.bForceOpaque = Geometry.bOpaque;
+		Initializer.Segments.Add(Segment);
+		TotalPrimitiveCount += Segment.NumPrimitives;
+
+		Inputs.Add(Geometry.AABBBuffer);
+	}
+	Initializer.TotalPrimitiveCount = TotalPrimitiveCount;
+
+	// the geometry is created on the render thread, failures are reported by the first Build
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRayTracingGeometry)(
+		[this, Initializer, ScratchName = FString::Printf(TEXT("%s__Scratch"), *GetName())](FRHICommandListImmediate& RHICmdList)
+		{
+			GeometryRHIRef = RHICreateRayTracingGeometry(Initializer);
+			ScratchBufferRHIRef = nullptr;
+			if (GeometryRHIRef.IsValid())
+			{
+				const FRayTracingAccelerationStructureSize SizeInfo = GeometryRHIRef->GetSizeInfo();
+				ScratchBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*ScratchName, FMath::Max(SizeInfo.BuildScratchSize, SizeInfo.UpdateScratchSize), EBufferUsageFlags::RayTracingScratch, 0, ERHIAccess::UAVCompute);
+			}
+		});
+
+	bIsTLAS = false;
+	bAllowUpdate = bInAllowUpdate;
+	bBuilt = false;
+	bInitialized = true;
+	return true;
+#else
+	return IsSupported(ErrorMessages);
+#endif
+}
+
+bool UCompushadyAccelerationStructure::PackInstances(const TArray<FCompushadyAccelerationStructureInstance>& Instances, TArray<Compushady::AccelerationStructure::FCompushadyInstanceDesc>& InstanceDescs, FString& ErrorMessages)
+{
+	if (Instances.Num() == 0)
+	{
+		ErrorMessages = "No instances specified";
+		return false;
+	}
+
+	InstanceDescs.SetNumUninitialized(Instances.Num());
+	for (int32 InstanceIndex = 0; InstanceIndex < Instances.Num(); InstanceIndex++)
+	{
+		const FCompushadyAccelerationStructureInstance& Instance = Instances[InstanceIndex];
+		if (!Compushady::AccelerationStructure::ValidateInstance(Instance, ErrorMessages))
+		{
+			ErrorMessages = FString::Printf(TEXT("Instance %d: %s"), InstanceIndex, *ErrorMessages);
+			return false;
+		}
+
+		// the GPU address is known only after the BLAS has been created by the render thread
+		if (!Instance.BLAS->IsBuilt())
+		{
+			ErrorMessages = FString::Printf(TEXT("Instance %d: the BLAS must be built before being instanced"), InstanceIndex);
+			return false;
+		}
+
+		Compushady::AccelerationStructure::PackInstance(Instance, static_cast<uint64>(Instance.BLAS->GetGPUAddress()), InstanceDescs[InstanceIndex]);
+	}
+
+	return true;
+}
+
+bool UCompushadyAccelerationStructure::InitializeTLAS(const TArray<FCompushadyAccelerationStructureInstance>& Instances, FString& ErrorMessages)
+{
+	if (!IsSupported(ErrorMessages))
+	{
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		ErrorMessages = "The AccelerationStructure is already running";
+		return false;
+	}
+
+	TArray<Compushady::AccelerationStructure::FCompushadyInstanceDesc> InstanceDescs;
+	if (!PackInstances(Instances, InstanceDescs, ErrorMessages))
+	{
+		return false;
+	}
+
+	TArray<UCompushadyAccelerationStructure*> InstancesBLASes;
+	for (const FCompushadyAccelerationStructureInstance& Instance : Instances)
+	{
+		InstancesBLASes.AddUnique(Instance.BLAS);
+	}
+
+	Inputs.Empty();
+	InstanceBufferOffset = 0;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateInstanceBuffer)(
+		[this, InstanceDescs = MoveTemp(InstanceDescs), InstancesName = FString::Printf(TEXT("%s__Instances"), *GetName())](FRHICommandListImmediate& RHICmdList)
+		{
+			const int64 Size = InstanceDescs.Num() * sizeof(Compushady::AccelerationStructure::FCompushadyInstanceDesc);
+			InstanceBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*InstancesName, Size, EBufferUsageFlags::ShaderResource | EBufferUsageFlags::StructuredBuffer, sizeof(Compushady::AccelerationStructure::FCompushadyInstanceDesc), ERHIAccess::SRVMask);
+			if (InstanceBufferRHIRef.IsValid())
+			{
+				void* Data = RHICmdList.LockBuffer(InstanceBufferRHIRef, 0, Size, EResourceLockMode::RLM_WriteOnly);
+				FMemory::Memcpy(Data, InstanceDescs.GetData(), Size);
+				RHICmdList.UnlockBuffer(InstanceBufferRHIRef);
+			}
+		});
+
+	return InitializeTLAS_Internal(Instances.Num(), InstancesBLASes, ErrorMessages);
+}
+
+bool UCompushadyAccelerationStructure::InitializeTLASFromInstanceBuffer(UCompushadyResource* InstanceBuffer, const int64 Offset, const int32 InNumInstances, const TArray<UCompushadyAccelerationStructure*>& InReferencedBLASes, FString& ErrorMessages)
+{
+	if (!IsSupported(ErrorMessages))
+	{
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		ErrorMessages = "The AccelerationStructure is already running";
+		return false;
+	}
+
+	if (!InstanceBuffer || !InstanceBuffer->IsValidBuffer())
+	{
+		ErrorMessages = "Invalid instance buffer";
+		return false;
+	}
+
+	if (!Compushady::AccelerationStructure::ValidateInstanceBuffer(InstanceBuffer->GetBufferSize(), Offset, InNumInstances, ErrorMessages))
+	{
+		return false;
+	}
+
+	for (const UCompushadyAccelerationStructure* BLAS : InReferencedBLASes)
+	{
+		if (!BLAS || BLAS->IsTLAS())
+		{
+			ErrorMessages = "Invalid referenced BLAS";
+			return false;
+		}
+	}
+
+	Inputs.Empty();
+	Inputs.Add(InstanceBuffer);
+	InstanceBufferOffset = Offset;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadySetInstanceBuffer)(
+		[this, NewInstanceBufferRHIRef = InstanceBuffer->GetBufferRHI()](FRHICommandListImmediate& RHICmdList)
+		{
+			InstanceBufferRHIRef = NewInstanceBufferRHIRef;
+		});
+
+	return InitializeTLAS_Internal(InNumInstances, InReferencedBLASes, ErrorMessages);
+}
+
+bool UCompushadyAccelerationStructure::InitializeTLAS_Internal(const int32 InNumInstances, const TArray<UCompushadyAccelerationStructure*>& InReferencedBLASes, FString& ErrorMessages)
+{
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+#if COMPUSHADY_UE_VERSION >= 55
+	// the shader binding table is no more part of the scene
+	FRayTracingSceneInitializer Initializer;
+	Initializer.DebugName = FName(TEXT("CompushadyTLAS"));
+	Initializer.MaxNumInstances = static_cast<uint32>(InNumInstances);
+	Initializer.BuildFlags = ERayTracingAccelerationStructureFlags::FastTrace;
+#else
+	FRayTracingSceneInitializer2 Initializer;
+	Initializer.DebugName = FName(TEXT("CompushadyTLAS"));
+#if COMPUSHADY_UE_VERSION >= 54
+	Initializer.NumNativeInstancesPerLayer.Add(static_cast<uint32>(InNumInstances));
+#else
+	Initializer.NumNativeInstances = static_cast<uint32>(InNumInstances);
+#endif
+	Initializer.ShaderSlotsPerGeometrySegment = 1;
+	Initializer.NumMissShaderSlots = 1;
+#endif
+
+	// the SRV object is created here, its RHI view is assigned by the render thread before the first Build
+	UCompushadySRV* NewSRV = NewObject<UCompushadySRV>(this);
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRayTracingScene)(
+		[this, NewSRV, Initializer = MoveTemp(Initializer), BaseName = GetName()](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			SceneRHIRef = RHICreateRayTracingScene(MoveTemp(Initializer));
+			SceneBufferRHIRef = nullptr;
+			ScratchBufferRHIRef = nullptr;
+			if (!SceneRHIRef.IsValid())
+			{
+				return;
+			}
+
+			const FRayTracingAccelerationStructureSize SizeInfo = SceneRHIRef->GetSizeInfo();
+			SceneBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*FString::Printf(TEXT("%s__TLAS"), *BaseName), SizeInfo.ResultSize, EBufferUsageFlags::AccelerationStructure, 0, ERHIAccess::BVHWrite);
+			ScratchBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*FString::Printf(TEXT("%s__Scratch"), *BaseName), SizeInfo.BuildScratchSize, EBufferUsageFlags::RayTracingScratch, 0, ERHIAccess::UAVCompute);
+			RHICmdList.BindAccelerationStructureMemory(SceneRHIRef, SceneBufferRHIRef, 0);
+			FShaderResourceViewRHIRef SceneSRVRHIRef = RHICmdList.CreateShaderResourceView(SceneBufferRHIRef, FRHIViewDesc::CreateBufferSRV().SetType(FRHIViewDesc::EBufferType::AccelerationStructure));
+			NewSRV->InitializeFromAccelerationStructure(SceneSRVRHIRef, FRHITransitionInfo(SceneRHIRef.GetReference(), ERHIAccess::Unknown, ERHIAccess::BVHRead));
+		});
+
+	SRV = NewSRV;
+	ReferencedBLASes = InReferencedBLASes;
+	NumInstances = InNumInstances;
+	bIsTLAS = true;
+	bAllowUpdate = false;
+	bBuilt = false;
+	bInitialized = true;
+	return true;
+#else
+	return IsSupported(ErrorMessages);
+#endif
+}
+
+void UCompushadyAccelerationStructure::Build(const FCompushadySignaled& OnSignaled)
+{
+	Build_Internal(false, OnSignaled);
+}
+
+void UCompushadyAccelerationStructure::Refit(const FCompushadySignaled& OnSignaled)
+{
+	if (bIsTLAS)
+	{
+		OnSignaled.ExecuteIfBound(false, "A TLAS cannot be refitted, use UpdateInstances or Build");
+		return;
+	}
+
+	if (!bAllowUpdate)
+	{
+		OnSignaled.ExecuteIfBound(false, "The BLAS has not been created with bAllowUpdate");
+		return;
+	}
+
+	if (!bBuilt)
+	{
+		OnSignaled.ExecuteIfBound(false, "The BLAS must be built before being refitted");
+		return;
+	}
+
+	Build_Internal(true, OnSignaled);
+}
+
+void UCompushadyAccelerationStructure::UpdateInstances(const TArray<FCompushadyAccelerationStructureInstance>& Instances, const FCompushadySignaled& OnSignaled)
+{
+	if (!bIsTLAS)
+	{
+		OnSignaled.ExecuteIfBound(false, "UpdateInstances requires a TLAS");
+		return;
+	}
+
+	// user provided instance buffers are directly updated by the user
+	if (Inputs.Num() > 0)
+	{
+		OnSignaled.ExecuteIfBound(false, "The TLAS has been initialized from an instance buffer, update it and call Build");
+		return;
+	}
+
+	if (Instances.Num() != NumInstances)
+	{
+		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Expected %d instances, got %d"), NumInstances, Instances.Num()));
+		return;
+	}
+
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The AccelerationStructure is already running");
+		return;
+	}
+
+	TArray<Compushady::AccelerationStructure::FCompushadyInstanceDesc> InstanceDescs;
+	FString ErrorMessages;
+	if (!PackInstances(Instances, InstanceDescs, ErrorMessages))
+	{
+		OnSignaled.ExecuteIfBound(false, ErrorMessages);
+		return;
+	}
+
+	for (const FCompushadyAccelerationStructureInstance& Instance : Instances)
+	{
+		ReferencedBLASes.AddUnique(Instance.BLAS);
+	}
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyUpdateInstanceBuffer)(
+		[this, InstanceDescs](FRHICommandListImmediate& RHICmdList)
+		{
+			const int64 Size = InstanceDescs.Num() * sizeof(Compushady::AccelerationStructure::FCompushadyInstanceDesc);
+			void* Data = RHICmdList.LockBuffer(InstanceBufferRHIRef, 0, Size, EResourceLockMode::RLM_WriteOnly);
+			FMemory::Memcpy(Data, InstanceDescs.GetData(), Size);
+			RHICmdList.UnlockBuffer(InstanceBufferRHIRef);
+		});
+
+	Build_Internal(false, OnSignaled);
+}
+
+void UCompushadyAccelerationStructure::Build_Internal(const bool bUpdate, const FCompushadySignaled& OnSignaled)
+{
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The AccelerationStructure is already running");
+		return;
+	}
+
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+	if (!bInitialized)
+	{
+		OnSignaled.ExecuteIfBound(false, "The AccelerationStructure has not been initialized");
+		return;
+	}
+
+	for (const UCompushadyAccelerationStructure* BLAS : ReferencedBLASes)
+	{
+		if (!BLAS->IsBuilt())
+		{
+			OnSignaled.ExecuteIfBound(false, "All of the referenced BLASes must be built before the TLAS");
+			return;
+		}
+	}
+
+	// bBuilt is updated by OnBuildSignaled, after the GPU has completed the build
+	PendingOnSignaled = OnSignaled;
+	bBuildFailed = false;
+
+	FCompushadySignaled OnBuilt;
+	OnBuilt.BindUFunction(this, GET_FUNCTION_NAME_CHECKED(UCompushadyAccelerationStructure, OnBuildSignaled));
+
+	EnqueueToGPU(
+		[this, bUpdate, BLASes = ReferencedBLASes, InstancesCount = static_cast<uint32>(NumInstances)](FRHICommandListImmediate& RHICmdList)
+		{
+			if (!ScratchBufferRHIRef.IsValid() || (bIsTLAS ? (!SceneRHIRef.IsValid() || !InstanceBufferRHIRef.IsValid()) : !GeometryRHIRef.IsValid()))
+			{
+				bBuildFailed = true;
+				return;
+			}
+
+			for (UCompushadyResource* Input : Inputs)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(Input->GetBufferRHI(), ERHIAccess::Unknown, ERHIAccess::SRVCompute));
+			}
+
+			if (bIsTLAS)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(InstanceBufferRHIRef, ERHIAccess::Unknown, ERHIAccess::SRVCompute));
+				RHICmdList.Transition(FRHITransitionInfo(SceneRHIRef.GetReference(), ERHIAccess::Unknown, ERHIAccess::BVHWrite));
+
+				FRayTracingSceneBuildParams Params;
+				Params.Scene = SceneRHIRef;
+				Params.ScratchBuffer = ScratchBufferRHIRef;
+				Params.ScratchBufferOffset = 0;
+				Params.InstanceBuffer = InstanceBufferRHIRef;
+				Params.InstanceBufferOffset = static_cast<uint32>(InstanceBufferOffset);
+#if COMPUSHADY_UE_VERSION >= 55
+				// the scene does not track the geometries anymore, the build needs the ones referenced by the instances
+				TArray<FRHIRayTracingGeometry*> ReferencedGeometries;
+				for (const UCompushadyAccelerationStructure* BLAS : BLASes)
+				{
+					if (BLAS->GeometryRHIRef.IsValid())
+					{
+						ReferencedGeometries.Add(BLAS->GeometryRHIRef.GetReference());
+					}
+				}
+				Params.NumInstances = InstancesCount;
+				Params.ReferencedGeometries = ReferencedGeometries;
+				RHICmdList.BuildAccelerationStructures(MakeArrayView(&Params, 1));
+#else
+				RHICmdList.BuildAccelerationStructure(Params);
+#endif
+
+				RHICmdList.Transition(FRHITransitionInfo(SceneRHIRef.GetReference(), ERHIAccess::BVHWrite, ERHIAccess::BVHRead));
+			}
+			else
+			{
+				FRayTracingGeometryBuildParams Params;
+				Params.Geometry = GeometryRHIRef;
+				Params.BuildMode = bUpdate ? EAccelerationStructureBuildMode::Update : EAccelerationStructureBuildMode::Build;
+
+				FRHIBufferRange ScratchBufferRange;
+				ScratchBufferRange.Buffer = ScratchBufferRHIRef;
+				ScratchBufferRange.Offset = 0;
+				ScratchBufferRange.Size = ScratchBufferRHIRef->GetSize();
+
+				RHICmdList.BuildAccelerationStructures(MakeArrayView(&Params, 1), ScratchBufferRange);
+			}
+		}, OnBuilt);
+#else
+	FString ErrorMessages;
+	IsSupported(ErrorMessages);
+	OnSignaled.ExecuteIfBound(false, ErrorMessages);
+#endif
+}
+
+void UCompushadyAccelerationStructure::OnBuildSignaled(bool bSuccess, const FString& ErrorMessage)
+{
+	// the user callback could start a new build
+	FCompushadySignaled OnSignaled = PendingOnSignaled;
+	PendingOnSignaled.Unbind();
+
+	if (bBuildFailed)
+	{
+		bBuilt = false;
+		OnSignaled.ExecuteIfBound(false, bIsTLAS ? "Unable to create TLAS" : "Unable to create BLAS");
+		return;
+	}
+
+	bBuilt = bSuccess;
+	OnSignaled.ExecuteIfBound(bSuccess, ErrorMessage);
+}
+
+UCompushadySRV* UCompushadyAccelerationStructure::GetSRV() const
+{
+	return SRV;
+}
+
+int64 UCompushadyAccelerationStructure::GetGPUAddress() const
+{
+#if COMPUSHADY_ACCELERATION_STRUCTURE_BUILDS
+	// GeometryRHIRef is assigned by the render thread, it is safe to read it after the first build
+	if (bBuilt && !bIsTLAS && GeometryRHIRef.IsValid())
+	{
+		return static_cast<int64>(GeometryRHIRef->GetAccelerationStructureAddress(0));
+	}
+#endif
+	return 0;
+}
+
+bool UCompushadyAccelerationStructure::IsTLAS() const
+{
+	return bIsTLAS;
+}
+
+bool UCompushadyAccelerationStructure::IsBuilt() const
+{
+	return bBuilt;
+}
+
+bool UCompushadyAccelerationStructure::IsRunning() const
+{
+	return ICompushadySignalable::IsRunning();
+}
+
+void UCompushadyAccelerationStructure::StoreLastSignal(bool bSuccess, const FString& ErrorMessage)
+{
+	bLastSuccess = bSuccess;
+	LastErrorMessages = ErrorMessage;
+}
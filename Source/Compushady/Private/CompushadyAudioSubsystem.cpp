@@ -16,12 +16,106 @@ bool UCompushadyAudioSubsystem::ShouldCreateSubsystem(UObject* Outer) const
 	return false;
 }
 
+Compushady::Audio::FCompushadyAudioBlockRing::FCompushadyAudioBlockRing(const int32 InNumBlocks, const int32 InBlockSize) : NumBlocks(InNumBlocks), BlockSize(InBlockSize)
+{
+	check(NumBlocks > 0 && BlockSize > 0);
+	Samples.AddZeroed(NumBlocks * BlockSize);
+}
+
+float* Compushady::Audio::FCompushadyAudioBlockRing::BeginWrite()
+{
+	const uint32 CurrentWriteIndex = WriteIndex.load(std::memory_order_relaxed);
+	if (CurrentWriteIndex - ReadIndex.load(std::memory_order_acquire) >= static_cast<uint32>(NumBlocks))
+	{
+		return nullptr;
+	}
+	return Samples.GetData() + (CurrentWriteIndex % NumBlocks) * BlockSize;
+}
+
+void Compushady::Audio::FCompushadyAudioBlockRing::EndWrite()
+{
+	WriteIndex.store(WriteIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const float* Compushady::Audio::FCompushadyAudioBlockRing::BeginRead() const
+{
+	const uint32 CurrentReadIndex = ReadIndex.load(std::memory_order_relaxed);
+	if (WriteIndex.load(std::memory_order_acquire) == CurrentReadIndex)
+	{
+		return nullptr;
+	}
+	return Samples.GetData() + (CurrentReadIndex % NumBlocks) * BlockSize;
+}
+
+void Compushady::Audio::FCompushadyAudioBlockRing::EndRead()
+{
+	ReadIndex.store(ReadIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int32 Compushady::Audio::FCompushadyAudioBlockRing::Num() const
+{
+	return static_cast<int32>(WriteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_acquire));
+}
+
+void Compushady::Audio::Deinterleave(const float* Interleaved, float* Planar, const int32 NumFrames, const int32 NumChannels, const int32 PlanarPitch)
+{
+	int32 Frame = 0;
+
+	if (NumChannels == 1)
+	{
+		FMemory::Memcpy(Planar, Interleaved, NumFrames * sizeof(float));
+		return;
+	}
+	else if (NumChannels == 2)
+	{
+		float* Left = Planar;
+		float* Right = Planar + PlanarPitch;
+		for (; Frame + 4 <= NumFrames; Frame += 4)
+		{
+			// L0 R0 L1 R1 | L2 R2 L3 R3
+			const VectorRegister4Float V0 = VectorLoad(Interleaved + Frame * 2);
+			const VectorRegister4Float V1 = VectorLoad(Interleaved + Frame * 2 + 4);
+			VectorStore(VectorShuffle(V0, V1, 0, 2, 0, 2), Left + Frame);
+			VectorStore(VectorShuffle(V0, V1, 1, 3, 1, 3), Right + Frame);
+		}
+	}
+	else if (NumChannels == 4)
+	{
+		for (; Frame + 4 <= NumFrames; Frame += 4)
+		{
+			// 4x4 transpose, every register is a frame
+			const VectorRegister4Float V0 = VectorLoad(Interleaved + Frame * 4);
+			const VectorRegister4Float V1 = VectorLoad(Interleaved + Frame * 4 + 4);
+			const VectorRegister4Float V2 = VectorLoad(Interleaved + Frame * 4 + 8);
+			const VectorRegister4Float V3 = VectorLoad(Interleaved + Frame * 4 + 12);
+			const VectorRegister4Float T0 = VectorShuffle(V0, V1, 0, 1, 0, 1);
+			const VectorRegister4Float T1 = VectorShuffle(V2, V3, 0, 1, 0, 1);
+			const VectorRegister4Float T2 = VectorShuffle(V0, V1, 2, 3, 2, 3);
+			const VectorRegister4Float T3 = VectorShuffle(V2, V3, 2, 3, 2, 3);
+			VectorStore(VectorShuffle(T0, T1, 0, 2, 0, 2), Planar + Frame);
+			VectorStore(VectorShuffle(T0, T1, 1, 3, 1, 3), Planar + PlanarPitch + Frame);
+			VectorStore(VectorShuffle(T2, T3, 0, 2, 0, 2), Planar + PlanarPitch * 2 + Frame);
+			VectorStore(VectorShuffle(T2, T3, 1, 3, 1, 3), Planar + PlanarPitch * 3 + Frame);
+		}
+	}
+
+	// generic layouts and the tail of the vectorized ones
+	for (int32 Channel = 0; Channel < NumChannels; Channel++)
+	{
+		float* Row = Planar + Channel * PlanarPitch;
+		for (int32 TailFrame = Frame; TailFrame < NumFrames; TailFrame++)
+		{
+			Row[TailFrame] = Interleaved[TailFrame * NumChannels + Channel];
+		}
+	}
+}
+
 void UCompushadyAudioSubsystem::Tick(float DeltaTime)
 {
 	// first check for dead textures
-	TArray<TWeakObjectPtr<UCompushadyResource>> DeadAudioTextures;
+	TArray<TWeakObjectPtr<UCompushadyResource>, TInlineAllocator<4>> DeadAudioTextures;
 
-	for (const TPair<TWeakObjectPtr<UCompushadyResource>, Audio::FPatchOutputStrongPtr>& Pair : RegisteredAudioTextures)
+	for (const TPair<TWeakObjectPtr<UCompushadyResource>, FCompushadyAudioTexture>& Pair : RegisteredAudioTextures)
 	{
 		if (!Pair.Key.IsValid())
 		{
@@ -34,27 +128,65 @@ void UCompushadyAudioSubsystem::Tick(float DeltaTime)
 		RegisteredAudioTextures.Remove(DeadAudioTexture);
 	}
 
-	for (const TPair<TWeakObjectPtr<UCompushadyResource>, Audio::FPatchOutputStrongPtr>& Pair : RegisteredAudioTextures)
+	// the audio is popped into the preallocated rings, the render thread deinterleaves directly into the textures
+	TArray<FCompushadyAudioTexture, TInlineAllocator<4>> Uploads;
+
+	for (const TPair<TWeakObjectPtr<UCompushadyResource>, FCompushadyAudioTexture>& Pair : RegisteredAudioTextures)
 	{
-		if (Pair.Value->GetNumSamplesAvailable() >= Pair.Key->GetTextureSize().X * Pair.Key->GetTextureSize().Y)
+		const FCompushadyAudioTexture& AudioTexture = Pair.Value;
+		const int32 BlockSize = AudioTexture.Ring->GetBlockSize();
+		if (AudioTexture.PatchOutputStrongPtr->GetNumSamplesAvailable() < BlockSize)
 		{
-			TArray<float> TempData;
-			TempData.AddUninitialized(Pair.Key->GetTextureSize().X * Pair.Key->GetTextureSize().Y);
-			Pair.Value->PopAudio(TempData.GetData(), Pair.Key->GetTextureSize().X * Pair.Key->GetTextureSize().Y, true);
-			Pair.Key->UpdateTextureSliceSyncWithFunction(reinterpret_cast<const uint8*>(TempData.GetData()), TempData.Num() * sizeof(float), 0,
-				[&](FRHICommandListImmediate& RHICmdList, void* Data, const uint32 SourcePitch, const uint32 DestPitch)
-				{
-					float* Samples = reinterpret_cast<float*>(Data);
-					for (int32 Y = 0; Y < Pair.Key->GetTextureSize().Y; Y++)
-					{
-						for (int32 X = 0; X < Pair.Key->GetTextureSize().X; X++)
-						{
-							Samples[Y * Pair.Key->GetTextureSize().X + X] = TempData[X * Pair.Key->GetTextureSize().Y + Y];
-						}
-					}
-				});
+			continue;
+		}
+
+		// the render thread is still behind, retry on the next tick
+		float* Block = AudioTexture.Ring->BeginWrite();
+		if (!Block)
+		{
+			continue;
 		}
+
+		AudioTexture.PatchOutputStrongPtr->PopAudio(Block, BlockSize, true);
+		AudioTexture.Ring->EndWrite();
+
+		Uploads.Add(AudioTexture);
+		Pair.Key->IncrementVersion();
+	}
+
+	if (Uploads.Num() == 0)
+	{
+		return;
 	}
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyUploadAudioTextures)(
+		[Uploads](FRHICommandListImmediate& RHICmdList)
+		{
+			for (const FCompushadyAudioTexture& AudioTexture : Uploads)
+			{
+				// only the most recent block ends in the texture
+				while (AudioTexture.Ring->Num() > 1)
+				{
+					AudioTexture.Ring->EndRead();
+				}
+
+				const float* Block = AudioTexture.Ring->BeginRead();
+				if (!Block)
+				{
+					continue;
+				}
+
+				uint32 DestStride;
+				void* Data = RHICmdList.LockTexture2D(AudioTexture.TextureRHIRef, 0, EResourceLockMode::RLM_WriteOnly, DestStride, false);
+				if (Data)
+				{
+					Compushady::Audio::Deinterleave(Block, reinterpret_cast<float*>(Data), AudioTexture.NumFrames, AudioTexture.NumChannels, DestStride / sizeof(float));
+					RHICmdList.UnlockTexture2D(AudioTexture.TextureRHIRef, 0, false);
+				}
+
+				AudioTexture.Ring->EndRead();
+			}
+		});
 }
 
 TStatId UCompushadyAudioSubsystem::GetStatId() const
@@ -64,5 +196,13 @@ TStatId UCompushadyAudioSubsystem::GetStatId() const
 
 void UCompushadyAudioSubsystem::RegisterAudioTexture(UCompushadyResource* InResource, Audio::FPatchOutputStrongPtr InPatchOutputStrongPtr)
 {
-	RegisteredAudioTextures.Add(InResource, InPatchOutputStrongPtr);
+	FCompushadyAudioTexture AudioTexture;
+	AudioTexture.TextureRHIRef = InResource->GetTextureRHI();
+	AudioTexture.PatchOutputStrongPtr = InPatchOutputStrongPtr;
+	AudioTexture.NumFrames = InResource->GetTextureSize().X;
+	AudioTexture.NumChannels = InResource->GetTextureSize().Y;
+	// a few blocks of slack for when the render thread lags behind the game thread
+	AudioTexture.Ring = MakeShared<Compushady::Audio::FCompushadyAudioBlockRing, ESPMode::ThreadSafe>(4, AudioTexture.NumFrames * AudioTexture.NumChannels);
+
+	RegisteredAudioTextures.Add(InResource, AudioTexture);
 }
\ No newline at end of file
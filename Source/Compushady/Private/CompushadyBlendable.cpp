@@ -2,6 +2,10 @@
 
 
 #include "CompushadyBlendable.h"
+#include "CompushadyCBV.h"
+#include "CompushadySampler.h"
+#include "CompushadySRV.h"
+#include "CompushadyUAV.h"
 
 #if COMPUSHADY_UE_VERSION >= 53
 #include "PostProcess/PostProcessMaterialInputs.h"
@@ -9,9 +13,199 @@
 #include "SceneViewExtension.h"
 #include "SystemTextures.h"
 #include "FXRenderingUtils.h"
+#include "RenderGraphUtils.h"
+#include "RHIStaticStates.h"
+#include "RHIUniformBufferLayoutInitializer.h"
 
 #include "CompushadyBlitterSubsystem.h"
 
+namespace Compushady
+{
+	namespace Blendable
+	{
+		static uint32 GetSceneTexturesMask(const FCompushadyResourceArray& ResourceArray)
+		{
+			uint32 SceneTexturesMask = 0;
+			for (const UCompushadySRV* SRV : ResourceArray.SRVs)
+			{
+				if (SRV && SRV->IsSceneTexture())
+				{
+					SceneTexturesMask |= 1 << static_cast<uint32>(SRV->GetSceneTexture());
+				}
+			}
+			return SceneTexturesMask;
+		}
+
+		// the history textures follow the output of the blendable, the other scene textures change every frame
+		static bool HasFrameSceneTextures(const FCompushadyResourceArray& ResourceArray)
+		{
+			for (const UCompushadySRV* SRV : ResourceArray.SRVs)
+			{
+				if (SRV && SRV->IsSceneTexture() && SRV->GetSceneTexture() < ECompushadySceneTexture::History0)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static bool HasSceneTexture(const uint32 SceneTexturesMask, const ECompushadySceneTexture SceneTexture)
+		{
+			return (SceneTexturesMask & (1 << static_cast<uint32>(SceneTexture))) != 0;
+		}
+
+		static FRDGTextureRef GetSceneTexture(const ECompushadySceneTexture SceneTexture, const FSceneTextureUniformParameters* Contents, FRDGTextureRef SceneColorInput, const TArray<FRDGTextureRef>& HistoryTextures)
+		{
+			switch (SceneTexture)
+			{
+			case ECompushadySceneTexture::SceneColorInput:
+				return SceneColorInput;
+			case ECompushadySceneTexture::SceneColor:
+				return Contents->SceneColorTexture;
+			case ECompushadySceneTexture::Depth:
+			case ECompushadySceneTexture::Stencil:
+				return Contents->SceneDepthTexture;
+			case ECompushadySceneTexture::CustomDepth:
+				return Contents->CustomDepthTexture;
+			case ECompushadySceneTexture::CustomStencil:
+				return Contents->CustomStencilTexture ? Contents->CustomStencilTexture->Desc.Texture : nullptr;
+			case ECompushadySceneTexture::GBufferA:
+				return Contents->GBufferATexture;
+			case ECompushadySceneTexture::GBufferB:
+				return Contents->GBufferBTexture;
+			case ECompushadySceneTexture::GBufferC:
+				return Contents->GBufferCTexture;
+			case ECompushadySceneTexture::GBufferD:
+				return Contents->GBufferDTexture;
+			case ECompushadySceneTexture::GBufferE:
+				return Contents->GBufferETexture;
+			case ECompushadySceneTexture::GBufferF:
+				return Contents->GBufferFTexture;
+			case ECompushadySceneTexture::Velocity:
+				return Contents->GBufferVelocityTexture;
+			case ECompushadySceneTexture::History0:
+			case ECompushadySceneTexture::History1:
+			case ECompushadySceneTexture::History2:
+			case ECompushadySceneTexture::History3:
+			{
+				const int32 HistoryIndex = static_cast<int32>(SceneTexture) - static_cast<int32>(ECompushadySceneTexture::History0);
+				return HistoryTextures.IsValidIndex(HistoryIndex) ? HistoryTextures[HistoryIndex] : nullptr;
+			}
+			default:
+				break;
+			}
+			return nullptr;
+		}
+
+		/* Declares the scene textures read by a blendable, textures already declared (like the render targets) keep their access */
+		static void AddSceneTextureAccesses(FCompushadyRDGComputePassParameters* PassParameters, const uint32 SceneTexturesMask, const ERHIAccess Access, const FSceneTextureUniformParameters* Contents, FRDGTextureRef SceneColorInput, const TArray<FRDGTextureRef>& HistoryTextures)
+		{
+			for (uint32 Index = 1; Index < static_cast<uint32>(ECompushadySceneTexture::Max); Index++)
+			{
+				const ECompushadySceneTexture SceneTexture = static_cast<ECompushadySceneTexture>(Index);
+				if (!HasSceneTexture(SceneTexturesMask, SceneTexture))
+				{
+					continue;
+				}
+
+				FRDGTextureRef Texture = GetSceneTexture(SceneTexture, Contents, SceneColorInput, HistoryTextures);
+				if (!Texture || PassParameters->TextureAccesses.ContainsByPredicate([Texture](const FRDGTextureAccess& TextureAccess) { return TextureAccess.GetTexture() == Texture; }))
+				{
+					continue;
+				}
+
+				PassParameters->TextureAccesses.Emplace(Texture, Access);
+			}
+		}
+
+		static FCompushadyRDGComputePassParameters* CreateRasterPassParameters(FRDGBuilder& GraphBuilder, const TArray<FRDGTextureRef>& RenderTargets, FRDGTextureRef DepthStencil, const FCompushadyResourceArray& VSResourceArray, const FCompushadyResourceArray& PSResourceArray, const FSceneTextureUniformParameters* Contents, FRDGTextureRef SceneColorInput, const TArray<FRDGTextureRef>& HistoryTextures)
+		{
+			TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+			FString ErrorMessages;
+			if (!Compushady::RDG::CollectResourceAccesses(VSResourceArray, Accesses, ErrorMessages, ERHIAccess::SRVGraphics, ERHIAccess::UAVGraphics, true) ||
+				!Compushady::RDG::CollectResourceAccesses(PSResourceArray, Accesses, ErrorMessages, ERHIAccess::SRVGraphics, ERHIAccess::UAVGraphics, true))
+			{
+				UE_LOG(LogCompushady, Error, TEXT("Unable to add Compushady Blendable pass: %s"), *ErrorMessages);
+				return nullptr;
+			}
+
+			FCompushadyRDGComputePassParameters* PassParameters = Compushady::RDG::CreatePassParameters(GraphBuilder, Accesses);
+
+			// the render pass is started by the blendable itself (ERDGPassFlags::SkipRenderPass)
+			for (FRDGTextureRef RenderTarget : RenderTargets)
+			{
+				PassParameters->TextureAccesses.Emplace(RenderTarget, ERHIAccess::RTV);
+			}
+
+			if (DepthStencil)
+			{
+				PassParameters->TextureAccesses.Emplace(DepthStencil, ERHIAccess::DSVWrite);
+			}
+
+			// the vertex shader has no access to the scene textures
+			AddSceneTextureAccesses(PassParameters, GetSceneTexturesMask(PSResourceArray), ERHIAccess::SRVGraphics, Contents, SceneColorInput, HistoryTextures);
+
+			return PassParameters;
+		}
+
+		/* Compushady::Utils::SetupPipelineParameters without transitions (the render graph already did them) */
+		template<typename SHADER_TYPE>
+		static void SetupParameters(FRHICommandList& RHICmdList, SHADER_TYPE Shader, const FCompushadyResourceArray& ResourceArray, const FCompushadyResourceBindings& ResourceBindings, const FCompushadySceneTextures& SceneTextures, const bool bSyncCBV, const TArray<uint8>& CBVZeroData = {})
+		{
+			Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, Shader, ResourceBindings,
+				[&](const int32 Index)
+				{
+					// the first CBV gets the copy with the view data (taken in SetupView)
+					if (Index == 0 && CBVZeroData.Num() > 0)
+					{
+						ResourceArray.CBVs[Index]->SyncBufferDataWithData(RHICmdList, CBVZeroData);
+					}
+					else if (bSyncCBV && ResourceArray.CBVs[Index]->BufferDataIsDirty())
+					{
+						ResourceArray.CBVs[Index]->SyncBufferData(RHICmdList);
+					}
+					return ResourceArray.CBVs[Index]->GetRHI();
+				},
+				[&](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+				{
+					UCompushadySRV* SRV = ResourceArray.SRVs[Index];
+					if (SRV->IsSceneTexture())
+					{
+						return SRV->GetRHI(SceneTextures);
+					}
+
+					// acceleration structures are not tracked by the render graph
+					if (SRV->IsAccelerationStructure())
+					{
+						RHICmdList.Transition(SRV->GetRHITransitionInfo());
+					}
+					return { SRV->GetRHI(), nullptr };
+				},
+				[&](const int32 Index)
+				{
+					return ResourceArray.UAVs[Index]->GetRHI();
+				},
+				[&](const int32 Index)
+				{
+					return ResourceArray.Samplers[Index]->GetRHI();
+				}, bSyncCBV);
+		}
+
+		static FCriticalSection PostProcessesLock;
+		static TSet<const ISceneViewExtension*> PostProcesses;
+
+		// history of views not rendered for this number of frames is released
+		static constexpr uint32 HistoryMaxAge = 60;
+
+		// ensure 16 bytes alignment!
+		struct FCompushadyBlendableUpsampleConfig
+		{
+			FVector4f ScaledSize = FVector4f::Zero(); // xy size, zw texel size
+			FVector4f DepthUV = FVector4f::Zero(); // xy origin, zw size (of the view rect in the depth texture)
+		};
+	}
+}
+
 class ICompushadyViewExtension
 {
 public:
@@ -20,6 +214,65 @@ public:
 		CompushadyPriority = NewPriority;
 	}
 
+	void SetHistory(const int32 NumHistoryBuffers)
+	{
+		History.SetNumBuffers(NumHistoryBuffers);
+	}
+
+	// the upsample pixel shader is used by scaled blendables and for compositing the cached output of dirty driven ones
+	// every upsample pass creates its own uniform buffer with the layout owned by the blendable (the extensions can be recreated every frame)
+	void SetResolutionScale(const float InResolutionScale, const ECompushadyBlendableUpsampleFilter InUpsampleFilter, FPixelShaderRHIRef InUpsamplePixelShaderRef, const FCompushadyResourceBindings& InUpsampleResourceBindings, FUniformBufferLayoutRHIRef InUpsampleUniformBufferLayoutRef)
+	{
+		if (!InUpsamplePixelShaderRef || !InUpsampleUniformBufferLayoutRef)
+		{
+			return;
+		}
+
+		ResolutionScale = InResolutionScale;
+		UpsampleFilter = InUpsampleFilter;
+		UpsamplePixelShaderRef = InUpsamplePixelShaderRef;
+		UpsampleResourceBindings = InUpsampleResourceBindings;
+		UpsampleUniformBufferLayoutRef = InUpsampleUniformBufferLayoutRef;
+	}
+
+	/*
+	 * Copies (in SetupView) the CBV receiving the view data: the vertex shader one, the compute one or the pixel shader one of full screen blendables.
+	 * Dirty driven blendables hash the contents of their CBVs here too.
+	 */
+	void CopyCBVData()
+	{
+		// make a copy of the CBV for thread-safe management (we need to rely on copies)
+		if (VertexShaderRef)
+		{
+			if (VSResourceArray.CBVs.Num() > 0)
+			{
+				CBVData = VSResourceArray.CBVs[0]->GetBufferData();
+			}
+		}
+		else if (ComputeShaderRef)
+		{
+			if (ComputeResourceArray.CBVs.Num() > 0)
+			{
+				CBVData = ComputeResourceArray.CBVs[0]->GetBufferData();
+			}
+		}
+		else if (PSResourceArray.CBVs.Num() > 0)
+		{
+			CBVData = PSResourceArray.CBVs[0]->GetBufferData();
+		}
+
+		if (bDirtyDriven)
+		{
+			CBVsSignature = Compushady::Blendable::GetCBVsSignature(ComputeShaderRef ? ComputeResourceArray : PSResourceArray);
+		}
+	}
+
+	void SetDirtyDriven(const bool bInDirtyDriven, TSharedPtr<FThreadSafeCounter, ESPMode::ThreadSafe> InDirtyCounter)
+	{
+		bDirtyDriven = bInDirtyDriven;
+		DirtyCounter = InDirtyCounter;
+	}
+
 protected:
 
 	ICompushadyViewExtension(FVertexShaderRHIRef InVertexShaderRef, const FCompushadyResourceBindings& InVSResourceBindings, const FCompushadyResourceArray& InVSResourceArray, FPixelShaderRHIRef InPixelShaderRef, const FCompushadyResourceBindings& InPSResourceBindings, const FCompushadyResourceArray& InPSResourceArray, const int32 InNumVertices, const int32 InNumInstances, const FCompushadyBlendableRasterizerConfig& InRasterizerConfig) :
@@ -35,32 +288,172 @@ protected:
 	{
 	}
 
-	void FillSceneTextures(FCompushadySceneTextures& SceneTextures, FRHICommandList& RHICmdList, FTextureRHIRef SceneColorInput, const FSceneTextureUniformParameters* Contents)
+	// only the scene textures in SceneTexturesMask are declared to the render graph, so only them can be accessed
+	void FillSceneTextures(FCompushadySceneTextures& SceneTextures, FRHICommandList& RHICmdList, FRDGTextureRef SceneColorInput, const FSceneTextureUniformParameters* Contents, const uint32 SceneTexturesMask)
+	{
+		auto SetTexture = [&](const ECompushadySceneTexture SceneTexture, FRDGTextureRef Texture)
+			{
+				if (Compushady::Blendable::HasSceneTexture(SceneTexturesMask, SceneTexture))
+				{
+					SceneTextures.SetTexture(SceneTexture, Texture ? Texture->GetRHI() : nullptr);
+				}
+			};
+
+		SetTexture(ECompushadySceneTexture::SceneColorInput, SceneColorInput);
+		SetTexture(ECompushadySceneTexture::SceneColor, Contents->SceneColorTexture);
+
+		const bool bHasDepth = Compushady::Blendable::HasSceneTexture(SceneTexturesMask, ECompushadySceneTexture::Depth);
+		const bool bHasStencil = Compushady::Blendable::HasSceneTexture(SceneTexturesMask, ECompushadySceneTexture::Stencil);
+		if (bHasDepth || bHasStencil)
+		{
+			FRHITexture* DepthTexture = Contents->SceneDepthTexture->GetRHI();
+
+			FRHIViewDesc::FTextureSRV::FInitializer SRVViewDesc = FRHIViewDesc::CreateTextureSRV();
+			SRVViewDesc.SetDimensionFromTexture(DepthTexture);
+
+			if (bHasDepth)
+			{
+				SRVViewDesc.SetPlane(ERHITexturePlane::Depth);
+				FShaderResourceViewRHIRef DepthSRV = COMPUSHADY_CREATE_SRV(DepthTexture, SRVViewDesc);
+				SceneTextures.SetSRV(ECompushadySceneTexture::Depth, DepthSRV);
+			}
+
+			if (bHasStencil)
+			{
+				SRVViewDesc.SetPlane(ERHITexturePlane::Stencil);
+				FShaderResourceViewRHIRef StencilSRV = COMPUSHADY_CREATE_SRV(DepthTexture, SRVViewDesc);
+				SceneTextures.SetSRV(ECompushadySceneTexture::Stencil, StencilSRV);
+			}
+		}
+
+		SetTexture(ECompushadySceneTexture::CustomDepth, Contents->CustomDepthTexture);
+		if (Compushady::Blendable::HasSceneTexture(SceneTexturesMask, ECompushadySceneTexture::CustomStencil))
+		{
+			SceneTextures.SetSRV(ECompushadySceneTexture::CustomStencil, Contents->CustomStencilTexture ? Contents->CustomStencilTexture->GetRHI() : nullptr);
+		}
+		SetTexture(ECompushadySceneTexture::GBufferA, Contents->GBufferATexture);
+		SetTexture(ECompushadySceneTexture::GBufferB, Contents->GBufferBTexture);
+		SetTexture(ECompushadySceneTexture::GBufferC, Contents->GBufferCTexture);
+		SetTexture(ECompushadySceneTexture::GBufferD, Contents->GBufferDTexture);
+		SetTexture(ECompushadySceneTexture::GBufferE, Contents->GBufferETexture);
+		SetTexture(ECompushadySceneTexture::GBufferF, Contents->GBufferFTexture);
+		SetTexture(ECompushadySceneTexture::Velocity, Contents->GBufferVelocityTexture);
+	}
+
+	// history targets without valid contents are bound as transparent black
+	void FillHistoryTextures(FCompushadySceneTextures& SceneTextures, const TArray<FRDGTextureRef>& HistoryTextures, const uint32 SceneTexturesMask)
+	{
+		for (int32 HistoryIndex = 0; HistoryIndex < Compushady::Blendable::MaxHistoryBuffers; HistoryIndex++)
+		{
+			const ECompushadySceneTexture SceneTexture = static_cast<ECompushadySceneTexture>(static_cast<int32>(ECompushadySceneTexture::History0) + HistoryIndex);
+			if (Compushady::Blendable::HasSceneTexture(SceneTexturesMask, SceneTexture))
+			{
+				SceneTextures.SetTexture(SceneTexture, HistoryTextures.IsValidIndex(HistoryIndex) ? HistoryTextures[HistoryIndex]->GetRHI() : nullptr);
+			}
+		}
+	}
+
+	/* Validates the history of the view against the Output format and OutputRect size, and registers the valid targets */
+	TArray<FRDGTextureRef> RegisterHistory_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, FRDGTextureRef Output, const FIntRect& OutputRect)
 	{
-		SceneTextures.SetTexture(ECompushadySceneTexture::SceneColorInput, SceneColorInput);
+		TArray<FRDGTextureRef> HistoryTextures;
+		if (History.GetNumBuffers() == 0 || !Output)
+		{
+			return HistoryTextures;
+		}
 
-		SceneTextures.SetTexture(ECompushadySceneTexture::SceneColor, Contents->SceneColorTexture->GetRHI());
+		History.RemoveStaleViews(View.Family->FrameNumber, Compushady::Blendable::HistoryMaxAge);
+		History.BeginFrame(View.GetViewKey(), OutputRect.Size(), Output->Desc.Format, View.bCameraCut, View.Family->FrameNumber);
 
-		FRHIViewDesc::FTextureSRV::FInitializer SRVViewDesc = FRHIViewDesc::CreateTextureSRV();
-		SRVViewDesc.SetDimensionFromTexture(Contents->SceneDepthTexture->GetRHI());
+		if (const auto* HistoryView = History.FindView(View.GetViewKey()))
+		{
+			for (int32 HistoryIndex = 0; HistoryIndex < HistoryView->NumValid; HistoryIndex++)
+			{
+				HistoryTextures.Add(GraphBuilder.RegisterExternalTexture(HistoryView->Targets[HistoryIndex]));
+			}
+		}
 
-		SRVViewDesc.SetPlane(ERHITexturePlane::Depth);
-		FShaderResourceViewRHIRef DepthSRV = COMPUSHADY_CREATE_SRV(Contents->SceneDepthTexture->GetRHI(), SRVViewDesc);
-		SceneTextures.SetSRV(ECompushadySceneTexture::Depth, DepthSRV);
+		return HistoryTextures;
+	}
 
-		SRVViewDesc.SetPlane(ERHITexturePlane::Stencil);
-		FShaderResourceViewRHIRef StencilSRV = COMPUSHADY_CREATE_SRV(Contents->SceneDepthTexture->GetRHI(), SRVViewDesc);
-		SceneTextures.SetSRV(ECompushadySceneTexture::Stencil, StencilSRV);
+	/* Copies OutputRect of Output to the history of the view (to be called after the passes reading the history) */
+	void UpdateHistory_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, FRDGTextureRef Output, const FIntRect& OutputRect)
+	{
+		if (History.GetNumBuffers() == 0 || !Output)
+		{
+			return;
+		}
+
+		bool bRecycled = false;
+		TRefCountPtr<IPooledRenderTarget>* Target = History.AcquireTarget(View.GetViewKey(), bRecycled);
+		if (!Target)
+		{
+			return;
+		}
+
+		FRDGTextureRef HistoryTexture = nullptr;
+		if (bRecycled)
+		{
+			HistoryTexture = GraphBuilder.RegisterExternalTexture(*Target);
+		}
+		else
+		{
+			// the extracted texture comes from (and goes back to) the render target pool
+			HistoryTexture = GraphBuilder.CreateTexture(FRDGTextureDesc::Create2D(OutputRect.Size(), Output->Desc.Format, FClearValueBinding::Black, TexCreate_ShaderResource), TEXT("Compushady::Blendable::History"));
+			GraphBuilder.QueueTextureExtraction(HistoryTexture, Target);
+		}
+
+		FRHICopyTextureInfo CopyTextureInfo;
+		CopyTextureInfo.SourcePosition = FIntVector(OutputRect.Min.X, OutputRect.Min.Y, 0);
+		CopyTextureInfo.Size = FIntVector(OutputRect.Width(), OutputRect.Height(), 1);
+		AddCopyTexturePass(GraphBuilder, Output, HistoryTexture, CopyTextureInfo);
+	}
+
+	/*
+	 * Signature of the inputs of a dirty driven blendable: the bound resources, the view matrices and the MarkDirty() counter.
+	 * The CBVs contents are hashed by SetupView (the game thread can write them while the render thread runs).
+	 */
+	uint32 GetInputsSignature(const FSceneView& View, const FIntRect& ViewRect, const FCompushadyResourceArray& ResourceArray) const
+	{
+		const FMatrix ViewProjectionMatrix = View.ViewMatrices.GetViewProjectionMatrix();
+		uint32 Signature = FCrc::MemCrc32(&ViewProjectionMatrix, sizeof(FMatrix));
+		Signature = HashCombine(Signature, GetTypeHash(ViewRect.Min));
+		Signature = HashCombine(Signature, GetTypeHash(ViewRect.Max));
+		Signature = HashCombine(Signature, GetTypeHash(DirtyCounter ? DirtyCounter->GetValue() : 0));
+		Signature = HashCombine(Signature, CBVsSignature);
+		return Compushady::Blendable::GetResourceVersionsSignature(ResourceArray, Signature);
+	}
+
+	// the render thread increments the versions immediately, so the blendables of the next passes see them
+	void IncrementUAVVersions(const FCompushadyResourceArray& ResourceArray)
+	{
+		for (UCompushadyUAV* UAV : ResourceArray.UAVs)
+		{
+			UAV->IncrementVersion();
+		}
+	}
+
+	void FillRenderTargets(FCompushadySceneTextures& SceneTextures, TArray<FTextureRHIRef>& RTVs, const TArray<FRDGTextureRef>& RenderTargets, const bool bBasePassRenderTargets)
+	{
+		// the base pass renders (in order) to SceneColor and the GBuffers
+		static const ECompushadySceneTexture BasePassSceneTextures[] =
+		{
+			ECompushadySceneTexture::SceneColor,
+			ECompushadySceneTexture::GBufferA,
+			ECompushadySceneTexture::GBufferB,
+			ECompushadySceneTexture::GBufferC,
+			ECompushadySceneTexture::GBufferD,
+			ECompushadySceneTexture::GBufferE
+		};
 
-		SceneTextures.SetTexture(ECompushadySceneTexture::CustomDepth, Contents->CustomDepthTexture->GetRHI());
-		SceneTextures.SetSRV(ECompushadySceneTexture::CustomStencil, Contents->CustomStencilTexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferA, Contents->GBufferATexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferB, Contents->GBufferBTexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferC, Contents->GBufferCTexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferD, Contents->GBufferDTexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferE, Contents->GBufferETexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::GBufferF, Contents->GBufferFTexture->GetRHI());
-		SceneTextures.SetTexture(ECompushadySceneTexture::Velocity, Contents->GBufferVelocityTexture->GetRHI());
+		for (int32 RTVIndex = 0; RTVIndex < RenderTargets.Num(); RTVIndex++)
+		{
+			RTVs.Add(RenderTargets[RTVIndex]->GetRHI());
+			if (bBasePassRenderTargets && RTVIndex < static_cast<int32>(UE_ARRAY_COUNT(BasePassSceneTextures)))
+			{
+				SceneTextures.SetTexture(BasePassSceneTextures[RTVIndex], RTVs[RTVIndex]);
+			}
+		}
 	}
 
 	FIntRect GetViewRectAndFillCBVZero(const FSceneView& View, const bool bBeforeUpscaling)
@@ -82,167 +475,314 @@ protected:
 			return ScreenSize;
 		}
 
-		auto SetMatrixByOffset = [&](const int32 Offset, const FMatrix& Matrix)
-			{
-				if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 16)) <= CBVData.Num())
-				{
-					FMemory::Memcpy(CBVData.GetData() + Offset, FMatrix44f(Matrix).M, sizeof(float) * 16);
-				}
-			};
+		Compushady::Blendable::FCompushadyBlendableViewData ViewData;
+		ViewData.ViewMatrix = View.ViewMatrices.GetViewMatrix();
+		ViewData.ProjectionMatrix = View.ViewMatrices.GetProjectionMatrix();
+		ViewData.InverseViewMatrix = View.ViewMatrices.GetInvViewMatrix();
+		ViewData.InverseProjectionMatrix = View.ViewMatrices.GetInvProjectionMatrix();
+		ViewData.ViewProjectionMatrix = View.ViewMatrices.GetViewProjectionMatrix();
+		ViewData.InverseViewProjectionMatrix = View.ViewMatrices.GetInvViewProjectionMatrix();
+		ViewData.ViewOrigin = View.ViewMatrices.GetViewOrigin();
+		ViewData.ScreenSize = ScreenSize.Size();
+		ViewData.DeltaTime = View.Family->Time.GetDeltaRealTimeSeconds();
+		ViewData.Time = View.Family->Time.GetRealTimeSeconds();
+
+		// the matrices are tracked for every blendable (not only the ones with history), so closed views must be released here too
+		History.RemoveStaleViews(View.Family->FrameNumber, Compushady::Blendable::HistoryMaxAge);
+		History.UpdateViewMatrices(View.GetViewKey(), View.bCameraCut, View.Family->FrameNumber, ViewData);
+
+		// custom vertex shaders always render at full resolution
+		Compushady::Blendable::FillMatrices(CBVData, RasterizerConfig.MatricesConfig, ViewData, VertexShaderRef ? 1.0f : ResolutionScale);
 
-		auto SetVector2ByOffset = [&](const int32 Offset, const FVector2D Vector)
-			{
-				if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 2)) <= CBVData.Num())
-				{
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Vector.X;
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float))) = Vector.Y;
-				}
-			};
+		return ScreenSize;
+	}
 
-		auto SetVector4ByOffset = [&](const int32 Offset, const FVector4 Vector)
-			{
-				if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 4)) <= CBVData.Num())
+	void AddRasterPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const TCHAR* PassName, const bool bBeforeUpscaling, const TArray<FRDGTextureRef>& RenderTargets, const FSceneTextureUniformParameters* SceneTextureContents, FRDGTextureRef SceneColorInput, const bool bBasePassRenderTargets)
+	{
+		if (RenderTargets.Num() == 0)
+		{
+			return;
+		}
+
+		const FIntRect ViewRect = GetViewRectAndFillCBVZero(View, bBeforeUpscaling);
+
+		const bool bFullScreen = UpsamplePixelShaderRef && !VertexShaderRef && !bBasePassRenderTargets && RenderTargets.Num() == 1;
+
+		if (bDirtyDriven && bFullScreen)
+		{
+			AddCachedRasterPass_RenderThread(GraphBuilder, View, PassName, ViewRect, RenderTargets[0], SceneTextureContents, SceneColorInput);
+			return;
+		}
+
+		const TArray<FRDGTextureRef> HistoryTextures = RegisterHistory_RenderThread(GraphBuilder, View, RenderTargets[0], ViewRect);
+
+		if (ResolutionScale < 1 && bFullScreen)
+		{
+			AddScaledRasterPass_RenderThread(GraphBuilder, View, PassName, ViewRect, RenderTargets[0], SceneTextureContents, SceneColorInput, HistoryTextures);
+			UpdateHistory_RenderThread(GraphBuilder, View, RenderTargets[0], ViewRect);
+			IncrementUAVVersions(PSResourceArray);
+			return;
+		}
+
+		// custom vertex shaders are rendered with the scene depth attached
+		FRDGTextureRef DepthStencil = VertexShaderRef ? SceneTextureContents->SceneDepthTexture : nullptr;
+
+		FCompushadyRDGComputePassParameters* PassParameters = Compushady::Blendable::CreateRasterPassParameters(GraphBuilder, RenderTargets, DepthStencil, VSResourceArray, PSResourceArray, SceneTextureContents, SceneColorInput, HistoryTextures);
+		if (!PassParameters)
+		{
+			return;
+		}
+
+		const uint32 SceneTexturesMask = Compushady::Blendable::GetSceneTexturesMask(PSResourceArray);
+
+		if (!VertexShaderRef)
+		{
+			FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
+			TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
+
+			RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
+
+			GraphBuilder.AddPass(
+				RDG_EVENT_NAME("%s", PassName),
+				PassParameters,
+				ERDGPassFlags::Raster | ERDGPassFlags::SkipRenderPass,
+				[this, PassName, ViewRect, VertexShader, RenderTargets, SceneTextureContents, SceneColorInput, SceneTexturesMask, HistoryTextures, bBasePassRenderTargets, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
 				{
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Vector.X;
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float))) = Vector.Y;
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float) * 2)) = Vector.Z;
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float) * 3)) = Vector.W;
-				}
-			};
+					FCompushadySceneTextures SceneTextures = {};
+					FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput, SceneTextureContents, SceneTexturesMask);
+					FillHistoryTextures(SceneTextures, HistoryTextures, SceneTexturesMask);
 
-		auto SetFloatByOffset = [&](const int32 Offset, const float Value)
-			{
-				if (Offset >= 0 && static_cast<int64>(Offset + sizeof(float)) <= CBVData.Num())
+					TArray<FTextureRHIRef> RTVs;
+					FillRenderTargets(SceneTextures, RTVs, RenderTargets, bBasePassRenderTargets);
+
+					Compushady::Utils::RasterizeSimplePass_RenderThread(PassName, RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, RTVs, nullptr, [&]()
+						{
+							Compushady::Blendable::SetupParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, true, CopyBufferData);
+							UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
+								0, 0, 1, 1,
+								ViewRect.Size(),
+								FIntPoint(1, 1),
+								INDEX_NONE,
+								false, EDRF_UseTriangleOptimization);
+						}, RasterizerConfig.RasterizerConfig);
+				});
+		}
+		else
+		{
+			GraphBuilder.AddPass(
+				RDG_EVENT_NAME("%s", PassName),
+				PassParameters,
+				ERDGPassFlags::Raster | ERDGPassFlags::SkipRenderPass,
+				[this, PassName, ViewRect, RenderTargets, DepthStencil, SceneTextureContents, SceneColorInput, SceneTexturesMask, HistoryTextures, bBasePassRenderTargets, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
 				{
-					*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Value;
-				}
-			};
+					FCompushadySceneTextures SceneTextures = {};
+					FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput, SceneTextureContents, SceneTexturesMask);
+					FillHistoryTextures(SceneTextures, HistoryTextures, SceneTexturesMask);
 
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.ViewMatrixOffset, View.ViewMatrices.GetViewMatrix());
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.ProjectionMatrixOffset, View.ViewMatrices.GetProjectionMatrix());
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.InverseViewMatrixOffset, View.ViewMatrices.GetInvViewMatrix());
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.InverseProjectionMatrixOffset, View.ViewMatrices.GetInvProjectionMatrix());
-		SetVector2ByOffset(RasterizerConfig.MatricesConfig.ScreenSizeFloat2Offset, ScreenSize.Size());
+					TArray<FTextureRHIRef> RTVs;
+					FillRenderTargets(SceneTextures, RTVs, RenderTargets, bBasePassRenderTargets);
 
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.ViewProjectionMatrixOffset, View.ViewMatrices.GetViewProjectionMatrix());
-		SetMatrixByOffset(RasterizerConfig.MatricesConfig.InverseViewProjectionMatrixOffset, View.ViewMatrices.GetInvViewProjectionMatrix());
+					Compushady::Utils::RasterizeSimplePass_RenderThread(PassName, RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RTVs, DepthStencil->GetRHI(), [&]()
+						{
+							if (VSResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
+							{
+								VSResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
+							}
+							Compushady::Blendable::SetupParameters(RHICmdList, VertexShaderRef, VSResourceArray, VSResourceBindings, {}, false);
+							Compushady::Blendable::SetupParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, false);
+							Compushady::Utils::DrawVertices(RHICmdList, NumVertices, NumInstances, RasterizerConfig.RasterizerConfig);
+						}, RasterizerConfig.RasterizerConfig);
+				});
+		}
 
-		SetVector4ByOffset(RasterizerConfig.MatricesConfig.ViewOriginFloat4Offset, View.ViewMatrices.GetViewOrigin());
+		UpdateHistory_RenderThread(GraphBuilder, View, RenderTargets[0], ViewRect);
+		IncrementUAVVersions(PSResourceArray);
+	}
 
-		SetFloatByOffset(RasterizerConfig.MatricesConfig.DeltaTimeFloatOffset, View.Family->Time.GetDeltaRealTimeSeconds());
-		SetFloatByOffset(RasterizerConfig.MatricesConfig.TimeFloatOffset, View.Family->Time.GetRealTimeSeconds());
+	/* Renders the pixel shader into a scaled texture (allocated by the render graph from the render target pool) and upsamples it to RenderTarget */
+	void AddScaledRasterPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const TCHAR* PassName, const FIntRect& ViewRect, FRDGTextureRef RenderTarget, const FSceneTextureUniformParameters* SceneTextureContents, FRDGTextureRef SceneColorInput, const TArray<FRDGTextureRef>& HistoryTextures)
+	{
+		const FIntPoint ScaledSize = Compushady::Blendable::GetScaledSize(ViewRect.Size(), ResolutionScale);
 
-		return ScreenSize;
+		FRDGTextureRef ScaledTexture = GraphBuilder.CreateTexture(FRDGTextureDesc::Create2D(ScaledSize, RenderTarget->Desc.Format, FClearValueBinding::Black, TexCreate_RenderTargetable | TexCreate_ShaderResource), TEXT("Compushady::Blendable::Scaled"));
+
+		AddOffscreenRasterPass_RenderThread(GraphBuilder, View, PassName, ScaledTexture, SceneTextureContents, SceneColorInput, HistoryTextures);
+		AddUpsamplePass_RenderThread(GraphBuilder, View, ViewRect, ScaledTexture, RenderTarget, SceneTextureContents, ECompushadyRasterizerBlendMode::Always);
 	}
 
-	FScreenPassTexture PostProcessCallback_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessMaterialInputs& InOutInputs)
+	/*
+	 * The pixel shader of a dirty driven blendable renders (only when its inputs change) into a per view cached target,
+	 * the cached target is written to RenderTarget every frame (like the uncached pass). The history follows the cached target.
+	 */
+	void AddCachedRasterPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const TCHAR* PassName, const FIntRect& ViewRect, FRDGTextureRef RenderTarget, const FSceneTextureUniformParameters* SceneTextureContents, FRDGTextureRef SceneColorInput)
 	{
-#if COMPUSHADY_UE_VERSION >= 54
-		const FScreenPassTexture& SceneColorInput = FScreenPassTexture::CopyFromSlice(GraphBuilder, InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor));
-#else
-		FScreenPassTexture SceneColorInput = InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor);
-#endif
+		const FIntPoint CachedSize = Compushady::Blendable::GetScaledSize(ViewRect.Size(), ResolutionScale);
+		const FIntRect CachedRect = FIntRect(FIntPoint::ZeroValue, CachedSize);
 
-		FScreenPassRenderTarget Output = InOutInputs.OverrideOutput;
-		if (!Output.IsValid())
+		OutputCache.RemoveStaleViews(View.Family->FrameNumber, Compushady::Blendable::HistoryMaxAge);
+		const bool bExecute = OutputCache.BeginFrame(View.GetViewKey(), CachedSize, RenderTarget->Desc.Format, GetInputsSignature(View, ViewRect, PSResourceArray), View.Family->FrameNumber);
+
+		TRefCountPtr<IPooledRenderTarget>* Target = OutputCache.GetTarget(View.GetViewKey());
+
+		FRDGTextureRef CachedTexture = nullptr;
+		if (Target->IsValid())
 		{
-			Output = FScreenPassRenderTarget::CreateFromInput(GraphBuilder, SceneColorInput, View.GetOverwriteLoadAction(), TEXT("ICompushadyViewExtension::PostProcessCallback_RenderThread"));
+			CachedTexture = GraphBuilder.RegisterExternalTexture(*Target);
+		}
+		else
+		{
+			CachedTexture = GraphBuilder.CreateTexture(FRDGTextureDesc::Create2D(CachedSize, RenderTarget->Desc.Format, FClearValueBinding::Transparent, TexCreate_RenderTargetable | TexCreate_ShaderResource), TEXT("Compushady::Blendable::Cached"));
+			GraphBuilder.QueueTextureExtraction(CachedTexture, Target);
 		}
 
-		GraphBuilder.ConvertToExternalTexture(Output.Texture);
+		if (bExecute)
+		{
+			const TArray<FRDGTextureRef> HistoryTextures = RegisterHistory_RenderThread(GraphBuilder, View, CachedTexture, CachedRect);
+			AddOffscreenRasterPass_RenderThread(GraphBuilder, View, PassName, CachedTexture, SceneTextureContents, SceneColorInput, HistoryTextures);
+			UpdateHistory_RenderThread(GraphBuilder, View, CachedTexture, CachedRect);
+			IncrementUAVVersions(PSResourceArray);
+			// the signature is taken again as the pixel shader could have written to its own UAVs
+			OutputCache.EndFrame(View.GetViewKey(), GetInputsSignature(View, ViewRect, PSResourceArray));
+		}
 
-		const FIntRect ViewRect = GetViewRectAndFillCBVZero(View, false);
+		AddUpsamplePass_RenderThread(GraphBuilder, View, ViewRect, CachedTexture, RenderTarget, SceneTextureContents, ECompushadyRasterizerBlendMode::Always);
+	}
 
-		if (PixelShaderRef)
+	/* Renders the full screen pixel shader into the whole OutputTexture */
+	void AddOffscreenRasterPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const TCHAR* PassName, FRDGTextureRef OutputTexture, const FSceneTextureUniformParameters* SceneTextureContents, FRDGTextureRef SceneColorInput, const TArray<FRDGTextureRef>& HistoryTextures)
+	{
+		const FIntPoint OutputSize = OutputTexture->Desc.Extent;
+
+		FCompushadyRDGComputePassParameters* PassParameters = Compushady::Blendable::CreateRasterPassParameters(GraphBuilder, { OutputTexture }, nullptr, VSResourceArray, PSResourceArray, SceneTextureContents, SceneColorInput, HistoryTextures);
+		if (!PassParameters)
 		{
-			if (!VertexShaderRef)
-			{
-				FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
-				TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
+			return;
+		}
 
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, VertexShader, Output, SceneColorInput, InOutInputs](FRHICommandList& RHICmdList)
-					{
-						FTextureRHIRef RenderTarget = Output.Texture->GetRHI();
+		const uint32 SceneTexturesMask = Compushady::Blendable::GetSceneTexturesMask(PSResourceArray);
 
-						FCompushadySceneTextures SceneTextures = {};
-						FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput.Texture->GetRHI(), InOutInputs.SceneTextures.SceneTextures->GetContents());
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
+		TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
 
-						RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
+		RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-							RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, RenderTarget, [&]()
-							{
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, true);
-								UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
-									0, 0, 1, 1,
-									ViewRect.Size(),
-									FIntPoint(1, 1),
-									INDEX_NONE,
-									false, EDRF_UseTriangleOptimization);
-							}, RasterizerConfig.RasterizerConfig);
-					});
-			}
-			else
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("%s (%dx%d)", PassName, OutputSize.X, OutputSize.Y),
+			PassParameters,
+			ERDGPassFlags::Raster | ERDGPassFlags::SkipRenderPass,
+			[this, PassName, OutputSize, VertexShader, OutputTexture, SceneTextureContents, SceneColorInput, SceneTexturesMask, HistoryTextures, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
 			{
-				const FSceneTextureUniformParameters* SceneTextureUniform = InOutInputs.SceneTextures.SceneTextures->GetContents();
+				FCompushadySceneTextures SceneTextures = {};
+				FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput, SceneTextureContents, SceneTexturesMask);
+				FillHistoryTextures(SceneTextures, HistoryTextures, SceneTexturesMask);
 
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, SceneColorInput, Output, SceneTextureUniform, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
+				Compushady::Utils::RasterizeSimplePass_RenderThread(PassName, RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, OutputTexture->GetRHI(), [&]()
 					{
-						FCompushadySceneTextures SceneTextures = {};
-						FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput.Texture->GetRHI(), SceneTextureUniform);
+						Compushady::Blendable::SetupParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, true, CopyBufferData);
+						UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, 0, 0, OutputSize.X, OutputSize.Y,
+							0, 0, 1, 1,
+							OutputSize,
+							FIntPoint(1, 1),
+							INDEX_NONE,
+							false, EDRF_UseTriangleOptimization);
+					}, RasterizerConfig.RasterizerConfig);
+			});
+	}
 
-						FTextureRHIRef RenderTarget = Output.Texture->GetRHI();
+	/* Upsamples (or just composites when the sizes match) ScaledTexture to the ViewRect of RenderTarget */
+	void AddUpsamplePass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FIntRect& ViewRect, FRDGTextureRef ScaledTexture, FRDGTextureRef RenderTarget, const FSceneTextureUniformParameters* SceneTextureContents, const ECompushadyRasterizerBlendMode BlendMode)
+	{
+		const FIntPoint ScaledSize = ScaledTexture->Desc.Extent;
 
-						FTextureRHIRef DepthStencil = SceneTextureUniform->SceneDepthTexture->GetRHI();
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
+		TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-							RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, DepthStencil, [&]()
-							{
-								if (VSResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
-								{
-									VSResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
-								}
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, VertexShaderRef, VSResourceArray, VSResourceBindings, false);
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, false);
-								Compushady::Utils::DrawVertices(RHICmdList, NumVertices, NumInstances, RasterizerConfig.RasterizerConfig);
-							}, RasterizerConfig.RasterizerConfig);
-					});
-			}
-		}
-		else if (ComputeShaderRef)
+		FCompushadyRasterizerConfig UpsampleRasterizerConfig;
+		UpsampleRasterizerConfig.BlendMode = BlendMode;
+
+		FRDGTextureRef DepthTexture = UpsampleFilter == ECompushadyBlendableUpsampleFilter::EdgeAware ? SceneTextureContents->SceneDepthTexture : nullptr;
+
+		FCompushadyRDGComputePassParameters* UpsamplePassParameters = GraphBuilder.AllocParameters<FCompushadyRDGComputePassParameters>();
+		UpsamplePassParameters->TextureAccesses.Emplace(ScaledTexture, ERHIAccess::SRVGraphics);
+		UpsamplePassParameters->TextureAccesses.Emplace(RenderTarget, ERHIAccess::RTV);
+
+		Compushady::Blendable::FCompushadyBlendableUpsampleConfig UpsampleConfig;
+		UpsampleConfig.ScaledSize = FVector4f(ScaledSize.X, ScaledSize.Y, 1.0f / ScaledSize.X, 1.0f / ScaledSize.Y);
+
+		if (DepthTexture)
 		{
-			const FSceneTextureUniformParameters* SceneTextureUniform = InOutInputs.SceneTextures.SceneTextures->GetContents();
+			UpsamplePassParameters->TextureAccesses.Emplace(DepthTexture, ERHIAccess::SRVGraphics);
 
-			GraphBuilder.AddPass(
-				RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-				ERDGPassFlags::None,
-				[this, SceneTextureUniform, &View, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
-				{
-					FTextureRHIRef RenderTarget = SceneTextureUniform->SceneColorTexture->GetRHI();
-					FCompushadySceneTextures SceneTextures = {};
-					FillSceneTextures(SceneTextures, RHICmdList, RenderTarget, SceneTextureUniform);
+			// the scene depth is always at render resolution (even after the upscaling)
+			const FIntRect DepthRect = View.bIsViewInfo ? UE::FXRenderingUtils::GetRawViewRectUnsafe(View) : ViewRect;
+			const FVector2f DepthExtent = FVector2f(DepthTexture->Desc.Extent);
+			UpsampleConfig.DepthUV = FVector4f(DepthRect.Min.X / DepthExtent.X, DepthRect.Min.Y / DepthExtent.Y, DepthRect.Width() / DepthExtent.X, DepthRect.Height() / DepthExtent.Y);
+		}
 
-					SetComputePipelineState(RHICmdList, ComputeShaderRef);
+		// every pass (and view) gets its own config
+		FUniformBufferRHIRef UpsampleUniformBufferRef = RHICreateUniformBuffer(&UpsampleConfig, UpsampleUniformBufferLayoutRef, EUniformBufferUsage::UniformBuffer_SingleDraw, EUniformBufferValidation::None);
 
-					if (ComputeResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("Compushady::Blendable::Upsample"),
+			UpsamplePassParameters,
+			ERDGPassFlags::Raster | ERDGPassFlags::SkipRenderPass,
+			[this, ViewRect, VertexShader, ScaledTexture, RenderTarget, DepthTexture, UpsampleUniformBufferRef, UpsampleRasterizerConfig](FRHICommandList& RHICmdList)
+			{
+				Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("Compushady::Blendable::Upsample"), RHICmdList, VertexShader.GetVertexShader(), UpsamplePixelShaderRef, nullptr, RenderTarget->GetRHI(), [&]()
 					{
-						ComputeResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
-					}
-					Compushady::Utils::SetupPipelineParameters(RHICmdList, ComputeShaderRef, ComputeResourceArray, ComputeResourceBindings, SceneTextures, false);
+						Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, UpsamplePixelShaderRef, UpsampleResourceBindings,
+							[&](const int32 Index)
+							{
+								return UpsampleUniformBufferRef;
+							},
+							[&](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+							{
+								if (DepthTexture && UpsampleResourceBindings.SRVs[Index].Name == TEXT("depth"))
+								{
+									return { nullptr, DepthTexture->GetRHI() };
+								}
+								return { nullptr, ScaledTexture->GetRHI() };
+							},
+							[](const int32 Index)
+							{
+								return nullptr;
+							},
+							[&](const int32 Index) -> FSamplerStateRHIRef
+							{
+								if (UpsampleResourceBindings.Samplers[Index].Name == TEXT("point_sampler"))
+								{
+									return TStaticSamplerState<SF_Point, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+								}
+								return TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+							}, true);
 
-					RHICmdList.DispatchComputeShader(XYZ.X, XYZ.Y, XYZ.Z);
-				});
+						UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
+							0, 0, 1, 1,
+							ViewRect.Size(),
+							FIntPoint(1, 1),
+							INDEX_NONE,
+							false, EDRF_UseTriangleOptimization);
+					}, UpsampleRasterizerConfig);
+			});
+	}
+
+	FScreenPassTexture PostProcessCallback_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessMaterialInputs& InOutInputs)
+	{
+#if COMPUSHADY_UE_VERSION >= 54
+		const FScreenPassTexture& SceneColorInput = FScreenPassTexture::CopyFromSlice(GraphBuilder, InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor));
+#else
+		FScreenPassTexture SceneColorInput = InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor);
+#endif
 
-			// ensure to return the original texture!
-			return SceneColorInput;
+		FScreenPassRenderTarget Output = InOutInputs.OverrideOutput;
+		if (!Output.IsValid())
+		{
+			Output = FScreenPassRenderTarget::CreateFromInput(GraphBuilder, SceneColorInput, View.GetOverwriteLoadAction(), TEXT("ICompushadyViewExtension::PostProcessCallback_RenderThread"));
 		}
 
+		// the output is declared as a render target of the pass, so it does not need to be converted to an external texture
+		AddRasterPass_RenderThread(GraphBuilder, View, TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"), false, { Output.Texture }, InOutInputs.SceneTextures.SceneTextures->GetContents(), SceneColorInput.Texture, false);
+
 		return Output;
 	}
 
@@ -268,6 +808,19 @@ protected:
 	FCompushadyBlendableRasterizerConfig RasterizerConfig;
 
 	TArray<uint8> CBVData;
+
+	float ResolutionScale = 1;
+	ECompushadyBlendableUpsampleFilter UpsampleFilter = ECompushadyBlendableUpsampleFilter::Bilinear;
+	FPixelShaderRHIRef UpsamplePixelShaderRef = nullptr;
+	FCompushadyResourceBindings UpsampleResourceBindings;
+	FUniformBufferLayoutRHIRef UpsampleUniformBufferLayoutRef;
+
+	Compushady::Blendable::TCompushadyBlendableHistory<TRefCountPtr<IPooledRenderTarget>> History;
+
+	bool bDirtyDriven = false;
+	TSharedPtr<FThreadSafeCounter, ESPMode::ThreadSafe> DirtyCounter;
+	uint32 CBVsSignature = 0;
+	Compushady::Blendable::TCompushadyBlendableOutputCache<TRefCountPtr<IPooledRenderTarget>> OutputCache;
 };
 
 class FCompushadyViewExtension : public ISceneViewExtension, public TSharedFromThis<FCompushadyViewExtension, ESPMode::ThreadSafe>, public ICompushadyViewExtension
@@ -296,15 +849,7 @@ public:
 	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
 	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override
 	{
-		// make a copy of the CBV for thread-safe management (we need to rely on copies)
-		if (VertexShaderRef && VSResourceArray.CBVs.Num() > 0)
-		{
-			CBVData = VSResourceArray.CBVs[0]->GetBufferData();
-		}
-		else if (ComputeShaderRef && ComputeResourceArray.CBVs.Num() > 0)
-		{
-			CBVData = ComputeResourceArray.CBVs[0]->GetBufferData();
-		}
+		CopyCBVData();
 	}
 
 	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
@@ -329,36 +874,9 @@ public:
 		}
 
 		TRDGUniformBufferRef<FSceneTextureUniformParameters> InputSceneTextures = *((TRDGUniformBufferRef<FSceneTextureUniformParameters>*) & Inputs);
+		const FSceneTextureUniformParameters* SceneTextureContents = InputSceneTextures->GetContents();
 
-		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
-		TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
-
-		const FIntRect ViewRect = GetViewRectAndFillCBVZero(View, true);
-
-		GraphBuilder.AddPass(
-			RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-			ERDGPassFlags::None,
-			[this, ViewRect, VertexShader, InputSceneTextures](FRHICommandList& RHICmdList)
-			{
-				FTextureRHIRef RenderTarget = InputSceneTextures->GetContents()->SceneColorTexture->GetRHI();
-
-				FCompushadySceneTextures SceneTextures = {};
-				FillSceneTextures(SceneTextures, RHICmdList, RenderTarget, InputSceneTextures->GetContents());
-
-				RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
-
-				Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-					RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, RenderTarget, [&]()
-					{
-						Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, true);
-						UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
-							0, 0, 1, 1,
-							ViewRect.Size(),
-							FIntPoint(1, 1),
-							INDEX_NONE,
-							false, EDRF_UseTriangleOptimization);
-					}, RasterizerConfig.RasterizerConfig);
-			});
+		AddRasterPass_RenderThread(GraphBuilder, View, TEXT("FCompushadyViewExtension::PrePostProcessPass_RenderThread"), true, { SceneTextureContents->SceneColorTexture }, SceneTextureContents, SceneTextureContents->SceneColorTexture, false);
 	}
 
 	virtual int32 GetPriority() const override { return CompushadyPriority; }
@@ -368,12 +886,17 @@ protected:
 	bool bPrePostProcess = false;
 };
 
+/*
+ * Consecutive compute blendables at the same location are dispatched in a single render graph pass:
+ * the first one of the group adds the pass (using the order of the view family extensions) and the others skip their callbacks.
+ */
 class FCompushadyPostProcess : public FSceneViewExtensionBase, public ICompushadyViewExtension, public ICompushadyTransientBlendable
 {
 public:
-	FCompushadyPostProcess(const FAutoRegister& AutoRegister, FVertexShaderRHIRef InVertexShaderRef, const FCompushadyResourceBindings& InVSResourceBindings, const FCompushadyResourceArray& InVSResourceArray, FPixelShaderRHIRef InPixelShaderRef, const FCompushadyResourceBindings& InPSResourceBindings, const FCompushadyResourceArray& InPSResourceArray, const ECompushadyPostProcessLocation PostProcessLocation, const int32 InNumVertices, const int32 InNumInstances, const FCompushadyBlendableRasterizerConfig& InRasterizerConfig) :
+	FCompushadyPostProcess(const FAutoRegister& AutoRegister, FVertexShaderRHIRef InVertexShaderRef, const FCompushadyResourceBindings& InVSResourceBindings, const FCompushadyResourceArray& InVSResourceArray, FPixelShaderRHIRef InPixelShaderRef, const FCompushadyResourceBindings& InPSResourceBindings, const FCompushadyResourceArray& InPSResourceArray, const ECompushadyPostProcessLocation InPostProcessLocation, const int32 InNumVertices, const int32 InNumInstances, const FCompushadyBlendableRasterizerConfig& InRasterizerConfig) :
 		FSceneViewExtensionBase(AutoRegister),
-		ICompushadyViewExtension(InVertexShaderRef, InVSResourceBindings, InVSResourceArray, InPixelShaderRef, InPSResourceBindings, InPSResourceArray, InNumVertices, InNumInstances, InRasterizerConfig)
+		ICompushadyViewExtension(InVertexShaderRef, InVSResourceBindings, InVSResourceArray, InPixelShaderRef, InPSResourceBindings, InPSResourceArray, InNumVertices, InNumInstances, InRasterizerConfig),
+		PostProcessLocation(InPostProcessLocation)
 	{
 		switch (PostProcessLocation)
 		{
@@ -391,10 +914,13 @@ public:
 			RequiredPass = EPostProcessingPass::Tonemap;
 			break;
 		}
+
+		FScopeLock Lock(&Compushady::Blendable::PostProcessesLock);
+		Compushady::Blendable::PostProcesses.Add(this);
 	}
 
-	FCompushadyPostProcess(const FAutoRegister& AutoRegister, FComputeShaderRHIRef InComputeShaderRef, const FCompushadyResourceBindings& InComputeResourceBindings, const FCompushadyResourceArray& InComputeResourceArray, const ECompushadyPostProcessLocation PostProcessLocation, const FIntVector& InXYZ, const FCompushadyBlendableRasterizerConfig& InRasterizerConfig) :
-		FCompushadyPostProcess(AutoRegister, nullptr, {}, {}, nullptr, {}, {}, PostProcessLocation, 0, 0, InRasterizerConfig)
+	FCompushadyPostProcess(const FAutoRegister& AutoRegister, FComputeShaderRHIRef InComputeShaderRef, const FCompushadyResourceBindings& InComputeResourceBindings, const FCompushadyResourceArray& InComputeResourceArray, const ECompushadyPostProcessLocation InPostProcessLocation, const FIntVector& InXYZ, const FCompushadyBlendableRasterizerConfig& InRasterizerConfig) :
+		FCompushadyPostProcess(AutoRegister, nullptr, {}, {}, nullptr, {}, {}, InPostProcessLocation, 0, 0, InRasterizerConfig)
 	{
 		ComputeShaderRef = InComputeShaderRef;
 		ComputeResourceBindings = InComputeResourceBindings;
@@ -402,308 +928,556 @@ public:
 		XYZ = InXYZ;
 	}
 
-	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
-	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override
+	virtual ~FCompushadyPostProcess()
+	{
+		FScopeLock Lock(&Compushady::Blendable::PostProcessesLock);
+		Compushady::Blendable::PostProcesses.Remove(this);
+	}
+
+	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override
+	{
+		CopyCBVData();
+	}
+
+	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
+
+#if COMPUSHADY_UE_VERSION >= 55
+	virtual void SubscribeToPostProcessingPass(EPostProcessingPass Pass, const FSceneView& InView, FPostProcessingPassDelegateArray& InOutPassCallbacks, bool bIsPassEnabled) override
+#else
+	virtual void SubscribeToPostProcessingPass(EPostProcessingPass Pass, FAfterPassCallbackDelegateArray& InOutPassCallbacks, bool bIsPassEnabled) override
+#endif
+	{
+		if (!bPrePostProcess && !bAfterBasePass && Pass == RequiredPass && bIsPassEnabled)
+		{
+			if (ComputeShaderRef)
+			{
+				InOutPassCallbacks.Add(FAfterPassCallbackDelegate::CreateSP(this, &FCompushadyPostProcess::ComputePostProcessCallback_RenderThread));
+			}
+			else
+			{
+				InOutPassCallbacks.Add(FAfterPassCallbackDelegate::CreateSP(this, &FCompushadyPostProcess::PostProcessCallback_RenderThread));
+			}
+		}
+	}
+
+	FScreenPassTexture ComputePostProcessCallback_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessMaterialInputs& InOutInputs)
+	{
+#if COMPUSHADY_UE_VERSION >= 54
+		const FScreenPassTexture& SceneColorInput = FScreenPassTexture::CopyFromSlice(GraphBuilder, InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor));
+#else
+		FScreenPassTexture SceneColorInput = InOutInputs.GetInput(EPostProcessMaterialInput::SceneColor);
+#endif
+
+		AddComputePass_RenderThread(GraphBuilder, View, TEXT("FCompushadyPostProcess::ComputePostProcessCallback_RenderThread"), false, InOutInputs.SceneTextures.SceneTextures->GetContents(), SceneColorInput.Texture);
+
+		// compute blendables do not write to SceneColor, so the input can be passed as is to the next pass
+		return SceneColorInput;
+	}
+
+	virtual void PostRenderBasePassDeferred_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& InView, const FRenderTargetBindingSlots& RenderTargets, TRDGUniformBufferRef<FSceneTextureUniformParameters> SceneTextures)
+	{
+		if (!bAfterBasePass)
+		{
+			return;
+		}
+
+		const FSceneTextureUniformParameters* SceneTextureContents = SceneTextures->GetContents();
+
+		if (PixelShaderRef)
+		{
+			TArray<FRDGTextureRef> RTVs;
+			for (int32 RTVIndex = 0; RTVIndex < MaxSimultaneousRenderTargets; RTVIndex++)
+			{
+				if (RenderTargets[RTVIndex].GetTexture() == nullptr)
+				{
+					break;
+				}
+				RTVs.Add(RenderTargets[RTVIndex].GetTexture());
+			}
+
+			AddRasterPass_RenderThread(GraphBuilder, InView, TEXT("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"), true, RTVs, SceneTextureContents, SceneTextureContents->SceneColorTexture, true);
+		}
+		else if (ComputeShaderRef)
+		{
+			AddComputePass_RenderThread(GraphBuilder, InView, TEXT("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"), true, SceneTextureContents, SceneTextureContents->SceneColorTexture);
+		}
+	}
+
+	virtual void PrePostProcessPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessingInputs& Inputs) override
+	{
+		if (!bPrePostProcess)
+		{
+			return;
+		}
+
+		TRDGUniformBufferRef<FSceneTextureUniformParameters> InputSceneTextures = *((TRDGUniformBufferRef<FSceneTextureUniformParameters>*) & Inputs);
+		const FSceneTextureUniformParameters* SceneTextureContents = InputSceneTextures->GetContents();
+
+		if (PixelShaderRef)
+		{
+			AddRasterPass_RenderThread(GraphBuilder, View, TEXT("FCompushadyPostProcess::PrePostProcessPass_RenderThread"), true, { SceneTextureContents->SceneColorTexture }, SceneTextureContents, SceneTextureContents->SceneColorTexture, false);
+		}
+		else if (ComputeShaderRef)
+		{
+			AddComputePass_RenderThread(GraphBuilder, View, TEXT("FCompushadyPostProcess::PrePostProcessPass_RenderThread"), true, SceneTextureContents, SceneTextureContents->SceneColorTexture);
+		}
+	}
+
+	virtual int32 GetPriority() const override { return CompushadyPriority; }
+
+	void Disable() override
+	{
+		bEnabled = false;
+	}
+
+	bool IsEnabled() const
+	{
+		return bEnabled;
+	}
+
+protected:
+	/* The blendables following this one in the view family, the first one (this) is always included */
+	TArray<FCompushadyPostProcess*> GetPassGroup(const FSceneView& View)
+	{
+		TArray<FCompushadyPostProcess*> Candidates = { this };
+		TArray<Compushady::Blendable::FCompushadyBlendablePassDesc> PassDescs;
+
+		const int32 ExtensionIndex = View.Family->ViewExtensions.IndexOfByPredicate([this](const FSceneViewExtensionRef& ViewExtension) { return &ViewExtension.Get() == this; });
+
+		for (int32 Index = ExtensionIndex; Index >= 0 && Index < View.Family->ViewExtensions.Num(); Index++)
+		{
+			FCompushadyPostProcess* PostProcess = nullptr;
+			{
+				const ISceneViewExtension* ViewExtension = &View.Family->ViewExtensions[Index].Get();
+				FScopeLock Lock(&Compushady::Blendable::PostProcessesLock);
+				if (Compushady::Blendable::PostProcesses.Contains(ViewExtension))
+				{
+					PostProcess = static_cast<FCompushadyPostProcess*>(const_cast<ISceneViewExtension*>(ViewExtension));
+				}
+			}
+
+			// any other extension could use the same location, so the group must stop there
+			if (!PostProcess || !PostProcess->IsEnabled())
+			{
+				break;
+			}
+
+			Compushady::Blendable::FCompushadyBlendablePassDesc PassDesc;
+			PassDesc.PostProcessLocation = PostProcess->PostProcessLocation;
+			PassDesc.bCompute = PostProcess->ComputeShaderRef.IsValid();
+			if (PassDesc.bCompute)
+			{
+				FString ErrorMessages;
+				if (!Compushady::RDG::CollectResourceAccesses(PostProcess->ComputeResourceArray, PassDesc.Accesses, ErrorMessages, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute, true))
+				{
+					break;
+				}
+			}
+
+			if (PostProcess != this)
+			{
+				Candidates.Add(PostProcess);
+			}
+			PassDescs.Add(MoveTemp(PassDesc));
+		}
+
+		TArray<TArray<int32>> Groups;
+		Compushady::Blendable::BuildPassGroups(PassDescs, Groups);
+
+		TArray<FCompushadyPostProcess*> PassGroup = { this };
+		if (Groups.Num() > 0)
+		{
+			for (int32 Index = 1; Index < Groups[0].Num(); Index++)
+			{
+				PassGroup.Add(Candidates[Groups[0][Index]]);
+			}
+		}
+		return PassGroup;
+	}
+
+	void AddComputePass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const TCHAR* PassName, const bool bBeforeUpscaling, const FSceneTextureUniformParameters* SceneTextureContents, FRDGTextureRef SceneColorInput)
 	{
-		// make a copy of the CBV for thread-safe management (we need to rely on copies)
-		if (VertexShaderRef && VSResourceArray.CBVs.Num() > 0)
+		// already dispatched by a previous blendable
+		if (MergedView == &View && MergedFrameNumber == View.Family->FrameNumber)
 		{
-			CBVData = VSResourceArray.CBVs[0]->GetBufferData();
+			return;
 		}
-		else if (ComputeShaderRef && ComputeResourceArray.CBVs.Num() > 0)
+
+		const TArray<FCompushadyPostProcess*> PassGroup = GetPassGroup(View);
+
+		for (FCompushadyPostProcess* PostProcess : PassGroup)
 		{
-			CBVData = ComputeResourceArray.CBVs[0]->GetBufferData();
+			if (PostProcess != this)
+			{
+				PostProcess->MergedView = &View;
+				PostProcess->MergedFrameNumber = View.Family->FrameNumber;
+			}
 		}
-	}
-
-	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
 
-#if COMPUSHADY_UE_VERSION >= 55
-	virtual void SubscribeToPostProcessingPass(EPostProcessingPass Pass, const FSceneView& InView, FPostProcessingPassDelegateArray& InOutPassCallbacks, bool bIsPassEnabled) override
-#else
-	virtual void SubscribeToPostProcessingPass(EPostProcessingPass Pass, FAfterPassCallbackDelegateArray& InOutPassCallbacks, bool bIsPassEnabled) override
-#endif
-	{
-		if (!bPrePostProcess && !bAfterBasePass && Pass == RequiredPass && bIsPassEnabled)
+		// dirty driven blendables with unchanged inputs keep the contents of their UAVs
+		TArray<FCompushadyPostProcess*> ExecutedPassGroup;
+		TArray<FIntRect> ExecutedViewRects;
+		for (FCompushadyPostProcess* PostProcess : PassGroup)
 		{
-			InOutPassCallbacks.Add(FAfterPassCallbackDelegate::CreateSP(this, &FCompushadyPostProcess::PostProcessCallback_RenderThread));
+			const FIntRect ViewRect = PostProcess->GetViewRectAndFillCBVZero(View, bBeforeUpscaling);
+			if (PostProcess->bDirtyDriven)
+			{
+				PostProcess->OutputCache.RemoveStaleViews(View.Family->FrameNumber, Compushady::Blendable::HistoryMaxAge);
+				if (!PostProcess->OutputCache.BeginFrame(View.GetViewKey(), FIntPoint::ZeroValue, PF_Unknown, PostProcess->GetInputsSignature(View, ViewRect, PostProcess->ComputeResourceArray), View.Family->FrameNumber))
+				{
+					continue;
+				}
+			}
+			ExecutedPassGroup.Add(PostProcess);
+			ExecutedViewRects.Add(ViewRect);
 		}
-	}
 
-	virtual void PostRenderBasePassDeferred_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& InView, const FRenderTargetBindingSlots& RenderTargets, TRDGUniformBufferRef<FSceneTextureUniformParameters> SceneTextures)
-	{
-		if (!bAfterBasePass)
+		if (ExecutedPassGroup.Num() == 0)
 		{
 			return;
 		}
 
-		const FIntRect ViewRect = GetViewRectAndFillCBVZero(InView, true);
+		TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+		uint32 SceneTexturesMask = 0;
+		TArray<TArray<uint8>> PassGroupCBVData;
+		TArray<TArray<FRHITransitionInfo>> PassGroupUAVBarriers;
+		TArray<TArray<FRDGTextureRef>> PassGroupHistoryTextures;
+		TArray<TPair<FRDGTextureRef, FIntRect>> PassGroupHistoryOutputs;
+		TSet<FRHIResource*> WrittenResources;
 
-		if (PixelShaderRef)
+		for (FCompushadyPostProcess* PostProcess : ExecutedPassGroup)
 		{
-			if (!VertexShaderRef)
+			FString ErrorMessages;
+			if (!Compushady::RDG::CollectResourceAccesses(PostProcess->ComputeResourceArray, Accesses, ErrorMessages, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute, true))
 			{
-				FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(InView.GetFeatureLevel());
-				TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
-
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, VertexShader, SceneTextures, RenderTargets](FRHICommandList& RHICmdList)
-					{
-						FCompushadySceneTextures CompushadySceneTextures = {};
-						FillSceneTextures(CompushadySceneTextures, RHICmdList, SceneTextures->GetContents()->SceneColorTexture->GetRHI(), SceneTextures->GetContents());
+				UE_LOG(LogCompushady, Error, TEXT("Unable to add Compushady Blendable pass: %s"), *ErrorMessages);
+				return;
+			}
 
-						TArray<FTextureRHIRef> RTVs;
-						for (int32 RTVIndex = 0; RTVIndex < MaxSimultaneousRenderTargets; RTVIndex++)
-						{
-							if (RenderTargets[RTVIndex].GetTexture() != nullptr)
-							{
-								RTVs.Add(RenderTargets[RTVIndex].GetTexture()->GetRHI());
-								switch (RTVIndex)
-								{
-								case 0:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::SceneColor, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 1:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferA, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 2:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferB, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 3:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferC, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 4:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferD, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 5:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferE, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								}
-							}
-						}
+			SceneTexturesMask |= Compushady::Blendable::GetSceneTexturesMask(PostProcess->ComputeResourceArray);
 
-						if (RTVs.Num() == 0)
-						{
-							return;
-						}
+			PassGroupCBVData.Add(PostProcess->CBVData);
 
-						RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
+			// the history of compute blendables is their first texture UAV
+			FRDGTextureRef HistoryOutput = nullptr;
+			if (PostProcess->History.GetNumBuffers() > 0)
+			{
+				for (UCompushadyUAV* UAV : PostProcess->ComputeResourceArray.UAVs)
+				{
+					if (UAV->IsValidTexture())
+					{
+						HistoryOutput = Compushady::RDG::RegisterExternalTexture(GraphBuilder, UAV->GetTextureRHI());
+						break;
+					}
+				}
+			}
+			const FIntRect HistoryOutputRect = HistoryOutput ? FIntRect(FIntPoint::ZeroValue, HistoryOutput->Desc.Extent) : FIntRect();
+			PassGroupHistoryTextures.Add(PostProcess->RegisterHistory_RenderThread(GraphBuilder, View, HistoryOutput, HistoryOutputRect));
+			PassGroupHistoryOutputs.Emplace(HistoryOutput, HistoryOutputRect);
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"),
-							RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, RTVs, nullptr, [&]()
-							{
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, CompushadySceneTextures, true);
-								UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
-									0, 0, 1, 1,
-									ViewRect.Size(),
-									FIntPoint(1, 1),
-									INDEX_NONE,
-									false, EDRF_UseTriangleOptimization);
-							}, RasterizerConfig.RasterizerConfig);
-					});
+			// blendables of the same pass writing to the same UAV still need to wait for each other
+			TArray<FRHITransitionInfo>& UAVBarriers = PassGroupUAVBarriers.AddDefaulted_GetRef();
+			for (UCompushadyUAV* UAV : PostProcess->ComputeResourceArray.UAVs)
+			{
+				FRHIResource* Resource = UAV->IsValidTexture() ? static_cast<FRHIResource*>(UAV->GetTextureRHI().GetReference()) : static_cast<FRHIResource*>(UAV->GetBufferRHI().GetReference());
+				if (WrittenResources.Contains(Resource))
+				{
+					UAVBarriers.Add(FRHITransitionInfo(UAV->GetRHI(), ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+				}
+				WrittenResources.Add(Resource);
 			}
-			else
+		}
+
+		FCompushadyRDGComputePassParameters* PassParameters = Compushady::RDG::CreatePassParameters(GraphBuilder, Accesses);
+		for (int32 Index = 0; Index < ExecutedPassGroup.Num(); Index++)
+		{
+			Compushady::Blendable::AddSceneTextureAccesses(PassParameters, Compushady::Blendable::GetSceneTexturesMask(ExecutedPassGroup[Index]->ComputeResourceArray), ERHIAccess::SRVCompute, SceneTextureContents, SceneColorInput, PassGroupHistoryTextures[Index]);
+		}
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("%s (%d blendables)", PassName, ExecutedPassGroup.Num()),
+			PassParameters,
+			ERDGPassFlags::Compute | ERDGPassFlags::NeverCull,
+			[this, PassGroup = ExecutedPassGroup, PassGroupCBVData, PassGroupUAVBarriers, PassGroupHistoryTextures, SceneTextureContents, SceneColorInput, SceneTexturesMask](FRHICommandList& RHICmdList)
 			{
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, SceneTextures, RenderTargets, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
+				FCompushadySceneTextures SceneTextures = {};
+				FillSceneTextures(SceneTextures, RHICmdList, SceneColorInput, SceneTextureContents, SceneTexturesMask);
+
+				for (int32 Index = 0; Index < PassGroup.Num(); Index++)
+				{
+					FCompushadyPostProcess* PostProcess = PassGroup[Index];
+
+					for (const FRHITransitionInfo& UAVBarrier : PassGroupUAVBarriers[Index])
 					{
-						FTextureRHIRef DepthStencil = SceneTextures->GetContents()->SceneDepthTexture->GetRHI();
+						RHICmdList.Transition(UAVBarrier);
+					}
 
-						FCompushadySceneTextures CompushadySceneTextures = {};
-						FillSceneTextures(CompushadySceneTextures, RHICmdList, SceneTextures->GetContents()->SceneColorTexture->GetRHI(), SceneTextures->GetContents());
+					FillHistoryTextures(SceneTextures, PassGroupHistoryTextures[Index], Compushady::Blendable::GetSceneTexturesMask(PostProcess->ComputeResourceArray));
 
-						TArray<FTextureRHIRef> RTVs;
-						for (int32 RTVIndex = 0; RTVIndex < MaxSimultaneousRenderTargets; RTVIndex++)
-						{
-							if (RenderTargets[RTVIndex].GetTexture() != nullptr)
-							{
-								RTVs.Add(RenderTargets[RTVIndex].GetTexture()->GetRHI());
-								switch (RTVIndex)
-								{
-								case 0:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::SceneColor, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 1:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferA, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 2:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferB, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 3:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferC, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 4:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferD, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								case 5:
-									CompushadySceneTextures.SetTexture(ECompushadySceneTexture::GBufferE, RenderTargets[RTVIndex].GetTexture()->GetRHI());
-									break;
-								}
-							}
-						}
+					SetComputePipelineState(RHICmdList, PostProcess->ComputeShaderRef);
 
-						if (RTVs.Num() == 0)
-						{
-							return;
-						}
+					if (PostProcess->ComputeResourceArray.CBVs.IsValidIndex(0) && PassGroupCBVData[Index].Num() > 0)
+					{
+						PostProcess->ComputeResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, PassGroupCBVData[Index]);
+					}
+					Compushady::Blendable::SetupParameters(RHICmdList, PostProcess->ComputeShaderRef, PostProcess->ComputeResourceArray, PostProcess->ComputeResourceBindings, SceneTextures, false);
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"),
-							RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RTVs, DepthStencil, [&]()
-							{
-								if (VSResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
-								{
-									VSResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
-								}
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, VertexShaderRef, VSResourceArray, VSResourceBindings, false);
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, CompushadySceneTextures, false);
-								Compushady::Utils::DrawVertices(RHICmdList, NumVertices, NumInstances, RasterizerConfig.RasterizerConfig);
-							}, RasterizerConfig.RasterizerConfig);
-					});
+					RHICmdList.DispatchComputeShader(PostProcess->XYZ.X, PostProcess->XYZ.Y, PostProcess->XYZ.Z);
+				}
+			});
+
+		for (int32 Index = 0; Index < ExecutedPassGroup.Num(); Index++)
+		{
+			FCompushadyPostProcess* PostProcess = ExecutedPassGroup[Index];
+			PostProcess->UpdateHistory_RenderThread(GraphBuilder, View, PassGroupHistoryOutputs[Index].Key, PassGroupHistoryOutputs[Index].Value);
+			PostProcess->IncrementUAVVersions(PostProcess->ComputeResourceArray);
+			if (PostProcess->bDirtyDriven)
+			{
+				// the signature is taken after the increments, so the writes of the blendable do not make it dirty again
+				PostProcess->OutputCache.EndFrame(View.GetViewKey(), PostProcess->GetInputsSignature(View, ExecutedViewRects[Index], PostProcess->ComputeResourceArray));
 			}
 		}
-		else if (ComputeShaderRef)
-		{
-			GraphBuilder.AddPass(
-				RDG_EVENT_NAME("FCompushadyPostProcess::PostRenderBasePassDeferred_RenderThread"),
-				ERDGPassFlags::None,
-				[this, SceneTextures, &InView, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
-				{
-					FTextureRHIRef RenderTarget = SceneTextures->GetContents()->SceneColorTexture->GetRHI();
-					FCompushadySceneTextures CompushadySceneTextures = {};
-					FillSceneTextures(CompushadySceneTextures, RHICmdList, RenderTarget, SceneTextures->GetContents());
+	}
+
+	ECompushadyPostProcessLocation PostProcessLocation;
+	EPostProcessingPass RequiredPass = EPostProcessingPass::Tonemap;
+	bool bPrePostProcess = false;
+	bool bAfterBasePass = false;
+
+	bool bEnabled = true;
+
+	// set by the first blendable of a merged pass
+	const FSceneView* MergedView = nullptr;
+	uint32 MergedFrameNumber = 0;
+};
+#endif
 
-					SetComputePipelineState(RHICmdList, ComputeShaderRef);
+namespace Compushady
+{
+	namespace Blendable
+	{
+		/*
+		 * "main" is a plain bilinear upsample, "main_edge_aware" reweights the 4 nearest scaled texels by their depth similarity
+		 * with the full resolution pixel, avoiding halos around the silhouettes.
+		 */
+		static const TCHAR* UpsamplePixelShaderCode =
+			TEXT("Texture2D<float4> scaled;")
+			TEXT("Texture2D<float> depth;")
+			TEXT("SamplerState bilinear_sampler;")
+			TEXT("SamplerState point_sampler;")
+			TEXT("cbuffer Config")
+			TEXT("{")
+			TEXT("float4 scaled_size;")
+			TEXT("float4 depth_uv;")
+			TEXT("};")
+			TEXT("float4 main(noperspective float4 uv_and_screen_pos : TEXCOORD0) : SV_Target0")
+			TEXT("{")
+			TEXT("return scaled.SampleLevel(bilinear_sampler, uv_and_screen_pos.xy, 0);")
+			TEXT("}")
+			TEXT("float4 main_edge_aware(noperspective float4 uv_and_screen_pos : TEXCOORD0) : SV_Target0")
+			TEXT("{")
+			TEXT("float2 uv = uv_and_screen_pos.xy;")
+			TEXT("float2 texel = uv * scaled_size.xy - 0.5;")
+			TEXT("float2 base = floor(texel);")
+			TEXT("float2 f = texel - base;")
+			TEXT("float full_depth = depth.SampleLevel(point_sampler, depth_uv.xy + uv * depth_uv.zw, 0);")
+			TEXT("float4 color = float4(0, 0, 0, 0);")
+			TEXT("float total = 0;")
+			TEXT("for (uint i = 0; i < 4; i++)")
+			TEXT("{")
+			TEXT("float2 offset = float2(i & 1, i >> 1);")
+			TEXT("float2 tap_uv = (base + offset + 0.5) * scaled_size.zw;")
+			TEXT("float2 bilinear = lerp(1 - f, f, offset);")
+			TEXT("float tap_depth = depth.SampleLevel(point_sampler, depth_uv.xy + tap_uv * depth_uv.zw, 0);")
+			TEXT("float weight = bilinear.x * bilinear.y * exp(-32 * abs(tap_depth - full_depth) / max(full_depth, 1e-6)) + 1e-5;")
+			TEXT("color += scaled.SampleLevel(point_sampler, tap_uv, 0) * weight;")
+			TEXT("total += weight;")
+			TEXT("}")
+			TEXT("return color / total;")
+			TEXT("}");
+	}
+}
 
-					if (ComputeResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
+namespace Compushady
+{
+	namespace Blendable
+	{
+		/* SRV bindings named History0..History3 missing in the map are bound to the history scene textures */
+		static TMap<FString, TScriptInterface<ICompushadyBindable>> AddHistorySRVs(const TMap<FString, TScriptInterface<ICompushadyBindable>>& ResourceMap, const FCompushadyResourceBindings& ResourceBindings)
+		{
+			TMap<FString, TScriptInterface<ICompushadyBindable>> NewResourceMap = ResourceMap;
+			for (const FCompushadyResourceBinding& Binding : ResourceBindings.SRVs)
+			{
+				for (int32 HistoryIndex = 0; HistoryIndex < MaxHistoryBuffers; HistoryIndex++)
+				{
+					if (Binding.Name == FString::Printf(TEXT("History%d"), HistoryIndex) && !NewResourceMap.Contains(Binding.Name))
 					{
-						ComputeResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
+						UCompushadySRV* SRV = NewObject<UCompushadySRV>();
+						SRV->InitializeFromSceneTexture(static_cast<ECompushadySceneTexture>(static_cast<int32>(ECompushadySceneTexture::History0) + HistoryIndex));
+						NewResourceMap.Add(Binding.Name, SRV);
 					}
-					Compushady::Utils::SetupPipelineParameters(RHICmdList, ComputeShaderRef, ComputeResourceArray, ComputeResourceBindings, CompushadySceneTextures, false);
-
-					RHICmdList.DispatchComputeShader(XYZ.X, XYZ.Y, XYZ.Z);
-				});
+				}
+			}
+			return NewResourceMap;
 		}
 	}
+}
 
-	virtual void PrePostProcessPass_RenderThread(FRDGBuilder& GraphBuilder, const FSceneView& View, const FPostProcessingInputs& Inputs) override
+uint32 Compushady::Blendable::GetResourcesSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed)
+{
+	return GetResourceVersionsSignature(ResourceArray, GetCBVsSignature(ResourceArray, Seed));
+}
+
+uint32 Compushady::Blendable::GetCBVsSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed)
+{
+	uint32 Signature = Seed;
+
+	for (const UCompushadyCBV* CBV : ResourceArray.CBVs)
 	{
-		if (!bPrePostProcess)
+		Signature = HashCombine(Signature, GetTypeHash(CBV));
+		if (CBV)
 		{
-			return;
+			Signature = FCrc::MemCrc32(CBV->GetBufferData().GetData(), CBV->GetBufferData().Num(), Signature);
 		}
+	}
 
-		TRDGUniformBufferRef<FSceneTextureUniformParameters> InputSceneTextures = *((TRDGUniformBufferRef<FSceneTextureUniformParameters>*) & Inputs);
+	return Signature;
+}
 
-		const FIntRect ViewRect = GetViewRectAndFillCBVZero(View, true);
+uint32 Compushady::Blendable::GetResourceVersionsSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed)
+{
+	uint32 Signature = Seed;
 
-		if (PixelShaderRef)
+	auto AddResource = [&Signature](const UCompushadyResource* Resource)
 		{
-			if (!VertexShaderRef)
+			Signature = HashCombine(Signature, GetTypeHash(Resource));
+			if (Resource)
 			{
-				FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(View.GetFeatureLevel());
-				TShaderMapRef<FScreenPassVS> VertexShader(ShaderMap);
+				Signature = HashCombine(Signature, GetTypeHash(Resource->GetVersion()));
+			}
+		};
 
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, VertexShader, InputSceneTextures](FRHICommandList& RHICmdList)
-					{
-						FRHITexture* RenderTarget = InputSceneTextures->GetContents()->SceneColorTexture->GetRHI();
+	for (const UCompushadySRV* SRV : ResourceArray.SRVs)
+	{
+		AddResource(SRV);
+	}
 
-						FCompushadySceneTextures SceneTextures = {};
-						FillSceneTextures(SceneTextures, RHICmdList, InputSceneTextures->GetContents()->SceneColorTexture->GetRHI(), InputSceneTextures->GetContents());
+	for (const UCompushadyUAV* UAV : ResourceArray.UAVs)
+	{
+		AddResource(UAV);
+	}
 
-						RasterizerConfig.RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::Always;
+	return Signature;
+}
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-							RHICmdList, VertexShader.GetVertexShader(), PixelShaderRef, nullptr, RenderTarget, [&]()
-							{
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, true);
-								UE::Renderer::PostProcess::DrawPostProcessPass(RHICmdList, VertexShader, ViewRect.Min.X, ViewRect.Min.Y, ViewRect.Width(), ViewRect.Height(),
-									0, 0, 1, 1,
-									ViewRect.Size(),
-									FIntPoint(1, 1),
-									INDEX_NONE,
-									false, EDRF_UseTriangleOptimization);
-							}, RasterizerConfig.RasterizerConfig);
-					});
-			}
-			else
+FIntPoint Compushady::Blendable::GetScaledSize(const FIntPoint& Size, const float ResolutionScale)
+{
+	return FIntPoint(FMath::Max(FMath::CeilToInt32(Size.X * ResolutionScale), 1), FMath::Max(FMath::CeilToInt32(Size.Y * ResolutionScale), 1));
+}
+
+void Compushady::Blendable::FillMatrices(TArray<uint8>& CBVData, const FCompushadyBlendableMatricesConfig& MatricesConfig, const FCompushadyBlendableViewData& ViewData, const float ResolutionScale)
+{
+	auto SetMatrixByOffset = [&](const int32 Offset, const FMatrix& Matrix)
+		{
+			if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 16)) <= CBVData.Num())
 			{
-				GraphBuilder.AddPass(
-					RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-					ERDGPassFlags::None,
-					[this, ViewRect, InputSceneTextures, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
-					{
-						FTextureRHIRef RenderTarget = InputSceneTextures->GetContents()->SceneColorTexture->GetRHI();
-						FTextureRHIRef DepthStencil = InputSceneTextures->GetContents()->SceneDepthTexture->GetRHI();
+				FMemory::Memcpy(CBVData.GetData() + Offset, FMatrix44f(Matrix).M, sizeof(float) * 16);
+			}
+		};
 
-						FCompushadySceneTextures SceneTextures = {};
-						FillSceneTextures(SceneTextures, RHICmdList, RenderTarget, InputSceneTextures->GetContents());
+	auto SetVector2ByOffset = [&](const int32 Offset, const FVector2D Vector)
+		{
+			if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 2)) <= CBVData.Num())
+			{
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Vector.X;
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float))) = Vector.Y;
+			}
+		};
 
-						Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyPostProcess::PostProcessCallback_RenderThread"),
-							RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, DepthStencil, [&]()
-							{
-								if (VSResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
-								{
-									VSResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
-								}
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, VertexShaderRef, VSResourceArray, VSResourceBindings, false);
-								Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, SceneTextures, false);
-								Compushady::Utils::DrawVertices(RHICmdList, NumVertices, NumInstances, RasterizerConfig.RasterizerConfig);
-							}, RasterizerConfig.RasterizerConfig);
-					});
+	auto SetVector4ByOffset = [&](const int32 Offset, const FVector4 Vector)
+		{
+			if (Offset >= 0 && static_cast<int64>(Offset + (sizeof(float) * 4)) <= CBVData.Num())
+			{
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Vector.X;
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float))) = Vector.Y;
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float) * 2)) = Vector.Z;
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset + sizeof(float) * 3)) = Vector.W;
 			}
-		}
-		else if (ComputeShaderRef)
+		};
+
+	auto SetFloatByOffset = [&](const int32 Offset, const float Value)
 		{
-			GraphBuilder.AddPass(
-				RDG_EVENT_NAME("FCompushadyPostProcess::PrePostProcessPass_RenderThread"),
-				ERDGPassFlags::None,
-				[this, InputSceneTextures, &View, CopyBufferData = CBVData](FRHICommandList& RHICmdList)
-				{
-					FTextureRHIRef RenderTarget = InputSceneTextures->GetContents()->SceneColorTexture->GetRHI();
-					FCompushadySceneTextures SceneTextures = {};
-					FillSceneTextures(SceneTextures, RHICmdList, RenderTarget, InputSceneTextures->GetContents());
+			if (Offset >= 0 && static_cast<int64>(Offset + sizeof(float)) <= CBVData.Num())
+			{
+				*(reinterpret_cast<float*>(CBVData.GetData() + Offset)) = Value;
+			}
+		};
 
-					SetComputePipelineState(RHICmdList, ComputeShaderRef);
+	SetMatrixByOffset(MatricesConfig.ViewMatrixOffset, ViewData.ViewMatrix);
+	SetMatrixByOffset(MatricesConfig.ProjectionMatrixOffset, ViewData.ProjectionMatrix);
+	SetMatrixByOffset(MatricesConfig.InverseViewMatrixOffset, ViewData.InverseViewMatrix);
+	SetMatrixByOffset(MatricesConfig.InverseProjectionMatrixOffset, ViewData.InverseProjectionMatrix);
+	SetVector2ByOffset(MatricesConfig.ScreenSizeFloat2Offset, GetScaledSize(ViewData.ScreenSize, ResolutionScale));
 
-					if (ComputeResourceArray.CBVs.IsValidIndex(0) && CopyBufferData.Num() > 0)
-					{
-						ComputeResourceArray.CBVs[0]->SyncBufferDataWithData(RHICmdList, CopyBufferData);
-					}
-					Compushady::Utils::SetupPipelineParameters(RHICmdList, ComputeShaderRef, ComputeResourceArray, ComputeResourceBindings, SceneTextures, false);
+	SetMatrixByOffset(MatricesConfig.ViewProjectionMatrixOffset, ViewData.ViewProjectionMatrix);
+	SetMatrixByOffset(MatricesConfig.InverseViewProjectionMatrixOffset, ViewData.InverseViewProjectionMatrix);
 
-					RHICmdList.DispatchComputeShader(XYZ.X, XYZ.Y, XYZ.Z);
-				});
-		}
+	SetVector4ByOffset(MatricesConfig.ViewOriginFloat4Offset, ViewData.ViewOrigin);
 
-	}
+	SetFloatByOffset(MatricesConfig.DeltaTimeFloatOffset, ViewData.DeltaTime);
+	SetFloatByOffset(MatricesConfig.TimeFloatOffset, ViewData.Time);
 
-	virtual int32 GetPriority() const override { return CompushadyPriority; }
+	SetMatrixByOffset(MatricesConfig.PreviousViewMatrixOffset, ViewData.PreviousViewMatrix);
+	SetMatrixByOffset(MatricesConfig.PreviousProjectionMatrixOffset, ViewData.PreviousProjectionMatrix);
+	SetMatrixByOffset(MatricesConfig.PreviousViewProjectionMatrixOffset, ViewData.PreviousViewProjectionMatrix);
+}
 
-	void Disable() override
-	{
-		bEnabled = false;
-	}
+void Compushady::Blendable::BuildPassGroups(const TArray<FCompushadyBlendablePassDesc>& Blendables, TArray<TArray<int32>>& Groups)
+{
+	Groups.Empty();
 
-	bool IsEnabled() const
+	TArray<Compushady::RDG::FCompushadyRDGResourceAccess> GroupAccesses;
+
+	auto HasHazard = [&GroupAccesses](const FCompushadyBlendablePassDesc& Blendable)
+		{
+			for (const Compushady::RDG::FCompushadyRDGResourceAccess& Access : Blendable.Accesses)
+			{
+				for (const Compushady::RDG::FCompushadyRDGResourceAccess& GroupAccess : GroupAccesses)
+				{
+					const bool bSameResource = (Access.TextureRHIRef && Access.TextureRHIRef == GroupAccess.TextureRHIRef) || (Access.BufferRHIRef && Access.BufferRHIRef == GroupAccess.BufferRHIRef);
+					// a resource has a single state in a pass, so only reads after reads and writes after writes (with an UAV barrier) are allowed
+					if (bSameResource && EnumHasAnyFlags(Access.Access, ERHIAccess::UAVMask) != EnumHasAnyFlags(GroupAccess.Access, ERHIAccess::UAVMask))
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		};
+
+	for (int32 Index = 0; Index < Blendables.Num(); Index++)
 	{
-		return bEnabled;
-	}
+		const FCompushadyBlendablePassDesc& Blendable = Blendables[Index];
 
-protected:
-	EPostProcessingPass RequiredPass = EPostProcessingPass::Tonemap;
-	bool bPrePostProcess = false;
-	bool bAfterBasePass = false;;
+		bool bMerge = false;
+		if (Groups.Num() > 0 && Blendable.bCompute)
+		{
+			const FCompushadyBlendablePassDesc& Previous = Blendables[Groups.Last().Last()];
+			bMerge = Previous.bCompute && Previous.PostProcessLocation == Blendable.PostProcessLocation && !HasHazard(Blendable);
+		}
+
+		if (!bMerge)
+		{
+			Groups.AddDefaulted();
+			GroupAccesses.Reset();
+		}
+
+		Groups.Last().Add(Index);
+		GroupAccesses.Append(Blendable.Accesses);
+	}
+}
 
-	bool bEnabled = true;
-};
-#endif
 
 bool UCompushadyBlendable::InitFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const ECompushadyPostProcessLocation InPostProcessLocation, FString& ErrorMessages)
 {
@@ -743,7 +1517,9 @@ void UCompushadyBlendable::OverrideBlendableSettings(class FSceneView& View, flo
 {
 #if COMPUSHADY_UE_VERSION >= 53
 	TArray<FSceneViewExtensionRef>& ViewExtensions = ((FSceneViewFamily*)View.Family)->ViewExtensions;
-	ViewExtensions.Add(MakeShared<FCompushadyViewExtension>(PixelShaderRef, PSResourceBindings, PSResourceArray, PostProcessLocation));
+	TSharedRef<FCompushadyViewExtension, ESPMode::ThreadSafe> ViewExtension = MakeShared<FCompushadyViewExtension>(PixelShaderRef, PSResourceBindings, PSResourceArray, PostProcessLocation);
+	ViewExtension->SetResolutionScale(ResolutionScale, UpsampleFilter, UpsamplePixelShaderRef, UpsampleResourceBindings, UpsampleUniformBufferLayoutRef);
+	ViewExtensions.Add(ViewExtension);
 #endif
 }
 
@@ -754,6 +1530,12 @@ bool UCompushadyBlendable::UpdateResources(const FCompushadyResourceArray& InPSR
 		return false;
 	}
 
+	if (bDirtyDriven && Compushady::Blendable::HasFrameSceneTextures(InPSResourceArray))
+	{
+		ErrorMessages = "Dirty driven blendables cannot bind scene textures";
+		return false;
+	}
+
 	UntrackResources();
 	PSResourceArray = InPSResourceArray;
 	TrackResources(PSResourceArray);
@@ -784,6 +1566,12 @@ bool UCompushadyBlendable::UpdateResourcesAdvanced(const FCompushadyResourceArra
 
 	RasterizerConfig = InBlendableRasterizerConfig;
 
+	if (bDirtyDriven && Compushady::Blendable::HasFrameSceneTextures(InPSResourceArray))
+	{
+		ErrorMessages = "Dirty driven blendables cannot bind scene textures";
+		return false;
+	}
+
 	UntrackResources();
 	VSResourceArray = InVSResourceArray;
 	PSResourceArray = InPSResourceArray;
@@ -806,6 +1594,12 @@ bool UCompushadyBlendable::UpdateComputeResourcesAdvanced(const FCompushadyResou
 		return false;
 	}
 
+	if (bDirtyDriven && Compushady::Blendable::HasFrameSceneTextures(InResourceArray))
+	{
+		ErrorMessages = "Dirty driven blendables cannot bind scene textures";
+		return false;
+	}
+
 	XYZ = InXYZ;
 
 	RasterizerConfig.MatricesConfig = BlendableMatricesConfig;
@@ -820,7 +1614,7 @@ bool UCompushadyBlendable::UpdateComputeResourcesAdvanced(const FCompushadyResou
 bool UCompushadyBlendable::UpdateResourcesByMap(const TMap<FString, TScriptInterface<ICompushadyBindable>>& PSResourceMap, FString& ErrorMessages)
 {
 	FCompushadyResourceArray InPSResourceArray;
-	if (!Compushady::Utils::ValidateResourceBindingsMap(PSResourceMap, PSResourceBindings, InPSResourceArray, ErrorMessages))
+	if (!Compushady::Utils::ValidateResourceBindingsMap(Compushady::Blendable::AddHistorySRVs(PSResourceMap, PSResourceBindings), PSResourceBindings, InPSResourceArray, ErrorMessages))
 	{
 		return false;
 	}
@@ -837,7 +1631,7 @@ bool UCompushadyBlendable::UpdateResourcesByMapAdvanced(const TMap<FString, TScr
 
 	}
 	FCompushadyResourceArray InPSResourceArray;
-	if (!Compushady::Utils::ValidateResourceBindingsMap(InPSResourceMap, PSResourceBindings, InPSResourceArray, ErrorMessages))
+	if (!Compushady::Utils::ValidateResourceBindingsMap(Compushady::Blendable::AddHistorySRVs(InPSResourceMap, PSResourceBindings), PSResourceBindings, InPSResourceArray, ErrorMessages))
 	{
 		return false;
 	}
@@ -848,7 +1642,7 @@ bool UCompushadyBlendable::UpdateResourcesByMapAdvanced(const TMap<FString, TScr
 bool UCompushadyBlendable::UpdateComputeResourcesByMapAdvanced(const TMap<FString, TScriptInterface<ICompushadyBindable>>& InResourceMap, const FIntVector& InXYZ, const FCompushadyBlendableMatricesConfig& BlendableMatricesConfig, FString& ErrorMessages)
 {
 	FCompushadyResourceArray InResourceArray;
-	if (!Compushady::Utils::ValidateResourceBindingsMap(InResourceMap, ComputeResourceBindings, InResourceArray, ErrorMessages))
+	if (!Compushady::Utils::ValidateResourceBindingsMap(Compushady::Blendable::AddHistorySRVs(InResourceMap, ComputeResourceBindings), ComputeResourceBindings, InResourceArray, ErrorMessages))
 	{
 		return false;
 
@@ -857,6 +1651,87 @@ bool UCompushadyBlendable::UpdateComputeResourcesByMapAdvanced(const TMap<FStrin
 	return UpdateComputeResourcesAdvanced(InResourceArray, InXYZ, BlendableMatricesConfig, ErrorMessages);
 }
 
+bool UCompushadyBlendable::SetResolutionScale(const float InResolutionScale, const ECompushadyBlendableUpsampleFilter InUpsampleFilter, FString& ErrorMessages)
+{
+	if (InResolutionScale <= 0 || InResolutionScale > 1)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid ResolutionScale %f (must be > 0 and <= 1)"), InResolutionScale);
+		return false;
+	}
+
+	if ((InResolutionScale < 1 || bDirtyDriven) && (!UpsamplePixelShaderRef || InUpsampleFilter != UpsampleFilter))
+	{
+		if (!CreateUpsamplePixelShader(InUpsampleFilter, ErrorMessages))
+		{
+			return false;
+		}
+	}
+
+	ResolutionScale = InResolutionScale;
+	UpsampleFilter = InUpsampleFilter;
+
+	return true;
+}
+
+bool UCompushadyBlendable::CreateUpsamplePixelShader(const ECompushadyBlendableUpsampleFilter InUpsampleFilter, FString& ErrorMessages)
+{
+	FCompushadyResourceBindings NewUpsampleResourceBindings;
+	FPixelShaderRHIRef NewUpsamplePixelShaderRef = Compushady::Utils::CreatePixelShaderFromHLSL(Compushady::Blendable::UpsamplePixelShaderCode, InUpsampleFilter == ECompushadyBlendableUpsampleFilter::EdgeAware ? TEXT("main_edge_aware") : TEXT("main"), NewUpsampleResourceBindings, ErrorMessages);
+	if (!NewUpsamplePixelShaderRef)
+	{
+		return false;
+	}
+	UpsamplePixelShaderRef = NewUpsamplePixelShaderRef;
+	UpsampleResourceBindings = NewUpsampleResourceBindings;
+
+	// shared by all of the view extensions, the upsample passes create a single draw uniform buffer with it
+	if (!UpsampleUniformBufferLayoutRef)
+	{
+		FRHIUniformBufferLayoutInitializer LayoutInitializer(nullptr, sizeof(Compushady::Blendable::FCompushadyBlendableUpsampleConfig));
+		UpsampleUniformBufferLayoutRef = RHICreateUniformBufferLayout(LayoutInitializer);
+	}
+	return true;
+}
+
+bool UCompushadyBlendable::SetHistory(const int32 InNumHistoryBuffers, FString& ErrorMessages)
+{
+	if (InNumHistoryBuffers < 0 || InNumHistoryBuffers > Compushady::Blendable::MaxHistoryBuffers)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of History buffers %d (max %d)"), InNumHistoryBuffers, Compushady::Blendable::MaxHistoryBuffers);
+		return false;
+	}
+
+	NumHistoryBuffers = InNumHistoryBuffers;
+	return true;
+}
+
+bool UCompushadyBlendable::SetDirtyDriven(const bool bInDirtyDriven, FString& ErrorMessages)
+{
+	// the inputs signature does not track the scene textures
+	if (bInDirtyDriven && (Compushady::Blendable::HasFrameSceneTextures(PSResourceArray) || Compushady::Blendable::HasFrameSceneTextures(ComputeResourceArray)))
+	{
+		ErrorMessages = "Dirty driven blendables cannot bind scene textures";
+		return false;
+	}
+
+	// the cached output of pixel shaders is composited with the upsample pixel shader
+	if (bInDirtyDriven && PixelShaderRef && !UpsamplePixelShaderRef)
+	{
+		if (!CreateUpsamplePixelShader(UpsampleFilter, ErrorMessages))
+		{
+			return false;
+		}
+	}
+
+	bDirtyDriven = bInDirtyDriven;
+	return true;
+}
+
+void UCompushadyBlendable::MarkDirty()
+{
+	DirtyCounter->Increment();
+}
+
 FPixelShaderRHIRef UCompushadyBlendable::GetPixelShader() const
 {
 	return PixelShaderRef;
@@ -900,6 +1775,9 @@ FGuid UCompushadyBlendable::AddToBlitter(UObject* WorldContextObject, const int3
 		Guid = WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddViewExtension(NewViewExtension, this);
 	}
 	NewViewExtension->SetPriority(Priority);
+	NewViewExtension->SetResolutionScale(ResolutionScale, UpsampleFilter, UpsamplePixelShaderRef, UpsampleResourceBindings, UpsampleUniformBufferLayoutRef);
+	NewViewExtension->SetHistory(NumHistoryBuffers);
+	NewViewExtension->SetDirtyDriven(bDirtyDriven, DirtyCounter);
 	return Guid;
 #else
 	return FGuid::NewGuid();
@@ -15,23 +15,217 @@
 
 #include "Misc/Optional.h"
 
-struct FCompushadyBlitterDrawable
+// layout of the blitter constant buffer (see the vertex shader in FCompushadyBlitterPipeline::Initialize)
+struct FCompushadyBlitterInstance
 {
-	FGuid Guid;
-	FTextureRHIRef Texture;
-	FShaderResourceViewRHIRef SRV;
-	FVector4 Quad;
-	ECompushadyKeepAspectRatio AspectRatio;
+	float Quad[4];
+	float ImageSize[2];
+	uint32 AspectRatio;
+	uint32 TextureSlot;
+};
+
+struct FCompushadyBlitterInstances
+{
+	float ScreenSize[4];
+	FCompushadyBlitterInstance Instances[Compushady::Blitter::MaxInstancesPerDraw];
+};
 
-	FCompushadyBlitterDrawable()
+static_assert(sizeof(FCompushadyBlitterInstances) % 16 == 0, "FCompushadyBlitterInstances must be 16 bytes aligned");
+
+void Compushady::Blitter::BuildBatches(const TArray<int32>& Priorities, const TArray<UPTRINT>& TextureKeys, TArray<FCompushadyBlitterBatch>& Batches, const int32 MaxInstances)
+{
+	TArray<int32> SortedIndices;
+	SortedIndices.Reserve(Priorities.Num());
+	for (int32 DrawableIndex = 0; DrawableIndex < Priorities.Num(); DrawableIndex++)
 	{
-		Guid = FGuid::NewGuid();
-		Texture = nullptr;
-		SRV = nullptr;
-		Quad = FVector4::Zero();
-		AspectRatio = ECompushadyKeepAspectRatio::None;
+		SortedIndices.Add(DrawableIndex);
 	}
-};
+
+	SortedIndices.StableSort([&Priorities](const int32 A, const int32 B)
+		{
+			return Priorities[A] < Priorities[B];
+		});
+
+	TMap<UPTRINT, int32> BatchTextureSlots;
+	FCompushadyBlitterBatch* CurrentBatch = nullptr;
+
+	for (const int32 DrawableIndex : SortedIndices)
+	{
+		const UPTRINT TextureKey = TextureKeys[DrawableIndex];
+		const int32* TextureSlot = CurrentBatch ? BatchTextureSlots.Find(TextureKey) : nullptr;
+
+		if (!CurrentBatch || CurrentBatch->DrawableIndices.Num() >= FMath::Clamp(MaxInstances, 1, MaxInstancesPerDraw) || (!TextureSlot && CurrentBatch->TextureDrawableIndices.Num() >= MaxTexturesPerDraw))
+		{
+			CurrentBatch = &Batches.AddDefaulted_GetRef();
+			BatchTextureSlots.Reset();
+			TextureSlot = nullptr;
+		}
+
+		int32 NewTextureSlot = 0;
+		if (TextureSlot)
+		{
+			NewTextureSlot = *TextureSlot;
+		}
+		else
+		{
+			NewTextureSlot = CurrentBatch->TextureDrawableIndices.Add(DrawableIndex);
+			BatchTextureSlots.Add(TextureKey, NewTextureSlot);
+		}
+
+		CurrentBatch->DrawableIndices.Add(DrawableIndex);
+		CurrentBatch->TextureSlots.Add(NewTextureSlot);
+	}
+}
+
+bool Compushady::Blitter::FCompushadyBlitterPipeline::Initialize(FString& ErrorMessages)
+{
+	VertexShaderRef = Compushady::Utils::CreateVertexShaderFromHLSL(
+		"static const float2 uvs[6] = { float2(0, 0), float2(1, 0), float2(0, 1), float2(1, 0), float2(1, 1), float2(0, 1) };"
+		"struct Instance { float4 quad; float2 image_size; uint aspect_ratio; uint texture_slot; };"
+		"struct Instances { float4 screen_size; Instance instances[64]; };"
+		"struct Output { float4 position : SV_Position; float2 uv : UV; nointerpolation uint texture_slot : TEXTURE_SLOT; };"
+		"ConstantBuffer<Instances> blitter;"
+		"Output main(const uint vid : SV_VertexID, const uint iid : SV_InstanceID) {"
+		"  Instance instance = blitter.instances[iid];"
+		"  float4 quad = instance.quad;"
+		"  if (instance.aspect_ratio == 1) { quad.w = quad.y + (instance.image_size.y * ((blitter.screen_size.x * (quad.z - quad.x)) / instance.image_size.x)) / blitter.screen_size.y; }"
+		"  else if (instance.aspect_ratio == 2) { quad.z = quad.x + (instance.image_size.x * ((blitter.screen_size.y * (quad.w - quad.y)) / instance.image_size.y)) / blitter.screen_size.x; }"
+		"  const float2 position = lerp(quad.xy, quad.zw, uvs[vid]);"
+		"  Output o; o.position = float4(position.x * 2 - 1, -(position.y * 2 - 1), 0, 1); o.uv = uvs[vid]; o.texture_slot = instance.texture_slot; return o; }",
+		"main", VSResourceBindings, ErrorMessages);
+
+	if (!VertexShaderRef)
+	{
+		return false;
+	}
+
+	FString PixelShaderTextures;
+	FString PixelShaderSwitch;
+	for (int32 TextureSlot = 0; TextureSlot < Compushady::Blitter::MaxTexturesPerDraw; TextureSlot++)
+	{
+		PixelShaderTextures += FString::Printf(TEXT("Texture2D<float4> texture%d;"), TextureSlot);
+		PixelShaderSwitch += FString::Printf(TEXT("case %d: return texture%d.Sample(sampler0, i.uv);"), TextureSlot, TextureSlot);
+	}
+
+	PixelShaderRef = Compushady::Utils::CreatePixelShaderFromHLSL(
+		PixelShaderTextures +
+		TEXT("SamplerState sampler0;")
+		TEXT("struct Input { float4 position : SV_Position; float2 uv : UV; nointerpolation uint texture_slot : TEXTURE_SLOT; };")
+		TEXT("float4 main(Input i) : SV_Target0 { switch (i.texture_slot) {") + PixelShaderSwitch + TEXT("} return float4(0, 0, 0, 0); }"),
+		"main", PSResourceBindings, ErrorMessages);
+
+	if (!PixelShaderRef)
+	{
+		return false;
+	}
+
+	// ensure 16 bytes alignment!
+	FRHIUniformBufferLayoutInitializer LayoutInitializer(nullptr, sizeof(FCompushadyBlitterInstances));
+	UniformBufferLayoutRef = RHICreateUniformBufferLayout(LayoutInitializer);
+	UniformBufferRef = RHICreateUniformBuffer(nullptr, UniformBufferLayoutRef, EUniformBufferUsage::UniformBuffer_MultiFrame, EUniformBufferValidation::None);
+
+	// map SRV bindings to texture slots (textureN)
+	for (const FCompushadyResourceBinding& Binding : PSResourceBindings.SRVs)
+	{
+		PSTextureSlots.Add(FCString::Atoi(*Binding.Name.RightChop(7)));
+	}
+
+	FSamplerStateInitializerRHI SamplerStateInitializer(ESamplerFilter::SF_Bilinear, ESamplerAddressMode::AM_Clamp, ESamplerAddressMode::AM_Clamp, ESamplerAddressMode::AM_Clamp);
+	SamplerStateRef = RHICreateSamplerState(SamplerStateInitializer);
+
+	return true;
+}
+
+int32 Compushady::Blitter::FCompushadyBlitterPipeline::Rasterize_RenderThread(const TCHAR* PassName, FRHICommandList& RHICmdList, const FIntRect& ViewRect, FTextureRHIRef RenderTarget, const TArray<FCompushadyBlitterDrawable>& Drawables, const int32 MaxInstances)
+{
+	TArray<int32> Priorities;
+	TArray<UPTRINT> TextureKeys;
+	Priorities.Reserve(Drawables.Num());
+	TextureKeys.Reserve(Drawables.Num());
+	for (const FCompushadyBlitterDrawable& Drawable : Drawables)
+	{
+		Priorities.Add(Drawable.Priority);
+		TextureKeys.Add(Drawable.SRV ? reinterpret_cast<UPTRINT>(Drawable.SRV.GetReference()) : reinterpret_cast<UPTRINT>(Drawable.Texture.GetReference()));
+	}
+
+	TArray<FCompushadyBlitterBatch> Batches;
+	BuildBatches(Priorities, TextureKeys, Batches, MaxInstances);
+
+	FCompushadyRasterizerConfig RasterizerConfig;
+	RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::AlphaBlending;
+
+	Compushady::Utils::RasterizeSimplePass_RenderThread(PassName, RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, [&]()
+		{
+			FCompushadyBlitterInstances InstancesData = {};
+			InstancesData.ScreenSize[0] = static_cast<float>(ViewRect.Width());
+			InstancesData.ScreenSize[1] = static_cast<float>(ViewRect.Height());
+
+			for (const FCompushadyBlitterBatch& Batch : Batches)
+			{
+				// the keep aspect ratio math is done in the vertex shader
+				for (int32 InstanceIndex = 0; InstanceIndex < Batch.DrawableIndices.Num(); InstanceIndex++)
+				{
+					const FCompushadyBlitterDrawable& Drawable = Drawables[Batch.DrawableIndices[InstanceIndex]];
+					FCompushadyBlitterInstance& Instance = InstancesData.Instances[InstanceIndex];
+					Instance.Quad[0] = Drawable.Quad.X;
+					Instance.Quad[1] = Drawable.Quad.Y;
+					Instance.Quad[2] = Drawable.Quad.Z;
+					Instance.Quad[3] = Drawable.Quad.W;
+					Instance.ImageSize[0] = static_cast<float>(Drawable.Texture->GetSizeX());
+					Instance.ImageSize[1] = static_cast<float>(Drawable.Texture->GetSizeY());
+					Instance.AspectRatio = static_cast<uint32>(Drawable.AspectRatio);
+					Instance.TextureSlot = static_cast<uint32>(Batch.TextureSlots[InstanceIndex]);
+				}
+
+				RHICmdList.UpdateUniformBuffer(UniformBufferRef, &InstancesData);
+
+				Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, VertexShaderRef, VSResourceBindings,
+					[&](const int32 Index)
+					{
+						return UniformBufferRef;
+					},
+					[](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+					{
+						return { nullptr, nullptr };
+					},
+					[](const int32 Index)
+					{
+						return nullptr;
+					},
+					[&](const int32 Index)
+					{
+						return SamplerStateRef;
+					},
+					true);
+
+				Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, PixelShaderRef, PSResourceBindings,
+					[&](const int32 Index)
+					{
+						return UniformBufferRef;
+					},
+					[&](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+					{
+						// unused slots are bound to the first texture of the batch
+						const int32 TextureSlot = PSTextureSlots.IsValidIndex(Index) && Batch.TextureDrawableIndices.IsValidIndex(PSTextureSlots[Index]) ? PSTextureSlots[Index] : 0;
+						const FCompushadyBlitterDrawable& Drawable = Drawables[Batch.TextureDrawableIndices[TextureSlot]];
+						return { Drawable.SRV, Drawable.SRV ? nullptr : Drawable.Texture };
+					},
+					[](const int32 Index)
+					{
+						return nullptr;
+					},
+					[&](const int32 Index)
+					{
+						return SamplerStateRef;
+					},
+					true);
+
+				RHICmdList.DrawPrimitive(0, 2, Batch.DrawableIndices.Num());
+			}
+		}, RasterizerConfig);
+
+	return Batches.Num();
+}
 
 class FCompushadyBlitterViewExtension : public FSceneViewExtensionBase
 {
@@ -50,22 +244,11 @@ protected:
 		return CurrentViewRect;
 	};
 public:
-	FCompushadyBlitterViewExtension(const FAutoRegister& AutoRegister, UWorld* InWorld, FVertexShaderRHIRef InVertexShaderRef, const FCompushadyResourceBindings& InVSResourceBindings, FPixelShaderRHIRef InPixelShaderRef, const FCompushadyResourceBindings& InPSResourceBindings) :
+	FCompushadyBlitterViewExtension(const FAutoRegister& AutoRegister, UWorld* InWorld, TSharedRef<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe> InPipeline) :
 		FSceneViewExtensionBase(AutoRegister),
-		VertexShaderRef(InVertexShaderRef),
-		VSResourceBindings(InVSResourceBindings),
-		PixelShaderRef(InPixelShaderRef),
-		PSResourceBindings(InPSResourceBindings),
+		Pipeline(InPipeline),
 		World(InWorld)
 	{
-		// ensure 16 bytes alignment!
-		FRHIUniformBufferLayoutInitializer LayoutInitializer(nullptr, 96);
-		UniformBufferLayoutRef = RHICreateUniformBufferLayout(LayoutInitializer);
-		UniformBufferRef = RHICreateUniformBuffer(nullptr, UniformBufferLayoutRef, EUniformBufferUsage::UniformBuffer_MultiFrame, EUniformBufferValidation::None);
-
-		FSamplerStateInitializerRHI SamplerStateInitializer(ESamplerFilter::SF_Bilinear, ESamplerAddressMode::AM_Clamp, ESamplerAddressMode::AM_Clamp, ESamplerAddressMode::AM_Clamp);
-		SamplerStateRef = RHICreateSamplerState(SamplerStateInitializer);
-
 		FSceneViewExtensionIsActiveFunctor IsActiveFunctor;
 		IsActiveFunctor.IsActiveFunction = [this](const ISceneViewExtension* SceneViewExtension, const FSceneViewExtensionContext& Context) -> TOptional<bool>
 			{
@@ -90,117 +273,6 @@ public:
 
 	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
 
-	void DrawDrawables_RenderThread(FRHICommandList& RHICmdList, const FIntRect ViewRect, const TArray<FCompushadyBlitterDrawable>& CurrentDrawables)
-	{
-		TStaticArray<float, 24> QuadData;
-
-		for (const FCompushadyBlitterDrawable& Drawable : CurrentDrawables)
-		{
-			FVector4 Quad = Drawable.Quad;
-
-			if (Drawable.AspectRatio != ECompushadyKeepAspectRatio::None)
-			{
-				const float ScreenWidth = static_cast<float>(ViewRect.Width());
-				const float ScreenHeight = static_cast<float>(ViewRect.Height());
-				const float ImageWidth = static_cast<float>(Drawable.Texture->GetSizeX());
-				const float ImageHeight = static_cast<float>(Drawable.Texture->GetSizeY());
-
-				if (Drawable.AspectRatio == ECompushadyKeepAspectRatio::Horizontal)
-				{
-					const float WantedImageWidth = ScreenWidth * (Quad.Z - Quad.X);
-					const float NewImageHeight = ImageHeight * (WantedImageWidth / ImageWidth);
-					Quad.W = Quad.Y + (NewImageHeight / ScreenHeight);
-				}
-				else if (Drawable.AspectRatio == ECompushadyKeepAspectRatio::Vertical)
-				{
-					const float WantedImageHeight = ScreenHeight * (Quad.W - Quad.Y);
-					const float NewImageWidth = ImageWidth * (WantedImageHeight / ImageHeight);
-					Quad.Z = Quad.X + (NewImageWidth / ScreenWidth);
-				}
-			}
-
-			// top left
-			QuadData[0] = Quad.X * 2 - 1;
-			QuadData[1] = -(Quad.Y * 2 - 1);
-			QuadData[2] = 0;
-			QuadData[3] = 1;
-
-			// top right
-			QuadData[4] = Quad.Z * 2 - 1;
-			QuadData[5] = -(Quad.Y * 2 - 1);
-			QuadData[6] = 0;
-			QuadData[7] = 1;
-
-			// bottom left
-			QuadData[8] = Quad.X * 2 - 1;
-			QuadData[9] = -(Quad.W * 2 - 1);
-			QuadData[10] = 0;
-			QuadData[11] = 1;
-
-			// top right
-			QuadData[12] = Quad.Z * 2 - 1;
-			QuadData[13] = -(Quad.Y * 2 - 1);
-			QuadData[14] = 0;
-			QuadData[15] = 1;
-
-			// bottom right
-			QuadData[16] = Quad.Z * 2 - 1;
-			QuadData[17] = -(Quad.W * 2 - 1);
-			QuadData[18] = 0;
-			QuadData[19] = 1;
-
-			// bottom left
-			QuadData[20] = Quad.X * 2 - 1;
-			QuadData[21] = -(Quad.W * 2 - 1);
-			QuadData[22] = 0;
-			QuadData[23] = 1;
-
-			RHICmdList.UpdateUniformBuffer(UniformBufferRef, QuadData.GetData());
-
-			Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, VertexShaderRef, VSResourceBindings,
-				[&](const int32 Index)
-				{
-					return UniformBufferRef;
-				},
-				[&](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
-				{
-					//RHICmdList.Transition(FRHITransitionInfo(Drawable.Texture, ERHIAccess::Unknown, ERHIAccess::SRVMask));
-					return { Drawable.SRV, Drawable.SRV ? nullptr : Drawable.Texture };
-				},
-				[](const int32 Index)
-				{
-					return nullptr;
-				},
-				[&](const int32 Index)
-				{
-					return SamplerStateRef;
-				},
-				true);
-
-			Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, PixelShaderRef, PSResourceBindings,
-				[&](const int32 Index)
-				{
-					return UniformBufferRef;
-				},
-				[&](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
-				{
-					//RHICmdList.Transition(FRHITransitionInfo(Drawable.Texture, ERHIAccess::Unknown, ERHIAccess::SRVMask));
-					return { Drawable.SRV, Drawable.SRV ? nullptr : Drawable.Texture };
-				},
-				[](const int32 Index)
-				{
-					return nullptr;
-				},
-				[&](const int32 Index)
-				{
-					return SamplerStateRef;
-				},
-				true);
-
-			RHICmdList.DrawPrimitive(0, 2, 1);
-		}
-	}
-
 	void PostRenderView_RenderThread(FRDGBuilder& GraphBuilder, FSceneView& InView) override
 	{
 		TArray<FCompushadyBlitterDrawable> CurrentDrawables;
@@ -225,14 +297,7 @@ public:
 				ERDGPassFlags::None,
 				[this, ViewRect, RenderTarget, CurrentDrawables](FRHICommandList& RHICmdList)
 				{
-					FCompushadyRasterizerConfig RasterizerConfig;
-					RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::AlphaBlending;
-
-					Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyDrawerViewExtension::PostRenderView_RenderThread"),
-						RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, [&]()
-						{
-							DrawDrawables_RenderThread(RHICmdList, ViewRect, CurrentDrawables);
-						}, RasterizerConfig);
+					Pipeline->Rasterize_RenderThread(TEXT("FCompushadyDrawerViewExtension::PostRenderView_RenderThread"), RHICmdList, ViewRect, RenderTarget, CurrentDrawables);
 				});
 		}
 	}
@@ -257,13 +322,7 @@ public:
 				[this, ViewRect, SceneTextures, CurrentDrawables](FRHICommandList& RHICmdList)
 				{
 					FTextureRHIRef RenderTarget = SceneTextures->GetContents()->SceneColorTexture->GetRHI();
-					FCompushadyRasterizerConfig RasterizerConfig;
-					RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::AlphaBlending;
-					Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyDrawerViewExtension::PrePostProcessPass_RenderThread"),
-						RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, [&]()
-						{
-							DrawDrawables_RenderThread(RHICmdList, ViewRect, CurrentDrawables);
-						}, RasterizerConfig);
+					Pipeline->Rasterize_RenderThread(TEXT("FCompushadyDrawerViewExtension::PrePostProcessPass_RenderThread"), RHICmdList, ViewRect, RenderTarget, CurrentDrawables);
 				});
 		}
 	}
@@ -300,15 +359,8 @@ public:
 				ERDGPassFlags::None,
 				[this, ViewRect, Output, CurrentDrawables](FRHICommandList& RHICmdList)
 				{
-					FCompushadyRasterizerConfig RasterizerConfig;
-					RasterizerConfig.BlendMode = ECompushadyRasterizerBlendMode::AlphaBlending;
-
 					FTextureRHIRef RenderTarget = Output.Texture->GetRHI();
-					Compushady::Utils::RasterizeSimplePass_RenderThread(TEXT("FCompushadyDrawerViewExtension::PostProcessAfterMotionBlur_RenderThread"),
-						RHICmdList, VertexShaderRef, PixelShaderRef, &ViewRect, RenderTarget, [&]()
-						{
-							DrawDrawables_RenderThread(RHICmdList, ViewRect, CurrentDrawables);
-						}, RasterizerConfig);
+					Pipeline->Rasterize_RenderThread(TEXT("FCompushadyDrawerViewExtension::PostProcessAfterMotionBlur_RenderThread"), RHICmdList, ViewRect, RenderTarget, CurrentDrawables);
 				});
 		}
 
@@ -429,15 +481,7 @@ protected:
 	FCriticalSection AfterMotionBlurDrawablesCriticalSection;
 	TArray<FCompushadyBlitterDrawable> AfterMotionBlurDrawables;
 
-	FVertexShaderRHIRef VertexShaderRef;
-	FCompushadyResourceBindings VSResourceBindings;
-
-	FPixelShaderRHIRef PixelShaderRef;
-	FCompushadyResourceBindings PSResourceBindings;
-
-	FUniformBufferLayoutRHIRef UniformBufferLayoutRef;
-	FUniformBufferRHIRef UniformBufferRef;
-	FSamplerStateRHIRef SamplerStateRef;
+	TSharedRef<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe> Pipeline;
 
 	FMatrix CurrentViewMatrix;
 	FMatrix CurrentProjectionMatrix;
@@ -459,37 +503,14 @@ void ACompushadyBlitterActor::BeginPlay()
 	Super::BeginPlay();
 
 	FString ErrorMessages;
-
-	FCompushadyResourceBindings VSResourceBindings;
-	FVertexShaderRHIRef VertexShaderRef = Compushady::Utils::CreateVertexShaderFromHLSL(
-		"static const float2 uvs[6] = { float2(0, 0), float2(1, 0), float2(0, 1), float2(1, 0), float2(1, 1), float2(0, 1) };"
-		"struct Quad { float4 vertices[6]; };"
-		"struct Output { float4 position : SV_Position; float2 uv : UV; };"
-		"ConstantBuffer<Quad> quad;"
-		"Output main(const uint vid : SV_VertexID) { Output o; o.position = quad.vertices[vid]; o.uv = uvs[vid]; return o; }",
-		"main", VSResourceBindings, ErrorMessages);
-
-	if (!VertexShaderRef)
-	{
-		UE_LOG(LogCompushady, Error, TEXT("Unable to initialize Compushady Blitter: %s"), *ErrorMessages);
-		return;
-	}
-
-	FCompushadyResourceBindings PSResourceBindings;
-	FPixelShaderRHIRef PixelShaderRef = Compushady::Utils::CreatePixelShaderFromHLSL(
-		"Texture2D<float4> texture0;"
-		"SamplerState sampler0;"
-		"struct Input { float4 position : SV_Position; float2 uv : UV; };"
-		"float4 main(Input i) : SV_Target0 { return texture0.Sample(sampler0, i.uv); }",
-		"main", PSResourceBindings, ErrorMessages);
-
-	if (!PixelShaderRef)
+	TSharedRef<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe> Pipeline = MakeShared<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe>();
+	if (!Pipeline->Initialize(ErrorMessages))
 	{
 		UE_LOG(LogCompushady, Error, TEXT("Unable to initialize Compushady Blitter: %s"), *ErrorMessages);
 		return;
 	}
 
-	ViewExtension = FSceneViewExtensions::NewExtension<FCompushadyBlitterViewExtension>(GetWorld(), VertexShaderRef, VSResourceBindings, PixelShaderRef, PSResourceBindings);
+	ViewExtension = FSceneViewExtensions::NewExtension<FCompushadyBlitterViewExtension>(GetWorld(), Pipeline);
 
 }
 
@@ -500,7 +521,7 @@ void ACompushadyBlitterActor::Tick(float DeltaTime)
 
 }
 
-FGuid ACompushadyBlitterActor::AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid ACompushadyBlitterActor::AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	if (!ViewExtension || !Resource || !Resource->GetTextureRHI())
 	{
@@ -520,12 +541,13 @@ FGuid ACompushadyBlitterActor::AddDrawable(UCompushadyResource* Resource, const
 		Drawable.Quad = FVector4(0, 0, 1, 1);
 	}
 	Drawable.AspectRatio = KeepAspectRatio;
+	Drawable.Priority = Priority;
 
 	ViewExtension->AddDrawable(Drawable);
 	return Drawable.Guid;
 }
 
-FGuid ACompushadyBlitterActor::AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid ACompushadyBlitterActor::AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	if (!ViewExtension || !Resource || !Resource->GetTextureRHI())
 	{
@@ -545,12 +567,13 @@ FGuid ACompushadyBlitterActor::AddBeforePostProcessingDrawable(UCompushadyResour
 		Drawable.Quad = FVector4(0, 0, 1, 1);
 	}
 	Drawable.AspectRatio = KeepAspectRatio;
+	Drawable.Priority = Priority;
 
 	ViewExtension->AddBeforePostProcessingDrawable(Drawable);
 	return Drawable.Guid;
 }
 
-FGuid ACompushadyBlitterActor::AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid ACompushadyBlitterActor::AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	if (!ViewExtension || !Resource || !Resource->GetTextureRHI())
 	{
@@ -570,6 +593,7 @@ FGuid ACompushadyBlitterActor::AddAfterMotionBlurDrawable(UCompushadyResource* R
 		Drawable.Quad = FVector4(0, 0, 1, 1);
 	}
 	Drawable.AspectRatio = KeepAspectRatio;
+	Drawable.Priority = Priority;
 
 	ViewExtension->AddAfterMotionBlurDrawable(Drawable);
 	return Drawable.Guid;
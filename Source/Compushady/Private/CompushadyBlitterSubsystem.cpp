@@ -28,34 +28,34 @@ ACompushadyBlitterActor* UCompushadyBlitterSubsystem::GetBlitterActor()
 	return BlitterActor;
 }
 
-FGuid UCompushadyBlitterSubsystem::AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyBlitterSubsystem::AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	ACompushadyBlitterActor* CompushadyBlitterActor = GetBlitterActor();
 	if (!CompushadyBlitterActor)
 	{
 		return FGuid();
 	}
-	return CompushadyBlitterActor->AddDrawable(Resource, Quad, KeepAspectRatio);
+	return CompushadyBlitterActor->AddDrawable(Resource, Quad, KeepAspectRatio, Priority);
 }
 
-FGuid UCompushadyBlitterSubsystem::AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyBlitterSubsystem::AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	ACompushadyBlitterActor* CompushadyBlitterActor = GetBlitterActor();
 	if (!CompushadyBlitterActor)
 	{
 		return FGuid();
 	}
-	return CompushadyBlitterActor->AddBeforePostProcessingDrawable(Resource, Quad, KeepAspectRatio);
+	return CompushadyBlitterActor->AddBeforePostProcessingDrawable(Resource, Quad, KeepAspectRatio, Priority);
 }
 
-FGuid UCompushadyBlitterSubsystem::AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyBlitterSubsystem::AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
 	ACompushadyBlitterActor* CompushadyBlitterActor = GetBlitterActor();
 	if (!CompushadyBlitterActor)
 	{
 		return FGuid();
 	}
-	return CompushadyBlitterActor->AddAfterMotionBlurDrawable(Resource, Quad, KeepAspectRatio);
+	return CompushadyBlitterActor->AddAfterMotionBlurDrawable(Resource, Quad, KeepAspectRatio, Priority);
 }
 
 void UCompushadyBlitterSubsystem::RemoveDrawable(const FGuid& Guid)
@@ -99,19 +99,19 @@ FGuid UCompushadyBlitterSubsystem::AddViewExtension(TSharedPtr<ICompushadyTransi
 }
 
 // let's put them here to avoid circular includes
-FGuid UCompushadyResource::Draw(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyResource::Draw(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
-	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddDrawable(this, Quad, KeepAspectRatio);
+	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddDrawable(this, Quad, KeepAspectRatio, Priority);
 }
 
-FGuid UCompushadyResource::DrawBeforePostProcessing(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyResource::DrawBeforePostProcessing(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
-	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddBeforePostProcessingDrawable(this, Quad, KeepAspectRatio);
+	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddBeforePostProcessingDrawable(this, Quad, KeepAspectRatio, Priority);
 }
 
-FGuid UCompushadyResource::DrawAfterMotionBlur(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio)
+FGuid UCompushadyResource::DrawAfterMotionBlur(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority)
 {
-	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddAfterMotionBlurDrawable(this, Quad, KeepAspectRatio);
+	return WorldContextObject->GetWorld()->GetSubsystem<UCompushadyBlitterSubsystem>()->AddAfterMotionBlurDrawable(this, Quad, KeepAspectRatio, Priority);
 }
 
 bool UCompushadyCBV::SetProjectionMatrixFromViewport(UObject* WorldContextObject, const int64 Offset, const bool bTranspose, const bool bInverse)
@@ -0,0 +1,820 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+
+#include "CompushadyBrickedVolume.h"
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyNRRD.h"
+#include "CompushadySRV.h"
+#include "CompushadyUAV.h"
+#include "HAL/FileManager.h"
+#include "RHIGPUReadback.h"
+
+// page table entries store the slot coordinates in 10 bits per axis
+#define COMPUSHADY_BRICKS_MAX_POOL_AXIS 1024
+#define COMPUSHADY_BRICKS_RESIDENT 0x80000000
+#define COMPUSHADY_BRICKS_NUM_READBACKS 3
+
+namespace Compushady
+{
+	namespace Bricks
+	{
+		static TArray<int32> CollectRequests(const void* Data, const int32 NumBricks)
+		{
+			TArray<int32> Requests;
+			const uint32* Flags = reinterpret_cast<const uint32*>(Data);
+			for (int32 Brick = 0; Brick < NumBricks; Brick++)
+			{
+				if (Flags[Brick])
+				{
+					Requests.Add(Brick);
+				}
+			}
+			return Requests;
+		}
+
+		/* Loaded bricks and the dirty page table region, uploaded in a single render command */
+		struct FCompushadyBrickUpload
+		{
+			TArray64<uint8> BricksData;
+			// pool texel coordinates and offset in BricksData
+			TArray<TPair<FIntVector, int64>> Bricks;
+			FIntVector PageTableOrigin = FIntVector::ZeroValue;
+			FIntVector PageTableSize = FIntVector::ZeroValue;
+			TArray<uint32> PageTableEntries;
+		};
+
+		struct FCompushadyBrickRequests
+		{
+			TArray<int32> Requests;
+			int32 MaxBricks = 0;
+			FCompushadySignaled OnSignaled;
+		};
+
+		struct FCompushadyBrickReadback
+		{
+			TUniquePtr<FRHIGPUBufferReadback> Readback;
+			int32 MaxBricks = 0;
+			FCompushadySignaled OnSignaled;
+		};
+
+		struct FCompushadyBrickStreamer : public TSharedFromThis<FCompushadyBrickStreamer, ESPMode::ThreadSafe>
+		{
+			FCompushadyBrickStreamer(const FCompushadyBrickLayout& InLayout, const EPixelFormat InPixelFormat, TSharedPtr<FCompushadyBrickSource> InSource) : Layout(InLayout), PixelFormat(InPixelFormat), Source(InSource), Cache(InLayout)
+			{
+				Readbacks.SetNum(COMPUSHADY_BRICKS_NUM_READBACKS);
+				for (FCompushadyBrickReadback& Readback : Readbacks)
+				{
+					Readback.Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("Compushady::BrickedVolume::Requests"));
+				}
+			}
+
+			/* Loads the requested bricks (on the calling thread), evictions are always applied, even if the new brick fails to load */
+			void Stream(const TArray<int32>& Requests, const int32 MaxBricks, FCompushadyBrickUpload& Upload)
+			{
+				TArray<FCompushadyBrickLoad> Loads;
+				{
+					FScopeLock ScopeLock(&CacheLock);
+					Cache.ProcessRequests(Requests, MaxBricks, Loads);
+				}
+
+				const int64 BrickDataSize = Source->GetBrickDataSize();
+				Upload.BricksData.SetNumUninitialized(Loads.Num() * BrickDataSize);
+
+				TArray<int32> DirtyBricks;
+				for (int32 LoadIndex = 0; LoadIndex < Loads.Num(); LoadIndex++)
+				{
+					const FCompushadyBrickLoad& Load = Loads[LoadIndex];
+					if (Load.EvictedBrick != INDEX_NONE)
+					{
+						DirtyBricks.Add(Load.EvictedBrick);
+					}
+					DirtyBricks.Add(Load.Brick);
+
+					FString ErrorMessages;
+					if (!Source->ReadBrick(Load.Brick, Upload.BricksData.GetData() + LoadIndex * BrickDataSize, ErrorMessages))
+					{
+						UE_LOG(LogCompushady, Error, TEXT("Unable to load brick %d: %s"), Load.Brick, *ErrorMessages);
+						FScopeLock ScopeLock(&CacheLock);
+						Cache.Release(Load.Brick);
+						FailedBricks++;
+						continue;
+					}
+
+					Upload.Bricks.Add({ Layout.GetSlotCoordinates(Load.Slot) * Layout.BrickSize, LoadIndex * BrickDataSize });
+					LoadedBricks++;
+				}
+
+				// the entries come from the cache, so released bricks are already non resident
+				FScopeLock ScopeLock(&CacheLock);
+				Cache.GetPageTableRegion(DirtyBricks, Upload.PageTableOrigin, Upload.PageTableSize, Upload.PageTableEntries);
+			}
+
+			/* Enqueues the bricks upload, the page table update and the requests clear */
+			void EnqueueUpload(FCompushadyBrickUpload&& Upload)
+			{
+				check(IsInGameThread());
+
+				ENQUEUE_RENDER_COMMAND(DoCompushadyStreamBricks)(
+					[Self = AsShared(), Upload = MoveTemp(Upload)](FRHICommandListImmediate& RHICmdList)
+					{
+						const uint32 BrickSize = Self->Layout.BrickSize;
+						const uint32 RowPitch = BrickSize * GPixelFormats[Self->PixelFormat].BlockBytes;
+
+						// bricks first, so the page table never points to stale data
+						for (const TPair<FIntVector, int64>& Brick : Upload.Bricks)
+						{
+							FUpdateTextureRegion3D UpdateTextureRegion3D(Brick.Key.X, Brick.Key.Y, Brick.Key.Z, 0, 0, 0, BrickSize, BrickSize, BrickSize);
+							RHICmdList.UpdateTexture3D(Self->PoolRHI, 0, UpdateTextureRegion3D, RowPitch, RowPitch * BrickSize, Upload.BricksData.GetData() + Brick.Value);
+						}
+
+						if (Upload.PageTableEntries.Num() > 0)
+						{
+							const FIntVector& Origin = Upload.PageTableOrigin;
+							const FIntVector& Size = Upload.PageTableSize;
+							FUpdateTextureRegion3D UpdateTextureRegion3D(Origin.X, Origin.Y, Origin.Z, 0, 0, 0, Size.X, Size.Y, Size.Z);
+							RHICmdList.UpdateTexture3D(Self->PageTableRHI, 0, UpdateTextureRegion3D, Size.X * sizeof(uint32), Size.X * Size.Y * sizeof(uint32), reinterpret_cast<const uint8*>(Upload.PageTableEntries.GetData()));
+						}
+
+						RHICmdList.Transition(FRHITransitionInfo(Self->RequestUAV, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+						RHICmdList.ClearUAVUint(Self->RequestUAV, FUintVector4(0, 0, 0, 0));
+
+						Self->NumInFlight--;
+					});
+			}
+
+			void EnqueueReadback_RenderThread(FRHICommandListImmediate& RHICmdList, const int32 MaxBricks, const FCompushadySignaled& OnSignaled)
+			{
+				FCompushadyBrickReadback& Readback = Readbacks[WriteIndex % Readbacks.Num()];
+				WriteIndex++;
+
+				Readback.MaxBricks = MaxBricks;
+				Readback.OnSignaled = OnSignaled;
+
+				RHICmdList.Transition(FRHITransitionInfo(RequestBufferRHI, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+				Readback.Readback->EnqueueCopy(RHICmdList, RequestBufferRHI, Layout.GetNumBricks() * sizeof(uint32));
+			}
+
+			/* Collects the requests of the completed readbacks (in order) and schedules their loading */
+			void PollReadbacks_RenderThread()
+			{
+				while (ReadIndex != WriteIndex)
+				{
+					FCompushadyBrickReadback& Readback = Readbacks[ReadIndex % Readbacks.Num()];
+					if (!Readback.Readback->IsReady())
+					{
+						break;
+					}
+
+					FCompushadyBrickRequests Requests;
+					Requests.Requests = CollectRequests(Readback.Readback->Lock(Layout.GetNumBricks() * sizeof(uint32)), Layout.GetNumBricks());
+					Readback.Readback->Unlock();
+					Requests.MaxBricks = Readback.MaxBricks;
+					Requests.OnSignaled = MoveTemp(Readback.OnSignaled);
+					PendingRequests.Enqueue(MoveTemp(Requests));
+
+					ReadIndex++;
+					NumReadbacks--;
+				}
+
+				ScheduleLoads();
+			}
+
+			void ReleaseReadbacks_RenderThread()
+			{
+				Readbacks.Empty();
+				ReadIndex = WriteIndex;
+			}
+
+			/* A single task at a time loads the requests, so the uploads are enqueued in the order of the updates */
+			void ScheduleLoads()
+			{
+				bool bExpected = false;
+				if (PendingRequests.IsEmpty() || !bLoading.compare_exchange_strong(bExpected, true))
+				{
+					return;
+				}
+
+				Async(EAsyncExecution::ThreadPool, [Self = AsShared()]()
+					{
+						FCompushadyBrickRequests Requests;
+						while (Self->PendingRequests.Dequeue(Requests))
+						{
+							FCompushadyBrickUpload Upload;
+							Self->Stream(Requests.Requests, Requests.MaxBricks, Upload);
+
+							// render commands can only be enqueued from the game thread
+							AsyncTask(ENamedThreads::GameThread, [Self, Upload = MoveTemp(Upload), OnSignaled = MoveTemp(Requests.OnSignaled)]() mutable
+								{
+									Self->EnqueueUpload(MoveTemp(Upload));
+									OnSignaled.ExecuteIfBound(true, "");
+								});
+						}
+
+						Self->bLoading = false;
+						// requests enqueued after the last Dequeue
+						Self->ScheduleLoads();
+					});
+			}
+
+			FCompushadyBrickedVolumeStats GetStats()
+			{
+				FCompushadyBrickedVolumeStats Stats;
+				{
+					FScopeLock ScopeLock(&CacheLock);
+					Stats.ResidentBricks = Cache.GetNumResident();
+					Stats.EvictedBricks = Cache.GetNumEvicted();
+					Stats.DroppedRequests = Cache.GetNumDropped();
+				}
+				Stats.LoadedBricks = LoadedBricks.load();
+				Stats.FailedBricks = FailedBricks.load();
+				return Stats;
+			}
+
+			FCompushadyBrickLayout Layout;
+			EPixelFormat PixelFormat;
+			TSharedPtr<FCompushadyBrickSource> Source;
+
+			FCriticalSection CacheLock;
+			FCompushadyBrickCache Cache;
+
+			FTextureRHIRef PoolRHI;
+			FTextureRHIRef PageTableRHI;
+			FBufferRHIRef RequestBufferRHI;
+			FUnorderedAccessViewRHIRef RequestUAV;
+
+			// render thread only
+			TArray<FCompushadyBrickReadback> Readbacks;
+			uint32 ReadIndex = 0;
+			uint32 WriteIndex = 0;
+
+			// produced by the render thread, consumed by the loading task
+			TQueue<FCompushadyBrickRequests, EQueueMode::Spsc> PendingRequests;
+			std::atomic<bool> bLoading{ false };
+
+			// updates not yet uploaded, and the ones still waiting for their readback
+			std::atomic<int32> NumInFlight{ 0 };
+			std::atomic<int32> NumReadbacks{ 0 };
+			std::atomic<int64> LoadedBricks{ 0 };
+			std::atomic<int64> FailedBricks{ 0 };
+		};
+
+	}
+}
+
+bool Compushady::Bricks::FCompushadyBrickLayout::Create(const FIntVector& VolumeSize, const int32 BrickSize, const FIntVector& PoolSize, FCompushadyBrickLayout& Layout, FString& ErrorMessages)
+{
+	if (VolumeSize.X <= 0 || VolumeSize.Y <= 0 || VolumeSize.Z <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid volume size (%d %d %d)"), VolumeSize.X, VolumeSize.Y, VolumeSize.Z);
+		return false;
+	}
+
+	if (BrickSize <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid brick size %d"), BrickSize);
+		return false;
+	}
+
+	if (PoolSize.X <= 0 || PoolSize.Y <= 0 || PoolSize.Z <= 0 || PoolSize.X > COMPUSHADY_BRICKS_MAX_POOL_AXIS || PoolSize.Y > COMPUSHADY_BRICKS_MAX_POOL_AXIS || PoolSize.Z > COMPUSHADY_BRICKS_MAX_POOL_AXIS)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid pool size (%d %d %d)"), PoolSize.X, PoolSize.Y, PoolSize.Z);
+		return false;
+	}
+
+	const FIntVector NumBricks((VolumeSize.X + BrickSize - 1) / BrickSize, (VolumeSize.Y + BrickSize - 1) / BrickSize, (VolumeSize.Z + BrickSize - 1) / BrickSize);
+	if (static_cast<int64>(NumBricks.X) * NumBricks.Y * NumBricks.Z > MAX_int32)
+	{
+		ErrorMessages = "Too many bricks, increase the brick size";
+		return false;
+	}
+
+	Layout.VolumeSize = VolumeSize;
+	Layout.BrickSize = BrickSize;
+	Layout.NumBricks = NumBricks;
+	Layout.PoolSize = PoolSize;
+
+	return true;
+}
+
+int32 Compushady::Bricks::FCompushadyBrickLayout::GetBrickIndex(const FIntVector& Brick) const
+{
+	return (Brick.Z * NumBricks.Y + Brick.Y) * NumBricks.X + Brick.X;
+}
+
+FIntVector Compushady::Bricks::FCompushadyBrickLayout::GetBrickCoordinates(const int32 BrickIndex) const
+{
+	return FIntVector(BrickIndex % NumBricks.X, (BrickIndex / NumBricks.X) % NumBricks.Y, BrickIndex / (NumBricks.X * NumBricks.Y));
+}
+
+FIntVector Compushady::Bricks::FCompushadyBrickLayout::GetSlotCoordinates(const int32 Slot) const
+{
+	return FIntVector(Slot % PoolSize.X, (Slot / PoolSize.X) % PoolSize.Y, Slot / (PoolSize.X * PoolSize.Y));
+}
+
+FIntVector Compushady::Bricks::FCompushadyBrickLayout::GetBrickOrigin(const int32 BrickIndex) const
+{
+	return GetBrickCoordinates(BrickIndex) * BrickSize;
+}
+
+FIntVector Compushady::Bricks::FCompushadyBrickLayout::GetBrickExtent(const int32 BrickIndex) const
+{
+	const FIntVector Origin = GetBrickOrigin(BrickIndex);
+	return FIntVector(FMath::Min(BrickSize, VolumeSize.X - Origin.X), FMath::Min(BrickSize, VolumeSize.Y - Origin.Y), FMath::Min(BrickSize, VolumeSize.Z - Origin.Z));
+}
+
+uint32 Compushady::Bricks::FCompushadyBrickLayout::GetPageTableEntry(const int32 Slot) const
+{
+	const FIntVector SlotCoordinates = GetSlotCoordinates(Slot);
+	return COMPUSHADY_BRICKS_RESIDENT | static_cast<uint32>(SlotCoordinates.X) | (static_cast<uint32>(SlotCoordinates.Y) << 10) | (static_cast<uint32>(SlotCoordinates.Z) << 20);
+}
+
+Compushady::Bricks::FCompushadyBrickCache::FCompushadyBrickCache(const FCompushadyBrickLayout& InLayout) : Layout(InLayout)
+{
+	const int32 NumBricks = Layout.GetNumBricks();
+	const int32 NumSlots = Layout.GetNumSlots();
+
+	BrickToSlot.Init(INDEX_NONE, NumBricks);
+	PageTable.Init(0, NumBricks);
+
+	SlotToBrick.Init(INDEX_NONE, NumSlots);
+	SlotPrev.Init(INDEX_NONE, NumSlots);
+	SlotNext.Init(INDEX_NONE, NumSlots);
+	SlotBatch.Init(0, NumSlots);
+
+	// popped from the end, so slot 0 is the first one used
+	FreeSlots.Reserve(NumSlots);
+	for (int32 Slot = NumSlots - 1; Slot >= 0; Slot--)
+	{
+		FreeSlots.Add(Slot);
+	}
+}
+
+void Compushady::Bricks::FCompushadyBrickCache::Unlink(const int32 Slot)
+{
+	if (SlotPrev[Slot] != INDEX_NONE)
+	{
+		SlotNext[SlotPrev[Slot]] = SlotNext[Slot];
+	}
+	else
+	{
+		Head = SlotNext[Slot];
+	}
+
+	if (SlotNext[Slot] != INDEX_NONE)
+	{
+		SlotPrev[SlotNext[Slot]] = SlotPrev[Slot];
+	}
+	else
+	{
+		Tail = SlotPrev[Slot];
+	}
+
+	SlotPrev[Slot] = INDEX_NONE;
+	SlotNext[Slot] = INDEX_NONE;
+}
+
+void Compushady::Bricks::FCompushadyBrickCache::PushFront(const int32 Slot)
+{
+	SlotPrev[Slot] = INDEX_NONE;
+	SlotNext[Slot] = Head;
+	if (Head != INDEX_NONE)
+	{
+		SlotPrev[Head] = Slot;
+	}
+	Head = Slot;
+	if (Tail == INDEX_NONE)
+	{
+		Tail = Slot;
+	}
+}
+
+void Compushady::Bricks::FCompushadyBrickCache::ProcessRequests(const TArray<int32>& Requests, const int32 MaxLoads, TArray<FCompushadyBrickLoad>& Loads)
+{
+	Batch++;
+
+	for (const int32 Brick : Requests)
+	{
+		if (BrickToSlot.IsValidIndex(Brick) && BrickToSlot[Brick] != INDEX_NONE)
+		{
+			const int32 Slot = BrickToSlot[Brick];
+			SlotBatch[Slot] = Batch;
+			Unlink(Slot);
+			PushFront(Slot);
+		}
+	}
+
+	for (const int32 Brick : Requests)
+	{
+		if (!BrickToSlot.IsValidIndex(Brick) || BrickToSlot[Brick] != INDEX_NONE)
+		{
+			continue;
+		}
+
+		if (MaxLoads > 0 && Loads.Num() >= MaxLoads)
+		{
+			NumDropped++;
+			continue;
+		}
+
+		FCompushadyBrickLoad Load;
+		Load.Brick = Brick;
+
+		if (FreeSlots.Num() > 0)
+		{
+			Load.Slot = FreeSlots.Pop(EAllowShrinking::No);
+		}
+		else
+		{
+			// the whole pool is used by this batch
+			if (Tail == INDEX_NONE || SlotBatch[Tail] == Batch)
+			{
+				NumDropped++;
+				continue;
+			}
+
+			Load.Slot = Tail;
+			Load.EvictedBrick = SlotToBrick[Tail];
+			Unlink(Tail);
+
+			BrickToSlot[Load.EvictedBrick] = INDEX_NONE;
+			PageTable[Load.EvictedBrick] = 0;
+			NumResident--;
+			NumEvicted++;
+		}
+
+		SlotToBrick[Load.Slot] = Brick;
+		SlotBatch[Load.Slot] = Batch;
+		BrickToSlot[Brick] = Load.Slot;
+		PageTable[Brick] = Layout.GetPageTableEntry(Load.Slot);
+		PushFront(Load.Slot);
+		NumResident++;
+
+		Loads.Add(Load);
+	}
+}
+
+void Compushady::Bricks::FCompushadyBrickCache::Release(const int32 Brick)
+{
+	if (!BrickToSlot.IsValidIndex(Brick) || BrickToSlot[Brick] == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Slot = BrickToSlot[Brick];
+	Unlink(Slot);
+	SlotToBrick[Slot] = INDEX_NONE;
+	SlotBatch[Slot] = 0;
+	BrickToSlot[Brick] = INDEX_NONE;
+	PageTable[Brick] = 0;
+	FreeSlots.Add(Slot);
+	NumResident--;
+}
+
+void Compushady::Bricks::FCompushadyBrickCache::GetPageTableRegion(const TArray<int32>& Bricks, FIntVector& RegionOrigin, FIntVector& RegionSize, TArray<uint32>& Entries) const
+{
+	Entries.Empty();
+	RegionOrigin = FIntVector::ZeroValue;
+	RegionSize = FIntVector::ZeroValue;
+
+	if (Bricks.Num() == 0)
+	{
+		return;
+	}
+
+	FIntVector Min(MAX_int32);
+	FIntVector Max(MIN_int32);
+	for (const int32 Brick : Bricks)
+	{
+		const FIntVector Coordinates = Layout.GetBrickCoordinates(Brick);
+		Min = FIntVector(FMath::Min(Min.X, Coordinates.X), FMath::Min(Min.Y, Coordinates.Y), FMath::Min(Min.Z, Coordinates.Z));
+		Max = FIntVector(FMath::Max(Max.X, Coordinates.X), FMath::Max(Max.Y, Coordinates.Y), FMath::Max(Max.Z, Coordinates.Z));
+	}
+
+	RegionOrigin = Min;
+	RegionSize = Max - Min + FIntVector(1);
+	Entries.Reserve(RegionSize.X * RegionSize.Y * RegionSize.Z);
+	for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 X = Min.X; X <= Max.X; X++)
+			{
+				Entries.Add(PageTable[Layout.GetBrickIndex(FIntVector(X, Y, Z))]);
+			}
+		}
+	}
+}
+
+TArray<int32> Compushady::Bricks::FCompushadyBrickCache::GetLRUBricks() const
+{
+	TArray<int32> Bricks;
+	for (int32 Slot = Tail; Slot != INDEX_NONE; Slot = SlotPrev[Slot])
+	{
+		Bricks.Add(SlotToBrick[Slot]);
+	}
+	return Bricks;
+}
+
+TSharedPtr<Compushady::Bricks::FCompushadyBrickSource> Compushady::Bricks::FCompushadyBrickSource::Create(const FString& Filename, const int64 Offset, const FCompushadyBrickLayout& Layout, const EPixelFormat PixelFormat, const bool bBigEndian, FString& ErrorMessages)
+{
+	const int64 BlockBytes = GPixelFormats[PixelFormat].BlockBytes;
+	if (BlockBytes <= 0 || GPixelFormats[PixelFormat].BlockSizeX != 1 || GPixelFormats[PixelFormat].BlockSizeY != 1)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported bricks Pixel Format %s"), GetPixelFormatString(PixelFormat));
+		return nullptr;
+	}
+
+	TSharedPtr<FCompushadyBrickSource> Source = MakeShareable(new FCompushadyBrickSource());
+	Source->Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Source->Archive)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open file %s"), *Filename);
+		return nullptr;
+	}
+
+	const int64 RequiredSize = static_cast<int64>(Layout.VolumeSize.X) * Layout.VolumeSize.Y * Layout.VolumeSize.Z * BlockBytes;
+	if (Offset < 0 || Source->Archive->TotalSize() - Offset < RequiredSize)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid volume file size (required: %lld bytes)"), RequiredSize);
+		return nullptr;
+	}
+
+	Source->Offset = Offset;
+	Source->Layout = Layout;
+	Source->PixelFormat = PixelFormat;
+	Source->bBigEndian = bBigEndian;
+
+	return Source;
+}
+
+int64 Compushady::Bricks::FCompushadyBrickSource::GetBrickDataSize() const
+{
+	return static_cast<int64>(Layout.BrickSize) * Layout.BrickSize * Layout.BrickSize * GPixelFormats[PixelFormat].BlockBytes;
+}
+
+bool Compushady::Bricks::FCompushadyBrickSource::ReadBrick(const int32 BrickIndex, uint8* Output, FString& ErrorMessages)
+{
+	const int64 BlockBytes = GPixelFormats[PixelFormat].BlockBytes;
+	const int64 BrickSize = Layout.BrickSize;
+	const FIntVector Origin = Layout.GetBrickOrigin(BrickIndex);
+	const FIntVector Extent = Layout.GetBrickExtent(BrickIndex);
+
+	if (Extent != FIntVector(Layout.BrickSize))
+	{
+		FMemory::Memzero(Output, GetBrickDataSize());
+	}
+
+	const int64 VolumeRowSize = Layout.VolumeSize.X * BlockBytes;
+	const int64 VolumeSliceSize = VolumeRowSize * Layout.VolumeSize.Y;
+	const int64 RowSize = Extent.X * BlockBytes;
+
+	for (int32 Z = 0; Z < Extent.Z; Z++)
+	{
+		for (int32 Y = 0; Y < Extent.Y; Y++)
+		{
+			Archive->Seek(Offset + (Origin.Z + Z) * VolumeSliceSize + (Origin.Y + Y) * VolumeRowSize + Origin.X * BlockBytes);
+			Archive->Serialize(Output + ((Z * BrickSize) + Y) * BrickSize * BlockBytes, RowSize);
+		}
+	}
+
+	if (Archive->IsError())
+	{
+		ErrorMessages = "Unable to read the brick data";
+		return false;
+	}
+
+	if (bBigEndian && BlockBytes > 1)
+	{
+		Compushady::NRRD::SwapEndianness(Output, GetBrickDataSize() / BlockBytes, BlockBytes);
+	}
+
+	return true;
+}
+
+bool UCompushadyBrickedVolume::InitializeFromFile(const FString& Name, const FString& Filename, const FIntVector VolumeSize, const EPixelFormat PixelFormat, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages, const int64 Offset)
+{
+	return Initialize(Name, Filename, Offset, VolumeSize, PixelFormat, false, BrickSize, PoolSize, ErrorMessages);
+}
+
+bool UCompushadyBrickedVolume::InitializeFromNRRDFile(const FString& Name, const FString& Filename, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages)
+{
+	Compushady::NRRD::FCompushadyNRRDHeader Header;
+	if (!Compushady::NRRD::ParseHeader(Filename, Header, ErrorMessages))
+	{
+		return false;
+	}
+
+	FString DataFilename;
+	int64 Offset = 0;
+	if (!Compushady::NRRD::GetRawDataLocation(Header, DataFilename, Offset, ErrorMessages))
+	{
+		return false;
+	}
+
+	return Initialize(Name, DataFilename, Offset, FIntVector(Header.Width, Header.Height, Header.Depth), Header.PixelFormat, Header.bBigEndian, BrickSize, PoolSize, ErrorMessages);
+}
+
+bool UCompushadyBrickedVolume::Initialize(const FString& Name, const FString& Filename, const int64 Offset, const FIntVector VolumeSize, const EPixelFormat PixelFormat, const bool bBigEndian, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages)
+{
+	if (IsStreaming())
+	{
+		ErrorMessages = "The bricked volume is still streaming";
+		return false;
+	}
+
+	Compushady::Bricks::FCompushadyBrickLayout Layout;
+	if (!Compushady::Bricks::FCompushadyBrickLayout::Create(VolumeSize, BrickSize, PoolSize, Layout, ErrorMessages))
+	{
+		return false;
+	}
+
+	const FIntVector PoolTextureSize = PoolSize * BrickSize;
+	const int32 MaxDimension = static_cast<int32>(GMaxVolumeTextureDimensions);
+	if (PoolTextureSize.GetMax() > MaxDimension || Layout.NumBricks.GetMax() > MaxDimension)
+	{
+		ErrorMessages = FString::Printf(TEXT("The pool (%d %d %d) and the page table (%d %d %d) cannot exceed %d texels per axis"), PoolTextureSize.X, PoolTextureSize.Y, PoolTextureSize.Z, Layout.NumBricks.X, Layout.NumBricks.Y, Layout.NumBricks.Z, MaxDimension);
+		return false;
+	}
+
+	TSharedPtr<Compushady::Bricks::FCompushadyBrickSource> Source = Compushady::Bricks::FCompushadyBrickSource::Create(Filename, Offset, Layout, PixelFormat, bBigEndian, ErrorMessages);
+	if (!Source)
+	{
+		return false;
+	}
+
+	BrickPool = UCompushadyFunctionLibrary::CreateCompushadySRVTexture3D(Name + "_Pool", PoolTextureSize.X, PoolTextureSize.Y, PoolTextureSize.Z, PixelFormat);
+	PageTable = UCompushadyFunctionLibrary::CreateCompushadySRVTexture3D(Name + "_PageTable", Layout.NumBricks.X, Layout.NumBricks.Y, Layout.NumBricks.Z, EPixelFormat::PF_R32_UINT);
+	RequestBuffer = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(Name + "_Requests", static_cast<int64>(Layout.GetNumBricks()) * sizeof(uint32), EPixelFormat::PF_R32_UINT);
+
+	if (!BrickPool || !PageTable || !RequestBuffer)
+	{
+		ErrorMessages = "Unable to create the bricked volume resources";
+		return false;
+	}
+
+	Streamer = MakeShared<Compushady::Bricks::FCompushadyBrickStreamer, ESPMode::ThreadSafe>(Layout, PixelFormat, Source);
+	Streamer->PoolRHI = BrickPool->GetTextureRHI();
+	Streamer->PageTableRHI = PageTable->GetTextureRHI();
+	Streamer->RequestBufferRHI = RequestBuffer->GetBufferRHI();
+	Streamer->RequestUAV = RequestBuffer->GetRHI();
+
+	// nothing is resident yet
+	const TArray<uint32>& EmptyPageTable = Streamer->Cache.GetPageTable();
+	for (int32 Slice = 0; Slice < Layout.NumBricks.Z; Slice++)
+	{
+		PageTable->UpdateTextureSliceSync(reinterpret_cast<const uint8*>(EmptyPageTable.GetData() + Slice * Layout.NumBricks.X * Layout.NumBricks.Y), Layout.NumBricks.X * Layout.NumBricks.Y * sizeof(uint32), Slice);
+	}
+
+	if (!RequestBuffer->ClearBufferWithByteSync(0))
+	{
+		ErrorMessages = "Unable to clear the request buffer";
+		return false;
+	}
+
+	return true;
+}
+
+void UCompushadyBrickedVolume::UpdateFromRequests(const int32 MaxBricks, const FCompushadySignaled& OnSignaled)
+{
+	if (!Streamer)
+	{
+		OnSignaled.ExecuteIfBound(false, "The bricked volume is not initialized");
+		return;
+	}
+
+	if (RequestBuffer->IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The Resource is already being processed by another task");
+		return;
+	}
+
+	int32 NumInFlight = Streamer->NumInFlight.load();
+	do
+	{
+		if (NumInFlight >= COMPUSHADY_BRICKS_NUM_READBACKS)
+		{
+			OnSignaled.ExecuteIfBound(false, "Too many bricked volume updates in flight");
+			return;
+		}
+	} while (!Streamer->NumInFlight.compare_exchange_weak(NumInFlight, NumInFlight + 1));
+
+	Streamer->NumReadbacks++;
+
+	// the readback is polled (by Tick) on the following frames
+	ENQUEUE_RENDER_COMMAND(DoCompushadyBrickedVolumeReadback)(
+		[Streamer = Streamer, MaxBricks, OnSignaled](FRHICommandListImmediate& RHICmdList)
+		{
+			Streamer->EnqueueReadback_RenderThread(RHICmdList, MaxBricks, OnSignaled);
+		});
+}
+
+bool UCompushadyBrickedVolume::UpdateFromRequestsSync(const int32 MaxBricks, FString& ErrorMessages)
+{
+	if (!Streamer)
+	{
+		ErrorMessages = "The bricked volume is not initialized";
+		return false;
+	}
+
+	if (RequestBuffer->IsRunning())
+	{
+		ErrorMessages = "The Resource is already being processed by another task";
+		return false;
+	}
+
+	int32 Expected = 0;
+	if (!Streamer->NumInFlight.compare_exchange_strong(Expected, 1))
+	{
+		ErrorMessages = "The bricked volume is still streaming";
+		return false;
+	}
+
+	const int32 NumBricks = Streamer->Layout.GetNumBricks();
+	TArray<int32> Requests;
+	if (!RequestBuffer->MapReadAndExecuteSync([&Requests, NumBricks](const void* Data)
+		{
+			Requests = Compushady::Bricks::CollectRequests(Data, NumBricks);
+			return true;
+		}))
+	{
+		Streamer->NumInFlight--;
+		ErrorMessages = "Unable to read back the request buffer";
+		return false;
+	}
+
+	Compushady::Bricks::FCompushadyBrickUpload Upload;
+	Streamer->Stream(Requests, MaxBricks, Upload);
+	Streamer->EnqueueUpload(MoveTemp(Upload));
+
+	FlushRenderingCommands();
+
+	return true;
+}
+
+bool UCompushadyBrickedVolume::IsStreaming() const
+{
+	return Streamer && Streamer->NumInFlight.load() > 0;
+}
+
+FIntVector UCompushadyBrickedVolume::GetNumBricks() const
+{
+	return Streamer ? Streamer->Layout.NumBricks : FIntVector::ZeroValue;
+}
+
+int32 UCompushadyBrickedVolume::GetBrickSize() const
+{
+	return Streamer ? Streamer->Layout.BrickSize : 0;
+}
+
+FCompushadyBrickedVolumeStats UCompushadyBrickedVolume::GetStats() const
+{
+	return Streamer ? Streamer->GetStats() : FCompushadyBrickedVolumeStats();
+}
+
+void UCompushadyBrickedVolume::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	if (Streamer)
+	{
+		// pending loads keep a reference to the streamer, only the readbacks are owned by the render thread
+		ENQUEUE_RENDER_COMMAND(DoCompushadyBrickedVolumeDestroy)(
+			[CurrentStreamer = Streamer](FRHICommandListImmediate& RHICmdList)
+			{
+				CurrentStreamer->ReleaseReadbacks_RenderThread();
+			});
+
+		DestroyFence.BeginFence();
+	}
+}
+
+bool UCompushadyBrickedVolume::IsReadyForFinishDestroy()
+{
+	if (!Super::IsReadyForFinishDestroy())
+	{
+		return false;
+	}
+
+	return !Streamer || DestroyFence.IsFenceComplete();
+}
+
+void UCompushadyBrickedVolume::Tick(float DeltaTime)
+{
+	ENQUEUE_RENDER_COMMAND(DoCompushadyBrickedVolumePoll)(
+		[CurrentStreamer = Streamer](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentStreamer->PollReadbacks_RenderThread();
+		});
+}
+
+TStatId UCompushadyBrickedVolume::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCompushadyBrickedVolume, STATGROUP_Tickables);
+}
+
+bool UCompushadyBrickedVolume::IsTickable() const
+{
+	return Streamer.IsValid() && Streamer->NumReadbacks.load() > 0 && !HasAnyFlags(RF_BeginDestroyed);
+}
@@ -0,0 +1,641 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyCompileWorker.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace Compushady
+{
+	namespace CompileWorker
+	{
+		static const uint32 Magic = 0x57435343; // CSCW
+		static const TCHAR* JobFilename = TEXT("Job.in");
+		static const TCHAR* ResultFilename = TEXT("Job.out");
+		static const TCHAR* QuitFilename = TEXT("Quit");
+		// granularity of the checks for dead processes while waiting on the semaphores
+		static const uint64 WaitSliceNanoseconds = 50 * 1000 * 1000;
+
+		static TSharedPtr<FCompushadyCompileWorkerPool, ESPMode::ThreadSafe> GlobalPool;
+		static FCriticalSection GlobalPoolLock;
+
+		// write to a temporary file and rename it, so the other side never sees a partial file
+		static bool WriteFileAtomically(const TArray<uint8>& Data, const FString& Filename)
+		{
+			const FString TempFilename = Filename + TEXT(".tmp");
+			if (!FFileHelper::SaveArrayToFile(Data, *TempFilename))
+			{
+				return false;
+			}
+			return IFileManager::Get().Move(*Filename, *TempFilename, true, true);
+		}
+	}
+}
+
+bool Compushady::FCompushadyCompileJob::Serialize(FArchive& Ar)
+{
+	uint32 JobMagic = CompileWorker::Magic;
+	Ar << JobMagic;
+	if (JobMagic != CompileWorker::Magic)
+	{
+		Ar.SetError();
+		return false;
+	}
+
+	uint8 LanguageValue = static_cast<uint8>(Language);
+	Ar << LanguageValue;
+	Language = static_cast<ECompushadyCompileJobLanguage>(LanguageValue);
+
+	Ar << ShaderCode;
+	Ar << EntryPoint;
+	Ar << TargetProfile;
+	Ar << bSPIRV;
+	Ar << bValidate;
+
+	return !Ar.IsError();
+}
+
+bool Compushady::FCompushadyCompileJobResult::Serialize(FArchive& Ar)
+{
+	uint32 ResultMagic = CompileWorker::Magic;
+	Ar << ResultMagic;
+	if (ResultMagic != CompileWorker::Magic)
+	{
+		Ar.SetError();
+		return false;
+	}
+
+	Ar << bSuccess;
+	Ar << ByteCode;
+	Ar << ErrorMessages;
+
+	return !Ar.IsError();
+}
+
+Compushady::FCompushadyCompileWorkerPool::FCompushadyCompileWorkerPool(const FCompushadyCompileWorkerConfig& InConfig) : Config(InConfig)
+{
+	const int32 NumWorkers = Config.NumWorkers > 0 ? Config.NumWorkers : FMath::Max(1, FPlatformMisc::NumberOfCores() - 1);
+
+	PoolDirectory = FPaths::ConvertRelativePathToFull(FPaths::Combine(FPaths::ProjectIntermediateDir(), TEXT("CompushadyCompileWorker"), FGuid::NewGuid().ToString()));
+
+	// workers are lazily launched on their first job
+	Workers.AddDefaulted(NumWorkers);
+	for (int32 WorkerIndex = 0; WorkerIndex < NumWorkers; WorkerIndex++)
+	{
+		Workers[WorkerIndex].JobDirectory = FPaths::Combine(PoolDirectory, FString::Printf(TEXT("Worker%d"), WorkerIndex));
+	}
+
+	WorkerReleasedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+Compushady::FCompushadyCompileWorkerPool::~FCompushadyCompileWorkerPool()
+{
+	// the launching threads stop waiting for their workers
+	bShuttingDown = true;
+	while (NumLaunching > 0)
+	{
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	for (FWorker& Worker : Workers)
+	{
+		KillWorker(Worker);
+	}
+
+	IFileManager::Get().DeleteDirectory(*PoolDirectory, false, true);
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkerReleasedEvent);
+}
+
+int32 Compushady::FCompushadyCompileWorkerPool::AcquireWorker()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	int32 LaunchedWorkerIndex = INDEX_NONE;
+
+	for (;;)
+	{
+		{
+			FScopeLock Lock(&WorkersLock);
+			int32 IdleWorkerIndex = INDEX_NONE;
+			bool bAnyWorkerAvailable = false;
+			for (int32 WorkerIndex = 0; WorkerIndex < Workers.Num(); WorkerIndex++)
+			{
+				FWorker& Worker = Workers[WorkerIndex];
+				if (Worker.bBusy || Worker.bLaunching)
+				{
+					bAnyWorkerAvailable = true;
+					continue;
+				}
+
+				if (IsWorkerAlive(Worker))
+				{
+					Worker.bBusy = true;
+					return WorkerIndex;
+				}
+
+				if (IdleWorkerIndex == INDEX_NONE)
+				{
+					IdleWorkerIndex = WorkerIndex;
+				}
+			}
+
+			// every caller launches at most one worker
+			if (LaunchedWorkerIndex == INDEX_NONE && IdleWorkerIndex != INDEX_NONE)
+			{
+				LaunchedWorkerIndex = IdleWorkerIndex;
+				LaunchWorkerAsync(IdleWorkerIndex);
+				bAnyWorkerAvailable = true;
+			}
+
+			// the launched worker failed and nothing else can become ready
+			if (!bAnyWorkerAvailable)
+			{
+				return INDEX_NONE;
+			}
+		}
+
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+		if (Elapsed >= Config.AcquireTimeoutSeconds)
+		{
+			UE_LOG(LogCompushady, Warning, TEXT("No compile worker ready after %.1f seconds"), Config.AcquireTimeoutSeconds);
+			return INDEX_NONE;
+		}
+
+		WorkerReleasedEvent->Wait(FMath::Clamp(static_cast<uint32>((Config.AcquireTimeoutSeconds - Elapsed) * 1000), 1u, 100u));
+	}
+}
+
+void Compushady::FCompushadyCompileWorkerPool::LaunchWorkerAsync(const int32 WorkerIndex)
+{
+	Workers[WorkerIndex].bLaunching = true;
+	Workers[WorkerIndex].bLaunchFailed = false;
+	NumLaunching++;
+
+	// the startup wait can be long, so it runs on its own thread instead of the caller (or the thread pool)
+	Async(EAsyncExecution::Thread, [this, WorkerIndex]()
+		{
+			const bool bLaunched = LaunchWorker(WorkerIndex);
+			{
+				FScopeLock Lock(&WorkersLock);
+				Workers[WorkerIndex].bLaunching = false;
+				Workers[WorkerIndex].bLaunchFailed = !bLaunched;
+			}
+			WorkerReleasedEvent->Trigger();
+			NumLaunching--;
+		});
+}
+
+void Compushady::FCompushadyCompileWorkerPool::LaunchWorkers()
+{
+	FScopeLock Lock(&WorkersLock);
+	for (int32 WorkerIndex = 0; WorkerIndex < Workers.Num(); WorkerIndex++)
+	{
+		FWorker& Worker = Workers[WorkerIndex];
+		if (!Worker.bBusy && !Worker.bLaunching && !IsWorkerAlive(Worker))
+		{
+			LaunchWorkerAsync(WorkerIndex);
+		}
+	}
+}
+
+int32 Compushady::FCompushadyCompileWorkerPool::GetNumReadyWorkers()
+{
+	FScopeLock Lock(&WorkersLock);
+	int32 NumReadyWorkers = 0;
+	for (FWorker& Worker : Workers)
+	{
+		if (!Worker.bBusy && !Worker.bLaunching && IsWorkerAlive(Worker))
+		{
+			NumReadyWorkers++;
+		}
+	}
+	return NumReadyWorkers;
+}
+
+void Compushady::FCompushadyCompileWorkerPool::ReleaseWorker(const int32 WorkerIndex)
+{
+	{
+		FScopeLock Lock(&WorkersLock);
+		Workers[WorkerIndex].bBusy = false;
+	}
+	WorkerReleasedEvent->Trigger();
+}
+
+bool Compushady::FCompushadyCompileWorkerPool::IsWorkerAlive(FWorker& Worker)
+{
+	return Worker.ProcHandle.IsValid() && FPlatformProcess::IsProcRunning(Worker.ProcHandle);
+}
+
+bool Compushady::FCompushadyCompileWorkerPool::WaitForWorker(FWorker& Worker, const double TimeoutSeconds)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	while (!Worker.ResultSemaphore->TryLock(CompileWorker::WaitSliceNanoseconds))
+	{
+		if (bShuttingDown || !FPlatformProcess::IsProcRunning(Worker.ProcHandle) || FPlatformTime::Seconds() - StartTime > TimeoutSeconds)
+		{
+			// the worker could have signaled just before exiting
+			return Worker.ResultSemaphore->TryLock(0);
+		}
+	}
+	return true;
+}
+
+bool Compushady::FCompushadyCompileWorkerPool::LaunchWorker(const int32 WorkerIndex)
+{
+	FWorker& Worker = Workers[WorkerIndex];
+
+	KillWorker(Worker);
+
+	if (Config.Executable.IsEmpty() && !CompileWorker::CanRunCommandlet())
+	{
+		return false;
+	}
+
+	if (!IFileManager::Get().MakeDirectory(*Worker.JobDirectory, true))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Unable to create compile worker directory %s"), *Worker.JobDirectory);
+		return false;
+	}
+
+	FString Executable = Config.Executable;
+	FString Arguments;
+
+	if (Executable.IsEmpty())
+	{
+		Executable = FPlatformProcess::ExecutablePath();
+		if (FPaths::IsProjectFilePathSet())
+		{
+			Arguments = FString::Printf(TEXT("\"%s\" "), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()));
+		}
+		Arguments += TEXT("-run=CompushadyCompileWorker -nullrhi -nosplash -nosound -unattended -nopause -stdout ");
+	}
+
+	// semaphores are created with their only lock available, so take it immediately
+	const FString SemaphoreName = FString::Printf(TEXT("CSCW%u_%d_%d"), FPlatformProcess::GetCurrentProcessId(), WorkerIndex, Worker.NumLaunches++);
+	Worker.JobSemaphore = FPlatformProcess::NewInterprocessSynchObject(SemaphoreName + TEXT("J"), true);
+	Worker.ResultSemaphore = FPlatformProcess::NewInterprocessSynchObject(SemaphoreName + TEXT("R"), true);
+	if (!Worker.JobSemaphore || !Worker.ResultSemaphore)
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Unable to create compile worker semaphores"));
+		KillWorker(Worker);
+		return false;
+	}
+	Worker.JobSemaphore->Lock();
+	Worker.ResultSemaphore->Lock();
+
+	Arguments += FString::Printf(TEXT("-JobDir=\"%s\" -Semaphore=%s -ParentPID=%u %s"), *Worker.JobDirectory, *SemaphoreName, FPlatformProcess::GetCurrentProcessId(), *Config.ExtraArguments);
+
+	Worker.ProcHandle = FPlatformProcess::CreateProc(*Executable, *Arguments, false, true, true, nullptr, -1, nullptr, nullptr, nullptr);
+	if (!Worker.ProcHandle.IsValid())
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Unable to launch compile worker %s"), *Executable);
+		KillWorker(Worker);
+		return false;
+	}
+
+	NumLaunchedProcesses++;
+
+	// the first signal of the worker is its readiness
+	if (!WaitForWorker(Worker, Config.StartupTimeoutSeconds))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Compile worker %d failed to start"), WorkerIndex);
+		KillWorker(Worker);
+		return false;
+	}
+
+	Worker.CompletedJobs = 0;
+
+	return true;
+}
+
+void Compushady::FCompushadyCompileWorkerPool::KillWorker(FWorker& Worker)
+{
+	if (Worker.ProcHandle.IsValid())
+	{
+		if (FPlatformProcess::IsProcRunning(Worker.ProcHandle))
+		{
+			// give the worker a chance to exit gracefully
+			TArray<uint8> Empty;
+			CompileWorker::WriteFileAtomically(Empty, FPaths::Combine(Worker.JobDirectory, CompileWorker::QuitFilename));
+			Worker.JobSemaphore->Unlock();
+
+			const double StartTime = FPlatformTime::Seconds();
+			while (FPlatformProcess::IsProcRunning(Worker.ProcHandle) && FPlatformTime::Seconds() - StartTime < 1.0)
+			{
+				FPlatformProcess::Sleep(0.01f);
+			}
+
+			if (FPlatformProcess::IsProcRunning(Worker.ProcHandle))
+			{
+				FPlatformProcess::TerminateProc(Worker.ProcHandle, true);
+			}
+		}
+		FPlatformProcess::CloseProc(Worker.ProcHandle);
+		Worker.ProcHandle.Reset();
+	}
+
+	for (FPlatformProcess::FSemaphore** Semaphore : { &Worker.JobSemaphore, &Worker.ResultSemaphore })
+	{
+		if (*Semaphore)
+		{
+			FPlatformProcess::DeleteInterprocessSynchObject(*Semaphore);
+			*Semaphore = nullptr;
+		}
+	}
+
+	IFileManager::Get().DeleteDirectory(*Worker.JobDirectory, false, true);
+}
+
+Compushady::ECompushadyCompileWorkerStatus Compushady::FCompushadyCompileWorkerPool::Compile(const FCompushadyCompileJob& Job, FCompushadyCompileJobResult& Result)
+{
+	const int32 WorkerIndex = AcquireWorker();
+	if (WorkerIndex == INDEX_NONE)
+	{
+		return ECompushadyCompileWorkerStatus::Unavailable;
+	}
+
+	// the Workers array is never resized after construction, so the reference is stable
+	FWorker& Worker = Workers[WorkerIndex];
+
+	const FString JobPath = FPaths::Combine(Worker.JobDirectory, CompileWorker::JobFilename);
+	const FString ResultPath = FPaths::Combine(Worker.JobDirectory, CompileWorker::ResultFilename);
+
+	FCompushadyCompileJob JobToSend = Job;
+	TArray<uint8> JobData;
+	FMemoryWriter Writer(JobData);
+	JobToSend.Serialize(Writer);
+
+	if (!CompileWorker::WriteFileAtomically(JobData, JobPath))
+	{
+		KillWorker(Worker);
+		ReleaseWorker(WorkerIndex);
+		return ECompushadyCompileWorkerStatus::Unavailable;
+	}
+
+	Worker.JobSemaphore->Unlock();
+
+	if (!WaitForWorker(Worker, Config.TimeoutSeconds))
+	{
+		const bool bCrashed = !FPlatformProcess::IsProcRunning(Worker.ProcHandle);
+		UE_LOG(LogCompushady, Error, TEXT("Compile worker %d %s"), WorkerIndex, bCrashed ? TEXT("crashed") : TEXT("timed out"));
+		KillWorker(Worker);
+		ReleaseWorker(WorkerIndex);
+		return bCrashed ? ECompushadyCompileWorkerStatus::Crashed : ECompushadyCompileWorkerStatus::TimedOut;
+	}
+
+	TArray<uint8> ResultData;
+	const bool bLoaded = FFileHelper::LoadFileToArray(ResultData, *ResultPath, FILEREAD_Silent);
+	IFileManager::Get().Delete(*ResultPath, false, true, true);
+
+	FMemoryReader Reader(ResultData);
+	if (!bLoaded || !Result.Serialize(Reader))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Compile worker %d returned a corrupted result"), WorkerIndex);
+		KillWorker(Worker);
+		ReleaseWorker(WorkerIndex);
+		return ECompushadyCompileWorkerStatus::Crashed;
+	}
+
+	Worker.CompletedJobs++;
+	if (Config.MaxJobsPerWorker > 0 && Worker.CompletedJobs >= Config.MaxJobsPerWorker)
+	{
+		KillWorker(Worker);
+	}
+
+	ReleaseWorker(WorkerIndex);
+
+	return ECompushadyCompileWorkerStatus::Completed;
+}
+
+bool Compushady::FCompushadyCompileWorkerPool::CompileWithFallback(const FCompushadyCompileJob& Job, TArray<uint8>& ByteCode, FString& ErrorMessages)
+{
+	FCompushadyCompileJobResult Result;
+
+	switch (Compile(Job, Result))
+	{
+	case ECompushadyCompileWorkerStatus::Completed:
+		ByteCode.Append(Result.ByteCode);
+		ErrorMessages = Result.ErrorMessages;
+		return Result.bSuccess;
+	case ECompushadyCompileWorkerStatus::Crashed:
+		ErrorMessages = "The shader compile worker crashed";
+		return false;
+	case ECompushadyCompileWorkerStatus::TimedOut:
+		ErrorMessages = FString::Printf(TEXT("The shader compile worker timed out after %.1f seconds"), Config.TimeoutSeconds);
+		return false;
+	case ECompushadyCompileWorkerStatus::Unavailable:
+	default:
+		break;
+	}
+
+	if (!Config.bFallbackToInProcess)
+	{
+		ErrorMessages = "No shader compile worker available";
+		return false;
+	}
+
+	UE_LOG(LogCompushady, Warning, TEXT("No shader compile worker available, falling back to in-process compilation"));
+	Result = FCompushadyCompileJobResult();
+
+	if (!CompileWorker::ExecuteJob(Job, Result))
+	{
+		ErrorMessages = Result.ErrorMessages;
+		return false;
+	}
+
+	ByteCode.Append(Result.ByteCode);
+	return true;
+}
+
+bool Compushady::CompileWorker::Enable(const FCompushadyCompileWorkerConfig& Config, FString& ErrorMessages)
+{
+	if (Config.Executable.IsEmpty() && !CanRunCommandlet())
+	{
+		ErrorMessages = "A standalone compile worker Executable is required in cooked and Shipping builds";
+		return false;
+	}
+
+	if (!Config.Executable.IsEmpty() && !FPaths::FileExists(Config.Executable))
+	{
+		ErrorMessages = FString::Printf(TEXT("Compile worker Executable %s not found"), *Config.Executable);
+		return false;
+	}
+
+	TSharedPtr<FCompushadyCompileWorkerPool, ESPMode::ThreadSafe> NewPool = MakeShared<FCompushadyCompileWorkerPool, ESPMode::ThreadSafe>(Config);
+	NewPool->LaunchWorkers();
+
+	FScopeLock Lock(&GlobalPoolLock);
+	GlobalPool = NewPool;
+	return true;
+}
+
+void Compushady::CompileWorker::Disable()
+{
+	TSharedPtr<FCompushadyCompileWorkerPool, ESPMode::ThreadSafe> OldPool;
+	{
+		FScopeLock Lock(&GlobalPoolLock);
+		OldPool = MoveTemp(GlobalPool);
+	}
+	// the pool (and its processes) is destroyed once the running jobs release it
+}
+
+bool Compushady::CompileWorker::IsEnabled()
+{
+	FScopeLock Lock(&GlobalPoolLock);
+	return GlobalPool.IsValid();
+}
+
+bool Compushady::CompileWorker::Compile(const FCompushadyCompileJob& Job, TArray<uint8>& ByteCode, FString& ErrorMessages)
+{
+	TSharedPtr<FCompushadyCompileWorkerPool, ESPMode::ThreadSafe> Pool;
+	{
+		FScopeLock Lock(&GlobalPoolLock);
+		Pool = GlobalPool;
+	}
+
+	if (!Pool)
+	{
+		FCompushadyCompileJobResult Result;
+		const bool bSuccess = ExecuteJob(Job, Result);
+		ByteCode.Append(Result.ByteCode);
+		ErrorMessages = Result.ErrorMessages;
+		return bSuccess;
+	}
+
+	return Pool->CompileWithFallback(Job, ByteCode, ErrorMessages);
+}
+
+bool Compushady::CompileWorker::ExecuteJob(const FCompushadyCompileJob& Job, FCompushadyCompileJobResult& Result)
+{
+	if (Job.Language == ECompushadyCompileJobLanguage::GLSL)
+	{
+		Result.bSuccess = CompileGLSLInProcess(Job.ShaderCode, Job.EntryPoint, Job.TargetProfile, Result.ByteCode, Result.ErrorMessages);
+	}
+	else
+	{
+		Result.bSuccess = CompileHLSLInProcess(Job.ShaderCode, Job.EntryPoint, Job.TargetProfile, Result.ByteCode, Result.ErrorMessages, Job.bSPIRV, Job.bValidate);
+	}
+	return Result.bSuccess;
+}
+
+bool Compushady::CompileWorker::CanRunCommandlet()
+{
+#if WITH_EDITOR
+	return !FPlatformProperties::RequiresCookedData();
+#else
+	return false;
+#endif
+}
+
+UCompushadyCompileWorkerCommandlet::UCompushadyCompileWorkerCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UCompushadyCompileWorkerCommandlet::Main(const FString& Params)
+{
+	FString JobDirectory;
+	if (!FParse::Value(*Params, TEXT("JobDir="), JobDirectory))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Missing -JobDir argument"));
+		return -1;
+	}
+
+	FString SemaphoreName;
+	if (!FParse::Value(*Params, TEXT("Semaphore="), SemaphoreName))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Missing -Semaphore argument"));
+		return -1;
+	}
+
+	uint32 ParentPID = 0;
+	FParse::Value(*Params, TEXT("ParentPID="), ParentPID);
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// used by the tests for simulating a misbehaving compiler
+	const bool bSimulateCrash = FParse::Param(*Params, TEXT("SimulateCrash"));
+	const bool bSimulateHang = FParse::Param(*Params, TEXT("SimulateHang"));
+#endif
+
+	FPlatformProcess::FSemaphore* JobSemaphore = FPlatformProcess::NewInterprocessSynchObject(SemaphoreName + TEXT("J"), false);
+	FPlatformProcess::FSemaphore* ResultSemaphore = FPlatformProcess::NewInterprocessSynchObject(SemaphoreName + TEXT("R"), false);
+	if (!JobSemaphore || !ResultSemaphore)
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Unable to open semaphore %s"), *SemaphoreName);
+		return -1;
+	}
+
+	const FString JobPath = FPaths::Combine(JobDirectory, Compushady::CompileWorker::JobFilename);
+	const FString ResultPath = FPaths::Combine(JobDirectory, Compushady::CompileWorker::ResultFilename);
+	const FString QuitPath = FPaths::Combine(JobDirectory, Compushady::CompileWorker::QuitFilename);
+
+	// ready
+	ResultSemaphore->Unlock();
+
+	for (;;)
+	{
+		if (!JobSemaphore->TryLock(Compushady::CompileWorker::WaitSliceNanoseconds))
+		{
+			if (ParentPID > 0 && !FPlatformProcess::IsApplicationRunning(ParentPID))
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (IFileManager::Get().FileExists(*QuitPath))
+		{
+			break;
+		}
+
+		TArray<uint8> JobData;
+		const bool bLoaded = FFileHelper::LoadFileToArray(JobData, *JobPath, FILEREAD_Silent);
+		IFileManager::Get().Delete(*JobPath, false, true, true);
+
+#if WITH_DEV_AUTOMATION_TESTS
+		if (bSimulateCrash)
+		{
+			FPlatformMisc::RequestExitWithStatus(true, 3);
+		}
+
+		if (bSimulateHang)
+		{
+			for (;;)
+			{
+				FPlatformProcess::Sleep(1);
+			}
+		}
+#endif
+
+		Compushady::FCompushadyCompileJob Job;
+		Compushady::FCompushadyCompileJobResult Result;
+
+		FMemoryReader Reader(JobData);
+		if (!bLoaded || !Job.Serialize(Reader))
+		{
+			Result.ErrorMessages = "Invalid compile job";
+		}
+		else
+		{
+			Compushady::CompileWorker::ExecuteJob(Job, Result);
+		}
+
+		TArray<uint8> ResultData;
+		FMemoryWriter Writer(ResultData);
+		Result.Serialize(Writer);
+
+		Compushady::CompileWorker::WriteFileAtomically(ResultData, ResultPath);
+		ResultSemaphore->Unlock();
+	}
+
+	FPlatformProcess::DeleteInterprocessSynchObject(JobSemaphore);
+	FPlatformProcess::DeleteInterprocessSynchObject(ResultSemaphore);
+
+	return 0;
+}
\ No newline at end of file
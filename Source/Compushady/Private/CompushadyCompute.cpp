@@ -5,10 +5,10 @@
 #include "Compushady.h"
 #include "Serialization/ArrayWriter.h"
 
-bool UCompushadyCompute::InitFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FString& ErrorMessages)
+bool UCompushadyCompute::InitFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FString& ErrorMessages, const FString& TargetProfile)
 {
 	FRenderQueryRHIRef Query = RHICreateRenderQuery(ERenderQueryType::RQT_AbsoluteTime);
-	ComputeShaderRef = Compushady::Utils::CreateComputeShaderFromHLSL(ShaderCode, EntryPoint, ResourceBindings, ThreadGroupSize, ErrorMessages);
+	ComputeShaderRef = Compushady::Utils::CreateComputeShaderFromHLSL(ShaderCode, EntryPoint, ResourceBindings, ThreadGroupSize, ErrorMessages, TargetProfile);
 	return ComputeShaderRef != nullptr;
 }
 
@@ -1,6 +1,7 @@
 // Copyright 2023 - Roberto De Ioris.
 
 #include "Compushady.h"
+#include "CompushadyCompileWorker.h"
 
 #if PLATFORM_WINDOWS
 #include "Windows/WindowsHWrapper.h"
@@ -290,9 +291,8 @@ bool Compushady::DisassembleDXIL(const TArray<uint8>& ByteCode, FString& Disasse
 	return true;
 }
 
-bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, TArray<uint8>& ByteCode, FString& ErrorMessages, const bool bForceSPIRV)
+static bool ValidateCompileArguments(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, FString& ErrorMessages)
 {
-
 	if (ShaderCode.Num() == 0)
 	{
 		ErrorMessages = "Empty ShaderCode";
@@ -311,6 +311,70 @@ bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& Ent
 		return false;
 	}
 
+	return true;
+}
+
+// ray tracing libraries and inline ray queries (Shader Model 6.5) require the SPV_KHR_ray_query/SPV_KHR_ray_tracing extensions
+static bool RequiresVulkan12(const FString& TargetProfile)
+{
+	if (TargetProfile.StartsWith("lib_"))
+	{
+		return true;
+	}
+
+	// mesh shaders keep the default environment
+	if (TargetProfile.StartsWith("ms_") || TargetProfile.StartsWith("as_"))
+	{
+		return false;
+	}
+
+	TArray<FString> Parts;
+	TargetProfile.ParseIntoArray(Parts, TEXT("_"));
+	if (Parts.Num() != 3)
+	{
+		return false;
+	}
+
+	const int32 Major = FCString::Atoi(*Parts[1]);
+	const int32 Minor = FCString::Atoi(*Parts[2]);
+
+	return Major > 6 || (Major == 6 && Minor >= 5);
+}
+
+bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, TArray<uint8>& ByteCode, FString& ErrorMessages, const bool bForceSPIRV)
+{
+	if (!ValidateCompileArguments(ShaderCode, EntryPoint, TargetProfile, ErrorMessages))
+	{
+		return false;
+	}
+
+	const ERHIInterfaceType RHIInterfaceType = RHIGetInterfaceType();
+	const bool bSPIRV = RHIInterfaceType == ERHIInterfaceType::Vulkan || RHIInterfaceType == ERHIInterfaceType::Metal || bForceSPIRV;
+	// decided here, as the workers run with the null RHI
+	const bool bValidate = RHIInterfaceType == ERHIInterfaceType::D3D12 && !bForceSPIRV;
+
+	if (CompileWorker::IsEnabled())
+	{
+		FCompushadyCompileJob Job;
+		Job.Language = ECompushadyCompileJobLanguage::HLSL;
+		Job.ShaderCode = ShaderCode;
+		Job.EntryPoint = EntryPoint;
+		Job.TargetProfile = TargetProfile;
+		Job.bSPIRV = bSPIRV;
+		Job.bValidate = bValidate;
+		return CompileWorker::Compile(Job, ByteCode, ErrorMessages);
+	}
+
+	return CompileHLSLInProcess(ShaderCode, EntryPoint, TargetProfile, ByteCode, ErrorMessages, bSPIRV, bValidate);
+}
+
+bool Compushady::CompileHLSLInProcess(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, TArray<uint8>& ByteCode, FString& ErrorMessages, const bool bSPIRV, const bool bValidate)
+{
+	if (!ValidateCompileArguments(ShaderCode, EntryPoint, TargetProfile, ErrorMessages))
+	{
+		return false;
+	}
+
 	if (!DXC::Setup())
 	{
 		ErrorMessages = "Failed DXCompiler initialization";
@@ -328,8 +392,6 @@ bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& Ent
 		return false;
 	}
 
-	ERHIInterfaceType RHIInterfaceType = RHIGetInterfaceType();
-
 	TArray<LPCWSTR> Arguments;
 
 	FTCHARToWChar WideTargetProfile(*TargetProfile);
@@ -342,14 +404,14 @@ bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& Ent
 	Arguments.Add(WideEntryPoint.Get());
 
 	// compile to spirv
-	if (RHIInterfaceType == ERHIInterfaceType::Vulkan || RHIInterfaceType == ERHIInterfaceType::Metal || bForceSPIRV)
+	if (bSPIRV)
 	{
 		Arguments.Add(L"-spirv");
 		Arguments.Add(L"-fvk-use-dx-layout");
 		Arguments.Add(L"-fvk-use-scalar-layout");
 		Arguments.Add(L"-fspv-entrypoint-name=main_00000000_00000000");
 		Arguments.Add(L"-fspv-reflect");
-		if (TargetProfile.StartsWith("lib_"))
+		if (RequiresVulkan12(TargetProfile))
 		{
 			Arguments.Add(L"-fspv-target-env=vulkan1.2");
 		}
@@ -428,7 +490,7 @@ bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& Ent
 	CompileResult->Release();
 
 	// validate the shader
-	if (RHIInterfaceType == ERHIInterfaceType::D3D12 && !bForceSPIRV)
+	if (bValidate)
 	{
 #if PLATFORM_WINDOWS
 		IDxcOperationResult* VerifyResult;
@@ -450,6 +512,129 @@ bool Compushady::CompileHLSL(const TArray<uint8>& ShaderCode, const FString& Ent
 	return true;
 }
 
+#if PLATFORM_WINDOWS
+namespace Compushady
+{
+	namespace DXC
+	{
+		struct FCompushadyDXILMappings
+		{
+			TMap<uint32, FCompushadyShaderResourceBinding> CBVs;
+			TMap<uint32, FCompushadyShaderResourceBinding> SRVs;
+			TMap<uint32, FCompushadyShaderResourceBinding> UAVs;
+			TMap<uint32, FCompushadyShaderResourceBinding> Samplers;
+		};
+
+		/*
+			D3D_SIT_CBUFFER
+			D3D_SIT_TBUFFER
+			D3D_SIT_TEXTURE
+			D3D_SIT_SAMPLER
+			D3D_SIT_UAV_RWTYPED
+			D3D_SIT_STRUCTURED
+			D3D_SIT_UAV_RWSTRUCTURED
+			D3D_SIT_BYTEADDRESS
+			D3D_SIT_UAV_RWBYTEADDRESS
+			D3D_SIT_UAV_APPEND_STRUCTURED
+			D3D_SIT_UAV_CONSUME_STRUCTURED
+			D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER
+			D3D_SIT_RTACCELERATIONSTRUCTURE
+			D3D_SIT_UAV_FEEDBACKTEXTURE
+		*/
+		static bool MapResourceBinding(const D3D12_SHADER_INPUT_BIND_DESC& BindDesc, FCompushadyDXILMappings& Mappings, FString& ErrorMessages)
+		{
+			FCompushadyShaderResourceBinding ResourceBinding;
+			ResourceBinding.BindingIndex = BindDesc.BindPoint;
+			ResourceBinding.SlotIndex = ResourceBinding.BindingIndex;
+			ResourceBinding.Name = BindDesc.Name;
+
+			switch (BindDesc.Type)
+			{
+			case COMPUSHADY_D3D_SIT_CBUFFER:
+				ResourceBinding.Type = ECompushadyShaderResourceType::UniformBuffer;
+				Mappings.CBVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_TEXTURE:
+				ResourceBinding.Type = BindDesc.Dimension == D3D_SRV_DIMENSION::D3D_SRV_DIMENSION_BUFFER ? ECompushadyShaderResourceType::Buffer : ECompushadyShaderResourceType::Texture;
+				Mappings.SRVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_SAMPLER:
+				ResourceBinding.Type = ECompushadyShaderResourceType::Sampler;
+				Mappings.Samplers.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_BYTEADDRESS:
+				ResourceBinding.Type = ECompushadyShaderResourceType::ByteAddressBuffer;
+				Mappings.SRVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_STRUCTURED:
+				ResourceBinding.Type = ECompushadyShaderResourceType::StructuredBuffer;
+				Mappings.SRVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_TBUFFER:
+				ResourceBinding.Type = ECompushadyShaderResourceType::Buffer;
+				Mappings.SRVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_RTACCELERATIONSTRUCTURE:
+				ResourceBinding.Type = ECompushadyShaderResourceType::RayTracingAccelerationStructure;
+				Mappings.SRVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_UAV_RWTYPED:
+				ResourceBinding.Type = BindDesc.Dimension == D3D_SRV_DIMENSION::D3D_SRV_DIMENSION_BUFFER ? ECompushadyShaderResourceType::Buffer : ECompushadyShaderResourceType::Texture;
+				Mappings.UAVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_UAV_FEEDBACKTEXTURE:
+				ResourceBinding.Type = ECompushadyShaderResourceType::Texture;
+				Mappings.UAVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_UAV_RWSTRUCTURED:
+			case COMPUSHADY_D3D_SIT_UAV_APPEND_STRUCTURED:
+			case COMPUSHADY_D3D_SIT_UAV_CONSUME_STRUCTURED:
+			case COMPUSHADY_D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+				ResourceBinding.Type = ECompushadyShaderResourceType::StructuredBuffer;
+				Mappings.UAVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			case COMPUSHADY_D3D_SIT_UAV_RWBYTEADDRESS:
+				ResourceBinding.Type = ECompushadyShaderResourceType::ByteAddressBuffer;
+				Mappings.UAVs.Add(BindDesc.BindPoint, ResourceBinding);
+				break;
+			default:
+				ErrorMessages = FString::Printf(TEXT("Unsupported resource type for %s"), UTF8_TO_TCHAR(BindDesc.Name));
+				return false;
+			}
+
+			return true;
+		}
+
+		// prepends the Unreal resource table and sorts the resources by binding point
+		static void FinalizeBindings(TArray<uint8>& ByteCode, const FCompushadyDXILMappings& Mappings, FCompushadyShaderResourceBindings& ShaderResourceBindings)
+		{
+			FShaderResourceTable ShaderResourceTable;
+			FArrayWriter Writer;
+			Writer << ShaderResourceTable;
+
+			ByteCode.Insert(Writer, 0);
+
+			auto AddSorted = [](const TMap<uint32, FCompushadyShaderResourceBinding>& Mapping, TArray<FCompushadyShaderResourceBinding>& Bindings)
+				{
+					TArray<uint32> Keys;
+					Mapping.GetKeys(Keys);
+					Keys.Sort();
+
+					for (uint32 Key : Keys)
+					{
+						Bindings.Add(Mapping[Key]);
+					}
+				};
+
+			AddSorted(Mappings.CBVs, ShaderResourceBindings.CBVs);
+			AddSorted(Mappings.SRVs, ShaderResourceBindings.SRVs);
+			AddSorted(Mappings.UAVs, ShaderResourceBindings.UAVs);
+			AddSorted(Mappings.Samplers, ShaderResourceBindings.Samplers);
+		}
+	}
+}
+#endif
+
 bool Compushady::FixupDXIL(TArray<uint8>& ByteCode, FCompushadyShaderResourceBindings& ShaderResourceBindings, FIntVector& ThreadGroupSize, FString& ErrorMessages)
 {
 	if (!DXC::Setup())
@@ -459,10 +644,7 @@ bool Compushady::FixupDXIL(TArray<uint8>& ByteCode, FCompushadyShaderResourceBin
 	}
 
 #if PLATFORM_WINDOWS
-	TMap<uint32, FCompushadyShaderResourceBinding> CBVMapping;
-	TMap<uint32, FCompushadyShaderResourceBinding> SRVMapping;
-	TMap<uint32, FCompushadyShaderResourceBinding> UAVMapping;
-	TMap<uint32, FCompushadyShaderResourceBinding> SamplerMapping;
+	DXC::FCompushadyDXILMappings Mappings;
 
 	ID3D12ShaderReflection* ShaderReflection;
 
@@ -501,84 +683,13 @@ bool Compushady::FixupDXIL(TArray<uint8>& ByteCode, FCompushadyShaderResourceBin
 		}
 	}
 
-	/*
-		D3D_SIT_CBUFFER
-		D3D_SIT_TBUFFER
-		D3D_SIT_TEXTURE
-		D3D_SIT_SAMPLER
-		D3D_SIT_UAV_RWTYPED
-		D3D_SIT_STRUCTURED
-		D3D_SIT_UAV_RWSTRUCTURED
-		D3D_SIT_BYTEADDRESS
-		D3D_SIT_UAV_RWBYTEADDRESS
-		D3D_SIT_UAV_APPEND_STRUCTURED
-		D3D_SIT_UAV_CONSUME_STRUCTURED
-		D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER
-		D3D_SIT_RTACCELERATIONSTRUCTURE
-		D3D_SIT_UAV_FEEDBACKTEXTURE
-	*/
-
 	for (uint32 Index = 0; Index < ShaderDesc.BoundResources; Index++)
 	{
 		D3D12_SHADER_INPUT_BIND_DESC BindDesc;
 		ShaderReflection->GetResourceBindingDesc(Index, &BindDesc);
 
-		FCompushadyShaderResourceBinding ResourceBinding;
-		ResourceBinding.BindingIndex = BindDesc.BindPoint;
-		ResourceBinding.SlotIndex = ResourceBinding.BindingIndex;
-		ResourceBinding.Name = BindDesc.Name;
-
-		switch (BindDesc.Type)
+		if (!DXC::MapResourceBinding(BindDesc, Mappings, ErrorMessages))
 		{
-		case COMPUSHADY_D3D_SIT_CBUFFER:
-			ResourceBinding.Type = ECompushadyShaderResourceType::UniformBuffer;
-			CBVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_TEXTURE:
-			ResourceBinding.Type = BindDesc.Dimension == D3D_SRV_DIMENSION::D3D_SRV_DIMENSION_BUFFER ? ECompushadyShaderResourceType::Buffer : ECompushadyShaderResourceType::Texture;
-			SRVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_SAMPLER:
-			ResourceBinding.Type = ECompushadyShaderResourceType::Sampler;
-			SamplerMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_BYTEADDRESS:
-			ResourceBinding.Type = ECompushadyShaderResourceType::ByteAddressBuffer;
-			SRVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_STRUCTURED:
-			ResourceBinding.Type = ECompushadyShaderResourceType::StructuredBuffer;
-			SRVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_TBUFFER:
-			ResourceBinding.Type = ECompushadyShaderResourceType::Buffer;
-			SRVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_RTACCELERATIONSTRUCTURE:
-			ResourceBinding.Type = ECompushadyShaderResourceType::RayTracingAccelerationStructure;
-			SRVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_UAV_RWTYPED:
-			ResourceBinding.Type = BindDesc.Dimension == D3D_SRV_DIMENSION::D3D_SRV_DIMENSION_BUFFER ? ECompushadyShaderResourceType::Buffer : ECompushadyShaderResourceType::Texture;
-			UAVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_UAV_FEEDBACKTEXTURE:
-			ResourceBinding.Type = ECompushadyShaderResourceType::Texture;
-			UAVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_UAV_RWSTRUCTURED:
-		case COMPUSHADY_D3D_SIT_UAV_APPEND_STRUCTURED:
-		case COMPUSHADY_D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case COMPUSHADY_D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-			ResourceBinding.Type = ECompushadyShaderResourceType::StructuredBuffer;
-			UAVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		case COMPUSHADY_D3D_SIT_UAV_RWBYTEADDRESS:
-			ResourceBinding.Type = ECompushadyShaderResourceType::ByteAddressBuffer;
-			UAVMapping.Add(BindDesc.BindPoint, ResourceBinding);
-			break;
-		default:
-			ErrorMessages = FString::Printf(TEXT("Unsupported resource type for %s"), UTF8_TO_TCHAR(BindDesc.Name));
 			ShaderReflection->Release();
 			return false;
 		}
@@ -590,49 +701,83 @@ bool Compushady::FixupDXIL(TArray<uint8>& ByteCode, FCompushadyShaderResourceBin
 
 	ShaderReflection->Release();
 
-	FShaderResourceTable ShaderResourceTable;
-	FArrayWriter Writer;
-	Writer << ShaderResourceTable;
-
-	ByteCode.Insert(Writer, 0);
-
-	// sort resources
-	TArray<uint32> CBVKeys;
-	CBVMapping.GetKeys(CBVKeys);
-	CBVKeys.Sort();
+	DXC::FinalizeBindings(ByteCode, Mappings, ShaderResourceBindings);
+#endif
+	return true;
+}
 
-	for (uint32 CBVIndex : CBVKeys)
+bool Compushady::FixupDXILLibrary(TArray<uint8>& ByteCode, const FString& EntryPoint, FCompushadyShaderResourceBindings& ShaderResourceBindings, FString& ErrorMessages)
+{
+	if (!DXC::Setup())
 	{
-		ShaderResourceBindings.CBVs.Add(CBVMapping[CBVIndex]);
+		ErrorMessages = "Failed DXCompiler initialization";
+		return false;
 	}
 
-	TArray<uint32> SRVKeys;
-	SRVMapping.GetKeys(SRVKeys);
-	SRVKeys.Sort();
+#if PLATFORM_WINDOWS
+	DXC::FCompushadyDXILMappings Mappings;
+
+	ID3D12LibraryReflection* LibraryReflection;
+
+	DxcBuffer ReflectionBuffer;
+	ReflectionBuffer.Ptr = ByteCode.GetData();
+	ReflectionBuffer.Size = ByteCode.Num();
+	ReflectionBuffer.Encoding = 0;
+	HRESULT HR = DXC::Utils->CreateReflection(&ReflectionBuffer, __uuidof(ID3D12LibraryReflection), reinterpret_cast<void**>(&LibraryReflection));
 
-	for (uint32 SRVIndex : SRVKeys)
+	if (!SUCCEEDED(HR))
 	{
-		ShaderResourceBindings.SRVs.Add(SRVMapping[SRVIndex]);
+		ErrorMessages = "Unable to create library reflection";
+		return false;
 	}
 
-	TArray<uint32> UAVKeys;
-	UAVMapping.GetKeys(UAVKeys);
-	UAVKeys.Sort();
+	D3D12_LIBRARY_DESC LibraryDesc;
+	LibraryReflection->GetDesc(&LibraryDesc);
 
-	for (uint32 UAVIndex : UAVKeys)
+	// exported functions are mangled as \x01?EntryPoint@@...
+	const FString MangledPrefix = FString::Printf(TEXT("\x01?%s@"), *EntryPoint);
+
+	// function reflections are owned by the library reflection
+	ID3D12FunctionReflection* FunctionReflection = nullptr;
+	D3D12_FUNCTION_DESC FunctionDesc;
+	for (uint32 FunctionIndex = 0; FunctionIndex < LibraryDesc.FunctionCount; FunctionIndex++)
 	{
-		ShaderResourceBindings.UAVs.Add(UAVMapping[UAVIndex]);
+		ID3D12FunctionReflection* CurrentFunctionReflection = LibraryReflection->GetFunctionByIndex(FunctionIndex);
+		if (!CurrentFunctionReflection || !SUCCEEDED(CurrentFunctionReflection->GetDesc(&FunctionDesc)))
+		{
+			continue;
+		}
+
+		const FString FunctionName = UTF8_TO_TCHAR(FunctionDesc.Name);
+		if (FunctionName == EntryPoint || FunctionName.StartsWith(MangledPrefix, ESearchCase::CaseSensitive))
+		{
+			FunctionReflection = CurrentFunctionReflection;
+			break;
+		}
 	}
 
-	TArray<uint32> SamplerKeys;
-	SamplerMapping.GetKeys(SamplerKeys);
-	SamplerKeys.Sort();
+	if (!FunctionReflection)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to find function %s in the library"), *EntryPoint);
+		LibraryReflection->Release();
+		return false;
+	}
 
-	for (uint32 SamplerIndex : SamplerKeys)
+	for (uint32 Index = 0; Index < FunctionDesc.BoundResources; Index++)
 	{
-		ShaderResourceBindings.Samplers.Add(SamplerMapping[SamplerIndex]);
+		D3D12_SHADER_INPUT_BIND_DESC BindDesc;
+		FunctionReflection->GetResourceBindingDesc(Index, &BindDesc);
+
+		if (!DXC::MapResourceBinding(BindDesc, Mappings, ErrorMessages))
+		{
+			LibraryReflection->Release();
+			return false;
+		}
 	}
 
+	LibraryReflection->Release();
+
+	DXC::FinalizeBindings(ByteCode, Mappings, ShaderResourceBindings);
 #endif
 	return true;
 }
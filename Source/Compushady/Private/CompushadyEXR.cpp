@@ -0,0 +1,199 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyTypes.h"
+#include "Async/ParallelFor.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+#if COMPUSHADY_OPENEXR
+#include "CompushadyOpenEXR.h"
+#endif
+
+namespace Compushady
+{
+	namespace EXR
+	{
+		static bool GetSourceLayout(const EPixelFormat PixelFormat, int32& NumComponents, bool& bHalf)
+		{
+			switch (PixelFormat)
+			{
+			case EPixelFormat::PF_FloatRGBA:
+				NumComponents = 4;
+				bHalf = true;
+				return true;
+			case EPixelFormat::PF_A32B32G32R32F:
+				NumComponents = 4;
+				bHalf = false;
+				return true;
+			case EPixelFormat::PF_R32G32B32F:
+				NumComponents = 3;
+				bHalf = false;
+				return true;
+			case EPixelFormat::PF_G16R16F:
+			case EPixelFormat::PF_G16R16F_FILTER:
+				NumComponents = 2;
+				bHalf = true;
+				return true;
+			case EPixelFormat::PF_G32R32F:
+				NumComponents = 2;
+				bHalf = false;
+				return true;
+			case EPixelFormat::PF_R16F:
+			case EPixelFormat::PF_R16F_FILTER:
+				NumComponents = 1;
+				bHalf = true;
+				return true;
+			case EPixelFormat::PF_R32_FLOAT:
+				NumComponents = 1;
+				bHalf = false;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		/* The ImageWrapper encodes RGBA pixels as they are, with ZIP or without compression */
+		static bool GenerateWithImageWrapper(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const bool bHalf, const ECompushadyEXRCompression Compression, TArray64<uint8>& EXR, FString& ErrorMessages)
+		{
+			const int64 PackedStride = static_cast<int64>(Width) * 4 * (bHalf ? sizeof(FFloat16) : sizeof(float));
+
+			// the image wrappers expect tightly packed rows
+			TArray64<uint8> Packed;
+			const uint8* Pixels = reinterpret_cast<const uint8*>(Data);
+			if (Stride != PackedStride)
+			{
+				Packed.AddUninitialized(PackedStride * Height);
+				for (uint32 Y = 0; Y < Height; Y++)
+				{
+					FMemory::Memcpy(Packed.GetData() + Y * PackedStride, Pixels + static_cast<int64>(Y) * Stride, PackedStride);
+				}
+				Pixels = Packed.GetData();
+			}
+
+			IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+			TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
+			if (!ImageWrapper.IsValid())
+			{
+				ErrorMessages = "EXR encoding is not available on this platform";
+				return false;
+			}
+
+			if (!ImageWrapper->SetRaw(Pixels, PackedStride * Height, Width, Height, ERGBFormat::RGBAF, bHalf ? 16 : 32))
+			{
+				ErrorMessages = "Unable to encode EXR";
+				return false;
+			}
+
+			// the default quality is ZIP
+			EXR = ImageWrapper->GetCompressed(static_cast<int32>(Compression == ECompushadyEXRCompression::None ? EImageCompressionQuality::Uncompressed : EImageCompressionQuality::Default));
+			if (EXR.Num() == 0)
+			{
+				ErrorMessages = "Unable to encode EXR";
+				return false;
+			}
+			return true;
+		}
+
+#if COMPUSHADY_OPENEXR
+		/* Converts the samples to the output type, one row per task */
+		template<typename SourceType, typename DestinationType>
+		static void ConvertPixels(const uint8* Data, const int32 Stride, const uint32 Width, const uint32 Height, const int32 NumComponents, TArray64<uint8>& Converted)
+		{
+			const int64 NumSamples = static_cast<int64>(Width) * NumComponents;
+			Converted.SetNumUninitialized(NumSamples * Height * sizeof(DestinationType));
+			ParallelFor(Height, [&](const int32 Y)
+				{
+					const SourceType* Source = reinterpret_cast<const SourceType*>(Data + static_cast<int64>(Y) * Stride);
+					DestinationType* Destination = reinterpret_cast<DestinationType*>(Converted.GetData()) + Y * NumSamples;
+					for (int64 Index = 0; Index < NumSamples; Index++)
+					{
+						Destination[Index] = DestinationType(static_cast<float>(Source[Index]));
+					}
+				});
+		}
+
+		static bool GenerateWithOpenEXR(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const int32 NumComponents, const bool bHalfSource, const bool bHalf, const ECompushadyEXRCompression Compression, TArray64<uint8>& EXR, FString& ErrorMessages)
+		{
+			const uint8* Pixels = reinterpret_cast<const uint8*>(Data);
+			int64 RowStride = Stride;
+
+			// when the types match, the slices point directly to the source rows
+			TArray64<uint8> Converted;
+			if (bHalfSource != bHalf)
+			{
+				if (bHalfSource)
+				{
+					ConvertPixels<FFloat16, float>(Pixels, Stride, Width, Height, NumComponents, Converted);
+				}
+				else
+				{
+					ConvertPixels<float, FFloat16>(Pixels, Stride, Width, Height, NumComponents, Converted);
+				}
+				Pixels = Converted.GetData();
+				RowStride = static_cast<int64>(Width) * NumComponents * (bHalf ? sizeof(FFloat16) : sizeof(float));
+			}
+
+			ECompushadyOpenEXRCompression EXRCompression = ECompushadyOpenEXRCompression::None;
+			switch (Compression)
+			{
+			case ECompushadyEXRCompression::ZIPS:
+				EXRCompression = ECompushadyOpenEXRCompression::ZIPS;
+				break;
+			case ECompushadyEXRCompression::ZIP:
+				EXRCompression = ECompushadyOpenEXRCompression::ZIP;
+				break;
+			case ECompushadyEXRCompression::PIZ:
+				EXRCompression = ECompushadyOpenEXRCompression::PIZ;
+				break;
+			default:
+				break;
+			}
+
+			// one line buffer per core, the blocks are compressed in parallel only if the application configured the OpenEXR thread pool
+			return Compushady::OpenEXR::EncodeEXR(Pixels, RowStride, Width, Height, NumComponents, bHalf, EXRCompression, FPlatformMisc::NumberOfCoresIncludingHyperthreads(), EXR, ErrorMessages);
+		}
+#endif
+	}
+}
+
+bool Compushady::Utils::IsEXRPixelFormat(const EPixelFormat PixelFormat)
+{
+	int32 NumComponents;
+	bool bHalf;
+	return Compushady::EXR::GetSourceLayout(PixelFormat, NumComponents, bHalf);
+}
+
+bool Compushady::Utils::GenerateEXR(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, TArray64<uint8>& EXR, FString& ErrorMessages)
+{
+	using namespace Compushady::EXR;
+
+	int32 NumComponents = 0;
+	bool bHalfSource = false;
+	if (!GetSourceLayout(PixelFormat, NumComponents, bHalfSource))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s for EXR"), GetPixelFormatString(PixelFormat));
+		return false;
+	}
+
+	if (Width == 0 || Height == 0 || Width > MAX_int32 || Height > MAX_int32)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid EXR size %ux%u"), Width, Height);
+		return false;
+	}
+
+	const bool bHalf = PixelType == ECompushadyEXRPixelType::Half;
+
+	// direct path for PF_FloatRGBA/PF_A32B32G32R32F
+	if (NumComponents == 4 && bHalf == bHalfSource && (Compression == ECompushadyEXRCompression::None || Compression == ECompushadyEXRCompression::ZIP))
+	{
+		return GenerateWithImageWrapper(Data, Stride, Width, Height, bHalf, Compression, EXR, ErrorMessages);
+	}
+
+	// the ImageWrapper has no PIZ or ZIPS, takes only RGBA (or gray) pixels and never converts between half and float
+#if COMPUSHADY_OPENEXR
+	return GenerateWithOpenEXR(Data, Stride, Width, Height, NumComponents, bHalfSource, bHalf, Compression, EXR, ErrorMessages);
+#else
+	ErrorMessages = "Only RGBA pixels with ZIP or no compression can be encoded to EXR on this platform";
+	return false;
+#endif
+}
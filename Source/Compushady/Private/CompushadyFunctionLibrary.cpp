@@ -2,6 +2,8 @@
 
 
 #include "CompushadyFunctionLibrary.h"
+#include "CompushadyMips.h"
+#include "CompushadyNRRD.h"
 #include "Serialization/ArrayWriter.h"
 #include "AudioDeviceManager.h"
 #include "AudioMixerDevice.h"
@@ -58,7 +60,7 @@ UCompushadyCBV* UCompushadyFunctionLibrary::CreateCompushadyCBVFromIntArray(cons
 	return CompushadyCBV;
 }
 
-UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLFile(const FString& Filename, FString& ErrorMessages, const FString& EntryPoint, const FCompushadyFileLoaderConfig& FileLoaderConfig)
+UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLFile(const FString& Filename, FString& ErrorMessages, const FString& EntryPoint, const FCompushadyFileLoaderConfig& FileLoaderConfig, const FString& TargetProfile)
 {
 	TArray<uint8> ShaderCode;
 	if (!LoadFileWithLoaderConfig(Filename, ShaderCode, FileLoaderConfig))
@@ -68,7 +70,7 @@ UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLF
 
 	UCompushadyCompute* CompushadyCompute = NewObject<UCompushadyCompute>();
 
-	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages))
+	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages, TargetProfile))
 	{
 		return nullptr;
 	}
@@ -258,14 +260,14 @@ bool UCompushadyFunctionLibrary::SPIRVBlobToGLSL(const TArray<uint8>& Blob, FStr
 	return true;
 }
 
-UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(const FString& ShaderSource, FString& ErrorMessages, const FString& EntryPoint)
+UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(const FString& ShaderSource, FString& ErrorMessages, const FString& EntryPoint, const FString& TargetProfile)
 {
 	UCompushadyCompute* CompushadyCompute = NewObject<UCompushadyCompute>();
 
 	TArray<uint8> ShaderCode;
 	Compushady::StringToShaderCode(ShaderSource, ShaderCode);
 
-	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages))
+	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages, TargetProfile))
 	{
 		return nullptr;
 	}
@@ -324,14 +326,14 @@ UCompushadyRasterizer* UCompushadyFunctionLibrary::CreateCompushadyMSPSRasterize
 	return CompushadyRasterizer;
 }
 
-UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLShaderAsset(UCompushadyShader* ShaderAsset, FString& ErrorMessages, const FString& EntryPoint)
+UCompushadyCompute* UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLShaderAsset(UCompushadyShader* ShaderAsset, FString& ErrorMessages, const FString& EntryPoint, const FString& TargetProfile)
 {
 	UCompushadyCompute* CompushadyCompute = NewObject<UCompushadyCompute>();
 
 	TArray<uint8> ShaderCode;
 	Compushady::StringToShaderCode(ShaderAsset->Code, ShaderCode);
 
-	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages))
+	if (!CompushadyCompute->InitFromHLSL(ShaderCode, EntryPoint, ErrorMessages, TargetProfile))
 	{
 		return nullptr;
 	}
@@ -432,7 +434,7 @@ UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVStructuredBuffer(
 	return CompushadyUAV;
 }
 
-UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format)
+UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format, const int32 NumMips)
 {
 	if (!GPixelFormats[Format].Supported)
 	{
@@ -442,6 +444,7 @@ UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(const F
 
 	FRHITextureCreateDesc TextureCreateDesc = FRHITextureCreateDesc::Create2D(*Name, Width, Height, Format);
 	TextureCreateDesc.SetFlags(ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV);
+	TextureCreateDesc.SetNumMips(static_cast<uint8>(FMath::Max(Compushady::Mips::ClampNumMips(FIntVector(Width, Height, 1), NumMips), 1)));
 
 	FTextureRHIRef TextureRHIRef = nullptr;
 
@@ -582,7 +585,7 @@ UCompushadyDSV* UCompushadyFunctionLibrary::CreateCompushadyDSVTexture2D(const F
 	return CompushadyDSV;
 }
 
-UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture3D(const FString& Name, const int32 Width, const int32 Height, const int32 Depth, const EPixelFormat Format)
+UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture3D(const FString& Name, const int32 Width, const int32 Height, const int32 Depth, const EPixelFormat Format, const int32 NumMips)
 {
 	if (!GPixelFormats[Format].Supported)
 	{
@@ -592,6 +595,7 @@ UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVTexture3D(const F
 
 	FRHITextureCreateDesc TextureCreateDesc = FRHITextureCreateDesc::Create3D(*Name, Width, Height, Depth, Format);
 	TextureCreateDesc.SetFlags(ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV);
+	TextureCreateDesc.SetNumMips(static_cast<uint8>(FMath::Max(Compushady::Mips::ClampNumMips(FIntVector(Width, Height, Depth), NumMips), 1)));
 	FTextureRHIRef TextureRHIRef = nullptr;
 
 	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateTexture)(
@@ -830,7 +834,7 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVFromTextureCube(U
 	return CompushadySRV;
 }
 
-UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture2DFromImageFile(const FString& Name, const FString& Filename)
+UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture2DFromImageFile(const FString& Name, const FString& Filename, const int32 NumMips)
 {
 	TArray<uint8> ImageData;
 	if (!FFileHelper::LoadFileToArray(ImageData, *Filename))
@@ -866,6 +870,25 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture2DFromImag
 		return nullptr;
 	}
 
+	const int32 TextureNumMips = FMath::Max(Compushady::Mips::ClampNumMips(FIntVector(ImageWrapper->GetWidth(), ImageWrapper->GetHeight(), 1), NumMips), 1);
+	TSharedPtr<Compushady::Mips::FCompushadyMipGenerator, ESPMode::ThreadSafe> MipGenerator = nullptr;
+	if (TextureNumMips > 1)
+	{
+		FString ErrorMessages;
+		MipGenerator = Compushady::Mips::FCompushadyMipGenerator::Get(ErrorMessages);
+		if (!MipGenerator)
+		{
+			UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+			return nullptr;
+		}
+
+		// BGRA typed UAV stores are optional
+		if (PixelFormat == EPixelFormat::PF_B8G8R8A8)
+		{
+			RGBFormat = ERGBFormat::RGBA;
+			PixelFormat = EPixelFormat::PF_R8G8B8A8;
+		}
+	}
 
 	TArray<uint8> UncompressedBytes;
 	if (!ImageWrapper->GetRaw(RGBFormat, BitDepth, UncompressedBytes))
@@ -874,7 +897,8 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture2DFromImag
 	}
 
 	FRHITextureCreateDesc TextureCreateDesc = FRHITextureCreateDesc::Create2D(*Name, ImageWrapper->GetWidth(), ImageWrapper->GetHeight(), PixelFormat);
-	TextureCreateDesc.SetFlags(ETextureCreateFlags::ShaderResource);
+	TextureCreateDesc.SetFlags(TextureNumMips > 1 ? ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV : ETextureCreateFlags::ShaderResource);
+	TextureCreateDesc.SetNumMips(static_cast<uint8>(TextureNumMips));
 	FTextureRHIRef TextureRHIRef = nullptr;
 
 	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateTexture)(
@@ -897,10 +921,26 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture2DFromImag
 			RHICmdList.UpdateTexture2D(TextureRHIRef, 0, UpdateTextureRegion2D, ImageWrapper->GetWidth() * GPixelFormats[PixelFormat].BlockBytes, UncompressedBytes.GetData());
 		});
 
+	if (MipGenerator)
+	{
+		ENQUEUE_RENDER_COMMAND(DoCompushadyGenerateMips)(
+			[TextureRHIRef, MipGenerator](FRHICommandListImmediate& RHICmdList)
+			{
+				MipGenerator->Generate_RenderThread(RHICmdList, TextureRHIRef, ECompushadyMipFilter::Box);
+			});
+	}
+
 	FlushRenderingCommands();
 
 	UCompushadySRV* CompushadySRV = NewObject<UCompushadySRV>();
-	if (!CompushadySRV->InitializeFromTexture(TextureRHIRef))
+	if (TextureNumMips > 1)
+	{
+		if (!CompushadySRV->InitializeFromTextureAdvanced(TextureRHIRef, 0, 1, 0, TextureNumMips, EPixelFormat::PF_Unknown))
+		{
+			return nullptr;
+		}
+	}
+	else if (!CompushadySRV->InitializeFromTexture(TextureRHIRef))
 	{
 		return nullptr;
 	}
@@ -1027,17 +1067,20 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture3DFromFile
 
 UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture3DFromNRRDFile(const FString& Name, const FString& Filename)
 {
-	TArray64<uint8> SlicesData;
-	int64 Offset;
-	uint32 Width;
-	uint32 Height;
-	uint32 Depth;
-	EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
-	if (!Compushady::Utils::LoadNRRD(Filename, SlicesData, Offset, Width, Height, Depth, PixelFormat))
+	FString ErrorMessages;
+	TSharedPtr<Compushady::NRRD::FCompushadyNRRDReader> Reader = Compushady::NRRD::FCompushadyNRRDReader::Create(Filename, ErrorMessages);
+	if (!Reader)
 	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
 		return nullptr;
 	}
 
+	const Compushady::NRRD::FCompushadyNRRDHeader& Header = Reader->GetHeader();
+	const uint32 Width = Header.Width;
+	const uint32 Height = Header.Height;
+	const uint32 Depth = Header.Depth;
+	const EPixelFormat PixelFormat = Header.PixelFormat;
+
 	FTextureRHIRef TextureRHIRef = nullptr;
 
 	FRHITextureCreateDesc TextureCreateDesc = FRHITextureCreateDesc::Create3D(*Name, Width, Height, Depth, PixelFormat);
@@ -1056,12 +1099,35 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVTexture3DFromNRRD
 		return nullptr;
 	}
 
-	ENQUEUE_RENDER_COMMAND(DoCompushadyUpdateTexture3D)(
-		[TextureRHIRef, &SlicesData, Offset, Width, Height, Depth, PixelFormat](FRHICommandListImmediate& RHICmdList)
+	// the volume is uploaded in groups of slices, the next group is decoded while the previous one is uploaded
+	constexpr int64 GroupSize = 64 * 1024 * 1024;
+	const int64 SliceSize = Header.GetSliceSize();
+	const int32 SlicesPerGroup = static_cast<int32>(FMath::Clamp<int64>(GroupSize / SliceSize, 1, Depth));
+
+	while (Reader->GetNextSlice() < static_cast<int32>(Depth))
+	{
+		const int32 FirstSlice = Reader->GetNextSlice();
+		const int32 NumSlices = FMath::Min<int32>(SlicesPerGroup, Depth - FirstSlice);
+
+		TArray64<uint8> SlicesData;
+		SlicesData.SetNumUninitialized(NumSlices * SliceSize);
+		if (!Reader->ReadSlices(SlicesData.GetData(), NumSlices, ErrorMessages))
 		{
-			FUpdateTextureRegion3D UpdateTextureRegion3D(0, 0, 0, 0, 0, 0, Width, Height, Depth);
-			RHICmdList.UpdateTexture3D(TextureRHIRef, 0, UpdateTextureRegion3D, Width * GPixelFormats[PixelFormat].BlockBytes, Width * Height * GPixelFormats[PixelFormat].BlockBytes, SlicesData.GetData() + Offset);
-		});
+			UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+			FlushRenderingCommands();
+			return nullptr;
+		}
+
+		// at most two groups in memory
+		FlushRenderingCommands();
+
+		ENQUEUE_RENDER_COMMAND(DoCompushadyUpdateTexture3D)(
+			[TextureRHIRef, SlicesData = MoveTemp(SlicesData), FirstSlice, NumSlices, Width, Height, PixelFormat](FRHICommandListImmediate& RHICmdList)
+			{
+				FUpdateTextureRegion3D UpdateTextureRegion3D(0, 0, FirstSlice, 0, 0, 0, Width, Height, NumSlices);
+				RHICmdList.UpdateTexture3D(TextureRHIRef, 0, UpdateTextureRegion3D, Width * GPixelFormats[PixelFormat].BlockBytes, Width * Height * GPixelFormats[PixelFormat].BlockBytes, SlicesData.GetData());
+			});
+	}
 
 	FlushRenderingCommands();
 
@@ -2169,9 +2235,29 @@ UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVFromResource(UCom
 		return nullptr;
 	}
 
+	CompushadySRV->ShareVersionCounter(Resource);
+
 	return CompushadySRV;
 }
 
+UCompushadyUAV* UCompushadyFunctionLibrary::CreateCompushadyUAVFromResource(UCompushadyResource* Resource, const int32 MipLevel)
+{
+	if (!Resource || !Resource->IsValidTexture())
+	{
+		return nullptr;
+	}
+
+	UCompushadyUAV* CompushadyUAV = NewObject<UCompushadyUAV>();
+	if (!CompushadyUAV->InitializeFromTextureMip(Resource->GetTextureRHI(), MipLevel))
+	{
+		return nullptr;
+	}
+
+	CompushadyUAV->ShareVersionCounter(Resource);
+
+	return CompushadyUAV;
+}
+
 UCompushadySRV* UCompushadyFunctionLibrary::CreateCompushadySRVFromWorldSceneAccelerationStructure(UObject* WorldContextObject)
 {
 	UCompushadySRV* CompushadySRV = NewObject<UCompushadySRV>();
@@ -2196,7 +2282,7 @@ UCompushadyRayTracer* UCompushadyFunctionLibrary::CreateCompushadyRayTracerFromH
 	TArray<uint8> RayMissShaderCode;
 	Compushady::StringToShaderCode(RayMissShaderSource, RayMissShaderCode);
 
-	if (!CompushadyRayTracer->InitFromHLSL(RayGenShaderCode, RayGenShaderEntryPoint, RayHitShaderCode, RayHitShaderEntryPoint, RayMissShaderCode, RayMissShaderEntryPoint, ErrorMessages))
+	if (!CompushadyRayTracer->InitFromHLSL(RayGenShaderCode, RayGenShaderEntryPoint, RayMissShaderCode, RayMissShaderEntryPoint, RayHitShaderCode, RayHitShaderEntryPoint, ErrorMessages))
 	{
 		return nullptr;
 	}
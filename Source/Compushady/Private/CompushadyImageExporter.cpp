@@ -0,0 +1,472 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+
+#include "CompushadyImageExporter.h"
+#include "Async/Async.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "RHIGPUReadback.h"
+
+namespace Compushady
+{
+	namespace Image
+	{
+		struct FCompushadyImageExportReadback
+		{
+			TUniquePtr<FRHIGPUTextureReadback> Readback;
+			uint64 Sequence = 0;
+			FString Filename;
+			FString ImageDescription;
+			FIntPoint Size = FIntPoint::ZeroValue;
+			EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
+		};
+
+		struct FCompushadyImageExportReadbacks
+		{
+			TSharedPtr<FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue;
+
+			// render thread only
+			TArray<FCompushadyImageExportReadback> Slots;
+			uint32 ReadIndex = 0;
+			uint32 WriteIndex = 0;
+
+			bool IsFull() const
+			{
+				return WriteIndex - ReadIndex >= static_cast<uint32>(Slots.Num());
+			}
+
+			/* Frames are completed in order, waiting for the GPU only with bWait (at most one frame if bOnlyOldest) */
+			void CompleteFrames_RenderThread(FRHICommandListImmediate& RHICmdList, const bool bWait, const bool bOnlyOldest = false)
+			{
+				if (bWait && ReadIndex != WriteIndex)
+				{
+					RHICmdList.BlockUntilGPUIdle();
+				}
+
+				while (ReadIndex != WriteIndex)
+				{
+					FCompushadyImageExportReadback& Slot = Slots[ReadIndex % Slots.Num()];
+					if (!Slot.Readback->IsReady() && !bWait)
+					{
+						break;
+					}
+
+					int32 RowPitchInPixels = 0;
+					// after waiting for the GPU a readback that is still not ready is lost
+					const uint8* Data = Slot.Readback->IsReady() ? reinterpret_cast<const uint8*>(Slot.Readback->Lock(RowPitchInPixels)) : nullptr;
+					if (Data)
+					{
+						const int32 PixelSize = GPixelFormats[Slot.PixelFormat].BlockBytes;
+
+						FCompushadyImageExportFrame Frame;
+						Frame.Filename = Slot.Filename;
+						Frame.ImageDescription = Slot.ImageDescription;
+						Frame.Width = Slot.Size.X;
+						Frame.Height = Slot.Size.Y;
+						Frame.PixelFormat = Slot.PixelFormat;
+						Frame.Stride = Slot.Size.X * PixelSize;
+						Frame.Pixels.AddUninitialized(static_cast<int64>(Frame.Stride) * Frame.Height);
+						for (int32 Y = 0; Y < Frame.Height; Y++)
+						{
+							FMemory::Memcpy(Frame.Pixels.GetData() + static_cast<int64>(Y) * Frame.Stride, Data + static_cast<int64>(Y) * RowPitchInPixels * PixelSize, Frame.Stride);
+						}
+						Slot.Readback->Unlock();
+
+						Queue->Submit(Slot.Sequence, MoveTemp(Frame));
+					}
+					else
+					{
+						Queue->Cancel(Slot.Sequence);
+					}
+
+					ReadIndex++;
+
+					if (bOnlyOldest)
+					{
+						break;
+					}
+				}
+			}
+		};
+
+		static bool GetImageWrapperFormat(const ECompushadyImageFormat Format, const EPixelFormat PixelFormat, ERGBFormat& OutRGBFormat, int32& OutBitDepth)
+		{
+			if (Format == ECompushadyImageFormat::PNG)
+			{
+				switch (PixelFormat)
+				{
+				case EPixelFormat::PF_B8G8R8A8:
+					OutRGBFormat = ERGBFormat::BGRA;
+					OutBitDepth = 8;
+					return true;
+				case EPixelFormat::PF_R8G8B8A8:
+					OutRGBFormat = ERGBFormat::RGBA;
+					OutBitDepth = 8;
+					return true;
+				case EPixelFormat::PF_R16G16B16A16_UNORM:
+					OutRGBFormat = ERGBFormat::RGBA;
+					OutBitDepth = 16;
+					return true;
+				case EPixelFormat::PF_G8:
+				case EPixelFormat::PF_R8:
+					OutRGBFormat = ERGBFormat::Gray;
+					OutBitDepth = 8;
+					return true;
+				case EPixelFormat::PF_G16:
+					OutRGBFormat = ERGBFormat::Gray;
+					OutBitDepth = 16;
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			return false;
+		}
+	}
+}
+
+bool Compushady::Image::IsSupportedPixelFormat(const ECompushadyImageFormat Format, const EPixelFormat PixelFormat)
+{
+	if (PixelFormat <= EPixelFormat::PF_Unknown || PixelFormat >= EPixelFormat::PF_MAX || !GPixelFormats[PixelFormat].Supported)
+	{
+		return false;
+	}
+
+	if (Format == ECompushadyImageFormat::TIFF)
+	{
+		// the TIFF generator validates the component types, block compressed formats cannot be exported
+		return GPixelFormats[PixelFormat].BlockSizeX == 1 && GPixelFormats[PixelFormat].BlockSizeY == 1;
+	}
+
+	if (Format == ECompushadyImageFormat::EXR)
+	{
+		return Compushady::Utils::IsEXRPixelFormat(PixelFormat);
+	}
+
+	ERGBFormat RGBFormat;
+	int32 BitDepth;
+	return GetImageWrapperFormat(Format, PixelFormat, RGBFormat, BitDepth);
+}
+
+bool Compushady::Image::EncodeImage(const void* Data, const int32 Stride, const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const ECompushadyImageFormat Format, const FString& ImageDescription, TArray64<uint8>& Output, FString& ErrorMessages)
+{
+	if (Width <= 0 || Height <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid image size %dx%d"), Width, Height);
+		return false;
+	}
+
+	if (!IsSupportedPixelFormat(Format, PixelFormat))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s"), GetPixelFormatString(PixelFormat));
+		return false;
+	}
+
+	const int32 PackedStride = Width * GPixelFormats[PixelFormat].BlockBytes;
+	if (Stride < PackedStride)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid Stride %d (expected at least %d)"), Stride, PackedStride);
+		return false;
+	}
+
+	if (Format == ECompushadyImageFormat::TIFF)
+	{
+		TArray<uint8> TIFF;
+		if (!Compushady::Utils::GenerateTIFF(Data, Stride, Width, Height, PixelFormat, ImageDescription, TIFF))
+		{
+			ErrorMessages = "Unable to generate TIFF";
+			return false;
+		}
+		Output.Empty(TIFF.Num());
+		Output.Append(TIFF.GetData(), TIFF.Num());
+		return true;
+	}
+
+	if (Format == ECompushadyImageFormat::EXR)
+	{
+		// keep the precision of the source
+		const bool bHalf = GPixelFormats[PixelFormat].BlockBytes / GPixelFormats[PixelFormat].NumComponents == 2;
+		return Compushady::Utils::GenerateEXR(Data, Stride, Width, Height, PixelFormat, bHalf ? ECompushadyEXRPixelType::Half : ECompushadyEXRPixelType::Float, ECompushadyEXRCompression::ZIP, Output, ErrorMessages);
+	}
+
+	ERGBFormat RGBFormat;
+	int32 BitDepth;
+	GetImageWrapperFormat(Format, PixelFormat, RGBFormat, BitDepth);
+
+	// the image wrappers expect tightly packed rows
+	TArray64<uint8> Packed;
+	const uint8* Pixels = reinterpret_cast<const uint8*>(Data);
+	if (Stride != PackedStride)
+	{
+		Packed.AddUninitialized(static_cast<int64>(PackedStride) * Height);
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			FMemory::Memcpy(Packed.GetData() + static_cast<int64>(Y) * PackedStride, Pixels + static_cast<int64>(Y) * Stride, PackedStride);
+		}
+		Pixels = Packed.GetData();
+	}
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	if (!ImageWrapper.IsValid())
+	{
+		ErrorMessages = "Unable to create the image encoder";
+		return false;
+	}
+
+	if (!ImageWrapper->SetRaw(Pixels, static_cast<int64>(PackedStride) * Height, Width, Height, RGBFormat, BitDepth))
+	{
+		ErrorMessages = "Unable to encode the image";
+		return false;
+	}
+
+	Output = ImageWrapper->GetCompressed();
+	return Output.Num() > 0;
+}
+
+Compushady::Image::FCompushadyImageExportQueue::FCompushadyImageExportQueue(const ECompushadyImageFormat InFormat, const int32 InMaxInFlight, const ECompushadyImageExportPolicy InPolicy) :
+	Format(InFormat),
+	Policy(InPolicy),
+	Writer(InMaxInFlight, [](TPair<FString, TArray64<uint8>>& EncodedImage, int64& WrittenBytes)
+		{
+			WrittenBytes = EncodedImage.Value.Num();
+			return EncodedImage.Value.Num() > 0 && FFileHelper::SaveArrayToFile(EncodedImage.Value, *EncodedImage.Key);
+		})
+{
+	FString ErrorMessages;
+	if (!Writer.Start(TEXT("CompushadyImageExportQueue"), ErrorMessages))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+	}
+}
+
+bool Compushady::Image::FCompushadyImageExportQueue::Acquire(uint64& Sequence)
+{
+	return Writer.Reserve(Sequence, Policy == ECompushadyImageExportPolicy::Block);
+}
+
+void Compushady::Image::FCompushadyImageExportQueue::Cancel(const uint64 Sequence)
+{
+	Writer.Cancel(Sequence);
+}
+
+void Compushady::Image::FCompushadyImageExportQueue::Submit(const uint64 Sequence, FCompushadyImageExportFrame&& Frame)
+{
+	Async(EAsyncExecution::ThreadPool, [Self = AsShared(), Sequence, Frame = MoveTemp(Frame)]()
+		{
+			TArray64<uint8> EncodedImage;
+			FString ErrorMessages;
+			if (!EncodeImage(Frame.Pixels.GetData(), Frame.Stride, Frame.Width, Frame.Height, Frame.PixelFormat, Self->Format, Frame.ImageDescription, EncodedImage, ErrorMessages))
+			{
+				UE_LOG(LogCompushady, Error, TEXT("Unable to export %s: %s"), *Frame.Filename, *ErrorMessages);
+				// an empty image keeps the write order
+				EncodedImage.Empty();
+			}
+			Self->Writer.Submit(Sequence, TPair<FString, TArray64<uint8>>(Frame.Filename, MoveTemp(EncodedImage)));
+		});
+}
+
+void Compushady::Image::FCompushadyImageExportQueue::Flush()
+{
+	Writer.Flush();
+}
+
+FCompushadyImageExporterStats Compushady::Image::FCompushadyImageExportQueue::GetStats() const
+{
+	FCompushadyImageExporterStats Stats;
+	Stats.InFlightFrames = Writer.NumQueued();
+	Stats.PeakInFlightFrames = Writer.GetPeakQueued();
+	Stats.DroppedFrames = Writer.GetNumDropped();
+	Stats.FailedFrames = Writer.GetNumFailed();
+	Stats.WrittenFrames = Writer.GetNumWritten();
+	Stats.WrittenBytes = Writer.GetWrittenBytes();
+	return Stats;
+}
+
+void UCompushadyImageExporter::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	if (Readbacks)
+	{
+		// the frames in the readbacks are completed without stalling the game thread
+		ENQUEUE_RENDER_COMMAND(DoCompushadyImageExportDestroy)(
+			[CurrentReadbacks = Readbacks](FRHICommandListImmediate& RHICmdList)
+			{
+				CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, true);
+			});
+
+		DestroyFence.BeginFence();
+	}
+}
+
+bool UCompushadyImageExporter::IsReadyForFinishDestroy()
+{
+	if (!Super::IsReadyForFinishDestroy())
+	{
+		return false;
+	}
+
+	// pending frames are still encoded and written by the queue
+	return !Readbacks || (DestroyFence.IsFenceComplete() && Queue->NumInFlight() == 0);
+}
+
+void UCompushadyImageExporter::Tick(float DeltaTime)
+{
+	ENQUEUE_RENDER_COMMAND(DoCompushadyImageExportPoll)(
+		[CurrentReadbacks = Readbacks](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, false);
+		});
+}
+
+TStatId UCompushadyImageExporter::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCompushadyImageExporter, STATGROUP_Tickables);
+}
+
+bool UCompushadyImageExporter::IsTickable() const
+{
+	// includes the frames being encoded and written, polling an empty ring is cheap
+	return Readbacks.IsValid() && Queue->NumInFlight() > 0;
+}
+
+bool UCompushadyImageExporter::Initialize(const ECompushadyImageFormat Format, FString& ErrorMessages, const int32 MaxInFlight, const ECompushadyImageExportPolicy Policy, const int32 NumReadbacks)
+{
+	if (MaxInFlight <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid MaxInFlight %d"), MaxInFlight);
+		return false;
+	}
+
+	if (NumReadbacks <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NumReadbacks %d"), NumReadbacks);
+		return false;
+	}
+
+	Flush();
+
+	TSharedPtr<Compushady::Image::FCompushadyImageExportReadbacks, ESPMode::ThreadSafe> NewReadbacks = MakeShared<Compushady::Image::FCompushadyImageExportReadbacks, ESPMode::ThreadSafe>();
+	NewReadbacks->Queue = MakeShared<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe>(Format, MaxInFlight, Policy);
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateImageExportReadbacks)(
+		[NewReadbacks, NumReadbacks](FRHICommandListImmediate& RHICmdList)
+		{
+			NewReadbacks->Slots.SetNum(NumReadbacks);
+			for (Compushady::Image::FCompushadyImageExportReadback& Slot : NewReadbacks->Slots)
+			{
+				Slot.Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("Compushady::ImageExporter::Readback"));
+			}
+		});
+
+	FlushRenderingCommands();
+
+	Queue = NewReadbacks->Queue;
+	Readbacks = NewReadbacks;
+
+	return true;
+}
+
+bool UCompushadyImageExporter::ExportTexture(UCompushadyResource* Resource, const FString& Filename, FString& ErrorMessages, const FString& ImageDescription)
+{
+	if (!Queue)
+	{
+		ErrorMessages = "ImageExporter is not initialized";
+		return false;
+	}
+
+	if (!Resource || !Resource->IsValidTexture())
+	{
+		ErrorMessages = "The resource is not a valid Texture";
+		return false;
+	}
+
+	FTextureRHIRef TextureRHIRef = Resource->GetTextureRHI();
+	const EPixelFormat PixelFormat = TextureRHIRef->GetDesc().Format;
+	if (!Compushady::Image::IsSupportedPixelFormat(Queue->GetFormat(), PixelFormat))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s"), GetPixelFormatString(PixelFormat));
+		return false;
+	}
+
+	if (Queue->GetPolicy() == ECompushadyImageExportPolicy::Block && Queue->NumInFlight() >= Queue->GetMaxInFlight())
+	{
+		// the slots held by the readbacks are released only by the render thread
+		ENQUEUE_RENDER_COMMAND(DoCompushadyImageExportComplete)(
+			[CurrentReadbacks = Readbacks](FRHICommandListImmediate& RHICmdList)
+			{
+				CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, true);
+			});
+
+		FlushRenderingCommands();
+	}
+
+	uint64 Sequence = 0;
+	if (!Queue->Acquire(Sequence))
+	{
+		ErrorMessages = "Too many frames in flight, the frame has been dropped";
+		return false;
+	}
+
+	const FIntPoint Size(TextureRHIRef->GetSizeX(), TextureRHIRef->GetSizeY());
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyImageExportTexture)(
+		[CurrentReadbacks = Readbacks, TextureRHIRef, Size, PixelFormat, Sequence, Filename, ImageDescription](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, false);
+
+			if (CurrentReadbacks->IsFull())
+			{
+				if (CurrentReadbacks->Queue->GetPolicy() == ECompushadyImageExportPolicy::Drop)
+				{
+					CurrentReadbacks->Queue->Cancel(Sequence);
+					return;
+				}
+				CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, true, true);
+			}
+
+			Compushady::Image::FCompushadyImageExportReadback& Slot = CurrentReadbacks->Slots[CurrentReadbacks->WriteIndex % CurrentReadbacks->Slots.Num()];
+			Slot.Sequence = Sequence;
+			Slot.Filename = Filename;
+			Slot.ImageDescription = ImageDescription;
+			Slot.Size = Size;
+			Slot.PixelFormat = PixelFormat;
+
+			RHICmdList.Transition(FRHITransitionInfo(TextureRHIRef, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+			Slot.Readback->EnqueueCopy(RHICmdList, TextureRHIRef);
+			CurrentReadbacks->WriteIndex++;
+		});
+
+	return true;
+}
+
+void UCompushadyImageExporter::Flush()
+{
+	if (!Readbacks)
+	{
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyImageExportFlush)(
+		[CurrentReadbacks = Readbacks](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentReadbacks->CompleteFrames_RenderThread(RHICmdList, true);
+		});
+
+	FlushRenderingCommands();
+
+	Queue->Flush();
+}
+
+FCompushadyImageExporterStats UCompushadyImageExporter::GetStats() const
+{
+	if (!Queue)
+	{
+		return FCompushadyImageExporterStats();
+	}
+
+	return Queue->GetStats();
+}
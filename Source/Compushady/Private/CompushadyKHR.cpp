@@ -1,6 +1,7 @@
 // Copyright 2023-2024 - Roberto De Ioris.
 
 #include "Compushady.h"
+#include "CompushadyCompileWorker.h"
 
 #if PLATFORM_WINDOWS
 #include "Windows/WindowsPlatformProcess.h"
@@ -117,6 +118,22 @@ namespace Compushady
 }
 
 bool Compushady::CompileGLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, TArray<uint8>& ByteCode, FString& ErrorMessages)
+{
+	if (CompileWorker::IsEnabled())
+	{
+		FCompushadyCompileJob Job;
+		Job.Language = ECompushadyCompileJobLanguage::GLSL;
+		Job.ShaderCode = ShaderCode;
+		Job.EntryPoint = EntryPoint;
+		Job.TargetProfile = TargetProfile;
+		Job.bSPIRV = true;
+		return CompileWorker::Compile(Job, ByteCode, ErrorMessages);
+	}
+
+	return CompileGLSLInProcess(ShaderCode, EntryPoint, TargetProfile, ByteCode, ErrorMessages);
+}
+
+bool Compushady::CompileGLSLInProcess(const TArray<uint8>& ShaderCode, const FString& EntryPoint, const FString& TargetProfile, TArray<uint8>& ByteCode, FString& ErrorMessages)
 {
 	if (!KHR::Setup())
 	{
@@ -0,0 +1,714 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+
+#include "CompushadyMips.h"
+
+namespace Compushady
+{
+	namespace Mips
+	{
+		/*
+		 * main generates up to 12 levels of a 2D texture with a single dispatch: every group reduces a 64x64 tile of the base mip
+		 * to 1x1 (6 levels) in groupshared memory, then the last group (tracked by the atomic counter) reduces the 64x64 mip6 to 1x1.
+		 * Only the first level of each of the two stages reads from textures, so it is the only one supporting odd parents
+		 * (the last texel covers 3 parent texels), GetNumDispatchMips splits the chain to respect this.
+		 * main_3d does the same for 16x16x16 tiles (4 levels) without the last group stage.
+		 * main_kaiser and main_kaiser_3d generate a single level with a separable 4 taps filter.
+		 */
+		static const TCHAR* MipGeneratorShaderCode =
+			TEXT("Texture2D<float4> source;")
+			TEXT("RWTexture2D<float4> mip1;")
+			TEXT("RWTexture2D<float4> mip2;")
+			TEXT("RWTexture2D<float4> mip3;")
+			TEXT("RWTexture2D<float4> mip4;")
+			TEXT("RWTexture2D<float4> mip5;")
+			TEXT("globallycoherent RWTexture2D<float4> mip6;")
+			TEXT("RWTexture2D<float4> mip7;")
+			TEXT("RWTexture2D<float4> mip8;")
+			TEXT("RWTexture2D<float4> mip9;")
+			TEXT("RWTexture2D<float4> mip10;")
+			TEXT("RWTexture2D<float4> mip11;")
+			TEXT("RWTexture2D<float4> mip12;")
+			TEXT("RWBuffer<uint> counter;")
+			TEXT("Texture3D<float4> volume_source;")
+			TEXT("RWTexture3D<float4> volume_mip1;")
+			TEXT("RWTexture3D<float4> volume_mip2;")
+			TEXT("RWTexture3D<float4> volume_mip3;")
+			TEXT("RWTexture3D<float4> volume_mip4;")
+			TEXT("cbuffer Config")
+			TEXT("{")
+			TEXT("uint4 size;")
+			TEXT("uint4 params;")
+			TEXT("float4 kaiser;")
+			TEXT("};")
+			TEXT("groupshared float4 lds[1280];")
+			TEXT("groupshared uint last_group;")
+			TEXT("uint3 mip_size(uint level)")
+			TEXT("{")
+			TEXT("return max(size.xyz >> level, uint3(1, 1, 1));")
+			TEXT("}")
+			TEXT("float4 reduce2(float4 a, float4 b)")
+			TEXT("{")
+			TEXT("if (params.x == 2) return min(a, b);")
+			TEXT("if (params.x == 3) return max(a, b);")
+			TEXT("return (a + b) * 0.5;")
+			TEXT("}")
+			TEXT("float4 reduce4(float4 a, float4 b, float4 c, float4 d)")
+			TEXT("{")
+			TEXT("return reduce2(reduce2(a, b), reduce2(c, d));")
+			TEXT("}")
+			TEXT("uint num_taps(uint xy, uint last, uint parent_size)")
+			TEXT("{")
+			TEXT("return (xy == last && (parent_size & 1) == 1 && parent_size > 1) ? 3 : 2;")
+			TEXT("}")
+			TEXT("float4 load_level(uint level, uint2 xy)")
+			TEXT("{")
+			TEXT("xy = min(xy, mip_size(level).xy - 1);")
+			TEXT("if (level == 0) return source.Load(int3(xy, 0));")
+			TEXT("return mip6[xy];")
+			TEXT("}")
+			TEXT("float4 downsample_footprint(uint level, uint2 xy)")
+			TEXT("{")
+			TEXT("uint2 parent_size = mip_size(level - 1).xy;")
+			TEXT("uint2 last = mip_size(level).xy - 1;")
+			TEXT("uint2 taps = uint2(num_taps(xy.x, last.x, parent_size.x), num_taps(xy.y, last.y, parent_size.y));")
+			TEXT("float4 sum = float4(0, 0, 0, 0);")
+			TEXT("float4 lo = asfloat(0x7f7fffff).xxxx;")
+			TEXT("float4 hi = -lo;")
+			TEXT("for (uint y = 0; y < taps.y; y++)")
+			TEXT("{")
+			TEXT("for (uint x = 0; x < taps.x; x++)")
+			TEXT("{")
+			TEXT("float4 value = load_level(level - 1, xy * 2 + uint2(x, y));")
+			TEXT("sum += value;")
+			TEXT("lo = min(lo, value);")
+			TEXT("hi = max(hi, value);")
+			TEXT("}")
+			TEXT("}")
+			TEXT("if (params.x == 2) return lo;")
+			TEXT("if (params.x == 3) return hi;")
+			TEXT("return sum / (float)(taps.x * taps.y);")
+			TEXT("}")
+			TEXT("void store_mip(uint level, uint2 xy, float4 value)")
+			TEXT("{")
+			TEXT("uint2 level_size = mip_size(level).xy;")
+			TEXT("if (level > size.w || xy.x >= level_size.x || xy.y >= level_size.y) return;")
+			TEXT("switch (level)")
+			TEXT("{")
+			TEXT("case 1: mip1[xy] = value; break;")
+			TEXT("case 2: mip2[xy] = value; break;")
+			TEXT("case 3: mip3[xy] = value; break;")
+			TEXT("case 4: mip4[xy] = value; break;")
+			TEXT("case 5: mip5[xy] = value; break;")
+			TEXT("case 6: mip6[xy] = value; break;")
+			TEXT("case 7: mip7[xy] = value; break;")
+			TEXT("case 8: mip8[xy] = value; break;")
+			TEXT("case 9: mip9[xy] = value; break;")
+			TEXT("case 10: mip10[xy] = value; break;")
+			TEXT("case 11: mip11[xy] = value; break;")
+			TEXT("case 12: mip12[xy] = value; break;")
+			TEXT("}")
+			TEXT("}")
+			TEXT("float4 load_lds(uint offset, uint2 xy, uint2 limit, uint pitch)")
+			TEXT("{")
+			TEXT("xy = min(xy, limit);")
+			TEXT("return lds[offset + xy.y * pitch + xy.x];")
+			TEXT("}")
+			TEXT("void downsample_tile(uint first_level, uint2 tile, uint tid)")
+			TEXT("{")
+			TEXT("for (uint i = 0; i < 4; i++)")
+			TEXT("{")
+			TEXT("uint2 local = uint2(tid % 16, tid / 16) + uint2(i & 1, i >> 1) * 16;")
+			TEXT("uint2 xy = tile * 32 + local;")
+			TEXT("float4 value = downsample_footprint(first_level, xy);")
+			TEXT("lds[local.y * 32 + local.x] = value;")
+			TEXT("store_mip(first_level, xy, value);")
+			TEXT("}")
+			TEXT("uint src_offset = 0;")
+			TEXT("uint dst_offset = 1024;")
+			TEXT("for (uint level = first_level + 1; level <= first_level + 5; level++)")
+			TEXT("{")
+			TEXT("GroupMemoryBarrierWithGroupSync();")
+			TEXT("if (level > size.w) return;")
+			TEXT("uint tile_size = 32 >> (level - first_level);")
+			TEXT("uint parent_tile = tile_size * 2;")
+			TEXT("if (tid < tile_size * tile_size)")
+			TEXT("{")
+			TEXT("uint2 local = uint2(tid % tile_size, tid / tile_size);")
+			TEXT("uint2 origin = tile * parent_tile;")
+			TEXT("uint2 limit = max(mip_size(level - 1).xy, origin + 1) - 1 - origin;")
+			TEXT("uint2 p = local * 2;")
+			TEXT("float4 value = reduce4(load_lds(src_offset, p, limit, parent_tile), load_lds(src_offset, p + uint2(1, 0), limit, parent_tile), load_lds(src_offset, p + uint2(0, 1), limit, parent_tile), load_lds(src_offset, p + uint2(1, 1), limit, parent_tile));")
+			TEXT("lds[dst_offset + local.y * tile_size + local.x] = value;")
+			TEXT("store_mip(level, tile * tile_size + local, value);")
+			TEXT("}")
+			TEXT("uint swap = src_offset;")
+			TEXT("src_offset = dst_offset;")
+			TEXT("dst_offset = swap;")
+			TEXT("}")
+			TEXT("}")
+			TEXT("[numthreads(256, 1, 1)]")
+			TEXT("void main(uint3 gid : SV_GroupID, uint tid : SV_GroupIndex)")
+			TEXT("{")
+			TEXT("downsample_tile(1, gid.xy, tid);")
+			TEXT("if (size.w <= 6) return;")
+			TEXT("AllMemoryBarrierWithGroupSync();")
+			TEXT("if (tid == 0)")
+			TEXT("{")
+			TEXT("uint previous;")
+			TEXT("InterlockedAdd(counter[0], 1, previous);")
+			TEXT("last_group = previous;")
+			TEXT("}")
+			TEXT("GroupMemoryBarrierWithGroupSync();")
+			TEXT("if (last_group != params.y - 1) return;")
+			TEXT("downsample_tile(7, uint2(0, 0), tid);")
+			TEXT("}")
+			TEXT("float4 load_volume(uint3 xyz)")
+			TEXT("{")
+			TEXT("return volume_source.Load(int4(min(xyz, size.xyz - 1), 0));")
+			TEXT("}")
+			TEXT("void store_volume_mip(uint level, uint3 xyz, float4 value)")
+			TEXT("{")
+			TEXT("uint3 level_size = mip_size(level);")
+			TEXT("if (level > size.w || xyz.x >= level_size.x || xyz.y >= level_size.y || xyz.z >= level_size.z) return;")
+			TEXT("switch (level)")
+			TEXT("{")
+			TEXT("case 1: volume_mip1[xyz] = value; break;")
+			TEXT("case 2: volume_mip2[xyz] = value; break;")
+			TEXT("case 3: volume_mip3[xyz] = value; break;")
+			TEXT("case 4: volume_mip4[xyz] = value; break;")
+			TEXT("}")
+			TEXT("}")
+			TEXT("float4 load_volume_lds(uint offset, uint3 xyz, uint3 limit, uint pitch)")
+			TEXT("{")
+			TEXT("xyz = min(xyz, limit);")
+			TEXT("return lds[offset + (xyz.z * pitch + xyz.y) * pitch + xyz.x];")
+			TEXT("}")
+			TEXT("[numthreads(8, 8, 8)]")
+			TEXT("void main_3d(uint3 gid : SV_GroupID, uint3 gtid : SV_GroupThreadID, uint tid : SV_GroupIndex)")
+			TEXT("{")
+			TEXT("uint3 xyz = gid * 8 + gtid;")
+			TEXT("uint3 parent_size = size.xyz;")
+			TEXT("uint3 last = mip_size(1) - 1;")
+			TEXT("uint3 taps = uint3(num_taps(xyz.x, last.x, parent_size.x), num_taps(xyz.y, last.y, parent_size.y), num_taps(xyz.z, last.z, parent_size.z));")
+			TEXT("float4 sum = float4(0, 0, 0, 0);")
+			TEXT("float4 lo = asfloat(0x7f7fffff).xxxx;")
+			TEXT("float4 hi = -lo;")
+			TEXT("for (uint z = 0; z < taps.z; z++)")
+			TEXT("{")
+			TEXT("for (uint y = 0; y < taps.y; y++)")
+			TEXT("{")
+			TEXT("for (uint x = 0; x < taps.x; x++)")
+			TEXT("{")
+			TEXT("float4 texel = load_volume(xyz * 2 + uint3(x, y, z));")
+			TEXT("sum += texel;")
+			TEXT("lo = min(lo, texel);")
+			TEXT("hi = max(hi, texel);")
+			TEXT("}")
+			TEXT("}")
+			TEXT("}")
+			TEXT("float4 value = params.x == 2 ? lo : (params.x == 3 ? hi : sum / (float)(taps.x * taps.y * taps.z));")
+			TEXT("lds[tid] = value;")
+			TEXT("store_volume_mip(1, xyz, value);")
+			TEXT("uint src_offset = 0;")
+			TEXT("uint dst_offset = 512;")
+			TEXT("for (uint level = 2; level <= 4; level++)")
+			TEXT("{")
+			TEXT("GroupMemoryBarrierWithGroupSync();")
+			TEXT("if (level > size.w) return;")
+			TEXT("uint tile_size = 8 >> (level - 1);")
+			TEXT("uint parent_tile = tile_size * 2;")
+			TEXT("if (tid < tile_size * tile_size * tile_size)")
+			TEXT("{")
+			TEXT("uint3 local = uint3(tid % tile_size, (tid / tile_size) % tile_size, tid / (tile_size * tile_size));")
+			TEXT("uint3 origin = gid * parent_tile;")
+			TEXT("uint3 limit = max(mip_size(level - 1), origin + 1) - 1 - origin;")
+			TEXT("uint3 p = local * 2;")
+			TEXT("float4 near_plane = reduce4(load_volume_lds(src_offset, p, limit, parent_tile), load_volume_lds(src_offset, p + uint3(1, 0, 0), limit, parent_tile), load_volume_lds(src_offset, p + uint3(0, 1, 0), limit, parent_tile), load_volume_lds(src_offset, p + uint3(1, 1, 0), limit, parent_tile));")
+			TEXT("float4 far_plane = reduce4(load_volume_lds(src_offset, p + uint3(0, 0, 1), limit, parent_tile), load_volume_lds(src_offset, p + uint3(1, 0, 1), limit, parent_tile), load_volume_lds(src_offset, p + uint3(0, 1, 1), limit, parent_tile), load_volume_lds(src_offset, p + uint3(1, 1, 1), limit, parent_tile));")
+			TEXT("float4 reduced = reduce2(near_plane, far_plane);")
+			TEXT("lds[dst_offset + (local.z * tile_size + local.y) * tile_size + local.x] = reduced;")
+			TEXT("store_volume_mip(level, gid * tile_size + local, reduced);")
+			TEXT("}")
+			TEXT("uint swap = src_offset;")
+			TEXT("src_offset = dst_offset;")
+			TEXT("dst_offset = swap;")
+			TEXT("}")
+			TEXT("}")
+			TEXT("float kaiser_weight(uint tap)")
+			TEXT("{")
+			TEXT("return (tap == 0 || tap == 3) ? kaiser.x : kaiser.y;")
+			TEXT("}")
+			TEXT("[numthreads(8, 8, 1)]")
+			TEXT("void main_kaiser(uint3 tid : SV_DispatchThreadID)")
+			TEXT("{")
+			TEXT("uint2 child_size = mip_size(1).xy;")
+			TEXT("if (tid.x >= child_size.x || tid.y >= child_size.y) return;")
+			TEXT("float4 value = float4(0, 0, 0, 0);")
+			TEXT("for (uint y = 0; y < 4; y++)")
+			TEXT("{")
+			TEXT("float4 row = float4(0, 0, 0, 0);")
+			TEXT("for (uint x = 0; x < 4; x++)")
+			TEXT("{")
+			TEXT("int2 xy = clamp(int2(tid.xy * 2 + uint2(x, y)) - 1, int2(0, 0), int2(size.xy) - 1);")
+			TEXT("row += source.Load(int3(xy, 0)) * kaiser_weight(x);")
+			TEXT("}")
+			TEXT("value += row * kaiser_weight(y);")
+			TEXT("}")
+			TEXT("mip1[tid.xy] = value;")
+			TEXT("}")
+			TEXT("[numthreads(4, 4, 4)]")
+			TEXT("void main_kaiser_3d(uint3 tid : SV_DispatchThreadID)")
+			TEXT("{")
+			TEXT("uint3 child_size = mip_size(1);")
+			TEXT("if (tid.x >= child_size.x || tid.y >= child_size.y || tid.z >= child_size.z) return;")
+			TEXT("float4 value = float4(0, 0, 0, 0);")
+			TEXT("for (uint z = 0; z < 4; z++)")
+			TEXT("{")
+			TEXT("float4 plane = float4(0, 0, 0, 0);")
+			TEXT("for (uint y = 0; y < 4; y++)")
+			TEXT("{")
+			TEXT("float4 row = float4(0, 0, 0, 0);")
+			TEXT("for (uint x = 0; x < 4; x++)")
+			TEXT("{")
+			TEXT("int3 xyz = clamp(int3(tid * 2 + uint3(x, y, z)) - 1, int3(0, 0, 0), int3(size.xyz) - 1);")
+			TEXT("row += volume_source.Load(int4(xyz, 0)) * kaiser_weight(x);")
+			TEXT("}")
+			TEXT("plane += row * kaiser_weight(y);")
+			TEXT("}")
+			TEXT("value += plane * kaiser_weight(z);")
+			TEXT("}")
+			TEXT("volume_mip1[tid] = value;")
+			TEXT("}");
+
+		struct FCompushadyMipGeneratorConfig
+		{
+			FUintVector4 Size = FUintVector4(0, 0, 0, 0); // base mip size, number of levels
+			FUintVector4 Params = FUintVector4(0, 0, 0, 0); // x filter, y number of groups
+			FVector4f Kaiser = FVector4f::Zero();
+		};
+
+		static TSharedPtr<FCompushadyMipGenerator, ESPMode::ThreadSafe> GlobalGenerator;
+
+		static bool IsIntegerFormat(const EPixelFormat PixelFormat)
+		{
+			switch (PixelFormat)
+			{
+			case EPixelFormat::PF_R8_UINT:
+			case EPixelFormat::PF_R8_SINT:
+			case EPixelFormat::PF_R8G8_UINT:
+			case EPixelFormat::PF_R8G8B8A8_UINT:
+			case EPixelFormat::PF_R16_UINT:
+			case EPixelFormat::PF_R16_SINT:
+			case EPixelFormat::PF_R16G16_UINT:
+			case EPixelFormat::PF_R16G16B16A16_UINT:
+			case EPixelFormat::PF_R16G16B16A16_SINT:
+			case EPixelFormat::PF_R32_UINT:
+			case EPixelFormat::PF_R32_SINT:
+			case EPixelFormat::PF_R32G32_UINT:
+			case EPixelFormat::PF_R32G32B32_UINT:
+			case EPixelFormat::PF_R32G32B32_SINT:
+			case EPixelFormat::PF_R32G32B32A32_UINT:
+			case EPixelFormat::PF_R64_UINT:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// "mip3" and "volume_mip3" are both level 3
+		static int32 GetBindingLevel(const FString& Name)
+		{
+			const int32 Index = Name.Find(TEXT("mip"), ESearchCase::CaseSensitive, ESearchDir::FromEnd);
+			if (Index == INDEX_NONE)
+			{
+				return 0;
+			}
+			return FCString::Atoi(*Name.RightChop(Index + 3));
+		}
+
+		static bool IsOddParent(const FIntVector& Size)
+		{
+			return (Size.X > 1 && (Size.X % 2) != 0) || (Size.Y > 1 && (Size.Y % 2) != 0) || (Size.Z > 1 && (Size.Z % 2) != 0);
+		}
+
+		static double BesselI0(const double Value)
+		{
+			double Sum = 1;
+			double Term = 1;
+			for (int32 K = 1; K < 32; K++)
+			{
+				Term *= (Value / (2 * K)) * (Value / (2 * K));
+				Sum += Term;
+			}
+			return Sum;
+		}
+	}
+}
+
+int32 Compushady::Mips::GetNumMips(const FIntVector& Size)
+{
+	const int32 MaxSize = FMath::Max3(Size.X, Size.Y, Size.Z);
+	if (MaxSize <= 0)
+	{
+		return 0;
+	}
+	return FMath::FloorLog2(static_cast<uint32>(MaxSize)) + 1;
+}
+
+int32 Compushady::Mips::ClampNumMips(const FIntVector& Size, const int32 NumMips)
+{
+	const int32 MaxMips = GetNumMips(Size);
+	if (NumMips <= 0)
+	{
+		return MaxMips;
+	}
+	return FMath::Min(NumMips, MaxMips);
+}
+
+FIntVector Compushady::Mips::GetMipSize(const FIntVector& Size, const int32 MipLevel)
+{
+	return FIntVector(FMath::Max(Size.X >> MipLevel, 1), FMath::Max(Size.Y >> MipLevel, 1), FMath::Max(Size.Z >> MipLevel, 1));
+}
+
+int32 Compushady::Mips::GetNumDispatchMips(const FIntVector& Size, const bool bVolume, const int32 BaseMip, const int32 NumMips, const ECompushadyMipFilter Filter)
+{
+	const int32 Remaining = NumMips - 1 - BaseMip;
+	if (Remaining <= 0)
+	{
+		return 0;
+	}
+
+	if (Filter == ECompushadyMipFilter::Kaiser)
+	{
+		return 1;
+	}
+
+	const int32 MaxLevels = bVolume ? 4 : 12;
+	const int32 StageLevels = bVolume ? 4 : 6;
+
+	int32 Levels = 1;
+	while (Levels < Remaining && Levels < MaxLevels)
+	{
+		// the second stage reduces the whole mip6 with a single group
+		if (Levels == StageLevels)
+		{
+			const FIntVector LastStageSize = GetMipSize(Size, BaseMip + StageLevels);
+			if (LastStageSize.X > 64 || LastStageSize.Y > 64)
+			{
+				break;
+			}
+		}
+		// levels reduced in groupshared memory cannot cover 3 parent texels
+		else if (IsOddParent(GetMipSize(Size, BaseMip + Levels)))
+		{
+			break;
+		}
+		Levels++;
+	}
+
+	return Levels;
+}
+
+FVector2f Compushady::Mips::GetKaiserWeights(const float Beta)
+{
+	// the taps are at 0.5 and 1.5 parent texels from the center of the child texel, the sinc cutoff is at 2 parent texels
+	auto Weight = [Beta](const double Distance)
+		{
+			const double X = Distance / 2;
+			const double Sinc = FMath::Sin(UE_DOUBLE_PI * X) / (UE_DOUBLE_PI * X);
+			return Sinc * BesselI0(Beta * FMath::Sqrt(1 - X * X)) / BesselI0(Beta);
+		};
+
+	const double Outer = Weight(1.5);
+	const double Inner = Weight(0.5);
+	const double Sum = (Outer + Inner) * 2;
+
+	return FVector2f(static_cast<float>(Outer / Sum), static_cast<float>(Inner / Sum));
+}
+
+bool Compushady::Mips::Downsample(const TArray<FLinearColor>& Pixels, const FIntVector& Size, const ECompushadyMipFilter Filter, TArray<FLinearColor>& Output, FIntVector& OutputSize)
+{
+	if (Size.X <= 0 || Size.Y <= 0 || Size.Z <= 0 || static_cast<int64>(Pixels.Num()) != static_cast<int64>(Size.X) * Size.Y * Size.Z)
+	{
+		return false;
+	}
+
+	OutputSize = GetMipSize(Size, 1);
+	Output.SetNumUninitialized(OutputSize.X * OutputSize.Y * OutputSize.Z);
+
+	auto Load = [&](const int32 X, const int32 Y, const int32 Z)
+		{
+			const int32 ClampedX = FMath::Clamp(X, 0, Size.X - 1);
+			const int32 ClampedY = FMath::Clamp(Y, 0, Size.Y - 1);
+			const int32 ClampedZ = FMath::Clamp(Z, 0, Size.Z - 1);
+			return Pixels[(ClampedZ * Size.Y + ClampedY) * Size.X + ClampedX];
+		};
+
+	auto NumTaps = [](const int32 Child, const int32 ChildSize, const int32 ParentSize)
+		{
+			return (Child == ChildSize - 1 && ParentSize > 1 && (ParentSize % 2) != 0) ? 3 : 2;
+		};
+
+	const FVector2f Kaiser = GetKaiserWeights();
+	const float KaiserWeights[4] = { Kaiser.X, Kaiser.Y, Kaiser.Y, Kaiser.X };
+	// 2D textures use the same Kaiser taps on the Z axis, clamping makes all of them read the only slice
+
+	for (int32 Z = 0; Z < OutputSize.Z; Z++)
+	{
+		for (int32 Y = 0; Y < OutputSize.Y; Y++)
+		{
+			for (int32 X = 0; X < OutputSize.X; X++)
+			{
+				FLinearColor Value = FLinearColor(0, 0, 0, 0);
+				if (Filter == ECompushadyMipFilter::Kaiser)
+				{
+					for (int32 TapZ = 0; TapZ < 4; TapZ++)
+					{
+						for (int32 TapY = 0; TapY < 4; TapY++)
+						{
+							for (int32 TapX = 0; TapX < 4; TapX++)
+							{
+								Value += Load(X * 2 + TapX - 1, Y * 2 + TapY - 1, Z * 2 + TapZ - 1) * (KaiserWeights[TapX] * KaiserWeights[TapY] * KaiserWeights[TapZ]);
+							}
+						}
+					}
+				}
+				else
+				{
+					const int32 TapsX = NumTaps(X, OutputSize.X, Size.X);
+					const int32 TapsY = NumTaps(Y, OutputSize.Y, Size.Y);
+					const int32 TapsZ = Size.Z > 1 ? NumTaps(Z, OutputSize.Z, Size.Z) : 1;
+					FLinearColor Min = Load(X * 2, Y * 2, Z * 2);
+					FLinearColor Max = Min;
+					for (int32 TapZ = 0; TapZ < TapsZ; TapZ++)
+					{
+						for (int32 TapY = 0; TapY < TapsY; TapY++)
+						{
+							for (int32 TapX = 0; TapX < TapsX; TapX++)
+							{
+								const FLinearColor Texel = Load(X * 2 + TapX, Y * 2 + TapY, Z * 2 + TapZ);
+								Value += Texel;
+								Min = FLinearColor(FMath::Min(Min.R, Texel.R), FMath::Min(Min.G, Texel.G), FMath::Min(Min.B, Texel.B), FMath::Min(Min.A, Texel.A));
+								Max = FLinearColor(FMath::Max(Max.R, Texel.R), FMath::Max(Max.G, Texel.G), FMath::Max(Max.B, Texel.B), FMath::Max(Max.A, Texel.A));
+							}
+						}
+					}
+
+					if (Filter == ECompushadyMipFilter::Min)
+					{
+						Value = Min;
+					}
+					else if (Filter == ECompushadyMipFilter::Max)
+					{
+						Value = Max;
+					}
+					else
+					{
+						Value /= static_cast<float>(TapsX * TapsY * TapsZ);
+					}
+				}
+				Output[(Z * OutputSize.Y + Y) * OutputSize.X + X] = Value;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Compushady::Mips::CanGenerateMips(FRHITexture* Texture, FString& ErrorMessages)
+{
+	if (!Texture)
+	{
+		ErrorMessages = "The resource is not a valid Texture";
+		return false;
+	}
+
+	const FRHITextureDesc& Desc = Texture->GetDesc();
+	if (Desc.Dimension != ETextureDimension::Texture2D && Desc.Dimension != ETextureDimension::Texture3D)
+	{
+		ErrorMessages = "Mips can be generated only for 2D and 3D textures";
+		return false;
+	}
+
+	if (Desc.NumMips < 2)
+	{
+		ErrorMessages = "The Texture has a single mip";
+		return false;
+	}
+
+	if (!EnumHasAnyFlags(Desc.Flags, ETextureCreateFlags::UAV))
+	{
+		ErrorMessages = "The Texture has not been created with the UAV flag";
+		return false;
+	}
+
+	if (IsIntegerFormat(Desc.Format))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s for mips generation"), GetPixelFormatString(Desc.Format));
+		return false;
+	}
+
+	return true;
+}
+
+TSharedPtr<Compushady::Mips::FCompushadyMipGenerator, ESPMode::ThreadSafe> Compushady::Mips::FCompushadyMipGenerator::Get(FString& ErrorMessages)
+{
+	check(IsInGameThread());
+
+	if (!GlobalGenerator)
+	{
+		TSharedPtr<FCompushadyMipGenerator, ESPMode::ThreadSafe> NewGenerator = MakeShared<FCompushadyMipGenerator, ESPMode::ThreadSafe>();
+		if (!NewGenerator->Initialize(ErrorMessages))
+		{
+			return nullptr;
+		}
+		GlobalGenerator = NewGenerator;
+	}
+
+	return GlobalGenerator;
+}
+
+bool Compushady::Mips::FCompushadyMipGenerator::CompileShader(const TCHAR* EntryPoint, FCompushadyMipShader& Shader, FString& ErrorMessages)
+{
+	Shader.ComputeShaderRef = Compushady::Utils::CreateComputeShaderFromHLSL(MipGeneratorShaderCode, EntryPoint, Shader.ResourceBindings, Shader.ThreadGroupSize, ErrorMessages);
+	return Shader.ComputeShaderRef.IsValid();
+}
+
+bool Compushady::Mips::FCompushadyMipGenerator::Initialize(FString& ErrorMessages)
+{
+	if (!CompileShader(TEXT("main"), Downsample2D, ErrorMessages) ||
+		!CompileShader(TEXT("main_3d"), Downsample3D, ErrorMessages) ||
+		!CompileShader(TEXT("main_kaiser"), Kaiser2D, ErrorMessages) ||
+		!CompileShader(TEXT("main_kaiser_3d"), Kaiser3D, ErrorMessages))
+	{
+		return false;
+	}
+
+	FRHIUniformBufferLayoutInitializer LayoutInitializer(nullptr, sizeof(FCompushadyMipGeneratorConfig));
+	UniformBufferLayoutRef = RHICreateUniformBufferLayout(LayoutInitializer);
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateMipGeneratorCounter)(
+		[this](FRHICommandListImmediate& RHICmdList)
+		{
+			const FString Name = TEXT("CompushadyMipGeneratorCounter");
+			CounterBufferRHIRef = COMPUSHADY_CREATE_BUFFER(*Name, sizeof(uint32), EBufferUsageFlags::ShaderResource | EBufferUsageFlags::UnorderedAccess | EBufferUsageFlags::VertexBuffer, sizeof(uint32), ERHIAccess::UAVCompute);
+			if (CounterBufferRHIRef.IsValid())
+			{
+				CounterUAVRHIRef = COMPUSHADY_CREATE_UAV(CounterBufferRHIRef, static_cast<uint8>(EPixelFormat::PF_R32_UINT));
+			}
+		});
+
+	FlushRenderingCommands();
+
+	if (!CounterUAVRHIRef.IsValid())
+	{
+		ErrorMessages = "Unable to create the mip generator counter";
+		return false;
+	}
+
+	return true;
+}
+
+void Compushady::Mips::FCompushadyMipGenerator::Generate_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Texture, const ECompushadyMipFilter Filter)
+{
+	const FRHITextureDesc& Desc = Texture->GetDesc();
+	const bool bVolume = Desc.IsTexture3D();
+	const FIntVector Size = Texture->GetSizeXYZ();
+	const int32 NumMips = Desc.NumMips;
+
+	TArray<FUnorderedAccessViewRHIRef> MipUAVs;
+	MipUAVs.AddDefaulted(NumMips);
+	for (int32 MipLevel = 1; MipLevel < NumMips; MipLevel++)
+	{
+		MipUAVs[MipLevel] = COMPUSHADY_CREATE_UAV(Texture, MipLevel);
+	}
+
+	RHICmdList.Transition(FRHITransitionInfo(Texture, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+
+	int32 BaseMip = 0;
+	while (BaseMip < NumMips - 1)
+	{
+		const int32 NumLevels = GetNumDispatchMips(Size, bVolume, BaseMip, NumMips, Filter);
+		const FIntVector BaseSize = GetMipSize(Size, BaseMip);
+
+		FRHITransitionInfo SourceTransitionInfo(Texture, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute);
+		SourceTransitionInfo.MipIndex = BaseMip;
+		RHICmdList.Transition(SourceTransitionInfo);
+
+		FRHITextureSRVCreateInfo SRVCreateInfo;
+#if COMPUSHADY_UE_VERSION > 52
+		SRVCreateInfo.DimensionOverride = Desc.Dimension;
+#endif
+		SRVCreateInfo.MipLevel = BaseMip;
+		SRVCreateInfo.NumMipLevels = 1;
+		FShaderResourceViewRHIRef SourceSRV = COMPUSHADY_CREATE_SRV(Texture, SRVCreateInfo);
+
+		const FCompushadyMipShader& Shader = Filter == ECompushadyMipFilter::Kaiser ? (bVolume ? Kaiser3D : Kaiser2D) : (bVolume ? Downsample3D : Downsample2D);
+
+		FIntVector NumGroups;
+		if (Filter == ECompushadyMipFilter::Kaiser)
+		{
+			const FIntVector ChildSize = GetMipSize(BaseSize, 1);
+			NumGroups = FIntVector(FMath::DivideAndRoundUp(ChildSize.X, Shader.ThreadGroupSize.X), FMath::DivideAndRoundUp(ChildSize.Y, Shader.ThreadGroupSize.Y), FMath::DivideAndRoundUp(ChildSize.Z, Shader.ThreadGroupSize.Z));
+		}
+		else if (bVolume)
+		{
+			NumGroups = FIntVector(FMath::DivideAndRoundUp(BaseSize.X, 16), FMath::DivideAndRoundUp(BaseSize.Y, 16), FMath::DivideAndRoundUp(BaseSize.Z, 16));
+		}
+		else
+		{
+			NumGroups = FIntVector(FMath::DivideAndRoundUp(BaseSize.X, 64), FMath::DivideAndRoundUp(BaseSize.Y, 64), 1);
+			RHICmdList.Transition(FRHITransitionInfo(CounterUAVRHIRef, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+			RHICmdList.ClearUAVUint(CounterUAVRHIRef, FUintVector4(0, 0, 0, 0));
+			RHICmdList.Transition(FRHITransitionInfo(CounterUAVRHIRef, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute));
+		}
+
+		// levels not generated by this dispatch are bound to the first one, the shader never writes them
+		Dispatch_RenderThread(RHICmdList, Shader, SourceSRV, [this, &Shader, &MipUAVs, BaseMip, NumLevels](const int32 Index) -> FUnorderedAccessViewRHIRef
+			{
+				if (Shader.ResourceBindings.UAVs[Index].Name == TEXT("counter"))
+				{
+					return CounterUAVRHIRef;
+				}
+				const int32 Level = GetBindingLevel(Shader.ResourceBindings.UAVs[Index].Name);
+				return MipUAVs[BaseMip + (Level >= 1 && Level <= NumLevels ? Level : 1)];
+			}, BaseSize, NumLevels, Filter, NumGroups);
+
+		// the last generated mip is the source of the next dispatch
+		BaseMip += NumLevels;
+	}
+
+	RHICmdList.Transition(FRHITransitionInfo(Texture, ERHIAccess::Unknown, ERHIAccess::SRVMask));
+}
+
+void Compushady::Mips::FCompushadyMipGenerator::Dispatch_RenderThread(FRHICommandList& RHICmdList, const FCompushadyMipShader& Shader, FRHIShaderResourceView* Source, TFunction<FUnorderedAccessViewRHIRef(const int32)> UAVFunction, const FIntVector& BaseSize, const int32 NumLevels, const ECompushadyMipFilter Filter, const FIntVector& NumGroups)
+{
+	const FVector2f Kaiser = GetKaiserWeights();
+
+	FCompushadyMipGeneratorConfig Config;
+	Config.Size = FUintVector4(BaseSize.X, BaseSize.Y, BaseSize.Z, NumLevels);
+	Config.Params = FUintVector4(static_cast<uint32>(Filter), NumGroups.X * NumGroups.Y * NumGroups.Z, 0, 0);
+	Config.Kaiser = FVector4f(Kaiser.X, Kaiser.Y, 0, 0);
+
+	// every dispatch gets its own constants, a single buffer would be overwritten before the previous dispatches run
+	FUniformBufferRHIRef UniformBufferRef = RHICreateUniformBuffer(&Config, UniformBufferLayoutRef, EUniformBufferUsage::UniformBuffer_SingleDraw, EUniformBufferValidation::None);
+
+	SetComputePipelineState(RHICmdList, Shader.ComputeShaderRef);
+	Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, Shader.ComputeShaderRef, Shader.ResourceBindings,
+		[UniformBufferRef](const int32 Index)
+		{
+			return UniformBufferRef;
+		},
+		[Source](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+		{
+			return { Source, nullptr };
+		},
+		UAVFunction,
+		[](const int32 Index)
+		{
+			return nullptr;
+		}, false);
+
+	RHICmdList.DispatchComputeShader(NumGroups.X, NumGroups.Y, NumGroups.Z);
+}
@@ -1,56 +1,891 @@
 // Copyright 2023-2024 - Roberto De Ioris.
 
 
-#include "CompushadyTypes.h"
-#include "Misc/FileHelper.h"
+#include "CompushadyNRRD.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
 
-bool Compushady::Utils::LoadNRRD(const FString& Filename, TArray64<uint8>& SlicesData, int64& Offset, uint32& Width, uint32& Height, uint32& Depth, EPixelFormat& PixelFormat)
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+// compressed bytes pulled from the file at once
+#define COMPUSHADY_NRRD_INPUT_CHUNK (64 * 1024)
+// headers bigger than this are considered corrupted
+#define COMPUSHADY_NRRD_MAX_HEADER_SIZE (16 * 1024 * 1024)
+
+#define COMPUSHADY_BZIP2_MAX_GROUPS 6
+#define COMPUSHADY_BZIP2_MAX_ALPHA_SIZE 258
+#define COMPUSHADY_BZIP2_MAX_CODE_LEN 20
+#define COMPUSHADY_BZIP2_MAX_SELECTORS 18002
+#define COMPUSHADY_BZIP2_GROUP_SIZE 50
+
+namespace Compushady
 {
-	if (!FFileHelper::LoadFileToArray(SlicesData, *Filename))
+	namespace NRRD
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Unable to load file %s"), *Filename);
+		class FCompushadyNRRDRawStream : public FCompushadyNRRDStream
+		{
+		public:
+			FCompushadyNRRDRawStream(FArchive& InArchive, const int64 InEnd) : Archive(InArchive), End(InEnd)
+			{
+			}
+
+			bool Read(uint8* Output, const int64 Size, FString& ErrorMessages) override
+			{
+				if (Archive.Tell() + Size > End)
+				{
+					ErrorMessages = "Unexpected end of NRRD data";
+					return false;
+				}
+
+				Archive.Serialize(Output, Size);
+				if (Archive.IsError())
+				{
+					ErrorMessages = "Unable to read NRRD data";
+					return false;
+				}
+
+				return true;
+			}
+
+		protected:
+			FArchive& Archive;
+			int64 End;
+		};
+
+		/* Base for the compressed streams, pulls the input in chunks */
+		class FCompushadyNRRDCompressedStream : public FCompushadyNRRDStream
+		{
+		public:
+			FCompushadyNRRDCompressedStream(FArchive& InArchive, const int64 InEnd) : Archive(InArchive), End(InEnd)
+			{
+				Input.SetNumUninitialized(COMPUSHADY_NRRD_INPUT_CHUNK);
+			}
+
+		protected:
+			/* Returns the number of bytes available in Input (0 at the end of the data) */
+			int32 Refill()
+			{
+				const int64 Remaining = End - Archive.Tell();
+				if (Remaining <= 0 || Archive.IsError())
+				{
+					return 0;
+				}
+
+				const int32 ChunkSize = static_cast<int32>(FMath::Min<int64>(Remaining, Input.Num()));
+				Archive.Serialize(Input.GetData(), ChunkSize);
+				return Archive.IsError() ? 0 : ChunkSize;
+			}
+
+			FArchive& Archive;
+			int64 End;
+			TArray<uint8> Input;
+		};
+
+		class FCompushadyNRRDGZIPStream : public FCompushadyNRRDCompressedStream
+		{
+		public:
+			FCompushadyNRRDGZIPStream(FArchive& InArchive, const int64 InEnd) : FCompushadyNRRDCompressedStream(InArchive, InEnd)
+			{
+				FMemory::Memzero(ZStream);
+				// gzip or zlib header detection
+				bInitialized = inflateInit2(&ZStream, 32 + MAX_WBITS) == Z_OK;
+			}
+
+			~FCompushadyNRRDGZIPStream()
+			{
+				if (bInitialized)
+				{
+					inflateEnd(&ZStream);
+				}
+			}
+
+			bool Read(uint8* Output, const int64 Size, FString& ErrorMessages) override
+			{
+				if (!bInitialized)
+				{
+					ErrorMessages = "Unable to initialize the GZIP decoder";
+					return false;
+				}
+
+				int64 Remaining = Size;
+				while (Remaining > 0)
+				{
+					if (ZStream.avail_in == 0)
+					{
+						const int32 Available = Refill();
+						if (Available == 0)
+						{
+							ErrorMessages = "Unexpected end of GZIP data";
+							return false;
+						}
+						ZStream.next_in = Input.GetData();
+						ZStream.avail_in = Available;
+					}
+
+					const uInt ChunkSize = static_cast<uInt>(FMath::Min<int64>(Remaining, MAX_int32));
+					ZStream.next_out = Output;
+					ZStream.avail_out = ChunkSize;
+
+					const int Result = inflate(&ZStream, Z_NO_FLUSH);
+					const int64 Produced = ChunkSize - ZStream.avail_out;
+					Output += Produced;
+					Remaining -= Produced;
+
+					if (Result == Z_STREAM_END)
+					{
+						// concatenated gzip members
+						inflateReset(&ZStream);
+					}
+					else if (Result != Z_OK && !(Result == Z_BUF_ERROR && ZStream.avail_in == 0))
+					{
+						ErrorMessages = FString::Printf(TEXT("Invalid GZIP data: %s"), UTF8_TO_TCHAR(ZStream.msg ? ZStream.msg : zError(Result)));
+						return false;
+					}
+				}
+
+				return true;
+			}
+
+		protected:
+			z_stream ZStream;
+			bool bInitialized = false;
+		};
+
+		/*
+		 * Block by block bzip2 decoder: only the current block (at most 900k symbols) is kept in memory,
+		 * the final run length decoding is done while copying to the output.
+		 */
+		class FCompushadyNRRDBZIP2Stream : public FCompushadyNRRDCompressedStream
+		{
+		public:
+			FCompushadyNRRDBZIP2Stream(FArchive& InArchive, const int64 InEnd) : FCompushadyNRRDCompressedStream(InArchive, InEnd)
+			{
+				for (uint32 Index = 0; Index < 256; Index++)
+				{
+					uint32 CRC = Index << 24;
+					for (int32 Bit = 0; Bit < 8; Bit++)
+					{
+						CRC = (CRC & 0x80000000) ? (CRC << 1) ^ 0x04C11DB7 : CRC << 1;
+					}
+					CRCTable[Index] = CRC;
+				}
+			}
+
+			bool Read(uint8* Output, const int64 Size, FString& ErrorMessages) override
+			{
+				int64 Written = 0;
+				while (Written < Size)
+				{
+					if (PendingRepeats > 0)
+					{
+						const int64 Repeats = FMath::Min<int64>(PendingRepeats, Size - Written);
+						for (int64 Index = 0; Index < Repeats; Index++)
+						{
+							Output[Written++] = LastByte;
+							BlockCRC = (BlockCRC << 8) ^ CRCTable[(BlockCRC >> 24) ^ LastByte];
+						}
+						PendingRepeats -= static_cast<int32>(Repeats);
+						continue;
+					}
+
+					if (BlockPosition >= BlockLength)
+					{
+						if (!FinishBlock(ErrorMessages) || !StartBlock(ErrorMessages))
+						{
+							return false;
+						}
+						continue;
+					}
+
+					TPos = TT[TPos];
+					const uint8 Byte = static_cast<uint8>(TPos & 0xFF);
+					TPos >>= 8;
+					BlockPosition++;
+
+					// 4 equal bytes are followed by the number of additional repeats
+					if (RunLength == 4)
+					{
+						PendingRepeats = Byte;
+						RunLength = 0;
+						continue;
+					}
+
+					if (RunLength > 0 && Byte == LastByte)
+					{
+						RunLength++;
+					}
+					else
+					{
+						RunLength = 1;
+						LastByte = Byte;
+					}
+
+					Output[Written++] = Byte;
+					BlockCRC = (BlockCRC << 8) ^ CRCTable[(BlockCRC >> 24) ^ Byte];
+				}
+
+				return true;
+			}
+
+		protected:
+			bool ReadBits(const int32 NumBits, uint32& Value)
+			{
+				while (BitCount < NumBits)
+				{
+					if (InputPosition >= InputSize)
+					{
+						InputSize = Refill();
+						InputPosition = 0;
+						if (InputSize == 0)
+						{
+							return false;
+						}
+					}
+					BitBuffer = (BitBuffer << 8) | Input[InputPosition++];
+					BitCount += 8;
+				}
+
+				Value = static_cast<uint32>((BitBuffer >> (BitCount - NumBits)) & ((1ULL << NumBits) - 1));
+				BitCount -= NumBits;
+				return true;
+			}
+
+			bool FinishBlock(FString& ErrorMessages)
+			{
+				if (!bInBlock)
+				{
+					return true;
+				}
+
+				bInBlock = false;
+				BlockCRC = ~BlockCRC;
+				if (BlockCRC != ExpectedBlockCRC)
+				{
+					ErrorMessages = "BZIP2 block CRC mismatch";
+					return false;
+				}
+
+				CombinedCRC = ((CombinedCRC << 1) | (CombinedCRC >> 31)) ^ BlockCRC;
+				return true;
+			}
+
+			bool StartBlock(FString& ErrorMessages)
+			{
+				auto Fail = [&ErrorMessages](const TCHAR* Message)
+					{
+						ErrorMessages = FString::Printf(TEXT("Invalid BZIP2 data: %s"), Message);
+						return false;
+					};
+
+				uint32 Value = 0;
+				for (;;)
+				{
+					if (!bInStream)
+					{
+						// the stream signature, streams can be concatenated (e.g. by parallel compressors)
+						uint32 Signature = 0;
+						uint32 Level = 0;
+						if (!ReadBits(24, Signature))
+						{
+							return Fail(TEXT("unexpected end of data"));
+						}
+						if (Signature != 0x425A68 || !ReadBits(8, Level) || Level < '1' || Level > '9')
+						{
+							return Fail(TEXT("missing stream header"));
+						}
+						MaxBlockLength = (Level - '0') * 100000;
+						CombinedCRC = 0;
+						bInStream = true;
+					}
+
+					uint32 MagicHigh = 0;
+					uint32 MagicLow = 0;
+					if (!ReadBits(24, MagicHigh) || !ReadBits(24, MagicLow) || !ReadBits(32, Value))
+					{
+						return Fail(TEXT("unexpected end of data"));
+					}
+
+					if (MagicHigh == 0x177245 && MagicLow == 0x385090)
+					{
+						if (Value != CombinedCRC)
+						{
+							return Fail(TEXT("stream CRC mismatch"));
+						}
+						// streams are byte aligned
+						BitCount -= BitCount % 8;
+						bInStream = false;
+						continue;
+					}
+
+					if (MagicHigh != 0x314159 || MagicLow != 0x265359)
+					{
+						return Fail(TEXT("missing block header"));
+					}
+
+					ExpectedBlockCRC = Value;
+					break;
+				}
+
+				uint32 Randomized = 0;
+				uint32 OrigPtr = 0;
+				uint32 InUse16 = 0;
+				if (!ReadBits(1, Randomized) || !ReadBits(24, OrigPtr) || !ReadBits(16, InUse16))
+				{
+					return Fail(TEXT("unexpected end of data"));
+				}
+
+				if (Randomized)
+				{
+					return Fail(TEXT("randomized blocks are not supported"));
+				}
+
+				uint8 SeqToUnseq[256];
+				int32 NumInUse = 0;
+				for (int32 Index = 0; Index < 16; Index++)
+				{
+					if (InUse16 & (0x8000 >> Index))
+					{
+						uint32 InUse = 0;
+						if (!ReadBits(16, InUse))
+						{
+							return Fail(TEXT("unexpected end of data"));
+						}
+						for (int32 Bit = 0; Bit < 16; Bit++)
+						{
+							if (InUse & (0x8000 >> Bit))
+							{
+								SeqToUnseq[NumInUse++] = static_cast<uint8>(Index * 16 + Bit);
+							}
+						}
+					}
+				}
+
+				if (NumInUse == 0)
+				{
+					return Fail(TEXT("empty symbols map"));
+				}
+
+				const int32 AlphaSize = NumInUse + 2;
+
+				uint32 NumGroups = 0;
+				uint32 NumSelectors = 0;
+				if (!ReadBits(3, NumGroups) || !ReadBits(15, NumSelectors) || NumGroups < 2 || NumGroups > COMPUSHADY_BZIP2_MAX_GROUPS || NumSelectors < 1)
+				{
+					return Fail(TEXT("invalid huffman groups"));
+				}
+
+				// selectors are move-to-front coded in unary
+				uint8 GroupsMTF[COMPUSHADY_BZIP2_MAX_GROUPS];
+				for (uint32 Group = 0; Group < NumGroups; Group++)
+				{
+					GroupsMTF[Group] = static_cast<uint8>(Group);
+				}
+
+				Selectors.SetNumUninitialized(FMath::Min<int32>(NumSelectors, COMPUSHADY_BZIP2_MAX_SELECTORS), EAllowShrinking::No);
+				for (uint32 Selector = 0; Selector < NumSelectors; Selector++)
+				{
+					uint32 Index = 0;
+					for (;;)
+					{
+						uint32 Bit = 0;
+						if (!ReadBits(1, Bit))
+						{
+							return Fail(TEXT("unexpected end of data"));
+						}
+						if (!Bit)
+						{
+							break;
+						}
+						if (++Index >= NumGroups)
+						{
+							return Fail(TEXT("invalid selector"));
+						}
+					}
+
+					const uint8 Group = GroupsMTF[Index];
+					for (; Index > 0; Index--)
+					{
+						GroupsMTF[Index] = GroupsMTF[Index - 1];
+					}
+					GroupsMTF[0] = Group;
+
+					// the reference encoder may write more selectors than used
+					if (Selector < COMPUSHADY_BZIP2_MAX_SELECTORS)
+					{
+						Selectors[Selector] = Group;
+					}
+				}
+
+				// delta coded code lengths, then the canonical decoding tables
+				for (uint32 Group = 0; Group < NumGroups; Group++)
+				{
+					uint8 Lengths[COMPUSHADY_BZIP2_MAX_ALPHA_SIZE];
+					uint32 Current = 0;
+					if (!ReadBits(5, Current))
+					{
+						return Fail(TEXT("unexpected end of data"));
+					}
+
+					for (int32 Symbol = 0; Symbol < AlphaSize; Symbol++)
+					{
+						for (;;)
+						{
+							if (Current < 1 || Current > COMPUSHADY_BZIP2_MAX_CODE_LEN)
+							{
+								return Fail(TEXT("invalid code length"));
+							}
+
+							uint32 Bit = 0;
+							if (!ReadBits(1, Bit))
+							{
+								return Fail(TEXT("unexpected end of data"));
+							}
+							if (!Bit)
+							{
+								break;
+							}
+							if (!ReadBits(1, Bit))
+							{
+								return Fail(TEXT("unexpected end of data"));
+							}
+							Current = Bit ? Current - 1 : Current + 1;
+						}
+						Lengths[Symbol] = static_cast<uint8>(Current);
+					}
+
+					BuildTable(Tables[Group], Lengths, AlphaSize);
+				}
+
+				// huffman + move-to-front + zero runs decoding
+				uint8 MTF[256];
+				for (int32 Index = 0; Index < 256; Index++)
+				{
+					MTF[Index] = static_cast<uint8>(Index);
+				}
+
+				uint32 ByteCount[256] = {};
+				TT.SetNumUninitialized(MaxBlockLength, EAllowShrinking::No);
+
+				const int32 EndOfBlock = NumInUse + 1;
+				int32 Length = 0;
+				int32 GroupIndex = -1;
+				int32 GroupPosition = 0;
+				int32 Run = 0;
+				int32 RunWeight = 1;
+
+				for (;;)
+				{
+					if (GroupPosition == 0)
+					{
+						if (++GroupIndex >= Selectors.Num())
+						{
+							return Fail(TEXT("not enough selectors"));
+						}
+						GroupPosition = COMPUSHADY_BZIP2_GROUP_SIZE;
+					}
+					GroupPosition--;
+
+					int32 Symbol = 0;
+					if (!DecodeSymbol(Tables[Selectors[GroupIndex]], Symbol))
+					{
+						return Fail(TEXT("invalid huffman code"));
+					}
+
+					// RUNA and RUNB encode the number of repeats of the front symbol in bijective base 2
+					if (Symbol <= 1)
+					{
+						Run += (Symbol + 1) * RunWeight;
+						RunWeight <<= 1;
+						if (RunWeight > 2 * 1024 * 1024)
+						{
+							return Fail(TEXT("run too long"));
+						}
+						continue;
+					}
+
+					if (Run > 0)
+					{
+						if (Length + Run > MaxBlockLength)
+						{
+							return Fail(TEXT("block too long"));
+						}
+						const uint8 Byte = SeqToUnseq[MTF[0]];
+						ByteCount[Byte] += Run;
+						for (int32 Index = 0; Index < Run; Index++)
+						{
+							TT[Length++] = Byte;
+						}
+						Run = 0;
+						RunWeight = 1;
+					}
+
+					if (Symbol == EndOfBlock)
+					{
+						break;
+					}
+
+					const int32 Position = Symbol - 1;
+					if (Position >= NumInUse || Length >= MaxBlockLength)
+					{
+						return Fail(TEXT("invalid symbol"));
+					}
+
+					const uint8 Value = MTF[Position];
+					FMemory::Memmove(MTF + 1, MTF, Position);
+					MTF[0] = Value;
+
+					const uint8 Byte = SeqToUnseq[Value];
+					ByteCount[Byte]++;
+					TT[Length++] = Byte;
+				}
+
+				if (OrigPtr >= static_cast<uint32>(Length))
+				{
+					return Fail(TEXT("invalid origin pointer"));
+				}
+
+				// inverse BWT, every entry links to the next one in its high 24 bits
+				uint32 Cumulative[256];
+				uint32 Sum = 0;
+				for (int32 Index = 0; Index < 256; Index++)
+				{
+					Cumulative[Index] = Sum;
+					Sum += ByteCount[Index];
+				}
+
+				for (int32 Index = 0; Index < Length; Index++)
+				{
+					const uint8 Byte = static_cast<uint8>(TT[Index] & 0xFF);
+					TT[Cumulative[Byte]++] |= static_cast<uint32>(Index) << 8;
+				}
+
+				TPos = TT[OrigPtr] >> 8;
+				BlockLength = Length;
+				BlockPosition = 0;
+				BlockCRC = 0xFFFFFFFF;
+				RunLength = 0;
+				PendingRepeats = 0;
+				bInBlock = true;
+
+				return true;
+			}
+
+			struct FHuffmanTable
+			{
+				int32 Limit[COMPUSHADY_BZIP2_MAX_CODE_LEN + 2];
+				int32 Base[COMPUSHADY_BZIP2_MAX_CODE_LEN + 2];
+				int32 Perm[COMPUSHADY_BZIP2_MAX_ALPHA_SIZE];
+				int32 MinLength;
+				int32 MaxLength;
+			};
+
+			static void BuildTable(FHuffmanTable& Table, const uint8* Lengths, const int32 AlphaSize)
+			{
+				Table.MinLength = COMPUSHADY_BZIP2_MAX_CODE_LEN;
+				Table.MaxLength = 0;
+				for (int32 Symbol = 0; Symbol < AlphaSize; Symbol++)
+				{
+					Table.MinLength = FMath::Min<int32>(Table.MinLength, Lengths[Symbol]);
+					Table.MaxLength = FMath::Max<int32>(Table.MaxLength, Lengths[Symbol]);
+				}
+
+				int32 PermIndex = 0;
+				for (int32 Length = Table.MinLength; Length <= Table.MaxLength; Length++)
+				{
+					for (int32 Symbol = 0; Symbol < AlphaSize; Symbol++)
+					{
+						if (Lengths[Symbol] == Length)
+						{
+							Table.Perm[PermIndex++] = Symbol;
+						}
+					}
+				}
+
+				FMemory::Memzero(Table.Base);
+				FMemory::Memzero(Table.Limit);
+				for (int32 Symbol = 0; Symbol < AlphaSize; Symbol++)
+				{
+					Table.Base[Lengths[Symbol] + 1]++;
+				}
+				for (int32 Length = 1; Length < COMPUSHADY_BZIP2_MAX_CODE_LEN + 2; Length++)
+				{
+					Table.Base[Length] += Table.Base[Length - 1];
+				}
+
+				int32 Code = 0;
+				for (int32 Length = Table.MinLength; Length <= Table.MaxLength; Length++)
+				{
+					Code += Table.Base[Length + 1] - Table.Base[Length];
+					Table.Limit[Length] = Code - 1;
+					Code <<= 1;
+				}
+				for (int32 Length = Table.MinLength + 1; Length <= Table.MaxLength; Length++)
+				{
+					Table.Base[Length] = ((Table.Limit[Length - 1] + 1) << 1) - Table.Base[Length];
+				}
+			}
+
+			bool DecodeSymbol(const FHuffmanTable& Table, int32& Symbol)
+			{
+				int32 Length = Table.MinLength;
+				uint32 Code = 0;
+				if (!ReadBits(Length, Code))
+				{
+					return false;
+				}
+
+				while (static_cast<int32>(Code) > Table.Limit[Length])
+				{
+					if (++Length > Table.MaxLength)
+					{
+						return false;
+					}
+					uint32 Bit = 0;
+					if (!ReadBits(1, Bit))
+					{
+						return false;
+					}
+					Code = (Code << 1) | Bit;
+				}
+
+				const int32 Index = static_cast<int32>(Code) - Table.Base[Length];
+				if (Index < 0 || Index >= COMPUSHADY_BZIP2_MAX_ALPHA_SIZE)
+				{
+					return false;
+				}
+
+				Symbol = Table.Perm[Index];
+				return true;
+			}
+
+			uint32 CRCTable[256];
+
+			uint64 BitBuffer = 0;
+			int32 BitCount = 0;
+			int32 InputPosition = 0;
+			int32 InputSize = 0;
+
+			bool bInStream = false;
+			bool bInBlock = false;
+			int32 MaxBlockLength = 0;
+			uint32 CombinedCRC = 0;
+			uint32 ExpectedBlockCRC = 0;
+			uint32 BlockCRC = 0;
+
+			TArray<uint8> Selectors;
+			FHuffmanTable Tables[COMPUSHADY_BZIP2_MAX_GROUPS];
+
+			TArray<uint32> TT;
+			uint32 TPos = 0;
+			int32 BlockLength = 0;
+			int32 BlockPosition = 0;
+
+			uint8 LastByte = 0;
+			int32 RunLength = 0;
+			int32 PendingRepeats = 0;
+		};
+
+		/* Expands printf style %d (with optional zero padding and width) data file formats */
+		static bool FormatDataFile(const FString& Format, const int32 Number, FString& Output)
+		{
+			int32 Percent = 0;
+			if (!Format.FindChar('%', Percent))
+			{
+				return false;
+			}
+
+			int32 Index = Percent + 1;
+			const bool bZeroPad = Format.IsValidIndex(Index) && Format[Index] == '0';
+			int32 Width = 0;
+			while (Format.IsValidIndex(Index) && FChar::IsDigit(Format[Index]))
+			{
+				Width = Width * 10 + (Format[Index] - '0');
+				Index++;
+			}
+
+			if (!Format.IsValidIndex(Index) || (Format[Index] != 'd' && Format[Index] != 'i' && Format[Index] != 'u'))
+			{
+				return false;
+			}
+
+			FString NumberString = FString::FromInt(FMath::Abs(Number));
+			const int32 Padding = Width - NumberString.Len() - (Number < 0 ? 1 : 0);
+			if (Padding > 0)
+			{
+				NumberString = (bZeroPad ? FString::ChrN(Padding, '0') + NumberString : NumberString);
+			}
+			if (Number < 0)
+			{
+				NumberString = "-" + NumberString;
+			}
+			if (Padding > 0 && !bZeroPad)
+			{
+				NumberString = FString::ChrN(Padding, ' ') + NumberString;
+			}
+
+			Output = Format.Left(Percent) + NumberString + Format.Mid(Index + 1);
+			return true;
+		}
+
+		static bool SkipLines(FArchive& Archive, const int64 LineSkip)
+		{
+			for (int64 Line = 0; Line < LineSkip;)
+			{
+				if (Archive.AtEnd())
+				{
+					return false;
+				}
+				uint8 Char = 0;
+				Archive.Serialize(&Char, 1);
+				Line += Char == '\n' ? 1 : 0;
+			}
+			return true;
+		}
+
+		static FString GetDataFilePath(const FString& HeaderFilename, const FString& DataFile)
+		{
+			if (FPaths::IsRelative(DataFile))
+			{
+				return FPaths::Combine(FPaths::GetPath(HeaderFilename), DataFile);
+			}
+			return DataFile;
+		}
+	}
+}
+
+bool Compushady::NRRD::FCompushadyNRRDStream::Skip(const int64 Size, FString& ErrorMessages)
+{
+	TArray<uint8> Scratch;
+	Scratch.SetNumUninitialized(static_cast<int32>(FMath::Min<int64>(Size, COMPUSHADY_NRRD_INPUT_CHUNK)));
+
+	int64 Remaining = Size;
+	while (Remaining > 0)
+	{
+		const int64 ChunkSize = FMath::Min<int64>(Remaining, Scratch.Num());
+		if (!Read(Scratch.GetData(), ChunkSize, ErrorMessages))
+		{
+			return false;
+		}
+		Remaining -= ChunkSize;
+	}
+
+	return true;
+}
+
+TUniquePtr<Compushady::NRRD::FCompushadyNRRDStream> Compushady::NRRD::FCompushadyNRRDStream::Create(const ECompushadyNRRDEncoding Encoding, FArchive& Archive, const int64 End)
+{
+	const int64 StreamEnd = End < 0 ? Archive.TotalSize() : End;
+
+	switch (Encoding)
+	{
+	case ECompushadyNRRDEncoding::GZIP:
+		return MakeUnique<FCompushadyNRRDGZIPStream>(Archive, StreamEnd);
+	case ECompushadyNRRDEncoding::BZIP2:
+		return MakeUnique<FCompushadyNRRDBZIP2Stream>(Archive, StreamEnd);
+	default:
+		return MakeUnique<FCompushadyNRRDRawStream>(Archive, StreamEnd);
+	}
+}
+
+int64 Compushady::NRRD::FCompushadyNRRDHeader::GetSliceSize() const
+{
+	return static_cast<int64>(Width) * Height * GPixelFormats[PixelFormat].BlockBytes;
+}
+
+int64 Compushady::NRRD::FCompushadyNRRDHeader::GetDataSize() const
+{
+	return GetSliceSize() * Depth;
+}
+
+bool Compushady::NRRD::ParseHeader(const FString& Filename, FCompushadyNRRDHeader& Header, FString& ErrorMessages)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open file %s"), *Filename);
 		return false;
 	}
 
+	// only the header is read, the (attached) data starts after the first empty line
 	TArray<FString> Lines;
 	TArray<uint8> Line;
-	int64 Index = 0;
-	for (Index = 0; Index < SlicesData.Num(); Index++)
+	TArray<uint8> Chunk;
+	int64 DataOffset = -1;
+	int64 Position = 0;
+	const int64 FileSize = Reader->TotalSize();
+
+	while (DataOffset < 0 && Position < FileSize)
 	{
-		const uint8 Char = SlicesData[Index];
-		if (Char == '\n')
+		if (Position >= COMPUSHADY_NRRD_MAX_HEADER_SIZE)
 		{
-			const FString StringLine = Compushady::ShaderCodeToString(Line).TrimStartAndEnd();
-			if (StringLine.IsEmpty())
+			ErrorMessages = "Invalid NRRD file: header too big";
+			return false;
+		}
+
+		Chunk.SetNumUninitialized(static_cast<int32>(FMath::Min<int64>(FileSize - Position, COMPUSHADY_NRRD_INPUT_CHUNK)));
+		Reader->Serialize(Chunk.GetData(), Chunk.Num());
+
+		for (int32 Index = 0; Index < Chunk.Num(); Index++)
+		{
+			const uint8 Char = Chunk[Index];
+			if (Char == '\n')
 			{
-				break;
+				const FString StringLine = Compushady::ShaderCodeToString(Line).TrimStartAndEnd();
+				Line.Empty();
+				if (StringLine.IsEmpty())
+				{
+					DataOffset = Position + Index + 1;
+					break;
+				}
+				Lines.Add(StringLine);
+			}
+			else if (Char != '\r')
+			{
+				Line.Add(Char);
 			}
-			Lines.Add(StringLine);
-			Line.Empty();
 		}
-		else if (Char != '\r')
+
+		Position += Chunk.Num();
+	}
+
+	// detached headers can end without a newline
+	if (DataOffset < 0 && Line.Num() > 0)
+	{
+		const FString StringLine = Compushady::ShaderCodeToString(Line).TrimStartAndEnd();
+		if (!StringLine.IsEmpty())
 		{
-			Line.Add(Char);
+			Lines.Add(StringLine);
 		}
 	}
 
 	if (Lines.Num() < 5 || !Lines[0].StartsWith("NRRD"))
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD file"));
+		ErrorMessages = "Invalid NRRD file";
 		return false;
 	}
 
-	PixelFormat = EPixelFormat::PF_Unknown;
+	Header = FCompushadyNRRDHeader();
 	int32 Dimension = 0;
-	Width = 0;
-	Height = 0;
-	Depth = 0;
 	TArray<FString> Sizes;
+	bool bDataFileList = false;
 
 	for (int32 LineIndex = 1; LineIndex < Lines.Num(); LineIndex++)
 	{
 		const FString NRRDHeaderLine = Lines[LineIndex];
 
+		if (bDataFileList)
+		{
+			Header.DataFiles.Add(GetDataFilePath(Filename, NRRDHeaderLine));
+			continue;
+		}
+
+		if (NRRDHeaderLine.StartsWith("#"))
+		{
+			continue;
+		}
+
 		int32 FoundIndex = 0;
 		if (NRRDHeaderLine.FindChar(':', FoundIndex))
 		{
@@ -66,35 +901,35 @@ bool Compushady::Utils::LoadNRRD(const FString& Filename, TArray64<uint8>& Slice
 			{
 				if (Value == "signed char" || Value == "int8" || Value == "int8_t")
 				{
-					PixelFormat = EPixelFormat::PF_R8_SINT;
+					Header.PixelFormat = EPixelFormat::PF_R8_SINT;
 				}
 				else if (Value == "uchar" || Value == "unsigned char" || Value == "uint8" || Value == "uint8_t")
 				{
-					PixelFormat = EPixelFormat::PF_R8_UINT;
+					Header.PixelFormat = EPixelFormat::PF_R8_UINT;
 				}
 				else if (Value == "short" || Value == "short int" || Value == "signed short" || Value == "signed short int" || Value == "int16" || Value == "int16_t")
 				{
-					PixelFormat = EPixelFormat::PF_R16_SINT;
+					Header.PixelFormat = EPixelFormat::PF_R16_SINT;
 				}
 				else if (Value == "ushort" || Value == "unsigned short" || Value == "unsigned short int" || Value == "uint16" || Value == "uint16_t")
 				{
-					PixelFormat = EPixelFormat::PF_R16_UINT;
+					Header.PixelFormat = EPixelFormat::PF_R16_UINT;
 				}
 				else if (Value == "int" || Value == "signed int" || Value == "int32" || Value == "int32_t")
 				{
-					PixelFormat = EPixelFormat::PF_R32_SINT;
+					Header.PixelFormat = EPixelFormat::PF_R32_SINT;
 				}
 				else if (Value == "uint" || Value == "unsigned int" || Value == "uint32" || Value == "uint32_t")
 				{
-					PixelFormat = EPixelFormat::PF_R32_UINT;
+					Header.PixelFormat = EPixelFormat::PF_R32_UINT;
 				}
 				else if (Value == "float")
 				{
-					PixelFormat = EPixelFormat::PF_R32_FLOAT;
+					Header.PixelFormat = EPixelFormat::PF_R32_FLOAT;
 				}
 				else
 				{
-					UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD type"));
+					ErrorMessages = FString::Printf(TEXT("Invalid NRRD type %s"), *Value);
 					return false;
 				}
 			}
@@ -103,71 +938,374 @@ bool Compushady::Utils::LoadNRRD(const FString& Filename, TArray64<uint8>& Slice
 				Dimension = FCString::Atoi(*Value);
 				if (Dimension < 1)
 				{
-					UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD dimension"));
+					ErrorMessages = "Invalid NRRD dimension";
 					return false;
 				}
 			}
 			else if (Key == "encoding")
 			{
-				if (Value != "raw")
+				if (Value == "raw")
+				{
+					Header.Encoding = ECompushadyNRRDEncoding::Raw;
+				}
+				else if (Value == "gzip" || Value == "gz")
+				{
+					Header.Encoding = ECompushadyNRRDEncoding::GZIP;
+				}
+				else if (Value == "bzip2" || Value == "bz2")
+				{
+					Header.Encoding = ECompushadyNRRDEncoding::BZIP2;
+				}
+				else
 				{
-					UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD encoding"));
+					ErrorMessages = FString::Printf(TEXT("Unsupported NRRD encoding %s"), *Value);
 					return false;
 				}
 			}
+			else if (Key == "endian")
+			{
+				Header.bBigEndian = Value == "big";
+			}
 			else if (Key == "sizes")
 			{
 				const TCHAR* Delimiters[] = { TEXT(" "), TEXT("\t") };
 				Value.ParseIntoArray(Sizes, Delimiters, 2, false);
 			}
+			else if (Key == "line skip" || Key == "lineskip")
+			{
+				Header.LineSkip = FCString::Atoi64(*Value);
+			}
+			else if (Key == "byte skip" || Key == "byteskip")
+			{
+				Header.ByteSkip = FCString::Atoi64(*Value);
+			}
+			else if (Key == "data file" || Key == "datafile")
+			{
+				const TCHAR* Delimiters[] = { TEXT(" "), TEXT("\t") };
+				TArray<FString> Tokens;
+				Value.ParseIntoArray(Tokens, Delimiters, 2, true);
+
+				if (Tokens.Num() > 0 && Tokens[0] == "LIST")
+				{
+					// the remaining lines are the data files
+					bDataFileList = true;
+				}
+				else if (Tokens.Num() >= 4 && Tokens[0].Contains("%"))
+				{
+					const int32 Min = FCString::Atoi(*Tokens[1]);
+					const int32 Max = FCString::Atoi(*Tokens[2]);
+					const int32 Step = FCString::Atoi(*Tokens[3]);
+					if (Step == 0 || (Max - Min) / Step < 0)
+					{
+						ErrorMessages = FString::Printf(TEXT("Invalid NRRD data file range %s"), *Value);
+						return false;
+					}
+
+					for (int32 Number = Min; Step > 0 ? Number <= Max : Number >= Max; Number += Step)
+					{
+						FString DataFile;
+						if (!FormatDataFile(Tokens[0], Number, DataFile))
+						{
+							ErrorMessages = FString::Printf(TEXT("Invalid NRRD data file format %s"), *Tokens[0]);
+							return false;
+						}
+						Header.DataFiles.Add(GetDataFilePath(Filename, DataFile));
+					}
+				}
+				else
+				{
+					Header.DataFiles.Add(GetDataFilePath(Filename, Value));
+				}
+			}
 		}
 	}
 
-	if (PixelFormat == EPixelFormat::PF_Unknown)
+	if (Header.PixelFormat == EPixelFormat::PF_Unknown)
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD: missing type"));
+		ErrorMessages = "Invalid NRRD: missing type";
 		return false;
 	}
 
 	if (Dimension == 0)
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD: missing dimension"));
+		ErrorMessages = "Invalid NRRD: missing dimension";
 		return false;
 	}
 
 	if (Sizes.Num() == 0)
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD: missing sizes"));
+		ErrorMessages = "Invalid NRRD: missing sizes";
 		return false;
 	}
 
-	Width = FCString::Atoi(*Sizes[0]);
-	Height = 1;
-	Depth = 1;
-	if (Sizes.IsValidIndex(1))
+	const int64 Width = FCString::Atoi64(*Sizes[0]);
+	const int64 Height = Sizes.IsValidIndex(1) ? FCString::Atoi64(*Sizes[1]) : 1;
+	const int64 Depth = Sizes.IsValidIndex(2) ? FCString::Atoi64(*Sizes[2]) : 1;
+
+	if (Width <= 0 || Height <= 0 || Depth <= 0 || Width > MAX_uint32 || Height > MAX_uint32 || Depth > MAX_uint32)
 	{
-		Height = FCString::Atoi(*Sizes[1]);
+		ErrorMessages = FString::Printf(TEXT("Invalid NRRD sizes (%lld %lld %lld)"), Width, Height, Depth);
+		return false;
 	}
-	if (Sizes.IsValidIndex(2))
+
+	Header.Width = static_cast<uint32>(Width);
+	Header.Height = static_cast<uint32>(Height);
+	Header.Depth = static_cast<uint32>(Depth);
+
+	if (Header.ByteSkip < -1 || Header.LineSkip < 0)
 	{
-		Depth = FCString::Atoi(*Sizes[2]);
+		ErrorMessages = "Invalid NRRD line/byte skip";
+		return false;
 	}
 
-	if (Width <= 0 || Height <= 0 || Depth <= 0)
+	if (Header.ByteSkip == -1 && Header.Encoding != ECompushadyNRRDEncoding::Raw)
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD sizes (%d %d %d)"), Width, Height, Depth);
+		ErrorMessages = "NRRD byte skip -1 requires the raw encoding";
 		return false;
 	}
 
-	Offset = Index + 1;
+	if (Header.DataFiles.Num() > 0)
+	{
+		if (Header.GetDataSize() % Header.DataFiles.Num() != 0)
+		{
+			ErrorMessages = FString::Printf(TEXT("The NRRD data cannot be split in %d data files"), Header.DataFiles.Num());
+			return false;
+		}
+	}
+	else
+	{
+		if (DataOffset < 0)
+		{
+			ErrorMessages = "Invalid NRRD: missing data";
+			return false;
+		}
+		Header.Filename = Filename;
+		Header.DataOffset = DataOffset;
+	}
+
+	return true;
+}
 
-	const int64 RequiredSize = Width * Height * Depth * GPixelFormats[PixelFormat].BlockBytes;
+void Compushady::NRRD::SwapEndianness(uint8* Data, const int64 NumElements, const int32 ElementSize)
+{
+	const int64 Size = NumElements * ElementSize;
+	int64 Offset = 0;
 
-	if (Offset >= SlicesData.Num() || (SlicesData.Num() - Offset) < RequiredSize)
+	if (ElementSize == 2)
+	{
+		const VectorRegister4Int HighMask = MakeVectorRegisterInt(0xFF00FF00, 0xFF00FF00, 0xFF00FF00, 0xFF00FF00);
+		const VectorRegister4Int LowMask = MakeVectorRegisterInt(0x00FF00FF, 0x00FF00FF, 0x00FF00FF, 0x00FF00FF);
+		for (; Offset + 16 <= Size; Offset += 16)
+		{
+			const VectorRegister4Int Value = VectorIntLoad(Data + Offset);
+			VectorIntStore(VectorIntOr(VectorIntAnd(VectorShiftLeftImm(Value, 8), HighMask), VectorIntAnd(VectorShiftRightImmLogical(Value, 8), LowMask)), Data + Offset);
+		}
+	}
+	else if (ElementSize == 4)
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Invalid NRRD file size (required: %lld bytes)"), RequiredSize);
+		const VectorRegister4Int Byte2Mask = MakeVectorRegisterInt(0x00FF0000, 0x00FF0000, 0x00FF0000, 0x00FF0000);
+		const VectorRegister4Int Byte1Mask = MakeVectorRegisterInt(0x0000FF00, 0x0000FF00, 0x0000FF00, 0x0000FF00);
+		for (; Offset + 16 <= Size; Offset += 16)
+		{
+			const VectorRegister4Int Value = VectorIntLoad(Data + Offset);
+			const VectorRegister4Int Outer = VectorIntOr(VectorShiftLeftImm(Value, 24), VectorShiftRightImmLogical(Value, 24));
+			const VectorRegister4Int Inner = VectorIntOr(VectorIntAnd(VectorShiftLeftImm(Value, 8), Byte2Mask), VectorIntAnd(VectorShiftRightImmLogical(Value, 8), Byte1Mask));
+			VectorIntStore(VectorIntOr(Outer, Inner), Data + Offset);
+		}
+	}
+
+	// 8 bytes elements and the tail
+	for (; Offset + ElementSize <= Size; Offset += ElementSize)
+	{
+		for (int32 Index = 0; Index < ElementSize / 2; Index++)
+		{
+			Swap(Data[Offset + Index], Data[Offset + ElementSize - 1 - Index]);
+		}
+	}
+}
+
+bool Compushady::NRRD::GetRawDataLocation(const FCompushadyNRRDHeader& Header, FString& DataFilename, int64& Offset, FString& ErrorMessages)
+{
+	if (Header.Encoding != ECompushadyNRRDEncoding::Raw || Header.DataFiles.Num() > 1)
+	{
+		ErrorMessages = "Random access requires raw NRRD data in a single file";
+		return false;
+	}
+
+	DataFilename = Header.DataFiles.Num() > 0 ? Header.DataFiles[0] : Header.Filename;
+
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileReader(*DataFilename));
+	if (!Archive)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open NRRD data file %s"), *DataFilename);
+		return false;
+	}
+
+	if (Header.DataFiles.Num() == 0)
+	{
+		Archive->Seek(Header.DataOffset);
+	}
+
+	if (!SkipLines(*Archive, Header.LineSkip))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to skip %lld lines in %s"), Header.LineSkip, *DataFilename);
+		return false;
+	}
+
+	Offset = Header.ByteSkip == -1 ? Archive->TotalSize() - Header.GetDataSize() : Archive->Tell() + Header.ByteSkip;
+	if (Offset < Archive->Tell() || Archive->TotalSize() - Offset < Header.GetDataSize())
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NRRD file size (required: %lld bytes)"), Header.GetDataSize());
+		return false;
+	}
+
+	return true;
+}
+
+TSharedPtr<Compushady::NRRD::FCompushadyNRRDReader> Compushady::NRRD::FCompushadyNRRDReader::Create(const FString& Filename, FString& ErrorMessages)
+{
+	TSharedPtr<FCompushadyNRRDReader> Reader = MakeShareable(new FCompushadyNRRDReader());
+	if (!ParseHeader(Filename, Reader->Header, ErrorMessages))
+	{
+		return nullptr;
+	}
+
+	if (!Reader->OpenDataFile(0, ErrorMessages))
+	{
+		return nullptr;
+	}
+
+	return Reader;
+}
+
+bool Compushady::NRRD::FCompushadyNRRDReader::OpenDataFile(const int32 InDataFileIndex, FString& ErrorMessages)
+{
+	Stream.Reset();
+	Archive.Reset();
+
+	const bool bAttached = Header.DataFiles.Num() == 0;
+	const FString& DataFilename = bAttached ? Header.Filename : Header.DataFiles[InDataFileIndex];
+
+	Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*DataFilename));
+	if (!Archive)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open NRRD data file %s"), *DataFilename);
 		return false;
 	}
 
+	if (bAttached)
+	{
+		Archive->Seek(Header.DataOffset);
+	}
+
+	// line skip applies to the file, byte skip to the decompressed data
+	if (!SkipLines(*Archive, Header.LineSkip))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to skip %lld lines in %s"), Header.LineSkip, *DataFilename);
+		return false;
+	}
+
+	DataFileSize = Header.GetDataSize() / FMath::Max(Header.DataFiles.Num(), 1);
+	DataFileRemaining = DataFileSize;
+	DataFileIndex = InDataFileIndex;
+
+	if (Header.Encoding == ECompushadyNRRDEncoding::Raw)
+	{
+		if (Header.ByteSkip == -1)
+		{
+			if (Archive->TotalSize() - DataFileSize < Archive->Tell())
+			{
+				ErrorMessages = FString::Printf(TEXT("Invalid NRRD file size (required: %lld bytes)"), DataFileSize);
+				return false;
+			}
+			Archive->Seek(Archive->TotalSize() - DataFileSize);
+		}
+		else
+		{
+			Archive->Seek(Archive->Tell() + Header.ByteSkip);
+		}
+
+		if (Archive->TotalSize() - Archive->Tell() < DataFileSize)
+		{
+			ErrorMessages = FString::Printf(TEXT("Invalid NRRD file size (required: %lld bytes)"), DataFileSize);
+			return false;
+		}
+	}
+
+	Stream = FCompushadyNRRDStream::Create(Header.Encoding, *Archive);
+
+	if (Header.Encoding != ECompushadyNRRDEncoding::Raw && Header.ByteSkip > 0)
+	{
+		return Stream->Skip(Header.ByteSkip, ErrorMessages);
+	}
+
+	return true;
+}
+
+bool Compushady::NRRD::FCompushadyNRRDReader::ReadSlices(uint8* Output, const int32 NumSlices, FString& ErrorMessages)
+{
+	if (NumSlices <= 0 || NextSlice + NumSlices > static_cast<int64>(Header.Depth))
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NRRD slices range (%d-%d)"), NextSlice, NextSlice + NumSlices);
+		return false;
+	}
+
+	const int64 Size = NumSlices * Header.GetSliceSize();
+	int64 Offset = 0;
+	while (Offset < Size)
+	{
+		if (DataFileRemaining == 0)
+		{
+			if (!OpenDataFile(DataFileIndex + 1, ErrorMessages))
+			{
+				return false;
+			}
+		}
+
+		const int64 ChunkSize = FMath::Min(DataFileRemaining, Size - Offset);
+		if (!Stream->Read(Output + Offset, ChunkSize, ErrorMessages))
+		{
+			return false;
+		}
+
+		Offset += ChunkSize;
+		DataFileRemaining -= ChunkSize;
+	}
+
+	const int32 ElementSize = GPixelFormats[Header.PixelFormat].BlockBytes;
+	if (Header.bBigEndian && ElementSize > 1)
+	{
+		SwapEndianness(Output, Size / ElementSize, ElementSize);
+	}
+
+	NextSlice += NumSlices;
+	return true;
+}
+
+bool Compushady::Utils::LoadNRRD(const FString& Filename, TArray64<uint8>& SlicesData, int64& Offset, uint32& Width, uint32& Height, uint32& Depth, EPixelFormat& PixelFormat)
+{
+	FString ErrorMessages;
+	TSharedPtr<Compushady::NRRD::FCompushadyNRRDReader> Reader = Compushady::NRRD::FCompushadyNRRDReader::Create(Filename, ErrorMessages);
+	if (!Reader)
+	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+		return false;
+	}
+
+	const Compushady::NRRD::FCompushadyNRRDHeader& Header = Reader->GetHeader();
+
+	SlicesData.SetNumUninitialized(Header.GetDataSize());
+	if (!Reader->ReadSlices(SlicesData.GetData(), Header.Depth, ErrorMessages))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+		return false;
+	}
+
+	Offset = 0;
+	Width = Header.Width;
+	Height = Header.Height;
+	Depth = Header.Depth;
+	PixelFormat = Header.PixelFormat;
+
 	return true;
-}
\ No newline at end of file
+}
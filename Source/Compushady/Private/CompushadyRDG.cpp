@@ -0,0 +1,244 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyRDG.h"
+#include "CompushadyCBV.h"
+#include "CompushadyCompute.h"
+#include "CompushadySampler.h"
+#include "CompushadySRV.h"
+#include "CompushadyUAV.h"
+#include "RenderTargetPool.h"
+
+namespace Compushady
+{
+	namespace RDG
+	{
+		static void AddResourceAccess(TArray<FCompushadyRDGResourceAccess>& Accesses, FTextureRHIRef TextureRHIRef, FBufferRHIRef BufferRHIRef, const ERHIAccess Access)
+		{
+			for (FCompushadyRDGResourceAccess& ResourceAccess : Accesses)
+			{
+				if ((TextureRHIRef && ResourceAccess.TextureRHIRef == TextureRHIRef) || (BufferRHIRef && ResourceAccess.BufferRHIRef == BufferRHIRef))
+				{
+					// UAV accesses already include reads, and mixing them with SRV accesses is not valid
+					if (EnumHasAnyFlags(Access, ERHIAccess::UAVMask))
+					{
+						ResourceAccess.Access = Access;
+					}
+					return;
+				}
+			}
+
+			FCompushadyRDGResourceAccess ResourceAccess;
+			ResourceAccess.TextureRHIRef = TextureRHIRef;
+			ResourceAccess.BufferRHIRef = BufferRHIRef;
+			ResourceAccess.Access = Access;
+			Accesses.Add(ResourceAccess);
+		}
+	}
+}
+
+bool Compushady::RDG::CollectResourceAccesses(const FCompushadyResourceArray& ResourceArray, TArray<FCompushadyRDGResourceAccess>& Accesses, FString& ErrorMessages, const ERHIAccess SRVAccess, const ERHIAccess UAVAccess, const bool bSkipSceneTextures)
+{
+	for (int32 Index = 0; Index < ResourceArray.SRVs.Num(); Index++)
+	{
+		UCompushadySRV* SRV = ResourceArray.SRVs[Index];
+		if (!SRV)
+		{
+			ErrorMessages = FString::Printf(TEXT("SRV %d cannot be null"), Index);
+			return false;
+		}
+
+		if (SRV->IsSceneTexture())
+		{
+			if (bSkipSceneTextures)
+			{
+				continue;
+			}
+			ErrorMessages = FString::Printf(TEXT("SRV %d is a scene texture (register the engine texture with the render graph instead)"), Index);
+			return false;
+		}
+
+		// acceleration structures are not tracked by the render graph
+		if (SRV->IsAccelerationStructure())
+		{
+			continue;
+		}
+
+		if (!SRV->IsValidTexture() && !SRV->IsValidBuffer())
+		{
+			ErrorMessages = FString::Printf(TEXT("SRV %d has no texture or buffer"), Index);
+			return false;
+		}
+
+		AddResourceAccess(Accesses, SRV->GetTextureRHI(), SRV->GetBufferRHI(), SRVAccess);
+	}
+
+	for (int32 Index = 0; Index < ResourceArray.UAVs.Num(); Index++)
+	{
+		UCompushadyUAV* UAV = ResourceArray.UAVs[Index];
+		if (!UAV)
+		{
+			ErrorMessages = FString::Printf(TEXT("UAV %d cannot be null"), Index);
+			return false;
+		}
+
+		if (!UAV->IsValidTexture() && !UAV->IsValidBuffer())
+		{
+			ErrorMessages = FString::Printf(TEXT("UAV %d has no texture or buffer"), Index);
+			return false;
+		}
+
+		AddResourceAccess(Accesses, UAV->GetTextureRHI(), UAV->GetBufferRHI(), UAVAccess);
+	}
+
+	return true;
+}
+
+FRDGTextureRef Compushady::RDG::RegisterExternalTexture(FRDGBuilder& GraphBuilder, FRHITexture* Texture)
+{
+	if (FRDGTextureRef RDGTexture = GraphBuilder.FindExternalTexture(Texture))
+	{
+		return RDGTexture;
+	}
+
+	return GraphBuilder.RegisterExternalTexture(CreateRenderTarget(Texture, TEXT("Compushady::RDG::Texture")));
+}
+
+FRDGBufferRef Compushady::RDG::RegisterExternalBuffer(FRDGBuilder& GraphBuilder, FRHIBuffer* Buffer)
+{
+	if (FRDGBufferRef RDGBuffer = GraphBuilder.FindExternalBuffer(Buffer))
+	{
+		return RDGBuffer;
+	}
+
+	const uint32 Stride = FMath::Max<uint32>(Buffer->GetStride(), 1);
+	FRDGBufferDesc BufferDesc = FRDGBufferDesc::CreateBufferDesc(Stride, Buffer->GetSize() / Stride);
+	BufferDesc.Usage = Buffer->GetUsage();
+
+#if COMPUSHADY_UE_VERSION >= 54
+	TRefCountPtr<FRDGPooledBuffer> PooledBuffer = new FRDGPooledBuffer(GraphBuilder.RHICmdList, Buffer, BufferDesc, BufferDesc.NumElements, TEXT("Compushady::RDG::Buffer"));
+#else
+	TRefCountPtr<FRDGPooledBuffer> PooledBuffer = new FRDGPooledBuffer(Buffer, BufferDesc, BufferDesc.NumElements, TEXT("Compushady::RDG::Buffer"));
+#endif
+
+	return GraphBuilder.RegisterExternalBuffer(PooledBuffer);
+}
+
+FCompushadyRDGComputePassParameters* Compushady::RDG::CreatePassParameters(FRDGBuilder& GraphBuilder, const TArray<FCompushadyRDGResourceAccess>& Accesses)
+{
+	FCompushadyRDGComputePassParameters* PassParameters = GraphBuilder.AllocParameters<FCompushadyRDGComputePassParameters>();
+
+	for (const FCompushadyRDGResourceAccess& ResourceAccess : Accesses)
+	{
+		if (ResourceAccess.TextureRHIRef)
+		{
+			PassParameters->TextureAccesses.Emplace(RegisterExternalTexture(GraphBuilder, ResourceAccess.TextureRHIRef), ResourceAccess.Access);
+		}
+		else if (ResourceAccess.BufferRHIRef)
+		{
+			PassParameters->BufferAccesses.Emplace(RegisterExternalBuffer(GraphBuilder, ResourceAccess.BufferRHIRef), ResourceAccess.Access);
+		}
+	}
+
+	return PassParameters;
+}
+
+bool Compushady::RDG::AddComputePass(FRDGBuilder& GraphBuilder, UCompushadyCompute* Compute, const FCompushadyResourceArray& ResourceArray, const FIntVector& XYZ, FString& ErrorMessages)
+{
+	check(IsInRenderingThread());
+
+	if (!Compute || !Compute->GetRHI())
+	{
+		ErrorMessages = "Invalid Compute";
+		return false;
+	}
+
+	if (XYZ.X <= 0 || XYZ.Y <= 0 || XYZ.Z <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid ThreadGroupCount %s"), *XYZ.ToString());
+		return false;
+	}
+
+	if (!Compushady::Utils::ValidateResourceBindings(ResourceArray, Compute->ResourceBindings, ErrorMessages))
+	{
+		return false;
+	}
+
+	TArray<FCompushadyRDGResourceAccess> Accesses;
+	if (!CollectResourceAccesses(ResourceArray, Accesses, ErrorMessages))
+	{
+		return false;
+	}
+
+	// CBVs live outside of the graph, so they can be synced immediately
+	TArray<FUniformBufferRHIRef> CBVs;
+	for (UCompushadyCBV* CBV : ResourceArray.CBVs)
+	{
+		if (CBV->BufferDataIsDirty())
+		{
+			CBV->SyncBufferData(GraphBuilder.RHICmdList);
+		}
+		CBVs.Add(CBV->GetRHI());
+	}
+
+	TArray<FShaderResourceViewRHIRef> SRVs;
+	TArray<FRHITransitionInfo> AccelerationStructureTransitions;
+	for (UCompushadySRV* SRV : ResourceArray.SRVs)
+	{
+		if (SRV->IsAccelerationStructure())
+		{
+			AccelerationStructureTransitions.Add(SRV->GetRHITransitionInfo());
+		}
+		SRVs.Add(SRV->GetRHI());
+	}
+
+	TArray<FUnorderedAccessViewRHIRef> UAVs;
+	for (UCompushadyUAV* UAV : ResourceArray.UAVs)
+	{
+		UAVs.Add(UAV->GetRHI());
+		UAV->IncrementVersion();
+	}
+
+	TArray<FSamplerStateRHIRef> Samplers;
+	for (UCompushadySampler* Sampler : ResourceArray.Samplers)
+	{
+		Samplers.Add(Sampler->GetRHI());
+	}
+
+	FCompushadyRDGComputePassParameters* PassParameters = CreatePassParameters(GraphBuilder, Accesses);
+
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("Compushady::RDG::AddComputePass"),
+		PassParameters,
+		ERDGPassFlags::Compute,
+		[ComputeShaderRef = Compute->GetRHI(), ResourceBindings = Compute->ResourceBindings, CBVs, SRVs, UAVs, Samplers, AccelerationStructureTransitions, XYZ](FRHICommandList& RHICmdList)
+		{
+			// the render graph transitions only the textures and buffers
+			for (const FRHITransitionInfo& TransitionInfo : AccelerationStructureTransitions)
+			{
+				RHICmdList.Transition(TransitionInfo);
+			}
+
+			SetComputePipelineState(RHICmdList, ComputeShaderRef);
+			Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, ComputeShaderRef, ResourceBindings,
+				[&CBVs](const int32 Index)
+				{
+					return CBVs[Index];
+				},
+				[&SRVs](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+				{
+					return { SRVs[Index], nullptr };
+				},
+				[&UAVs](const int32 Index)
+				{
+					return UAVs[Index];
+				},
+				[&Samplers](const int32 Index)
+				{
+					return Samplers[Index];
+				}, false);
+
+			RHICmdList.DispatchComputeShader(XYZ.X, XYZ.Y, XYZ.Z);
+		});
+
+	return true;
+}
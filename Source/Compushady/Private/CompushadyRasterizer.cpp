@@ -4,8 +4,42 @@
 #include "CompushadyRasterizer.h"
 #include "CommonRenderResources.h"
 #include "Compushady.h"
+#include "PipelineStateCache.h"
 #include "Serialization/ArrayWriter.h"
 
+FCompushadyRasterizerPipelineStateKey::FCompushadyRasterizerPipelineStateKey()
+{
+	FMemory::Memzero(this, sizeof(FCompushadyRasterizerPipelineStateKey));
+}
+
+FCompushadyRasterizerPipelineStateKey::FCompushadyRasterizerPipelineStateKey(const FGraphicsPipelineStateInitializer& PipelineStateInitializer)
+{
+	// zero the padding too, so the whole struct can be hashed and compared
+	FMemory::Memzero(this, sizeof(FCompushadyRasterizerPipelineStateKey));
+
+	RenderTargetsEnabled = PipelineStateInitializer.RenderTargetsEnabled;
+	for (uint32 RenderTargetIndex = 0; RenderTargetIndex < RenderTargetsEnabled && RenderTargetIndex < MaxSimultaneousRenderTargets; RenderTargetIndex++)
+	{
+		RenderTargetFormats[RenderTargetIndex] = static_cast<uint8>(PipelineStateInitializer.RenderTargetFormats[RenderTargetIndex]);
+		RenderTargetFlags[RenderTargetIndex] = static_cast<uint64>(PipelineStateInitializer.RenderTargetFlags[RenderTargetIndex]);
+	}
+	DepthStencilTargetFormat = static_cast<uint8>(PipelineStateInitializer.DepthStencilTargetFormat);
+	DepthStencilTargetFlag = static_cast<uint64>(PipelineStateInitializer.DepthStencilTargetFlag);
+	DepthTargetLoadAction = static_cast<uint8>(PipelineStateInitializer.DepthTargetLoadAction);
+	DepthTargetStoreAction = static_cast<uint8>(PipelineStateInitializer.DepthTargetStoreAction);
+	StencilTargetLoadAction = static_cast<uint8>(PipelineStateInitializer.StencilTargetLoadAction);
+	StencilTargetStoreAction = static_cast<uint8>(PipelineStateInitializer.StencilTargetStoreAction);
+	DepthStencilAccess = PipelineStateInitializer.DepthStencilAccess.GetIndex();
+	NumSamples = PipelineStateInitializer.NumSamples;
+
+	Hash = FCrc::MemCrc32(this, STRUCT_OFFSET(FCompushadyRasterizerPipelineStateKey, Hash));
+}
+
+bool FCompushadyRasterizerPipelineStateKey::operator==(const FCompushadyRasterizerPipelineStateKey& Other) const
+{
+	return FMemory::Memcmp(this, &Other, sizeof(FCompushadyRasterizerPipelineStateKey)) == 0;
+}
+
 bool UCompushadyRasterizer::InitVSPSFromHLSL(const TArray<uint8>& VertexShaderCode, const FString& VertexShaderEntryPoint, const TArray<uint8>& PixelShaderCode, const FString& PixelShaderEntryPoint, const FCompushadyRasterizerConfig& RasterizerConfig, FString& ErrorMessages)
 {
 	VertexShaderRef = Compushady::Utils::CreateVertexShaderFromHLSL(VertexShaderCode, VertexShaderEntryPoint, VSResourceBindings, ErrorMessages);
@@ -89,6 +123,8 @@ void UCompushadyRasterizer::FillPipelineStateInitializer(const FCompushadyRaster
 {
 	Compushady::Utils::FillRasterizerPipelineStateInitializer(RasterizerConfig, PipelineStateInitializer);
 
+	ResetPipelineStateCache();
+
 	static int32 Denominators[] = { 3, 2, 1 };
 	DrawDenominator = Denominators[static_cast<int32>(RasterizerConfig.PrimitiveType)];
 }
@@ -375,6 +411,8 @@ bool UCompushadyRasterizer::ClearAndDrawByMapSync(const TMap<FString, TScriptInt
 
 void UCompushadyRasterizer::SetupRasterization_RenderThread(FRHICommandListImmediate& RHICmdList, const FCompushadyRasterizeConfig& RasterizeConfig, const int32 Width, const int32 Height)
 {
+	NumRenderPasses++;
+
 	float ViewportMinX = RasterizeConfig.Viewport.Min.X > 0 ? RasterizeConfig.Viewport.Min.X : 0;
 	float ViewportMinY = RasterizeConfig.Viewport.Min.Y > 0 ? RasterizeConfig.Viewport.Min.Y : 0;
 	float ViewportMinZ = RasterizeConfig.Viewport.Min.Z > 0 ? RasterizeConfig.Viewport.Min.Z : 0;
@@ -385,9 +423,142 @@ void UCompushadyRasterizer::SetupRasterization_RenderThread(FRHICommandListImmed
 	RHICmdList.SetViewport(ViewportMinX, ViewportMinY, ViewportMinZ, ViewportMaxX, ViewportMaxY, ViewportMaxZ);
 	RHICmdList.SetScissorRect(RasterizeConfig.Scissor.GetArea() > 0, RasterizeConfig.Scissor.Min.X, RasterizeConfig.Scissor.Min.Y, RasterizeConfig.Scissor.Max.X, RasterizeConfig.Scissor.Max.Y);
 
+	SetGraphicsPipelineState_RenderThread(RHICmdList, RasterizeConfig.StencilValue);
+}
+
+void UCompushadyRasterizer::SetGraphicsPipelineState_RenderThread(FRHICommandList& RHICmdList, const uint32 StencilValue)
+{
 	RHICmdList.ApplyCachedRenderTargets(PipelineStateInitializer);
 
-	SetGraphicsPipelineState(RHICmdList, PipelineStateInitializer, RasterizeConfig.StencilValue);
+	FGraphicsPipelineState* PipelineState = bUsePipelineStateCache ? PipelineStateCache->GetPipelineState(RHICmdList, PipelineStateInitializer) : nullptr;
+	if (!PipelineState)
+	{
+		SetGraphicsPipelineState(RHICmdList, PipelineStateInitializer, StencilValue);
+		return;
+	}
+
+	FRHIGraphicsPipelineState* RHIPipelineState = ExecuteSetGraphicsPipelineState(PipelineState);
+	RHICmdList.SetGraphicsPipelineState(RHIPipelineState, PipelineStateInitializer.BoundShaderState, StencilValue, true);
+}
+
+FGraphicsPipelineState* FCompushadyRasterizerPipelineStateCache::GetPipelineState(FRHICommandList& RHICmdList, const FGraphicsPipelineStateInitializer& Initializer)
+{
+	// the shaders and the rasterizer config never change, so only the render targets part needs to be checked
+	const FCompushadyRasterizerPipelineStateKey Key(Initializer);
+	if (LastPipelineState && LastFrameCounter == GFrameCounterRenderThread && Key == LastKey)
+	{
+		return LastPipelineState;
+	}
+
+	const FGraphicsPipelineStateInitializer* CachedInitializer = Initializers.Find(Key);
+	if (!CachedInitializer)
+	{
+		CachedInitializer = &Initializers.Add(Key, Initializer);
+	}
+
+	LastPipelineState = PipelineStateCache::GetAndOrCreateGraphicsPipelineState(RHICmdList, *CachedInitializer, EApplyRendertargetOption::DoNothing);
+	LastKey = Key;
+	LastFrameCounter = GFrameCounterRenderThread;
+
+	return LastPipelineState;
+}
+
+void FCompushadyRasterizerPipelineStateCache::Precache(FRHICommandList& RHICmdList, const FGraphicsPipelineStateInitializer& Initializer)
+{
+	const FCompushadyRasterizerPipelineStateKey Key(Initializer);
+	if (Initializers.Contains(Key))
+	{
+		return;
+	}
+
+	if (PipelineStateCache::GetAndOrCreateGraphicsPipelineState(RHICmdList, Initializer, EApplyRendertargetOption::DoNothing))
+	{
+		Initializers.Add(Key, Initializer);
+	}
+}
+
+void FCompushadyRasterizerPipelineStateCache::Reset()
+{
+	Initializers.Empty();
+	LastPipelineState = nullptr;
+}
+
+void UCompushadyRasterizer::ResetPipelineStateCache()
+{
+	ENQUEUE_RENDER_COMMAND(DoCompushadyResetPipelineStateCache)(
+		[Cache = PipelineStateCache](FRHICommandListImmediate& RHICmdList)
+		{
+			Cache->Reset();
+		});
+}
+
+/* Applies the render targets of a render pass to the initializer, like FRHICommandList::ApplyCachedRenderTargets does for the current one */
+static void CompushadyApplyRenderTargets(const FRHIRenderPassInfo& Info, FGraphicsPipelineStateInitializer& Initializer)
+{
+	FRHISetRenderTargetsInfo RenderTargetsInfo;
+	Info.ConvertToRenderTargetsInfo(RenderTargetsInfo);
+
+	Initializer.RenderTargetsEnabled = RenderTargetsInfo.NumColorRenderTargets;
+	for (int32 RenderTargetIndex = 0; RenderTargetIndex < RenderTargetsInfo.NumColorRenderTargets; RenderTargetIndex++)
+	{
+		FRHITexture* Texture = RenderTargetsInfo.ColorRenderTarget[RenderTargetIndex].Texture;
+		Initializer.RenderTargetFormats[RenderTargetIndex] = Texture ? UE_PIXELFORMAT_TO_UINT8(Texture->GetFormat()) : UE_PIXELFORMAT_TO_UINT8(PF_Unknown);
+		Initializer.RenderTargetFlags[RenderTargetIndex] = Texture ? Texture->GetFlags() : TexCreate_None;
+		if (Texture)
+		{
+			Initializer.NumSamples = Texture->GetNumSamples();
+		}
+	}
+
+	const FRHIDepthRenderTargetView& DepthStencilTarget = RenderTargetsInfo.DepthStencilRenderTarget;
+	Initializer.DepthStencilTargetFormat = DepthStencilTarget.Texture ? DepthStencilTarget.Texture->GetFormat() : PF_Unknown;
+	Initializer.DepthStencilTargetFlag = DepthStencilTarget.Texture ? DepthStencilTarget.Texture->GetFlags() : TexCreate_None;
+	Initializer.DepthTargetLoadAction = DepthStencilTarget.DepthLoadAction;
+	Initializer.DepthTargetStoreAction = DepthStencilTarget.DepthStoreAction;
+	Initializer.StencilTargetLoadAction = DepthStencilTarget.StencilLoadAction;
+	Initializer.StencilTargetStoreAction = DepthStencilTarget.GetStencilStoreAction();
+	Initializer.DepthStencilAccess = DepthStencilTarget.GetDepthStencilAccess();
+	if (DepthStencilTarget.Texture)
+	{
+		Initializer.NumSamples = DepthStencilTarget.Texture->GetNumSamples();
+	}
+}
+
+void UCompushadyRasterizer::PrecachePipelineStates(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV)
+{
+	TStaticArray<FRHITexture*, 8> RenderTargets = {};
+	int32 RenderTargetsEnabled = 0;
+	FRHITexture* DepthStencilTexture = nullptr;
+	if (!SetupRenderTargets(RTVs, DSV, RenderTargets, RenderTargetsEnabled, DepthStencilTexture))
+	{
+		return;
+	}
+
+	// the render targets state is computed from the render pass info, without recording a render pass
+	FGraphicsPipelineStateInitializer PrecacheInitializer = PipelineStateInitializer;
+	ENQUEUE_RENDER_COMMAND(DoCompushadyPrecachePipelineStates)(
+		[Cache = PipelineStateCache, PrecacheInitializer, RenderTargets, RenderTargetsEnabled, DepthStencilTexture](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			// the Clear* variants only differ in the depth/stencil load actions
+			for (const EDepthStencilTargetActions DepthStencilAction : { EDepthStencilTargetActions::LoadDepthStencil_StoreDepthStencil, EDepthStencilTargetActions::ClearDepthStencil_StoreDepthStencil })
+			{
+				FRHIRenderPassInfo Info;
+				uint32 Width = 0;
+				uint32 Height = 0;
+				if (!GetRenderPassInfo(RenderTargets, RenderTargetsEnabled, DepthStencilTexture, ERenderTargetActions::Load_Store, DepthStencilAction, Info, Width, Height))
+				{
+					return;
+				}
+
+				CompushadyApplyRenderTargets(Info, PrecacheInitializer);
+				Cache->Precache(RHICmdList, PrecacheInitializer);
+
+				if (!DepthStencilTexture)
+				{
+					break;
+				}
+			}
+		});
 }
 
 void UCompushadyRasterizer::DrawIndirect(const FCompushadyResourceArray& VSResourceArray, const FCompushadyResourceArray& PSResourceArray, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, UCompushadyResource* CommandBuffer, const int32 Offset, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled)
@@ -452,6 +623,193 @@ void UCompushadyRasterizer::DrawIndirect(const FCompushadyResourceArray& VSResou
 		}, OnSignaled);
 }
 
+void UCompushadyRasterizer::DrawBatch(const TArray<FCompushadyDrawItem>& DrawItems, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled)
+{
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The Rasterizer is already running");
+		return;
+	}
+
+	if (DrawItems.Num() == 0)
+	{
+		OnSignaled.ExecuteIfBound(false, "Empty DrawItems");
+		return;
+	}
+
+	FString ErrorMessages;
+	for (int32 DrawItemIndex = 0; DrawItemIndex < DrawItems.Num(); DrawItemIndex++)
+	{
+		const FCompushadyDrawItem& DrawItem = DrawItems[DrawItemIndex];
+		if (DrawItem.NumVertices <= 0)
+		{
+			OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid number of vertices %d for DrawItem %d"), DrawItem.NumVertices, DrawItemIndex));
+			return;
+		}
+
+		if (DrawItem.NumInstances <= 0)
+		{
+			OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid number of instances %d for DrawItem %d"), DrawItem.NumInstances, DrawItemIndex));
+			return;
+		}
+
+		if (DrawItem.FirstVertex < 0)
+		{
+			OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid first vertex %d for DrawItem %d"), DrawItem.FirstVertex, DrawItemIndex));
+			return;
+		}
+
+		if (!Compushady::Utils::ValidateResourceBindings(DrawItem.VSResourceArray, VSResourceBindings, ErrorMessages))
+		{
+			OnSignaled.ExecuteIfBound(false, ErrorMessages);
+			return;
+		}
+
+		if (!Compushady::Utils::ValidateResourceBindings(DrawItem.PSResourceArray, PSResourceBindings, ErrorMessages))
+		{
+			OnSignaled.ExecuteIfBound(false, ErrorMessages);
+			return;
+		}
+	}
+
+	TStaticArray<FRHITexture*, 8> RenderTargets = {};
+	int32 RenderTargetsEnabled = 0;
+	FRHITexture* DepthStencilTexture = nullptr;
+	if (!SetupRenderTargets(RTVs, DSV, RenderTargets, RenderTargetsEnabled, DepthStencilTexture))
+	{
+		OnSignaled.ExecuteIfBound(false, "Invalid RTVs");
+		return;
+	}
+
+	for (const FCompushadyDrawItem& DrawItem : DrawItems)
+	{
+		TrackResources(DrawItem.VSResourceArray);
+		TrackResources(DrawItem.PSResourceArray);
+	}
+
+	EnqueueToGPU(
+		[this, DrawItems, RenderTargets, RenderTargetsEnabled, DepthStencilTexture, RasterizeConfig](FRHICommandListImmediate& RHICmdList)
+		{
+			DrawBatch_RenderThread(RHICmdList, DrawItems, RenderTargets, RenderTargetsEnabled, DepthStencilTexture, RasterizeConfig);
+		}, OnSignaled);
+}
+
+static bool CompushadySameResourceArray(const FCompushadyResourceArray& ResourceArray, const FCompushadyResourceArray& OtherResourceArray)
+{
+	return ResourceArray.CBVs == OtherResourceArray.CBVs && ResourceArray.SRVs == OtherResourceArray.SRVs && ResourceArray.UAVs == OtherResourceArray.UAVs && ResourceArray.Samplers == OtherResourceArray.Samplers;
+}
+
+void UCompushadyRasterizer::DrawBatch_RenderThread(FRHICommandListImmediate& RHICmdList, const TArray<FCompushadyDrawItem>& DrawItems, const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const FCompushadyRasterizeConfig& RasterizeConfig)
+{
+	uint32 Width = 0;
+	uint32 Height = 0;
+
+	if (!BeginRenderPass_RenderThread(TEXT("UCompushadyRasterizer::DrawBatch"), RHICmdList, RenderTargets, RenderTargetsEnabled, DepthStencilTexture, ERenderTargetActions::Load_Store, EDepthStencilTargetActions::LoadDepthStencil_StoreDepthStencil, Width, Height))
+	{
+		return;
+	}
+
+	SetupRasterization_RenderThread(RHICmdList, RasterizeConfig, Width, Height);
+
+	for (int32 DrawItemIndex = 0; DrawItemIndex < DrawItems.Num(); DrawItemIndex++)
+	{
+		const FCompushadyDrawItem& DrawItem = DrawItems[DrawItemIndex];
+
+		if (DrawItemIndex == 0 || !CompushadySameResourceArray(DrawItem.VSResourceArray, DrawItems[DrawItemIndex - 1].VSResourceArray))
+		{
+			Compushady::Utils::SetupPipelineParameters(RHICmdList, VertexShaderRef, DrawItem.VSResourceArray, VSResourceBindings, true);
+		}
+
+		if (DrawItemIndex == 0 || !CompushadySameResourceArray(DrawItem.PSResourceArray, DrawItems[DrawItemIndex - 1].PSResourceArray))
+		{
+			Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, DrawItem.PSResourceArray, PSResourceBindings, {}, true);
+		}
+
+		RHICmdList.DrawPrimitive(DrawItem.FirstVertex, DrawItem.NumVertices / DrawDenominator, DrawItem.NumInstances);
+	}
+
+	RHICmdList.EndRenderPass();
+}
+
+void UCompushadyRasterizer::DrawIndirectBatch(const FCompushadyResourceArray& VSResourceArray, const FCompushadyResourceArray& PSResourceArray, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, UCompushadyResource* CommandBuffer, const int32 Offset, const int32 NumDraws, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled)
+{
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The Rasterizer is already running");
+		return;
+	}
+
+	if (!CommandBuffer)
+	{
+		OnSignaled.ExecuteIfBound(false, TEXT("CommandBuffer is NULL"));
+		return;
+	}
+
+	if (NumDraws <= 0)
+	{
+		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid number of draws %d"), NumDraws));
+		return;
+	}
+
+	const int64 RequiredSize = static_cast<int64>(Offset) + static_cast<int64>(NumDraws) * sizeof(FRHIDrawIndirectParameters);
+	if (Offset < 0 || !CommandBuffer->GetBufferRHI() || RequiredSize > CommandBuffer->GetBufferRHI()->GetSize())
+	{
+		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("CommandBuffer is too small for %d draws at offset %d"), NumDraws, Offset));
+		return;
+	}
+
+	FString ErrorMessages;
+	if (!Compushady::Utils::ValidateResourceBindings(VSResourceArray, VSResourceBindings, ErrorMessages))
+	{
+		OnSignaled.ExecuteIfBound(false, ErrorMessages);
+		return;
+	}
+
+	if (!Compushady::Utils::ValidateResourceBindings(PSResourceArray, PSResourceBindings, ErrorMessages))
+	{
+		OnSignaled.ExecuteIfBound(false, ErrorMessages);
+		return;
+	}
+
+	TStaticArray<FRHITexture*, 8> RenderTargets = {};
+	int32 RenderTargetsEnabled = 0;
+	FRHITexture* DepthStencilTexture = nullptr;
+	if (!SetupRenderTargets(RTVs, DSV, RenderTargets, RenderTargetsEnabled, DepthStencilTexture))
+	{
+		OnSignaled.ExecuteIfBound(false, "Invalid RTVs");
+		return;
+	}
+
+	TrackResources(VSResourceArray);
+	TrackResources(PSResourceArray);
+
+	FRHIBuffer* RHICommandBuffer = CommandBuffer->GetBufferRHI();
+	TrackResource(CommandBuffer);
+
+	EnqueueToGPU(
+		[this, VSResourceArray, PSResourceArray, RenderTargets, RenderTargetsEnabled, DepthStencilTexture, RHICommandBuffer, Offset, NumDraws, RasterizeConfig](FRHICommandListImmediate& RHICmdList)
+		{
+			uint32 Width = 0;
+			uint32 Height = 0;
+			if (BeginRenderPass_RenderThread(TEXT("UCompushadyRasterizer::DrawIndirectBatch"), RHICmdList, RenderTargets, RenderTargetsEnabled, DepthStencilTexture, ERenderTargetActions::Load_Store, EDepthStencilTargetActions::LoadDepthStencil_StoreDepthStencil, Width, Height))
+			{
+				SetupRasterization_RenderThread(RHICmdList, RasterizeConfig, Width, Height);
+
+				Compushady::Utils::SetupPipelineParameters(RHICmdList, VertexShaderRef, VSResourceArray, VSResourceBindings, true);
+				Compushady::Utils::SetupPipelineParameters(RHICmdList, PixelShaderRef, PSResourceArray, PSResourceBindings, {}, true);
+
+				// the RHI does not expose a non-indexed multi draw indirect, so the draws are issued one by one in the same pass
+				for (int32 DrawIndex = 0; DrawIndex < NumDraws; DrawIndex++)
+				{
+					RHICmdList.DrawPrimitiveIndirect(RHICommandBuffer, Offset + DrawIndex * sizeof(FRHIDrawIndirectParameters));
+				}
+
+				RHICmdList.EndRenderPass();
+			}
+
+		}, OnSignaled);
+}
+
 bool UCompushadyRasterizer::SetupRenderTargets(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV, TStaticArray<FRHITexture*, 8>& RenderTargets, int32& RenderTargetsEnabled, FRHITexture*& DepthStencilTexture)
 {
 	for (int32 Index = 0; Index < RTVs.Num(); Index++)
@@ -463,32 +821,24 @@ bool UCompushadyRasterizer::SetupRenderTargets(const TArray<UCompushadyRTV*>& RT
 		RenderTargets[Index] = RTVs[Index]->GetTextureRHI();
 		RenderTargetsEnabled++;
 		TrackResource(RTVs[Index]);
+		RTVs[Index]->IncrementVersion();
 	}
 
 	if (DSV)
 	{
 		DepthStencilTexture = DSV->GetTextureRHI();
 		TrackResource(DSV);
+		DSV->IncrementVersion();
 	}
 
 	return true;
 }
 
-bool UCompushadyRasterizer::BeginRenderPass_RenderThread(const TCHAR* Name, FRHICommandListImmediate& RHICmdList, const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const ERenderTargetActions ColorAction, const EDepthStencilTargetActions DepthStencilAction, uint32& Width, uint32& Height)
+bool UCompushadyRasterizer::GetRenderPassInfo(const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const ERenderTargetActions ColorAction, const EDepthStencilTargetActions DepthStencilAction, FRHIRenderPassInfo& Info, uint32& Width, uint32& Height)
 {
-	for (int32 RenderTargetIndex = 0; RenderTargetIndex < RenderTargetsEnabled; RenderTargetIndex++)
-	{
-		RHICmdList.Transition(FRHITransitionInfo(RenderTargets[RenderTargetIndex], ERHIAccess::Unknown, ERHIAccess::RTV));
-	}
-
-	if (DepthStencilTexture)
-	{
-		RHICmdList.Transition(FRHITransitionInfo(DepthStencilTexture, ERHIAccess::Unknown, ERHIAccess::DSVRead | ERHIAccess::DSVWrite));
-	}
-
 	if (RenderTargetsEnabled > 0 && DepthStencilTexture)
 	{
-		FRHIRenderPassInfo Info(RenderTargetsEnabled,
+		Info = FRHIRenderPassInfo(RenderTargetsEnabled,
 			const_cast<FRHITexture**>(RenderTargets.GetData()),
 			ColorAction,
 			DepthStencilTexture,
@@ -496,34 +846,53 @@ bool UCompushadyRasterizer::BeginRenderPass_RenderThread(const TCHAR* Name, FRHI
 			FExclusiveDepthStencil::DepthWrite_StencilWrite);
 		Width = RenderTargets[0]->GetSizeX();
 		Height = RenderTargets[0]->GetSizeY();
-		RHICmdList.BeginRenderPass(Info, Name);
 		return true;
 	}
 	else if (RenderTargetsEnabled > 0)
 	{
-		FRHIRenderPassInfo Info(RenderTargetsEnabled,
+		Info = FRHIRenderPassInfo(RenderTargetsEnabled,
 			const_cast<FRHITexture**>(RenderTargets.GetData()),
 			ColorAction);
 		Width = RenderTargets[0]->GetSizeX();
 		Height = RenderTargets[0]->GetSizeY();
-		RHICmdList.BeginRenderPass(Info, Name);
 		return true;
 	}
 	else if (DepthStencilTexture)
 	{
-		FRHIRenderPassInfo Info(DepthStencilTexture,
+		Info = FRHIRenderPassInfo(DepthStencilTexture,
 			DepthStencilAction,
 			nullptr,
 			FExclusiveDepthStencil::DepthWrite_StencilWrite);
 		Width = DepthStencilTexture->GetSizeX();
 		Height = DepthStencilTexture->GetSizeY();
-		RHICmdList.BeginRenderPass(Info, Name);
 		return true;
 	}
 
 	return false;
 }
 
+bool UCompushadyRasterizer::BeginRenderPass_RenderThread(const TCHAR* Name, FRHICommandListImmediate& RHICmdList, const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const ERenderTargetActions ColorAction, const EDepthStencilTargetActions DepthStencilAction, uint32& Width, uint32& Height)
+{
+	FRHIRenderPassInfo Info;
+	if (!GetRenderPassInfo(RenderTargets, RenderTargetsEnabled, DepthStencilTexture, ColorAction, DepthStencilAction, Info, Width, Height))
+	{
+		return false;
+	}
+
+	for (int32 RenderTargetIndex = 0; RenderTargetIndex < RenderTargetsEnabled; RenderTargetIndex++)
+	{
+		RHICmdList.Transition(FRHITransitionInfo(RenderTargets[RenderTargetIndex], ERHIAccess::Unknown, ERHIAccess::RTV));
+	}
+
+	if (DepthStencilTexture)
+	{
+		RHICmdList.Transition(FRHITransitionInfo(DepthStencilTexture, ERHIAccess::Unknown, ERHIAccess::DSVRead | ERHIAccess::DSVWrite));
+	}
+
+	RHICmdList.BeginRenderPass(Info, Name);
+	return true;
+}
+
 void UCompushadyRasterizer::Clear(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV, const FCompushadySignaled& OnSignaled)
 {
 	if (IsRunning())
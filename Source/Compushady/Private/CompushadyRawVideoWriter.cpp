@@ -0,0 +1,689 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+
+#include "CompushadyRawVideoWriter.h"
+#include "HAL/PlatformFileManager.h"
+#include "RHIGPUReadback.h"
+
+namespace Compushady
+{
+	namespace Video
+	{
+		/*
+		 * Every thread of main converts a block of 8x2 pixels, so luma and chroma are always written as whole uints.
+		 * main_nv12_texture converts a block of 2x2 pixels to the planes of an NV12 texture.
+		 */
+		static const TCHAR* YUVConverterShaderCode =
+			TEXT("Texture2D<float4> source;")
+			TEXT("RWBuffer<uint> output;")
+			TEXT("RWTexture2D<float> luma_plane;")
+			TEXT("RWTexture2D<float2> chroma_plane;")
+			TEXT("cbuffer Config")
+			TEXT("{")
+			TEXT("uint4 size;")
+			TEXT("uint4 format;")
+			TEXT("float4 y_coeffs;")
+			TEXT("float4 u_coeffs;")
+			TEXT("float4 v_coeffs;")
+			TEXT("};")
+			TEXT("float3 load_rgb(uint2 xy)")
+			TEXT("{")
+			TEXT("float3 rgb = saturate(source.Load(int3(min(xy, size.xy - 1), 0)).rgb);")
+			TEXT("if (format.z)")
+			TEXT("{")
+			TEXT("rgb = lerp(rgb * 12.92, 1.055 * pow(rgb, 1.0 / 2.4) - 0.055, step(0.0031308, rgb));")
+			TEXT("}")
+			TEXT("return rgb;")
+			TEXT("}")
+			TEXT("uint to_byte(float value)")
+			TEXT("{")
+			TEXT("return (uint)clamp(round(value * 255.0), 0.0, 255.0);")
+			TEXT("}")
+			TEXT("[numthreads(8, 8, 1)]")
+			TEXT("void main(uint3 tid : SV_DispatchThreadID)")
+			TEXT("{")
+			TEXT("uint2 origin = tid.xy * uint2(8, 2);")
+			TEXT("if (origin.x >= size.z || origin.y >= size.y)")
+			TEXT("{")
+			TEXT("return;")
+			TEXT("}")
+			TEXT("uint4 luma = uint4(0, 0, 0, 0);")
+			TEXT("uint4 chroma_u = uint4(0, 0, 0, 0);")
+			TEXT("uint4 chroma_v = uint4(0, 0, 0, 0);")
+			TEXT("for (uint block = 0; block < 4; block++)")
+			TEXT("{")
+			TEXT("float3 rgb_sum = float3(0, 0, 0);")
+			TEXT("for (uint i = 0; i < 4; i++)")
+			TEXT("{")
+			TEXT("float3 rgb = load_rgb(origin + uint2(block * 2 + (i & 1), i >> 1));")
+			TEXT("rgb_sum += rgb;")
+			TEXT("luma[(i >> 1) * 2 + (block >> 1)] |= to_byte(dot(rgb, y_coeffs.xyz) + y_coeffs.w) << (((block & 1) * 2 + (i & 1)) * 8);")
+			TEXT("}")
+			TEXT("float3 rgb_avg = rgb_sum * 0.25;")
+			TEXT("chroma_u[block] = to_byte(dot(rgb_avg, u_coeffs.xyz) + u_coeffs.w);")
+			TEXT("chroma_v[block] = to_byte(dot(rgb_avg, v_coeffs.xyz) + v_coeffs.w);")
+			TEXT("}")
+			TEXT("uint luma_index = (origin.y * size.z + origin.x) / 4;")
+			TEXT("output[luma_index] = luma.x;")
+			TEXT("output[luma_index + 1] = luma.y;")
+			TEXT("output[luma_index + size.z / 4] = luma.z;")
+			TEXT("output[luma_index + size.z / 4 + 1] = luma.w;")
+			TEXT("if (format.x)")
+			TEXT("{")
+			TEXT("uint uv_index = (size.w + tid.y * size.z + tid.x * 8) / 4;")
+			TEXT("output[uv_index] = chroma_u.x | (chroma_v.x << 8) | (chroma_u.y << 16) | (chroma_v.y << 24);")
+			TEXT("output[uv_index + 1] = chroma_u.z | (chroma_v.z << 8) | (chroma_u.w << 16) | (chroma_v.w << 24);")
+			TEXT("}")
+			TEXT("else")
+			TEXT("{")
+			TEXT("uint chroma_offset = tid.y * (size.z / 2) + tid.x * 4;")
+			TEXT("output[(size.w + chroma_offset) / 4] = chroma_u.x | (chroma_u.y << 8) | (chroma_u.z << 16) | (chroma_u.w << 24);")
+			TEXT("output[(format.y + chroma_offset) / 4] = chroma_v.x | (chroma_v.y << 8) | (chroma_v.z << 16) | (chroma_v.w << 24);")
+			TEXT("}")
+			TEXT("}")
+			TEXT("[numthreads(8, 8, 1)]")
+			TEXT("void main_nv12_texture(uint3 tid : SV_DispatchThreadID)")
+			TEXT("{")
+			TEXT("uint2 origin = tid.xy * 2;")
+			TEXT("if (origin.x >= size.x || origin.y >= size.y)")
+			TEXT("{")
+			TEXT("return;")
+			TEXT("}")
+			TEXT("float3 rgb_sum = float3(0, 0, 0);")
+			TEXT("for (uint i = 0; i < 4; i++)")
+			TEXT("{")
+			TEXT("uint2 xy = origin + uint2(i & 1, i >> 1);")
+			TEXT("float3 rgb = load_rgb(xy);")
+			TEXT("rgb_sum += rgb;")
+			TEXT("luma_plane[xy] = dot(rgb, y_coeffs.xyz) + y_coeffs.w;")
+			TEXT("}")
+			TEXT("float3 rgb_avg = rgb_sum * 0.25;")
+			TEXT("chroma_plane[tid.xy] = float2(dot(rgb_avg, u_coeffs.xyz) + u_coeffs.w, dot(rgb_avg, v_coeffs.xyz) + v_coeffs.w);")
+			TEXT("}");
+
+		struct FCompushadyYUVConverterConfig
+		{
+			FUintVector4 Size = FUintVector4(0, 0, 0, 0); // width, height, luma pitch, chroma (U or UV) offset
+			FUintVector4 Format = FUintVector4(0, 0, 0, 0); // x nv12, y V offset, z linear source
+			FVector4f Y = FVector4f::Zero();
+			FVector4f U = FVector4f::Zero();
+			FVector4f V = FVector4f::Zero();
+		};
+
+		struct FCompushadyRawVideoCapture
+		{
+			FCompushadyYUVFrameLayout Layout;
+			FCompushadyYUVConverter Converter;
+			TSharedPtr<FCompushadyRawVideoFileSink> Sink;
+			FBufferRHIRef BufferRHIRef;
+			FUnorderedAccessViewRHIRef UAVRHIRef;
+			std::atomic<int32> NumInFlight{ 0 };
+
+			// render thread only
+			TArray<TUniquePtr<FRHIGPUBufferReadback>> Readbacks;
+			uint32 ReadIndex = 0;
+			uint32 WriteIndex = 0;
+
+			/* Frames are completed in order, without waiting for the GPU unless bWait is set */
+			void CompleteFrames_RenderThread(FRHICommandListImmediate& RHICmdList, const bool bWait)
+			{
+				if (bWait && ReadIndex != WriteIndex)
+				{
+					RHICmdList.BlockUntilGPUIdle();
+				}
+
+				while (ReadIndex != WriteIndex)
+				{
+					FRHIGPUBufferReadback& Readback = *Readbacks[ReadIndex % Readbacks.Num()];
+					// after waiting for the GPU a readback that is still not ready is lost
+					if (!Readback.IsReady() && !bWait)
+					{
+						break;
+					}
+
+					const uint32 NumBytes = static_cast<uint32>(Layout.GetFrameSize());
+					if (const void* Data = Readback.IsReady() ? Readback.Lock(NumBytes) : nullptr)
+					{
+						TArray<uint8> Frame;
+						Frame.Append(reinterpret_cast<const uint8*>(Data), NumBytes);
+						Readback.Unlock();
+						Sink->Enqueue(MoveTemp(Frame));
+					}
+					else
+					{
+						Sink->AddDroppedFrame();
+					}
+
+					ReadIndex++;
+					NumInFlight--;
+				}
+			}
+		};
+	}
+}
+
+Compushady::Video::FCompushadyYUVCoefficients Compushady::Video::FCompushadyYUVCoefficients::Get(const ECompushadyYUVMatrix Matrix)
+{
+	const float KR = Matrix == ECompushadyYUVMatrix::BT601 ? 0.299f : 0.2126f;
+	const float KB = Matrix == ECompushadyYUVMatrix::BT601 ? 0.114f : 0.0722f;
+	const float KG = 1.0f - KR - KB;
+
+	constexpr float LumaScale = 219.0f / 255.0f;
+	constexpr float ChromaScale = 224.0f / 255.0f;
+
+	FCompushadyYUVCoefficients Coefficients;
+	Coefficients.Y = FVector4f(KR * LumaScale, KG * LumaScale, KB * LumaScale, 16.0f / 255.0f);
+
+	const float UScale = ChromaScale / (2.0f * (1.0f - KB));
+	Coefficients.U = FVector4f(-KR * UScale, -KG * UScale, (1.0f - KB) * UScale, 128.0f / 255.0f);
+
+	const float VScale = ChromaScale / (2.0f * (1.0f - KR));
+	Coefficients.V = FVector4f((1.0f - KR) * VScale, -KG * VScale, -KB * VScale, 128.0f / 255.0f);
+
+	return Coefficients;
+}
+
+Compushady::Video::FCompushadyYUVFrameLayout::FCompushadyYUVFrameLayout(const int32 InWidth, const int32 InHeight, const ECompushadyYUVFormat InFormat, const int32 PitchAlignment) : Width(InWidth), Height(InHeight), Format(InFormat)
+{
+	Pitch = AlignArbitrary(FMath::Max(Width, 0), FMath::Max(PitchAlignment, 1));
+}
+
+bool Compushady::Video::FCompushadyYUVFrameLayout::IsValid() const
+{
+	return Width > 0 && Height > 0 && (Width % 2) == 0 && (Height % 2) == 0 && Pitch >= Width && (Pitch % 2) == 0;
+}
+
+int32 Compushady::Video::FCompushadyYUVFrameLayout::GetChromaPitch() const
+{
+	return Format == ECompushadyYUVFormat::NV12 ? Pitch : Pitch / 2;
+}
+
+int64 Compushady::Video::FCompushadyYUVFrameLayout::GetLumaSize() const
+{
+	return static_cast<int64>(Pitch) * Height;
+}
+
+int64 Compushady::Video::FCompushadyYUVFrameLayout::GetChromaOffset() const
+{
+	return GetLumaSize();
+}
+
+int64 Compushady::Video::FCompushadyYUVFrameLayout::GetSecondChromaOffset() const
+{
+	if (Format == ECompushadyYUVFormat::NV12)
+	{
+		return INDEX_NONE;
+	}
+	return GetLumaSize() + static_cast<int64>(GetChromaPitch()) * (Height / 2);
+}
+
+int64 Compushady::Video::FCompushadyYUVFrameLayout::GetFrameSize() const
+{
+	// both formats have half of the luma size of chroma
+	return GetLumaSize() + GetLumaSize() / 2;
+}
+
+void Compushady::Video::RGBToYUV(const FLinearColor& Color, const ECompushadyYUVMatrix Matrix, uint8& OutY, uint8& OutU, uint8& OutV)
+{
+	const FCompushadyYUVCoefficients Coefficients = FCompushadyYUVCoefficients::Get(Matrix);
+	const FVector3f RGB(FMath::Clamp(Color.R, 0.0f, 1.0f), FMath::Clamp(Color.G, 0.0f, 1.0f), FMath::Clamp(Color.B, 0.0f, 1.0f));
+
+	auto ToByte = [&RGB](const FVector4f& Row)
+		{
+			const float Value = (RGB.X * Row.X + RGB.Y * Row.Y + RGB.Z * Row.Z + Row.W) * 255.0f;
+			return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Value), 0, 255));
+		};
+
+	OutY = ToByte(Coefficients.Y);
+	OutU = ToByte(Coefficients.U);
+	OutV = ToByte(Coefficients.V);
+}
+
+bool Compushady::Video::ConvertRGBToYUV(const FLinearColor* Pixels, const FCompushadyYUVFrameLayout& Layout, const ECompushadyYUVMatrix Matrix, uint8* Output)
+{
+	if (!Layout.IsValid())
+	{
+		return false;
+	}
+
+	const int32 ChromaPitch = Layout.GetChromaPitch();
+	uint8* Luma = Output;
+	uint8* ChromaU = Output + Layout.GetChromaOffset();
+	uint8* ChromaV = Layout.Format == ECompushadyYUVFormat::NV12 ? ChromaU + 1 : Output + Layout.GetSecondChromaOffset();
+	const int32 ChromaStride = Layout.Format == ECompushadyYUVFormat::NV12 ? 2 : 1;
+
+	for (int32 Y = 0; Y < Layout.Height; Y += 2)
+	{
+		for (int32 X = 0; X < Layout.Width; X += 2)
+		{
+			FLinearColor Sum = FLinearColor::Transparent;
+			for (int32 Index = 0; Index < 4; Index++)
+			{
+				const int32 PixelX = X + (Index & 1);
+				const int32 PixelY = Y + (Index >> 1);
+				// the GPU saturates before averaging
+				const FLinearColor Color = Pixels[PixelY * Layout.Width + PixelX].GetClamped();
+				Sum += Color;
+
+				uint8 Unused;
+				RGBToYUV(Color, Matrix, Luma[PixelY * Layout.Pitch + PixelX], Unused, Unused);
+			}
+
+			uint8 Unused;
+			const int32 ChromaIndex = (Y / 2) * ChromaPitch + (X / 2) * ChromaStride;
+			RGBToYUV(Sum * 0.25f, Matrix, Unused, ChromaU[ChromaIndex], ChromaV[ChromaIndex]);
+		}
+	}
+
+	return true;
+}
+
+void Compushady::Video::WriteY4MHeader(const int32 Width, const int32 Height, const int32 FrameRate, TArray<uint8>& Output)
+{
+	// chroma is sited at the center of each 2x2 block (the jpeg 4:2:0 siting)
+	const FString Header = FString::Printf(TEXT("YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n"), Width, Height, FrameRate);
+	const FTCHARToUTF8 UTF8Header(*Header);
+	Output.Append(reinterpret_cast<const uint8*>(UTF8Header.Get()), UTF8Header.Length());
+}
+
+void Compushady::Video::WriteY4MFrame(const uint8* Frame, const FCompushadyYUVFrameLayout& Layout, TArray<uint8>& Output)
+{
+	static const char FrameHeader[] = "FRAME\n";
+	Output.Append(reinterpret_cast<const uint8*>(FrameHeader), sizeof(FrameHeader) - 1);
+
+	for (int32 Y = 0; Y < Layout.Height; Y++)
+	{
+		Output.Append(Frame + static_cast<int64>(Y) * Layout.Pitch, Layout.Width);
+	}
+
+	const int32 ChromaWidth = Layout.Width / 2;
+	const int32 ChromaHeight = Layout.Height / 2;
+	const int32 ChromaPitch = Layout.GetChromaPitch();
+	const uint8* Chroma = Frame + Layout.GetChromaOffset();
+
+	if (Layout.Format == ECompushadyYUVFormat::NV12)
+	{
+		for (int32 Plane = 0; Plane < 2; Plane++)
+		{
+			for (int32 Y = 0; Y < ChromaHeight; Y++)
+			{
+				const uint8* Row = Chroma + static_cast<int64>(Y) * ChromaPitch + Plane;
+				for (int32 X = 0; X < ChromaWidth; X++)
+				{
+					Output.Add(Row[X * 2]);
+				}
+			}
+		}
+		return;
+	}
+
+	const uint8* ChromaV = Frame + Layout.GetSecondChromaOffset();
+	for (const uint8* Plane : { Chroma, ChromaV })
+	{
+		for (int32 Y = 0; Y < ChromaHeight; Y++)
+		{
+			Output.Append(Plane + static_cast<int64>(Y) * ChromaPitch, ChromaWidth);
+		}
+	}
+}
+
+bool Compushady::Video::FCompushadyYUVConverter::Initialize(const ECompushadyYUVMatrix InMatrix, const bool bInLinearSource, const bool bToTexture, FString& ErrorMessages)
+{
+	FCompushadyResourceBindings NewResourceBindings;
+	FIntVector NewThreadGroupSize;
+	FComputeShaderRHIRef NewComputeShaderRef = Compushady::Utils::CreateComputeShaderFromHLSL(YUVConverterShaderCode, bToTexture ? TEXT("main_nv12_texture") : TEXT("main"), NewResourceBindings, NewThreadGroupSize, ErrorMessages);
+	if (!NewComputeShaderRef)
+	{
+		return false;
+	}
+
+	ComputeShaderRef = NewComputeShaderRef;
+	ResourceBindings = NewResourceBindings;
+	ThreadGroupSize = NewThreadGroupSize;
+
+	FRHIUniformBufferLayoutInitializer LayoutInitializer(nullptr, sizeof(FCompushadyYUVConverterConfig));
+	UniformBufferLayoutRef = RHICreateUniformBufferLayout(LayoutInitializer);
+	UniformBufferRef = RHICreateUniformBuffer(nullptr, UniformBufferLayoutRef, EUniformBufferUsage::UniformBuffer_MultiFrame, EUniformBufferValidation::None);
+
+	Matrix = InMatrix;
+	bLinearSource = bInLinearSource;
+
+	return true;
+}
+
+void Compushady::Video::FCompushadyYUVConverter::ConvertToBuffer_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, FRHIUnorderedAccessView* Output, const FCompushadyYUVFrameLayout& Layout)
+{
+	check(Layout.IsValid() && (Layout.Pitch % 8) == 0);
+
+	Dispatch_RenderThread(RHICmdList, Source, [Output](const int32 Index) -> FUnorderedAccessViewRHIRef
+		{
+			return Output;
+		}, Layout, FIntPoint(Layout.Pitch / 8, Layout.Height / 2));
+}
+
+void Compushady::Video::FCompushadyYUVConverter::ConvertToTexture_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, FRHIUnorderedAccessView* LumaOutput, FRHIUnorderedAccessView* ChromaOutput, const FIntPoint Size)
+{
+	const FCompushadyYUVFrameLayout Layout(Size.X, Size.Y, ECompushadyYUVFormat::NV12);
+	check(Layout.IsValid());
+
+	Dispatch_RenderThread(RHICmdList, Source, [this, LumaOutput, ChromaOutput](const int32 Index) -> FUnorderedAccessViewRHIRef
+		{
+			return ResourceBindings.UAVs[Index].Name == TEXT("luma_plane") ? LumaOutput : ChromaOutput;
+		}, Layout, FIntPoint(Layout.Width / 2, Layout.Height / 2));
+}
+
+void Compushady::Video::FCompushadyYUVConverter::Dispatch_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, TFunction<FUnorderedAccessViewRHIRef(const int32)> UAVFunction, const FCompushadyYUVFrameLayout& Layout, const FIntPoint NumBlocks)
+{
+	const FCompushadyYUVCoefficients Coefficients = FCompushadyYUVCoefficients::Get(Matrix);
+
+	FCompushadyYUVConverterConfig Config;
+	Config.Size = FUintVector4(Layout.Width, Layout.Height, Layout.Pitch, static_cast<uint32>(Layout.GetChromaOffset()));
+	Config.Format = FUintVector4(Layout.Format == ECompushadyYUVFormat::NV12 ? 1 : 0, static_cast<uint32>(FMath::Max<int64>(Layout.GetSecondChromaOffset(), 0)), bLinearSource ? 1 : 0, 0);
+	Config.Y = Coefficients.Y;
+	Config.U = Coefficients.U;
+	Config.V = Coefficients.V;
+
+	RHICmdList.Transition(FRHITransitionInfo(Source, ERHIAccess::Unknown, ERHIAccess::SRVCompute));
+	RHICmdList.UpdateUniformBuffer(UniformBufferRef, &Config);
+
+	SetComputePipelineState(RHICmdList, ComputeShaderRef);
+	Compushady::Utils::SetupPipelineParametersRHI(RHICmdList, ComputeShaderRef, ResourceBindings,
+		[this](const int32 Index)
+		{
+			return UniformBufferRef;
+		},
+		[Source](const int32 Index) -> TPair<FShaderResourceViewRHIRef, FTextureRHIRef>
+		{
+			return { nullptr, Source };
+		},
+		UAVFunction,
+		[](const int32 Index)
+		{
+			return nullptr;
+		}, false);
+
+	RHICmdList.DispatchComputeShader(FMath::DivideAndRoundUp(NumBlocks.X, ThreadGroupSize.X), FMath::DivideAndRoundUp(NumBlocks.Y, ThreadGroupSize.Y), 1);
+}
+
+TSharedPtr<Compushady::Video::FCompushadyRawVideoFileSink> Compushady::Video::FCompushadyRawVideoFileSink::Create(const FString& Filename, const FCompushadyYUVFrameLayout& Layout, const int32 FrameRate, const int32 MaxQueuedFrames, FString& ErrorMessages)
+{
+	if (!Layout.IsValid())
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid frame size %dx%d (width and height must be even)"), Layout.Width, Layout.Height);
+		return nullptr;
+	}
+
+	if (FrameRate <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid FrameRate %d"), FrameRate);
+		return nullptr;
+	}
+
+	if (MaxQueuedFrames <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid MaxQueuedFrames %d"), MaxQueuedFrames);
+		return nullptr;
+	}
+
+	IFileHandle* FileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename);
+	if (!FileHandle)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open %s for writing"), *Filename);
+		return nullptr;
+	}
+
+	TArray<uint8> Header;
+	WriteY4MHeader(Layout.Width, Layout.Height, FrameRate, Header);
+	if (!FileHandle->Write(Header.GetData(), Header.Num()))
+	{
+		delete FileHandle;
+		ErrorMessages = FString::Printf(TEXT("Unable to write to %s"), *Filename);
+		return nullptr;
+	}
+
+	TSharedPtr<FCompushadyRawVideoFileSink> Sink = MakeShareable(new FCompushadyRawVideoFileSink());
+	Sink->Layout = Layout;
+	Sink->HeaderSize = Header.Num();
+	Sink->FileHandle.Reset(FileHandle);
+
+	FCompushadyRawVideoFileSink* SinkPtr = Sink.Get();
+	Sink->Writer = MakeUnique<TCompushadyOrderedWriter<TArray<uint8>>>(MaxQueuedFrames,
+		[SinkPtr](TArray<uint8>& Frame, int64& WrittenBytes)
+		{
+			return SinkPtr->WriteFrame(Frame, WrittenBytes);
+		});
+
+	if (!Sink->Writer->Start(TEXT("CompushadyRawVideoFileSink"), ErrorMessages))
+	{
+		return nullptr;
+	}
+
+	return Sink;
+}
+
+Compushady::Video::FCompushadyRawVideoFileSink::~FCompushadyRawVideoFileSink()
+{
+	Close();
+}
+
+bool Compushady::Video::FCompushadyRawVideoFileSink::Enqueue(TArray<uint8>&& Frame)
+{
+	if (Frame.Num() < Layout.GetFrameSize())
+	{
+		Writer->AddDropped();
+		return false;
+	}
+
+	return Writer->Enqueue(MoveTemp(Frame));
+}
+
+void Compushady::Video::FCompushadyRawVideoFileSink::Close()
+{
+	if (Writer)
+	{
+		Writer->Close();
+	}
+
+	if (FileHandle)
+	{
+		FileHandle->Flush();
+		FileHandle.Reset();
+	}
+}
+
+FCompushadyRawVideoStats Compushady::Video::FCompushadyRawVideoFileSink::GetStats() const
+{
+	FCompushadyRawVideoStats Stats;
+	Stats.QueuedFrames = Writer->NumQueued();
+	Stats.PeakQueuedFrames = Writer->GetPeakQueued();
+	Stats.DroppedFrames = Writer->GetNumDropped() + Writer->GetNumFailed();
+	Stats.WrittenFrames = Writer->GetNumWritten();
+	Stats.WrittenBytes = HeaderSize + Writer->GetWrittenBytes();
+	return Stats;
+}
+
+bool Compushady::Video::FCompushadyRawVideoFileSink::WriteFrame(const TArray<uint8>& Frame, int64& WrittenBytes)
+{
+	WriteBuffer.Reset();
+	WriteY4MFrame(Frame.GetData(), Layout, WriteBuffer);
+	WrittenBytes = WriteBuffer.Num();
+	return FileHandle->Write(WriteBuffer.GetData(), WriteBuffer.Num());
+}
+
+void UCompushadyRawVideoWriter::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	if (Capture)
+	{
+		// the frames in the readbacks are completed without stalling the game thread
+		ENQUEUE_RENDER_COMMAND(DoCompushadyRawVideoDestroy)(
+			[CurrentCapture = Capture](FRHICommandListImmediate& RHICmdList)
+			{
+				CurrentCapture->CompleteFrames_RenderThread(RHICmdList, true);
+			});
+
+		DestroyFence.BeginFence();
+	}
+}
+
+bool UCompushadyRawVideoWriter::IsReadyForFinishDestroy()
+{
+	if (!Super::IsReadyForFinishDestroy())
+	{
+		return false;
+	}
+
+	if (!Capture)
+	{
+		return true;
+	}
+
+	if (!DestroyFence.IsFenceComplete() || Capture->Sink->GetStats().QueuedFrames > 0)
+	{
+		return false;
+	}
+
+	// the writer thread is idle, closing does not block
+	Capture->Sink->Close();
+	Capture = nullptr;
+	return true;
+}
+
+bool UCompushadyRawVideoWriter::Open(const FString& Filename, const int32 Width, const int32 Height, FString& ErrorMessages, const int32 FrameRate, const ECompushadyYUVMatrix Matrix, const bool bLinearSource, const int32 NumReadbacks, const int32 MaxQueuedFrames)
+{
+	Close();
+
+	if (NumReadbacks <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NumReadbacks %d"), NumReadbacks);
+		return false;
+	}
+
+	// the compute conversion writes whole uints of 8 luma pixels
+	const Compushady::Video::FCompushadyYUVFrameLayout Layout(Width, Height, ECompushadyYUVFormat::I420, 8);
+
+	TSharedPtr<Compushady::Video::FCompushadyRawVideoCapture, ESPMode::ThreadSafe> NewCapture = MakeShared<Compushady::Video::FCompushadyRawVideoCapture, ESPMode::ThreadSafe>();
+	NewCapture->Layout = Layout;
+
+	NewCapture->Sink = Compushady::Video::FCompushadyRawVideoFileSink::Create(Filename, Layout, FrameRate, MaxQueuedFrames, ErrorMessages);
+	if (!NewCapture->Sink)
+	{
+		return false;
+	}
+
+	if (!NewCapture->Converter.Initialize(Matrix, bLinearSource, false, ErrorMessages))
+	{
+		return false;
+	}
+
+	const FString Name = GetPathName();
+	const int64 FrameSize = Layout.GetFrameSize();
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRawVideoBuffer)(
+		[NewCapture, Name, FrameSize, NumReadbacks](FRHICommandListImmediate& RHICmdList)
+		{
+			NewCapture->BufferRHIRef = COMPUSHADY_CREATE_BUFFER(*Name, FrameSize, EBufferUsageFlags::ShaderResource | EBufferUsageFlags::UnorderedAccess | EBufferUsageFlags::VertexBuffer, sizeof(uint32), ERHIAccess::UAVMask);
+			if (NewCapture->BufferRHIRef.IsValid())
+			{
+				NewCapture->UAVRHIRef = COMPUSHADY_CREATE_UAV(NewCapture->BufferRHIRef, static_cast<uint8>(EPixelFormat::PF_R32_UINT));
+			}
+			for (int32 Index = 0; Index < NumReadbacks; Index++)
+			{
+				NewCapture->Readbacks.Add(MakeUnique<FRHIGPUBufferReadback>(TEXT("Compushady::RawVideoWriter::Readback")));
+			}
+		});
+
+	FlushRenderingCommands();
+
+	if (!NewCapture->UAVRHIRef)
+	{
+		ErrorMessages = "Unable to create the conversion buffer";
+		return false;
+	}
+
+	Capture = NewCapture;
+	return true;
+}
+
+bool UCompushadyRawVideoWriter::WriteFrame(UCompushadyResource* FrameResource, FString& ErrorMessages)
+{
+	if (!Capture)
+	{
+		ErrorMessages = "The writer is not open";
+		return false;
+	}
+
+	if (!FrameResource || !FrameResource->IsValidTexture())
+	{
+		ErrorMessages = "Expected a valid texture";
+		return false;
+	}
+
+	FTextureRHIRef SourceTexture = FrameResource->GetTextureRHI();
+	if (SourceTexture->GetSizeX() != Capture->Layout.Width || SourceTexture->GetSizeY() != Capture->Layout.Height)
+	{
+		ErrorMessages = FString::Printf(TEXT("Expected a %dx%d texture (got %dx%d)"), Capture->Layout.Width, Capture->Layout.Height, SourceTexture->GetSizeX(), SourceTexture->GetSizeY());
+		return false;
+	}
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyRawVideoWriteFrame)(
+		[CurrentCapture = Capture, SourceTexture](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentCapture->CompleteFrames_RenderThread(RHICmdList, false);
+
+			// never stall, the frame is lost if the GPU is too far ahead of the readbacks
+			if (CurrentCapture->WriteIndex - CurrentCapture->ReadIndex >= static_cast<uint32>(CurrentCapture->Readbacks.Num()))
+			{
+				CurrentCapture->Sink->AddDroppedFrame();
+				return;
+			}
+
+			RHICmdList.Transition(FRHITransitionInfo(CurrentCapture->UAVRHIRef, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+			CurrentCapture->Converter.ConvertToBuffer_RenderThread(RHICmdList, SourceTexture, CurrentCapture->UAVRHIRef, CurrentCapture->Layout);
+			RHICmdList.Transition(FRHITransitionInfo(CurrentCapture->BufferRHIRef, ERHIAccess::UAVCompute, ERHIAccess::CopySrc));
+
+			FRHIGPUBufferReadback& Readback = *CurrentCapture->Readbacks[CurrentCapture->WriteIndex % CurrentCapture->Readbacks.Num()];
+			Readback.EnqueueCopy(RHICmdList, CurrentCapture->BufferRHIRef, static_cast<uint32>(CurrentCapture->Layout.GetFrameSize()));
+			CurrentCapture->WriteIndex++;
+			CurrentCapture->NumInFlight++;
+		});
+
+	return true;
+}
+
+void UCompushadyRawVideoWriter::Close()
+{
+	if (!Capture)
+	{
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyRawVideoClose)(
+		[CurrentCapture = Capture](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentCapture->CompleteFrames_RenderThread(RHICmdList, true);
+		});
+
+	FlushRenderingCommands();
+
+	Capture->Sink->Close();
+	Capture = nullptr;
+}
+
+bool UCompushadyRawVideoWriter::IsOpen() const
+{
+	return Capture.IsValid();
+}
+
+FCompushadyRawVideoStats UCompushadyRawVideoWriter::GetStats() const
+{
+	if (!Capture)
+	{
+		return FCompushadyRawVideoStats();
+	}
+
+	FCompushadyRawVideoStats Stats = Capture->Sink->GetStats();
+	Stats.QueuedFrames += Capture->NumInFlight.load();
+	return Stats;
+}
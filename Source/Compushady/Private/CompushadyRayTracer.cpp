@@ -7,11 +7,24 @@
 #include "Serialization/ArrayWriter.h"
 #include "FXRenderingUtils.h"
 #include "Engine/World.h"
+#include "Async/Async.h"
+#include "CompushadyCBV.h"
+#include "CompushadySampler.h"
+#include "CompushadyShaderRegistry.h"
+#include "CompushadySRV.h"
+#include "CompushadyUAV.h"
+#include "PipelineStateCache.h"
 
 bool UCompushadyRayTracer::InitFromHLSL(const TArray<uint8>& RayGenShaderCode, const FString& RayGenShaderEntryPoint, const TArray<uint8>& RayMissShaderCode, const FString& RayMissShaderEntryPoint, const TArray<uint8>& RayHitGroupShaderCode, const FString& RayHitGroupShaderEntryPoint, FString& ErrorMessages)
 {
 	RHIInterfaceType = RHIGetInterfaceType();
 
+	if (RHIInterfaceType != ERHIInterfaceType::D3D12)
+	{
+		ErrorMessages = "RayTracing is currently supported only on Direct3D12";
+		return false;
+	}
+
 	TArray<uint8> RayGenShaderByteCode;
 	Compushady::FCompushadyShaderResourceBindings RayGenShaderResourceBindings;
 	if (!Compushady::CompileHLSL(RayGenShaderCode, RayGenShaderEntryPoint, "lib_6_3", RayGenShaderByteCode, ErrorMessages, false))
@@ -19,6 +32,11 @@ bool UCompushadyRayTracer::InitFromHLSL(const TArray<uint8>& RayGenShaderCode, c
 		return false;
 	}
 
+	if (!Compushady::FixupDXILLibrary(RayGenShaderByteCode, RayGenShaderEntryPoint, RayGenShaderResourceBindings, ErrorMessages))
+	{
+		return false;
+	}
+
 	TArray<uint8> RayMissShaderByteCode;
 	Compushady::FCompushadyShaderResourceBindings RayMissShaderResourceBindings;
 	if (!Compushady::CompileHLSL(RayMissShaderCode, RayMissShaderEntryPoint, "lib_6_3", RayMissShaderByteCode, ErrorMessages, false))
@@ -26,6 +44,11 @@ bool UCompushadyRayTracer::InitFromHLSL(const TArray<uint8>& RayGenShaderCode, c
 		return false;
 	}
 
+	if (!Compushady::FixupDXILLibrary(RayMissShaderByteCode, RayMissShaderEntryPoint, RayMissShaderResourceBindings, ErrorMessages))
+	{
+		return false;
+	}
+
 	TArray<uint8> RayHitGroupShaderByteCode;
 	Compushady::FCompushadyShaderResourceBindings RayHitGroupShaderResourceBindings;
 	if (!Compushady::CompileHLSL(RayHitGroupShaderCode, RayHitGroupShaderEntryPoint, "lib_6_3", RayHitGroupShaderByteCode, ErrorMessages, false))
@@ -33,12 +56,109 @@ bool UCompushadyRayTracer::InitFromHLSL(const TArray<uint8>& RayGenShaderCode, c
 		return false;
 	}
 
+	if (!Compushady::FixupDXILLibrary(RayHitGroupShaderByteCode, RayHitGroupShaderEntryPoint, RayHitGroupShaderResourceBindings, ErrorMessages))
+	{
+		return false;
+	}
+
 	return CreateRayTracerPipeline(RayGenShaderByteCode, RayMissShaderByteCode, RayHitGroupShaderByteCode, RayGenShaderResourceBindings, RayMissShaderResourceBindings, RayHitGroupShaderResourceBindings, ErrorMessages);
 }
 
+namespace Compushady
+{
+	namespace RayTracerPipelineCache
+	{
+		struct FCompushadyRayTracerPipelineCacheEntry
+		{
+			FRayTracingPipelineState* PipelineState = nullptr;
+			bool bPending = true;
+			TArray<TFunction<void(FRayTracingPipelineState*)>> Waiters;
+		};
+
+		// accessed only by the game thread
+		static TMap<FCompushadyRayTracerPipelineKey, FCompushadyRayTracerPipelineCacheEntry> Pipelines;
+		static int64 NumCreatedPipelines = 0;
+
+		static void CompletePipeline(const FCompushadyRayTracerPipelineKey& Key, FRayTracingPipelineState* PipelineState)
+		{
+			FCompushadyRayTracerPipelineCacheEntry* Entry = Pipelines.Find(Key);
+			// the cache has been flushed in the meantime
+			if (!Entry)
+			{
+				return;
+			}
+
+			TArray<TFunction<void(FRayTracingPipelineState*)>> Waiters = MoveTemp(Entry->Waiters);
+
+			// failures are not cached, so the next request will retry
+			if (PipelineState)
+			{
+				Entry->PipelineState = PipelineState;
+				Entry->bPending = false;
+			}
+			else
+			{
+				Pipelines.Remove(Key);
+			}
+
+			for (TFunction<void(FRayTracingPipelineState*)>& Waiter : Waiters)
+			{
+				Waiter(PipelineState);
+			}
+		}
+	}
+}
+
+void Compushady::RayTracerPipelineCache::GetOrCreate(const FCompushadyRayTracerPipelineKey& Key, TFunction<FRayTracingPipelineState* (FRHICommandListImmediate&)> CreateFunction, TFunction<void(FRayTracingPipelineState*)> OnReady)
+{
+	check(IsInGameThread());
+
+	if (FCompushadyRayTracerPipelineCacheEntry* Entry = Pipelines.Find(Key))
+	{
+		if (Entry->bPending)
+		{
+			Entry->Waiters.Add(MoveTemp(OnReady));
+		}
+		else
+		{
+			OnReady(Entry->PipelineState);
+		}
+		return;
+	}
+
+	FCompushadyRayTracerPipelineCacheEntry& NewEntry = Pipelines.Add(Key);
+	NewEntry.Waiters.Add(MoveTemp(OnReady));
+	NumCreatedPipelines++;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRayTracerPipelineState)(
+		[Key, CreateFunction](FRHICommandListImmediate& RHICmdList)
+		{
+			FRayTracingPipelineState* PipelineState = CreateFunction(RHICmdList);
+			AsyncTask(ENamedThreads::GameThread, [Key, PipelineState]()
+				{
+					CompletePipeline(Key, PipelineState);
+				});
+		});
+}
+
+int32 Compushady::RayTracerPipelineCache::GetNumPipelines()
+{
+	return Pipelines.Num();
+}
+
+int64 Compushady::RayTracerPipelineCache::GetNumCreatedPipelines()
+{
+	return NumCreatedPipelines;
+}
+
+void Compushady::RayTracerPipelineCache::Flush()
+{
+	Pipelines.Empty();
+}
+
 bool UCompushadyRayTracer::CreateRayTracerPipeline(TArray<uint8>& RayGenShaderByteCode, TArray<uint8>& RayMissShaderByteCode, TArray<uint8>& RayHitGroupShaderByteCode, Compushady::FCompushadyShaderResourceBindings RGShaderResourceBindings, Compushady::FCompushadyShaderResourceBindings RMShaderResourceBindings, Compushady::FCompushadyShaderResourceBindings RHGShaderResourceBindings, FString& ErrorMessages)
 {
-#if 0
+#if COMPUSHADY_UE_VERSION >= 53 && RHI_RAYTRACING
 	if (!Compushady::Utils::CreateResourceBindings(RGShaderResourceBindings, RayGenResourceBindings, ErrorMessages))
 	{
 		return false;
@@ -58,97 +178,148 @@ bool UCompushadyRayTracer::CreateRayTracerPipeline(TArray<uint8>& RayGenShaderBy
 
 	TArray<uint8> RGSByteCode;
 	FSHAHash RGSHash;
-	//if (!Compushady::ToUnrealShader(RayGenShaderByteCode, RGSByteCode, RayGenResourceBindings.NumCBVs, RayGenResourceBindings.NumSRVs, RayGenResourceBindings.NumUAVs, RayGenResourceBindings.NumSamplers, RGSHash))
+	if (!Compushady::ToUnrealShader(RayGenShaderByteCode, RGSByteCode, RGShaderResourceBindings.CBVs.Num(), RGShaderResourceBindings.SRVs.Num(), RGShaderResourceBindings.UAVs.Num(), RGShaderResourceBindings.Samplers.Num(), RGSHash))
 	{
 		ErrorMessages = "Unable to add Unreal metadata to the RayGen Shader";
 		return false;
 	}
 
-	RayGenShaderRef = RHICreateRayTracingShader(RGSByteCode, RGSHash, EShaderFrequency::SF_RayGen);
-	if (!RayGenShaderRef.IsValid() || !RayGenShaderRef->IsValid())
+	RayGenShaderRef = Compushady::ShaderRegistry::GetOrCreateRayTracingShader(RGSByteCode, RGSHash, EShaderFrequency::SF_RayGen);
+	if (!RayGenShaderRef.IsValid())
 	{
 		ErrorMessages = "Unable to create RayGen Shader";
 		return false;
 	}
 
-	RayGenShaderRef->SetHash(RGSHash);
-
 	/** RayMiss Shader */
 
 	TArray<uint8> RMSByteCode;
 	FSHAHash RMSHash;
-	//if (!Compushady::ToUnrealShader(RayMissShaderByteCode, RMSByteCode, RayMissResourceBindings.NumCBVs, RayMissResourceBindings.NumSRVs, RayMissResourceBindings.NumUAVs, RayMissResourceBindings.NumSamplers, RMSHash))
+	if (!Compushady::ToUnrealShader(RayMissShaderByteCode, RMSByteCode, RMShaderResourceBindings.CBVs.Num(), RMShaderResourceBindings.SRVs.Num(), RMShaderResourceBindings.UAVs.Num(), RMShaderResourceBindings.Samplers.Num(), RMSHash))
 	{
 		ErrorMessages = "Unable to add Unreal metadata to the RayMiss Shader";
 		return false;
 	}
 
-	RayMissShaderRef = RHICreateRayTracingShader(RMSByteCode, RMSHash, EShaderFrequency::SF_RayMiss);
-	if (!RayMissShaderRef.IsValid() || !RayMissShaderRef->IsValid())
+	RayMissShaderRef = Compushady::ShaderRegistry::GetOrCreateRayTracingShader(RMSByteCode, RMSHash, EShaderFrequency::SF_RayMiss);
+	if (!RayMissShaderRef.IsValid())
 	{
 		ErrorMessages = "Unable to create RayMiss Shader";
 		return false;
 	}
 
-	RayMissShaderRef->SetHash(RMSHash);
-
 	/** RayHitGroup Shader */
 
 	TArray<uint8> RHGSByteCode;
 	FSHAHash RHGSHash;
-
-	//if (!Compushady::ToUnrealShader(RayHitGroupShaderByteCode, RHGSByteCode, RayHitGroupResourceBindings.NumCBVs, RayHitGroupResourceBindings.NumSRVs, RayHitGroupResourceBindings.NumUAVs, RayHitGroupResourceBindings.NumSamplers, RHGSHash))
+	if (!Compushady::ToUnrealShader(RayHitGroupShaderByteCode, RHGSByteCode, RHGShaderResourceBindings.CBVs.Num(), RHGShaderResourceBindings.SRVs.Num(), RHGShaderResourceBindings.UAVs.Num(), RHGShaderResourceBindings.Samplers.Num(), RHGSHash))
 	{
 		ErrorMessages = "Unable to add Unreal metadata to the RayHitGroup Shader";
 		return false;
 	}
 
-	RayHitGroupShaderRef = RHICreateRayTracingShader(RHGSByteCode, RHGSHash, EShaderFrequency::SF_RayHitGroup);
-	if (!RayHitGroupShaderRef.IsValid() || !RayHitGroupShaderRef->IsValid())
+	RayHitGroupShaderRef = Compushady::ShaderRegistry::GetOrCreateRayTracingShader(RHGSByteCode, RHGSHash, EShaderFrequency::SF_RayHitGroup);
+	if (!RayHitGroupShaderRef.IsValid())
 	{
 		ErrorMessages = "Unable to create RayHitGroup Shader";
 		return false;
 	}
 
-	RayHitGroupShaderRef->SetHash(RHGSHash);
+	Compushady::FCompushadyRayTracerPipelineKey Key;
+	Key.RayGenHash = RGSHash;
+	Key.RayMissHash = RMSHash;
+	Key.RayHitGroupHash = RHGSHash;
 
-	FRHIRayTracingShader* RayGenShaderTable[] = { RayGenShaderRef };
-	PipelineStateInitializer.SetRayGenShaderTable(RayGenShaderTable);
+	// the initializer only stores views of the shader tables, so it is built directly on the render thread
+	RequestPipelineState(Key, [RayGenShader = RayGenShaderRef, RayMissShader = RayMissShaderRef, RayHitGroupShader = RayHitGroupShaderRef](FRHICommandListImmediate& RHICmdList)
+		{
+			FRayTracingPipelineStateInitializer PipelineStateInitializer;
 
-	FRHIRayTracingShader* RayMissShaderTable[] = { RayMissShaderRef };
-	PipelineStateInitializer.SetMissShaderTable(RayMissShaderTable);
+			FRHIRayTracingShader* RayGenShaderTable[] = { RayGenShader };
+			PipelineStateInitializer.SetRayGenShaderTable(RayGenShaderTable);
 
-	FRHIRayTracingShader* RayHitGroupShaderTable[] = { RayHitGroupShaderRef };
-	PipelineStateInitializer.SetHitGroupTable(RayHitGroupShaderTable);
+			FRHIRayTracingShader* RayMissShaderTable[] = { RayMissShader };
+			PipelineStateInitializer.SetMissShaderTable(RayMissShaderTable);
 
-	ENQUEUE_RENDER_COMMAND(DoCompushadyCreateRayTracerPipelineState)(
-		[this](FRHICommandListImmediate& RHICmdList)
+			FRHIRayTracingShader* RayHitGroupShaderTable[] = { RayHitGroupShader };
+			PipelineStateInitializer.SetHitGroupTable(RayHitGroupShaderTable);
+
+			return PipelineStateCache::GetAndOrCreateRayTracingPipelineState(RHICmdList, PipelineStateInitializer);
+		});
+
+	return true;
+#else
+	ErrorMessages = "RayTracing is not supported";
+	return false;
+#endif
+}
+
+void UCompushadyRayTracer::RequestPipelineState(const Compushady::FCompushadyRayTracerPipelineKey& Key, TFunction<FRayTracingPipelineState* (FRHICommandListImmediate&)> CreateFunction)
+{
+	PipelineStatus = ECompushadyRayTracerPipelineStatus::Pending;
+
+	TWeakObjectPtr<UCompushadyRayTracer> WeakThis(this);
+	Compushady::RayTracerPipelineCache::GetOrCreate(Key, CreateFunction, [WeakThis](FRayTracingPipelineState* InPipelineState)
 		{
-			PipelineState = PipelineStateCache::GetAndOrCreateRayTracingPipelineState(RHICmdList, PipelineStateInitializer);
+			if (UCompushadyRayTracer* RayTracer = WeakThis.Get())
+			{
+				RayTracer->OnPipelineStateReady(InPipelineState);
+			}
 		});
+}
+
+void UCompushadyRayTracer::OnPipelineStateReady(FRayTracingPipelineState* InPipelineState)
+{
+	PipelineState = InPipelineState;
+	PipelineStatus = PipelineState ? ECompushadyRayTracerPipelineStatus::Ready : ECompushadyRayTracerPipelineStatus::Failed;
 
-	FlushRenderingCommands();
+	TArray<FCompushadySignaled> Waiters = MoveTemp(PipelineWaiters);
+	for (const FCompushadySignaled& Waiter : Waiters)
+	{
+		Waiter.ExecuteIfBound(PipelineState != nullptr, PipelineState ? "" : "Unable to create RayTracer Pipeline State");
+	}
 
 	if (!PipelineState)
 	{
-		ErrorMessages = "Unable to create RayTracer Pipeline State";
-		return false;
+		TArray<FCompushadyRayTracerQueuedDispatch> FailedDispatches = MoveTemp(QueuedDispatches);
+		for (const FCompushadyRayTracerQueuedDispatch& QueuedDispatch : FailedDispatches)
+		{
+			QueuedDispatch.OnSignaled.ExecuteIfBound(false, "Unable to create RayTracer Pipeline State");
+		}
+		return;
 	}
 
-	return true;
-#endif
-	return false;
+	if (!IsRunning())
+	{
+		DispatchNextQueued();
+	}
 }
 
-void UCompushadyRayTracer::DispatchRays(const FCompushadyResourceArray& ResourceArray, const FIntVector XYZ, const FCompushadySignaled& OnSignaled)
+void UCompushadyRayTracer::DispatchNextQueued()
 {
-#if COMPUSHADY_UE_VERSION >= 53 && RHI_RAYTRACING
-	if (IsRunning())
+	if (QueuedDispatches.Num() == 0)
 	{
-		OnSignaled.ExecuteIfBound(false, "The RayTracer is already running");
 		return;
 	}
 
+	FCompushadyRayTracerQueuedDispatch QueuedDispatch = QueuedDispatches[0];
+	QueuedDispatches.RemoveAt(0);
+
+	DispatchRays_Internal(QueuedDispatch.ResourceArray, QueuedDispatch.XYZ, QueuedDispatch.OnSignaled);
+}
+
+void UCompushadyRayTracer::OnSignalReceived()
+{
+	ICompushadyPipeline::OnSignalReceived();
+
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::Ready)
+	{
+		DispatchNextQueued();
+	}
+}
+
+void UCompushadyRayTracer::DispatchRays(const FCompushadyResourceArray& ResourceArray, const FIntVector XYZ, const FCompushadySignaled& OnSignaled)
+{
 	if (XYZ.GetMin() <= 0)
 	{
 		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid Thread Group Size %s"), *XYZ.ToString()));
@@ -162,19 +333,117 @@ void UCompushadyRayTracer::DispatchRays(const FCompushadyResourceArray& Resource
 		return;
 	}
 
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::None)
+	{
+		OnSignaled.ExecuteIfBound(false, "The RayTracer Pipeline State has not been created");
+		return;
+	}
+
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::Failed)
+	{
+		OnSignaled.ExecuteIfBound(false, "Unable to create RayTracer Pipeline State");
+		return;
+	}
+
+	// keep the order of the dispatches issued before the pipeline was ready
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::Pending || QueuedDispatches.Num() > 0)
+	{
+		FCompushadyRayTracerQueuedDispatch& QueuedDispatch = QueuedDispatches.AddDefaulted_GetRef();
+		QueuedDispatch.ResourceArray = ResourceArray;
+		QueuedDispatch.XYZ = XYZ;
+		QueuedDispatch.OnSignaled = OnSignaled;
+		return;
+	}
+
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The RayTracer is already running");
+		return;
+	}
+
+	DispatchRays_Internal(ResourceArray, XYZ, OnSignaled);
+}
+
+void UCompushadyRayTracer::DispatchRays_Internal(const FCompushadyResourceArray& ResourceArray, const FIntVector XYZ, const FCompushadySignaled& OnSignaled)
+{
+#if COMPUSHADY_UE_VERSION >= 53 && RHI_RAYTRACING
 	TrackResources(ResourceArray);
 
 	EnqueueToGPU(
 		[this, XYZ, ResourceArray](FRHICommandListImmediate& RHICmdList)
 		{
-			FRayTracingShaderBindings Bindings;
+			for (UCompushadyCBV* CBV : ResourceArray.CBVs)
+			{
+				if (CBV->BufferDataIsDirty())
+				{
+					CBV->SyncBufferData(RHICmdList);
+				}
+			}
+
+			for (UCompushadySRV* SRV : ResourceArray.SRVs)
+			{
+				RHICmdList.Transition(SRV->GetRHITransitionInfo());
+			}
+
+			for (UCompushadyUAV* UAV : ResourceArray.UAVs)
+			{
+				RHICmdList.Transition(UAV->GetRHITransitionInfo());
+			}
+
+			// the RHI resources (not the UObjects) are compared, as a resource can reallocate them (the references
+			// held by the cache prevent a new resource from reusing the address of a cached one)
+			TArray<TRefCountPtr<FRHIResource>> BindingsResources;
+			BindingsResources.Reserve(ResourceArray.CBVs.Num() + ResourceArray.SRVs.Num() + ResourceArray.UAVs.Num() + ResourceArray.Samplers.Num());
+			for (UCompushadyCBV* CBV : ResourceArray.CBVs)
+			{
+				BindingsResources.Add(CBV->GetRHI().GetReference());
+			}
+			for (UCompushadySRV* SRV : ResourceArray.SRVs)
+			{
+				BindingsResources.Add(SRV->GetRHI().GetReference());
+			}
+			for (UCompushadyUAV* UAV : ResourceArray.UAVs)
+			{
+				BindingsResources.Add(UAV->GetRHI().GetReference());
+			}
+			for (UCompushadySampler* Sampler : ResourceArray.Samplers)
+			{
+				BindingsResources.Add(Sampler->GetRHI().GetReference());
+			}
+
+			if (!bCachedBindingsValid_RenderThread || CachedBindingsResources_RenderThread != BindingsResources)
+			{
+				CachedBindings_RenderThread = FRayTracingShaderBindings();
+				for (int32 Index = 0; Index < RayGenResourceBindings.CBVs.Num(); Index++)
+				{
+					CachedBindings_RenderThread.UniformBuffers[RayGenResourceBindings.CBVs[Index].SlotIndex] = ResourceArray.CBVs[Index]->GetRHI();
+				}
+				for (int32 Index = 0; Index < RayGenResourceBindings.SRVs.Num(); Index++)
+				{
+					CachedBindings_RenderThread.SRVs[RayGenResourceBindings.SRVs[Index].SlotIndex] = ResourceArray.SRVs[Index]->GetRHI();
+				}
+				for (int32 Index = 0; Index < RayGenResourceBindings.UAVs.Num(); Index++)
+				{
+					CachedBindings_RenderThread.UAVs[RayGenResourceBindings.UAVs[Index].SlotIndex] = ResourceArray.UAVs[Index]->GetRHI();
+				}
+				for (int32 Index = 0; Index < RayGenResourceBindings.Samplers.Num(); Index++)
+				{
+					CachedBindings_RenderThread.Samplers[RayGenResourceBindings.Samplers[Index].SlotIndex] = ResourceArray.Samplers[Index]->GetRHI();
+				}
+				CachedBindingsResources_RenderThread = MoveTemp(BindingsResources);
+				bCachedBindingsValid_RenderThread = true;
+				NumBindingsUpdates++;
+			}
+
 #if COMPUSHADY_UE_VERSION >= 57
 			// currently unsupported
-			RHICmdList.RayTraceDispatch(PipelineState, RayGenShaderRef, nullptr, Bindings, XYZ.X, XYZ.Y);
+			RHICmdList.RayTraceDispatch(PipelineState, RayGenShaderRef, nullptr, CachedBindings_RenderThread, XYZ.X, XYZ.Y);
 #else
-			RHICmdList.RayTraceDispatch(PipelineState, RayGenShaderRef, UE::FXRenderingUtils::RayTracing::GetRayTracingScene(GetWorld()->Scene), Bindings, XYZ.X, XYZ.Y);
+			RHICmdList.RayTraceDispatch(PipelineState, RayGenShaderRef, UE::FXRenderingUtils::RayTracing::GetRayTracingScene(GetWorld()->Scene), CachedBindings_RenderThread, XYZ.X, XYZ.Y);
 #endif
 		}, OnSignaled);
+#else
+	OnSignaled.ExecuteIfBound(false, "RayTracing is not supported");
 #endif
 }
 
@@ -183,9 +452,37 @@ bool UCompushadyRayTracer::IsRunning() const
 	return ICompushadySignalable::IsRunning();
 }
 
+bool UCompushadyRayTracer::IsPipelineReady() const
+{
+	return PipelineStatus == ECompushadyRayTracerPipelineStatus::Ready;
+}
+
+void UCompushadyRayTracer::WaitForPipeline(const FCompushadySignaled& OnSignaled)
+{
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::Pending)
+	{
+		PipelineWaiters.Add(OnSignaled);
+		return;
+	}
+
+	if (PipelineStatus == ECompushadyRayTracerPipelineStatus::Ready)
+	{
+		OnSignaled.ExecuteIfBound(true, "");
+	}
+	else
+	{
+		OnSignaled.ExecuteIfBound(false, "Unable to create RayTracer Pipeline State");
+	}
+}
+
+int32 UCompushadyRayTracer::GetNumQueuedDispatches() const
+{
+	return QueuedDispatches.Num();
+}
+
 void UCompushadyRayTracer::StoreLastSignal(bool bSuccess, const FString& ErrorMessage)
 {
 	bLastSuccess = bSuccess;
 	LastErrorMessages = ErrorMessage;
-
-}
\ No newline at end of file
+	NumStoredSignals++;
+}
@@ -677,6 +677,28 @@ bool Compushady::FixupSPIRV(TArray<uint8>& ByteCode, const FString& TargetProfil
 #endif
 			UAVMapping.Add(ResourceBinding.BindingIndex, ResourceBinding);
 		}
+		else if (Pair.Value.ReflectionType == "raytracingaccelerationstructure")
+		{
+#if COMPUSHADY_UE_VERSION >= 55
+			FVulkanShaderHeader::FBindingInfo BindingInfo = {};
+			BindingInfo.DescriptorType = VkDescriptorType::VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			ResourceBinding.Type = ECompushadyShaderResourceType::RayTracingAccelerationStructure;
+			ResourceBinding.SlotIndex = VulkanShaderHeader.Bindings.Add(BindingInfo);
+			ResourceBinding.BindingIndex = Pair.Value.Binding;
+			SpirV[Pair.Value.BindingIndexOffset] = ResourceBinding.SlotIndex;
+			SpirV[Pair.Value.DescriptorSetOffset] = DescriptorSet;
+#else
+			FVulkanShaderHeader::FGlobalInfo GlobalInfo = {};
+			GlobalInfo.OriginalBindingIndex = Pair.Value.Binding;
+			GlobalInfo.CombinedSamplerStateAliasIndex = UINT16_MAX;
+			GlobalInfo.TypeIndex = RayTracingAccelerationStructureType;
+			ResourceBinding.Type = ECompushadyShaderResourceType::RayTracingAccelerationStructure;
+			ResourceBinding.SlotIndex = VulkanShaderHeader.Globals.Add(GlobalInfo);
+			ResourceBinding.BindingIndex = Pair.Value.Binding;
+			VulkanShaderHeader.GlobalSpirvInfos.Add(SpirvInfo);
+#endif
+			SRVMapping.Add(ResourceBinding.BindingIndex, ResourceBinding);
+		}
 		else
 		{
 			ErrorMessages = FString::Printf(TEXT("Unsupported shader resource type \"%s\" for %s (binding: %u)"), *Pair.Value.ReflectionType, *ResourceBinding.Name, Pair.Value.Binding);
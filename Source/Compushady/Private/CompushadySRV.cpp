@@ -136,6 +136,7 @@ bool UCompushadySRV::InitializeFromWorldSceneAccelerationStructure(UWorld* World
 	}
 
 	RHITransitionInfo = FRHITransitionInfo(UE::FXRenderingUtils::RayTracing::GetRayTracingScene(Scene), ERHIAccess::Unknown, ERHIAccess::BVHRead);
+	bIsAccelerationStructure = true;
 
 	return true;
 #else
@@ -143,6 +144,20 @@ bool UCompushadySRV::InitializeFromWorldSceneAccelerationStructure(UWorld* World
 #endif
 }
 
+bool UCompushadySRV::InitializeFromAccelerationStructure(FShaderResourceViewRHIRef InSRVRHIRef, const FRHITransitionInfo& InRHITransitionInfo)
+{
+	if (!InSRVRHIRef)
+	{
+		return false;
+	}
+
+	SRVRHIRef = InSRVRHIRef;
+	RHITransitionInfo = InRHITransitionInfo;
+	bIsAccelerationStructure = true;
+
+	return true;
+}
+
 bool UCompushadySRV::InitializeFromBuffer(FBufferRHIRef InBufferRHIRef, const EPixelFormat PixelFormat)
 {
 	if (!InBufferRHIRef)
@@ -228,3 +243,13 @@ bool UCompushadySRV::IsSceneTexture() const
 {
 	return SceneTexture != ECompushadySceneTexture::None;
 }
+
+ECompushadySceneTexture UCompushadySRV::GetSceneTexture() const
+{
+	return SceneTexture;
+}
+
+bool UCompushadySRV::IsAccelerationStructure() const
+{
+	return bIsAccelerationStructure;
+}
@@ -0,0 +1,124 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyShaderRegistry.h"
+#include "Compushady.h"
+
+namespace Compushady
+{
+	namespace ShaderRegistry
+	{
+		static TMap<FSHAHash, TRefCountPtr<FRHIShader>> Shaders[SF_NumFrequencies];
+		static FCriticalSection ShadersLock;
+		static int64 NumCreatedShaders = 0;
+
+		static int32 PurgeUnlocked()
+		{
+			int32 NumReleased = 0;
+			for (TMap<FSHAHash, TRefCountPtr<FRHIShader>>& FrequencyShaders : Shaders)
+			{
+				for (auto It = FrequencyShaders.CreateIterator(); It; ++It)
+				{
+					// the registry is the only owner
+					if (It->Value->GetRefCount() <= 1)
+					{
+						It.RemoveCurrent();
+						NumReleased++;
+					}
+				}
+			}
+			return NumReleased;
+		}
+
+		template<typename T, typename CreateFunction>
+		TRefCountPtr<T> GetOrCreate(const EShaderFrequency Frequency, const TArray<uint8>& Blob, const FSHAHash& Hash, CreateFunction Create)
+		{
+			FScopeLock Lock(&ShadersLock);
+
+			if (TRefCountPtr<FRHIShader>* Shader = Shaders[Frequency].Find(Hash))
+			{
+				return TRefCountPtr<T>(static_cast<T*>(Shader->GetReference()));
+			}
+
+			TRefCountPtr<T> NewShader = Create(Blob, Hash);
+			if (!NewShader.IsValid() || !NewShader->IsValid())
+			{
+				return nullptr;
+			}
+
+			NewShader->SetHash(Hash);
+
+			// this is a good moment for getting rid of unused shaders
+			PurgeUnlocked();
+
+			Shaders[Frequency].Add(Hash, NewShader.GetReference());
+			NumCreatedShaders++;
+
+			return NewShader;
+		}
+	}
+}
+
+FVertexShaderRHIRef Compushady::ShaderRegistry::GetOrCreateVertexShader(const TArray<uint8>& Blob, const FSHAHash& Hash)
+{
+	return GetOrCreate<FRHIVertexShader>(SF_Vertex, Blob, Hash, [](const TArray<uint8>& InBlob, const FSHAHash& InHash) { return RHICreateVertexShader(InBlob, InHash); });
+}
+
+FPixelShaderRHIRef Compushady::ShaderRegistry::GetOrCreatePixelShader(const TArray<uint8>& Blob, const FSHAHash& Hash)
+{
+	return GetOrCreate<FRHIPixelShader>(SF_Pixel, Blob, Hash, [](const TArray<uint8>& InBlob, const FSHAHash& InHash) { return RHICreatePixelShader(InBlob, InHash); });
+}
+
+FComputeShaderRHIRef Compushady::ShaderRegistry::GetOrCreateComputeShader(const TArray<uint8>& Blob, const FSHAHash& Hash)
+{
+	return GetOrCreate<FRHIComputeShader>(SF_Compute, Blob, Hash, [](const TArray<uint8>& InBlob, const FSHAHash& InHash) { return RHICreateComputeShader(InBlob, InHash); });
+}
+
+FMeshShaderRHIRef Compushady::ShaderRegistry::GetOrCreateMeshShader(const TArray<uint8>& Blob, const FSHAHash& Hash)
+{
+	return GetOrCreate<FRHIMeshShader>(SF_Mesh, Blob, Hash, [](const TArray<uint8>& InBlob, const FSHAHash& InHash) { return RHICreateMeshShader(InBlob, InHash); });
+}
+
+#if RHI_RAYTRACING
+FRayTracingShaderRHIRef Compushady::ShaderRegistry::GetOrCreateRayTracingShader(const TArray<uint8>& Blob, const FSHAHash& Hash, const EShaderFrequency Frequency)
+{
+	return GetOrCreate<FRHIRayTracingShader>(Frequency, Blob, Hash, [Frequency](const TArray<uint8>& InBlob, const FSHAHash& InHash) { return RHICreateRayTracingShader(InBlob, InHash, Frequency); });
+}
+#endif
+
+int32 Compushady::ShaderRegistry::GetNumShaders()
+{
+	FScopeLock Lock(&ShadersLock);
+	int32 NumShaders = 0;
+	for (const TMap<FSHAHash, TRefCountPtr<FRHIShader>>& FrequencyShaders : Shaders)
+	{
+		NumShaders += FrequencyShaders.Num();
+	}
+	return NumShaders;
+}
+
+int64 Compushady::ShaderRegistry::GetNumCreatedShaders()
+{
+	FScopeLock Lock(&ShadersLock);
+	return NumCreatedShaders;
+}
+
+bool Compushady::ShaderRegistry::Contains(const EShaderFrequency Frequency, const FSHAHash& Hash)
+{
+	FScopeLock Lock(&ShadersLock);
+	return Shaders[Frequency].Contains(Hash);
+}
+
+int32 Compushady::ShaderRegistry::Purge()
+{
+	FScopeLock Lock(&ShadersLock);
+	return PurgeUnlocked();
+}
+
+void Compushady::ShaderRegistry::Flush()
+{
+	FScopeLock Lock(&ShadersLock);
+	for (TMap<FSHAHash, TRefCountPtr<FRHIShader>>& FrequencyShaders : Shaders)
+	{
+		FrequencyShaders.Empty();
+	}
+}
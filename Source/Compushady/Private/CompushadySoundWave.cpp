@@ -2,6 +2,152 @@
 
 
 #include "CompushadySoundWave.h"
+#include "RHIGPUReadback.h"
+
+namespace Compushady
+{
+	namespace Audio
+	{
+		struct FCompushadyAudioStream
+		{
+			FCompushadyAudioStreamRing Ring;
+			// render thread only
+			TArray<TUniquePtr<FRHIGPUBufferReadback>> Readbacks;
+			TArray<bool> CopiesEnqueued;
+
+			FCompushadyAudioStream(const int32 NumChunks, const int32 ChunkSamples, const int32 LatencyChunks) : Ring(NumChunks, ChunkSamples, LatencyChunks)
+			{
+				for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++)
+				{
+					Readbacks.Add(MakeUnique<FRHIGPUBufferReadback>(TEXT("Compushady::SoundWave::Readback")));
+					CopiesEnqueued.Add(false);
+				}
+			}
+
+			void CompleteChunks_RenderThread()
+			{
+				int32 ChunkIndex = Ring.GetNextPendingChunk();
+				// chunks are completed in order, a chunk submitted by the game thread could still be waiting for its copy
+				while (ChunkIndex != INDEX_NONE && CopiesEnqueued[ChunkIndex] && Readbacks[ChunkIndex]->IsReady())
+				{
+					const uint32 NumBytes = Ring.GetChunkSamples() * sizeof(float);
+					if (const void* Data = Readbacks[ChunkIndex]->Lock(NumBytes))
+					{
+						FMemory::Memcpy(Ring.GetChunkData(ChunkIndex), Data, NumBytes);
+						Readbacks[ChunkIndex]->Unlock();
+					}
+					else
+					{
+						FMemory::Memzero(Ring.GetChunkData(ChunkIndex), NumBytes);
+					}
+
+					CopiesEnqueued[ChunkIndex] = false;
+					Ring.Complete();
+					ChunkIndex = Ring.GetNextPendingChunk();
+				}
+			}
+		};
+	}
+}
+
+Compushady::Audio::FCompushadyAudioStreamRing::FCompushadyAudioStreamRing(const int32 InNumChunks, const int32 InChunkSamples, const int32 InLatencyChunks) : NumChunks(InNumChunks), ChunkSamples(InChunkSamples)
+{
+	check(NumChunks > 0 && ChunkSamples > 0);
+	LatencyChunks = FMath::Clamp(InLatencyChunks, 1, NumChunks);
+	Samples.AddZeroed(NumChunks * ChunkSamples);
+}
+
+int32 Compushady::Audio::FCompushadyAudioStreamRing::Submit()
+{
+	const uint32 CurrentSubmitIndex = SubmitIndex.load(std::memory_order_relaxed);
+	if (CurrentSubmitIndex - ReadIndex.load(std::memory_order_acquire) >= static_cast<uint32>(NumChunks))
+	{
+		NumDroppedChunks++;
+		return INDEX_NONE;
+	}
+
+	SubmitIndex.store(CurrentSubmitIndex + 1, std::memory_order_release);
+	return CurrentSubmitIndex % NumChunks;
+}
+
+int32 Compushady::Audio::FCompushadyAudioStreamRing::GetNextPendingChunk() const
+{
+	const uint32 CurrentCompleteIndex = CompleteIndex.load(std::memory_order_relaxed);
+	if (SubmitIndex.load(std::memory_order_acquire) == CurrentCompleteIndex)
+	{
+		return INDEX_NONE;
+	}
+	return CurrentCompleteIndex % NumChunks;
+}
+
+float* Compushady::Audio::FCompushadyAudioStreamRing::GetChunkData(const int32 ChunkIndex)
+{
+	return Samples.GetData() + ChunkIndex * ChunkSamples;
+}
+
+void Compushady::Audio::FCompushadyAudioStreamRing::Complete()
+{
+	CompleteIndex.store(CompleteIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int32 Compushady::Audio::FCompushadyAudioStreamRing::Pop(float* OutSamples, const int32 NumSamples)
+{
+	int32 StreamedSamples = 0;
+
+	if (bBuffering.load() && CompleteIndex.load(std::memory_order_acquire) - ReadIndex.load(std::memory_order_relaxed) >= static_cast<uint32>(LatencyChunks))
+	{
+		bBuffering = false;
+	}
+
+	if (!bBuffering.load())
+	{
+		while (StreamedSamples < NumSamples)
+		{
+			const uint32 CurrentReadIndex = ReadIndex.load(std::memory_order_relaxed);
+			if (CompleteIndex.load(std::memory_order_acquire) == CurrentReadIndex)
+			{
+				break;
+			}
+
+			const float* Chunk = Samples.GetData() + (CurrentReadIndex % NumChunks) * ChunkSamples;
+			const int32 SamplesToCopy = FMath::Min(ChunkSamples - ReadOffset, NumSamples - StreamedSamples);
+			FMemory::Memcpy(OutSamples + StreamedSamples, Chunk + ReadOffset, SamplesToCopy * sizeof(float));
+			StreamedSamples += SamplesToCopy;
+			ReadOffset += SamplesToCopy;
+
+			if (ReadOffset == ChunkSamples)
+			{
+				ReadOffset = 0;
+				ReadIndex.store(CurrentReadIndex + 1, std::memory_order_release);
+			}
+		}
+
+		// the GPU is not keeping up, buffer again up to the latency target
+		if (StreamedSamples < NumSamples)
+		{
+			NumUnderruns++;
+			NumUnderrunSamples += NumSamples - StreamedSamples;
+			bBuffering = true;
+		}
+	}
+
+	if (StreamedSamples < NumSamples)
+	{
+		FMemory::Memzero(OutSamples + StreamedSamples, (NumSamples - StreamedSamples) * sizeof(float));
+	}
+
+	return StreamedSamples;
+}
+
+int32 Compushady::Audio::FCompushadyAudioStreamRing::NumPending() const
+{
+	return static_cast<int32>(SubmitIndex.load() - CompleteIndex.load());
+}
+
+int32 Compushady::Audio::FCompushadyAudioStreamRing::NumCompleted() const
+{
+	return static_cast<int32>(CompleteIndex.load() - ReadIndex.load());
+}
 
 void UCompushadySoundWave::UpdateSamples()
 {
@@ -10,6 +156,25 @@ void UCompushadySoundWave::UpdateSamples()
 		return;
 	}
 
+	if (TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> CurrentStream = GetStream())
+	{
+		const int32 ChunkIndex = CurrentStream->Ring.Submit();
+		if (ChunkIndex == INDEX_NONE)
+		{
+			return;
+		}
+
+		ENQUEUE_RENDER_COMMAND(DoCompushadyStreamSamples)(
+			[CurrentStream, ChunkIndex, BufferRHIRef = UAV->GetBufferRHI()](FRHICommandListImmediate& RHICmdList)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(BufferRHIRef, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+				CurrentStream->Readbacks[ChunkIndex]->EnqueueCopy(RHICmdList, BufferRHIRef, CurrentStream->Ring.GetChunkSamples() * sizeof(float));
+				CurrentStream->CopiesEnqueued[ChunkIndex] = true;
+				CurrentStream->CompleteChunks_RenderThread();
+			});
+		return;
+	}
+
 	if (TempData.Num() != UAV->GetBufferSize())
 	{
 		TempData.Empty(UAV->GetBufferSize());
@@ -25,6 +190,88 @@ void UCompushadySoundWave::UpdateSamples()
 	QueueAudio(TempData.GetData(), TempData.Num());
 }
 
+int32 UCompushadySoundWave::OnGeneratePCMAudio(TArray<uint8>& OutAudio, int32 NumSamples)
+{
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> CurrentStream = GetStream();
+	if (!CurrentStream)
+	{
+		return Super::OnGeneratePCMAudio(OutAudio, NumSamples);
+	}
+
+	const int32 Offset = OutAudio.Num();
+	OutAudio.AddUninitialized(NumSamples * sizeof(float));
+	CurrentStream->Ring.Pop(reinterpret_cast<float*>(OutAudio.GetData() + Offset), NumSamples);
+
+	// underruns are filled with silence, so the whole request is always satisfied
+	return NumSamples;
+}
+
+bool UCompushadySoundWave::StartStreaming(const int32 NumChunks, const float LatencyTarget, FString& ErrorMessages)
+{
+	if (!UAV || !UAV->IsValidBuffer())
+	{
+		ErrorMessages = "Invalid UAV";
+		return false;
+	}
+
+	if (NumChunks < 2)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NumChunks %d (at least 2 are required)"), NumChunks);
+		return false;
+	}
+
+	if (LatencyTarget < 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid LatencyTarget %f"), LatencyTarget);
+		return false;
+	}
+
+	const int32 ChunkSamples = UAV->GetBufferSize() / sizeof(float);
+	const int32 LatencySamples = FMath::CeilToInt32(LatencyTarget * SampleRate) * NumChannels;
+	const int32 LatencyChunks = FMath::DivideAndRoundUp(LatencySamples, ChunkSamples);
+
+	if (LatencyChunks > NumChunks)
+	{
+		ErrorMessages = FString::Printf(TEXT("LatencyTarget %f requires %d chunks, only %d available"), LatencyTarget, LatencyChunks, NumChunks);
+		return false;
+	}
+
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> NewStream = MakeShared<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe>(NumChunks, ChunkSamples, LatencyChunks);
+
+	FScopeLock Lock(&StreamLock);
+	Stream = NewStream;
+	return true;
+}
+
+void UCompushadySoundWave::StopStreaming()
+{
+	FScopeLock Lock(&StreamLock);
+	Stream = nullptr;
+}
+
+bool UCompushadySoundWave::IsStreaming() const
+{
+	return GetStream().IsValid();
+}
+
+int64 UCompushadySoundWave::GetStreamingUnderruns() const
+{
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> CurrentStream = GetStream();
+	return CurrentStream ? CurrentStream->Ring.GetNumUnderruns() : 0;
+}
+
+int64 UCompushadySoundWave::GetStreamingDroppedChunks() const
+{
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> CurrentStream = GetStream();
+	return CurrentStream ? CurrentStream->Ring.GetNumDroppedChunks() : 0;
+}
+
+TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> UCompushadySoundWave::GetStream() const
+{
+	FScopeLock Lock(&StreamLock);
+	return Stream;
+}
+
 void UCompushadySoundWave::ClearSamples()
 {
 	ResetAudio();
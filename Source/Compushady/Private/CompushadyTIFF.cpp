@@ -1,394 +1,763 @@
 // Copyright 2023-2024 - Roberto De Ioris.
 
 
-#include "CompushadyTypes.h"
+#include "CompushadyTIFF.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryWriter.h"
 
 #define COMPUSHADY_TIFF_TYPE_ASCII 2
 #define COMPUSHADY_TIFF_TYPE_SHORT 3
 #define COMPUSHADY_TIFF_TYPE_LONG 4
 #define COMPUSHADY_TIFF_TYPE_RATIONAL 5
+#define COMPUSHADY_TIFF_TYPE_LONG8 16
 
 #define COMPUSHADY_TIFF_FORMAT_UINT 1
 #define COMPUSHADY_TIFF_FORMAT_INT 2
 #define COMPUSHADY_TIFF_FORMAT_FLOAT 3
 
-class FCompushadyTIFFGenerator
+#define COMPUSHADY_TIFF_COMPRESSION_NONE 1
+#define COMPUSHADY_TIFF_COMPRESSION_LZW 5
+#define COMPUSHADY_TIFF_COMPRESSION_DEFLATE 8
+
+#define COMPUSHADY_TIFF_PREDICTOR_HORIZONTAL 2
+#define COMPUSHADY_TIFF_PREDICTOR_FLOATINGPOINT 3
+
+namespace Compushady
 {
-public:
-	FCompushadyTIFFGenerator(TArray<uint8>& InData, const uint16 IFDEntryNum) : Data(InData)
+	namespace TIFF
 	{
-		// add file header
-		if (InData.Num() == 0)
+		class FCompushadyLZWBitWriter
 		{
-			Data.Add(0x49);
-			Data.Add(0x49);
-
-			Data.Add(42);
-			Data.Add(0);
-
-			Data.Add(8);
-			Data.Add(0);
-			Data.Add(0);
-			Data.Add(0);
+		public:
+			FCompushadyLZWBitWriter(TArray<uint8>& InOutput) : Output(InOutput)
+			{
+			}
+
+			void Put(const uint32 Code, const int32 CodeWidth)
+			{
+				BitBuffer = (BitBuffer << CodeWidth) | Code;
+				BitCount += CodeWidth;
+				while (BitCount >= 8)
+				{
+					Output.Add(static_cast<uint8>(BitBuffer >> (BitCount - 8)));
+					BitCount -= 8;
+				}
+			}
+
+			void Flush()
+			{
+				if (BitCount > 0)
+				{
+					Output.Add(static_cast<uint8>(BitBuffer << (8 - BitCount)));
+					BitCount = 0;
+				}
+			}
+
+		protected:
+			TArray<uint8>& Output;
+			uint32 BitBuffer = 0;
+			int32 BitCount = 0;
+		};
+
+		template<typename T>
+		void HorizontalDifferencing(uint8* Row, const uint32 NumSamples, const uint16 NumComponents)
+		{
+			T* Samples = reinterpret_cast<T*>(Row);
+			for (uint32 Index = NumSamples - 1; Index >= NumComponents; Index--)
+			{
+				Samples[Index] -= Samples[Index - NumComponents];
+			}
 		}
-#if 0
-		else
+
+		template<typename T>
+		void AddEntry(TArray<FCompushadyTIFFEntry>& Entries, const uint16 Tag, const uint16 Type, const TArray<T>& Values, const uint64 Count)
 		{
-			// add next IFDEntry
-			uint32 CurrentOffset = Data.Num();
-			FMemory::Memcpy(Data.GetData() + CurrentOffset - 4, &CurrentOffset, sizeof(uint32));
+			FCompushadyTIFFEntry& Entry = Entries.AddDefaulted_GetRef();
+			Entry.Tag = Tag;
+			Entry.Type = Type;
+			Entry.Count = Count;
+			Entry.Value.Append(reinterpret_cast<const uint8*>(Values.GetData()), Values.Num() * sizeof(T));
 		}
-#endif
 
-		Data.Append(reinterpret_cast<const uint8*>(&IFDEntryNum), sizeof(uint16));
+		template<typename T>
+		void AddEntry(TArray<FCompushadyTIFFEntry>& Entries, const uint16 Tag, const uint16 Type, const T Value)
+		{
+			AddEntry(Entries, Tag, Type, TArray<T>({ Value }), 1);
+		}
 
-		AdditionalDataOffset = Data.Num() + (12 * IFDEntryNum) + sizeof(uint32);
+		template<typename T>
+		void AppendValue(TArray<uint8>& Data, const T Value)
+		{
+			Data.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+		}
 	}
+}
 
-	void AddIFDEntry(const uint16 Tag, const uint16 Type, const uint32 NumberOfValues, const uint32 ValueOrOffset)
+bool Compushady::TIFF::GetSampleLayout(const EPixelFormat PixelFormat, uint16& NumComponents, uint16& BitsPerComponent, uint16& SampleFormat)
+{
+	if (!GPixelFormats[PixelFormat].Supported)
 	{
-		Data.Append(reinterpret_cast<const uint8*>(&Tag), sizeof(uint16));
-		Data.Append(reinterpret_cast<const uint8*>(&Type), sizeof(uint16));
-		Data.Append(reinterpret_cast<const uint8*>(&NumberOfValues), sizeof(uint32));
-		Data.Append(reinterpret_cast<const uint8*>(&ValueOrOffset), sizeof(uint32));
+		return false;
 	}
 
-	uint32 GetCurrentDataOffset() const
+	switch (PixelFormat)
 	{
-		return AdditionalDataOffset + static_cast<uint32>(AdditionalData.Num());
+	case EPixelFormat::PF_FloatRGBA:
+	case EPixelFormat::PF_R32G32B32F:
+	case EPixelFormat::PF_A32B32G32R32F:
+	case EPixelFormat::PF_R32_FLOAT:
+	case EPixelFormat::PF_G32R32F:
+	case EPixelFormat::PF_R16F:
+	case EPixelFormat::PF_G16R16F:
+	case EPixelFormat::PF_G16R16F_FILTER:
+	case EPixelFormat::PF_R16F_FILTER:
+		SampleFormat = COMPUSHADY_TIFF_FORMAT_FLOAT;
+		break;
+	case EPixelFormat::PF_R8G8B8A8:
+	case EPixelFormat::PF_R16G16B16A16_UINT:
+	case EPixelFormat::PF_R16G16B16A16_UNORM:
+	case EPixelFormat::PF_R32G32_UINT:
+	case EPixelFormat::PF_R16G16_UINT:
+	case EPixelFormat::PF_R8G8B8A8_UINT:
+	case EPixelFormat::PF_R32G32B32_UINT:
+	case EPixelFormat::PF_G16R16:
+	case EPixelFormat::PF_R16_UINT:
+	case EPixelFormat::PF_R32_UINT:
+	case EPixelFormat::PF_R8G8_UINT:
+	case EPixelFormat::PF_R32G32B32A32_UINT:
+	case EPixelFormat::PF_A8:
+	case EPixelFormat::PF_A16B16G16R16:
+	case EPixelFormat::PF_R8_UINT:
+		SampleFormat = COMPUSHADY_TIFF_FORMAT_UINT;
+		break;
+	case EPixelFormat::PF_R16G16B16A16_SINT:
+	case EPixelFormat::PF_R16G16B16A16_SNORM:
+	case EPixelFormat::PF_R8_SINT:
+	case EPixelFormat::PF_R8G8B8A8_SNORM:
+	case EPixelFormat::PF_R32G32B32_SINT:
+	case EPixelFormat::PF_G16R16_SNORM:
+	case EPixelFormat::PF_R8:
+	case EPixelFormat::PF_R8G8:
+	case EPixelFormat::PF_V8U8:
+	case EPixelFormat::PF_R16_SINT:
+	case EPixelFormat::PF_R32_SINT:
+		SampleFormat = COMPUSHADY_TIFF_FORMAT_INT;
+		break;
+	default:
+		return false;
 	}
 
-	uint32 AddAdditionalData(const uint32 Value)
-	{
-		const uint32 CurrentOffset = GetCurrentDataOffset();
-		AdditionalData.Append(reinterpret_cast<const uint8*>(&Value), sizeof(uint32));
-		return CurrentOffset;
-	}
+	NumComponents = GPixelFormats[PixelFormat].NumComponents;
+	BitsPerComponent = (GPixelFormats[PixelFormat].BlockBytes / NumComponents) * 8;
 
-	uint32 AddAdditionalData(const uint16 Value)
-	{
-		const uint32 CurrentOffset = GetCurrentDataOffset();
-		AdditionalData.Append(reinterpret_cast<const uint8*>(&Value), sizeof(uint16));
-		return CurrentOffset;
-	}
+	return true;
+}
 
-	uint32 AddAdditionalData(const uint8 Value)
-	{
-		const uint32 CurrentOffset = GetCurrentDataOffset();
-		AdditionalData.Add(Value);
-		return CurrentOffset;
-	}
+void Compushady::TIFF::LZWCompress(const uint8* Data, const int64 Size, TArray<uint8>& Output)
+{
+	constexpr uint32 ClearCode = 256;
+	constexpr uint32 EOICode = 257;
+	constexpr uint32 FirstCode = 258;
+	// the table is reset before the 12 bits codes run out
+	constexpr uint32 TableFullCode = 4094;
+	constexpr uint32 HashSize = 8192;
 
-	uint32 AddAdditionalData(const uint8* RawData, const int32 Num)
-	{
-		const uint32 CurrentOffset = GetCurrentDataOffset();
-		AdditionalData.Append(RawData, Num);
-		return CurrentOffset;
-	}
+	TArray<uint32> HashKeys;
+	HashKeys.SetNumZeroed(HashSize);
+	TArray<uint16> HashCodes;
+	HashCodes.SetNumUninitialized(HashSize);
 
-	void AddImageWidth(const uint32 Width)
+	Output.Reset();
+	Output.Reserve(Size / 2 + 16);
+
+	FCompushadyLZWBitWriter BitWriter(Output);
+
+	int32 CodeWidth = 9;
+	uint32 NextCode = FirstCode;
+
+	// the decoder adds its entries one code late, hence the width grows when NextCode overflows it (early change)
+	auto AdvanceCode = [&]()
+		{
+			NextCode++;
+			if (NextCode == TableFullCode)
+			{
+				BitWriter.Put(ClearCode, CodeWidth);
+				FMemory::Memzero(HashKeys.GetData(), HashKeys.Num() * sizeof(uint32));
+				NextCode = FirstCode;
+				CodeWidth = 9;
+			}
+			else if (NextCode > (1U << CodeWidth) - 1)
+			{
+				CodeWidth++;
+			}
+		};
+
+	BitWriter.Put(ClearCode, CodeWidth);
+
+	if (Size > 0)
 	{
-		AddIFDEntry(0x100, COMPUSHADY_TIFF_TYPE_SHORT, 1, Width);
+		uint32 Prefix = Data[0];
+		for (int64 Index = 1; Index < Size; Index++)
+		{
+			// keys are stored + 1, so that 0 marks the empty slots
+			const uint32 Key = ((Prefix << 8) | Data[Index]) + 1;
+			uint32 Slot = (Key * 2654435761U) >> 19;
+			bool bFound = false;
+			while (HashKeys[Slot] != 0)
+			{
+				if (HashKeys[Slot] == Key)
+				{
+					Prefix = HashCodes[Slot];
+					bFound = true;
+					break;
+				}
+				Slot = (Slot + 1) & (HashSize - 1);
+			}
+
+			if (bFound)
+			{
+				continue;
+			}
+
+			BitWriter.Put(Prefix, CodeWidth);
+			HashKeys[Slot] = Key;
+			HashCodes[Slot] = static_cast<uint16>(NextCode);
+			AdvanceCode();
+			Prefix = Data[Index];
+		}
+
+		BitWriter.Put(Prefix, CodeWidth);
+		AdvanceCode();
 	}
 
-	void AddImageHeight(const uint32 Width)
+	BitWriter.Put(EOICode, CodeWidth);
+	BitWriter.Flush();
+}
+
+void Compushady::TIFF::ApplyPredictor(uint8* Row, TArray<uint8>& Scratch, const uint32 Width, const uint16 NumComponents, const uint16 BitsPerComponent, const uint16 SampleFormat)
+{
+	const uint32 NumSamples = Width * NumComponents;
+	if (NumSamples <= NumComponents)
 	{
-		AddIFDEntry(0x101, COMPUSHADY_TIFF_TYPE_SHORT, 1, Width);
+		return;
 	}
 
-	void AddBitsPerSample(const uint16 NumComponents, const uint16 BitsPerSample)
+	if (SampleFormat != COMPUSHADY_TIFF_FORMAT_FLOAT)
 	{
-		if (NumComponents == 1)
-		{
-			AddIFDEntry(0x102, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, BitsPerSample);
-			return;
-		}
-
-		if (NumComponents == 2)
+		switch (BitsPerComponent)
 		{
-			AddIFDEntry(0x102, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, BitsPerSample << 16 | BitsPerSample);
-			return;
+		case 8:
+			HorizontalDifferencing<uint8>(Row, NumSamples, NumComponents);
+			break;
+		case 16:
+			HorizontalDifferencing<uint16>(Row, NumSamples, NumComponents);
+			break;
+		case 32:
+			HorizontalDifferencing<uint32>(Row, NumSamples, NumComponents);
+			break;
+		default:
+			break;
 		}
+		return;
+	}
 
-		const uint32 BitsPerSampleDataOffset = GetCurrentDataOffset();
-		for (uint16 ComponentIndex = 0; ComponentIndex < NumComponents; ComponentIndex++)
+	// split the samples in byte planes (most significant first), then difference the bytes
+	const uint32 BytesPerComponent = BitsPerComponent / 8;
+	const uint32 RowSize = NumSamples * BytesPerComponent;
+	Scratch.SetNumUninitialized(RowSize, EAllowShrinking::No);
+	FMemory::Memcpy(Scratch.GetData(), Row, RowSize);
+	for (uint32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+	{
+		for (uint32 ByteIndex = 0; ByteIndex < BytesPerComponent; ByteIndex++)
 		{
-			AddAdditionalData(BitsPerSample);
+			Row[ByteIndex * NumSamples + SampleIndex] = Scratch[SampleIndex * BytesPerComponent + (BytesPerComponent - 1 - ByteIndex)];
 		}
-		AddIFDEntry(0x102, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, BitsPerSampleDataOffset);
 	}
-
-	void AddCompression()
+	for (uint32 Index = RowSize - 1; Index >= NumComponents; Index--)
 	{
-		AddIFDEntry(0x103, COMPUSHADY_TIFF_TYPE_SHORT, 1, 1);
+		Row[Index] -= Row[Index - NumComponents];
 	}
+}
 
-	void AddPhotometricInterpretation()
+TSharedPtr<Compushady::TIFF::FCompushadyTIFFWriter> Compushady::TIFF::FCompushadyTIFFWriter::Create(const FString& Filename, const FCompushadyTIFFConfig& Config, FString& ErrorMessages)
+{
+	FArchive* FileWriter = IFileManager::Get().CreateFileWriter(*Filename);
+	if (!FileWriter)
 	{
-		AddIFDEntry(0x106, COMPUSHADY_TIFF_TYPE_SHORT, 1, 2);
+		ErrorMessages = FString::Printf(TEXT("Unable to open %s"), *Filename);
+		return nullptr;
 	}
 
-	void AddImageDescription(const FString& ImageDescription)
-	{
-		TArray<uint8> ASCII;
-		Compushady::StringToShaderCode(ImageDescription, ASCII);
-		ASCII.Add(static_cast<uint8>(0));
-	
-		if (ASCII.Num() <= 4)
-		{
-			AddIFDEntry(0x10e, COMPUSHADY_TIFF_TYPE_ASCII, ASCII.Num(), *(reinterpret_cast<const uint32*>(ASCII.GetData())));
-			return;
-		}
+	TSharedPtr<FCompushadyTIFFWriter> Writer = MakeShared<FCompushadyTIFFWriter>(*FileWriter, Config);
+	Writer->OwnedArchive = TUniquePtr<FArchive>(FileWriter);
+	return Writer;
+}
 
-		const uint32 ImageDescriptionDataOffset = AddAdditionalData(ASCII.GetData(), ASCII.Num());
-		// align
-		if (ASCII.Num() % 2 != 0)
-		{
-			AddAdditionalData(static_cast<uint8>(0));
-		}
-		AddIFDEntry(0x10e, COMPUSHADY_TIFF_TYPE_ASCII, ASCII.Num(), ImageDescriptionDataOffset);
+Compushady::TIFF::FCompushadyTIFFWriter::FCompushadyTIFFWriter(FArchive& InArchive, const FCompushadyTIFFConfig& InConfig) : Archive(&InArchive), Config(InConfig)
+{
+	TArray<uint8> Header = { 0x49, 0x49 };
+	if (Config.bBigTIFF)
+	{
+		AppendValue<uint16>(Header, 43);
+		AppendValue<uint16>(Header, 8);
+		AppendValue<uint16>(Header, 0);
+		NextIFDPointerPosition = Header.Num();
+		AppendValue<uint64>(Header, 0);
 	}
+	else
+	{
+		AppendValue<uint16>(Header, 42);
+		NextIFDPointerPosition = Header.Num();
+		AppendValue<uint32>(Header, 0);
+	}
+
+	Archive->Serialize(Header.GetData(), Header.Num());
+	WrittenBytes = Archive->Tell();
+}
+
+Compushady::TIFF::FCompushadyTIFFWriter::~FCompushadyTIFFWriter()
+{
+	FString ErrorMessages;
+	Close(ErrorMessages);
+}
 
-	void AddSamplesPerPixel(const uint16 NumSamples)
+bool Compushady::TIFF::FCompushadyTIFFWriter::CheckOffset(const uint64 Value, FString& ErrorMessages) const
+{
+	if (!Config.bBigTIFF && Value > MAX_uint32)
 	{
-		AddIFDEntry(0x115, COMPUSHADY_TIFF_TYPE_SHORT, 1, NumSamples);
+		ErrorMessages = "TIFF file exceeds 4GB, enable BigTIFF";
+		return false;
 	}
+	return true;
+}
 
-	void AddRowsPerStrip(const uint32 Height)
+void Compushady::TIFF::FCompushadyTIFFWriter::WritePadding()
+{
+	if (Archive->Tell() % 2 != 0)
 	{
-		AddIFDEntry(0x116, COMPUSHADY_TIFF_TYPE_SHORT, 1, Height);
+		uint8 Zero = 0;
+		Archive->Serialize(&Zero, 1);
 	}
+}
+
+bool Compushady::TIFF::FCompushadyTIFFWriter::WriteIFD(TArray<FCompushadyTIFFEntry>& Entries, FString& ErrorMessages)
+{
+	Entries.Sort([](const FCompushadyTIFFEntry& A, const FCompushadyTIFFEntry& B) { return A.Tag < B.Tag; });
+
+	WritePadding();
+
+	const uint64 IFDOffset = Archive->Tell();
+	const int32 ValueSize = Config.bBigTIFF ? 8 : 4;
+	const uint64 IFDSize = (Config.bBigTIFF ? 8 : 2) + Entries.Num() * (Config.bBigTIFF ? 20 : 12) + ValueSize;
+
+	TArray<uint8> IFD;
+	TArray<uint8> AdditionalData;
 
-	void AddPlanarConfiguration()
+	if (Config.bBigTIFF)
 	{
-		AddIFDEntry(0x11c, COMPUSHADY_TIFF_TYPE_SHORT, 1, 1);
+		AppendValue<uint64>(IFD, Entries.Num());
+	}
+	else
+	{
+		AppendValue<uint16>(IFD, Entries.Num());
 	}
 
-	void AddSampleFormat(const uint16 NumComponents, const uint16 Format)
+	for (const FCompushadyTIFFEntry& Entry : Entries)
 	{
-		if (NumComponents == 1)
+		AppendValue(IFD, Entry.Tag);
+		AppendValue(IFD, Entry.Type);
+		if (Config.bBigTIFF)
+		{
+			AppendValue<uint64>(IFD, Entry.Count);
+		}
+		else
 		{
-			AddIFDEntry(0x153, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, Format);
-			return;
+			AppendValue<uint32>(IFD, static_cast<uint32>(Entry.Count));
 		}
 
-		if (NumComponents == 2)
+		if (Entry.Value.Num() <= ValueSize)
 		{
-			AddIFDEntry(0x153, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, Format << 16 | Format);
-			return;
+			IFD.Append(Entry.Value);
+			IFD.AddZeroed(ValueSize - Entry.Value.Num());
+			continue;
 		}
 
-		const uint32 SampleFormatDataOffset = GetCurrentDataOffset();
-		for (uint16 ComponentIndex = 0; ComponentIndex < NumComponents; ComponentIndex++)
+		const uint64 ValueOffset = IFDOffset + IFDSize + AdditionalData.Num();
+		if (!CheckOffset(ValueOffset + Entry.Value.Num(), ErrorMessages))
 		{
-			AddAdditionalData(Format);
+			return false;
 		}
-		AddIFDEntry(0x153, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents, SampleFormatDataOffset);
-	}
 
-	void AddExtraSamples(const uint16 NumExtra)
-	{
-		if (NumExtra <= 2)
+		if (Config.bBigTIFF)
 		{
-			AddIFDEntry(0x152, COMPUSHADY_TIFF_TYPE_SHORT, NumExtra, 1);
-			return;
+			AppendValue<uint64>(IFD, ValueOffset);
+		}
+		else
+		{
+			AppendValue<uint32>(IFD, static_cast<uint32>(ValueOffset));
 		}
 
-		const uint32 ExtraSamplesDataOffset = GetCurrentDataOffset();
-		for (uint16 ComponentIndex = 0; ComponentIndex < NumExtra; ComponentIndex++)
+		AdditionalData.Append(Entry.Value);
+		// align
+		if (AdditionalData.Num() % 2 != 0)
 		{
-			AddAdditionalData(ComponentIndex == 0 ? static_cast<uint16>(1) : static_cast<uint16>(0));
+			AdditionalData.Add(0);
 		}
-		AddIFDEntry(0x152, COMPUSHADY_TIFF_TYPE_SHORT, NumExtra, ExtraSamplesDataOffset);
 	}
 
-	void AddStripByteCounts(const uint32 StripByteCounts)
+	// next IFD (patched by the next page)
+	IFD.AddZeroed(ValueSize);
+
+	Archive->Serialize(IFD.GetData(), IFD.Num());
+	Archive->Serialize(AdditionalData.GetData(), AdditionalData.Num());
+
+	// link the page to the previous one (or to the header)
+	const int64 EndOfFile = Archive->Tell();
+	Archive->Seek(NextIFDPointerPosition);
+	if (Config.bBigTIFF)
 	{
-		AddIFDEntry(0x117, COMPUSHADY_TIFF_TYPE_LONG, 1, StripByteCounts);
+		uint64 Offset = IFDOffset;
+		Archive->Serialize(&Offset, sizeof(uint64));
 	}
-
-	void AddStripOffsets(const void* RawPtr, const uint32 Stride, const uint32 Width, const uint32 Height, const uint32 PixelSize)
+	else
 	{
-		const uint32 ExtraStripOffsetsDataOffset = GetCurrentDataOffset();
-		const uint8* Ptr = reinterpret_cast<const uint8*>(RawPtr);
-		TArray<uint8> RowData;
-		RowData.AddUninitialized(Width * PixelSize);
-		for (uint32 Y = 0; Y < Height; Y++)
-		{
-			FMemory::Memcpy(RowData.GetData(), Ptr, RowData.Num());
-			AddAdditionalData(RowData.GetData(), RowData.Num());
-			Ptr += Stride;
-		}
-
-		AddIFDEntry(0x111, COMPUSHADY_TIFF_TYPE_LONG, 1, ExtraStripOffsetsDataOffset);
+		uint32 Offset = static_cast<uint32>(IFDOffset);
+		Archive->Serialize(&Offset, sizeof(uint32));
 	}
+	Archive->Seek(EndOfFile);
+
+	NextIFDPointerPosition = IFDOffset + IFDSize - ValueSize;
+
+	return true;
+}
 
-	void AddResolutionUnit()
+bool Compushady::TIFF::FCompushadyTIFFWriter::AddPage(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString& ImageDescription, FString& ErrorMessages)
+{
+	if (bClosed)
 	{
-		AddIFDEntry(0x128, COMPUSHADY_TIFF_TYPE_SHORT, 1, 1);
+		ErrorMessages = "TIFF writer is closed";
+		return false;
 	}
 
-	void AddXResolution(const uint32 Width)
+	if (Width == 0 || Height == 0)
 	{
-		const uint32 XResolutionDataOffset = GetCurrentDataOffset();
-		AddAdditionalData(Width);
-		AddAdditionalData(static_cast<const uint32>(1));
-		AddIFDEntry(0x11a, COMPUSHADY_TIFF_TYPE_RATIONAL, 1, XResolutionDataOffset);
+		ErrorMessages = "Invalid TIFF page size";
+		return false;
 	}
 
-	void AddYResolution(const uint32 Height)
+	if (Config.TileSize < 0 || Config.TileSize % 16 != 0)
 	{
-		const uint32 YResolutionDataOffset = GetCurrentDataOffset();
-		AddAdditionalData(Height);
-		AddAdditionalData(static_cast<const uint32>(1));
-		AddIFDEntry(0x11b, COMPUSHADY_TIFF_TYPE_RATIONAL, 1, YResolutionDataOffset);
+		ErrorMessages = "TIFF TileSize must be a multiple of 16";
+		return false;
 	}
 
-	int32 Finalize()
+	if (Config.RowsPerStrip < 0)
 	{
-		const int32 NextOffset = Data.Num();
-		Data.AddZeroed(4);
-		Data.Append(AdditionalData);
-		return NextOffset;
+		ErrorMessages = "Invalid TIFF RowsPerStrip";
+		return false;
 	}
 
-protected:
-	TArray<uint8>& Data;
-	TArray<uint8> AdditionalData;
-	uint32 AdditionalDataOffset = 0;
-};
-
-bool Compushady::Utils::GenerateTIFF(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString ImageDescription, TArray<uint8>& IFD)
-{
-	if (!GPixelFormats[PixelFormat].Supported)
+	uint16 NumComponents = 0;
+	uint16 BitsPerComponent = 0;
+	uint16 SampleFormat = 0;
+	if (!GetSampleLayout(PixelFormat, NumComponents, BitsPerComponent, SampleFormat))
 	{
-		UE_LOG(LogCompushady, Error, TEXT("Unsupported PixelFormat %d for TIFF generator"), static_cast<int32>(PixelFormat));
+		ErrorMessages = FString::Printf(TEXT("Unsupported PixelFormat %d for TIFF generator"), static_cast<int32>(PixelFormat));
 		return false;
 	}
 
-	const uint16 PixelSize = GPixelFormats[PixelFormat].BlockBytes;
-	const uint16 NumComponents = GPixelFormats[PixelFormat].NumComponents;
-	const uint16 BitsPerComponent = (PixelSize / NumComponents) * 8;
+	const uint32 PixelSize = GPixelFormats[PixelFormat].BlockBytes;
+	const bool bTiled = Config.TileSize > 0;
+	const bool bPredictor = Config.bPredictor && Config.Compression != ECompushadyTIFFCompression::None;
 
-	uint16 Format = 0;
+	// a chunk is a strip or a tile
+	const uint32 ChunkWidth = bTiled ? static_cast<uint32>(Config.TileSize) : Width;
+	uint32 ChunkHeight = bTiled ? static_cast<uint32>(Config.TileSize) : static_cast<uint32>(Config.RowsPerStrip);
+	if (ChunkHeight == 0)
+	{
+		ChunkHeight = FMath::Clamp<uint32>((1024 * 1024) / (Width * PixelSize), 1, Height);
+	}
+	else if (!bTiled)
+	{
+		ChunkHeight = FMath::Min(ChunkHeight, Height);
+	}
 
-	switch (PixelFormat)
+	const uint64 ChunkRowSize = static_cast<uint64>(ChunkWidth) * PixelSize;
+	if (ChunkRowSize * ChunkHeight > MAX_int32)
 	{
-	case EPixelFormat::PF_FloatRGBA:
-	case EPixelFormat::PF_R32G32B32F:
-	case EPixelFormat::PF_A32B32G32R32F:
-	case EPixelFormat::PF_R32_FLOAT:
-	case EPixelFormat::PF_G32R32F:
-	case EPixelFormat::PF_R16F:
-	case EPixelFormat::PF_G16R16F:
-	case EPixelFormat::PF_G16R16F_FILTER:
-	case EPixelFormat::PF_R16F_FILTER:
-		Format = COMPUSHADY_TIFF_FORMAT_FLOAT;
-		break;
-	case EPixelFormat::PF_R8G8B8A8:
-	case EPixelFormat::PF_R16G16B16A16_UINT:
-	case EPixelFormat::PF_R16G16B16A16_UNORM:
-	case EPixelFormat::PF_R32G32_UINT:
-	case EPixelFormat::PF_R16G16_UINT:
-	case EPixelFormat::PF_R8G8B8A8_UINT:
-	case EPixelFormat::PF_R32G32B32_UINT:
-	case EPixelFormat::PF_G16R16:
-	case EPixelFormat::PF_R16_UINT:
-	case EPixelFormat::PF_R32_UINT:
-	case EPixelFormat::PF_R8G8_UINT:
-	case EPixelFormat::PF_R32G32B32A32_UINT:
-	case EPixelFormat::PF_A8:
-	case EPixelFormat::PF_A16B16G16R16:
-	case EPixelFormat::PF_R8_UINT:
-		Format = COMPUSHADY_TIFF_FORMAT_UINT;
-		break;
-	case EPixelFormat::PF_R16G16B16A16_SINT:
-	case EPixelFormat::PF_R16G16B16A16_SNORM:
-	case EPixelFormat::PF_R8_SINT:
-	case EPixelFormat::PF_R8G8B8A8_SNORM:
-	case EPixelFormat::PF_R32G32B32_SINT:
-	case EPixelFormat::PF_G16R16_SNORM:
-	case EPixelFormat::PF_R8:
-	case EPixelFormat::PF_R8G8:
-	case EPixelFormat::PF_V8U8:
-	case EPixelFormat::PF_R16_SINT:
-	case EPixelFormat::PF_R32_SINT:
-		Format = COMPUSHADY_TIFF_FORMAT_INT;
-		break;
-	default:
-		UE_LOG(LogCompushady, Error, TEXT("Unsupported PixelFormat %d for TIFF generator"), static_cast<int32>(PixelFormat));
+		ErrorMessages = "TIFF strips/tiles must be smaller than 2GB";
 		return false;
 	}
 
-	uint16 IFDEntryNum = 14;
+	const uint32 ChunksAcross = bTiled ? FMath::DivideAndRoundUp(Width, ChunkWidth) : 1;
+	const uint32 ChunksDown = FMath::DivideAndRoundUp(Height, ChunkHeight);
+	const int32 NumChunks = static_cast<int32>(ChunksAcross * ChunksDown);
 
-	if (!ImageDescription.IsEmpty())
+	auto EncodeChunk = [&](const int32 ChunkIndex, TArray<uint8>& Output) -> bool
+		{
+			const uint32 ChunkX = (ChunkIndex % ChunksAcross) * ChunkWidth;
+			const uint32 ChunkY = (ChunkIndex / ChunksAcross) * ChunkHeight;
+			// strips are not padded, tiles always are
+			const uint32 NumRows = bTiled ? ChunkHeight : FMath::Min(ChunkHeight, Height - ChunkY);
+			const uint32 NumCopyRows = FMath::Min(NumRows, Height - ChunkY);
+			const uint64 CopySize = static_cast<uint64>(FMath::Min(ChunkWidth, Width - ChunkX)) * PixelSize;
+
+			TArray<uint8> Raw;
+			Raw.SetNumZeroed(static_cast<int32>(ChunkRowSize * NumRows));
+			TArray<uint8> Scratch;
+			for (uint32 Y = 0; Y < NumRows; Y++)
+			{
+				uint8* Row = Raw.GetData() + Y * ChunkRowSize;
+				if (Y < NumCopyRows)
+				{
+					FMemory::Memcpy(Row, reinterpret_cast<const uint8*>(Data) + static_cast<int64>(ChunkY + Y) * Stride + static_cast<int64>(ChunkX) * PixelSize, CopySize);
+				}
+
+				if (bPredictor)
+				{
+					ApplyPredictor(Row, Scratch, ChunkWidth, NumComponents, BitsPerComponent, SampleFormat);
+				}
+			}
+
+			if (Config.Compression == ECompushadyTIFFCompression::LZW)
+			{
+				LZWCompress(Raw.GetData(), Raw.Num(), Output);
+				return true;
+			}
+
+			if (Config.Compression == ECompushadyTIFFCompression::Deflate)
+			{
+				int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Raw.Num());
+				Output.SetNumUninitialized(CompressedSize, EAllowShrinking::No);
+				if (!FCompression::CompressMemory(NAME_Zlib, Output.GetData(), CompressedSize, Raw.GetData(), Raw.Num()))
+				{
+					return false;
+				}
+				Output.SetNum(CompressedSize, EAllowShrinking::No);
+				return true;
+			}
+
+			Output = MoveTemp(Raw);
+			return true;
+		};
+
+	TArray<uint64> ChunkOffsets;
+	TArray<uint64> ChunkByteCounts;
+	ChunkOffsets.Reserve(NumChunks);
+	ChunkByteCounts.Reserve(NumChunks);
+
+	// bounds the memory to a couple of chunks per worker
+	const int32 BatchSize = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1) * 2;
+	TArray<TArray<uint8>> EncodedChunks;
+	EncodedChunks.SetNum(BatchSize);
+
+	for (int32 BatchStart = 0; BatchStart < NumChunks; BatchStart += BatchSize)
 	{
-		IFDEntryNum++;
-	}
+		const int32 BatchNum = FMath::Min(BatchSize, NumChunks - BatchStart);
+		std::atomic<bool> bFailed{ false };
+		ParallelFor(BatchNum, [&](const int32 Index)
+			{
+				if (!EncodeChunk(BatchStart + Index, EncodedChunks[Index]))
+				{
+					bFailed = true;
+				}
+			});
+
+		if (bFailed)
+		{
+			ErrorMessages = "Unable to compress TIFF data";
+			return false;
+		}
 
-	if (NumComponents > 3)
-	{
-		IFDEntryNum++;
+		for (int32 Index = 0; Index < BatchNum; Index++)
+		{
+			const uint64 ChunkOffset = Archive->Tell();
+			if (!CheckOffset(ChunkOffset + EncodedChunks[Index].Num(), ErrorMessages))
+			{
+				return false;
+			}
+			ChunkOffsets.Add(ChunkOffset);
+			ChunkByteCounts.Add(EncodedChunks[Index].Num());
+			Archive->Serialize(EncodedChunks[Index].GetData(), EncodedChunks[Index].Num());
+		}
+
+		if (Archive->IsError())
+		{
+			ErrorMessages = "Unable to write TIFF data";
+			return false;
+		}
 	}
 
-	FCompushadyTIFFGenerator TIFFGenerator(IFD, IFDEntryNum);
+	TArray<FCompushadyTIFFEntry> Entries;
 
 	// 0100 ImageWidth
-	TIFFGenerator.AddImageWidth(Width);
+	AddEntry<uint32>(Entries, 0x100, COMPUSHADY_TIFF_TYPE_LONG, Width);
 
-	// 0101 ImageHeight
-	TIFFGenerator.AddImageHeight(Height);
+	// 0101 ImageLength
+	AddEntry<uint32>(Entries, 0x101, COMPUSHADY_TIFF_TYPE_LONG, Height);
 
 	// 0102 BitsPerSample
-	TIFFGenerator.AddBitsPerSample(NumComponents, BitsPerComponent);
+	TArray<uint16> BitsPerSample;
+	BitsPerSample.Init(BitsPerComponent, NumComponents);
+	AddEntry(Entries, 0x102, COMPUSHADY_TIFF_TYPE_SHORT, BitsPerSample, NumComponents);
 
 	// 0103 Compression
-	TIFFGenerator.AddCompression();
+	uint16 Compression = COMPUSHADY_TIFF_COMPRESSION_NONE;
+	if (Config.Compression == ECompushadyTIFFCompression::LZW)
+	{
+		Compression = COMPUSHADY_TIFF_COMPRESSION_LZW;
+	}
+	else if (Config.Compression == ECompushadyTIFFCompression::Deflate)
+	{
+		Compression = COMPUSHADY_TIFF_COMPRESSION_DEFLATE;
+	}
+	AddEntry<uint16>(Entries, 0x103, COMPUSHADY_TIFF_TYPE_SHORT, Compression);
 
-	// 0106 PhotometricInterpretation
-	TIFFGenerator.AddPhotometricInterpretation();
+	// 0106 PhotometricInterpretation (BlackIsZero or RGB)
+	const uint16 NumColorComponents = NumComponents < 3 ? 1 : 3;
+	AddEntry<uint16>(Entries, 0x106, COMPUSHADY_TIFF_TYPE_SHORT, NumColorComponents == 1 ? 1 : 2);
 
-	// 10e ImageDescription
+	// 010e ImageDescription
 	if (!ImageDescription.IsEmpty())
 	{
-		TIFFGenerator.AddImageDescription(ImageDescription);
+		TArray<uint8> ASCII;
+		Compushady::StringToShaderCode(ImageDescription, ASCII);
+		ASCII.Add(0);
+		AddEntry(Entries, 0x10e, COMPUSHADY_TIFF_TYPE_ASCII, ASCII, ASCII.Num());
+	}
+
+	// 0115 SamplesPerPixel
+	AddEntry<uint16>(Entries, 0x115, COMPUSHADY_TIFF_TYPE_SHORT, NumComponents);
+
+	// 011a XResolution
+	AddEntry(Entries, 0x11a, COMPUSHADY_TIFF_TYPE_RATIONAL, TArray<uint32>({ Width, 1 }), 1);
+
+	// 011b YResolution
+	AddEntry(Entries, 0x11b, COMPUSHADY_TIFF_TYPE_RATIONAL, TArray<uint32>({ Height, 1 }), 1);
+
+	// 011c PlanarConfiguration
+	AddEntry<uint16>(Entries, 0x11c, COMPUSHADY_TIFF_TYPE_SHORT, 1);
+
+	// 0128 ResolutionUnit
+	AddEntry<uint16>(Entries, 0x128, COMPUSHADY_TIFF_TYPE_SHORT, 1);
+
+	// 013d Predictor
+	if (bPredictor)
+	{
+		AddEntry<uint16>(Entries, 0x13d, COMPUSHADY_TIFF_TYPE_SHORT, SampleFormat == COMPUSHADY_TIFF_FORMAT_FLOAT ? COMPUSHADY_TIFF_PREDICTOR_FLOATINGPOINT : COMPUSHADY_TIFF_PREDICTOR_HORIZONTAL);
+	}
+
+	// 0111 StripOffsets, 0117 StripByteCounts or 0144 TileOffsets, 0145 TileByteCounts
+	const uint16 OffsetsTag = bTiled ? 0x144 : 0x111;
+	const uint16 ByteCountsTag = bTiled ? 0x145 : 0x117;
+	if (Config.bBigTIFF)
+	{
+		AddEntry(Entries, OffsetsTag, COMPUSHADY_TIFF_TYPE_LONG8, ChunkOffsets, NumChunks);
+		AddEntry(Entries, ByteCountsTag, COMPUSHADY_TIFF_TYPE_LONG8, ChunkByteCounts, NumChunks);
+	}
+	else
+	{
+		TArray<uint32> ChunkOffsets32;
+		TArray<uint32> ChunkByteCounts32;
+		for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++)
+		{
+			ChunkOffsets32.Add(static_cast<uint32>(ChunkOffsets[ChunkIndex]));
+			ChunkByteCounts32.Add(static_cast<uint32>(ChunkByteCounts[ChunkIndex]));
+		}
+		AddEntry(Entries, OffsetsTag, COMPUSHADY_TIFF_TYPE_LONG, ChunkOffsets32, NumChunks);
+		AddEntry(Entries, ByteCountsTag, COMPUSHADY_TIFF_TYPE_LONG, ChunkByteCounts32, NumChunks);
+	}
+
+	if (bTiled)
+	{
+		// 0142 TileWidth
+		AddEntry<uint32>(Entries, 0x142, COMPUSHADY_TIFF_TYPE_LONG, ChunkWidth);
+		// 0143 TileLength
+		AddEntry<uint32>(Entries, 0x143, COMPUSHADY_TIFF_TYPE_LONG, ChunkHeight);
+	}
+	else
+	{
+		// 0116 RowsPerStrip
+		AddEntry<uint32>(Entries, 0x116, COMPUSHADY_TIFF_TYPE_LONG, ChunkHeight);
 	}
 
-	// 111 StripOffsets
-	TIFFGenerator.AddStripOffsets(Data, Stride, Width, Height, PixelSize);
+	// 0152 ExtraSamples
+	if (NumComponents > NumColorComponents)
+	{
+		TArray<uint16> ExtraSamples;
+		ExtraSamples.AddZeroed(NumComponents - NumColorComponents);
+		ExtraSamples[0] = 1;
+		AddEntry(Entries, 0x152, COMPUSHADY_TIFF_TYPE_SHORT, ExtraSamples, ExtraSamples.Num());
+	}
 
-	// 115 SamplesPerPixel
-	TIFFGenerator.AddSamplesPerPixel(NumComponents);
+	// 0153 SampleFormat
+	TArray<uint16> SampleFormats;
+	SampleFormats.Init(SampleFormat, NumComponents);
+	AddEntry(Entries, 0x153, COMPUSHADY_TIFF_TYPE_SHORT, SampleFormats, NumComponents);
 
-	// 116 RowsPerStrip
-	TIFFGenerator.AddRowsPerStrip(Height);
+	if (!WriteIFD(Entries, ErrorMessages))
+	{
+		return false;
+	}
+
+	if (Archive->IsError())
+	{
+		ErrorMessages = "Unable to write TIFF data";
+		return false;
+	}
 
-	// 117 StripByteCounts
-	TIFFGenerator.AddStripByteCounts(Width * Height * PixelSize);
+	WrittenBytes = Archive->Tell();
+	NumPages++;
 
-	// 11a XResolution
-	TIFFGenerator.AddXResolution(Width);
+	return true;
+}
 
-	// 11b YResolution
-	TIFFGenerator.AddYResolution(Height);
+bool Compushady::TIFF::FCompushadyTIFFWriter::Close(FString& ErrorMessages)
+{
+	if (bClosed)
+	{
+		return true;
+	}
 
-	// 11c PlanarConfiguration
-	TIFFGenerator.AddPlanarConfiguration();
+	bClosed = true;
 
-	// 128 ResolutionUnit
-	TIFFGenerator.AddResolutionUnit();
+	bool bSuccess = !Archive->IsError();
+	if (OwnedArchive)
+	{
+		bSuccess = OwnedArchive->Close() && bSuccess;
+		OwnedArchive.Reset();
+	}
+	Archive = nullptr;
 
-	// 152 ExtraSamples
-	if (NumComponents > 3)
+	if (!bSuccess)
 	{
-		TIFFGenerator.AddExtraSamples(NumComponents - 3);
+		ErrorMessages = "Unable to write TIFF data";
 	}
 
-	// 153 SampleFormat
-	TIFFGenerator.AddSampleFormat(NumComponents, Format);
+	return bSuccess;
+}
+
+bool Compushady::Utils::GenerateTIFF(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString ImageDescription, TArray<uint8>& IFD)
+{
+	return GenerateTIFF(Data, Stride, Width, Height, PixelFormat, ImageDescription, FCompushadyTIFFConfig(), IFD);
+}
+
+bool Compushady::Utils::GenerateTIFF(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString ImageDescription, const FCompushadyTIFFConfig& Config, TArray<uint8>& IFD)
+{
+	TArray<uint8> TIFFData;
+	FMemoryWriter MemoryWriter(TIFFData);
+
+	FString ErrorMessages;
+	Compushady::TIFF::FCompushadyTIFFWriter TIFFWriter(MemoryWriter, Config);
+	if (!TIFFWriter.AddPage(Data, Stride, Width, Height, PixelFormat, ImageDescription, ErrorMessages) || !TIFFWriter.Close(ErrorMessages))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+		return false;
+	}
 
-	TIFFGenerator.Finalize();
+	IFD.Append(TIFFData);
 
 	return true;
-}
\ No newline at end of file
+}
@@ -6,14 +6,34 @@
 #include "CompushadySampler.h"
 #include "CompushadySRV.h"
 #include "CompushadyUAV.h"
+#include "CompushadyMips.h"
+#include "CompushadyShaderRegistry.h"
+#include "CompushadyTIFF.h"
+#include "CompushadyWAVRecorder.h"
+#include "Async/Async.h"
 #include "CommonRenderResources.h"
 #include "IImageWrapper.h"
 #include "IImageWrapperModule.h"
 #include "Engine/Canvas.h"
 #include "Serialization/ArrayWriter.h"
+#include "HAL/FileManager.h"
 #include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "RHIStaticStates.h"
 
+namespace Compushady
+{
+	struct FCompushadyResourceVersion
+	{
+		std::atomic<uint64> Value{ 0 };
+	};
+
+	namespace Versions
+	{
+		// the counters can be requested by the render thread too (IncrementVersion)
+		static FCriticalSection Lock;
+	}
+}
 
 FTextureRHIRef UCompushadyResource::GetTextureRHI() const
 {
@@ -30,6 +50,66 @@ const FRHITransitionInfo& UCompushadyResource::GetRHITransitionInfo() const
 	return RHITransitionInfo;
 }
 
+FRHIResource* UCompushadyResource::GetVersionedRHIResource() const
+{
+	return TextureRHIRef.IsValid() ? static_cast<FRHIResource*>(TextureRHIRef.GetReference()) : static_cast<FRHIResource*>(BufferRHIRef.GetReference());
+}
+
+TSharedPtr<Compushady::FCompushadyResourceVersion, ESPMode::ThreadSafe> UCompushadyResource::GetVersionCounter() const
+{
+	FRHIResource* RHIResource = GetVersionedRHIResource();
+
+	FScopeLock Lock(&Compushady::Versions::Lock);
+
+	if (VersionCounter.IsValid() && VersionCounterRHIResource == RHIResource)
+	{
+		return VersionCounter;
+	}
+
+	// a resource reinitialized with a new texture or buffer must not go back to an older version
+	const uint64 MinVersion = VersionCounter.IsValid() ? VersionCounter->Value.load() + 1 : 0;
+
+	VersionCounter = MakeShared<Compushady::FCompushadyResourceVersion, ESPMode::ThreadSafe>();
+	VersionCounter->Value = MinVersion;
+	VersionCounterRHIResource = RHIResource;
+
+	return VersionCounter;
+}
+
+void UCompushadyResource::ShareVersionCounter(const UCompushadyResource* Resource)
+{
+	if (!Resource || Resource == this)
+	{
+		return;
+	}
+
+	TSharedPtr<Compushady::FCompushadyResourceVersion, ESPMode::ThreadSafe> Counter = Resource->GetVersionCounter();
+	FRHIResource* RHIResource = Resource->GetVersionedRHIResource();
+
+	FScopeLock Lock(&Compushady::Versions::Lock);
+
+	// a view on a different texture or buffer keeps its own counter
+	if (RHIResource && RHIResource == GetVersionedRHIResource())
+	{
+		VersionCounter = Counter;
+		VersionCounterRHIResource = RHIResource;
+	}
+}
+
+int64 UCompushadyResource::GetVersion() const
+{
+	return static_cast<int64>(GetVersionCounter()->Value.load());
+}
+
+void UCompushadyResource::IncrementVersion()
+{
+	ENQUEUE_RENDER_COMMAND(DoCompushadyIncrementVersion)(
+		[Counter = GetVersionCounter()](FRHICommandListImmediate& RHICmdList)
+		{
+			Counter->Value++;
+		});
+}
+
 FStagingBufferRHIRef UCompushadyResource::GetStagingBuffer()
 {
 	if (!StagingBufferRHIRef.IsValid() || !StagingBufferRHIRef->IsValid())
@@ -104,6 +184,8 @@ bool UCompushadyResource::UpdateTextureSliceSyncWithFunction(const uint8* Ptr, c
 			}
 		});
 
+	IncrementVersion();
+
 	FlushRenderingCommands();
 
 	return true;
@@ -242,7 +324,7 @@ bool UCompushadyResource::ReadbackTextureToPNGFileSync(const FString& Filename,
 	return MapTextureSliceAndExecuteSync(PngWriter, 0);
 }
 
-bool UCompushadyResource::ReadbackTextureToTIFFFileSync(const FString& Filename, const FString& ImageDescription, FString& ErrorMessages)
+bool UCompushadyResource::ReadbackTextureToTIFFFileSync(const FString& Filename, const FString& ImageDescription, FString& ErrorMessages, const FCompushadyTIFFConfig& Config)
 {
 	if (!IsValidTexture())
 	{
@@ -250,21 +332,233 @@ bool UCompushadyResource::ReadbackTextureToTIFFFileSync(const FString& Filename,
 		return false;
 	}
 
-	auto TIFFWriter = [this, Filename, ImageDescription](const void* Data, const uint32 Stride)
+	if (IsRunning())
+	{
+		ErrorMessages = "The Resource is already being processed by another task";
+		return false;
+	}
+
+	// pages are written to a temporary file (in the same directory), moved to Filename only when complete
+	const FString TempFilename = FPaths::CreateTempFilename(*FPaths::GetPath(Filename), TEXT("CompushadyTIFF"), TEXT(".tmp"));
+	TSharedPtr<Compushady::TIFF::FCompushadyTIFFWriter> TIFFWriter = Compushady::TIFF::FCompushadyTIFFWriter::Create(TempFilename, Config, ErrorMessages);
+	if (!TIFFWriter)
+	{
+		return false;
+	}
+
+	const FIntVector Size = GetTextureSize();
+	const EPixelFormat PixelFormat = GetTextureRHI()->GetDesc().Format;
+	const ETextureDimension Dimension = GetTextureRHI()->GetDesc().Dimension;
+	const int32 NumSlices = Dimension == ETextureDimension::Texture3D || Dimension == ETextureDimension::Texture2DArray ? Size.Z : 1;
+
+	// one page per slice, each one is written as soon as it is read back
+	bool bSuccess = true;
+	for (int32 Slice = 0; Slice < NumSlices && bSuccess; Slice++)
+	{
+		auto PageWriter = [&](const void* Data, const uint32 Stride)
+			{
+				bSuccess = TIFFWriter->AddPage(Data, Stride, Size.X, Size.Y, PixelFormat, Slice == 0 ? ImageDescription : FString(), ErrorMessages);
+			};
+
+		if (!MapTextureSliceAndExecuteSync(PageWriter, Slice))
+		{
+			ErrorMessages = FString::Printf(TEXT("Unable to read back slice %d"), Slice);
+			bSuccess = false;
+		}
+	}
+
+	FString CloseErrorMessages;
+	if (!TIFFWriter->Close(CloseErrorMessages) && bSuccess)
+	{
+		ErrorMessages = CloseErrorMessages;
+		bSuccess = false;
+	}
+
+	if (bSuccess && !IFileManager::Get().Move(*Filename, *TempFilename, true))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to write %s"), *Filename);
+		bSuccess = false;
+	}
+
+	if (!bSuccess)
+	{
+		IFileManager::Get().Delete(*TempFilename);
+	}
+
+	return bSuccess;
+}
+
+void UCompushadyResource::ReadbackTextureToEXRFile(const FString& Filename, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, const FCompushadySignaled& OnSignaled)
+{
+	if (!IsValidTexture())
+	{
+		OnSignaled.ExecuteIfBound(false, "The resource is not a valid Texture");
+		return;
+	}
+
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The Resource is already being processed by another task");
+		return;
+	}
+
+	const EPixelFormat PixelFormat = GetTextureRHI()->GetDesc().Format;
+	if (!Compushady::Utils::IsEXRPixelFormat(PixelFormat))
+	{
+		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Unsupported Pixel Format %s for EXR"), GetPixelFormatString(PixelFormat)));
+		return;
+	}
+
+	bRunning = true;
+
+	// only the copy happens on the render thread, encoding and file writing are moved to the thread pool
+	ENQUEUE_RENDER_COMMAND(DoCompushadyReadbackTextureToEXR)(
+		[this, Filename, PixelType, Compression, PixelFormat, OnSignaled](FRHICommandListImmediate& RHICmdList)
+		{
+			const FIntVector Size = GetTextureSize();
+			const int32 Stride = Size.X * GPixelFormats[PixelFormat].BlockBytes;
+			TArray64<uint8> Pixels;
+
+			auto Copy = [&](const void* Data, const uint32 SourceStride)
+				{
+					Pixels.AddUninitialized(static_cast<int64>(Stride) * Size.Y);
+					for (int32 Y = 0; Y < Size.Y; Y++)
+					{
+						FMemory::Memcpy(Pixels.GetData() + static_cast<int64>(Y) * Stride, reinterpret_cast<const uint8*>(Data) + static_cast<int64>(Y) * SourceStride, Stride);
+					}
+				};
+
+			MapTextureSliceAndExecute_RenderThread(RHICmdList, Copy, 0);
+
+			Async(EAsyncExecution::ThreadPool, [this, Filename, PixelType, Compression, PixelFormat, OnSignaled, Size, Stride, Pixels = MoveTemp(Pixels)]()
+				{
+					FString ErrorMessages;
+					bool bSuccess = false;
+					if (Pixels.Num() == 0)
+					{
+						ErrorMessages = "Unable to map the texture";
+					}
+					else
+					{
+						TArray64<uint8> EXR;
+						if (Compushady::Utils::GenerateEXR(Pixels.GetData(), Stride, Size.X, Size.Y, PixelFormat, PixelType, Compression, EXR, ErrorMessages))
+						{
+							bSuccess = FFileHelper::SaveArrayToFile(EXR, *Filename);
+							if (!bSuccess)
+							{
+								ErrorMessages = FString::Printf(TEXT("Unable to write %s"), *Filename);
+							}
+						}
+					}
+
+					AsyncTask(ENamedThreads::GameThread, [this, OnSignaled, bSuccess, ErrorMessages]()
+						{
+							bRunning = false;
+							OnSignaled.ExecuteIfBound(bSuccess, ErrorMessages);
+							OnSignalReceived();
+						});
+				});
+		});
+}
+
+bool UCompushadyResource::ReadbackTextureToEXRFileSync(const FString& Filename, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, FString& ErrorMessages)
+{
+	if (!IsValidTexture())
+	{
+		ErrorMessages = "The resource is not a valid Texture";
+		return false;
+	}
+
+	const EPixelFormat PixelFormat = GetTextureRHI()->GetDesc().Format;
+	if (!Compushady::Utils::IsEXRPixelFormat(PixelFormat))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s for EXR"), GetPixelFormatString(PixelFormat));
+		return false;
+	}
+
+	bool bSuccess = false;
+	auto EXRWriter = [&](const void* Data, const uint32 Stride)
 		{
 			const FIntVector Size = GetTextureSize();
-			const EPixelFormat PixelFormat = GetTextureRHI()->GetDesc().Format;
-			TArray<uint8> TIFF;
-			if (Compushady::Utils::GenerateTIFF(Data, Stride, Size.X, Size.Y, PixelFormat, ImageDescription, TIFF))
+			TArray64<uint8> EXR;
+			if (Compushady::Utils::GenerateEXR(Data, Stride, Size.X, Size.Y, PixelFormat, PixelType, Compression, EXR, ErrorMessages))
+			{
+				bSuccess = FFileHelper::SaveArrayToFile(EXR, *Filename);
+				if (!bSuccess)
+				{
+					ErrorMessages = FString::Printf(TEXT("Unable to write %s"), *Filename);
+				}
+			}
+		};
+
+	if (!MapTextureSliceAndExecuteSync(EXRWriter, 0))
+	{
+		ErrorMessages = "The Resource is already being processed by another task";
+		return false;
+	}
+
+	if (!bSuccess && ErrorMessages.IsEmpty())
+	{
+		ErrorMessages = "Unable to map the texture";
+	}
+
+	return bSuccess;
+}
+
+bool UCompushadyResource::ReadbackBufferToEXRFileSync(const FString& Filename, const int64 Offset, const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, FString& ErrorMessages)
+{
+	if (!IsValidBuffer())
+	{
+		ErrorMessages = "The resource is not a valid Buffer";
+		return false;
+	}
+
+	if (IsRunning())
+	{
+		ErrorMessages = "The Resource is already being processed by another task";
+		return false;
+	}
+
+	if (!Compushady::Utils::IsEXRPixelFormat(PixelFormat))
+	{
+		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s for EXR"), GetPixelFormatString(PixelFormat));
+		return false;
+	}
+
+	if (Width <= 0 || Height <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid EXR size %dx%d"), Width, Height);
+		return false;
+	}
+
+	const int32 Stride = Width * GPixelFormats[PixelFormat].BlockBytes;
+	if (Offset < 0 || Offset + static_cast<int64>(Stride) * Height > GetBufferSize())
+	{
+		ErrorMessages = "Invalid Buffer offset";
+		return false;
+	}
+
+	auto EXRWriter = [&](const void* Data)
+		{
+			TArray64<uint8> EXR;
+			if (!Compushady::Utils::GenerateEXR(reinterpret_cast<const uint8*>(Data) + Offset, Stride, Width, Height, PixelFormat, PixelType, Compression, EXR, ErrorMessages))
+			{
+				return false;
+			}
+
+			if (!FFileHelper::SaveArrayToFile(EXR, *Filename))
 			{
-				FFileHelper::SaveArrayToFile(TIFF, *Filename);
+				ErrorMessages = FString::Printf(TEXT("Unable to write %s"), *Filename);
+				return false;
 			}
+
+			return true;
 		};
 
-	return MapTextureSliceAndExecuteSync(TIFFWriter, 0);
+	return MapReadAndExecuteSync(EXRWriter);
 }
 
-bool UCompushadyResource::ReadbackBufferToWAVFileSync(const FString& Filename, const int64 Offset, const int64 Size, const int32 SampleRate, const int32 NumChannels, const EPixelFormat PixelFormat, const ECompushadyWAVFormat WAVFormat, FString& ErrorMessages)
+bool UCompushadyResource::ReadbackBufferToWAVFileSync(const FString& Filename, const int64 Offset, const int64 Size, const int32 SampleRate, const int32 NumChannels, const EPixelFormat PixelFormat, const ECompushadyWAVFormat WAVFormat, FString& ErrorMessages, const bool bPlanar, const bool bDither)
 {
 	if (!IsValidBuffer())
 	{
@@ -275,60 +569,43 @@ bool UCompushadyResource::ReadbackBufferToWAVFileSync(const FString& Filename, c
 	int64 WantedSize = Size;
 	if (WantedSize == 0)
 	{
-		WantedSize = GetBufferSize();
+		WantedSize = GetBufferSize() - Offset;
 	}
 
-	if (Offset < 0 || Offset + WantedSize > GetBufferSize())
+	if (Offset < 0 || WantedSize < 0 || Offset + WantedSize > GetBufferSize())
 	{
 		ErrorMessages = "Invalid Buffer offset";
 		return false;
 	}
 
-	if (!GPixelFormats[PixelFormat].Supported)
+	if (PixelFormat != EPixelFormat::PF_R32_FLOAT)
 	{
 		ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s"), GetPixelFormatString(PixelFormat));
 		return false;
 	}
 
-	if (PixelFormat == EPixelFormat::PF_R32_FLOAT)
+	if (NumChannels <= 0)
 	{
-		auto WAVWriter = [Filename, NumChannels, SampleRate, Offset, WantedSize](const void* Data)
-			{
-				TArray<uint8> WAV;
-				const uint32 WantedSize32 = WantedSize;
-				const uint32 OverallFileSize = 12 + 24 + 8 + WantedSize;
-				WAV.Append({ 0x52, 0x49, 0x46, 0x46 }); // RIFF
-				WAV.Append(reinterpret_cast<const uint8*>(&OverallFileSize), sizeof(uint32)); // file size - 8
-				WAV.Append({ 0x57, 0x41, 0x56, 0x45 }); // WAVE
-
-				WAV.Append({ 0x66, 0x6D, 0x74, 0x20 }); // fmt
-				WAV.Append({ 0x10, 0, 0, 0 }); // chunk size (16)
-				WAV.Append({ 3, 0 }); // Audio format (float)
-				const uint16 NumChannels16 = NumChannels;
-				const uint32 SampleRate32 = SampleRate;
-				const uint16 BytesPerBlock = sizeof(float) * NumChannels;
-				const uint32 BytesPerSec = SampleRate * BytesPerBlock;
-				const uint16 BitsPerSample = 32;
-				WAV.Append(reinterpret_cast<const uint8*>(&NumChannels16), sizeof(uint16)); // Number of channels
-				WAV.Append(reinterpret_cast<const uint8*>(&SampleRate32), sizeof(uint32)); // Sample rate
-				WAV.Append(reinterpret_cast<const uint8*>(&BytesPerSec), sizeof(uint32)); // Number of bytes to read per second
-				WAV.Append(reinterpret_cast<const uint8*>(&BytesPerBlock), sizeof(uint16)); // Number of bytes per block
-				WAV.Append(reinterpret_cast<const uint8*>(&BitsPerSample), sizeof(uint16)); // Number of bits per sample
-
-				WAV.Append({ 0x64, 0x61, 0x74, 0x61 }); // data
-				WAV.Append(reinterpret_cast<const uint8*>(&WantedSize32), sizeof(uint32)); // SampledData size
-
-				WAV.Append(reinterpret_cast<const uint8*>(Data) + Offset, WantedSize);
-
-				FFileHelper::SaveArrayToFile(WAV, *Filename);
-
-				return true;
-			};
-		return MapReadAndExecuteSync(WAVWriter);
+		ErrorMessages = FString::Printf(TEXT("Invalid NumChannels %d"), NumChannels);
+		return false;
+	}
+
+	const int64 NumFrames = WantedSize / (static_cast<int64>(sizeof(float)) * NumChannels);
+
+	TSharedPtr<Compushady::WAV::FCompushadyWAVWriter> Writer = Compushady::WAV::FCompushadyWAVWriter::Create(Filename, SampleRate, NumChannels, WAVFormat, bDither, ErrorMessages);
+	if (!Writer)
+	{
+		return false;
 	}
 
-	ErrorMessages = FString::Printf(TEXT("Unsupported Pixel Format %s"), GetPixelFormatString(PixelFormat));
-	return false;
+	auto WAVWriter = [Writer, Offset, NumFrames, bPlanar, &ErrorMessages](const void* Data)
+		{
+			const float* Samples = reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(Data) + Offset);
+			return Writer->Write(Samples, NumFrames, bPlanar ? NumFrames : 0, ErrorMessages);
+		};
+
+	const bool bSuccess = MapReadAndExecuteSync(WAVWriter);
+	return Writer->Close(ErrorMessages) && bSuccess;
 }
 
 void UCompushadyResource::ReadbackBufferToFile(const FString& Filename, const int64 Offset, const int64 Size, const FCompushadySignaled& OnSignaled)
@@ -666,6 +943,8 @@ void UCompushadyResource::CopyFromMediaTexture(UMediaTexture* MediaTexture, cons
 	{
 		return;
 	}
+
+	IncrementVersion();
 }
 
 
@@ -841,6 +1120,61 @@ void UCompushadyResource::OnSignalReceived()
 
 }
 
+void UCompushadyResource::GenerateMips(const ECompushadyMipFilter Filter, const FCompushadySignaled& OnSignaled)
+{
+	if (IsRunning())
+	{
+		OnSignaled.ExecuteIfBound(false, "The Resource is already being processed by another task");
+		return;
+	}
+
+	FString ErrorMessages;
+	if (!Compushady::Mips::CanGenerateMips(GetTextureRHI(), ErrorMessages))
+	{
+		OnSignaled.ExecuteIfBound(false, ErrorMessages);
+		return;
+	}
+
+	TSharedPtr<Compushady::Mips::FCompushadyMipGenerator, ESPMode::ThreadSafe> Generator = Compushady::Mips::FCompushadyMipGenerator::Get(ErrorMessages);
+	if (!Generator)
+	{
+		OnSignaled.ExecuteIfBound(false, ErrorMessages);
+		return;
+	}
+
+	IncrementVersion();
+
+	EnqueueToGPU(
+		[this, Generator, Filter](FRHICommandListImmediate& RHICmdList)
+		{
+			Generator->Generate_RenderThread(RHICmdList, GetTextureRHI(), Filter);
+		}, OnSignaled);
+}
+
+bool UCompushadyResource::GenerateMipsSync(const ECompushadyMipFilter Filter, FString& ErrorMessages)
+{
+	if (!Compushady::Mips::CanGenerateMips(GetTextureRHI(), ErrorMessages))
+	{
+		return false;
+	}
+
+	TSharedPtr<Compushady::Mips::FCompushadyMipGenerator, ESPMode::ThreadSafe> Generator = Compushady::Mips::FCompushadyMipGenerator::Get(ErrorMessages);
+	if (!Generator)
+	{
+		return false;
+	}
+
+	IncrementVersion();
+
+	EnqueueToGPUSync(
+		[this, Generator, Filter](FRHICommandListImmediate& RHICmdList)
+		{
+			Generator->Generate_RenderThread(RHICmdList, GetTextureRHI(), Filter);
+		});
+
+	return true;
+}
+
 FIntVector UCompushadyResource::GetTextureThreadGroupSize(const FIntVector XYZ, const bool bUseNumSlicesForZ) const
 {
 	if (IsValidTexture())
@@ -922,6 +1256,15 @@ int32 UCompushadyResource::GetTextureNumSlices() const
 	return 0;
 }
 
+int32 UCompushadyResource::GetTextureNumMips() const
+{
+	if (TextureRHIRef.IsValid())
+	{
+		return TextureRHIRef->GetDesc().NumMips;
+	}
+	return 0;
+}
+
 void UCompushadyResource::MapReadAndExecute(TFunction<void(const void*)> InFunction, const FCompushadySignaled& OnSignaled)
 {
 	if (IsRunning())
@@ -967,6 +1310,8 @@ void UCompushadyResource::MapWriteAndExecute(TFunction<void(void*)> InFunction,
 
 	if (IsValidBuffer())
 	{
+		IncrementVersion();
+
 		EnqueueToGPU(
 			[this, InFunction](FRHICommandListImmediate& RHICmdList)
 			{
@@ -1033,6 +1378,8 @@ bool UCompushadyResource::MapWriteAndExecuteSync(TFunction<bool(void*)> InFuncti
 		return false;
 	}
 
+	IncrementVersion();
+
 	EnqueueToGPUSync(
 		[this, InFunction](FRHICommandListImmediate& RHICmdList)
 		{
@@ -1086,6 +1433,17 @@ bool UCompushadyResource::MapTextureSliceAndExecuteSync(TFunction<void(const voi
 		return false;
 	}
 
+	EnqueueToGPUSync(
+		[this, InFunction, Slice](FRHICommandListImmediate& RHICmdList)
+		{
+			MapTextureSliceAndExecute_RenderThread(RHICmdList, InFunction, Slice);
+		});
+
+	return true;
+}
+
+bool UCompushadyResource::MapTextureSliceAndExecute_RenderThread(FRHICommandListImmediate& RHICmdList, TFunction<void(const void*, const int32)> InFunction, const int32 Slice)
+{
 	FRHICopyTextureInfo CopyTextureInfo;
 	CopyTextureInfo.Size.X = TextureRHIRef->GetSizeX();
 	CopyTextureInfo.Size.Y = TextureRHIRef->GetSizeY();
@@ -1101,24 +1459,21 @@ bool UCompushadyResource::MapTextureSliceAndExecuteSync(TFunction<void(const voi
 		CopyTextureInfo.SourcePosition.Z = Slice;
 	}
 
-	EnqueueToGPUSync(
-		[this, InFunction, &CopyTextureInfo](FRHICommandListImmediate& RHICmdList)
-		{
-			FTextureRHIRef ReadbackTexture = GetReadbackTexture();
-			RHICmdList.Transition(FRHITransitionInfo(TextureRHIRef, ERHIAccess::Unknown, ERHIAccess::CopySrc));
-			RHICmdList.CopyTexture(TextureRHIRef, ReadbackTexture, CopyTextureInfo);
-			WaitForGPU(RHICmdList);
-			int32 Width = 0;
-			int32 Height = 0;
-			void* Data = nullptr;
-			RHICmdList.MapStagingSurface(ReadbackTexture, Data, Width, Height);
-			if (Data)
-			{
-				InFunction(Data, Width * GPixelFormats[TextureRHIRef->GetFormat()].BlockBytes);
-				RHICmdList.UnmapStagingSurface(ReadbackTexture);
-			}
-		});
+	FTextureRHIRef ReadbackTexture = GetReadbackTexture();
+	RHICmdList.Transition(FRHITransitionInfo(TextureRHIRef, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+	RHICmdList.CopyTexture(TextureRHIRef, ReadbackTexture, CopyTextureInfo);
+	WaitForGPU(RHICmdList);
+	int32 Width = 0;
+	int32 Height = 0;
+	void* Data = nullptr;
+	RHICmdList.MapStagingSurface(ReadbackTexture, Data, Width, Height);
+	if (!Data)
+	{
+		return false;
+	}
 
+	InFunction(Data, Width * GPixelFormats[TextureRHIRef->GetFormat()].BlockBytes);
+	RHICmdList.UnmapStagingSurface(ReadbackTexture);
 	return true;
 }
 
@@ -1408,6 +1763,15 @@ void ICompushadyPipeline::TrackResources(const FCompushadyResourceArray& Resourc
 	{
 		TrackResource(Resource);
 	}
+
+	// resources are tracked when submitted to a pipeline, any bound UAV is considered written
+	for (UCompushadyUAV* UAV : ResourceArray.UAVs)
+	{
+		if (UAV)
+		{
+			UAV->IncrementVersion();
+		}
+	}
 }
 
 void ICompushadyPipeline::UntrackResources()
@@ -1483,6 +1847,8 @@ void UCompushadyResource::CopyToBuffer(UCompushadyResource* DestinationBuffer, c
 		return;
 	}
 
+	DestinationBuffer->IncrementVersion();
+
 	EnqueueToGPU(
 		[this, DestinationBuffer, RequiredSize, DestinationOffset, SourceOffset](FRHICommandListImmediate& RHICmdList)
 		{
@@ -1563,6 +1929,8 @@ bool UCompushadyResource::CopyToBufferSync(UCompushadyResource* DestinationBuffe
 		return false;
 	}
 
+	DestinationBuffer->IncrementVersion();
+
 	EnqueueToGPUSync(
 		[this, DestinationBuffer, RequiredSize, DestinationOffset, SourceOffset](FRHICommandListImmediate& RHICmdList)
 		{
@@ -1631,6 +1999,12 @@ bool Compushady::Utils::ValidateResourceBindings(const FCompushadyResourceArray&
 			ErrorMessages = FString::Printf(TEXT("SRV %d (%s) cannot be null"), Index, *(ResourceBindings.SRVs[Index].Name));
 			return false;
 		}
+
+		if (SRVs[Index]->IsAccelerationStructure() != ResourceBindings.SRVs[Index].bIsAccelerationStructure)
+		{
+			ErrorMessages = FString::Printf(TEXT("SRV %d (%s) %s an acceleration structure"), Index, *(ResourceBindings.SRVs[Index].Name), ResourceBindings.SRVs[Index].bIsAccelerationStructure ? TEXT("expects") : TEXT("cannot be"));
+			return false;
+		}
 	}
 
 	if (UAVs.Num() != ResourceBindings.UAVs.Num())
@@ -1782,6 +2156,7 @@ bool Compushady::Utils::CreateResourceBindings(const Compushady::FCompushadyShad
 		ResourceBinding.BindingIndex = ShaderResourceBinding.BindingIndex;
 		ResourceBinding.SlotIndex = ShaderResourceBinding.SlotIndex;
 		ResourceBinding.Name = ShaderResourceBinding.Name;
+		ResourceBinding.bIsAccelerationStructure = ShaderResourceBinding.Type == Compushady::ECompushadyShaderResourceType::RayTracingAccelerationStructure;
 		OutBindings.SRVs.Add(ResourceBinding);
 		OutBindings.SRVsMap.Add(ResourceBinding.Name, ResourceBinding);
 		OutBindings.SRVsSlotMap.Add(ResourceBinding.SlotIndex, ResourceBinding);
@@ -1843,15 +2218,13 @@ FVertexShaderRHIRef Compushady::Utils::CreateVertexShaderFromHLSL(const TArray<u
 		return nullptr;
 	}
 
-	FVertexShaderRHIRef VertexShaderRef = RHICreateVertexShader(VSByteCode, VSHash);
+	FVertexShaderRHIRef VertexShaderRef = Compushady::ShaderRegistry::GetOrCreateVertexShader(VSByteCode, VSHash);
 	if (!VertexShaderRef.IsValid() || !VertexShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Vertex Shader";
 		return nullptr;
 	}
 
-	VertexShaderRef->SetHash(VSHash);
-
 	return VertexShaderRef;
 }
 
@@ -1880,15 +2253,13 @@ FPixelShaderRHIRef Compushady::Utils::CreatePixelShaderFromHLSL(const TArray<uin
 		return nullptr;
 	}
 
-	FPixelShaderRHIRef PixelShaderRef = RHICreatePixelShader(PSByteCode, PSHash);
+	FPixelShaderRHIRef PixelShaderRef = Compushady::ShaderRegistry::GetOrCreatePixelShader(PSByteCode, PSHash);
 	if (!PixelShaderRef.IsValid() || !PixelShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Pixel Shader";
 		return nullptr;
 	}
 
-	PixelShaderRef->SetHash(PSHash);
-
 	return PixelShaderRef;
 }
 
@@ -1917,20 +2288,24 @@ FPixelShaderRHIRef Compushady::Utils::CreatePixelShaderFromGLSL(const TArray<uin
 		return nullptr;
 	}
 
-	FPixelShaderRHIRef PixelShaderRef = RHICreatePixelShader(PSByteCode, PSHash);
+	FPixelShaderRHIRef PixelShaderRef = Compushady::ShaderRegistry::GetOrCreatePixelShader(PSByteCode, PSHash);
 	if (!PixelShaderRef.IsValid() || !PixelShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Pixel Shader";
 		return nullptr;
 	}
 
-	PixelShaderRef->SetHash(PSHash);
-
 	return PixelShaderRef;
 }
 
 FComputeShaderRHIRef Compushady::Utils::CreateComputeShaderFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FCompushadyResourceBindings& ResourceBindings, FIntVector& ThreadGroupSize, FString& ErrorMessages, const FString& TargetProfile)
 {
+	if (!TargetProfile.StartsWith("cs_"))
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid TargetProfile %s for a Compute Shader (expected cs_6_x)"), *TargetProfile);
+		return nullptr;
+	}
+
 	TArray<uint8> ComputeShaderByteCode;
 	Compushady::FCompushadyShaderResourceBindings ComputeShaderResourceBindings;
 	if (!Compushady::CompileHLSL(ShaderCode, EntryPoint, TargetProfile, ComputeShaderByteCode, ErrorMessages, false))
@@ -1951,15 +2326,13 @@ FComputeShaderRHIRef Compushady::Utils::CreateComputeShaderFromHLSL(const TArray
 		return nullptr;
 	}
 
-	FComputeShaderRHIRef ComputeShaderRef = RHICreateComputeShader(CSByteCode, CSHash);
+	FComputeShaderRHIRef ComputeShaderRef = Compushady::ShaderRegistry::GetOrCreateComputeShader(CSByteCode, CSHash);
 	if (!ComputeShaderRef.IsValid() || !ComputeShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Compute Shader";
 		return nullptr;
 	}
 
-	ComputeShaderRef->SetHash(CSHash);
-
 	return ComputeShaderRef;
 }
 
@@ -1987,15 +2360,13 @@ FComputeShaderRHIRef Compushady::Utils::CreateComputeShaderFromGLSL(const TArray
 		return nullptr;
 	}
 
-	FComputeShaderRHIRef ComputeShaderRef = RHICreateComputeShader(CSByteCode, CSHash);
+	FComputeShaderRHIRef ComputeShaderRef = Compushady::ShaderRegistry::GetOrCreateComputeShader(CSByteCode, CSHash);
 	if (!ComputeShaderRef.IsValid() || !ComputeShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Compute Shader";
 		return nullptr;
 	}
 
-	ComputeShaderRef->SetHash(CSHash);
-
 	return ComputeShaderRef;
 }
 
@@ -2019,15 +2390,13 @@ FComputeShaderRHIRef Compushady::Utils::CreateComputeShaderFromSPIRVBlob(const T
 		return nullptr;
 	}
 
-	FComputeShaderRHIRef ComputeShaderRef = RHICreateComputeShader(CSByteCode, CSHash);
+	FComputeShaderRHIRef ComputeShaderRef = Compushady::ShaderRegistry::GetOrCreateComputeShader(CSByteCode, CSHash);
 	if (!ComputeShaderRef.IsValid() || !ComputeShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Compute Shader";
 		return nullptr;
 	}
 
-	ComputeShaderRef->SetHash(CSHash);
-
 	return ComputeShaderRef;
 }
 
@@ -2055,15 +2424,13 @@ FMeshShaderRHIRef Compushady::Utils::CreateMeshShaderFromHLSL(const TArray<uint8
 		return nullptr;
 	}
 
-	FMeshShaderRHIRef MeshShaderRef = RHICreateMeshShader(MSByteCode, MSHash);
+	FMeshShaderRHIRef MeshShaderRef = Compushady::ShaderRegistry::GetOrCreateMeshShader(MSByteCode, MSHash);
 	if (!MeshShaderRef.IsValid() || !MeshShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Mesh Shader";
 		return nullptr;
 	}
 
-	MeshShaderRef->SetHash(MSHash);
-
 	return MeshShaderRef;
 }
 
@@ -2091,15 +2458,13 @@ FMeshShaderRHIRef Compushady::Utils::CreateMeshShaderFromGLSL(const TArray<uint8
 		return nullptr;
 	}
 
-	FMeshShaderRHIRef MeshShaderRef = RHICreateMeshShader(MSByteCode, MSHash);
+	FMeshShaderRHIRef MeshShaderRef = Compushady::ShaderRegistry::GetOrCreateMeshShader(MSByteCode, MSHash);
 	if (!MeshShaderRef.IsValid() || !MeshShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Mesh Shader";
 		return nullptr;
 	}
 
-	MeshShaderRef->SetHash(MSHash);
-
 	return MeshShaderRef;
 }
 
@@ -2128,15 +2493,13 @@ FVertexShaderRHIRef Compushady::Utils::CreateVertexShaderFromGLSL(const TArray<u
 		return nullptr;
 	}
 
-	FVertexShaderRHIRef VertexShaderRef = RHICreateVertexShader(VSByteCode, VSHash);
+	FVertexShaderRHIRef VertexShaderRef = Compushady::ShaderRegistry::GetOrCreateVertexShader(VSByteCode, VSHash);
 	if (!VertexShaderRef.IsValid() || !VertexShaderRef->IsValid())
 	{
 		ErrorMessages = "Unable to create Vertex Shader";
 		return nullptr;
 	}
 
-	VertexShaderRef->SetHash(VSHash);
-
 	return VertexShaderRef;
 }
 
@@ -34,6 +34,42 @@ bool UCompushadyUAV::InitializeFromTexture(FTextureRHIRef InTextureRHIRef)
 	return true;
 }
 
+bool UCompushadyUAV::InitializeFromTextureMip(FTextureRHIRef InTextureRHIRef, const int32 MipLevel)
+{
+	if (!InTextureRHIRef)
+	{
+		return false;
+	}
+
+	if (MipLevel < 0 || MipLevel >= InTextureRHIRef->GetDesc().NumMips || !EnumHasAnyFlags(InTextureRHIRef->GetDesc().Flags, ETextureCreateFlags::UAV))
+	{
+		return false;
+	}
+
+	TextureRHIRef = InTextureRHIRef;
+
+	EnqueueToGPUSync(
+		[this, MipLevel](FRHICommandListImmediate& RHICmdList)
+		{
+			UAVRHIRef = COMPUSHADY_CREATE_UAV(TextureRHIRef, MipLevel);
+		});
+
+	if (!UAVRHIRef)
+	{
+		return false;
+	}
+
+	if (InTextureRHIRef->GetOwnerName() == NAME_None)
+	{
+		InTextureRHIRef->SetOwnerName(*GetPathName());
+	}
+
+	RHITransitionInfo = FRHITransitionInfo(TextureRHIRef, ERHIAccess::Unknown, ERHIAccess::UAVMask);
+	RHITransitionInfo.MipIndex = MipLevel;
+
+	return true;
+}
+
 bool UCompushadyUAV::InitializeFromBuffer(FBufferRHIRef InBufferRHIRef, const EPixelFormat PixelFormat)
 {
 	if (!InBufferRHIRef)
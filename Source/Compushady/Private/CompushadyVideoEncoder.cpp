@@ -7,95 +7,896 @@
 #include "Video/Encoders/Configs/VideoEncoderConfigH264.h"
 #include "Video/Encoders/Configs/VideoEncoderConfigH265.h"
 #include "Video/Resources/VideoResourceRHI.h"
-struct FCompushadyVideoEncoder
+
+static void ApplyQualityAndLatency(FVideoEncoderConfig& Config, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency)
+{
+	switch (Quality)
+	{
+	case ECompushadyVideoEncoderQuality::Default:
+		Config.Preset = EAVPreset::Default;
+		break;
+	case ECompushadyVideoEncoderQuality::Low:
+		Config.Preset = EAVPreset::LowQuality;
+		break;
+	case ECompushadyVideoEncoderQuality::High:
+		Config.Preset = EAVPreset::HighQuality;
+		break;
+	case ECompushadyVideoEncoderQuality::UltraLow:
+		Config.Preset = EAVPreset::UltraLowQuality;
+		break;
+	case ECompushadyVideoEncoderQuality::Lossless:
+		Config.Preset = EAVPreset::Lossless;
+		break;
+	default:
+		Config.Preset = EAVPreset::Default;
+		break;
+	}
+
+	switch (Latency)
+	{
+	case ECompushadyVideoEncoderLatency::Default:
+		Config.LatencyMode = EAVLatencyMode::Default;
+		break;
+	case ECompushadyVideoEncoderLatency::Low:
+		Config.LatencyMode = EAVLatencyMode::LowLatency;
+		break;
+	case ECompushadyVideoEncoderLatency::UltraLow:
+		Config.LatencyMode = EAVLatencyMode::UltraLowLatency;
+		break;
+	default:
+		Config.LatencyMode = EAVLatencyMode::Default;
+		break;
+	}
+}
+
+static void ApplyCommonSettings(FVideoEncoderConfig& Config, const Compushady::Video::FCompushadyVideoEncoderSettings& Settings)
+{
+	ApplyQualityAndLatency(Config, Settings.Quality, Settings.Latency);
+
+	if (Settings.Width > 0 && Settings.Height > 0)
+	{
+		Config.Width = Settings.Width;
+		Config.Height = Settings.Height;
+	}
+
+	if (Settings.TargetBitrate > 0)
+	{
+		Config.TargetBitrate = Settings.TargetBitrate;
+	}
+
+	if (Settings.MaxBitrate > 0)
+	{
+		Config.MaxBitrate = Settings.MaxBitrate;
+	}
+}
+
+struct FCompushadyVideoEncoder : public Compushady::Video::ICompushadyVideoEncoderBackend
 {
 	TSharedPtr<TVideoEncoder<FVideoResourceRHI>> Encoder;
+
+	// the encoder reads its input asynchronously, so every frame gets its own copy of the texture
+	Compushady::Video::TCompushadyVideoFramePool<FVideoResourceRHI> FramePool;
+	TArray<FTextureRHIRef> FrameTextures;
+	// plane views of the NV12 frames (native YUV only)
+	TArray<FUnorderedAccessViewRHIRef> FrameLumaUAVs;
+	TArray<FUnorderedAccessViewRHIRef> FrameChromaUAVs;
+	// packets received while waiting for a free input frame, they are returned before the encoder ones
+	TArray<FVideoPacket> PendingPackets;
+
+	/* A frame is released only by its packet (or by a later one), so the ready packets are drained until one is free */
+	int32 AcquireFrame(const uint64 Timestamp)
+	{
+		int32 FrameIndex = FramePool.Acquire(Timestamp);
+		FVideoPacket VideoPacket;
+		while (FrameIndex == INDEX_NONE && Encoder->ReceivePacket(VideoPacket))
+		{
+			FramePool.Release(VideoPacket.Timestamp);
+			PendingPackets.Add(VideoPacket);
+			FrameIndex = FramePool.Acquire(Timestamp);
+		}
+		return FrameIndex;
+	}
+
+	bool ReceivePacket(FVideoPacket& VideoPacket)
+	{
+		if (PendingPackets.Num() > 0)
+		{
+			VideoPacket = PendingPackets[0];
+			PendingPackets.RemoveAt(0);
+			return true;
+		}
+
+		if (!Encoder->ReceivePacket(VideoPacket))
+		{
+			return false;
+		}
+
+		FramePool.Release(VideoPacket.Timestamp);
+		return true;
+	}
+
+	bool ApplySettings(const Compushady::Video::FCompushadyVideoEncoderSettings& Settings) override
+	{
+		if (Settings.Codec == ECompushadyVideoEncoderCodec::H265Main)
+		{
+			FVideoEncoderConfigH265& Config = Encoder->GetInstance()->Edit<FVideoEncoderConfigH265>();
+			ApplyCommonSettings(Config, Settings);
+			Encoder->SetMinimalConfig(Config);
+		}
+		else
+		{
+			FVideoEncoderConfigH264& Config = Encoder->GetInstance()->Edit<FVideoEncoderConfigH264>();
+			ApplyCommonSettings(Config, Settings);
+			Encoder->SetMinimalConfig(Config);
+		}
+		return true;
+	}
 };
 #endif
+#include "HAL/PlatformFileManager.h"
 
-
-bool UCompushadyVideoEncoder::Initialize(const ECompushadyVideoEncoderCodec Codec, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency)
+namespace Compushady
 {
-#ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
-	auto ApplyConfig = [](TSharedPtr<FVideoEncoderConfig> Config, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency)
+	namespace Video
+	{
+		namespace H264
+		{
+			constexpr uint8 IDR = 5;
+			constexpr uint8 SPS = 7;
+			constexpr uint8 PPS = 8;
+			constexpr uint8 AUD = 9;
+		}
+
+		namespace H265
 		{
-			switch (Quality)
+			constexpr uint8 BLA_W_LP = 16;
+			constexpr uint8 RSV_IRAP_VCL23 = 23;
+			constexpr uint8 VPS = 32;
+			constexpr uint8 SPS = 33;
+			constexpr uint8 PPS = 34;
+			constexpr uint8 AUD = 35;
+		}
+
+		namespace MP4
+		{
+			static void WriteU8(TArray<uint8>& Output, const uint8 Value)
 			{
-			case ECompushadyVideoEncoderQuality::Default:
-				Config->Preset = EAVPreset::Default;
-				break;
-			case ECompushadyVideoEncoderQuality::Low:
-				Config->Preset = EAVPreset::LowQuality;
-				break;
-			case ECompushadyVideoEncoderQuality::High:
-				Config->Preset = EAVPreset::HighQuality;
-				break;
-			case ECompushadyVideoEncoderQuality::UltraLow:
-				Config->Preset = EAVPreset::UltraLowQuality;
-				break;
-			case ECompushadyVideoEncoderQuality::Lossless:
-				Config->Preset = EAVPreset::Lossless;
-				break;
-			default:
-				Config->Preset = EAVPreset::Default;
-				break;
+				Output.Add(Value);
 			}
 
-			switch (Latency)
+			static void WriteU16(TArray<uint8>& Output, const uint16 Value)
 			{
-			case ECompushadyVideoEncoderLatency::Default:
-				Config->LatencyMode = EAVLatencyMode::Default;
-				break;
-			case ECompushadyVideoEncoderLatency::Low:
-				Config->LatencyMode = EAVLatencyMode::LowLatency;
-				break;
-			case ECompushadyVideoEncoderLatency::UltraLow:
-				Config->LatencyMode = EAVLatencyMode::UltraLowLatency;
-				break;
-			default:
-				Config->LatencyMode = EAVLatencyMode::Default;
-				break;
+				Output.Add(static_cast<uint8>(Value >> 8));
+				Output.Add(static_cast<uint8>(Value));
+			}
+
+			static void WriteU32(TArray<uint8>& Output, const uint32 Value)
+			{
+				WriteU16(Output, static_cast<uint16>(Value >> 16));
+				WriteU16(Output, static_cast<uint16>(Value));
+			}
+
+			static void WriteU64(TArray<uint8>& Output, const uint64 Value)
+			{
+				WriteU32(Output, static_cast<uint32>(Value >> 32));
+				WriteU32(Output, static_cast<uint32>(Value));
+			}
+
+			static void WriteFourCC(TArray<uint8>& Output, const char* FourCC)
+			{
+				Output.Append(reinterpret_cast<const uint8*>(FourCC), 4);
+			}
+
+			static void WriteBytes(TArray<uint8>& Output, const TArrayView<const uint8> Bytes)
+			{
+				Output.Append(Bytes.GetData(), Bytes.Num());
+			}
+
+			static void WriteMatrix(TArray<uint8>& Output)
+			{
+				const uint32 Matrix[] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+				for (const uint32 Value : Matrix)
+				{
+					WriteU32(Output, Value);
+				}
+			}
+
+			/* Returns the offset of the box, the size is fixed by EndBox */
+			static int32 BeginBox(TArray<uint8>& Output, const char* Type)
+			{
+				const int32 Offset = Output.Num();
+				WriteU32(Output, 0);
+				WriteFourCC(Output, Type);
+				return Offset;
+			}
+
+			static int32 BeginFullBox(TArray<uint8>& Output, const char* Type, const uint8 Version, const uint32 Flags)
+			{
+				const int32 Offset = BeginBox(Output, Type);
+				WriteU32(Output, (static_cast<uint32>(Version) << 24) | (Flags & 0xFFFFFF));
+				return Offset;
+			}
+
+			static void EndBox(TArray<uint8>& Output, const int32 Offset)
+			{
+				const uint32 Size = static_cast<uint32>(Output.Num() - Offset);
+				Output[Offset] = static_cast<uint8>(Size >> 24);
+				Output[Offset + 1] = static_cast<uint8>(Size >> 16);
+				Output[Offset + 2] = static_cast<uint8>(Size >> 8);
+				Output[Offset + 3] = static_cast<uint8>(Size);
+			}
+
+			static void WriteAVCC(TArray<uint8>& Output, const FCompushadyVideoParameterSets& ParameterSets)
+			{
+				const int32 AVCC = BeginBox(Output, "avcC");
+				const uint8 Profile = ParameterSets.SPS[1];
+				WriteU8(Output, 1);
+				WriteU8(Output, Profile);
+				WriteU8(Output, ParameterSets.SPS[2]);
+				WriteU8(Output, ParameterSets.SPS[3]);
+				// 4 bytes NAL unit lengths
+				WriteU8(Output, 0xFF);
+				WriteU8(Output, 0xE1);
+				WriteU16(Output, static_cast<uint16>(ParameterSets.SPS.Num()));
+				WriteBytes(Output, ParameterSets.SPS);
+				WriteU8(Output, 1);
+				WriteU16(Output, static_cast<uint16>(ParameterSets.PPS.Num()));
+				WriteBytes(Output, ParameterSets.PPS);
+				// high profiles require the chroma format and the bit depths (the encoders only produce 8 bit 4:2:0)
+				if (Profile == 100 || Profile == 110 || Profile == 122 || Profile == 144)
+				{
+					WriteU8(Output, 0xFC | 1);
+					WriteU8(Output, 0xF8);
+					WriteU8(Output, 0xF8);
+					WriteU8(Output, 0);
+				}
+				EndBox(Output, AVCC);
+			}
+
+			static bool WriteHVCC(TArray<uint8>& Output, const FCompushadyVideoParameterSets& ParameterSets, FString& ErrorMessages)
+			{
+				// 2 bytes header, 1 byte with the sub layers and 12 bytes of general profile_tier_level
+				TArray<uint8> RBSP;
+				NALUnitToRBSP(ParameterSets.SPS, RBSP);
+				if (RBSP.Num() < 15)
+				{
+					ErrorMessages = FString::Printf(TEXT("SPS is too short (%d bytes)"), RBSP.Num());
+					return false;
+				}
+
+				const uint8 MaxSubLayersMinus1 = (RBSP[2] >> 1) & 0x07;
+				const uint8 TemporalIdNesting = RBSP[2] & 0x01;
+
+				const int32 HVCC = BeginBox(Output, "hvcC");
+				WriteU8(Output, 1);
+				// profile space/tier/profile, compatibility flags, constraint flags and level
+				Output.Append(RBSP.GetData() + 3, 12);
+				WriteU16(Output, 0xF000);
+				WriteU8(Output, 0xFC);
+				// 4:2:0, 8 bit
+				WriteU8(Output, 0xFC | 1);
+				WriteU8(Output, 0xF8);
+				WriteU8(Output, 0xF8);
+				WriteU16(Output, 0);
+				WriteU8(Output, static_cast<uint8>(((MaxSubLayersMinus1 + 1) << 3) | (TemporalIdNesting << 2) | 0x03));
+
+				const TPair<uint8, const TArray<uint8>*> Arrays[] = { { H265::VPS, &ParameterSets.VPS }, { H265::SPS, &ParameterSets.SPS }, { H265::PPS, &ParameterSets.PPS } };
+				WriteU8(Output, UE_ARRAY_COUNT(Arrays));
+				for (const TPair<uint8, const TArray<uint8>*>& Array : Arrays)
+				{
+					// array_completeness
+					WriteU8(Output, 0x80 | Array.Key);
+					WriteU16(Output, 1);
+					WriteU16(Output, static_cast<uint16>(Array.Value->Num()));
+					WriteBytes(Output, *Array.Value);
+				}
+				EndBox(Output, HVCC);
+				return true;
+			}
+		}
+	}
+}
+
+void Compushady::Video::ParseAnnexB(const uint8* Data, const int64 Size, TArray<TArrayView<const uint8>>& NALUnits)
+{
+	auto AddNALUnit = [&NALUnits, Data](const int64 Start, int64 End)
+		{
+			// the zeros before a start code are not part of the NAL unit (4 bytes start codes and trailing_zero_8bits)
+			while (End > Start && Data[End - 1] == 0)
+			{
+				End--;
+			}
+			if (End > Start)
+			{
+				NALUnits.Add(TArrayView<const uint8>(Data + Start, static_cast<int32>(End - Start)));
 			}
 		};
 
+	int64 NALUnitStart = -1;
+	int64 Index = 0;
+	while (Index + 3 <= Size)
+	{
+		if (Data[Index] == 0 && Data[Index + 1] == 0 && Data[Index + 2] == 1)
+		{
+			if (NALUnitStart >= 0)
+			{
+				AddNALUnit(NALUnitStart, Index);
+			}
+			Index += 3;
+			NALUnitStart = Index;
+			continue;
+		}
+		Index++;
+	}
 
-	VideoEncoder = MakeShared<FCompushadyVideoEncoder>();
-	if (!VideoEncoder)
+	if (NALUnitStart >= 0)
 	{
+		AddNALUnit(NALUnitStart, Size);
+	}
+}
+
+uint8 Compushady::Video::GetNALUnitType(const TArrayView<const uint8> NALUnit, const bool bH265)
+{
+	if (NALUnit.Num() < 1)
+	{
+		return 0;
+	}
+	return bH265 ? (NALUnit[0] >> 1) & 0x3F : NALUnit[0] & 0x1F;
+}
+
+bool Compushady::Video::IsKeyFrameNALUnit(const TArrayView<const uint8> NALUnit, const bool bH265)
+{
+	const uint8 NALUnitType = GetNALUnitType(NALUnit, bH265);
+	if (bH265)
+	{
+		return NALUnitType >= H265::BLA_W_LP && NALUnitType <= H265::RSV_IRAP_VCL23;
+	}
+	return NALUnitType == H264::IDR;
+}
+
+void Compushady::Video::NALUnitToRBSP(const TArrayView<const uint8> NALUnit, TArray<uint8>& RBSP)
+{
+	RBSP.Empty(NALUnit.Num());
+	int32 Zeros = 0;
+	for (const uint8 Byte : NALUnit)
+	{
+		if (Zeros >= 2 && Byte == 0x03)
+		{
+			Zeros = 0;
+			continue;
+		}
+		Zeros = Byte == 0 ? Zeros + 1 : 0;
+		RBSP.Add(Byte);
+	}
+}
+
+bool Compushady::Video::FCompushadyVideoParameterSets::Extract(const TArray<TArrayView<const uint8>>& NALUnits, const bool bH265)
+{
+	bool bFound = false;
+	for (const TArrayView<const uint8>& NALUnit : NALUnits)
+	{
+		const uint8 NALUnitType = GetNALUnitType(NALUnit, bH265);
+		TArray<uint8>* ParameterSet = nullptr;
+		if (bH265)
+		{
+			ParameterSet = NALUnitType == H265::VPS ? &VPS : (NALUnitType == H265::SPS ? &SPS : (NALUnitType == H265::PPS ? &PPS : nullptr));
+		}
+		else
+		{
+			ParameterSet = NALUnitType == H264::SPS ? &SPS : (NALUnitType == H264::PPS ? &PPS : nullptr);
+		}
+
+		if (ParameterSet)
+		{
+			ParameterSet->Reset();
+			ParameterSet->Append(NALUnit.GetData(), NALUnit.Num());
+			bFound = true;
+		}
+	}
+	return bFound;
+}
+
+bool Compushady::Video::FCompushadyVideoParameterSets::IsValid(const bool bH265) const
+{
+	// the avcC needs profile, compatibility and level from the SPS
+	return SPS.Num() >= 4 && PPS.Num() > 0 && (!bH265 || VPS.Num() > 0);
+}
+
+bool Compushady::Video::FCompushadyVideoEncoderSettings::operator==(const FCompushadyVideoEncoderSettings& Other) const
+{
+	return Codec == Other.Codec &&
+		Quality == Other.Quality &&
+		Latency == Other.Latency &&
+		Width == Other.Width &&
+		Height == Other.Height &&
+		TargetBitrate == Other.TargetBitrate &&
+		MaxBitrate == Other.MaxBitrate;
+}
+
+void Compushady::Video::FCompushadyVideoEncoderConfig::Initialize(const FCompushadyVideoEncoderSettings& InSettings)
+{
+	Settings = InSettings;
+	AppliedSettings = FCompushadyVideoEncoderSettings();
+	bApplied = false;
+	bKeyFrameRequested = false;
+	NumApplies = 0;
+}
+
+void Compushady::Video::FCompushadyVideoEncoderConfig::SetResolution(const int32 Width, const int32 Height)
+{
+	Settings.Width = Width;
+	Settings.Height = Height;
+}
+
+void Compushady::Video::FCompushadyVideoEncoderConfig::SetBitrate(const int32 TargetBitrate, const int32 MaxBitrate)
+{
+	Settings.TargetBitrate = TargetBitrate;
+	Settings.MaxBitrate = MaxBitrate;
+}
+
+void Compushady::Video::FCompushadyVideoEncoderConfig::RequestKeyFrame()
+{
+	bKeyFrameRequested = true;
+}
+
+bool Compushady::Video::FCompushadyVideoEncoderConfig::IsDirty() const
+{
+	return !bApplied || Settings != AppliedSettings;
+}
+
+bool Compushady::Video::FCompushadyVideoEncoderConfig::Update(ICompushadyVideoEncoderBackend& Backend, bool& bOutForceKeyFrame)
+{
+	bOutForceKeyFrame = false;
+
+	if (IsDirty())
+	{
+		// the parameter sets change with the resolution, so the decoder needs a new keyframe
+		const bool bResolutionChanged = bApplied && (Settings.Width != AppliedSettings.Width || Settings.Height != AppliedSettings.Height);
+
+		if (!Backend.ApplySettings(Settings))
+		{
+			return false;
+		}
+
+		AppliedSettings = Settings;
+		bApplied = true;
+		NumApplies++;
+
+		if (bResolutionChanged)
+		{
+			bKeyFrameRequested = true;
+		}
+	}
+
+	bOutForceKeyFrame = bKeyFrameRequested;
+	bKeyFrameRequested = false;
+	return true;
+}
+
+Compushady::Video::FCompushadyFMP4Muxer::FCompushadyFMP4Muxer(const bool bInH265, const int32 InWidth, const int32 InHeight, const uint32 InTimescale, const uint32 InFrameDuration) :
+	bH265(bInH265), Width(InWidth), Height(InHeight), Timescale(InTimescale), FrameDuration(InFrameDuration)
+{
+}
+
+bool Compushady::Video::FCompushadyFMP4Muxer::WriteInitSegment(const FCompushadyVideoParameterSets& ParameterSets, TArray<uint8>& Output, FString& ErrorMessages)
+{
+	using namespace MP4;
+
+	if (!ParameterSets.IsValid(bH265))
+	{
+		ErrorMessages = "Missing parameter sets";
 		return false;
 	}
 
-	if (Codec == ECompushadyVideoEncoderCodec::H264Main)
+	TArray<uint8> SampleEntry;
+	const int32 SampleEntryBox = BeginBox(SampleEntry, bH265 ? "hvc1" : "avc1");
+	// reserved and data_reference_index
+	WriteU32(SampleEntry, 0);
+	WriteU16(SampleEntry, 0);
+	WriteU16(SampleEntry, 1);
+	// pre_defined and reserved
+	WriteU16(SampleEntry, 0);
+	WriteU16(SampleEntry, 0);
+	WriteU32(SampleEntry, 0);
+	WriteU32(SampleEntry, 0);
+	WriteU32(SampleEntry, 0);
+	WriteU16(SampleEntry, static_cast<uint16>(Width));
+	WriteU16(SampleEntry, static_cast<uint16>(Height));
+	// 72 dpi
+	WriteU32(SampleEntry, 0x00480000);
+	WriteU32(SampleEntry, 0x00480000);
+	WriteU32(SampleEntry, 0);
+	// frame_count
+	WriteU16(SampleEntry, 1);
+	// compressorname
+	SampleEntry.AddZeroed(32);
+	WriteU16(SampleEntry, 0x0018);
+	WriteU16(SampleEntry, 0xFFFF);
+	if (bH265)
 	{
-		TSharedPtr<FVideoEncoderConfigH264> Config = MakeShared<FVideoEncoderConfigH264>();
-		Config->RepeatSPSPPS = true;
-		Config->Profile = EH264Profile::Main;
-		ApplyConfig(Config, Quality, Latency);
-		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), *Config.Get());
+		if (!WriteHVCC(SampleEntry, ParameterSets, ErrorMessages))
+		{
+			return false;
+		}
 	}
-	else if (Codec == ECompushadyVideoEncoderCodec::H264Baseline)
+	else
 	{
-		TSharedPtr<FVideoEncoderConfigH264> Config = MakeShared<FVideoEncoderConfigH264>();
-		Config->RepeatSPSPPS = true;
-		Config->Profile = EH264Profile::Baseline;
-		ApplyConfig(Config, Quality, Latency);
-		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), *Config.Get());
+		WriteAVCC(SampleEntry, ParameterSets);
 	}
-	else if (Codec == ECompushadyVideoEncoderCodec::H264High)
+	EndBox(SampleEntry, SampleEntryBox);
+
+	const int32 FTYP = BeginBox(Output, "ftyp");
+	WriteFourCC(Output, "isom");
+	WriteU32(Output, 0x200);
+	WriteFourCC(Output, "isom");
+	WriteFourCC(Output, "iso6");
+	WriteFourCC(Output, "mp41");
+	EndBox(Output, FTYP);
+
+	const int32 MOOV = BeginBox(Output, "moov");
 	{
-		TSharedPtr<FVideoEncoderConfigH264> Config = MakeShared<FVideoEncoderConfigH264>();
-		Config->RepeatSPSPPS = true;
-		Config->Profile = EH264Profile::High;
-		ApplyConfig(Config, Quality, Latency);
-		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), *Config.Get());
+		const int32 MVHD = BeginFullBox(Output, "mvhd", 0, 0);
+		WriteU32(Output, 0);
+		WriteU32(Output, 0);
+		WriteU32(Output, Timescale);
+		// the duration is in the fragments
+		WriteU32(Output, 0);
+		WriteU32(Output, 0x00010000);
+		WriteU16(Output, 0x0100);
+		WriteU16(Output, 0);
+		WriteU64(Output, 0);
+		WriteMatrix(Output);
+		Output.AddZeroed(24);
+		// next_track_ID
+		WriteU32(Output, 2);
+		EndBox(Output, MVHD);
+
+		const int32 TRAK = BeginBox(Output, "trak");
+		{
+			// enabled and in movie
+			const int32 TKHD = BeginFullBox(Output, "tkhd", 0, 0x000003);
+			WriteU32(Output, 0);
+			WriteU32(Output, 0);
+			WriteU32(Output, 1);
+			WriteU32(Output, 0);
+			WriteU32(Output, 0);
+			WriteU64(Output, 0);
+			// layer, alternate_group, volume and reserved
+			WriteU64(Output, 0);
+			WriteMatrix(Output);
+			WriteU32(Output, static_cast<uint32>(Width) << 16);
+			WriteU32(Output, static_cast<uint32>(Height) << 16);
+			EndBox(Output, TKHD);
+
+			const int32 MDIA = BeginBox(Output, "mdia");
+			{
+				const int32 MDHD = BeginFullBox(Output, "mdhd", 0, 0);
+				WriteU32(Output, 0);
+				WriteU32(Output, 0);
+				WriteU32(Output, Timescale);
+				WriteU32(Output, 0);
+				// und
+				WriteU16(Output, 0x55C4);
+				WriteU16(Output, 0);
+				EndBox(Output, MDHD);
+
+				const int32 HDLR = BeginFullBox(Output, "hdlr", 0, 0);
+				WriteU32(Output, 0);
+				WriteFourCC(Output, "vide");
+				Output.AddZeroed(12);
+				Output.Append(reinterpret_cast<const uint8*>("VideoHandler"), 13);
+				EndBox(Output, HDLR);
+
+				const int32 MINF = BeginBox(Output, "minf");
+				{
+					const int32 VMHD = BeginFullBox(Output, "vmhd", 0, 0x000001);
+					WriteU64(Output, 0);
+					EndBox(Output, VMHD);
+
+					const int32 DINF = BeginBox(Output, "dinf");
+					const int32 DREF = BeginFullBox(Output, "dref", 0, 0);
+					WriteU32(Output, 1);
+					// self contained
+					EndBox(Output, BeginFullBox(Output, "url ", 0, 0x000001));
+					EndBox(Output, DREF);
+					EndBox(Output, DINF);
+
+					const int32 STBL = BeginBox(Output, "stbl");
+					{
+						const int32 STSD = BeginFullBox(Output, "stsd", 0, 0);
+						WriteU32(Output, 1);
+						Output.Append(SampleEntry);
+						EndBox(Output, STSD);
+
+						// the sample tables are empty, samples are described by the fragments
+						const char* EmptyTables[] = { "stts", "stsc", "stco" };
+						for (const char* EmptyTable : EmptyTables)
+						{
+							const int32 Table = BeginFullBox(Output, EmptyTable, 0, 0);
+							WriteU32(Output, 0);
+							EndBox(Output, Table);
+						}
+
+						const int32 STSZ = BeginFullBox(Output, "stsz", 0, 0);
+						WriteU32(Output, 0);
+						WriteU32(Output, 0);
+						EndBox(Output, STSZ);
+					}
+					EndBox(Output, STBL);
+				}
+				EndBox(Output, MINF);
+			}
+			EndBox(Output, MDIA);
+		}
+		EndBox(Output, TRAK);
+
+		const int32 MVEX = BeginBox(Output, "mvex");
+		const int32 TREX = BeginFullBox(Output, "trex", 0, 0);
+		WriteU32(Output, 1);
+		WriteU32(Output, 1);
+		WriteU32(Output, 0);
+		WriteU32(Output, 0);
+		WriteU32(Output, 0);
+		EndBox(Output, TREX);
+		EndBox(Output, MVEX);
 	}
-	else if (Codec == ECompushadyVideoEncoderCodec::H265Main)
+	EndBox(Output, MOOV);
+
+	return true;
+}
+
+void Compushady::Video::FCompushadyFMP4Muxer::WriteFragment(const TArray<TArrayView<const uint8>>& NALUnits, const uint64 DecodeTime, const bool bKeyFrame, TArray<uint8>& Output)
+{
+	using namespace MP4;
+
+	uint32 SampleSize = 0;
+	for (const TArrayView<const uint8>& NALUnit : NALUnits)
 	{
-		TSharedPtr<FVideoEncoderConfigH265> Config = MakeShared<FVideoEncoderConfigH265>();
-		Config->RepeatSPSPPS = true;
-		Config->Profile = EH265Profile::Main;
-		ApplyConfig(Config, Quality, Latency);
-		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), *Config.Get());
+		const uint8 NALUnitType = GetNALUnitType(NALUnit, bH265);
+		const bool bSkip = bH265 ? (NALUnitType >= H265::VPS && NALUnitType <= H265::AUD) : (NALUnitType == H264::SPS || NALUnitType == H264::PPS || NALUnitType == H264::AUD);
+		if (!bSkip)
+		{
+			SampleSize += 4 + NALUnit.Num();
+		}
+	}
+
+	const int32 MOOF = BeginBox(Output, "moof");
+	const int32 MFHD = BeginFullBox(Output, "mfhd", 0, 0);
+	WriteU32(Output, ++SequenceNumber);
+	EndBox(Output, MFHD);
+
+	const int32 TRAF = BeginBox(Output, "traf");
+	// default-base-is-moof
+	const int32 TFHD = BeginFullBox(Output, "tfhd", 0, 0x020000);
+	WriteU32(Output, 1);
+	EndBox(Output, TFHD);
+
+	const int32 TFDT = BeginFullBox(Output, "tfdt", 1, 0);
+	WriteU64(Output, DecodeTime);
+	EndBox(Output, TFDT);
+
+	// data-offset, sample-duration, sample-size and sample-flags
+	const int32 TRUN = BeginFullBox(Output, "trun", 0, 0x000701);
+	WriteU32(Output, 1);
+	const int32 DataOffset = Output.Num();
+	WriteU32(Output, 0);
+	WriteU32(Output, FrameDuration);
+	WriteU32(Output, SampleSize);
+	// sync samples do not depend on others, the other ones are non sync
+	WriteU32(Output, bKeyFrame ? 0x02000000 : 0x01010000);
+	EndBox(Output, TRUN);
+	EndBox(Output, TRAF);
+	EndBox(Output, MOOF);
+
+	// the sample starts right after the mdat header
+	const uint32 SampleOffset = static_cast<uint32>(Output.Num() - MOOF + 8);
+	Output[DataOffset] = static_cast<uint8>(SampleOffset >> 24);
+	Output[DataOffset + 1] = static_cast<uint8>(SampleOffset >> 16);
+	Output[DataOffset + 2] = static_cast<uint8>(SampleOffset >> 8);
+	Output[DataOffset + 3] = static_cast<uint8>(SampleOffset);
+
+	const int32 MDAT = BeginBox(Output, "mdat");
+	Output.Reserve(Output.Num() + SampleSize);
+	for (const TArrayView<const uint8>& NALUnit : NALUnits)
+	{
+		const uint8 NALUnitType = GetNALUnitType(NALUnit, bH265);
+		const bool bSkip = bH265 ? (NALUnitType >= H265::VPS && NALUnitType <= H265::AUD) : (NALUnitType == H264::SPS || NALUnitType == H264::PPS || NALUnitType == H264::AUD);
+		if (!bSkip)
+		{
+			WriteU32(Output, NALUnit.Num());
+			WriteBytes(Output, NALUnit);
+		}
+	}
+	EndBox(Output, MDAT);
+}
+
+TSharedPtr<Compushady::Video::FCompushadyVideoFileSink> Compushady::Video::FCompushadyVideoFileSink::Create(const FString& Filename, const ECompushadyVideoContainer Container, const bool bH265, const int32 FrameRate, const int32 MaxQueuedPackets, FString& ErrorMessages)
+{
+	if (FrameRate <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid FrameRate %d"), FrameRate);
+		return nullptr;
+	}
+
+	if (MaxQueuedPackets <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid MaxQueuedPackets %d"), MaxQueuedPackets);
+		return nullptr;
+	}
+
+	IFileHandle* FileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename);
+	if (!FileHandle)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open %s for writing"), *Filename);
+		return nullptr;
+	}
+
+	TSharedPtr<FCompushadyVideoFileSink> Sink = MakeShareable(new FCompushadyVideoFileSink());
+	Sink->Container = Container;
+	Sink->bH265 = bH265;
+	Sink->FrameRate = FrameRate;
+	Sink->FileHandle.Reset(FileHandle);
+
+	FCompushadyVideoFileSink* SinkPtr = Sink.Get();
+	Sink->Writer = MakeUnique<TCompushadyOrderedWriter<FCompushadyVideoPacket>>(MaxQueuedPackets,
+		[SinkPtr](FCompushadyVideoPacket& Packet, int64& WrittenBytes)
+		{
+			return SinkPtr->WritePacket(Packet, WrittenBytes);
+		});
+
+	if (!Sink->Writer->Start(TEXT("CompushadyVideoFileSink"), ErrorMessages))
+	{
+		return nullptr;
+	}
+
+	return Sink;
+}
+
+Compushady::Video::FCompushadyVideoFileSink::~FCompushadyVideoFileSink()
+{
+	Close();
+}
+
+bool Compushady::Video::FCompushadyVideoFileSink::Enqueue(FCompushadyVideoPacket&& Packet)
+{
+	if (!Packet.Data || Packet.Size <= 0)
+	{
+		return false;
+	}
+
+	if (bWaitForKeyFrame)
+	{
+		// delta frames are useless without the frames they depend on
+		if (!Packet.bKeyFrame)
+		{
+			Writer->AddDropped();
+			return false;
+		}
+	}
+
+	if (!Writer->Enqueue(MoveTemp(Packet)))
+	{
+		bWaitForKeyFrame = true;
+		return false;
+	}
+
+	bWaitForKeyFrame = false;
+	return true;
+}
+
+void Compushady::Video::FCompushadyVideoFileSink::Close()
+{
+	if (Writer)
+	{
+		Writer->Close();
+	}
+
+	if (FileHandle)
+	{
+		FileHandle->Flush();
+		FileHandle.Reset();
+	}
+}
+
+FCompushadyVideoRecordingStats Compushady::Video::FCompushadyVideoFileSink::GetStats() const
+{
+	FCompushadyVideoRecordingStats Stats;
+	Stats.QueuedPackets = Writer->NumQueued();
+	Stats.PeakQueuedPackets = Writer->GetPeakQueued();
+	// packets that could not be muxed are lost too
+	Stats.DroppedPackets = Writer->GetNumDropped() + Writer->GetNumFailed();
+	Stats.WrittenPackets = Writer->GetNumWritten();
+	Stats.WrittenBytes = Writer->GetWrittenBytes();
+	return Stats;
+}
+
+bool Compushady::Video::FCompushadyVideoFileSink::WritePacket(const FCompushadyVideoPacket& Packet, int64& WrittenBytes)
+{
+	WriteBuffer.Reset();
+
+	if (Container == ECompushadyVideoContainer::AnnexB)
+	{
+		// the encoder output is already an elementary stream
+		WrittenBytes = Packet.Size;
+		return FileHandle->Write(Packet.Data.Get(), Packet.Size);
+	}
+
+	TArray<TArrayView<const uint8>> NALUnits;
+	ParseAnnexB(Packet.Data.Get(), Packet.Size, NALUnits);
+
+	if (Packet.bKeyFrame)
+	{
+		ParameterSets.Extract(NALUnits, bH265);
+	}
+
+	if (!Muxer)
+	{
+		// the init segment can be written only after the first keyframe with its parameter sets
+		FString ErrorMessages;
+		// 1000 ticks per frame leave room for variable frame rates in the future
+		TUniquePtr<FCompushadyFMP4Muxer> NewMuxer = MakeUnique<FCompushadyFMP4Muxer>(bH265, Packet.FrameSize.X, Packet.FrameSize.Y, static_cast<uint32>(FrameRate) * 1000, 1000);
+		if (!Packet.bKeyFrame || !NewMuxer->WriteInitSegment(ParameterSets, WriteBuffer, ErrorMessages))
+		{
+			return false;
+		}
+		Muxer = MoveTemp(NewMuxer);
+		FirstTimestamp = Packet.Timestamp;
+	}
+
+	// the encoders do not reorder frames, so decode and presentation times match
+	const uint64 DecodeTime = (Packet.Timestamp - FirstTimestamp) * Muxer->GetFrameDuration();
+	Muxer->WriteFragment(NALUnits, DecodeTime, Packet.bKeyFrame, WriteBuffer);
+
+	WrittenBytes = WriteBuffer.Num();
+	return FileHandle->Write(WriteBuffer.GetData(), WriteBuffer.Num());
+}
+
+
+bool UCompushadyVideoEncoder::Initialize(const ECompushadyVideoEncoderCodec Codec, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency, const int32 NumInputFrames)
+{
+#ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	if (NumInputFrames < 1)
+	{
+		return false;
+	}
+
+	VideoEncoder = MakeShared<FCompushadyVideoEncoder>();
+	if (!VideoEncoder)
+	{
+		return false;
+	}
+
+	Compushady::Video::FCompushadyVideoEncoderSettings Settings;
+	Settings.Codec = Codec;
+	Settings.Quality = Quality;
+	Settings.Latency = Latency;
+
+	if (Codec == ECompushadyVideoEncoderCodec::H265Main)
+	{
+		FVideoEncoderConfigH265 Config;
+		Config.RepeatSPSPPS = true;
+		Config.Profile = EH265Profile::Main;
+		ApplyCommonSettings(Config, Settings);
+		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), Config);
+	}
+	else
+	{
+		FVideoEncoderConfigH264 Config;
+		Config.RepeatSPSPPS = true;
+		if (Codec == ECompushadyVideoEncoderCodec::H264Baseline)
+		{
+			Config.Profile = EH264Profile::Baseline;
+		}
+		else if (Codec == ECompushadyVideoEncoderCodec::H264High)
+		{
+			Config.Profile = EH264Profile::High;
+		}
+		else
+		{
+			Config.Profile = EH264Profile::Main;
+		}
+		ApplyCommonSettings(Config, Settings);
+		VideoEncoder->Encoder = TVideoEncoder<FVideoResourceRHI>::Create<FVideoResourceRHI>(FAVDevice::GetHardwareDevice(), Config);
 	}
 
 	if (!VideoEncoder->Encoder)
@@ -104,7 +905,16 @@ bool UCompushadyVideoEncoder::Initialize(const ECompushadyVideoEncoderCodec Code
 		return false;
 	}
 
+	VideoEncoder->FramePool.Reset(NumInputFrames);
+	VideoEncoder->FrameTextures.SetNum(NumInputFrames);
+	VideoEncoder->FrameLumaUAVs.SetNum(NumInputFrames);
+	VideoEncoder->FrameChromaUAVs.SetNum(NumInputFrames);
+
+	// the resolution is known only with the first frame, so the settings are applied there
+	EncoderConfig.Initialize(Settings);
+
 	Timestamp = 0;
+	bH265 = Codec == ECompushadyVideoEncoderCodec::H265Main;
 
 	return true;
 #else
@@ -115,6 +925,11 @@ bool UCompushadyVideoEncoder::Initialize(const ECompushadyVideoEncoderCodec Code
 bool UCompushadyVideoEncoder::EncodeFrame(UCompushadyResource* FrameResource, const bool bForceKeyFrame)
 {
 #ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	if (!VideoEncoder)
+	{
+		return false;
+	}
+
 	if (!FrameResource)
 	{
 		return false;
@@ -125,20 +940,121 @@ bool UCompushadyVideoEncoder::EncodeFrame(UCompushadyResource* FrameResource, co
 		return false;
 	}
 
-	FVideoEncoderConfigH264& Config = VideoEncoder->Encoder->GetInstance()->Edit<FVideoEncoderConfigH264>();
+	FTextureRHIRef SourceTexture = FrameResource->GetTextureRHI();
+
+	if (YUVConverter && ((SourceTexture->GetSizeX() % 2) != 0 || (SourceTexture->GetSizeY() % 2) != 0))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("NV12 frames require even sizes (got %dx%d)"), SourceTexture->GetSizeX(), SourceTexture->GetSizeY());
+		return false;
+	}
+
+	EncoderConfig.SetResolution(SourceTexture->GetSizeX(), SourceTexture->GetSizeY());
+	if (bForceKeyFrame)
+	{
+		EncoderConfig.RequestKeyFrame();
+	}
+
+	const int32 FrameIndex = VideoEncoder->AcquireFrame(Timestamp);
+	if (FrameIndex == INDEX_NONE)
+	{
+		UE_LOG(LogCompushady, Warning, TEXT("All of the %d VideoEncoder input frames are still in use, frame dropped"), VideoEncoder->FramePool.Num());
+		return false;
+	}
+
+	bool bKeyFrame = false;
+	if (!EncoderConfig.Update(*VideoEncoder, bKeyFrame))
+	{
+		VideoEncoder->FramePool.Cancel(FrameIndex);
+		return false;
+	}
+
+	FTextureRHIRef& FrameTexture = VideoEncoder->FrameTextures[FrameIndex];
+	FUnorderedAccessViewRHIRef& FrameLumaUAV = VideoEncoder->FrameLumaUAVs[FrameIndex];
+	FUnorderedAccessViewRHIRef& FrameChromaUAV = VideoEncoder->FrameChromaUAVs[FrameIndex];
+	TSharedPtr<FVideoResourceRHI>& VideoResource = VideoEncoder->FramePool.GetResource(FrameIndex);
+
+	const EPixelFormat FrameFormat = YUVConverter ? EPixelFormat::PF_NV12 : SourceTexture->GetFormat();
+
+	// input frames are (re)created only when the texture size or format changes
+	if (!FrameTexture.IsValid() || FrameTexture->GetSizeXY() != SourceTexture->GetSizeXY() || FrameTexture->GetFormat() != FrameFormat)
+	{
+		FRHITextureCreateDesc TextureCreateDesc = FRHITextureCreateDesc::Create2D(*FString::Printf(TEXT("CompushadyVideoEncoderFrame%d"), FrameIndex), SourceTexture->GetSizeX(), SourceTexture->GetSizeY(), FrameFormat);
+		TextureCreateDesc.SetFlags(ETextureCreateFlags::ShaderResource | ETextureCreateFlags::UAV);
+
+		FTextureRHIRef NewFrameTexture = nullptr;
+		FUnorderedAccessViewRHIRef NewFrameLumaUAV = nullptr;
+		FUnorderedAccessViewRHIRef NewFrameChromaUAV = nullptr;
+
+		ENQUEUE_RENDER_COMMAND(DoCompushadyCreateTexture)(
+			[&NewFrameTexture, &NewFrameLumaUAV, &NewFrameChromaUAV, &TextureCreateDesc, FrameFormat](FRHICommandListImmediate& RHICmdList)
+			{
+				NewFrameTexture = RHICreateTexture(TextureCreateDesc);
+				if (FrameFormat == EPixelFormat::PF_NV12 && NewFrameTexture.IsValid())
+				{
+					// the plane is selected by the view format
+#if COMPUSHADY_UE_VERSION >= 53
+					NewFrameLumaUAV = COMPUSHADY_CREATE_UAV(NewFrameTexture, FRHIViewDesc::CreateTextureUAV().SetDimensionFromTexture(NewFrameTexture).SetFormat(EPixelFormat::PF_R8));
+					NewFrameChromaUAV = COMPUSHADY_CREATE_UAV(NewFrameTexture, FRHIViewDesc::CreateTextureUAV().SetDimensionFromTexture(NewFrameTexture).SetFormat(EPixelFormat::PF_R8G8));
+#else
+					NewFrameLumaUAV = COMPUSHADY_CREATE_UAV(NewFrameTexture, 0, static_cast<uint8>(EPixelFormat::PF_R8));
+					NewFrameChromaUAV = COMPUSHADY_CREATE_UAV(NewFrameTexture, 0, static_cast<uint8>(EPixelFormat::PF_R8G8));
+#endif
+				}
+			});
+
+		FlushRenderingCommands();
+
+		if (!NewFrameTexture.IsValid() || !NewFrameTexture->IsValid() || (FrameFormat == EPixelFormat::PF_NV12 && (!NewFrameLumaUAV || !NewFrameChromaUAV)))
+		{
+			VideoEncoder->FramePool.Cancel(FrameIndex);
+			// do not lose the keyframe request
+			if (bKeyFrame)
+			{
+				EncoderConfig.RequestKeyFrame();
+			}
+			return false;
+		}
 
-	Config.Width = FrameResource->GetTextureSize().X;
-	Config.Height = FrameResource->GetTextureSize().Y;
+		FrameTexture = NewFrameTexture;
+		FrameLumaUAV = NewFrameLumaUAV;
+		FrameChromaUAV = NewFrameChromaUAV;
 
-	VideoEncoder->Encoder->SetMinimalConfig(Config);
+		FVideoDescriptor RawDescriptor = FVideoResourceRHI::GetDescriptorFrom(VideoEncoder->Encoder->GetDevice().ToSharedRef(), FrameTexture);
 
-	FVideoDescriptor RawDescriptor = FVideoResourceRHI::GetDescriptorFrom(VideoEncoder->Encoder->GetDevice().ToSharedRef(), FrameResource->GetTextureRHI());
+		VideoResource = MakeShared<FVideoResourceRHI>(
+			VideoEncoder->Encoder->GetDevice().ToSharedRef(),
+			FVideoResourceRHI::FRawData{ FrameTexture, nullptr, 0 }, RawDescriptor);
+	}
 
-	TSharedPtr<FVideoResourceRHI> VideoResource = MakeShared<FVideoResourceRHI>(
-		VideoEncoder->Encoder->GetDevice().ToSharedRef(),
-		FVideoResourceRHI::FRawData{ FrameResource->GetTextureRHI(), nullptr, 0 }, RawDescriptor);
+	if (YUVConverter)
+	{
+		ENQUEUE_RENDER_COMMAND(DoCompushadyConvertVideoEncoderFrame)(
+			[Converter = YUVConverter, SourceTexture, FrameTexture, FrameLumaUAV, FrameChromaUAV](FRHICommandListImmediate& RHICmdList)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(FrameTexture, ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+				Converter->ConvertToTexture_RenderThread(RHICmdList, SourceTexture, FrameLumaUAV, FrameChromaUAV, FIntPoint(SourceTexture->GetSizeX(), SourceTexture->GetSizeY()));
+				RHICmdList.Transition(FRHITransitionInfo(FrameTexture, ERHIAccess::UAVCompute, ERHIAccess::SRVMask));
+			});
+	}
+	else
+	{
+		ENQUEUE_RENDER_COMMAND(DoCompushadyCopyVideoEncoderFrame)(
+			[SourceTexture, FrameTexture](FRHICommandListImmediate& RHICmdList)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+				RHICmdList.Transition(FRHITransitionInfo(FrameTexture, ERHIAccess::Unknown, ERHIAccess::CopyDest));
+				RHICmdList.CopyTexture(SourceTexture, FrameTexture, FRHICopyTextureInfo());
+				RHICmdList.Transition(FRHITransitionInfo(FrameTexture, ERHIAccess::CopyDest, ERHIAccess::SRVMask));
+			});
+	}
 
-	VideoEncoder->Encoder->SendFrame(VideoResource, Timestamp++, bForceKeyFrame);
+	VideoEncoder->Encoder->SendFrame(VideoResource, Timestamp++, bKeyFrame);
+
+	if (Sink)
+	{
+		FrameSize = FIntPoint(SourceTexture->GetSizeX(), SourceTexture->GetSizeY());
+		DequeueEncodedFramesToSink();
+	}
 
 	return true;
 #else
@@ -146,11 +1062,57 @@ bool UCompushadyVideoEncoder::EncodeFrame(UCompushadyResource* FrameResource, co
 #endif
 }
 
+void UCompushadyVideoEncoder::SetBitrate(const int32 TargetBitrate, const int32 MaxBitrate)
+{
+	EncoderConfig.SetBitrate(TargetBitrate, MaxBitrate);
+}
+
+void UCompushadyVideoEncoder::RequestKeyFrame()
+{
+	EncoderConfig.RequestKeyFrame();
+}
+
+bool UCompushadyVideoEncoder::SetNativeYUV(const bool bEnable, const ECompushadyYUVMatrix Matrix, FString& ErrorMessages, const bool bLinearSource)
+{
+	if (!bEnable)
+	{
+		YUVConverter = nullptr;
+		return true;
+	}
+
+	// NV12 planes are written through R8/R8G8 views of the texture
+	if (RHIGetInterfaceType() != ERHIInterfaceType::D3D12)
+	{
+		ErrorMessages = "Native YUV frames are currently supported only on Direct3D12";
+		return false;
+	}
+
+	if (!GPixelFormats[EPixelFormat::PF_NV12].Supported)
+	{
+		ErrorMessages = "NV12 textures are not supported";
+		return false;
+	}
+
+	TSharedPtr<Compushady::Video::FCompushadyYUVConverter, ESPMode::ThreadSafe> NewYUVConverter = MakeShared<Compushady::Video::FCompushadyYUVConverter, ESPMode::ThreadSafe>();
+	if (!NewYUVConverter->Initialize(Matrix, bLinearSource, true, ErrorMessages))
+	{
+		return false;
+	}
+
+	YUVConverter = NewYUVConverter;
+	return true;
+}
+
 bool UCompushadyVideoEncoder::DequeueEncodedFrame(TArray<uint8>& FrameData)
 {
 #ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	if (Sink)
+	{
+		return false;
+	}
+
 	FVideoPacket VideoPacket;
-	if (!VideoEncoder->Encoder->ReceivePacket(VideoPacket))
+	if (!VideoEncoder->ReceivePacket(VideoPacket))
 	{
 		return false;
 	}
@@ -167,8 +1129,13 @@ bool UCompushadyVideoEncoder::DequeueEncodedFrame(TArray<uint8>& FrameData)
 bool UCompushadyVideoEncoder::DequeueEncodedFrame(uint8* FrameData, int32& FrameDataSize)
 {
 #ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	if (Sink)
+	{
+		return false;
+	}
+
 	FVideoPacket VideoPacket;
-	if (!VideoEncoder->Encoder->ReceivePacket(VideoPacket))
+	if (!VideoEncoder->ReceivePacket(VideoPacket))
 	{
 		return false;
 	}
@@ -187,8 +1154,86 @@ bool UCompushadyVideoEncoder::DequeueEncodedFrame(uint8* FrameData, int32& Frame
 #endif
 }
 
+bool UCompushadyVideoEncoder::StartRecording(const FString& Filename, const ECompushadyVideoContainer Container, FString& ErrorMessages, const int32 FrameRate, const int32 MaxQueuedPackets)
+{
+#ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	if (!VideoEncoder)
+	{
+		ErrorMessages = "VideoEncoder is not initialized";
+		return false;
+	}
+
+	if (Sink)
+	{
+		ErrorMessages = "VideoEncoder is already recording";
+		return false;
+	}
+
+	Sink = Compushady::Video::FCompushadyVideoFileSink::Create(Filename, Container, bH265, FrameRate, MaxQueuedPackets, ErrorMessages);
+	return Sink.IsValid();
+#else
+	ErrorMessages = "Video encoding is not supported on this platform";
+	return false;
+#endif
+}
+
+void UCompushadyVideoEncoder::StopRecording()
+{
+	if (!Sink)
+	{
+		return;
+	}
+
+	// packets still in the encoder
+	DequeueEncodedFramesToSink();
+
+	Sink->Close();
+	Sink = nullptr;
+}
+
+bool UCompushadyVideoEncoder::IsRecording() const
+{
+	return Sink.IsValid();
+}
+
+FCompushadyVideoRecordingStats UCompushadyVideoEncoder::GetRecordingStats() const
+{
+	return Sink ? Sink->GetStats() : FCompushadyVideoRecordingStats();
+}
+
+void UCompushadyVideoEncoder::DequeueEncodedFramesToSink()
+{
+#ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
+	FVideoPacket VideoPacket;
+	while (VideoEncoder->ReceivePacket(VideoPacket))
+	{
+		Compushady::Video::FCompushadyVideoPacket Packet;
+		Packet.Data = VideoPacket.DataPtr;
+		Packet.Size = static_cast<int64>(VideoPacket.DataSize);
+		Packet.Timestamp = VideoPacket.Timestamp;
+		Packet.FrameSize = FrameSize;
+
+		// the encoder flags are not reliable across backends, the NAL unit types are
+		TArray<TArrayView<const uint8>> NALUnits;
+		Compushady::Video::ParseAnnexB(Packet.Data.Get(), Packet.Size, NALUnits);
+		for (const TArrayView<const uint8>& NALUnit : NALUnits)
+		{
+			if (Compushady::Video::IsKeyFrameNALUnit(NALUnit, bH265))
+			{
+				Packet.bKeyFrame = true;
+				break;
+			}
+		}
+
+		Sink->Enqueue(MoveTemp(Packet));
+	}
+#endif
+}
+
 UCompushadyVideoEncoder::~UCompushadyVideoEncoder()
 {
+	StopRecording();
+
 #ifdef COMPUSHADY_SUPPORTS_VIDEO_ENCODING
 	if (VideoEncoder)
 	{
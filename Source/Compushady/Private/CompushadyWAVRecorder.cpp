@@ -0,0 +1,704 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyWAVRecorder.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Math/VectorRegister.h"
+#include "RHIGPUReadback.h"
+
+// frames converted at once by the writer, keeps the conversion buffer small
+#define COMPUSHADY_WAV_CONVERSION_FRAMES 16384
+
+namespace Compushady
+{
+	namespace WAV
+	{
+		static void AppendFourCC(TArray<uint8>& Data, const char* FourCC)
+		{
+			Data.Append(reinterpret_cast<const uint8*>(FourCC), 4);
+		}
+
+		template<typename T>
+		static void AppendValue(TArray<uint8>& Data, const T Value)
+		{
+			Data.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+		}
+
+		/* next uniform [0, 1) value of every lane */
+		FORCEINLINE static VectorRegister4Float NextUniform(VectorRegister4Int& State)
+		{
+			State = VectorIntAdd(VectorIntMultiply(State, MakeVectorRegisterInt(1664525, 1664525, 1664525, 1664525)), MakeVectorRegisterInt(1013904223, 1013904223, 1013904223, 1013904223));
+			return VectorMultiply(VectorIntToFloat(VectorShiftRightImmLogical(State, 8)), VectorSetFloat1(1.0f / 16777216.0f));
+		}
+
+		FORCEINLINE static void StoreSample(const int32 Value, const int32 BytesPerSample, uint8* Output)
+		{
+			if (BytesPerSample == 1)
+			{
+				// 8 bit samples are unsigned
+				*Output = static_cast<uint8>(Value + 128);
+			}
+			else
+			{
+				// little endian, the lowest bytes of the int32
+				FMemory::Memcpy(Output, &Value, BytesPerSample);
+			}
+		}
+
+		struct FCompushadyWAVReadback
+		{
+			TUniquePtr<FRHIGPUBufferReadback> Readback;
+			uint64 Sequence = 0;
+			int64 NumFrames = 0;
+			uint32 NumBytes = 0;
+			FCompushadySignaled OnSignaled;
+		};
+
+		struct FCompushadyWAVCapture
+		{
+			TSharedPtr<FCompushadyWAVSink> Sink;
+			std::atomic<int32> NumInFlight{ 0 };
+
+			// render thread only
+			TQueue<FCompushadyWAVReadback, EQueueMode::Spsc> Readbacks;
+
+			/* Readbacks are completed in order, waiting for the GPU only with bWait */
+			void CompleteBlocks_RenderThread(FRHICommandListImmediate& RHICmdList, const bool bWait)
+			{
+				if (bWait && !Readbacks.IsEmpty())
+				{
+					RHICmdList.BlockUntilGPUIdle();
+				}
+
+				while (FCompushadyWAVReadback* Block = Readbacks.Peek())
+				{
+					if (!Block->Readback->IsReady() && !bWait)
+					{
+						break;
+					}
+
+					bool bSuccess = false;
+					// after waiting for the GPU a readback that is still not ready is lost
+					if (const void* Data = Block->Readback->IsReady() ? Block->Readback->Lock(Block->NumBytes) : nullptr)
+					{
+						TArray<float> Samples;
+						Samples.Append(reinterpret_cast<const float*>(Data), static_cast<int32>(Block->NumBytes / sizeof(float)));
+						Block->Readback->Unlock();
+						Sink->Submit(Block->Sequence, MoveTemp(Samples), Block->NumFrames);
+						bSuccess = true;
+					}
+					else
+					{
+						Sink->Cancel(Block->Sequence);
+					}
+
+					AsyncTask(ENamedThreads::GameThread, [OnSignaled = Block->OnSignaled, bSuccess]()
+						{
+							OnSignaled.ExecuteIfBound(bSuccess, bSuccess ? "" : "Unable to read back the WAV block");
+						});
+
+					Readbacks.Pop();
+					NumInFlight--;
+				}
+			}
+		};
+	}
+}
+
+int32 Compushady::WAV::GetBytesPerSample(const ECompushadyWAVFormat WAVFormat)
+{
+	switch (WAVFormat)
+	{
+	case ECompushadyWAVFormat::PCM8:
+		return 1;
+	case ECompushadyWAVFormat::PCM16:
+		return 2;
+	case ECompushadyWAVFormat::PCM24:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+void Compushady::WAV::WriteHeader(TArray<uint8>& Header, const int32 SampleRate, const int32 NumChannels, const ECompushadyWAVFormat WAVFormat, const uint64 DataSize)
+{
+	const int32 BytesPerSample = GetBytesPerSample(WAVFormat);
+	const uint16 BlockAlign = static_cast<uint16>(NumChannels * BytesPerSample);
+	const bool bFloat = WAVFormat == ECompushadyWAVFormat::Float;
+	// WAVE_FORMAT_EXTENSIBLE is required for more than 2 channels or more than 16 bits
+	const bool bExtensible = NumChannels > 2 || BytesPerSample > 2;
+	const uint32 FmtSize = bExtensible ? 40 : 16;
+
+	const uint64 HeaderSize = 12 + 8 + 28 + 8 + FmtSize + 8;
+	// odd data chunks are padded
+	const uint64 RIFFSize = HeaderSize - 8 + DataSize + (DataSize & 1);
+	const bool bRF64 = RIFFSize > MAX_uint32;
+
+	Header.Empty(static_cast<int32>(HeaderSize));
+
+	AppendFourCC(Header, bRF64 ? "RF64" : "RIFF");
+	AppendValue<uint32>(Header, bRF64 ? MAX_uint32 : static_cast<uint32>(RIFFSize));
+	AppendFourCC(Header, "WAVE");
+
+	// the JUNK chunk has the same size of ds64, so a RIFF file can be promoted in place
+	AppendFourCC(Header, bRF64 ? "ds64" : "JUNK");
+	AppendValue<uint32>(Header, 28);
+	AppendValue<uint64>(Header, bRF64 ? RIFFSize : 0);
+	AppendValue<uint64>(Header, bRF64 ? DataSize : 0);
+	AppendValue<uint64>(Header, bRF64 ? DataSize / BlockAlign : 0);
+	// table length
+	AppendValue<uint32>(Header, 0);
+
+	const uint16 FormatTag = bFloat ? 3 : 1;
+	AppendFourCC(Header, "fmt ");
+	AppendValue<uint32>(Header, FmtSize);
+	AppendValue<uint16>(Header, bExtensible ? 0xFFFE : FormatTag);
+	AppendValue<uint16>(Header, static_cast<uint16>(NumChannels));
+	AppendValue<uint32>(Header, static_cast<uint32>(SampleRate));
+	AppendValue<uint32>(Header, static_cast<uint32>(SampleRate) * BlockAlign);
+	AppendValue<uint16>(Header, BlockAlign);
+	AppendValue<uint16>(Header, static_cast<uint16>(BytesPerSample * 8));
+	if (bExtensible)
+	{
+		AppendValue<uint16>(Header, 22);
+		// valid bits
+		AppendValue<uint16>(Header, static_cast<uint16>(BytesPerSample * 8));
+		// channel mask (unspecified)
+		AppendValue<uint32>(Header, 0);
+		// KSDATAFORMAT_SUBTYPE_PCM/IEEE_FLOAT
+		AppendValue<uint16>(Header, FormatTag);
+		Header.Append({ 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 });
+	}
+
+	AppendFourCC(Header, "data");
+	AppendValue<uint32>(Header, bRF64 ? MAX_uint32 : static_cast<uint32>(DataSize));
+}
+
+void Compushady::WAV::ConvertSamples(const float* Samples, const int64 NumFrames, const int32 NumChannels, const int64 PlanarPitch, const ECompushadyWAVFormat WAVFormat, FCompushadyWAVDither* Dither, uint8* Output)
+{
+	const int32 BytesPerSample = GetBytesPerSample(WAVFormat);
+	const int64 NumSamples = NumFrames * NumChannels;
+
+	if (WAVFormat == ECompushadyWAVFormat::Float)
+	{
+		if (PlanarPitch == 0)
+		{
+			FMemory::Memcpy(Output, Samples, NumSamples * sizeof(float));
+			return;
+		}
+
+		float* FloatOutput = reinterpret_cast<float*>(Output);
+		for (int32 Channel = 0; Channel < NumChannels; Channel++)
+		{
+			const float* Plane = Samples + Channel * PlanarPitch;
+			for (int64 Frame = 0; Frame < NumFrames; Frame++)
+			{
+				FloatOutput[Frame * NumChannels + Channel] = Plane[Frame];
+			}
+		}
+		return;
+	}
+
+	const float Scale = static_cast<float>(1ULL << (BytesPerSample * 8 - 1));
+	// the biggest float below 2^31 for PCM32
+	const float Max = WAVFormat == ECompushadyWAVFormat::PCM32 ? 2147483520.0f : Scale - 1;
+	const bool bDither = Dither && WAVFormat != ECompushadyWAVFormat::PCM32;
+
+	const VectorRegister4Float ScaleVector = VectorSetFloat1(Scale);
+	const VectorRegister4Float MinVector = VectorSetFloat1(-Scale);
+	const VectorRegister4Float MaxVector = VectorSetFloat1(Max);
+	const VectorRegister4Float HalfVector = VectorSetFloat1(0.5f);
+	VectorRegister4Int DitherState = bDither ? VectorIntLoad(Dither->Lanes) : GlobalVectorConstants::IntZero;
+
+	MS_ALIGN(16) int32 Quantized[4] GCC_ALIGN(16);
+	MS_ALIGN(16) float Gathered[4] GCC_ALIGN(16);
+
+	auto Quantize = [&](const VectorRegister4Float Value)
+		{
+			VectorRegister4Float Scaled = VectorMultiply(Value, ScaleVector);
+			if (bDither)
+			{
+				// triangular (TPDF) noise, +-1 LSB
+				const VectorRegister4Float Noise0 = NextUniform(DitherState);
+				const VectorRegister4Float Noise1 = NextUniform(DitherState);
+				Scaled = VectorAdd(Scaled, VectorSubtract(Noise0, Noise1));
+			}
+			Scaled = VectorMax(VectorMin(VectorFloor(VectorAdd(Scaled, HalfVector)), MaxVector), MinVector);
+			VectorIntStoreAligned(VectorFloatToInt(Scaled), Quantized);
+		};
+
+	if (PlanarPitch == 0)
+	{
+		// interleaved input maps 1:1 to the output
+		for (int64 Index = 0; Index < NumSamples; Index += 4)
+		{
+			const int32 Count = static_cast<int32>(FMath::Min<int64>(4, NumSamples - Index));
+			if (Count == 4)
+			{
+				Quantize(VectorLoad(Samples + Index));
+			}
+			else
+			{
+				FMemory::Memzero(Gathered, sizeof(Gathered));
+				FMemory::Memcpy(Gathered, Samples + Index, Count * sizeof(float));
+				Quantize(VectorLoadAligned(Gathered));
+			}
+
+			for (int32 Lane = 0; Lane < Count; Lane++)
+			{
+				StoreSample(Quantized[Lane], BytesPerSample, Output + (Index + Lane) * BytesPerSample);
+			}
+		}
+	}
+	else
+	{
+		// 4 frames of a plane at a time, scattered to the interleaved output
+		const int64 FrameSize = static_cast<int64>(NumChannels) * BytesPerSample;
+		for (int32 Channel = 0; Channel < NumChannels; Channel++)
+		{
+			const float* Plane = Samples + Channel * PlanarPitch;
+			uint8* ChannelOutput = Output + Channel * BytesPerSample;
+			for (int64 Frame = 0; Frame < NumFrames; Frame += 4)
+			{
+				const int32 Count = static_cast<int32>(FMath::Min<int64>(4, NumFrames - Frame));
+				if (Count == 4)
+				{
+					Quantize(VectorLoad(Plane + Frame));
+				}
+				else
+				{
+					FMemory::Memzero(Gathered, sizeof(Gathered));
+					FMemory::Memcpy(Gathered, Plane + Frame, Count * sizeof(float));
+					Quantize(VectorLoadAligned(Gathered));
+				}
+
+				for (int32 Lane = 0; Lane < Count; Lane++)
+				{
+					StoreSample(Quantized[Lane], BytesPerSample, ChannelOutput + (Frame + Lane) * FrameSize);
+				}
+			}
+		}
+	}
+
+	if (bDither)
+	{
+		VectorIntStore(DitherState, Dither->Lanes);
+	}
+}
+
+TSharedPtr<Compushady::WAV::FCompushadyWAVWriter> Compushady::WAV::FCompushadyWAVWriter::Create(const FString& Filename, const int32 SampleRate, const int32 NumChannels, const ECompushadyWAVFormat WAVFormat, const bool bDither, FString& ErrorMessages)
+{
+	if (SampleRate <= 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid SampleRate %d"), SampleRate);
+		return nullptr;
+	}
+
+	if (NumChannels <= 0 || NumChannels > MAX_uint16 / 4)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid NumChannels %d"), NumChannels);
+		return nullptr;
+	}
+
+	FArchive* FileWriter = IFileManager::Get().CreateFileWriter(*Filename);
+	if (!FileWriter)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to open %s"), *Filename);
+		return nullptr;
+	}
+
+	TSharedPtr<FCompushadyWAVWriter> Writer = MakeShared<FCompushadyWAVWriter>(*FileWriter, SampleRate, NumChannels, WAVFormat, bDither);
+	Writer->OwnedArchive = TUniquePtr<FArchive>(FileWriter);
+	return Writer;
+}
+
+Compushady::WAV::FCompushadyWAVWriter::FCompushadyWAVWriter(FArchive& InArchive, const int32 InSampleRate, const int32 InNumChannels, const ECompushadyWAVFormat InWAVFormat, const bool bDither) : Archive(&InArchive), SampleRate(InSampleRate), NumChannels(InNumChannels), WAVFormat(InWAVFormat)
+{
+	if (bDither)
+	{
+		Dither.Emplace();
+	}
+
+	// placeholder sizes, patched on Close()
+	TArray<uint8> Header;
+	WriteHeader(Header, SampleRate, NumChannels, WAVFormat, 0);
+	HeaderSize = Header.Num();
+	Archive->Serialize(Header.GetData(), Header.Num());
+}
+
+Compushady::WAV::FCompushadyWAVWriter::~FCompushadyWAVWriter()
+{
+	FString ErrorMessages;
+	Close(ErrorMessages);
+}
+
+bool Compushady::WAV::FCompushadyWAVWriter::Write(const float* Samples, const int64 InNumFrames, const int64 PlanarPitch, FString& ErrorMessages)
+{
+	if (bClosed)
+	{
+		ErrorMessages = "The WAV writer is closed";
+		return false;
+	}
+
+	if (InNumFrames <= 0)
+	{
+		return true;
+	}
+
+	if (PlanarPitch != 0 && PlanarPitch < InNumFrames)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid PlanarPitch %lld"), PlanarPitch);
+		return false;
+	}
+
+	const int32 FrameSize = NumChannels * GetBytesPerSample(WAVFormat);
+
+	for (int64 Frame = 0; Frame < InNumFrames; Frame += COMPUSHADY_WAV_CONVERSION_FRAMES)
+	{
+		const int64 ChunkFrames = FMath::Min<int64>(COMPUSHADY_WAV_CONVERSION_FRAMES, InNumFrames - Frame);
+		ConversionBuffer.SetNumUninitialized(static_cast<int32>(ChunkFrames * FrameSize), EAllowShrinking::No);
+
+		const float* ChunkSamples = PlanarPitch == 0 ? Samples + Frame * NumChannels : Samples + Frame;
+		ConvertSamples(ChunkSamples, ChunkFrames, NumChannels, PlanarPitch, WAVFormat, Dither.GetPtrOrNull(), ConversionBuffer.GetData());
+
+		Archive->Serialize(ConversionBuffer.GetData(), ConversionBuffer.Num());
+		if (Archive->IsError())
+		{
+			ErrorMessages = "Unable to write WAV data";
+			return false;
+		}
+
+		NumFrames += ChunkFrames;
+		DataSize += ConversionBuffer.Num();
+	}
+
+	return true;
+}
+
+bool Compushady::WAV::FCompushadyWAVWriter::Close(FString& ErrorMessages)
+{
+	if (bClosed)
+	{
+		return true;
+	}
+
+	bClosed = true;
+
+	if (DataSize & 1)
+	{
+		uint8 Padding = 0;
+		Archive->Serialize(&Padding, 1);
+	}
+
+	TArray<uint8> Header;
+	WriteHeader(Header, SampleRate, NumChannels, WAVFormat, DataSize);
+	check(Header.Num() == HeaderSize);
+	bRF64 = Header[0] == 'R' && Header[1] == 'F';
+
+	const int64 EndPosition = Archive->Tell();
+	Archive->Seek(0);
+	Archive->Serialize(Header.GetData(), Header.Num());
+	Archive->Seek(EndPosition);
+
+	bool bSuccess = !Archive->IsError();
+	if (OwnedArchive)
+	{
+		bSuccess = OwnedArchive->Close() && bSuccess;
+		OwnedArchive.Reset();
+	}
+	Archive = nullptr;
+
+	if (!bSuccess)
+	{
+		ErrorMessages = "Unable to write WAV data";
+	}
+
+	return bSuccess;
+}
+
+Compushady::WAV::FCompushadyWAVSink::FCompushadyWAVSink(TSharedPtr<FCompushadyWAVWriter> InWriter, const bool bInPlanar) :
+	Writer(InWriter),
+	bPlanar(bInPlanar),
+	// audio blocks are never dropped
+	Blocks(MAX_int32, [this](TPair<TArray<float>, int64>& Block, int64& WrittenBytes)
+		{
+			return WriteBlock(Block, WrittenBytes);
+		})
+{
+}
+
+Compushady::WAV::FCompushadyWAVSink::~FCompushadyWAVSink()
+{
+	// the writer thread uses the sink
+	Blocks.Close();
+}
+
+bool Compushady::WAV::FCompushadyWAVSink::Start(FString& ErrorMessages)
+{
+	return Blocks.Start(TEXT("CompushadyWAVSink"), ErrorMessages);
+}
+
+bool Compushady::WAV::FCompushadyWAVSink::Reserve(uint64& Sequence)
+{
+	return Blocks.Reserve(Sequence, false);
+}
+
+void Compushady::WAV::FCompushadyWAVSink::Submit(const uint64 Sequence, TArray<float>&& Samples, const int64 NumFrames)
+{
+	Blocks.Submit(Sequence, TPair<TArray<float>, int64>(MoveTemp(Samples), NumFrames));
+}
+
+void Compushady::WAV::FCompushadyWAVSink::Cancel(const uint64 Sequence)
+{
+	Blocks.Cancel(Sequence);
+}
+
+bool Compushady::WAV::FCompushadyWAVSink::WriteBlock(TPair<TArray<float>, int64>& Block, int64& WrittenBytes)
+{
+	const int64 DataSize = Writer->GetDataSize();
+
+	FString ErrorMessages;
+	if (!Writer->Write(Block.Key.GetData(), Block.Value, bPlanar ? Block.Value : 0, ErrorMessages))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("Unable to append WAV block: %s"), *ErrorMessages);
+		return false;
+	}
+
+	WrittenFrames += Block.Value;
+	WrittenBytes = Writer->GetDataSize() - DataSize;
+	return true;
+}
+
+bool Compushady::WAV::FCompushadyWAVSink::Close(FString& ErrorMessages)
+{
+	Blocks.Close();
+	return Writer->Close(ErrorMessages);
+}
+
+FCompushadyWAVRecorderStats Compushady::WAV::FCompushadyWAVSink::GetStats() const
+{
+	FCompushadyWAVRecorderStats Stats;
+	Stats.QueuedBlocks = Blocks.NumQueued();
+	// lost readbacks are failures too
+	Stats.FailedBlocks = Blocks.GetNumFailed() + Blocks.GetNumDropped();
+	Stats.WrittenFrames = WrittenFrames.load();
+	Stats.WrittenBytes = Blocks.GetWrittenBytes();
+	return Stats;
+}
+
+void UCompushadyWAVRecorder::BeginDestroy()
+{
+	Super::BeginDestroy();
+
+	if (Capture)
+	{
+		// the blocks in the readbacks are completed without stalling the game thread
+		ENQUEUE_RENDER_COMMAND(DoCompushadyWAVRecorderDestroy)(
+			[CurrentCapture = Capture](FRHICommandListImmediate& RHICmdList)
+			{
+				CurrentCapture->CompleteBlocks_RenderThread(RHICmdList, true);
+			});
+
+		DestroyFence.BeginFence();
+	}
+}
+
+bool UCompushadyWAVRecorder::IsReadyForFinishDestroy()
+{
+	if (!Super::IsReadyForFinishDestroy())
+	{
+		return false;
+	}
+
+	if (!Capture)
+	{
+		return true;
+	}
+
+	if (!DestroyFence.IsFenceComplete() || Capture->Sink->NumQueued() > 0)
+	{
+		return false;
+	}
+
+	// the writer thread is idle, only the header is left
+	FString ErrorMessages;
+	if (!Capture->Sink->Close(ErrorMessages))
+	{
+		UE_LOG(LogCompushady, Error, TEXT("%s"), *ErrorMessages);
+	}
+	Capture = nullptr;
+	return true;
+}
+
+void UCompushadyWAVRecorder::Tick(float DeltaTime)
+{
+	ENQUEUE_RENDER_COMMAND(DoCompushadyWAVRecorderPoll)(
+		[CurrentCapture = Capture](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentCapture->CompleteBlocks_RenderThread(RHICmdList, false);
+		});
+}
+
+TStatId UCompushadyWAVRecorder::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCompushadyWAVRecorder, STATGROUP_Tickables);
+}
+
+bool UCompushadyWAVRecorder::IsTickable() const
+{
+	return Capture.IsValid() && Capture->NumInFlight.load() > 0;
+}
+
+bool UCompushadyWAVRecorder::Open(const FString& Filename, const int32 SampleRate, const int32 NumChannels, FString& ErrorMessages, const ECompushadyWAVFormat WAVFormat, const bool bPlanar, const bool bDither)
+{
+	if (!Close(ErrorMessages))
+	{
+		return false;
+	}
+
+	TSharedPtr<Compushady::WAV::FCompushadyWAVWriter> Writer = Compushady::WAV::FCompushadyWAVWriter::Create(Filename, SampleRate, NumChannels, WAVFormat, bDither, ErrorMessages);
+	if (!Writer)
+	{
+		return false;
+	}
+
+	TSharedPtr<Compushady::WAV::FCompushadyWAVCapture, ESPMode::ThreadSafe> NewCapture = MakeShared<Compushady::WAV::FCompushadyWAVCapture, ESPMode::ThreadSafe>();
+	NewCapture->Sink = MakeShared<Compushady::WAV::FCompushadyWAVSink>(Writer, bPlanar);
+	if (!NewCapture->Sink->Start(ErrorMessages))
+	{
+		return false;
+	}
+
+	Capture = NewCapture;
+	return true;
+}
+
+void UCompushadyWAVRecorder::AppendBuffer(UCompushadyResource* Resource, const int64 Offset, const int64 NumFrames, const FCompushadySignaled& OnSignaled)
+{
+	if (!Capture)
+	{
+		OnSignaled.ExecuteIfBound(false, "The recorder is not open");
+		return;
+	}
+
+	if (!Resource || !Resource->IsValidBuffer())
+	{
+		OnSignaled.ExecuteIfBound(false, "The resource is not a valid Buffer");
+		return;
+	}
+
+	const int64 NumBytes = NumFrames * Capture->Sink->GetNumChannels() * static_cast<int64>(sizeof(float));
+	if (NumFrames <= 0 || NumBytes > MAX_int32)
+	{
+		OnSignaled.ExecuteIfBound(false, FString::Printf(TEXT("Invalid NumFrames %lld"), NumFrames));
+		return;
+	}
+
+	if (Offset < 0 || Offset + NumBytes > Resource->GetBufferSize())
+	{
+		OnSignaled.ExecuteIfBound(false, "Invalid Buffer offset");
+		return;
+	}
+
+	// the order of the blocks is the order of the calls, not of the readbacks completion
+	uint64 Sequence = 0;
+	if (!Capture->Sink->Reserve(Sequence))
+	{
+		OnSignaled.ExecuteIfBound(false, "Unable to queue the WAV block");
+		return;
+	}
+
+	Capture->NumInFlight++;
+
+	// only [Offset, Offset + NumBytes) is copied, the readback is polled on the following frames
+	ENQUEUE_RENDER_COMMAND(DoCompushadyWAVRecorderAppendBuffer)(
+		[CurrentCapture = Capture, BufferRHIRef = Resource->GetBufferRHI(), Offset, NumBytes, NumFrames, Sequence, OnSignaled](FRHICommandListImmediate& RHICmdList)
+		{
+			Compushady::WAV::FCompushadyWAVReadback Block;
+			Block.Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("Compushady::WAVRecorder::Readback"));
+			Block.Sequence = Sequence;
+			Block.NumFrames = NumFrames;
+			Block.NumBytes = static_cast<uint32>(NumBytes);
+			Block.OnSignaled = OnSignaled;
+
+			RHICmdList.Transition(FRHITransitionInfo(BufferRHIRef, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+
+			if (Offset == 0)
+			{
+				Block.Readback->EnqueueCopy(RHICmdList, BufferRHIRef, Block.NumBytes);
+			}
+			else
+			{
+				// the readback always starts at the beginning of the buffer
+				FBufferRHIRef RegionBuffer = COMPUSHADY_CREATE_BUFFER(TEXT("Compushady::WAVRecorder::Region"), Block.NumBytes, EBufferUsageFlags::UnorderedAccess, sizeof(float), ERHIAccess::CopyDest);
+				RHICmdList.CopyBufferRegion(RegionBuffer, 0, BufferRHIRef, Offset, Block.NumBytes);
+				RHICmdList.Transition(FRHITransitionInfo(RegionBuffer, ERHIAccess::CopyDest, ERHIAccess::CopySrc));
+				Block.Readback->EnqueueCopy(RHICmdList, RegionBuffer, Block.NumBytes);
+			}
+
+			CurrentCapture->Readbacks.Enqueue(MoveTemp(Block));
+		});
+}
+
+bool UCompushadyWAVRecorder::AppendSamples(const TArray<float>& Samples, FString& ErrorMessages)
+{
+	if (!Capture)
+	{
+		ErrorMessages = "The recorder is not open";
+		return false;
+	}
+
+	const int32 NumChannels = Capture->Sink->GetNumChannels();
+	if (Samples.Num() % NumChannels != 0)
+	{
+		ErrorMessages = FString::Printf(TEXT("The number of samples (%d) is not a multiple of NumChannels (%d)"), Samples.Num(), NumChannels);
+		return false;
+	}
+
+	uint64 Sequence = 0;
+	if (!Capture->Sink->Reserve(Sequence))
+	{
+		ErrorMessages = "Unable to queue the WAV block";
+		return false;
+	}
+
+	TArray<float> Block = Samples;
+	Capture->Sink->Submit(Sequence, MoveTemp(Block), Samples.Num() / NumChannels);
+	return true;
+}
+
+bool UCompushadyWAVRecorder::Close(FString& ErrorMessages)
+{
+	if (!Capture)
+	{
+		return true;
+	}
+
+	// readbacks still in flight
+	ENQUEUE_RENDER_COMMAND(DoCompushadyWAVRecorderClose)(
+		[CurrentCapture = Capture](FRHICommandListImmediate& RHICmdList)
+		{
+			CurrentCapture->CompleteBlocks_RenderThread(RHICmdList, true);
+		});
+
+	FlushRenderingCommands();
+
+	const bool bSuccess = Capture->Sink->Close(ErrorMessages);
+	Capture = nullptr;
+	return bSuccess;
+}
+
+bool UCompushadyWAVRecorder::IsOpen() const
+{
+	return Capture.IsValid();
+}
+
+FCompushadyWAVRecorderStats UCompushadyWAVRecorder::GetStats() const
+{
+	if (!Capture)
+	{
+		return FCompushadyWAVRecorderStats();
+	}
+
+	return Capture->Sink->GetStats();
+}
@@ -0,0 +1,215 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyAccelerationStructure.h"
+#include "CompushadyFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAccelerationStructureTest_ValidateTriangles, "Compushady.AccelerationStructure.ValidateTriangles", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAccelerationStructureTest_ValidateTriangles::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+
+	FCompushadyAccelerationStructureTriangles Triangles;
+	Triangles.NumVertices = 4;
+	Triangles.NumIndices = 6;
+
+	TestTrue(TEXT("Indexed"), Compushady::AccelerationStructure::ValidateTriangles(Triangles, 4 * 12, 6 * 4, 4, ErrorMessages));
+	TestTrue(TEXT("Indexed16"), Compushady::AccelerationStructure::ValidateTriangles(Triangles, 4 * 12, 6 * 2, 2, ErrorMessages));
+
+	TestFalse(TEXT("VertexBufferTooSmall"), Compushady::AccelerationStructure::ValidateTriangles(Triangles, 4 * 12 - 1, 6 * 4, 4, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "Vertex buffer too small (48 bytes required, 47 available)");
+
+	TestFalse(TEXT("IndexBufferTooSmall"), Compushady::AccelerationStructure::ValidateTriangles(Triangles, 4 * 12, 6 * 4 - 4, 4, ErrorMessages));
+	TestFalse(TEXT("InvalidIndexStride"), Compushady::AccelerationStructure::ValidateTriangles(Triangles, 4 * 12, 6 * 4, 1, ErrorMessages));
+
+	FCompushadyAccelerationStructureTriangles InvalidIndices = Triangles;
+	InvalidIndices.NumIndices = 5;
+	TestFalse(TEXT("InvalidNumIndices"), Compushady::AccelerationStructure::ValidateTriangles(InvalidIndices, 4 * 12, 6 * 4, 4, ErrorMessages));
+
+	FCompushadyAccelerationStructureTriangles MisalignedIndexOffset = Triangles;
+	MisalignedIndexOffset.IndexOffset = 4;
+	TestFalse(TEXT("MisalignedIndexOffset"), Compushady::AccelerationStructure::ValidateTriangles(MisalignedIndexOffset, 4 * 12, 1024, 4, ErrorMessages));
+
+	FCompushadyAccelerationStructureTriangles InvalidStride = Triangles;
+	InvalidStride.VertexStride = 10;
+	TestFalse(TEXT("InvalidVertexStride"), Compushady::AccelerationStructure::ValidateTriangles(InvalidStride, 1024, 6 * 4, 4, ErrorMessages));
+
+	// interleaved vertices, only the position of the last vertex must fit
+	FCompushadyAccelerationStructureTriangles Interleaved = Triangles;
+	Interleaved.VertexStride = 32;
+	Interleaved.VertexOffset = 16;
+	TestTrue(TEXT("Interleaved"), Compushady::AccelerationStructure::ValidateTriangles(Interleaved, 16 + 3 * 32 + 12, 6 * 4, 4, ErrorMessages));
+
+	FCompushadyAccelerationStructureTriangles NonIndexed;
+	NonIndexed.NumVertices = 6;
+	TestTrue(TEXT("NonIndexed"), Compushady::AccelerationStructure::ValidateTriangles(NonIndexed, 6 * 12, 0, 0, ErrorMessages));
+	NonIndexed.NumVertices = 5;
+	TestFalse(TEXT("NonIndexedInvalid"), Compushady::AccelerationStructure::ValidateTriangles(NonIndexed, 6 * 12, 0, 0, ErrorMessages));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAccelerationStructureTest_ValidateAABBs, "Compushady.AccelerationStructure.ValidateAABBs", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAccelerationStructureTest_ValidateAABBs::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+
+	FCompushadyAccelerationStructureAABBs AABBs;
+	AABBs.NumAABBs = 100;
+
+	TestTrue(TEXT("Valid"), Compushady::AccelerationStructure::ValidateAABBs(AABBs, 100 * 24, ErrorMessages));
+	TestFalse(TEXT("TooSmall"), Compushady::AccelerationStructure::ValidateAABBs(AABBs, 100 * 24 - 1, ErrorMessages));
+
+	FCompushadyAccelerationStructureAABBs InvalidStride = AABBs;
+	InvalidStride.Stride = 28;
+	TestFalse(TEXT("InvalidStride"), Compushady::AccelerationStructure::ValidateAABBs(InvalidStride, 100 * 32, ErrorMessages));
+
+	FCompushadyAccelerationStructureAABBs InvalidOffset = AABBs;
+	InvalidOffset.Offset = 4;
+	TestFalse(TEXT("InvalidOffset"), Compushady::AccelerationStructure::ValidateAABBs(InvalidOffset, 100 * 32, ErrorMessages));
+
+	FCompushadyAccelerationStructureAABBs Empty;
+	TestFalse(TEXT("Empty"), Compushady::AccelerationStructure::ValidateAABBs(Empty, 1024, ErrorMessages));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAccelerationStructureTest_ValidateInstances, "Compushady.AccelerationStructure.ValidateInstances", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAccelerationStructureTest_ValidateInstances::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+
+	FCompushadyAccelerationStructureInstance Instance;
+	TestFalse(TEXT("NoBLAS"), Compushady::AccelerationStructure::ValidateInstance(Instance, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "Invalid BLAS");
+
+	TStrongObjectPtr<UCompushadyAccelerationStructure> BLAS(NewObject<UCompushadyAccelerationStructure>());
+	Instance.BLAS = BLAS.Get();
+	TestTrue(TEXT("Valid"), Compushady::AccelerationStructure::ValidateInstance(Instance, ErrorMessages));
+
+	Instance.InstanceID = 1 << 24;
+	TestFalse(TEXT("InvalidInstanceID"), Compushady::AccelerationStructure::ValidateInstance(Instance, ErrorMessages));
+
+	Instance.InstanceID = 0;
+	Instance.HitGroupIndex = -1;
+	TestFalse(TEXT("InvalidHitGroupIndex"), Compushady::AccelerationStructure::ValidateInstance(Instance, ErrorMessages));
+
+	TestTrue(TEXT("InstanceBuffer"), Compushady::AccelerationStructure::ValidateInstanceBuffer(64 * 10, 0, 10, ErrorMessages));
+	TestFalse(TEXT("InstanceBufferTooSmall"), Compushady::AccelerationStructure::ValidateInstanceBuffer(64 * 10, 64, 10, ErrorMessages));
+	TestFalse(TEXT("InstanceBufferMisaligned"), Compushady::AccelerationStructure::ValidateInstanceBuffer(64 * 11, 8, 10, ErrorMessages));
+	TestFalse(TEXT("InstanceBufferEmpty"), Compushady::AccelerationStructure::ValidateInstanceBuffer(64 * 10, 0, 0, ErrorMessages));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAccelerationStructureTest_PackInstance, "Compushady.AccelerationStructure.PackInstance", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAccelerationStructureTest_PackInstance::RunTest(const FString& Parameters)
+{
+	FCompushadyAccelerationStructureInstance Instance;
+	Instance.Transform = FTransform(FQuat::Identity, FVector(10, 20, 30), FVector(2, 3, 4));
+	Instance.InstanceID = 0x123456;
+	Instance.Mask = 0x0F;
+	Instance.HitGroupIndex = 7;
+	Instance.bForceOpaque = true;
+	Instance.bTriangleCullDisable = true;
+
+	Compushady::AccelerationStructure::FCompushadyInstanceDesc InstanceDesc;
+	Compushady::AccelerationStructure::PackInstance(Instance, 0xDEADBEEF00001000ULL, InstanceDesc);
+
+	// scale on the diagonal, translation in the last column
+	TestEqual(TEXT("Transform[0][0]"), InstanceDesc.Transform[0][0], 2.0f);
+	TestEqual(TEXT("Transform[1][1]"), InstanceDesc.Transform[1][1], 3.0f);
+	TestEqual(TEXT("Transform[2][2]"), InstanceDesc.Transform[2][2], 4.0f);
+	TestEqual(TEXT("Transform[0][1]"), InstanceDesc.Transform[0][1], 0.0f);
+	TestEqual(TEXT("Transform[0][3]"), InstanceDesc.Transform[0][3], 10.0f);
+	TestEqual(TEXT("Transform[1][3]"), InstanceDesc.Transform[1][3], 20.0f);
+	TestEqual(TEXT("Transform[2][3]"), InstanceDesc.Transform[2][3], 30.0f);
+
+	TestEqual(TEXT("InstanceIDAndMask"), InstanceDesc.InstanceIDAndMask, 0x0F123456u);
+	TestEqual(TEXT("HitGroupIndexAndFlags"), InstanceDesc.HitGroupIndexAndFlags, 0x05000007u);
+	TestEqual(TEXT("AccelerationStructureAddress"), InstanceDesc.AccelerationStructureAddress, 0xDEADBEEF00001000ULL);
+
+	// the native layout
+	TestEqual(TEXT("InstanceIDAndMask Offset"), static_cast<int32>(STRUCT_OFFSET(Compushady::AccelerationStructure::FCompushadyInstanceDesc, InstanceIDAndMask)), 48);
+	TestEqual(TEXT("AccelerationStructureAddress Offset"), static_cast<int32>(STRUCT_OFFSET(Compushady::AccelerationStructure::FCompushadyInstanceDesc, AccelerationStructureAddress)), 56);
+
+	// a rotation must end in the upper 3x3 (column-vector convention)
+	Instance.Transform = FTransform(FRotator(0, 90, 0));
+	Compushady::AccelerationStructure::PackInstance(Instance, 0, InstanceDesc);
+	const FVector Rotated = Instance.Transform.TransformVector(FVector(1, 0, 0));
+	TestEqual(TEXT("Rotated.X"), InstanceDesc.Transform[0][0], static_cast<float>(Rotated.X), 0.0001f);
+	TestEqual(TEXT("Rotated.Y"), InstanceDesc.Transform[1][0], static_cast<float>(Rotated.Y), 0.0001f);
+	TestEqual(TEXT("Rotated.Z"), InstanceDesc.Transform[2][0], static_cast<float>(Rotated.Z), 0.0001f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAccelerationStructureTest_Build, "Compushady.AccelerationStructure.Build", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAccelerationStructureTest_Build::RunTest(const FString& Parameters)
+{
+	const TArray<float> Positions = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+	UCompushadySRV* VertexBuffer = UCompushadyFunctionLibrary::CreateCompushadySRVBufferFromFloatArray(TestName, Positions, EPixelFormat::PF_R32_FLOAT);
+
+	FCompushadyAccelerationStructureTriangles Triangles;
+	Triangles.VertexBuffer = VertexBuffer;
+	Triangles.NumVertices = 3;
+
+	TStrongObjectPtr<UCompushadyAccelerationStructure> BLAS(NewObject<UCompushadyAccelerationStructure>());
+
+	FString SupportErrorMessages;
+	FString ErrorMessages;
+	if (!UCompushadyAccelerationStructure::IsSupported(SupportErrorMessages))
+	{
+		// the limitation is reported when creating the acceleration structure
+		TestFalse(TEXT("BLAS->InitializeBLASFromTriangles"), BLAS->InitializeBLASFromTriangles({ Triangles }, false, ErrorMessages));
+		TestEqual(TEXT("ErrorMessages"), ErrorMessages, SupportErrorMessages);
+		return true;
+	}
+
+	if (!TestTrue(TEXT("BLAS->InitializeBLASFromTriangles"), BLAS->InitializeBLASFromTriangles({ Triangles }, false, ErrorMessages)))
+	{
+		AddError(ErrorMessages);
+		return true;
+	}
+
+	FCompushadyAccelerationStructureInstance Instance;
+	Instance.BLAS = BLAS.Get();
+
+	TStrongObjectPtr<UCompushadyAccelerationStructure> TLAS(NewObject<UCompushadyAccelerationStructure>());
+	TestFalse(TEXT("TLAS->InitializeTLAS (BLAS not built)"), TLAS->InitializeTLAS({ Instance }, ErrorMessages));
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(BLAS.Get(), TEXT("StoreLastSignal"));
+	BLAS->Build(Signal);
+
+	// the build is asynchronous
+	TestTrue(TEXT("BLAS->IsRunning()"), BLAS->IsRunning());
+	TestFalse(TEXT("BLAS->IsBuilt()"), BLAS->IsBuilt());
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, BLAS, TLAS, Instance]()
+		{
+			if (BLAS->IsRunning())
+			{
+				return false;
+			}
+
+			TestTrue(TEXT("BLAS->bLastSuccess"), BLAS->bLastSuccess);
+			TestTrue(TEXT("BLAS->IsBuilt()"), BLAS->IsBuilt());
+			TestTrue(TEXT("BLAS->GetGPUAddress()"), BLAS->GetGPUAddress() != 0);
+
+			FString ErrorMessages;
+			TestTrue(TEXT("TLAS->InitializeTLAS"), TLAS->InitializeTLAS({ Instance }, ErrorMessages));
+			TestNotNull(TEXT("TLAS->GetSRV()"), TLAS->GetSRV());
+			return true;
+		}));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,227 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyAudioSubsystem.h"
+#include "CompushadySoundWave.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAudioTest_DeinterleaveChannelLayouts, "Compushady.Audio.DeinterleaveChannelLayouts", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAudioTest_DeinterleaveChannelLayouts::RunTest(const FString& Parameters)
+{
+	const int32 ChannelLayouts[] = { 1, 2, 3, 4, 6, 8 };
+	// 13 exercises the non vectorized tail
+	const int32 FrameCounts[] = { 4, 13, 1024 };
+
+	for (const int32 NumChannels : ChannelLayouts)
+	{
+		for (const int32 NumFrames : FrameCounts)
+		{
+			const int32 Pitch = NumFrames + 3;
+
+			TArray<float> Interleaved;
+			Interleaved.AddUninitialized(NumFrames * NumChannels);
+			for (int32 Index = 0; Index < Interleaved.Num(); Index++)
+			{
+				Interleaved[Index] = static_cast<float>(Index);
+			}
+
+			TArray<float> Planar;
+			Planar.Init(-1, Pitch * NumChannels);
+
+			Compushady::Audio::Deinterleave(Interleaved.GetData(), Planar.GetData(), NumFrames, NumChannels, Pitch);
+
+			bool bMatches = true;
+			bool bPaddingUntouched = true;
+			for (int32 Channel = 0; Channel < NumChannels; Channel++)
+			{
+				for (int32 Frame = 0; Frame < Pitch; Frame++)
+				{
+					const float Value = Planar[Channel * Pitch + Frame];
+					if (Frame < NumFrames)
+					{
+						bMatches &= Value == Interleaved[Frame * NumChannels + Channel];
+					}
+					else
+					{
+						bPaddingUntouched &= Value == -1;
+					}
+				}
+			}
+
+			TestTrue(FString::Printf(TEXT("bMatches (%d channels, %d frames)"), NumChannels, NumFrames), bMatches);
+			TestTrue(FString::Printf(TEXT("bPaddingUntouched (%d channels, %d frames)"), NumChannels, NumFrames), bPaddingUntouched);
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAudioTest_BlockRing, "Compushady.Audio.BlockRing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAudioTest_BlockRing::RunTest(const FString& Parameters)
+{
+	Compushady::Audio::FCompushadyAudioBlockRing Ring(2, 4);
+
+	TestNull(TEXT("BeginRead (empty)"), Ring.BeginRead());
+
+	// wrap around a few times
+	for (int32 Iteration = 0; Iteration < 3; Iteration++)
+	{
+		for (int32 Block = 0; Block < 2; Block++)
+		{
+			float* Samples = Ring.BeginWrite();
+			if (!TestNotNull(TEXT("BeginWrite"), Samples))
+			{
+				return true;
+			}
+			Samples[0] = static_cast<float>(Iteration * 2 + Block);
+			Ring.EndWrite();
+		}
+
+		TestNull(TEXT("BeginWrite (full)"), Ring.BeginWrite());
+		TestEqual(TEXT("Ring.Num()"), Ring.Num(), 2);
+
+		for (int32 Block = 0; Block < 2; Block++)
+		{
+			const float* Samples = Ring.BeginRead();
+			if (!TestNotNull(TEXT("BeginRead"), Samples))
+			{
+				return true;
+			}
+			TestEqual(TEXT("Samples[0]"), Samples[0], static_cast<float>(Iteration * 2 + Block));
+			Ring.EndRead();
+		}
+
+		TestEqual(TEXT("Ring.Num() (drained)"), Ring.Num(), 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAudioTest_DeinterleaveBenchmark, "Compushady.Audio.DeinterleaveBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAudioTest_DeinterleaveBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumFrames = 1024;
+	constexpr int32 NumIterations = 2000;
+	const int32 ChannelLayouts[] = { 2, 4 };
+
+	for (const int32 NumChannels : ChannelLayouts)
+	{
+		TArray<float> Interleaved;
+		Interleaved.AddUninitialized(NumFrames * NumChannels);
+		for (int32 Index = 0; Index < Interleaved.Num(); Index++)
+		{
+			Interleaved[Index] = static_cast<float>(Index);
+		}
+
+		TArray<float> Planar;
+		Planar.AddZeroed(NumFrames * NumChannels);
+		TArray<float> PlanarReference;
+		PlanarReference.AddZeroed(NumFrames * NumChannels);
+
+		// the per sample transpose previously done on the game thread
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+		{
+			for (int32 Y = 0; Y < NumChannels; Y++)
+			{
+				for (int32 X = 0; X < NumFrames; X++)
+				{
+					PlanarReference[Y * NumFrames + X] = Interleaved[X * NumChannels + Y];
+				}
+			}
+		}
+		const double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+		{
+			Compushady::Audio::Deinterleave(Interleaved.GetData(), Planar.GetData(), NumFrames, NumChannels, NumFrames);
+		}
+		const double VectorizedTime = FPlatformTime::Seconds() - StartTime;
+
+		AddInfo(FString::Printf(TEXT("%d channels: scalar %f ms, vectorized %f ms"), NumChannels, ScalarTime * 1000, VectorizedTime * 1000));
+
+		TestTrue(TEXT("Planar == PlanarReference"), Planar == PlanarReference);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyAudioTest_StreamRing, "Compushady.Audio.StreamRing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyAudioTest_StreamRing::RunTest(const FString& Parameters)
+{
+	Compushady::Audio::FCompushadyAudioStreamRing Ring(3, 4, 2);
+
+	auto CompleteChunk = [&Ring](const float Value)
+		{
+			const int32 ChunkIndex = Ring.GetNextPendingChunk();
+			if (ChunkIndex == INDEX_NONE)
+			{
+				return false;
+			}
+			float* Data = Ring.GetChunkData(ChunkIndex);
+			for (int32 Index = 0; Index < Ring.GetChunkSamples(); Index++)
+			{
+				Data[Index] = Value;
+			}
+			Ring.Complete();
+			return true;
+		};
+
+	float Output[6];
+
+	// nothing submitted yet, buffering is not an underrun
+	TestEqual(TEXT("Pop (empty)"), Ring.Pop(Output, 6), 0);
+	TestEqual(TEXT("Output[0] (silence)"), Output[0], 0.0f);
+	TestTrue(TEXT("IsBuffering (empty)"), Ring.IsBuffering());
+	TestEqual(TEXT("GetNumUnderruns (empty)"), Ring.GetNumUnderruns(), 0LL);
+
+	TestEqual(TEXT("Submit 0"), Ring.Submit(), 0);
+	TestEqual(TEXT("Submit 1"), Ring.Submit(), 1);
+	TestEqual(TEXT("Submit 2"), Ring.Submit(), 2);
+	TestEqual(TEXT("Submit (full)"), Ring.Submit(), static_cast<int32>(INDEX_NONE));
+	TestEqual(TEXT("GetNumDroppedChunks"), Ring.GetNumDroppedChunks(), 1LL);
+	TestEqual(TEXT("NumPending"), Ring.NumPending(), 3);
+
+	// below the latency target
+	TestTrue(TEXT("CompleteChunk 0"), CompleteChunk(1));
+	TestEqual(TEXT("Pop (buffering)"), Ring.Pop(Output, 6), 0);
+	TestTrue(TEXT("IsBuffering (buffering)"), Ring.IsBuffering());
+
+	TestTrue(TEXT("CompleteChunk 1"), CompleteChunk(2));
+	TestEqual(TEXT("NumCompleted"), Ring.NumCompleted(), 2);
+
+	// crosses the chunk boundary
+	TestEqual(TEXT("Pop (playing)"), Ring.Pop(Output, 6), 6);
+	TestFalse(TEXT("IsBuffering (playing)"), Ring.IsBuffering());
+	TestEqual(TEXT("Output[3]"), Output[3], 1.0f);
+	TestEqual(TEXT("Output[4]"), Output[4], 2.0f);
+
+	// the first chunk is free again
+	TestEqual(TEXT("Submit (recycled)"), Ring.Submit(), 0);
+
+	// chunk 2 is still waiting for the GPU
+	TestEqual(TEXT("Pop (underrun)"), Ring.Pop(Output, 4), 2);
+	TestEqual(TEXT("Output[1]"), Output[1], 2.0f);
+	TestEqual(TEXT("Output[2] (silence)"), Output[2], 0.0f);
+	TestEqual(TEXT("GetNumUnderruns"), Ring.GetNumUnderruns(), 1LL);
+	TestEqual(TEXT("GetNumUnderrunSamples"), Ring.GetNumUnderrunSamples(), 2LL);
+	TestTrue(TEXT("IsBuffering (underrun)"), Ring.IsBuffering());
+
+	// back to playing only after the latency target is reached again
+	TestTrue(TEXT("CompleteChunk 2"), CompleteChunk(3));
+	TestEqual(TEXT("Pop (rebuffering)"), Ring.Pop(Output, 4), 0);
+	TestTrue(TEXT("CompleteChunk 3"), CompleteChunk(4));
+	TestFalse(TEXT("CompleteChunk (nothing pending)"), CompleteChunk(5));
+	TestEqual(TEXT("Pop (resumed)"), Ring.Pop(Output, 4), 4);
+	TestEqual(TEXT("Output[0] (resumed)"), Output[0], 3.0f);
+	TestEqual(TEXT("GetNumUnderruns (resumed)"), Ring.GetNumUnderruns(), 1LL);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,450 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyBlendable.h"
+#include "CompushadyFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+namespace Compushady
+{
+	namespace Tests
+	{
+		static Compushady::Blendable::FCompushadyBlendablePassDesc MakePassDesc(const ECompushadyPostProcessLocation PostProcessLocation, const bool bCompute, const FCompushadyResourceArray& ResourceArray = {})
+		{
+			Compushady::Blendable::FCompushadyBlendablePassDesc PassDesc;
+			PassDesc.PostProcessLocation = PostProcessLocation;
+			PassDesc.bCompute = bCompute;
+			FString ErrorMessages;
+			Compushady::RDG::CollectResourceAccesses(ResourceArray, PassDesc.Accesses, ErrorMessages, ERHIAccess::SRVCompute, ERHIAccess::UAVCompute, true);
+			return PassDesc;
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_PassGroups, "Compushady.Blendable.PassGroups", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_PassGroups::RunTest(const FString& Parameters)
+{
+	TArray<TArray<int32>> Groups;
+
+	Compushady::Blendable::BuildPassGroups({}, Groups);
+	TestEqual(TEXT("Empty"), Groups.Num(), 0);
+
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true)
+		}, Groups);
+	if (TestEqual(TEXT("Consecutive Compute"), Groups.Num(), 1))
+	{
+		TestTrue(TEXT("Consecutive Compute Groups[0]"), Groups[0] == TArray<int32>({ 0, 1, 2 }));
+	}
+
+	// a pixel shader blendable breaks the sequence
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, false),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, false),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, false)
+		}, Groups);
+	if (TestEqual(TEXT("Mixed"), Groups.Num(), 5))
+	{
+		TestTrue(TEXT("Mixed Groups[0]"), Groups[0] == TArray<int32>({ 0 }));
+		TestTrue(TEXT("Mixed Groups[1]"), Groups[1] == TArray<int32>({ 1 }));
+		TestTrue(TEXT("Mixed Groups[2]"), Groups[2] == TArray<int32>({ 2, 3 }));
+		TestTrue(TEXT("Mixed Groups[3]"), Groups[3] == TArray<int32>({ 4 }));
+		TestTrue(TEXT("Mixed Groups[4]"), Groups[4] == TArray<int32>({ 5 }));
+	}
+
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::AfterBasePass, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::PrePostProcess, true),
+		Compushady::Tests::MakePassDesc(ECompushadyPostProcessLocation::AfterTonemapping, true)
+		}, Groups);
+	if (TestEqual(TEXT("Locations"), Groups.Num(), 3))
+	{
+		TestTrue(TEXT("Locations Groups[0]"), Groups[0] == TArray<int32>({ 0 }));
+		TestTrue(TEXT("Locations Groups[1]"), Groups[1] == TArray<int32>({ 1, 2 }));
+		TestTrue(TEXT("Locations Groups[2]"), Groups[2] == TArray<int32>({ 3 }));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_PassGroupsHazards, "Compushady.Blendable.PassGroupsHazards", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_PassGroupsHazards::RunTest(const FString& Parameters)
+{
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8);
+	UCompushadyUAV* UAV2 = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8);
+
+	// an SRV on the same texture of the UAV
+	UCompushadySRV* SRV = NewObject<UCompushadySRV>();
+	TestTrue(TEXT("SRV->InitializeFromTexture"), SRV->InitializeFromTexture(UAV->GetTextureRHI()));
+
+	FCompushadyResourceArray WriteResourceArray;
+	WriteResourceArray.UAVs = { UAV };
+
+	FCompushadyResourceArray ReadResourceArray;
+	ReadResourceArray.SRVs = { SRV, UCompushadyFunctionLibrary::CreateCompushadySRVFromSceneTexture(ECompushadySceneTexture::SceneColorInput) };
+	ReadResourceArray.UAVs = { UAV2 };
+
+	const ECompushadyPostProcessLocation Location = ECompushadyPostProcessLocation::AfterTonemapping;
+
+	TArray<TArray<int32>> Groups;
+
+	// write after write is solved with an UAV barrier in the same pass
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(Location, true, WriteResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true, WriteResourceArray)
+		}, Groups);
+	if (TestEqual(TEXT("WriteAfterWrite"), Groups.Num(), 1))
+	{
+		TestTrue(TEXT("WriteAfterWrite Groups[0]"), Groups[0] == TArray<int32>({ 0, 1 }));
+	}
+
+	// read after write requires a new pass (and the ones after it join the new pass)
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(Location, true, WriteResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true, ReadResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true, ReadResourceArray)
+		}, Groups);
+	if (TestEqual(TEXT("ReadAfterWrite"), Groups.Num(), 2))
+	{
+		TestTrue(TEXT("ReadAfterWrite Groups[0]"), Groups[0] == TArray<int32>({ 0 }));
+		TestTrue(TEXT("ReadAfterWrite Groups[1]"), Groups[1] == TArray<int32>({ 1, 2 }));
+	}
+
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(Location, true, ReadResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true, WriteResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true)
+		}, Groups);
+	if (TestEqual(TEXT("WriteAfterRead"), Groups.Num(), 2))
+	{
+		TestTrue(TEXT("WriteAfterRead Groups[0]"), Groups[0] == TArray<int32>({ 0 }));
+		TestTrue(TEXT("WriteAfterRead Groups[1]"), Groups[1] == TArray<int32>({ 1, 2 }));
+	}
+
+	// unrelated resources (and scene textures, that are only read) do not break the pass
+	FCompushadyResourceArray OtherResourceArray;
+	OtherResourceArray.SRVs = { UCompushadyFunctionLibrary::CreateCompushadySRVFromSceneTexture(ECompushadySceneTexture::SceneColorInput) };
+	OtherResourceArray.UAVs = { UAV2 };
+
+	Compushady::Blendable::BuildPassGroups({
+		Compushady::Tests::MakePassDesc(Location, true, WriteResourceArray),
+		Compushady::Tests::MakePassDesc(Location, true, OtherResourceArray)
+		}, Groups);
+	if (TestEqual(TEXT("Unrelated"), Groups.Num(), 1))
+	{
+		TestTrue(TEXT("Unrelated Groups[0]"), Groups[0] == TArray<int32>({ 0, 1 }));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_MatricesInjection, "Compushady.Blendable.MatricesInjection", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_MatricesInjection::RunTest(const FString& Parameters)
+{
+	Compushady::Blendable::FCompushadyBlendableViewData ViewData;
+	ViewData.ViewMatrix = FMatrix(FPlane(1, 2, 3, 4), FPlane(5, 6, 7, 8), FPlane(9, 10, 11, 12), FPlane(13, 14, 15, 16));
+	ViewData.InverseProjectionMatrix = FMatrix(FPlane(2, 0, 0, 0), FPlane(0, 3, 0, 0), FPlane(0, 0, 4, 0), FPlane(0, 0, 0, 5));
+	ViewData.ScreenSize = FIntPoint(1920, 1080);
+	ViewData.Time = 17;
+
+	FCompushadyBlendableMatricesConfig MatricesConfig;
+	MatricesConfig.ViewMatrixOffset = 0;
+	MatricesConfig.InverseProjectionMatrixOffset = 64;
+	MatricesConfig.ScreenSizeFloat2Offset = 128;
+	MatricesConfig.TimeFloatOffset = 136;
+	// out of the buffer
+	MatricesConfig.ProjectionMatrixOffset = 136;
+	MatricesConfig.DeltaTimeFloatOffset = 144;
+
+	const float Scales[] = { 1.0f, 0.5f, 0.25f, 0.33f };
+	const FIntPoint ExpectedSizes[] = { FIntPoint(1920, 1080), FIntPoint(960, 540), FIntPoint(480, 270), FIntPoint(634, 357) };
+
+	for (int32 Index = 0; Index < static_cast<int32>(UE_ARRAY_COUNT(Scales)); Index++)
+	{
+		const FString Prefix = FString::Printf(TEXT("Scale %f"), Scales[Index]);
+
+		TestTrue(Prefix + TEXT(" GetScaledSize"), Compushady::Blendable::GetScaledSize(ViewData.ScreenSize, Scales[Index]) == ExpectedSizes[Index]);
+
+		TArray<uint8> CBVData;
+		CBVData.AddZeroed(144);
+		Compushady::Blendable::FillMatrices(CBVData, MatricesConfig, ViewData, Scales[Index]);
+
+		const float* Floats = reinterpret_cast<const float*>(CBVData.GetData());
+
+		// the matrices do not depend on the scale
+		TestEqual(Prefix + TEXT(" ViewMatrix[0][0]"), Floats[0], 1.0f);
+		TestEqual(Prefix + TEXT(" ViewMatrix[1][2]"), Floats[6], 7.0f);
+		TestEqual(Prefix + TEXT(" ViewMatrix[3][3]"), Floats[15], 16.0f);
+		TestEqual(Prefix + TEXT(" InverseProjectionMatrix[0][0]"), Floats[16], 2.0f);
+		TestEqual(Prefix + TEXT(" InverseProjectionMatrix[3][3]"), Floats[31], 5.0f);
+
+		TestEqual(Prefix + TEXT(" ScreenSize.X"), Floats[32], static_cast<float>(ExpectedSizes[Index].X));
+		TestEqual(Prefix + TEXT(" ScreenSize.Y"), Floats[33], static_cast<float>(ExpectedSizes[Index].Y));
+		TestEqual(Prefix + TEXT(" Time"), Floats[34], 17.0f);
+		TestEqual(Prefix + TEXT(" Padding"), Floats[35], 0.0f);
+	}
+
+	TestTrue(TEXT("Minimum size"), Compushady::Blendable::GetScaledSize(FIntPoint(3, 2), 0.01f) == FIntPoint(1, 1));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_HistoryReuse, "Compushady.Blendable.HistoryReuse", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_HistoryReuse::RunTest(const FString& Parameters)
+{
+	using namespace Compushady::Blendable;
+
+	TCompushadyBlendableHistory<TSharedPtr<int32>> History;
+	History.SetNumBuffers(2);
+
+	const uint32 ViewKey = 1;
+	const FIntPoint Size(64, 32);
+	bool bRecycled = false;
+
+	TestTrue(TEXT("Frame 0 BeginFrame"), History.BeginFrame(ViewKey, Size, PF_FloatRGBA, false, 0) == ECompushadyBlendableHistoryUpdate::Reallocated);
+	TSharedPtr<int32>* Target = History.AcquireTarget(ViewKey, bRecycled);
+	if (!TestNotNull(TEXT("Frame 0 Target"), Target))
+	{
+		return true;
+	}
+	TestFalse(TEXT("Frame 0 bRecycled"), bRecycled);
+	*Target = MakeShared<int32>(0);
+
+	TestTrue(TEXT("Frame 1 BeginFrame"), History.BeginFrame(ViewKey, Size, PF_FloatRGBA, false, 1) == ECompushadyBlendableHistoryUpdate::Reused);
+	TestEqual(TEXT("Frame 1 Targets.Num()"), History.FindView(ViewKey)->Targets.Num(), 1);
+	TestEqual(TEXT("Frame 1 NumValid"), History.FindView(ViewKey)->NumValid, 1);
+	TestEqual(TEXT("Frame 1 History0"), *History.FindView(ViewKey)->Targets[0], 0);
+	Target = History.AcquireTarget(ViewKey, bRecycled);
+	TestFalse(TEXT("Frame 1 bRecycled"), bRecycled);
+	*Target = MakeShared<int32>(1);
+
+	TestTrue(TEXT("Frame 2 BeginFrame"), History.BeginFrame(ViewKey, Size, PF_FloatRGBA, false, 2) == ECompushadyBlendableHistoryUpdate::Reused);
+	// further calls in the same frame do not rotate the history again
+	TestTrue(TEXT("Frame 2 BeginFrame (again)"), History.BeginFrame(ViewKey, Size, PF_FloatRGBA, false, 2) == ECompushadyBlendableHistoryUpdate::Reused);
+	TestEqual(TEXT("Frame 2 NumValid"), History.FindView(ViewKey)->NumValid, 2);
+	TestEqual(TEXT("Frame 2 History0"), *History.FindView(ViewKey)->Targets[0], 1);
+	TestEqual(TEXT("Frame 2 History1"), *History.FindView(ViewKey)->Targets[1], 0);
+
+	// the ring is full, so the oldest target is written again
+	Target = History.AcquireTarget(ViewKey, bRecycled);
+	TestTrue(TEXT("Frame 2 bRecycled"), bRecycled);
+	TestEqual(TEXT("Frame 2 Recycled Target"), **Target, 0);
+	**Target = 2;
+
+	TestTrue(TEXT("Frame 3 BeginFrame"), History.BeginFrame(ViewKey, Size, PF_FloatRGBA, false, 3) == ECompushadyBlendableHistoryUpdate::Reused);
+	TestEqual(TEXT("Frame 3 Targets.Num()"), History.FindView(ViewKey)->Targets.Num(), 2);
+	TestEqual(TEXT("Frame 3 NumValid"), History.FindView(ViewKey)->NumValid, 2);
+	TestEqual(TEXT("Frame 3 History0"), *History.FindView(ViewKey)->Targets[0], 2);
+	TestEqual(TEXT("Frame 3 History1"), *History.FindView(ViewKey)->Targets[1], 1);
+
+	// every view has its own history
+	TestTrue(TEXT("Second View BeginFrame"), History.BeginFrame(ViewKey + 1, Size, PF_FloatRGBA, false, 3) == ECompushadyBlendableHistoryUpdate::Reallocated);
+	TestEqual(TEXT("NumViews"), History.NumViews(), 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_HistoryInvalidation, "Compushady.Blendable.HistoryInvalidation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_HistoryInvalidation::RunTest(const FString& Parameters)
+{
+	using namespace Compushady::Blendable;
+
+	TCompushadyBlendableHistory<TSharedPtr<int32>> History;
+	History.SetNumBuffers(1);
+
+	const uint32 ViewKey = 1;
+	bool bRecycled = false;
+
+	History.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, false, 0);
+	*History.AcquireTarget(ViewKey, bRecycled) = MakeShared<int32>(0);
+
+	// a camera cut keeps the targets but discards their contents
+	TestTrue(TEXT("Camera Cut"), History.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, true, 1) == ECompushadyBlendableHistoryUpdate::Invalidated);
+	TestEqual(TEXT("Camera Cut Targets.Num()"), History.FindView(ViewKey)->Targets.Num(), 1);
+	TestEqual(TEXT("Camera Cut NumValid"), History.FindView(ViewKey)->NumValid, 0);
+	TSharedPtr<int32>* Target = History.AcquireTarget(ViewKey, bRecycled);
+	TestTrue(TEXT("Camera Cut bRecycled"), bRecycled);
+	TWeakPtr<int32> OldTarget = *Target;
+
+	TestTrue(TEXT("After Camera Cut"), History.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, false, 2) == ECompushadyBlendableHistoryUpdate::Reused);
+	TestEqual(TEXT("After Camera Cut NumValid"), History.FindView(ViewKey)->NumValid, 1);
+
+	// a resolution change releases the targets
+	TestTrue(TEXT("Resize"), History.BeginFrame(ViewKey, FIntPoint(128, 64), PF_FloatRGBA, false, 3) == ECompushadyBlendableHistoryUpdate::Reallocated);
+	TestEqual(TEXT("Resize Targets.Num()"), History.FindView(ViewKey)->Targets.Num(), 0);
+	TestEqual(TEXT("Resize NumValid"), History.FindView(ViewKey)->NumValid, 0);
+	TestFalse(TEXT("Resize OldTarget.IsValid()"), OldTarget.IsValid());
+	History.AcquireTarget(ViewKey, bRecycled);
+	TestFalse(TEXT("Resize bRecycled"), bRecycled);
+
+	TestTrue(TEXT("Format"), History.BeginFrame(ViewKey, FIntPoint(128, 64), PF_R8G8B8A8, false, 4) == ECompushadyBlendableHistoryUpdate::Reallocated);
+
+	// previous matrices are the current ones on the first frame and after a camera cut
+	const FMatrix Matrix0 = FMatrix(FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 1, 0), FPlane(10, 0, 0, 1));
+	const FMatrix Matrix1 = FMatrix(FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 1, 0), FPlane(20, 0, 0, 1));
+
+	FCompushadyBlendableViewData ViewData;
+	ViewData.ViewMatrix = Matrix0;
+	History.UpdateViewMatrices(ViewKey, false, 4, ViewData);
+	TestTrue(TEXT("First Frame PreviousViewMatrix"), ViewData.PreviousViewMatrix.Equals(Matrix0));
+
+	ViewData.ViewMatrix = Matrix1;
+	History.UpdateViewMatrices(ViewKey, false, 5, ViewData);
+	TestTrue(TEXT("PreviousViewMatrix"), ViewData.PreviousViewMatrix.Equals(Matrix0));
+	History.UpdateViewMatrices(ViewKey, false, 5, ViewData);
+	TestTrue(TEXT("PreviousViewMatrix (same frame)"), ViewData.PreviousViewMatrix.Equals(Matrix0));
+
+	ViewData.ViewMatrix = Matrix0;
+	History.UpdateViewMatrices(ViewKey, true, 6, ViewData);
+	TestTrue(TEXT("Camera Cut PreviousViewMatrix"), ViewData.PreviousViewMatrix.Equals(Matrix0));
+
+	// views not rendered anymore are released
+	History.BeginFrame(ViewKey + 1, FIntPoint(128, 64), PF_R8G8B8A8, false, 100);
+	History.RemoveStaleViews(100, 60);
+	TestEqual(TEXT("NumViews"), History.NumViews(), 1);
+	TestNull(TEXT("Stale View"), History.FindView(ViewKey));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_DirtyDrivenCache, "Compushady.Blendable.DirtyDrivenCache", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_DirtyDrivenCache::RunTest(const FString& Parameters)
+{
+	using namespace Compushady::Blendable;
+
+	TCompushadyBlendableOutputCache<TSharedPtr<int32>> OutputCache;
+
+	const uint32 ViewKey = 1;
+
+	// a new view is always executed
+	TestTrue(TEXT("First Frame"), OutputCache.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, 100, 0));
+	*OutputCache.GetTarget(ViewKey) = MakeShared<int32>(0);
+	OutputCache.EndFrame(ViewKey, 100);
+
+	TestFalse(TEXT("Same Signature"), OutputCache.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, 100, 1));
+	TestTrue(TEXT("Same Signature Target"), OutputCache.GetTarget(ViewKey)->IsValid());
+
+	// not executed frames keep the previous signature
+	TestTrue(TEXT("New Signature"), OutputCache.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, 101, 2));
+	TestTrue(TEXT("New Signature (not executed)"), OutputCache.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, 101, 3));
+	OutputCache.EndFrame(ViewKey, 101);
+	TestFalse(TEXT("New Signature (executed)"), OutputCache.BeginFrame(ViewKey, FIntPoint(64, 32), PF_FloatRGBA, 101, 4));
+
+	// a resolution change releases the cached target
+	TWeakPtr<int32> OldTarget = *OutputCache.GetTarget(ViewKey);
+	TestTrue(TEXT("Resize"), OutputCache.BeginFrame(ViewKey, FIntPoint(128, 64), PF_FloatRGBA, 101, 5));
+	TestFalse(TEXT("Resize OldTarget.IsValid()"), OldTarget.IsValid());
+	TestFalse(TEXT("Resize Target"), OutputCache.GetTarget(ViewKey)->IsValid());
+
+	// views are independent
+	TestTrue(TEXT("Second View"), OutputCache.BeginFrame(ViewKey + 1, FIntPoint(128, 64), PF_FloatRGBA, 101, 5));
+	TestEqual(TEXT("NumViews"), OutputCache.NumViews(), 2);
+
+	OutputCache.RemoveStaleViews(100, 60);
+	TestEqual(TEXT("Stale NumViews"), OutputCache.NumViews(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_ResourcesSignature, "Compushady.Blendable.ResourcesSignature", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_ResourcesSignature::RunTest(const FString& Parameters)
+{
+	using namespace Compushady::Blendable;
+
+	FString ErrorMessages;
+	UCompushadyCompute* Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString("RWBuffer<uint> Output; [numthreads(1, 1, 1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = tid.x; }", ErrorMessages, "main");
+	if (!TestNotNull(TEXT("Compute"), Compute))
+	{
+		return true;
+	}
+
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName, 32, EPixelFormat::PF_R32_UINT);
+	UCompushadySRV* SRV = UCompushadyFunctionLibrary::CreateCompushadySRVFromResource(UAV, 0, 0, 1, 1, EPixelFormat::PF_R32_UINT);
+	if (!TestNotNull(TEXT("SRV"), SRV))
+	{
+		return true;
+	}
+
+	UCompushadyCBV* CBV = UCompushadyFunctionLibrary::CreateCompushadyCBV(TestName, 16);
+	if (!TestNotNull(TEXT("CBV"), CBV))
+	{
+		return true;
+	}
+
+	// a blendable reading the buffer written by a compute pipeline
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.CBVs = { CBV };
+	ResourceArray.SRVs = { SRV };
+
+	const uint32 Signature = GetResourcesSignature(ResourceArray);
+	TestEqual(TEXT("Same Signature"), GetResourcesSignature(ResourceArray), Signature);
+
+	FCompushadyResourceArray ComputeResourceArray;
+	ComputeResourceArray.UAVs = { UAV };
+	TestTrue(TEXT("DispatchSync"), Compute->DispatchSync(ComputeResourceArray, FIntVector(8, 1, 1), ErrorMessages));
+
+	const uint32 DispatchSignature = GetResourcesSignature(ResourceArray);
+	TestNotEqual(TEXT("Dispatch Signature"), DispatchSignature, Signature);
+
+	CBV->SetFloat(0, 1.0f);
+	const uint32 CBVSignature = GetResourcesSignature(ResourceArray);
+	TestNotEqual(TEXT("CBV Signature"), CBVSignature, DispatchSignature);
+
+	// writing the same value does not change the contents
+	CBV->SetFloat(0, 1.0f);
+	TestEqual(TEXT("Same CBV Signature"), GetResourcesSignature(ResourceArray), CBVSignature);
+
+	// the render thread only hashes the versions, the CBVs part is taken on the game thread
+	TestEqual(TEXT("Split Signature"), GetResourceVersionsSignature(ResourceArray, GetCBVsSignature(ResourceArray)), CBVSignature);
+	const uint32 VersionsSignature = GetResourceVersionsSignature(ResourceArray);
+	CBV->SetFloat(0, 2.0f);
+	TestEqual(TEXT("Versions Signature"), GetResourceVersionsSignature(ResourceArray), VersionsSignature);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlendableTest_DirtyDrivenSceneTextures, "Compushady.Blendable.DirtyDrivenSceneTextures", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlendableTest_DirtyDrivenSceneTextures::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString PSCode = "Texture2D<float4> Input; float4 main(float4 position : SV_Position) : SV_Target0 { return Input.Load(int3(position.xy, 0)); }";
+
+	FCompushadyResourceArray SceneResourceArray;
+	SceneResourceArray.SRVs = { UCompushadyFunctionLibrary::CreateCompushadySRVFromSceneTexture(ECompushadySceneTexture::SceneColorInput) };
+
+	UCompushadyBlendable* Blendable = UCompushadyFunctionLibrary::CreateCompushadyBlendableFromHLSLString(PSCode, SceneResourceArray, ErrorMessages);
+	if (!TestNotNull(TEXT("Blendable"), Blendable))
+	{
+		return true;
+	}
+
+	// scene textures change every frame, the cache would never be refreshed
+	TestFalse(TEXT("SetDirtyDriven with scene textures"), Blendable->SetDirtyDriven(true, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "Dirty driven blendables cannot bind scene textures");
+
+	UCompushadySRV* SRV = UCompushadyFunctionLibrary::CreateCompushadySRVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8);
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.SRVs = { SRV };
+
+	TestTrue(TEXT("UpdateResources"), Blendable->UpdateResources(ResourceArray, ErrorMessages));
+	TestTrue(TEXT("SetDirtyDriven"), Blendable->SetDirtyDriven(true, ErrorMessages));
+	TestFalse(TEXT("UpdateResources with scene textures"), Blendable->UpdateResources(SceneResourceArray, ErrorMessages));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,273 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyBlitterActor.h"
+#include "CompushadyFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_PriorityOrdering, "Compushady.Blitter.PriorityOrdering", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_PriorityOrdering::RunTest(const FString& Parameters)
+{
+	const TArray<int32> Priorities = { 5, 0, 3, 0 };
+	const TArray<UPTRINT> TextureKeys = { 1, 1, 1, 1 };
+
+	TArray<Compushady::Blitter::FCompushadyBlitterBatch> Batches;
+	Compushady::Blitter::BuildBatches(Priorities, TextureKeys, Batches);
+
+	if (!TestEqual(TEXT("Batches.Num()"), Batches.Num(), 1))
+	{
+		return true;
+	}
+
+	// ties keep the insertion order
+	const TArray<int32> ExpectedIndices = { 1, 3, 2, 0 };
+	TestEqual(TEXT("DrawableIndices"), Batches[0].DrawableIndices, ExpectedIndices);
+	TestEqual(TEXT("TextureDrawableIndices.Num()"), Batches[0].TextureDrawableIndices.Num(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_PriorityDrawOrder, "Compushady.Blitter.PriorityDrawOrder", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_PriorityDrawOrder::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	TSharedRef<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe> Pipeline = MakeShared<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe>();
+	if (!TestTrue(TEXT("Pipeline->Initialize"), Pipeline->Initialize(ErrorMessages)))
+	{
+		AddError(ErrorMessages);
+		return true;
+	}
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+	UCompushadyRTV* Red = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Red);
+	UCompushadyRTV* Green = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Green);
+
+	// both drawables cover the whole target, so the one drawn last (the highest priority) is the visible one
+	auto DrawAndReadPixel = [&](const int32 RedPriority, const int32 GreenPriority, const int32 MaxInstances) -> uint32
+		{
+			TArray<FCompushadyBlitterDrawable> Drawables;
+			for (const TPair<UCompushadyRTV*, int32>& Pair : { TPair<UCompushadyRTV*, int32>(Red, RedPriority), TPair<UCompushadyRTV*, int32>(Green, GreenPriority) })
+			{
+				FCompushadyBlitterDrawable Drawable;
+				Drawable.Texture = Pair.Key->GetTextureRHI();
+				Drawable.Quad = FVector4(0, 0, 1, 1);
+				Drawable.Priority = Pair.Value;
+				Drawables.Add(Drawable);
+			}
+
+			ENQUEUE_RENDER_COMMAND(DoCompushadyBlitterPriorityDrawOrder)(
+				[Pipeline, RTV, Red, Green, Drawables, MaxInstances](FRHICommandListImmediate& RHICmdList)
+				{
+					for (UCompushadyRTV* Target : { RTV, Red, Green })
+					{
+						RHICmdList.Transition(FRHITransitionInfo(Target->GetTextureRHI(), ERHIAccess::Unknown, ERHIAccess::RTV));
+						FRHIRenderPassInfo Info(Target->GetTextureRHI(), ERenderTargetActions::Clear_Store);
+						RHICmdList.BeginRenderPass(Info, TEXT("FCompushadyBlitterTest_PriorityDrawOrder::Clear"));
+						RHICmdList.EndRenderPass();
+					}
+
+					RHICmdList.Transition(FRHITransitionInfo(Red->GetTextureRHI(), ERHIAccess::RTV, ERHIAccess::SRVGraphics));
+					RHICmdList.Transition(FRHITransitionInfo(Green->GetTextureRHI(), ERHIAccess::RTV, ERHIAccess::SRVGraphics));
+
+					Pipeline->Rasterize_RenderThread(TEXT("FCompushadyBlitterTest_PriorityDrawOrder"), RHICmdList, FIntRect(0, 0, 8, 8), RTV->GetTextureRHI(), Drawables, MaxInstances);
+				});
+
+			FlushRenderingCommands();
+
+			TArray<uint32> Output;
+			Output.AddZeroed(8 * 8);
+			RTV->MapTextureSliceAndExecuteSync([&Output](const void* Data, const int32 RowPitch)
+				{
+					CopyTextureData2D(Data, Output.GetData(), 8, EPixelFormat::PF_R8G8B8A8, RowPitch, 8 * sizeof(uint32));
+				}, 0);
+
+			return Output[4 * 8 + 4];
+		};
+
+	// single batch (instance order) and one draw per drawable (draw order)
+	for (const int32 MaxInstances : { Compushady::Blitter::MaxInstancesPerDraw, 1 })
+	{
+		TestEqual(FString::Printf(TEXT("Red on top (MaxInstances %d)"), MaxInstances), DrawAndReadPixel(1, 0, MaxInstances), 0xff0000ffU);
+		TestEqual(FString::Printf(TEXT("Green on top (MaxInstances %d)"), MaxInstances), DrawAndReadPixel(0, 1, MaxInstances), 0xff00ff00U);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_SharedTextureSlot, "Compushady.Blitter.SharedTextureSlot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_SharedTextureSlot::RunTest(const FString& Parameters)
+{
+	const TArray<int32> Priorities = { 0, 0, 0, 0 };
+	const TArray<UPTRINT> TextureKeys = { 100, 200, 100, 300 };
+
+	TArray<Compushady::Blitter::FCompushadyBlitterBatch> Batches;
+	Compushady::Blitter::BuildBatches(Priorities, TextureKeys, Batches);
+
+	if (!TestEqual(TEXT("Batches.Num()"), Batches.Num(), 1))
+	{
+		return true;
+	}
+
+	const TArray<int32> ExpectedSlots = { 0, 1, 0, 2 };
+	TestEqual(TEXT("TextureSlots"), Batches[0].TextureSlots, ExpectedSlots);
+	const TArray<int32> ExpectedTextureDrawables = { 0, 1, 3 };
+	TestEqual(TEXT("TextureDrawableIndices"), Batches[0].TextureDrawableIndices, ExpectedTextureDrawables);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_TextureLimit, "Compushady.Blitter.TextureLimit", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_TextureLimit::RunTest(const FString& Parameters)
+{
+	TArray<int32> Priorities;
+	TArray<UPTRINT> TextureKeys;
+	for (int32 Index = 0; Index < Compushady::Blitter::MaxTexturesPerDraw + 4; Index++)
+	{
+		Priorities.Add(0);
+		TextureKeys.Add(Index + 1);
+	}
+
+	TArray<Compushady::Blitter::FCompushadyBlitterBatch> Batches;
+	Compushady::Blitter::BuildBatches(Priorities, TextureKeys, Batches);
+
+	if (!TestEqual(TEXT("Batches.Num()"), Batches.Num(), 2))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("Batches[0].TextureDrawableIndices.Num()"), Batches[0].TextureDrawableIndices.Num(), Compushady::Blitter::MaxTexturesPerDraw);
+	TestEqual(TEXT("Batches[1].TextureDrawableIndices.Num()"), Batches[1].TextureDrawableIndices.Num(), 4);
+	TestEqual(TEXT("Batches[1].TextureSlots[0]"), Batches[1].TextureSlots[0], 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_InstanceLimit, "Compushady.Blitter.InstanceLimit", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_InstanceLimit::RunTest(const FString& Parameters)
+{
+	TArray<int32> Priorities;
+	TArray<UPTRINT> TextureKeys;
+	for (int32 Index = 0; Index < Compushady::Blitter::MaxInstancesPerDraw * 2 + 1; Index++)
+	{
+		Priorities.Add(0);
+		TextureKeys.Add(1);
+	}
+
+	TArray<Compushady::Blitter::FCompushadyBlitterBatch> Batches;
+	Compushady::Blitter::BuildBatches(Priorities, TextureKeys, Batches);
+
+	if (!TestEqual(TEXT("Batches.Num()"), Batches.Num(), 3))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("Batches[0].DrawableIndices.Num()"), Batches[0].DrawableIndices.Num(), Compushady::Blitter::MaxInstancesPerDraw);
+	TestEqual(TEXT("Batches[2].DrawableIndices.Num()"), Batches[2].DrawableIndices.Num(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBlitterTest_BatchingBenchmark, "Compushady.Blitter.BatchingBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBlitterTest_BatchingBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumDrawables = 1000;
+	constexpr int32 NumTextures = 8;
+	constexpr int32 NumIterations = 4;
+
+	FString ErrorMessages;
+	TSharedRef<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe> Pipeline = MakeShared<Compushady::Blitter::FCompushadyBlitterPipeline, ESPMode::ThreadSafe>();
+	if (!TestTrue(TEXT("Pipeline->Initialize"), Pipeline->Initialize(ErrorMessages)))
+	{
+		AddError(ErrorMessages);
+		return true;
+	}
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 1024, 1024, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	TArray<TStrongObjectPtr<UCompushadySRV>> Textures;
+	for (int32 TextureIndex = 0; TextureIndex < NumTextures; TextureIndex++)
+	{
+		Textures.Emplace(UCompushadyFunctionLibrary::CreateCompushadySRVTexture2D(TestName, 64, 64, EPixelFormat::PF_R8G8B8A8));
+	}
+
+	TArray<FCompushadyBlitterDrawable> Drawables;
+	FRandomStream RandomStream(17);
+	for (int32 DrawableIndex = 0; DrawableIndex < NumDrawables; DrawableIndex++)
+	{
+		FCompushadyBlitterDrawable Drawable;
+		Drawable.Texture = Textures[DrawableIndex % NumTextures]->GetTextureRHI();
+		const float X = RandomStream.FRand() * 0.9f;
+		const float Y = RandomStream.FRand() * 0.9f;
+		Drawable.Quad = FVector4(X, Y, X + 0.1f, Y + 0.1f);
+		Drawable.Priority = DrawableIndex % 4;
+		Drawables.Add(Drawable);
+	}
+
+	// unbatched (one draw per drawable) vs batched, the best of NumIterations runs is reported
+	const int32 MaxInstances[2] = { 1, Compushady::Blitter::MaxInstancesPerDraw };
+	int32 NumDraws[2] = {};
+	double SubmitMilliseconds[2] = { MAX_dbl, MAX_dbl };
+	double GPUMilliseconds[2] = { MAX_dbl, MAX_dbl };
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyBlitterBenchmark)(
+		[&](FRHICommandListImmediate& RHICmdList)
+		{
+			const FIntRect ViewRect(0, 0, 1024, 1024);
+			FTextureRHIRef RenderTarget = RTV->GetTextureRHI();
+
+			for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+			{
+				for (int32 RunIndex = 0; RunIndex < 2; RunIndex++)
+				{
+					FRenderQueryRHIRef BeginQuery = GSupportsTimestampRenderQueries ? RHICreateRenderQuery(RQT_AbsoluteTime) : nullptr;
+					FRenderQueryRHIRef EndQuery = GSupportsTimestampRenderQueries ? RHICreateRenderQuery(RQT_AbsoluteTime) : nullptr;
+
+					if (BeginQuery)
+					{
+						RHICmdList.EndRenderQuery(BeginQuery);
+					}
+
+					// recording plus translation of the commands by the RHI thread
+					const double StartTime = FPlatformTime::Seconds();
+					NumDraws[RunIndex] = Pipeline->Rasterize_RenderThread(TEXT("DoCompushadyBlitterBenchmark"), RHICmdList, ViewRect, RenderTarget, Drawables, MaxInstances[RunIndex]);
+					RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
+					SubmitMilliseconds[RunIndex] = FMath::Min(SubmitMilliseconds[RunIndex], (FPlatformTime::Seconds() - StartTime) * 1000);
+
+					if (EndQuery)
+					{
+						RHICmdList.EndRenderQuery(EndQuery);
+						RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
+
+						uint64 BeginMicroseconds = 0;
+						uint64 EndMicroseconds = 0;
+						if (RHIGetRenderQueryResult(BeginQuery, BeginMicroseconds, true) && RHIGetRenderQueryResult(EndQuery, EndMicroseconds, true))
+						{
+							GPUMilliseconds[RunIndex] = FMath::Min(GPUMilliseconds[RunIndex], (EndMicroseconds - BeginMicroseconds) / 1000.0);
+						}
+					}
+				}
+			}
+		});
+
+	FlushRenderingCommands();
+
+	TestEqual(TEXT("Unbatched NumDraws"), NumDraws[0], NumDrawables);
+	TestEqual(TEXT("Batched NumDraws"), NumDraws[1], FMath::DivideAndRoundUp(NumDrawables, Compushady::Blitter::MaxInstancesPerDraw));
+
+	AddInfo(FString::Printf(TEXT("unbatched: %d draws, submit %f ms"), NumDraws[0], SubmitMilliseconds[0]));
+	AddInfo(FString::Printf(TEXT("batched: %d draws, submit %f ms"), NumDraws[1], SubmitMilliseconds[1]));
+	if (GPUMilliseconds[0] < MAX_dbl && GPUMilliseconds[1] < MAX_dbl)
+	{
+		AddInfo(FString::Printf(TEXT("GPU: unbatched %f ms, batched %f ms"), GPUMilliseconds[0], GPUMilliseconds[1]));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyBrickedVolume.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace CompushadyBrickedVolumeTests
+{
+	static Compushady::Bricks::FCompushadyBrickLayout MakeLayout(const FIntVector& VolumeSize, const int32 BrickSize, const FIntVector& PoolSize)
+	{
+		Compushady::Bricks::FCompushadyBrickLayout Layout;
+		FString ErrorMessages;
+		Compushady::Bricks::FCompushadyBrickLayout::Create(VolumeSize, BrickSize, PoolSize, Layout, ErrorMessages);
+		return Layout;
+	}
+
+	static TArray<int32> GetLoadedBricks(const TArray<Compushady::Bricks::FCompushadyBrickLoad>& Loads)
+	{
+		TArray<int32> Bricks;
+		for (const Compushady::Bricks::FCompushadyBrickLoad& Load : Loads)
+		{
+			Bricks.Add(Load.Brick);
+		}
+		return Bricks;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBrickedVolumeTest_Layout, "Compushady.BrickedVolume.Layout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBrickedVolumeTest_Layout::RunTest(const FString& Parameters)
+{
+	Compushady::Bricks::FCompushadyBrickLayout Layout;
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("Create"), Compushady::Bricks::FCompushadyBrickLayout::Create(FIntVector(100, 64, 33), 32, FIntVector(4, 2, 3), Layout, ErrorMessages)))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("NumBricks"), Layout.NumBricks, FIntVector(4, 2, 2));
+	TestEqual(TEXT("GetNumBricks"), Layout.GetNumBricks(), 16);
+	TestEqual(TEXT("GetNumSlots"), Layout.GetNumSlots(), 24);
+
+	bool bRoundTrip = true;
+	for (int32 Brick = 0; Brick < Layout.GetNumBricks(); Brick++)
+	{
+		bRoundTrip &= Layout.GetBrickIndex(Layout.GetBrickCoordinates(Brick)) == Brick;
+	}
+	TestTrue(TEXT("Brick RoundTrip"), bRoundTrip);
+
+	const int32 LastBrick = Layout.GetBrickIndex(FIntVector(3, 1, 1));
+	TestEqual(TEXT("LastBrick"), LastBrick, 15);
+	TestEqual(TEXT("Origin"), Layout.GetBrickOrigin(LastBrick), FIntVector(96, 32, 32));
+	TestEqual(TEXT("Edge Extent"), Layout.GetBrickExtent(LastBrick), FIntVector(4, 32, 1));
+	TestEqual(TEXT("Full Extent"), Layout.GetBrickExtent(0), FIntVector(32, 32, 32));
+
+	TestEqual(TEXT("Slot Coordinates"), Layout.GetSlotCoordinates(13), FIntVector(1, 1, 1));
+	TestEqual(TEXT("Page Table Entry"), Layout.GetPageTableEntry(13), 0x80000000u | 1u | (1u << 10) | (1u << 20));
+	TestEqual(TEXT("Page Table Entry Last"), Layout.GetPageTableEntry(23), 0x80000000u | 3u | (1u << 10) | (2u << 20));
+
+	TestFalse(TEXT("Invalid Brick Size"), Compushady::Bricks::FCompushadyBrickLayout::Create(FIntVector(100, 64, 33), 0, FIntVector(4, 2, 3), Layout, ErrorMessages));
+	TestFalse(TEXT("Invalid Pool Size"), Compushady::Bricks::FCompushadyBrickLayout::Create(FIntVector(100, 64, 33), 32, FIntVector(2048, 1, 1), Layout, ErrorMessages));
+	TestFalse(TEXT("Invalid Volume Size"), Compushady::Bricks::FCompushadyBrickLayout::Create(FIntVector(100, 0, 33), 32, FIntVector(4, 2, 3), Layout, ErrorMessages));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBrickedVolumeTest_PageTable, "Compushady.BrickedVolume.PageTable", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBrickedVolumeTest_PageTable::RunTest(const FString& Parameters)
+{
+	const Compushady::Bricks::FCompushadyBrickLayout Layout = CompushadyBrickedVolumeTests::MakeLayout(FIntVector(64, 64, 64), 16, FIntVector(2, 2, 1));
+	Compushady::Bricks::FCompushadyBrickCache Cache(Layout);
+
+	TArray<Compushady::Bricks::FCompushadyBrickLoad> Loads;
+	Cache.ProcessRequests({ 5, 9, 5, 200 }, 0, Loads);
+
+	// duplicated and out of range requests are ignored
+	if (TestEqual(TEXT("Loads"), Loads.Num(), 2))
+	{
+		TestEqual(TEXT("Load 0 Brick"), Loads[0].Brick, 5);
+		TestEqual(TEXT("Load 0 Slot"), Loads[0].Slot, 0);
+		TestEqual(TEXT("Load 1 Slot"), Loads[1].Slot, 1);
+		TestEqual(TEXT("Load 1 Evicted"), Loads[1].EvictedBrick, static_cast<int32>(INDEX_NONE));
+	}
+
+	TestEqual(TEXT("Resident"), Cache.GetNumResident(), 2);
+	TestEqual(TEXT("Entry 5"), Cache.GetPageTableEntry(5), Layout.GetPageTableEntry(0));
+	TestEqual(TEXT("Entry 9"), Cache.GetPageTableEntry(9), Layout.GetPageTableEntry(1));
+	TestEqual(TEXT("Entry 0"), Cache.GetPageTableEntry(0), 0u);
+
+	// resident bricks are not loaded again
+	Loads.Empty();
+	Cache.ProcessRequests({ 9 }, 0, Loads);
+	TestEqual(TEXT("Resident Loads"), Loads.Num(), 0);
+
+	Cache.Release(9);
+	TestEqual(TEXT("Released Entry"), Cache.GetPageTableEntry(9), 0u);
+	TestEqual(TEXT("Released Resident"), Cache.GetNumResident(), 1);
+
+	// the released slot is reused first
+	Loads.Empty();
+	Cache.ProcessRequests({ 10 }, 0, Loads);
+	if (TestEqual(TEXT("Reuse Loads"), Loads.Num(), 1))
+	{
+		TestEqual(TEXT("Reused Slot"), Loads[0].Slot, 1);
+	}
+
+	// MaxLoads
+	Loads.Empty();
+	Cache.ProcessRequests({ 20, 21, 22 }, 1, Loads);
+	TestEqual(TEXT("MaxLoads"), Loads.Num(), 1);
+	TestEqual(TEXT("Dropped"), Cache.GetNumDropped(), static_cast<int64>(2));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBrickedVolumeTest_PageTableRegion, "Compushady.BrickedVolume.PageTableRegion", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBrickedVolumeTest_PageTableRegion::RunTest(const FString& Parameters)
+{
+	const Compushady::Bricks::FCompushadyBrickLayout Layout = CompushadyBrickedVolumeTests::MakeLayout(FIntVector(64, 64, 64), 16, FIntVector(2, 2, 1));
+	Compushady::Bricks::FCompushadyBrickCache Cache(Layout);
+
+	TArray<Compushady::Bricks::FCompushadyBrickLoad> Loads;
+	Cache.ProcessRequests({ 5, 22 }, 0, Loads);
+
+	FIntVector RegionOrigin;
+	FIntVector RegionSize;
+	TArray<uint32> Entries;
+	Cache.GetPageTableRegion({ 5, 22 }, RegionOrigin, RegionSize, Entries);
+
+	// bricks (1, 1, 0) and (2, 1, 1) are updated with a single 2x1x2 region
+	TestEqual(TEXT("RegionOrigin"), RegionOrigin, FIntVector(1, 1, 0));
+	TestEqual(TEXT("RegionSize"), RegionSize, FIntVector(2, 1, 2));
+	if (TestEqual(TEXT("Entries"), Entries.Num(), 4))
+	{
+		TestEqual(TEXT("Entry 5"), Entries[0], Layout.GetPageTableEntry(0));
+		TestEqual(TEXT("Entry 6"), Entries[1], 0u);
+		TestEqual(TEXT("Entry 21"), Entries[2], 0u);
+		TestEqual(TEXT("Entry 22"), Entries[3], Layout.GetPageTableEntry(1));
+	}
+
+	Cache.GetPageTableRegion({}, RegionOrigin, RegionSize, Entries);
+	TestEqual(TEXT("Empty Entries"), Entries.Num(), 0);
+	TestEqual(TEXT("Empty RegionSize"), RegionSize, FIntVector::ZeroValue);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBrickedVolumeTest_Eviction, "Compushady.BrickedVolume.Eviction", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBrickedVolumeTest_Eviction::RunTest(const FString& Parameters)
+{
+	const Compushady::Bricks::FCompushadyBrickLayout Layout = CompushadyBrickedVolumeTests::MakeLayout(FIntVector(64, 64, 64), 16, FIntVector(3, 1, 1));
+	Compushady::Bricks::FCompushadyBrickCache Cache(Layout);
+
+	TArray<Compushady::Bricks::FCompushadyBrickLoad> Loads;
+	Cache.ProcessRequests({ 1, 2, 3 }, 0, Loads);
+	TestTrue(TEXT("LRU"), Cache.GetLRUBricks() == TArray<int32>({ 1, 2, 3 }));
+
+	// touching 1 makes 2 the least recently used
+	Loads.Empty();
+	Cache.ProcessRequests({ 1 }, 0, Loads);
+	TestTrue(TEXT("LRU Touch"), Cache.GetLRUBricks() == TArray<int32>({ 2, 3, 1 }));
+
+	Loads.Empty();
+	Cache.ProcessRequests({ 4 }, 0, Loads);
+	if (TestEqual(TEXT("Eviction Loads"), Loads.Num(), 1))
+	{
+		TestEqual(TEXT("Evicted"), Loads[0].EvictedBrick, 2);
+		TestEqual(TEXT("Evicted Slot"), Loads[0].Slot, Cache.GetSlot(4));
+	}
+	TestEqual(TEXT("Evicted Entry"), Cache.GetPageTableEntry(2), 0u);
+	TestEqual(TEXT("Evicted Slot"), Cache.GetSlot(2), static_cast<int32>(INDEX_NONE));
+	TestEqual(TEXT("Resident"), Cache.GetNumResident(), 3);
+	TestEqual(TEXT("NumEvicted"), Cache.GetNumEvicted(), static_cast<int64>(1));
+
+	// resident bricks of the same batch are refreshed before loading, so 3 (not 1) is evicted
+	Loads.Empty();
+	Cache.ProcessRequests({ 5, 1, 4 }, 0, Loads);
+	if (TestEqual(TEXT("Batch Loads"), Loads.Num(), 1))
+	{
+		TestEqual(TEXT("Batch Evicted"), Loads[0].EvictedBrick, 3);
+	}
+
+	// more requests than slots: bricks of the same batch are never evicted
+	Loads.Empty();
+	Cache.ProcessRequests({ 10, 11, 12, 13, 14 }, 0, Loads);
+	TestTrue(TEXT("Overflow Loads"), CompushadyBrickedVolumeTests::GetLoadedBricks(Loads) == TArray<int32>({ 10, 11, 12 }));
+	TestEqual(TEXT("Overflow Dropped"), Cache.GetNumDropped(), static_cast<int64>(2));
+	TestEqual(TEXT("Overflow Resident"), Cache.GetNumResident(), 3);
+
+	// the page table is consistent with the slots
+	bool bConsistent = true;
+	for (int32 Brick = 0; Brick < Layout.GetNumBricks(); Brick++)
+	{
+		const int32 Slot = Cache.GetSlot(Brick);
+		bConsistent &= Slot == INDEX_NONE ? Cache.GetPageTableEntry(Brick) == 0 : (Cache.GetBrick(Slot) == Brick && Cache.GetPageTableEntry(Brick) == Layout.GetPageTableEntry(Slot));
+	}
+	TestTrue(TEXT("Consistent"), bConsistent);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyBrickedVolumeTest_Source, "Compushady.BrickedVolume.Source", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyBrickedVolumeTest_Source::RunTest(const FString& Parameters)
+{
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), "compushady_test_bricks.raw");
+	const FIntVector VolumeSize(10, 7, 5);
+	const int64 Offset = 13;
+
+	// big endian uint16, value = voxel index
+	TArray<uint8> Data;
+	Data.AddZeroed(Offset);
+	for (int32 Index = 0; Index < VolumeSize.X * VolumeSize.Y * VolumeSize.Z; Index++)
+	{
+		Data.Add(static_cast<uint8>(Index >> 8));
+		Data.Add(static_cast<uint8>(Index & 0xFF));
+	}
+	TestTrue(TEXT("SaveArrayToFile"), FFileHelper::SaveArrayToFile(Data, *Filename));
+
+	const Compushady::Bricks::FCompushadyBrickLayout Layout = CompushadyBrickedVolumeTests::MakeLayout(VolumeSize, 4, FIntVector(2, 2, 2));
+
+	FString ErrorMessages;
+	TSharedPtr<Compushady::Bricks::FCompushadyBrickSource> Source = Compushady::Bricks::FCompushadyBrickSource::Create(Filename, Offset, Layout, EPixelFormat::PF_R16_UINT, true, ErrorMessages);
+	if (TestTrue(TEXT("Source"), Source.IsValid()))
+	{
+		TestEqual(TEXT("BrickDataSize"), Source->GetBrickDataSize(), static_cast<int64>(4 * 4 * 4 * sizeof(uint16)));
+
+		for (const int32 Brick : { 0, Layout.GetBrickIndex(FIntVector(2, 1, 1)) })
+		{
+			TArray<uint16> Voxels;
+			Voxels.SetNumUninitialized(4 * 4 * 4);
+			if (!TestTrue(TEXT("ReadBrick"), Source->ReadBrick(Brick, reinterpret_cast<uint8*>(Voxels.GetData()), ErrorMessages)))
+			{
+				continue;
+			}
+
+			const FIntVector Origin = Layout.GetBrickOrigin(Brick);
+			bool bMatch = true;
+			for (int32 Z = 0; Z < 4; Z++)
+			{
+				for (int32 Y = 0; Y < 4; Y++)
+				{
+					for (int32 X = 0; X < 4; X++)
+					{
+						const FIntVector Voxel = Origin + FIntVector(X, Y, Z);
+						const bool bInside = Voxel.X < VolumeSize.X && Voxel.Y < VolumeSize.Y && Voxel.Z < VolumeSize.Z;
+						const uint16 Expected = bInside ? static_cast<uint16>((Voxel.Z * VolumeSize.Y + Voxel.Y) * VolumeSize.X + Voxel.X) : 0;
+						bMatch &= Voxels[(Z * 4 + Y) * 4 + X] == Expected;
+					}
+				}
+			}
+			TestTrue(FString::Printf(TEXT("Brick %d"), Brick), bMatch);
+		}
+	}
+
+	// the file is too small for the volume
+	const Compushady::Bricks::FCompushadyBrickLayout BigLayout = CompushadyBrickedVolumeTests::MakeLayout(FIntVector(100, 100, 100), 4, FIntVector(2, 2, 2));
+	TestFalse(TEXT("Too Small"), Compushady::Bricks::FCompushadyBrickSource::Create(Filename, Offset, BigLayout, EPixelFormat::PF_R16_UINT, true, ErrorMessages).IsValid());
+
+	Source.Reset();
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+#endif
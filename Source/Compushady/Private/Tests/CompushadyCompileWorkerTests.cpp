@@ -0,0 +1,250 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "Compushady.h"
+#include "CompushadyCompileWorker.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static Compushady::FCompushadyCompileJob CompushadyCompileWorkerTestJob()
+{
+	Compushady::FCompushadyCompileJob Job;
+	Job.Language = Compushady::ECompushadyCompileJobLanguage::HLSL;
+	Compushady::StringToShaderCode("[numthreads(1, 1, 1)] void main() {}", Job.ShaderCode);
+	Job.EntryPoint = "main";
+	Job.TargetProfile = "cs_6_0";
+	return Job;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_SerializeJob, "Compushady.CompileWorker.SerializeJob", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_SerializeJob::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileJob Job = CompushadyCompileWorkerTestJob();
+	Job.Language = Compushady::ECompushadyCompileJobLanguage::GLSL;
+	Job.bSPIRV = true;
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	TestTrue(TEXT("Write"), Job.Serialize(Writer));
+
+	Compushady::FCompushadyCompileJob LoadedJob;
+	FMemoryReader Reader(Data);
+	TestTrue(TEXT("Read"), LoadedJob.Serialize(Reader));
+
+	TestTrue(TEXT("Language"), LoadedJob.Language == Compushady::ECompushadyCompileJobLanguage::GLSL);
+	TestEqual(TEXT("ShaderCode"), LoadedJob.ShaderCode, Job.ShaderCode);
+	TestEqual(TEXT("EntryPoint"), LoadedJob.EntryPoint, Job.EntryPoint);
+	TestEqual(TEXT("TargetProfile"), LoadedJob.TargetProfile, Job.TargetProfile);
+	TestTrue(TEXT("bSPIRV"), LoadedJob.bSPIRV);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_SerializeCorrupted, "Compushady.CompileWorker.SerializeCorrupted", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_SerializeCorrupted::RunTest(const FString& Parameters)
+{
+	TArray<uint8> Data = { 0xde, 0xad, 0xbe, 0xef, 0x00 };
+
+	Compushady::FCompushadyCompileJobResult Result;
+	FMemoryReader Reader(Data);
+	TestFalse(TEXT("Read"), Result.Serialize(Reader));
+	TestFalse(TEXT("bSuccess"), Result.bSuccess);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_Compile, "Compushady.CompileWorker.Compile", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_Compile::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.bFallbackToInProcess = false;
+	// wait for the first launch
+	Config.AcquireTimeoutSeconds = Config.StartupTimeoutSeconds;
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	// the second job reuses the same process
+	for (int32 JobIndex = 0; JobIndex < 2; JobIndex++)
+	{
+		Compushady::FCompushadyCompileJobResult Result;
+		TestTrue(TEXT("Completed"), Pool.Compile(CompushadyCompileWorkerTestJob(), Result) == Compushady::ECompushadyCompileWorkerStatus::Completed);
+		TestTrue(TEXT("bSuccess"), Result.bSuccess);
+		TestTrue(TEXT("ByteCode"), Result.ByteCode.Num() > 0);
+	}
+
+	Compushady::FCompushadyCompileJob BrokenJob = CompushadyCompileWorkerTestJob();
+	Compushady::StringToShaderCode("[numthreads(1, 1, 1)] void main() { broken }", BrokenJob.ShaderCode);
+
+	Compushady::FCompushadyCompileJobResult Result;
+	TestTrue(TEXT("Completed"), Pool.Compile(BrokenJob, Result) == Compushady::ECompushadyCompileWorkerStatus::Completed);
+	TestFalse(TEXT("bSuccess"), Result.bSuccess);
+	TestFalse(TEXT("ErrorMessages"), Result.ErrorMessages.IsEmpty());
+
+	TestEqual(TEXT("NumLaunchedProcesses"), Pool.GetNumLaunchedProcesses(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_Crash, "Compushady.CompileWorker.Crash", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_Crash::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.ExtraArguments = "-SimulateCrash";
+	Config.AcquireTimeoutSeconds = Config.StartupTimeoutSeconds;
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	Compushady::FCompushadyCompileJobResult Result;
+	const Compushady::ECompushadyCompileWorkerStatus Status = Pool.Compile(CompushadyCompileWorkerTestJob(), Result);
+
+	TestTrue(TEXT("Crashed"), Status == Compushady::ECompushadyCompileWorkerStatus::Crashed);
+
+	// a crash must not be retried in-process
+	TArray<uint8> ByteCode;
+	FString ErrorMessages;
+	TestFalse(TEXT("CompileWithFallback"), Pool.CompileWithFallback(CompushadyCompileWorkerTestJob(), ByteCode, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "The shader compile worker crashed");
+	TestEqual(TEXT("NumLaunchedProcesses"), Pool.GetNumLaunchedProcesses(), 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_Timeout, "Compushady.CompileWorker.Timeout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_Timeout::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.TimeoutSeconds = 1;
+	Config.ExtraArguments = "-SimulateHang";
+	Config.AcquireTimeoutSeconds = Config.StartupTimeoutSeconds;
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	Compushady::FCompushadyCompileJobResult Result;
+	const Compushady::ECompushadyCompileWorkerStatus Status = Pool.Compile(CompushadyCompileWorkerTestJob(), Result);
+
+	TestTrue(TEXT("TimedOut"), Status == Compushady::ECompushadyCompileWorkerStatus::TimedOut);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_AcquireTimeout, "Compushady.CompileWorker.AcquireTimeout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_AcquireTimeout::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.TimeoutSeconds = 10;
+	Config.AcquireTimeoutSeconds = 1;
+	Config.ExtraArguments = "-SimulateHang";
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	// the launch does not block the caller
+	const double LaunchTime = FPlatformTime::Seconds();
+	Pool.LaunchWorkers();
+	TestTrue(TEXT("LaunchWorkers"), FPlatformTime::Seconds() - LaunchTime < Config.AcquireTimeoutSeconds);
+
+	while (Pool.GetNumReadyWorkers() == 0 && FPlatformTime::Seconds() - LaunchTime < Config.StartupTimeoutSeconds)
+	{
+		FPlatformProcess::Sleep(0.1f);
+	}
+
+	if (!TestEqual(TEXT("GetNumReadyWorkers"), Pool.GetNumReadyWorkers(), 1))
+	{
+		return true;
+	}
+
+	// the only worker hangs on this job
+	TFuture<Compushady::ECompushadyCompileWorkerStatus> HungJob = Async(EAsyncExecution::Thread, [&Pool]()
+		{
+			Compushady::FCompushadyCompileJobResult Result;
+			return Pool.Compile(CompushadyCompileWorkerTestJob(), Result);
+		});
+
+	while (Pool.GetNumReadyWorkers() > 0)
+	{
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	// no worker is ready in time, so the job is compiled in-process without waiting for the hung one
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<uint8> ByteCode;
+	FString ErrorMessages;
+	TestTrue(TEXT("CompileWithFallback"), Pool.CompileWithFallback(CompushadyCompileWorkerTestJob(), ByteCode, ErrorMessages));
+	TestTrue(TEXT("ByteCode"), ByteCode.Num() > 0);
+	TestTrue(TEXT("AcquireTimeout"), FPlatformTime::Seconds() - StartTime < Config.TimeoutSeconds);
+
+	TestTrue(TEXT("TimedOut"), HungJob.Get() == Compushady::ECompushadyCompileWorkerStatus::TimedOut);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_Enable, "Compushady.CompileWorker.Enable", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_Enable::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.Executable = "CompushadyMissingCompileWorker.exe";
+
+	const bool bWasEnabled = Compushady::CompileWorker::IsEnabled();
+
+	FString ErrorMessages;
+	TestFalse(TEXT("Enable"), Compushady::CompileWorker::Enable(Config, ErrorMessages));
+	TestFalse(TEXT("ErrorMessages"), ErrorMessages.IsEmpty());
+	TestEqual(TEXT("IsEnabled"), Compushady::CompileWorker::IsEnabled(), bWasEnabled);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_Fallback, "Compushady.CompileWorker.Fallback", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_Fallback::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.Executable = "CompushadyMissingCompileWorker.exe";
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	Compushady::FCompushadyCompileJobResult Result;
+	TestTrue(TEXT("Unavailable"), Pool.Compile(CompushadyCompileWorkerTestJob(), Result) == Compushady::ECompushadyCompileWorkerStatus::Unavailable);
+
+	TArray<uint8> ByteCode;
+	FString ErrorMessages;
+	TestTrue(TEXT("CompileWithFallback"), Pool.CompileWithFallback(CompushadyCompileWorkerTestJob(), ByteCode, ErrorMessages));
+	TestTrue(TEXT("ByteCode"), ByteCode.Num() > 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCompileWorkerTest_NoFallback, "Compushady.CompileWorker.NoFallback", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCompileWorkerTest_NoFallback::RunTest(const FString& Parameters)
+{
+	Compushady::FCompushadyCompileWorkerConfig Config;
+	Config.NumWorkers = 1;
+	Config.Executable = "CompushadyMissingCompileWorker.exe";
+	Config.bFallbackToInProcess = false;
+
+	Compushady::FCompushadyCompileWorkerPool Pool(Config);
+
+	TArray<uint8> ByteCode;
+	FString ErrorMessages;
+	TestFalse(TEXT("CompileWithFallback"), Pool.CompileWithFallback(CompushadyCompileWorkerTestJob(), ByteCode, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "No shader compile worker available");
+
+	return true;
+}
+
+#endif
@@ -120,4 +120,31 @@ bool FCompushadyCopyTest_SimpleUAVSync::RunTest(const FString& Parameters)
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyCopyTest_Version, "Compushady.Copy.Version", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyCopyTest_Version::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+
+	UCompushadyUAV* Source = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName, 8, EPixelFormat::PF_R32_FLOAT);
+	Source->ClearBufferWithFloatSync(17);
+
+	UCompushadySRV* Destination = UCompushadyFunctionLibrary::CreateCompushadySRVBuffer(TestName + "_", 8, EPixelFormat::PF_R32_FLOAT);
+
+	const int64 SourceVersion = Source->GetVersion();
+	const int64 DestinationVersion = Destination->GetVersion();
+
+	TestTrue(TEXT("CopyToBufferSync"), Source->CopyToBufferSync(Destination, 8, 0, 0, ErrorMessages));
+
+	// only the destination is written
+	TestEqual(TEXT("Source->GetVersion()"), Source->GetVersion(), SourceVersion);
+	TestEqual(TEXT("Destination->GetVersion()"), Destination->GetVersion(), DestinationVersion + 1);
+
+	// failed copies do not change the version
+	TestFalse(TEXT("CopyToBufferSync"), Source->CopyToBufferSync(Destination, 16, 0, 0, ErrorMessages));
+	TestEqual(TEXT("Destination->GetVersion()"), Destination->GetVersion(), DestinationVersion + 1);
+
+	return true;
+}
+
 #endif
@@ -159,5 +159,78 @@ bool FCompushadyDXCTest_Bindings::RunTest(const FString& Parameters)
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyDXCTest_RayQueryBindings, "Compushady.DXC.RayQueryBindings", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyDXCTest_RayQueryBindings::RunTest(const FString& Parameters)
+{
+	TArray<uint8> ByteCode;
+	Compushady::FCompushadyShaderResourceBindings ShaderBindings;
+	FIntVector ThreadGroupSize;
+	FString ErrorMessages;
+
+	TArray<uint8> ShaderCode;
+	Compushady::StringToShaderCode("RaytracingAccelerationStructure Scene; Texture2D<float4> Input0; RWTexture2D<float> Output0; [numthreads(8, 8, 1)] void main(uint3 tid : SV_DispatchThreadID) { RayDesc Ray; Ray.Origin = Input0[tid.xy].xyz; Ray.Direction = float3(0, 0, 1); Ray.TMin = 0.001; Ray.TMax = 10000; RayQuery<RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH> Query; Query.TraceRayInline(Scene, RAY_FLAG_NONE, 0xFF, Ray); Query.Proceed(); Output0[tid.xy] = Query.CommittedStatus() == COMMITTED_TRIANGLE_HIT ? 0 : 1; }", ShaderCode);
+
+	bool bSuccess = Compushady::CompileHLSL(ShaderCode, "main", "cs_6_5", ByteCode, ErrorMessages, false);
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+
+	bSuccess = Compushady::FixupDXIL(ByteCode, ShaderBindings, ThreadGroupSize, ErrorMessages);
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+
+	TestEqual(TEXT("Bindings.SRVs.Num()"), ShaderBindings.SRVs.Num(), 2);
+	TestEqual(TEXT("Bindings.UAVs.Num()"), ShaderBindings.UAVs.Num(), 1);
+
+	const Compushady::FCompushadyShaderResourceBinding* SceneBinding = ShaderBindings.SRVs.FindByPredicate([](const Compushady::FCompushadyShaderResourceBinding& Binding) { return Binding.Name == "Scene"; });
+	if (TestNotNull(TEXT("SceneBinding"), SceneBinding))
+	{
+		TestEqual(TEXT("SceneBinding->Type"), SceneBinding->Type, Compushady::ECompushadyShaderResourceType::RayTracingAccelerationStructure);
+	}
+
+	FCompushadyResourceBindings Bindings;
+	bSuccess = Compushady::Utils::CreateResourceBindings(ShaderBindings, Bindings, ErrorMessages);
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+	TestTrue(TEXT("Bindings.SRVsMap[\"Scene\"].bIsAccelerationStructure"), Bindings.SRVsMap["Scene"].bIsAccelerationStructure);
+	TestFalse(TEXT("Bindings.SRVsMap[\"Input0\"].bIsAccelerationStructure"), Bindings.SRVsMap["Input0"].bIsAccelerationStructure);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyDXCTest_RayQueryBindingsSPIRV, "Compushady.DXC.RayQueryBindingsSPIRV", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyDXCTest_RayQueryBindingsSPIRV::RunTest(const FString& Parameters)
+{
+	TArray<uint8> ByteCode;
+	Compushady::FCompushadyShaderResourceBindings ShaderBindings;
+	FIntVector ThreadGroupSize;
+	FString ErrorMessages;
+
+	TArray<uint8> ShaderCode;
+	Compushady::StringToShaderCode("RaytracingAccelerationStructure Scene; Texture2D<float4> Input0; RWTexture2D<float> Output0; [numthreads(8, 8, 1)] void main(uint3 tid : SV_DispatchThreadID) { RayDesc Ray; Ray.Origin = Input0[tid.xy].xyz; Ray.Direction = float3(0, 0, 1); Ray.TMin = 0.001; Ray.TMax = 10000; RayQuery<RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH> Query; Query.TraceRayInline(Scene, RAY_FLAG_NONE, 0xFF, Ray); Query.Proceed(); Output0[tid.xy] = Query.CommittedStatus() == COMMITTED_TRIANGLE_HIT ? 0 : 1; }", ShaderCode);
+
+	// SM 6.5 profiles enable the Vulkan 1.2 environment required by SPV_KHR_ray_query
+	bool bSuccess = Compushady::CompileHLSL(ShaderCode, "main", "cs_6_5", ByteCode, ErrorMessages, true);
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+
+	bSuccess = Compushady::FixupSPIRV(ByteCode, "cs_6_5", ShaderBindings, ThreadGroupSize, ErrorMessages);
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+
+	TestEqual(TEXT("ThreadGroupSize.X"), ThreadGroupSize.X, 8);
+	TestEqual(TEXT("Bindings.SRVs.Num()"), ShaderBindings.SRVs.Num(), 2);
+	TestEqual(TEXT("Bindings.UAVs.Num()"), ShaderBindings.UAVs.Num(), 1);
+
+	const Compushady::FCompushadyShaderResourceBinding* SceneBinding = ShaderBindings.SRVs.FindByPredicate([](const Compushady::FCompushadyShaderResourceBinding& Binding) { return Binding.Name == "Scene"; });
+	if (TestNotNull(TEXT("SceneBinding"), SceneBinding))
+	{
+		TestEqual(TEXT("SceneBinding->Type"), SceneBinding->Type, Compushady::ECompushadyShaderResourceType::RayTracingAccelerationStructure);
+	}
+
+	return true;
+}
+
 
 #endif
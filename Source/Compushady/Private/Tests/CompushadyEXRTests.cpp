@@ -0,0 +1,348 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyTypes.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/AutomationTest.h"
+
+namespace CompushadyEXRTests
+{
+	struct FEXRHeader
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		uint8 Compression = 0;
+		TArray<FString> ChannelNames;
+		TArray<int32> ChannelTypes;
+	};
+
+	template<typename T>
+	static bool ReadValue(const TArray64<uint8>& Data, int64& Offset, T& Value)
+	{
+		if (Offset + static_cast<int64>(sizeof(T)) > Data.Num())
+		{
+			return false;
+		}
+		FMemory::Memcpy(&Value, Data.GetData() + Offset, sizeof(T));
+		Offset += sizeof(T);
+		return true;
+	}
+
+	static bool ReadString(const TArray64<uint8>& Data, int64& Offset, FString& Value)
+	{
+		const int64 Start = Offset;
+		while (Offset < Data.Num() && Data[Offset] != 0)
+		{
+			Offset++;
+		}
+		if (Offset >= Data.Num())
+		{
+			return false;
+		}
+		Value = FString(static_cast<int32>(Offset - Start), reinterpret_cast<const ANSICHAR*>(Data.GetData() + Start));
+		Offset++;
+		return true;
+	}
+
+	/* pixels are decoded by the engine ImageWrapper, only the attributes it does not report are parsed here */
+	static bool ReadEXRHeader(const TArray64<uint8>& Data, FEXRHeader& Header)
+	{
+		int64 Offset = 0;
+		int32 Magic = 0;
+		int32 Version = 0;
+		if (!ReadValue(Data, Offset, Magic) || !ReadValue(Data, Offset, Version) || Magic != 20000630 || (Version & 0xff) != 2)
+		{
+			return false;
+		}
+
+		for (;;)
+		{
+			FString Name;
+			if (!ReadString(Data, Offset, Name))
+			{
+				return false;
+			}
+			if (Name.IsEmpty())
+			{
+				break;
+			}
+
+			FString Type;
+			int32 Size = 0;
+			if (!ReadString(Data, Offset, Type) || !ReadValue(Data, Offset, Size))
+			{
+				return false;
+			}
+
+			const int64 AttributeEnd = Offset + Size;
+			if (Name == "channels")
+			{
+				for (;;)
+				{
+					FString ChannelName;
+					if (!ReadString(Data, Offset, ChannelName))
+					{
+						return false;
+					}
+					if (ChannelName.IsEmpty())
+					{
+						break;
+					}
+					int32 ChannelType = 0;
+					if (!ReadValue(Data, Offset, ChannelType))
+					{
+						return false;
+					}
+					Header.ChannelNames.Add(ChannelName);
+					Header.ChannelTypes.Add(ChannelType);
+					Offset += sizeof(int32) * 3;
+				}
+			}
+			else if (Name == "compression")
+			{
+				ReadValue(Data, Offset, Header.Compression);
+			}
+			else if (Name == "dataWindow")
+			{
+				int32 Box[4];
+				for (int32 Index = 0; Index < 4; Index++)
+				{
+					ReadValue(Data, Offset, Box[Index]);
+				}
+				Header.Width = Box[2] - Box[0] + 1;
+				Header.Height = Box[3] - Box[1] + 1;
+			}
+			Offset = AttributeEnd;
+		}
+
+		return Header.Width > 0 && Header.Height > 0 && Header.ChannelNames.Num() > 0;
+	}
+
+	static bool DecodeEXR(const TArray64<uint8>& Data, int32& Width, int32& Height, TArray64<uint8>& Raw)
+	{
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Data.GetData(), Data.Num()))
+		{
+			return false;
+		}
+		Width = static_cast<int32>(ImageWrapper->GetWidth());
+		Height = static_cast<int32>(ImageWrapper->GetHeight());
+		return ImageWrapper->GetRaw(ERGBFormat::RGBAF, 32, Raw);
+	}
+
+	/* file values of ECompushadyEXRCompression */
+	static uint8 GetEXRCompression(const ECompushadyEXRCompression Compression)
+	{
+		switch (Compression)
+		{
+		case ECompushadyEXRCompression::ZIPS:
+			return 2;
+		case ECompushadyEXRCompression::ZIP:
+			return 3;
+		case ECompushadyEXRCompression::PIZ:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	/* values are multiples of 1/64 in a small range, so they survive the half conversion */
+	static TArray<uint8> MakePixels(const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const int32 Stride, const int32 NumComponents, const bool bHalf)
+	{
+		TArray<uint8> Pixels;
+		Pixels.AddZeroed(Stride * Height);
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				for (int32 Component = 0; Component < NumComponents; Component++)
+				{
+					const float Value = static_cast<float>((X * 3 + Y * 5 + Component * 7) % 256 - 128) / 64.0f;
+					uint8* Destination = Pixels.GetData() + Y * Stride + (X * NumComponents + Component) * (bHalf ? 2 : 4);
+					if (bHalf)
+					{
+						const FFloat16 Half(Value);
+						FMemory::Memcpy(Destination, &Half, sizeof(FFloat16));
+					}
+					else
+					{
+						FMemory::Memcpy(Destination, &Value, sizeof(float));
+					}
+				}
+			}
+		}
+		return Pixels;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyEXRTest_RoundTrip, "Compushady.EXR.RoundTrip", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyEXRTest_RoundTrip::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyEXRTests;
+
+	// more than one ZIP and PIZ block and a partial last one
+	constexpr int32 Width = 53;
+	constexpr int32 Height = 41;
+
+	struct FSourceFormat
+	{
+		EPixelFormat PixelFormat;
+		int32 NumComponents;
+		bool bHalf;
+	};
+
+	const FSourceFormat SourceFormats[] =
+	{
+		{ EPixelFormat::PF_FloatRGBA, 4, true },
+		{ EPixelFormat::PF_A32B32G32R32F, 4, false },
+		{ EPixelFormat::PF_R32G32B32F, 3, false },
+		{ EPixelFormat::PF_G16R16F, 2, true },
+		{ EPixelFormat::PF_G32R32F, 2, false },
+		{ EPixelFormat::PF_R16F, 1, true },
+		{ EPixelFormat::PF_R32_FLOAT, 1, false },
+	};
+
+	static const TCHAR* ChannelNames[] = { TEXT("R"), TEXT("G"), TEXT("B"), TEXT("A") };
+
+	for (const FSourceFormat& SourceFormat : SourceFormats)
+	{
+		const int32 Stride = Width * GPixelFormats[SourceFormat.PixelFormat].BlockBytes + 8;
+		const TArray<uint8> Pixels = MakePixels(Width, Height, SourceFormat.PixelFormat, Stride, SourceFormat.NumComponents, SourceFormat.bHalf);
+
+		TestTrue(*FString::Printf(TEXT("IsEXRPixelFormat %s"), GPixelFormats[SourceFormat.PixelFormat].Name), Compushady::Utils::IsEXRPixelFormat(SourceFormat.PixelFormat));
+
+		for (const ECompushadyEXRPixelType PixelType : { ECompushadyEXRPixelType::Half, ECompushadyEXRPixelType::Float })
+		{
+			for (const ECompushadyEXRCompression Compression : { ECompushadyEXRCompression::None, ECompushadyEXRCompression::ZIPS, ECompushadyEXRCompression::ZIP, ECompushadyEXRCompression::PIZ })
+			{
+				const FString Name = FString::Printf(TEXT("%s PixelType %d Compression %d"), GPixelFormats[SourceFormat.PixelFormat].Name, static_cast<int32>(PixelType), static_cast<int32>(Compression));
+
+				TArray64<uint8> EXRData;
+				FString ErrorMessages;
+				if (!TestTrue(*FString::Printf(TEXT("GenerateEXR %s"), *Name), Compushady::Utils::GenerateEXR(Pixels.GetData(), Stride, Width, Height, SourceFormat.PixelFormat, PixelType, Compression, EXRData, ErrorMessages)))
+				{
+					continue;
+				}
+
+				FEXRHeader Header;
+				if (!TestTrue(*FString::Printf(TEXT("ReadEXRHeader %s"), *Name), ReadEXRHeader(EXRData, Header)))
+				{
+					continue;
+				}
+
+				TestEqual(*FString::Printf(TEXT("Compression %s"), *Name), Header.Compression, GetEXRCompression(Compression));
+				if (!TestEqual(*FString::Printf(TEXT("Channels %s"), *Name), Header.ChannelNames.Num(), SourceFormat.NumComponents))
+				{
+					continue;
+				}
+
+				for (int32 Channel = 0; Channel < Header.ChannelNames.Num(); Channel++)
+				{
+					// channels are stored in alphabetical order
+					TestEqual(*FString::Printf(TEXT("ChannelName %s"), *Name), Header.ChannelNames[Channel], FString(ChannelNames[SourceFormat.NumComponents - 1 - Channel]));
+					TestEqual(*FString::Printf(TEXT("ChannelType %s"), *Name), Header.ChannelTypes[Channel], PixelType == ECompushadyEXRPixelType::Half ? 1 : 2);
+				}
+
+				int32 DecodedWidth = 0;
+				int32 DecodedHeight = 0;
+				TArray64<uint8> Raw;
+				if (!TestTrue(*FString::Printf(TEXT("DecodeEXR %s"), *Name), DecodeEXR(EXRData, DecodedWidth, DecodedHeight, Raw)))
+				{
+					continue;
+				}
+
+				TestEqual(*FString::Printf(TEXT("Width %s"), *Name), DecodedWidth, Width);
+				TestEqual(*FString::Printf(TEXT("Height %s"), *Name), DecodedHeight, Height);
+				if (!TestEqual(*FString::Printf(TEXT("Raw %s"), *Name), Raw.Num(), static_cast<int64>(Width) * Height * 4 * sizeof(float)))
+				{
+					continue;
+				}
+
+				// the missing channels are filled by the decoder, only the source ones are compared
+				const float* Decoded = reinterpret_cast<const float*>(Raw.GetData());
+				bool bMatch = true;
+				for (int32 Y = 0; Y < Height && bMatch; Y++)
+				{
+					for (int32 X = 0; X < Width && bMatch; X++)
+					{
+						for (int32 Component = 0; Component < SourceFormat.NumComponents; Component++)
+						{
+							const float Expected = static_cast<float>((X * 3 + Y * 5 + Component * 7) % 256 - 128) / 64.0f;
+							if (Decoded[(Y * Width + X) * 4 + Component] != Expected)
+							{
+								bMatch = false;
+								break;
+							}
+						}
+					}
+				}
+				TestTrue(*FString::Printf(TEXT("Pixels %s"), *Name), bMatch);
+			}
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyEXRTest_ImageWrapper, "Compushady.EXR.ImageWrapper", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyEXRTest_ImageWrapper::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyEXRTests;
+
+	constexpr int32 Width = 64;
+	constexpr int32 Height = 40;
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	// RGBA pixels of the same type with ZIP or no compression are encoded by the ImageWrapper itself
+	for (const EPixelFormat PixelFormat : { EPixelFormat::PF_FloatRGBA, EPixelFormat::PF_A32B32G32R32F })
+	{
+		const bool bHalf = PixelFormat == EPixelFormat::PF_FloatRGBA;
+		const int32 Stride = Width * GPixelFormats[PixelFormat].BlockBytes;
+		const TArray<uint8> Pixels = MakePixels(Width, Height, PixelFormat, Stride, 4, bHalf);
+
+		for (const ECompushadyEXRCompression Compression : { ECompushadyEXRCompression::None, ECompushadyEXRCompression::ZIP })
+		{
+			TArray64<uint8> EXRData;
+			FString ErrorMessages;
+			if (!TestTrue(TEXT("GenerateEXR"), Compushady::Utils::GenerateEXR(Pixels.GetData(), Stride, Width, Height, PixelFormat, bHalf ? ECompushadyEXRPixelType::Half : ECompushadyEXRPixelType::Float, Compression, EXRData, ErrorMessages)))
+			{
+				continue;
+			}
+
+			TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
+			if (!TestTrue(TEXT("SetRaw"), ImageWrapper.IsValid() && ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num(), Width, Height, ERGBFormat::RGBAF, bHalf ? 16 : 32)))
+			{
+				continue;
+			}
+
+			const TArray64<uint8> Expected = ImageWrapper->GetCompressed(static_cast<int32>(Compression == ECompushadyEXRCompression::None ? EImageCompressionQuality::Uncompressed : EImageCompressionQuality::Default));
+			TestTrue(TEXT("ImageWrapper output"), EXRData == Expected);
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyEXRTest_InvalidFormat, "Compushady.EXR.InvalidFormat", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyEXRTest_InvalidFormat::RunTest(const FString& Parameters)
+{
+	TArray<uint8> Pixels;
+	Pixels.AddZeroed(8 * 8 * 4);
+
+	TArray64<uint8> EXRData;
+	FString ErrorMessages;
+	TestFalse(TEXT("IsEXRPixelFormat"), Compushady::Utils::IsEXRPixelFormat(EPixelFormat::PF_R8G8B8A8));
+	TestFalse(TEXT("GenerateEXR (R8G8B8A8)"), Compushady::Utils::GenerateEXR(Pixels.GetData(), 32, 8, 8, EPixelFormat::PF_R8G8B8A8, ECompushadyEXRPixelType::Half, ECompushadyEXRCompression::ZIP, EXRData, ErrorMessages));
+	TestFalse(TEXT("ErrorMessages"), ErrorMessages.IsEmpty());
+	TestFalse(TEXT("GenerateEXR (empty)"), Compushady::Utils::GenerateEXR(Pixels.GetData(), 16, 0, 8, EPixelFormat::PF_R32_FLOAT, ECompushadyEXRPixelType::Float, ECompushadyEXRCompression::None, EXRData, ErrorMessages));
+
+	return true;
+}
+
+#endif
@@ -375,4 +375,21 @@ bool FCompushadyHLSLTest_RWBufferBytesThreeOutputsWithDoubleConfigAndSRV::RunTes
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyHLSLTest_TargetProfile, "Compushady.HLSL.TargetProfile", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyHLSLTest_TargetProfile::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString Code = "RWTexture2D<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.xy] = tid.x; }";
+
+	UCompushadyCompute* Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code, ErrorMessages, "main", "cs_6_5");
+	TestNotNull(TEXT("Compute"), Compute);
+
+	Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code, ErrorMessages, "main", "ps_6_0");
+	TestNull(TEXT("Compute"), Compute);
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "Invalid TargetProfile ps_6_0 for a Compute Shader (expected cs_6_x)");
+
+	return true;
+}
+
 #endif
@@ -0,0 +1,307 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyImageExporter.h"
+#include "HAL/FileManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace CompushadyImageExporterTests
+{
+	static Compushady::Image::FCompushadyImageExportFrame MakeFrame(const FString& Filename, const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const int32 Padding = 0)
+	{
+		Compushady::Image::FCompushadyImageExportFrame Frame;
+		Frame.Filename = Filename;
+		Frame.Width = Width;
+		Frame.Height = Height;
+		Frame.PixelFormat = PixelFormat;
+		Frame.Stride = Width * GPixelFormats[PixelFormat].BlockBytes + Padding;
+		Frame.Pixels.AddZeroed(static_cast<int64>(Frame.Stride) * Height);
+		return Frame;
+	}
+
+	static bool DecodeFile(const FString& Filename, const EImageFormat ImageFormat, const ERGBFormat RGBFormat, const int32 BitDepth, TArray64<uint8>& OutRaw, FIntPoint& OutSize)
+	{
+		TArray<uint8> FileData;
+		if (!FFileHelper::LoadFileToArray(FileData, *Filename))
+		{
+			return false;
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(ImageFormat);
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num()))
+		{
+			return false;
+		}
+
+		OutSize = FIntPoint(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+		return ImageWrapper->GetRaw(RGBFormat, BitDepth, OutRaw);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_PNG, "Compushady.ImageExporter.PNG", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_PNG::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyImageExporterTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyImageExporterTest.png"));
+
+	TSharedPtr<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue = MakeShared<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe>(ECompushadyImageFormat::PNG, 4, ECompushadyImageExportPolicy::Drop);
+
+	// padded rows must be repacked
+	Compushady::Image::FCompushadyImageExportFrame Frame = MakeFrame(Filename, 3, 2, EPixelFormat::PF_B8G8R8A8, 4);
+	for (int32 Y = 0; Y < Frame.Height; Y++)
+	{
+		for (int32 X = 0; X < Frame.Width; X++)
+		{
+			uint8* Pixel = Frame.Pixels.GetData() + Y * Frame.Stride + X * 4;
+			Pixel[0] = X * 10; // B
+			Pixel[1] = Y * 20; // G
+			Pixel[2] = 200; // R
+			Pixel[3] = 255;
+		}
+	}
+
+	uint64 Sequence = 0;
+	TestTrue(TEXT("Acquire"), Queue->Acquire(Sequence));
+	Queue->Submit(Sequence, MoveTemp(Frame));
+	Queue->Flush();
+
+	const FCompushadyImageExporterStats Stats = Queue->GetStats();
+	TestEqual(TEXT("Stats.WrittenFrames"), Stats.WrittenFrames, 1LL);
+	TestEqual(TEXT("Stats.InFlightFrames"), Stats.InFlightFrames, 0);
+
+	TArray64<uint8> Raw;
+	FIntPoint Size;
+	if (!TestTrue(TEXT("DecodeFile"), DecodeFile(Filename, EImageFormat::PNG, ERGBFormat::RGBA, 8, Raw, Size)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("Size"), Size, FIntPoint(3, 2));
+	if (TestEqual(TEXT("Raw.Num()"), Raw.Num(), 3LL * 2 * 4))
+	{
+		// second row, third pixel
+		TestEqual(TEXT("R"), Raw[20], static_cast<uint8>(200));
+		TestEqual(TEXT("G"), Raw[21], static_cast<uint8>(20));
+		TestEqual(TEXT("B"), Raw[22], static_cast<uint8>(20));
+		TestEqual(TEXT("A"), Raw[23], static_cast<uint8>(255));
+	}
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_TIFF, "Compushady.ImageExporter.TIFF", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_TIFF::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyImageExporterTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyImageExporterTest.tiff"));
+
+	TSharedPtr<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue = MakeShared<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe>(ECompushadyImageFormat::TIFF, 4, ECompushadyImageExportPolicy::Drop);
+
+	float Expected[16];
+	for (int32 Index = 0; Index < 16; Index++)
+	{
+		Expected[Index] = Index * 0.5f;
+	}
+
+	Compushady::Image::FCompushadyImageExportFrame Frame = MakeFrame(Filename, 4, 4, EPixelFormat::PF_R32_FLOAT);
+	FMemory::Memcpy(Frame.Pixels.GetData(), Expected, sizeof(Expected));
+
+	uint64 Sequence = 0;
+	TestTrue(TEXT("Acquire"), Queue->Acquire(Sequence));
+	Queue->Submit(Sequence, MoveTemp(Frame));
+	Queue->Flush();
+
+	TArray<uint8> FileData;
+	if (!TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("Stats.WrittenBytes"), Queue->GetStats().WrittenBytes, static_cast<int64>(FileData.Num()));
+	TestTrue(TEXT("Header"), FileData.Num() > 8 && FileData[0] == 'I' && FileData[1] == 'I' && FileData[2] == 42 && FileData[3] == 0);
+
+	// the strip is stored uncompressed
+	bool bFound = false;
+	for (int32 Offset = 0; Offset + static_cast<int32>(sizeof(Expected)) <= FileData.Num(); Offset++)
+	{
+		if (FMemory::Memcmp(FileData.GetData() + Offset, Expected, sizeof(Expected)) == 0)
+		{
+			bFound = true;
+			break;
+		}
+	}
+	TestTrue(TEXT("Pixels"), bFound);
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_EXR, "Compushady.ImageExporter.EXR", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_EXR::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyImageExporterTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyImageExporterTest.exr"));
+
+	TSharedPtr<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue = MakeShared<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe>(ECompushadyImageFormat::EXR, 4, ECompushadyImageExportPolicy::Drop);
+
+	Compushady::Image::FCompushadyImageExportFrame Frame = MakeFrame(Filename, 2, 2, EPixelFormat::PF_A32B32G32R32F);
+	FLinearColor* Pixels = reinterpret_cast<FLinearColor*>(Frame.Pixels.GetData());
+	Pixels[0] = FLinearColor(0, 0.5f, 1, 1);
+	Pixels[3] = FLinearColor(4, 8, 16, 0.25f);
+
+	uint64 Sequence = 0;
+	TestTrue(TEXT("Acquire"), Queue->Acquire(Sequence));
+	Queue->Submit(Sequence, MoveTemp(Frame));
+	Queue->Flush();
+
+	TArray64<uint8> Raw;
+	FIntPoint Size;
+	if (!TestTrue(TEXT("DecodeFile"), DecodeFile(Filename, EImageFormat::EXR, ERGBFormat::RGBAF, 32, Raw, Size)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("Size"), Size, FIntPoint(2, 2));
+	if (TestEqual(TEXT("Raw.Num()"), Raw.Num(), static_cast<int64>(4 * sizeof(FLinearColor))))
+	{
+		const FLinearColor* Decoded = reinterpret_cast<const FLinearColor*>(Raw.GetData());
+		TestEqual(TEXT("Decoded[0]"), Decoded[0], FLinearColor(0, 0.5f, 1, 1));
+		TestEqual(TEXT("Decoded[3]"), Decoded[3], FLinearColor(4, 8, 16, 0.25f));
+	}
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_Sequence, "Compushady.ImageExporter.Sequence", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_Sequence::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyImageExporterTests;
+
+	constexpr int32 NumFrames = 16;
+
+	// the same file is written by every frame, so the last one wins only if the writes are ordered
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyImageExporterTestSequence.tiff"));
+
+	TSharedPtr<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue = MakeShared<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe>(ECompushadyImageFormat::TIFF, 4, ECompushadyImageExportPolicy::Block);
+
+	for (int32 Index = 0; Index < NumFrames; Index++)
+	{
+		// larger images first, so that they take longer to encode
+		const int32 Width = 512 - Index * 16;
+		Compushady::Image::FCompushadyImageExportFrame Frame = MakeFrame(Filename, Width, 64, EPixelFormat::PF_R8G8B8A8);
+		uint64 Sequence = 0;
+		TestTrue(TEXT("Acquire"), Queue->Acquire(Sequence));
+		TestTrue(TEXT("NumInFlight"), Queue->NumInFlight() <= 4);
+		Queue->Submit(Sequence, MoveTemp(Frame));
+	}
+
+	Queue->Flush();
+
+	const FCompushadyImageExporterStats Stats = Queue->GetStats();
+	TestEqual(TEXT("Stats.WrittenFrames"), Stats.WrittenFrames, static_cast<int64>(NumFrames));
+	TestEqual(TEXT("Stats.DroppedFrames"), Stats.DroppedFrames, 0LL);
+	TestTrue(TEXT("Stats.PeakInFlightFrames"), Stats.PeakInFlightFrames <= 4);
+
+	const Compushady::Image::FCompushadyImageExportFrame LastFrame = MakeFrame(Filename, 512 - (NumFrames - 1) * 16, 64, EPixelFormat::PF_R8G8B8A8);
+	TArray<uint8> Expected;
+	Compushady::Utils::GenerateTIFF(LastFrame.Pixels.GetData(), LastFrame.Stride, LastFrame.Width, LastFrame.Height, LastFrame.PixelFormat, "", Expected);
+
+	TArray<uint8> FileData;
+	TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename));
+	TestTrue(TEXT("Last frame"), FileData == Expected);
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_DropPolicy, "Compushady.ImageExporter.DropPolicy", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_DropPolicy::RunTest(const FString& Parameters)
+{
+	Compushady::Image::FCompushadyImageExportQueue Queue(ECompushadyImageFormat::PNG, 2, ECompushadyImageExportPolicy::Drop);
+
+	uint64 Sequences[3];
+	TestTrue(TEXT("Acquire 0"), Queue.Acquire(Sequences[0]));
+	TestTrue(TEXT("Acquire 1"), Queue.Acquire(Sequences[1]));
+	uint64 FullSequence = 0;
+	TestFalse(TEXT("Acquire (full)"), Queue.Acquire(FullSequence));
+
+	Queue.Cancel(Sequences[0]);
+	TestTrue(TEXT("Acquire (released)"), Queue.Acquire(Sequences[2]));
+
+	const FCompushadyImageExporterStats Stats = Queue.GetStats();
+	TestEqual(TEXT("Stats.InFlightFrames"), Stats.InFlightFrames, 2);
+	TestEqual(TEXT("Stats.PeakInFlightFrames"), Stats.PeakInFlightFrames, 2);
+	// the failed Acquire and the Cancel
+	TestEqual(TEXT("Stats.DroppedFrames"), Stats.DroppedFrames, 2LL);
+
+	TestFalse(TEXT("IsSupportedPixelFormat (PNG float)"), Compushady::Image::IsSupportedPixelFormat(ECompushadyImageFormat::PNG, EPixelFormat::PF_A32B32G32R32F));
+	TestTrue(TEXT("IsSupportedPixelFormat (EXR float)"), Compushady::Image::IsSupportedPixelFormat(ECompushadyImageFormat::EXR, EPixelFormat::PF_A32B32G32R32F));
+	TestFalse(TEXT("IsSupportedPixelFormat (TIFF BC1)"), Compushady::Image::IsSupportedPixelFormat(ECompushadyImageFormat::TIFF, EPixelFormat::PF_DXT1));
+
+	Queue.Cancel(Sequences[1]);
+	Queue.Cancel(Sequences[2]);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyImageExporterTest_Tick, "Compushady.ImageExporter.Tick", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyImageExporterTest_Tick::RunTest(const FString& Parameters)
+{
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyImageExporterTestTick.png"));
+
+	UCompushadyImageExporter* ImageExporter = NewObject<UCompushadyImageExporter>();
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("Initialize"), ImageExporter->Initialize(ECompushadyImageFormat::PNG, ErrorMessages)))
+	{
+		return false;
+	}
+
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D("ImageExporterTick", 8, 8, EPixelFormat::PF_B8G8R8A8);
+	if (!TestNotNull(TEXT("UAV"), UAV))
+	{
+		return false;
+	}
+
+	TestTrue(TEXT("ExportTexture"), ImageExporter->ExportTexture(UAV, Filename, ErrorMessages));
+	TestTrue(TEXT("IsTickable"), ImageExporter->IsTickable());
+
+	// no more exports and no Flush, only the tick completes the readback
+	const double StartTime = FPlatformTime::Seconds();
+	while (ImageExporter->IsTickable() && FPlatformTime::Seconds() - StartTime < 10.0)
+	{
+		ImageExporter->Tick(0);
+		FlushRenderingCommands();
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	TestFalse(TEXT("IsTickable (written)"), ImageExporter->IsTickable());
+	TestEqual(TEXT("Stats.WrittenFrames"), ImageExporter->GetStats().WrittenFrames, 1LL);
+	TestTrue(TEXT("FileExists"), IFileManager::Get().FileExists(*Filename));
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,191 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyMips.h"
+#include "Misc/AutomationTest.h"
+
+namespace CompushadyMipsTests
+{
+	static TArray<FLinearColor> MakePixels(const FIntVector& Size, TFunction<float(const int32, const int32, const int32)> Generator)
+	{
+		TArray<FLinearColor> Pixels;
+		for (int32 Z = 0; Z < Size.Z; Z++)
+		{
+			for (int32 Y = 0; Y < Size.Y; Y++)
+			{
+				for (int32 X = 0; X < Size.X; X++)
+				{
+					const float Value = Generator(X, Y, Z);
+					Pixels.Add(FLinearColor(Value, Value, Value, Value));
+				}
+			}
+		}
+		return Pixels;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyMipsTest_Dimensions, "Compushady.Mips.Dimensions", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyMipsTest_Dimensions::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("1x1"), Compushady::Mips::GetNumMips(FIntVector(1, 1, 1)), 1);
+	TestEqual(TEXT("5x3"), Compushady::Mips::GetNumMips(FIntVector(5, 3, 1)), 3);
+	TestEqual(TEXT("1920x1080"), Compushady::Mips::GetNumMips(FIntVector(1920, 1080, 1)), 11);
+	TestEqual(TEXT("4096x4096"), Compushady::Mips::GetNumMips(FIntVector(4096, 4096, 1)), 13);
+	TestEqual(TEXT("7x4x9"), Compushady::Mips::GetNumMips(FIntVector(7, 4, 9)), 4);
+
+	TestEqual(TEXT("5x3 Mip 1"), Compushady::Mips::GetMipSize(FIntVector(5, 3, 1), 1), FIntVector(2, 1, 1));
+	TestEqual(TEXT("5x3 Mip 2"), Compushady::Mips::GetMipSize(FIntVector(5, 3, 1), 2), FIntVector(1, 1, 1));
+	TestEqual(TEXT("7x4x9 Mip 2"), Compushady::Mips::GetMipSize(FIntVector(7, 4, 9), 2), FIntVector(1, 1, 2));
+	TestEqual(TEXT("1920x1080 Mip 4"), Compushady::Mips::GetMipSize(FIntVector(1920, 1080, 1), 4), FIntVector(120, 67, 1));
+
+	TestEqual(TEXT("Full Chain"), Compushady::Mips::ClampNumMips(FIntVector(5, 3, 1), 0), 3);
+	TestEqual(TEXT("Clamped Chain"), Compushady::Mips::ClampNumMips(FIntVector(5, 3, 1), 10), 3);
+	TestEqual(TEXT("Partial Chain"), Compushady::Mips::ClampNumMips(FIntVector(5, 3, 1), 2), 2);
+
+	const FIntVector Sizes[] = { FIntVector(1, 1, 1), FIntVector(2, 1, 1), FIntVector(3, 7, 1), FIntVector(33, 17, 1), FIntVector(1000, 1, 1), FIntVector(5, 9, 31) };
+	for (const FIntVector& Size : Sizes)
+	{
+		const int32 NumMips = Compushady::Mips::GetNumMips(Size);
+		TestEqual(*FString::Printf(TEXT("%s Last Mip"), *Size.ToString()), Compushady::Mips::GetMipSize(Size, NumMips - 1), FIntVector(1, 1, 1));
+		if (NumMips > 1)
+		{
+			TestNotEqual(*FString::Printf(TEXT("%s Previous Mip"), *Size.ToString()), Compushady::Mips::GetMipSize(Size, NumMips - 2), FIntVector(1, 1, 1));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyMipsTest_Dispatches, "Compushady.Mips.Dispatches", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyMipsTest_Dispatches::RunTest(const FString& Parameters)
+{
+	TestEqual(TEXT("4096 Single Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(4096, 4096, 1), false, 0, 13, ECompushadyMipFilter::Box), 12);
+	TestEqual(TEXT("4096 Done"), Compushady::Mips::GetNumDispatchMips(FIntVector(4096, 4096, 1), false, 12, 13, ECompushadyMipFilter::Box), 0);
+
+	// mip6 of 8192 does not fit in the last group tile
+	TestEqual(TEXT("8192 First Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(8192, 8192, 1), false, 0, 14, ECompushadyMipFilter::Max), 6);
+	TestEqual(TEXT("8192 Second Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(8192, 8192, 1), false, 6, 14, ECompushadyMipFilter::Max), 7);
+
+	// 240x135 is the first odd parent
+	TestEqual(TEXT("1920x1080 First Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(1920, 1080, 1), false, 0, 11, ECompushadyMipFilter::Min), 3);
+	TestEqual(TEXT("1920x1080 Odd Parent"), Compushady::Mips::GetNumDispatchMips(FIntVector(1920, 1080, 1), false, 3, 11, ECompushadyMipFilter::Min), 1);
+	TestEqual(TEXT("1920x1080 30x16"), Compushady::Mips::GetNumDispatchMips(FIntVector(1920, 1080, 1), false, 5, 11, ECompushadyMipFilter::Min), 2);
+
+	TestEqual(TEXT("5x3"), Compushady::Mips::GetNumDispatchMips(FIntVector(5, 3, 1), false, 0, 3, ECompushadyMipFilter::Box), 2);
+	TestEqual(TEXT("Kaiser"), Compushady::Mips::GetNumDispatchMips(FIntVector(4096, 4096, 1), false, 0, 13, ECompushadyMipFilter::Kaiser), 1);
+
+	TestEqual(TEXT("Volume First Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(64, 64, 64), true, 0, 7, ECompushadyMipFilter::Box), 4);
+	TestEqual(TEXT("Volume Second Dispatch"), Compushady::Mips::GetNumDispatchMips(FIntVector(64, 64, 64), true, 4, 7, ECompushadyMipFilter::Box), 2);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyMipsTest_Filters, "Compushady.Mips.Filters", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyMipsTest_Filters::RunTest(const FString& Parameters)
+{
+	const FIntVector Size(5, 3, 1);
+	const TArray<FLinearColor> Pixels = CompushadyMipsTests::MakePixels(Size, [](const int32 X, const int32 Y, const int32 Z) { return static_cast<float>(X + Y * 10); });
+
+	TArray<FLinearColor> Output;
+	FIntVector OutputSize;
+	if (!TestTrue(TEXT("Box"), Compushady::Mips::Downsample(Pixels, Size, ECompushadyMipFilter::Box, Output, OutputSize)))
+	{
+		return false;
+	}
+
+	// the last column covers 3 texels, the only row covers all of them
+	TestEqual(TEXT("Box Size"), OutputSize, FIntVector(2, 1, 1));
+	TestEqual(TEXT("Box First"), Output[0].R, 10.5f, 1e-5f);
+	TestEqual(TEXT("Box Last"), Output[1].R, 13.0f, 1e-5f);
+
+	Compushady::Mips::Downsample(Pixels, Size, ECompushadyMipFilter::Min, Output, OutputSize);
+	TestEqual(TEXT("Min First"), Output[0].R, 0.0f);
+	TestEqual(TEXT("Min Last"), Output[1].R, 2.0f);
+
+	Compushady::Mips::Downsample(Pixels, Size, ECompushadyMipFilter::Max, Output, OutputSize);
+	TestEqual(TEXT("Max First"), Output[0].R, 21.0f);
+	TestEqual(TEXT("Max Last"), Output[1].R, 24.0f);
+
+	// every texel of odd sized parents must be covered by a child texel (conservative pyramids)
+	const FIntVector OddSize(7, 5, 3);
+	FRandomStream RandomStream(17);
+	const TArray<FLinearColor> RandomPixels = CompushadyMipsTests::MakePixels(OddSize, [&RandomStream](const int32 X, const int32 Y, const int32 Z) { return RandomStream.FRand(); });
+
+	TArray<FLinearColor> MinOutput;
+	TArray<FLinearColor> MaxOutput;
+	Compushady::Mips::Downsample(RandomPixels, OddSize, ECompushadyMipFilter::Min, MinOutput, OutputSize);
+	Compushady::Mips::Downsample(RandomPixels, OddSize, ECompushadyMipFilter::Max, MaxOutput, OutputSize);
+	TestEqual(TEXT("Odd Size"), OutputSize, FIntVector(3, 2, 1));
+
+	bool bConservative = true;
+	for (int32 Z = 0; Z < OddSize.Z; Z++)
+	{
+		for (int32 Y = 0; Y < OddSize.Y; Y++)
+		{
+			for (int32 X = 0; X < OddSize.X; X++)
+			{
+				const int32 Child = (FMath::Min(Z / 2, OutputSize.Z - 1) * OutputSize.Y + FMath::Min(Y / 2, OutputSize.Y - 1)) * OutputSize.X + FMath::Min(X / 2, OutputSize.X - 1);
+				const float Value = RandomPixels[(Z * OddSize.Y + Y) * OddSize.X + X].R;
+				bConservative &= MinOutput[Child].R <= Value && MaxOutput[Child].R >= Value;
+			}
+		}
+	}
+	TestTrue(TEXT("Conservative"), bConservative);
+
+	const TArray<FLinearColor> Volume = CompushadyMipsTests::MakePixels(FIntVector(2, 2, 2), [](const int32 X, const int32 Y, const int32 Z) { return static_cast<float>(X + Y * 2 + Z * 4); });
+	Compushady::Mips::Downsample(Volume, FIntVector(2, 2, 2), ECompushadyMipFilter::Box, Output, OutputSize);
+	TestEqual(TEXT("Volume Size"), OutputSize, FIntVector(1, 1, 1));
+	TestEqual(TEXT("Volume Box"), Output[0].R, 3.5f, 1e-5f);
+
+	TestFalse(TEXT("Invalid Pixels"), Compushady::Mips::Downsample(Pixels, FIntVector(4, 3, 1), ECompushadyMipFilter::Box, Output, OutputSize));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyMipsTest_Kaiser, "Compushady.Mips.Kaiser", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyMipsTest_Kaiser::RunTest(const FString& Parameters)
+{
+	const FVector2f Weights = Compushady::Mips::GetKaiserWeights();
+	TestEqual(TEXT("Normalized"), (Weights.X + Weights.Y) * 2, 1.0f, 1e-5f);
+	TestTrue(TEXT("Positive Outer"), Weights.X > 0);
+	TestTrue(TEXT("Inner Bigger"), Weights.Y > Weights.X);
+
+	TArray<FLinearColor> Output;
+	FIntVector OutputSize;
+
+	const TArray<FLinearColor> Constant = CompushadyMipsTests::MakePixels(FIntVector(6, 5, 1), [](const int32 X, const int32 Y, const int32 Z) { return 0.25f; });
+	Compushady::Mips::Downsample(Constant, FIntVector(6, 5, 1), ECompushadyMipFilter::Kaiser, Output, OutputSize);
+	TestEqual(TEXT("Constant Size"), OutputSize, FIntVector(3, 2, 1));
+	bool bConstant = true;
+	for (const FLinearColor& Color : Output)
+	{
+		bConstant &= FMath::IsNearlyEqual(Color.R, 0.25f, 1e-5f) && FMath::IsNearlyEqual(Color.A, 0.25f, 1e-5f);
+	}
+	TestTrue(TEXT("Constant"), bConstant);
+
+	// the outer taps are clamped to the edges, so each texel gets half of the weight
+	const TArray<FLinearColor> Pair = CompushadyMipsTests::MakePixels(FIntVector(2, 1, 1), [](const int32 X, const int32 Y, const int32 Z) { return X == 0 ? 0.2f : 0.6f; });
+	Compushady::Mips::Downsample(Pair, FIntVector(2, 1, 1), ECompushadyMipFilter::Kaiser, Output, OutputSize);
+	TestEqual(TEXT("Pair"), Output[0].R, 0.4f, 1e-5f);
+
+	// a step is smoothed, but the taps never leave the range of the source
+	const TArray<FLinearColor> Step = CompushadyMipsTests::MakePixels(FIntVector(8, 1, 1), [](const int32 X, const int32 Y, const int32 Z) { return X < 4 ? 0.0f : 1.0f; });
+	Compushady::Mips::Downsample(Step, FIntVector(8, 1, 1), ECompushadyMipFilter::Kaiser, Output, OutputSize);
+	TestEqual(TEXT("Step Start"), Output[0].R, 0.0f, 1e-5f);
+	TestEqual(TEXT("Step Before"), Output[1].R, Weights.X, 1e-5f);
+	TestEqual(TEXT("Step After"), Output[2].R, 1.0f - Weights.X, 1e-5f);
+	TestEqual(TEXT("Step End"), Output[3].R, 1.0f, 1e-5f);
+
+	const TArray<FLinearColor> Volume = CompushadyMipsTests::MakePixels(FIntVector(4, 4, 4), [](const int32 X, const int32 Y, const int32 Z) { return 0.5f; });
+	Compushady::Mips::Downsample(Volume, FIntVector(4, 4, 4), ECompushadyMipFilter::Kaiser, Output, OutputSize);
+	TestEqual(TEXT("Volume Size"), OutputSize, FIntVector(2, 2, 2));
+	TestEqual(TEXT("Volume"), Output[7].R, 0.5f, 1e-5f);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,313 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyNRRD.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace CompushadyNRRDTests
+{
+	// 5x4x3 ushort volume ((i * 37 + 11) & 0xFFFF), big endian, bzip2 -9
+	static const uint8 BZIP2Volume[] =
+	{
+		0x42, 0x5A, 0x68, 0x39, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59, 0x92, 0x06, 0x95, 0xEF, 0x00, 0x00,
+		0x00, 0x7F, 0xFF, 0xFF, 0xC9, 0x24, 0x92, 0x48, 0x00, 0x49, 0x24, 0x92, 0x40, 0x02, 0x49, 0x24,
+		0x92, 0x00, 0x12, 0x49, 0x24, 0x90, 0x00, 0x92, 0x49, 0x24, 0x00, 0x04, 0x92, 0x49, 0x20, 0x00,
+		0x24, 0x92, 0x49, 0x20, 0x00, 0x68, 0x70, 0x34, 0xD3, 0x4D, 0x19, 0x06, 0x8C, 0x46, 0x04, 0x6D,
+		0x23, 0x35, 0x3D, 0x4D, 0x94, 0xCD, 0x0D, 0x46, 0xD4, 0xF4, 0x20, 0x70, 0x0F, 0xF6, 0xAA, 0x80,
+		0x00, 0x03, 0x40, 0x00, 0x00, 0x00, 0x34, 0xD3, 0x64, 0x9D, 0xF4, 0x6E, 0x70, 0x02, 0x29, 0xF6,
+		0x37, 0x0C, 0x83, 0xAB, 0xE3, 0x4F, 0xC6, 0x29, 0xCC, 0x87, 0xC0, 0x12, 0x53, 0xEE, 0xD8, 0xC2,
+		0x32, 0x98, 0xF7, 0x08, 0x85, 0x35, 0x88, 0xBE, 0x8A, 0xBD, 0x1D, 0x17, 0x7D, 0xF6, 0xEB, 0xCF,
+		0xB1, 0xB0, 0x31, 0xB0, 0x7C, 0x77, 0xEB, 0xDF, 0x9F, 0x63, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x01, 0x24, 0x92, 0x49, 0x24, 0x92, 0x4B, 0xF8, 0xBB, 0x92, 0x29, 0xC2, 0x84,
+		0x84, 0x90, 0x34, 0xAF, 0x78
+	};
+
+	static TArray<uint16> MakeVolume()
+	{
+		TArray<uint16> Values;
+		for (int32 Index = 0; Index < 5 * 4 * 3; Index++)
+		{
+			Values.Add(static_cast<uint16>((Index * 37 + 11) & 0xFFFF));
+		}
+		return Values;
+	}
+
+	static TArray<uint8> ToBytes(const TArray<uint16>& Values, const bool bBigEndian)
+	{
+		TArray<uint8> Bytes;
+		for (const uint16 Value : Values)
+		{
+			Bytes.Add(bBigEndian ? Value >> 8 : Value & 0xFF);
+			Bytes.Add(bBigEndian ? Value & 0xFF : Value >> 8);
+		}
+		return Bytes;
+	}
+
+	static TArray<uint8> Compress(const TArray<uint8>& Data)
+	{
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Gzip, Data.Num());
+		TArray<uint8> Compressed;
+		Compressed.SetNumUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(NAME_Gzip, Compressed.GetData(), CompressedSize, Data.GetData(), Data.Num()))
+		{
+			return {};
+		}
+		Compressed.SetNum(CompressedSize);
+		return Compressed;
+	}
+
+	static FString GetFilename(const FString& Name)
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), Name);
+	}
+
+	static bool WriteFile(const FString& Filename, const FString& Header, const TArray<uint8>& Data)
+	{
+		TArray<uint8> Content;
+		FTCHARToUTF8 UTF8(*Header);
+		Content.Append(reinterpret_cast<const uint8*>(UTF8.Get()), UTF8.Length());
+		Content.Append(Data);
+		return FFileHelper::SaveArrayToFile(Content, *Filename);
+	}
+
+	static bool LoadVolume(const FString& Filename, TArray<uint16>& Values, FString& ErrorMessages)
+	{
+		TSharedPtr<Compushady::NRRD::FCompushadyNRRDReader> Reader = Compushady::NRRD::FCompushadyNRRDReader::Create(Filename, ErrorMessages);
+		if (!Reader)
+		{
+			return false;
+		}
+
+		const Compushady::NRRD::FCompushadyNRRDHeader& Header = Reader->GetHeader();
+		if (Header.Width != 5 || Header.Height != 4 || Header.Depth != 3 || Header.PixelFormat != EPixelFormat::PF_R16_UINT)
+		{
+			ErrorMessages = "Unexpected NRRD header";
+			return false;
+		}
+
+		// one slice at a time, as the texture upload does
+		Values.SetNumZeroed(5 * 4 * 3);
+		for (int32 Slice = 0; Slice < 3; Slice++)
+		{
+			if (!Reader->ReadSlices(reinterpret_cast<uint8*>(Values.GetData() + Slice * 5 * 4), 1, ErrorMessages))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyNRRDTest_Encodings, "Compushady.NRRD.Encodings", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyNRRDTest_Encodings::RunTest(const FString& Parameters)
+{
+	const TArray<uint16> Volume = CompushadyNRRDTests::MakeVolume();
+	const FString Filename = CompushadyNRRDTests::GetFilename("compushady_test.nrrd");
+
+	for (const bool bBigEndian : { false, true })
+	{
+		const TArray<uint8> Bytes = CompushadyNRRDTests::ToBytes(Volume, bBigEndian);
+		const FString Endian = bBigEndian ? "big" : "little";
+
+		struct FEncodingCase
+		{
+			FString Encoding;
+			TArray<uint8> Data;
+		};
+
+		TArray<FEncodingCase> Cases;
+		Cases.Add({ "raw", Bytes });
+		Cases.Add({ "gzip", CompushadyNRRDTests::Compress(Bytes) });
+		if (bBigEndian)
+		{
+			Cases.Add({ "bzip2", TArray<uint8>(CompushadyNRRDTests::BZIP2Volume, UE_ARRAY_COUNT(CompushadyNRRDTests::BZIP2Volume)) });
+		}
+
+		for (const FEncodingCase& Case : Cases)
+		{
+			const FString Header = FString::Printf(TEXT("NRRD0004\n# test volume\ntype: ushort\ndimension: 3\nsizes: 5 4 3\nencoding: %s\nendian: %s\n\n"), *Case.Encoding, *Endian);
+			TestTrue(TEXT("WriteFile"), CompushadyNRRDTests::WriteFile(Filename, Header, Case.Data));
+
+			TArray<uint16> Values;
+			FString ErrorMessages;
+			const bool bLoaded = CompushadyNRRDTests::LoadVolume(Filename, Values, ErrorMessages);
+			TestTrue(FString::Printf(TEXT("Load %s %s (%s)"), *Case.Encoding, *Endian, *ErrorMessages), bLoaded);
+			if (bLoaded)
+			{
+				TestTrue(FString::Printf(TEXT("Values %s %s"), *Case.Encoding, *Endian), Values == Volume);
+			}
+		}
+	}
+
+	// the legacy full load
+	TArray64<uint8> SlicesData;
+	int64 Offset = 0;
+	uint32 Width = 0;
+	uint32 Height = 0;
+	uint32 Depth = 0;
+	EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
+	if (TestTrue(TEXT("LoadNRRD"), Compushady::Utils::LoadNRRD(Filename, SlicesData, Offset, Width, Height, Depth, PixelFormat)))
+	{
+		TestEqual(TEXT("LoadNRRD Size"), SlicesData.Num() - Offset, static_cast<int64>(Volume.Num() * sizeof(uint16)));
+		TestEqual(TEXT("LoadNRRD Data"), FMemory::Memcmp(SlicesData.GetData() + Offset, Volume.GetData(), Volume.Num() * sizeof(uint16)), 0);
+		TestEqual(TEXT("LoadNRRD Depth"), Depth, 3u);
+	}
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyNRRDTest_Detached, "Compushady.NRRD.Detached", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyNRRDTest_Detached::RunTest(const FString& Parameters)
+{
+	const TArray<uint16> Volume = CompushadyNRRDTests::MakeVolume();
+	const TArray<uint8> Bytes = CompushadyNRRDTests::ToBytes(Volume, false);
+	const int32 SliceSize = 5 * 4 * sizeof(uint16);
+
+	TArray<FString> Filenames;
+
+	// one gzip file per slice, each one with a text preamble (line skip) and a decompressed byte skip
+	for (int32 Slice = 0; Slice < 3; Slice++)
+	{
+		TArray<uint8> SliceData;
+		SliceData.AddZeroed(3);
+		SliceData.Append(Bytes.GetData() + Slice * SliceSize, SliceSize);
+
+		const FString Filename = CompushadyNRRDTests::GetFilename(FString::Printf(TEXT("compushady_test_slice%03d.gz"), Slice));
+		TestTrue(TEXT("WriteFile"), CompushadyNRRDTests::WriteFile(Filename, "preamble\n", CompushadyNRRDTests::Compress(SliceData)));
+		Filenames.Add(Filename);
+	}
+
+	const FString CommonHeader = "NRRD0004\ntype: uint16\ndimension: 3\nsizes: 5 4 3\nencoding: gz\nendian: little\nline skip: 1\nbyte skip: 3\n";
+
+	const FString ListFilename = CompushadyNRRDTests::GetFilename("compushady_test_list.nhdr");
+	TestTrue(TEXT("WriteFile List"), CompushadyNRRDTests::WriteFile(ListFilename, CommonHeader + "data file: LIST 2\ncompushady_test_slice000.gz\ncompushady_test_slice001.gz\ncompushady_test_slice002.gz\n", {}));
+	Filenames.Add(ListFilename);
+
+	// no trailing newline
+	const FString FormatFilename = CompushadyNRRDTests::GetFilename("compushady_test_format.nhdr");
+	TestTrue(TEXT("WriteFile Format"), CompushadyNRRDTests::WriteFile(FormatFilename, CommonHeader + "data file: compushady_test_slice%03d.gz 0 2 1 2", {}));
+	Filenames.Add(FormatFilename);
+
+	for (const FString& Filename : { ListFilename, FormatFilename })
+	{
+		Compushady::NRRD::FCompushadyNRRDHeader Header;
+		FString ErrorMessages;
+		if (TestTrue(FString::Printf(TEXT("ParseHeader %s"), *Filename), Compushady::NRRD::ParseHeader(Filename, Header, ErrorMessages)))
+		{
+			TestEqual(TEXT("DataFiles"), Header.DataFiles.Num(), 3);
+			TestTrue(TEXT("Encoding"), Header.Encoding == Compushady::NRRD::ECompushadyNRRDEncoding::GZIP);
+		}
+
+		TArray<uint16> Values;
+		const bool bLoaded = CompushadyNRRDTests::LoadVolume(Filename, Values, ErrorMessages);
+		TestTrue(FString::Printf(TEXT("Load %s (%s)"), *Filename, *ErrorMessages), bLoaded);
+		if (bLoaded)
+		{
+			TestTrue(TEXT("Values"), Values == Volume);
+		}
+	}
+
+	// raw data at the end of the file
+	const FString RawFilename = CompushadyNRRDTests::GetFilename("compushady_test_tail.raw");
+	TestTrue(TEXT("WriteFile Raw"), CompushadyNRRDTests::WriteFile(RawFilename, "some unrelated header", Bytes));
+	Filenames.Add(RawFilename);
+
+	const FString TailFilename = CompushadyNRRDTests::GetFilename("compushady_test_tail.nhdr");
+	TestTrue(TEXT("WriteFile Tail"), CompushadyNRRDTests::WriteFile(TailFilename, "NRRD0004\ntype: ushort\ndimension: 3\nsizes: 5 4 3\nencoding: raw\nbyte skip: -1\ndata file: compushady_test_tail.raw\n", {}));
+	Filenames.Add(TailFilename);
+
+	TArray<uint16> Values;
+	FString ErrorMessages;
+	const bool bLoaded = CompushadyNRRDTests::LoadVolume(TailFilename, Values, ErrorMessages);
+	TestTrue(FString::Printf(TEXT("Load Tail (%s)"), *ErrorMessages), bLoaded);
+	if (bLoaded)
+	{
+		TestTrue(TEXT("Values Tail"), Values == Volume);
+	}
+
+	for (const FString& Filename : Filenames)
+	{
+		IFileManager::Get().Delete(*Filename);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyNRRDTest_SwapEndianness, "Compushady.NRRD.SwapEndianness", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyNRRDTest_SwapEndianness::RunTest(const FString& Parameters)
+{
+	for (const int32 ElementSize : { 2, 4, 8 })
+	{
+		// not a multiple of the vector size, to cover the scalar tail
+		const int32 NumElements = 37;
+		TArray<uint8> Data;
+		for (int32 Index = 0; Index < NumElements * ElementSize; Index++)
+		{
+			Data.Add(static_cast<uint8>(Index * 7 + 1));
+		}
+
+		TArray<uint8> Swapped = Data;
+		Compushady::NRRD::SwapEndianness(Swapped.GetData(), NumElements, ElementSize);
+
+		bool bMatch = true;
+		for (int32 Element = 0; Element < NumElements; Element++)
+		{
+			for (int32 Byte = 0; Byte < ElementSize; Byte++)
+			{
+				bMatch &= Swapped[Element * ElementSize + Byte] == Data[Element * ElementSize + ElementSize - 1 - Byte];
+			}
+		}
+		TestTrue(FString::Printf(TEXT("Swap %d"), ElementSize), bMatch);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyNRRDTest_Invalid, "Compushady.NRRD.Invalid", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyNRRDTest_Invalid::RunTest(const FString& Parameters)
+{
+	const FString Filename = CompushadyNRRDTests::GetFilename("compushady_test_invalid.nrrd");
+
+	const TArray<uint8> Bytes = CompushadyNRRDTests::ToBytes(CompushadyNRRDTests::MakeVolume(), false);
+
+	const TCHAR* Headers[] =
+	{
+		TEXT("NRRD0004\ntype: ushort\ndimension: 3\nsizes: 5 4 3\nencoding: hex\n\n"),
+		TEXT("NRRD0004\ntype: ushort\ndimension: 3\nsizes: 5 4 3\nencoding: gzip\nbyte skip: -1\n\n"),
+		TEXT("NRRD0004\ntype: double\ndimension: 3\nsizes: 5 4 3\nencoding: raw\n\n"),
+		TEXT("NRRD0004\ntype: ushort\ndimension: 3\nsizes: 5 4 0\nencoding: raw\n\n"),
+	};
+
+	for (const TCHAR* Header : Headers)
+	{
+		TestTrue(TEXT("WriteFile"), CompushadyNRRDTests::WriteFile(Filename, Header, Bytes));
+
+		FString ErrorMessages;
+		TestFalse(FString::Printf(TEXT("Reader %s"), Header), Compushady::NRRD::FCompushadyNRRDReader::Create(Filename, ErrorMessages).IsValid());
+		TestFalse(TEXT("ErrorMessages"), ErrorMessages.IsEmpty());
+	}
+
+	// truncated data
+	TArray<uint8> Truncated = CompushadyNRRDTests::Compress(Bytes);
+	Truncated.SetNum(20);
+	TestTrue(TEXT("WriteFile Truncated"), CompushadyNRRDTests::WriteFile(Filename, "NRRD0004\ntype: ushort\ndimension: 3\nsizes: 5 4 3\nencoding: gzip\n\n", Truncated));
+	TArray<uint16> Values;
+	FString ErrorMessages;
+	TestFalse(TEXT("Truncated"), CompushadyNRRDTests::LoadVolume(Filename, Values, ErrorMessages));
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyOrderedWriter.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyOrderedWriterTest_Order, "Compushady.OrderedWriter.Order", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyOrderedWriterTest_Order::RunTest(const FString& Parameters)
+{
+	// the write function runs only on the writer thread
+	TArray<int32> Written;
+	Compushady::TCompushadyOrderedWriter<int32> Writer(4,
+		[&Written](int32& Item, int64& WrittenBytes)
+		{
+			Written.Add(Item);
+			WrittenBytes = sizeof(int32);
+			// odd items fail
+			return (Item % 2) == 0;
+		});
+
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("Start"), Writer.Start(TEXT("CompushadyOrderedWriterTest"), ErrorMessages)))
+	{
+		return true;
+	}
+
+	uint64 Sequences[4];
+	for (int32 Index = 0; Index < 4; Index++)
+	{
+		TestTrue(FString::Printf(TEXT("Reserve %d"), Index), Writer.Reserve(Sequences[Index], false));
+	}
+
+	uint64 FullSequence = 0;
+	TestFalse(TEXT("Reserve (full)"), Writer.Reserve(FullSequence, false));
+
+	// submitted out of order from the thread pool, the cancelled item does not block the following ones
+	Writer.Cancel(Sequences[2]);
+	TFuture<void> Future = Async(EAsyncExecution::ThreadPool, [&Writer, &Sequences]()
+		{
+			Writer.Submit(Sequences[3], 30);
+			Writer.Submit(Sequences[1], 11);
+		});
+	Writer.Submit(Sequences[0], 0);
+	Future.Wait();
+
+	Writer.Flush();
+	TestEqual(TEXT("NumQueued"), Writer.NumQueued(), 0);
+	TestTrue(TEXT("Written"), Written == TArray<int32>({ 0, 11, 30 }));
+
+	// space is available again
+	TestTrue(TEXT("Enqueue"), Writer.Enqueue(40));
+	Writer.Close();
+
+	TestEqual(TEXT("Written (closed)"), Written.Num(), 4);
+	TestEqual(TEXT("GetNumWritten"), Writer.GetNumWritten(), 3LL);
+	TestEqual(TEXT("GetNumFailed"), Writer.GetNumFailed(), 1LL);
+	TestEqual(TEXT("GetNumDropped"), Writer.GetNumDropped(), 2LL);
+	TestEqual(TEXT("GetWrittenBytes"), Writer.GetWrittenBytes(), static_cast<int64>(sizeof(int32) * 3));
+	TestEqual(TEXT("GetPeakQueued"), Writer.GetPeakQueued(), 4);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyOrderedWriterTest_Block, "Compushady.OrderedWriter.Block", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyOrderedWriterTest_Block::RunTest(const FString& Parameters)
+{
+	std::atomic<int32> NumWritten{ 0 };
+	Compushady::TCompushadyOrderedWriter<int32> Writer(2,
+		[&NumWritten](int32& Item, int64& WrittenBytes)
+		{
+			FPlatformProcess::Sleep(0.001f);
+			NumWritten++;
+			return true;
+		});
+
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("Start"), Writer.Start(TEXT("CompushadyOrderedWriterTest"), ErrorMessages)))
+	{
+		return true;
+	}
+
+	// the reservations wait for the writer instead of dropping
+	for (int32 Index = 0; Index < 16; Index++)
+	{
+		uint64 Sequence = 0;
+		TestTrue(FString::Printf(TEXT("Reserve %d"), Index), Writer.Reserve(Sequence, true));
+		TestTrue(TEXT("NumQueued"), Writer.NumQueued() <= 2);
+		Writer.Submit(Sequence, Index);
+	}
+
+	Writer.Close();
+
+	TestEqual(TEXT("NumWritten"), NumWritten.load(), 16);
+	TestEqual(TEXT("GetNumDropped"), Writer.GetNumDropped(), 0LL);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,163 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyRDG.h"
+#include "CompushadyFunctionLibrary.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRDGTest_CollectResourceAccesses, "Compushady.RDG.CollectResourceAccesses", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRDGTest_CollectResourceAccesses::RunTest(const FString& Parameters)
+{
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8);
+	UCompushadySRV* SRVBuffer = UCompushadyFunctionLibrary::CreateCompushadySRVBuffer(TestName, 32, EPixelFormat::PF_R32_UINT);
+
+	// an SRV on the same texture of the UAV
+	UCompushadySRV* SRV = NewObject<UCompushadySRV>();
+	TestTrue(TEXT("SRV->InitializeFromTexture"), SRV->InitializeFromTexture(UAV->GetTextureRHI()));
+
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.SRVs = { SRV, SRVBuffer, SRVBuffer };
+	ResourceArray.UAVs = { UAV };
+
+	TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+	FString ErrorMessages;
+	TestTrue(TEXT("bSuccess"), Compushady::RDG::CollectResourceAccesses(ResourceArray, Accesses, ErrorMessages));
+
+	if (!TestEqual(TEXT("Accesses.Num()"), Accesses.Num(), 2))
+	{
+		return true;
+	}
+
+	TestTrue(TEXT("Accesses[0].TextureRHIRef"), Accesses[0].TextureRHIRef == UAV->GetTextureRHI());
+	TestTrue(TEXT("Accesses[0].Access"), Accesses[0].Access == ERHIAccess::UAVCompute);
+	TestTrue(TEXT("Accesses[1].BufferRHIRef"), Accesses[1].BufferRHIRef == SRVBuffer->GetBufferRHI());
+	TestTrue(TEXT("Accesses[1].Access"), Accesses[1].Access == ERHIAccess::SRVCompute);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRDGTest_SceneTexture, "Compushady.RDG.SceneTexture", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRDGTest_SceneTexture::RunTest(const FString& Parameters)
+{
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.SRVs = { UCompushadyFunctionLibrary::CreateCompushadySRVFromSceneTexture(ECompushadySceneTexture::SceneColorInput) };
+
+	TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+	FString ErrorMessages;
+	TestFalse(TEXT("bSuccess"), Compushady::RDG::CollectResourceAccesses(ResourceArray, Accesses, ErrorMessages));
+	TestEqual(TEXT("ErrorMessages"), ErrorMessages, "SRV 0 is a scene texture (register the engine texture with the render graph instead)");
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRDGTest_DeclaredAccesses, "Compushady.RDG.DeclaredAccesses", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRDGTest_DeclaredAccesses::RunTest(const FString& Parameters)
+{
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8);
+	UCompushadySRV* SRVBuffer = UCompushadyFunctionLibrary::CreateCompushadySRVBuffer(TestName, 32, EPixelFormat::PF_R32_UINT);
+
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.SRVs = { SRVBuffer };
+	ResourceArray.UAVs = { UAV };
+
+	TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+	FString ErrorMessages;
+	TestTrue(TEXT("bSuccess"), Compushady::RDG::CollectResourceAccesses(ResourceArray, Accesses, ErrorMessages));
+
+	int32 NumTextureAccesses = 0;
+	int32 NumBufferAccesses = 0;
+	ERHIAccess TextureAccess = ERHIAccess::Unknown;
+	ERHIAccess BufferAccess = ERHIAccess::Unknown;
+	bool bSameTexture = false;
+	bool bSameBuffer = false;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyRDGTest)(
+		[&](FRHICommandListImmediate& RHICmdList)
+		{
+			FRDGBuilder GraphBuilder(RHICmdList);
+
+			FCompushadyRDGComputePassParameters* PassParameters = Compushady::RDG::CreatePassParameters(GraphBuilder, Accesses);
+			NumTextureAccesses = PassParameters->TextureAccesses.Num();
+			NumBufferAccesses = PassParameters->BufferAccesses.Num();
+			if (NumTextureAccesses > 0 && NumBufferAccesses > 0)
+			{
+				TextureAccess = PassParameters->TextureAccesses[0].GetAccess();
+				BufferAccess = PassParameters->BufferAccesses[0].GetAccess();
+				// registering again must return the same RDG resources
+				bSameTexture = Compushady::RDG::RegisterExternalTexture(GraphBuilder, UAV->GetTextureRHI()) == PassParameters->TextureAccesses[0].GetTexture();
+				bSameBuffer = Compushady::RDG::RegisterExternalBuffer(GraphBuilder, SRVBuffer->GetBufferRHI()) == PassParameters->BufferAccesses[0].GetBuffer();
+			}
+
+			GraphBuilder.Execute();
+		});
+
+	FlushRenderingCommands();
+
+	TestEqual(TEXT("NumTextureAccesses"), NumTextureAccesses, 1);
+	TestEqual(TEXT("NumBufferAccesses"), NumBufferAccesses, 1);
+	TestTrue(TEXT("TextureAccess"), TextureAccess == ERHIAccess::UAVCompute);
+	TestTrue(TEXT("BufferAccess"), BufferAccess == ERHIAccess::SRVCompute);
+	TestTrue(TEXT("bSameTexture"), bSameTexture);
+	TestTrue(TEXT("bSameBuffer"), bSameBuffer);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRDGTest_AddComputePass, "Compushady.RDG.AddComputePass", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRDGTest_AddComputePass::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	UCompushadyCompute* Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString("RWBuffer<uint> Output; [numthreads(1, 1, 1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = tid.x * 2; }", ErrorMessages, "main");
+	if (!TestNotNull(TEXT("Compute"), Compute))
+	{
+		return true;
+	}
+
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName, 32, EPixelFormat::PF_R32_UINT);
+
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.UAVs = { UAV };
+
+	bool bSuccess = false;
+	bool bMissingBindingsSuccess = true;
+	FString MissingBindingsErrorMessages;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyRDGTest)(
+		[&](FRHICommandListImmediate& RHICmdList)
+		{
+			FRDGBuilder GraphBuilder(RHICmdList);
+
+			bSuccess = Compushady::RDG::AddComputePass(GraphBuilder, Compute, ResourceArray, FIntVector(8, 1, 1), ErrorMessages);
+			bMissingBindingsSuccess = Compushady::RDG::AddComputePass(GraphBuilder, Compute, {}, FIntVector(8, 1, 1), MissingBindingsErrorMessages);
+
+			GraphBuilder.Execute();
+		});
+
+	FlushRenderingCommands();
+
+	TestTrue(TEXT("bSuccess"), bSuccess);
+	TestFalse(TEXT("bMissingBindingsSuccess"), bMissingBindingsSuccess);
+	TestEqual(TEXT("MissingBindingsErrorMessages"), MissingBindingsErrorMessages, "Expected 1 UAVs got 0");
+
+	TArray<uint32> Output;
+	Output.AddZeroed(8);
+
+	UAV->MapReadAndExecuteSync([&Output](const void* Data)
+		{
+			FMemory::Memcpy(Output.GetData(), Data, Output.Num() * sizeof(uint32));
+			return true;
+		});
+
+	for (int32 Index = 0; Index < Output.Num(); Index++)
+	{
+		TestEqual(FString::Printf(TEXT("Output[%d]"), Index), Output[Index], static_cast<uint32>(Index * 2));
+	}
+
+	return true;
+}
+
+#endif
@@ -155,4 +155,251 @@ bool FCompushadyRasterizerTest_StencilOnly::RunTest(const FString& Parameters)
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_PrecachePipelineStates, "Compushady.Rasterizer.PrecachePipelineStates", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_PrecachePipelineStates::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString VSCode = "float4 main(const uint vid : SV_VertexID) : SV_Position { if (vid == 0) { return float4(-1, -1, 0, 1); } else if (vid == 1) { return float4(0, 1, 0, 1); } else if (vid == 2) { return float4(1, -1, 0, 1); } return float4(0, 0, 0, 0); }";
+	const FString PSCode = "float4 main() : SV_Target0 { return float4(1, 0, 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+	UCompushadyRTV* RTV2 = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+	UCompushadyRTV* RTVFloat = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_FloatRGBA, FLinearColor::Black);
+
+	Rasterizer->PrecachePipelineStates({ RTV }, nullptr);
+	// same formats, no new pipeline state
+	Rasterizer->PrecachePipelineStates({ RTV2 }, nullptr);
+	FlushRenderingCommands();
+
+	TestEqual(TEXT("NumCachedPipelineStates"), Rasterizer->GetNumCachedPipelineStates_RenderThread(), 1);
+
+	Rasterizer->PrecachePipelineStates({ RTVFloat }, nullptr);
+	FlushRenderingCommands();
+
+	TestEqual(TEXT("NumCachedPipelineStates"), Rasterizer->GetNumCachedPipelineStates_RenderThread(), 2);
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(Rasterizer, TEXT("StoreLastSignal"));
+
+	Rasterizer->Draw({}, {}, { RTV }, nullptr, 3, 1, FCompushadyRasterizeConfig(), Signal);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FCompushadyWaitRasterizer(this, Rasterizer, [this, Rasterizer]()
+		{
+			TestTrue("Rasterizer->bLastSuccess", Rasterizer->bLastSuccess);
+			// the draw must reuse the precached pipeline state
+			TestEqual(TEXT("NumCachedPipelineStates"), Rasterizer->GetNumCachedPipelineStates_RenderThread(), 2);
+		}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_PipelineStateCacheBenchmark, "Compushady.Rasterizer.PipelineStateCacheBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_PipelineStateCacheBenchmark::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString VSCode = "float4 main(const uint vid : SV_VertexID) : SV_Position { if (vid == 0) { return float4(-1, -1, 0, 1); } else if (vid == 1) { return float4(0, 1, 0, 1); } else if (vid == 2) { return float4(1, -1, 0, 1); } return float4(0, 0, 0, 0); }";
+	const FString PSCode = "float4 main() : SV_Target0 { return float4(1, 0, 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	constexpr int32 NumDraws = 10000;
+	double UncachedTime = 0;
+	double CachedTime = 0;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyPipelineStateCacheBenchmark)(
+		[Rasterizer, RTV, &UncachedTime, &CachedTime](FRHICommandListImmediate& RHICmdList)
+		{
+			FRHITexture* Texture = RTV->GetTextureRHI();
+			RHICmdList.Transition(FRHITransitionInfo(Texture, ERHIAccess::Unknown, ERHIAccess::RTV));
+
+			FRHIRenderPassInfo Info(Texture, ERenderTargetActions::Load_Store);
+			RHICmdList.BeginRenderPass(Info, TEXT("FCompushadyRasterizerTest_PipelineStateCacheBenchmark"));
+			RHICmdList.SetViewport(0, 0, 0, 8, 8, 1);
+
+			for (const bool bUsePipelineStateCache : { false, true })
+			{
+				Rasterizer->bUsePipelineStateCache = bUsePipelineStateCache;
+				const double StartTime = FPlatformTime::Seconds();
+				for (int32 DrawIndex = 0; DrawIndex < NumDraws; DrawIndex++)
+				{
+					Rasterizer->SetGraphicsPipelineState_RenderThread(RHICmdList, 0);
+					RHICmdList.DrawPrimitive(0, 1, 1);
+				}
+				(bUsePipelineStateCache ? CachedTime : UncachedTime) = FPlatformTime::Seconds() - StartTime;
+			}
+
+			RHICmdList.EndRenderPass();
+		});
+
+	FlushRenderingCommands();
+
+	AddInfo(FString::Printf(TEXT("%d draws: %.3f ms without pipeline state cache, %.3f ms with pipeline state cache"), NumDraws, UncachedTime * 1000, CachedTime * 1000));
+
+	TestEqual(TEXT("NumCachedPipelineStates"), Rasterizer->GetNumCachedPipelineStates_RenderThread(), 1);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_DrawBatchRenderPasses, "Compushady.Rasterizer.DrawBatchRenderPasses", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_DrawBatchRenderPasses::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString VSCode = "float4 main(const uint vid : SV_VertexID) : SV_Position { if (vid % 3 == 0) { return float4(-1, -1, 0, 1); } else if (vid % 3 == 1) { return float4(0, 1, 0, 1); } return float4(1, -1, 0, 1); }";
+	const FString PSCode = "float4 main() : SV_Target0 { return float4(1, 0, 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	TArray<FCompushadyDrawItem> DrawItems;
+	for (int32 DrawItemIndex = 0; DrawItemIndex < 100; DrawItemIndex++)
+	{
+		FCompushadyDrawItem DrawItem;
+		DrawItem.NumVertices = 3;
+		DrawItem.FirstVertex = DrawItemIndex * 3;
+		DrawItems.Add(DrawItem);
+	}
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(Rasterizer, TEXT("StoreLastSignal"));
+
+	Rasterizer->DrawBatch(DrawItems, { RTV }, nullptr, FCompushadyRasterizeConfig(), Signal);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FCompushadyWaitRasterizer(this, Rasterizer, [this, Rasterizer]()
+		{
+			TestTrue("Rasterizer->bLastSuccess", Rasterizer->bLastSuccess);
+			TestEqual(TEXT("NumRenderPasses"), Rasterizer->NumRenderPasses, 1);
+		}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_DrawBatchOrdering, "Compushady.Rasterizer.DrawBatchOrdering", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_DrawBatchOrdering::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	// every triangle covers the same area, the color depends on the triangle index
+	const FString VSCode = "struct Output { float4 position : SV_Position; nointerpolation uint index : INDEX; }; Output main(const uint vid : SV_VertexID) { Output o; o.index = vid / 3; if (vid % 3 == 0) { o.position = float4(-1, -1, 0, 1); } else if (vid % 3 == 1) { o.position = float4(-1, 3, 0, 1); } else { o.position = float4(3, -1, 0, 1); } return o; }";
+	const FString PSCode = "float4 main(float4 position : SV_Position, nointerpolation uint index : INDEX) : SV_Target0 { return float4(index == 0 ? 1 : 0, index == 1 ? 1 : 0, index == 2 ? 1 : 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	// draw the blue triangle, then the red one and finally the green one
+	TArray<FCompushadyDrawItem> DrawItems;
+	for (const int32 TriangleIndex : { 2, 0, 1 })
+	{
+		FCompushadyDrawItem DrawItem;
+		DrawItem.NumVertices = 3;
+		DrawItem.FirstVertex = TriangleIndex * 3;
+		DrawItems.Add(DrawItem);
+	}
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(Rasterizer, TEXT("StoreLastSignal"));
+
+	Rasterizer->DrawBatch(DrawItems, { RTV }, nullptr, FCompushadyRasterizeConfig(), Signal);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FCompushadyWaitRasterizer(this, Rasterizer, [this, Rasterizer, RTV]()
+		{
+			TestTrue("Rasterizer->bLastSuccess", Rasterizer->bLastSuccess);
+
+			TArray<uint32> Output;
+			Output.AddZeroed(8 * 8);
+
+			RTV->MapTextureSliceAndExecuteSync([&Output](const void* Data, const int32 RowPitch)
+				{
+					CopyTextureData2D(Data, Output.GetData(), 8, EPixelFormat::PF_R8G8B8A8, RowPitch, 8 * sizeof(uint32));
+				}, 0);
+
+			TestEqual(TEXT("Output[0]"), Output[0], 0xff00ff00);
+			TestEqual(TEXT("Output[63]"), Output[63], 0xff00ff00);
+		}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_DrawBatchInvalidItem, "Compushady.Rasterizer.DrawBatchInvalidItem", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_DrawBatchInvalidItem::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString VSCode = "float4 main(const uint vid : SV_VertexID) : SV_Position { return float4(0, 0, 0, 1); }";
+	const FString PSCode = "float4 main() : SV_Target0 { return float4(1, 0, 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	TArray<FCompushadyDrawItem> DrawItems;
+	DrawItems.AddDefaulted(2);
+	DrawItems[0].NumVertices = 3;
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(Rasterizer, TEXT("StoreLastSignal"));
+
+	Rasterizer->DrawBatch(DrawItems, { RTV }, nullptr, FCompushadyRasterizeConfig(), Signal);
+
+	TestFalse(TEXT("bLastSuccess"), Rasterizer->bLastSuccess);
+	TestEqual(TEXT("LastErrorMessages"), Rasterizer->LastErrorMessages, "Invalid number of vertices 0 for DrawItem 1");
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRasterizerTest_DrawBatchBenchmark, "Compushady.Rasterizer.DrawBatchBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRasterizerTest_DrawBatchBenchmark::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	const FString VSCode = "float4 main(const uint vid : SV_VertexID) : SV_Position { if (vid % 3 == 0) { return float4(-1, -1, 0, 1); } else if (vid % 3 == 1) { return float4(0, 1, 0, 1); } return float4(1, -1, 0, 1); }";
+	const FString PSCode = "float4 main() : SV_Target0 { return float4(1, 0, 0, 1); }";
+	UCompushadyRasterizer* Rasterizer = UCompushadyFunctionLibrary::CreateCompushadyVSPSRasterizerFromHLSLString(VSCode, PSCode, FCompushadyRasterizerConfig(), ErrorMessages, "main", "main");
+
+	UCompushadyRTV* RTV = UCompushadyFunctionLibrary::CreateCompushadyRTVTexture2D(TestName, 8, 8, EPixelFormat::PF_R8G8B8A8, FLinearColor::Black);
+
+	constexpr int32 NumDraws = 1000;
+
+	TArray<FCompushadyDrawItem> DrawItems;
+	for (int32 DrawItemIndex = 0; DrawItemIndex < NumDraws; DrawItemIndex++)
+	{
+		FCompushadyDrawItem DrawItem;
+		DrawItem.NumVertices = 3;
+		DrawItems.Add(DrawItem);
+	}
+
+	double SeparateTime = 0;
+	double BatchTime = 0;
+
+	ENQUEUE_RENDER_COMMAND(DoCompushadyDrawBatchBenchmark)(
+		[Rasterizer, RTV, &DrawItems, &SeparateTime, &BatchTime](FRHICommandListImmediate& RHICmdList)
+		{
+			TStaticArray<FRHITexture*, 8> RenderTargets = {};
+			RenderTargets[0] = RTV->GetTextureRHI();
+
+			// one render pass per draw, like calling Draw() NumDraws times
+			double StartTime = FPlatformTime::Seconds();
+			for (const FCompushadyDrawItem& DrawItem : DrawItems)
+			{
+				Rasterizer->DrawBatch_RenderThread(RHICmdList, { DrawItem }, RenderTargets, 1, nullptr, FCompushadyRasterizeConfig());
+			}
+			SeparateTime = FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			Rasterizer->DrawBatch_RenderThread(RHICmdList, DrawItems, RenderTargets, 1, nullptr, FCompushadyRasterizeConfig());
+			BatchTime = FPlatformTime::Seconds() - StartTime;
+		});
+
+	FlushRenderingCommands();
+
+	AddInfo(FString::Printf(TEXT("%d draws: %.3f ms with a render pass per draw, %.3f ms batched"), NumDraws, SeparateTime * 1000, BatchTime * 1000));
+
+	TestEqual(TEXT("NumRenderPasses"), Rasterizer->NumRenderPasses, NumDraws + 1);
+
+	return true;
+}
+
 #endif
@@ -0,0 +1,225 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyRawVideoWriter.h"
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyUAV.h"
+#include "Misc/AutomationTest.h"
+
+namespace CompushadyRawVideoWriterTests
+{
+	struct FReferenceColor
+	{
+		FLinearColor Color;
+		uint8 Y;
+		uint8 U;
+		uint8 V;
+	};
+
+	static void TestReferenceColors(FAutomationTestBase& Test, const ECompushadyYUVMatrix Matrix, const TArray<FReferenceColor>& ReferenceColors)
+	{
+		for (const FReferenceColor& ReferenceColor : ReferenceColors)
+		{
+			uint8 Y, U, V;
+			Compushady::Video::RGBToYUV(ReferenceColor.Color, Matrix, Y, U, V);
+			const FString Name = ReferenceColor.Color.ToString();
+			Test.TestEqual(FString::Printf(TEXT("Y %s"), *Name), Y, ReferenceColor.Y);
+			Test.TestEqual(FString::Printf(TEXT("U %s"), *Name), U, ReferenceColor.U);
+			Test.TestEqual(FString::Printf(TEXT("V %s"), *Name), V, ReferenceColor.V);
+		}
+	}
+
+	static TArray<FLinearColor> MakeGradient(const int32 Width, const int32 Height)
+	{
+		TArray<FLinearColor> Pixels;
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				Pixels.Add(FLinearColor(static_cast<float>(X) / Width, static_cast<float>(Y) / Height, static_cast<float>((X + Y) % 3) / 2, 1));
+			}
+		}
+		return Pixels;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRawVideoTest_BT601, "Compushady.RawVideo.BT601", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRawVideoTest_BT601::RunTest(const FString& Parameters)
+{
+	CompushadyRawVideoWriterTests::TestReferenceColors(*this, ECompushadyYUVMatrix::BT601, {
+		{ FLinearColor(0, 0, 0), 16, 128, 128 },
+		{ FLinearColor(1, 1, 1), 235, 128, 128 },
+		{ FLinearColor(1, 0, 0), 81, 90, 240 },
+		{ FLinearColor(0, 1, 0), 145, 54, 34 },
+		{ FLinearColor(0, 0, 1), 41, 240, 110 },
+		// out of range values are saturated
+		{ FLinearColor(2, -1, 0), 81, 90, 240 },
+		});
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRawVideoTest_BT709, "Compushady.RawVideo.BT709", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRawVideoTest_BT709::RunTest(const FString& Parameters)
+{
+	CompushadyRawVideoWriterTests::TestReferenceColors(*this, ECompushadyYUVMatrix::BT709, {
+		{ FLinearColor(0, 0, 0), 16, 128, 128 },
+		{ FLinearColor(1, 1, 1), 235, 128, 128 },
+		{ FLinearColor(1, 0, 0), 63, 102, 240 },
+		{ FLinearColor(0, 1, 0), 173, 42, 26 },
+		{ FLinearColor(0, 0, 1), 32, 240, 118 },
+		});
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRawVideoTest_ConvertFrame, "Compushady.RawVideo.ConvertFrame", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRawVideoTest_ConvertFrame::RunTest(const FString& Parameters)
+{
+	// a red and a blue column in the first 2x2 block
+	TArray<FLinearColor> Pixels;
+	Pixels.Init(FLinearColor(1, 1, 1), 4 * 2);
+	Pixels[0] = Pixels[4] = FLinearColor(1, 0, 0);
+	Pixels[1] = Pixels[5] = FLinearColor(0, 0, 1);
+
+	uint8 ExpectedU, ExpectedV, Unused;
+	Compushady::Video::RGBToYUV(FLinearColor(0.5f, 0, 0.5f), ECompushadyYUVMatrix::BT709, Unused, ExpectedU, ExpectedV);
+
+	const Compushady::Video::FCompushadyYUVFrameLayout I420Layout(4, 2, ECompushadyYUVFormat::I420, 8);
+	TestEqual(TEXT("I420Layout.Pitch"), I420Layout.Pitch, 8);
+	TestEqual(TEXT("I420Layout.GetFrameSize()"), I420Layout.GetFrameSize(), 24LL);
+	TestEqual(TEXT("I420Layout.GetSecondChromaOffset()"), I420Layout.GetSecondChromaOffset(), 20LL);
+
+	TArray<uint8> I420;
+	I420.Init(0xFF, I420Layout.GetFrameSize());
+	TestTrue(TEXT("ConvertRGBToYUV (I420)"), Compushady::Video::ConvertRGBToYUV(Pixels.GetData(), I420Layout, ECompushadyYUVMatrix::BT709, I420.GetData()));
+
+	TestEqual(TEXT("I420[0]"), I420[0], static_cast<uint8>(63));
+	TestEqual(TEXT("I420[1]"), I420[1], static_cast<uint8>(32));
+	TestEqual(TEXT("I420[9] (second row)"), I420[9], static_cast<uint8>(32));
+	TestEqual(TEXT("I420[4] (padding)"), I420[4], static_cast<uint8>(0xFF));
+	TestEqual(TEXT("U[0]"), I420[16], ExpectedU);
+	TestEqual(TEXT("U[1]"), I420[17], static_cast<uint8>(128));
+	TestEqual(TEXT("V[0]"), I420[20], ExpectedV);
+
+	const Compushady::Video::FCompushadyYUVFrameLayout NV12Layout(4, 2, ECompushadyYUVFormat::NV12);
+	TestEqual(TEXT("NV12Layout.GetSecondChromaOffset()"), NV12Layout.GetSecondChromaOffset(), static_cast<int64>(INDEX_NONE));
+
+	TArray<uint8> NV12;
+	NV12.AddZeroed(NV12Layout.GetFrameSize());
+	TestTrue(TEXT("ConvertRGBToYUV (NV12)"), Compushady::Video::ConvertRGBToYUV(Pixels.GetData(), NV12Layout, ECompushadyYUVMatrix::BT709, NV12.GetData()));
+	TestEqual(TEXT("UV[0]"), NV12[8], ExpectedU);
+	TestEqual(TEXT("UV[1]"), NV12[9], ExpectedV);
+	TestEqual(TEXT("UV[2]"), NV12[10], static_cast<uint8>(128));
+
+	// both layouts must produce the same y4m frame
+	TArray<uint8> I420Y4M;
+	Compushady::Video::WriteY4MFrame(I420.GetData(), I420Layout, I420Y4M);
+	TArray<uint8> NV12Y4M;
+	Compushady::Video::WriteY4MFrame(NV12.GetData(), NV12Layout, NV12Y4M);
+	TestEqual(TEXT("I420Y4M.Num()"), I420Y4M.Num(), 6 + 12);
+	TestTrue(TEXT("I420Y4M == NV12Y4M"), I420Y4M == NV12Y4M);
+
+	TestFalse(TEXT("ConvertRGBToYUV (odd size)"), Compushady::Video::ConvertRGBToYUV(Pixels.GetData(), Compushady::Video::FCompushadyYUVFrameLayout(3, 2, ECompushadyYUVFormat::I420), ECompushadyYUVMatrix::BT709, I420.GetData()));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRawVideoTest_Y4MHeader, "Compushady.RawVideo.Y4MHeader", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRawVideoTest_Y4MHeader::RunTest(const FString& Parameters)
+{
+	TArray<uint8> Header;
+	Compushady::Video::WriteY4MHeader(1920, 1080, 30, Header);
+
+	FUTF8ToTCHAR Converter(reinterpret_cast<const UTF8CHAR*>(Header.GetData()), Header.Num());
+	const FString HeaderString(Converter.Length(), Converter.Get());
+	TestEqual(TEXT("Header"), HeaderString, FString(TEXT("YUV4MPEG2 W1920 H1080 F30:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n")));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRawVideoTest_ComputeConversion, "Compushady.RawVideo.ComputeConversion", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRawVideoTest_ComputeConversion::RunTest(const FString& Parameters)
+{
+	constexpr int32 Width = 20;
+	constexpr int32 Height = 6;
+
+	const TArray<FLinearColor> Pixels = CompushadyRawVideoWriterTests::MakeGradient(Width, Height);
+
+	UCompushadyUAV* Texture = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D(TestName, Width, Height, EPixelFormat::PF_A32B32G32R32F);
+	if (!TestNotNull(TEXT("Texture"), Texture))
+	{
+		return true;
+	}
+	Texture->UpdateTextureSliceSync(reinterpret_cast<const uint8*>(Pixels.GetData()), Pixels.Num() * sizeof(FLinearColor), 0);
+
+	for (const ECompushadyYUVFormat Format : { ECompushadyYUVFormat::I420, ECompushadyYUVFormat::NV12 })
+	{
+		const Compushady::Video::FCompushadyYUVFrameLayout Layout(Width, Height, Format, 8);
+
+		TArray<uint8> Expected;
+		Expected.AddZeroed(Layout.GetFrameSize());
+		Compushady::Video::ConvertRGBToYUV(Pixels.GetData(), Layout, ECompushadyYUVMatrix::BT601, Expected.GetData());
+
+		UCompushadyUAV* Output = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName + "_Output", Layout.GetFrameSize(), EPixelFormat::PF_R32_UINT);
+		if (!TestNotNull(TEXT("Output"), Output))
+		{
+			return true;
+		}
+
+		FString ErrorMessages;
+		Compushady::Video::FCompushadyYUVConverter Converter;
+		if (!TestTrue(TEXT("Converter.Initialize"), Converter.Initialize(ECompushadyYUVMatrix::BT601, false, false, ErrorMessages)))
+		{
+			AddError(ErrorMessages);
+			return true;
+		}
+
+		ENQUEUE_RENDER_COMMAND(DoCompushadyTestYUVConversion)(
+			[&Converter, Texture, Output, &Layout](FRHICommandListImmediate& RHICmdList)
+			{
+				RHICmdList.Transition(FRHITransitionInfo(Output->GetRHI(), ERHIAccess::Unknown, ERHIAccess::UAVCompute));
+				Converter.ConvertToBuffer_RenderThread(RHICmdList, Texture->GetTextureRHI(), Output->GetRHI(), Layout);
+			});
+
+		FlushRenderingCommands();
+
+		TArray<uint8> Converted;
+		Output->MapReadAndExecuteSync([&Converted, &Layout](const void* Data)
+			{
+				Converted.Append(reinterpret_cast<const uint8*>(Data), Layout.GetFrameSize());
+				return true;
+			});
+
+		// the GPU rounding can differ by one, padding bytes are not compared
+		int32 MaxDifference = 0;
+		TArray<uint8> ExpectedY4M;
+		Compushady::Video::WriteY4MFrame(Expected.GetData(), Layout, ExpectedY4M);
+		TArray<uint8> ConvertedY4M;
+		if (Converted.Num() == Layout.GetFrameSize())
+		{
+			Compushady::Video::WriteY4MFrame(Converted.GetData(), Layout, ConvertedY4M);
+		}
+
+		if (!TestEqual(TEXT("ConvertedY4M.Num()"), ConvertedY4M.Num(), ExpectedY4M.Num()))
+		{
+			return true;
+		}
+
+		for (int32 Index = 0; Index < ExpectedY4M.Num(); Index++)
+		{
+			MaxDifference = FMath::Max(MaxDifference, FMath::Abs(static_cast<int32>(ExpectedY4M[Index]) - static_cast<int32>(ConvertedY4M[Index])));
+		}
+
+		TestTrue(FString::Printf(TEXT("MaxDifference (%s)"), Format == ECompushadyYUVFormat::NV12 ? TEXT("NV12") : TEXT("I420")), MaxDifference <= 1);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,205 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyRayTracer.h"
+#include "Misc/AutomationTest.h"
+
+static Compushady::FCompushadyRayTracerPipelineKey CompushadyRayTracerTestUniqueKey()
+{
+	// the Guid ensures the key is not already in the cache
+	const FGuid Guid = FGuid::NewGuid();
+	Compushady::FCompushadyRayTracerPipelineKey Key;
+	FSHA1::HashBuffer(&Guid, sizeof(FGuid), Key.RayGenHash.Hash);
+	return Key;
+}
+
+static const TCHAR* CompushadyRayTracerTestRayGen = TEXT(
+	"struct Payload { float4 color; };"
+	"cbuffer Config : register(b0) { float4 tint; };"
+	"RaytracingAccelerationStructure scene : register(t0);"
+	"Buffer<float4> colors : register(t1);"
+	"RWTexture2D<float4> output : register(u0);"
+	"[shader(\"raygeneration\")] void main() {"
+	"  RayDesc ray; ray.Origin = float3(0, 0, 0); ray.Direction = float3(0, 0, 1); ray.TMin = 0; ray.TMax = 1000;"
+	"  Payload payload; payload.color = colors[0];"
+	"  TraceRay(scene, RAY_FLAG_NONE, 0xff, 0, 1, 0, ray, payload);"
+	"  output[DispatchRaysIndex().xy] = payload.color * tint; }");
+
+static const TCHAR* CompushadyRayTracerTestMiss = TEXT(
+	"struct Payload { float4 color; };"
+	"[shader(\"miss\")] void main(inout Payload payload) { payload.color = float4(0, 0, 0, 1); }");
+
+static const TCHAR* CompushadyRayTracerTestHitGroup = TEXT(
+	"struct Payload { float4 color; };"
+	"[shader(\"closesthit\")] void main(inout Payload payload, in BuiltInTriangleIntersectionAttributes attributes) { payload.color = float4(attributes.barycentrics, 0, 1); }");
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRayTracerTest_Pipeline, "Compushady.RayTracer.Pipeline", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRayTracerTest_Pipeline::RunTest(const FString& Parameters)
+{
+	if (!GRHISupportsRayTracing || !GRHISupportsRayTracingShaders || RHIGetInterfaceType() != ERHIInterfaceType::D3D12)
+	{
+		AddInfo(TEXT("RHI ray tracing is not supported, skipping"));
+		return true;
+	}
+
+	TArray<uint8> RayGenCode;
+	TArray<uint8> MissCode;
+	TArray<uint8> HitGroupCode;
+	Compushady::StringToShaderCode(CompushadyRayTracerTestRayGen, RayGenCode);
+	Compushady::StringToShaderCode(CompushadyRayTracerTestMiss, MissCode);
+	Compushady::StringToShaderCode(CompushadyRayTracerTestHitGroup, HitGroupCode);
+
+	const int64 NumCreatedPipelines = Compushady::RayTracerPipelineCache::GetNumCreatedPipelines();
+
+	FString ErrorMessages;
+	TStrongObjectPtr<UCompushadyRayTracer> RayTracer(NewObject<UCompushadyRayTracer>());
+	if (!TestTrue(TEXT("RayTracer->InitFromHLSL"), RayTracer->InitFromHLSL(RayGenCode, "main", MissCode, "main", HitGroupCode, "main", ErrorMessages)))
+	{
+		AddError(ErrorMessages);
+		return true;
+	}
+
+	// the bindings come from the reflection of the library functions
+	TestEqual(TEXT("RayGenResourceBindings.CBVs.Num()"), RayTracer->RayGenResourceBindings.CBVs.Num(), 1);
+	TestEqual(TEXT("RayGenResourceBindings.SRVs.Num()"), RayTracer->RayGenResourceBindings.SRVs.Num(), 2);
+	TestEqual(TEXT("RayGenResourceBindings.UAVs.Num()"), RayTracer->RayGenResourceBindings.UAVs.Num(), 1);
+	if (RayTracer->RayGenResourceBindings.SRVs.Num() == 2)
+	{
+		TestEqual(TEXT("RayGenResourceBindings.SRVs[0].Name"), RayTracer->RayGenResourceBindings.SRVs[0].Name, "scene");
+		TestEqual(TEXT("RayGenResourceBindings.SRVs[1].Name"), RayTracer->RayGenResourceBindings.SRVs[1].Name, "colors");
+	}
+	TestEqual(TEXT("RayMissResourceBindings.UAVs.Num()"), RayTracer->RayMissResourceBindings.UAVs.Num(), 0);
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(RayTracer.Get(), TEXT("StoreLastSignal"));
+
+	// an empty resource array does not match the raygen bindings
+	RayTracer->DispatchRays({}, FIntVector(1, 1, 1), Signal);
+	TestFalse(TEXT("RayTracer->bLastSuccess"), RayTracer->bLastSuccess);
+	TestEqual(TEXT("RayTracer->NumStoredSignals"), RayTracer->NumStoredSignals, 1);
+
+	// same shaders, so the pipeline is shared through the cache
+	TStrongObjectPtr<UCompushadyRayTracer> RayTracer2(NewObject<UCompushadyRayTracer>());
+	TestTrue(TEXT("RayTracer2->InitFromHLSL"), RayTracer2->InitFromHLSL(RayGenCode, "main", MissCode, "main", HitGroupCode, "main", ErrorMessages));
+	TestTrue(TEXT("NumCreatedPipelines"), Compushady::RayTracerPipelineCache::GetNumCreatedPipelines() - NumCreatedPipelines <= 1);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, RayTracer, RayTracer2, NumCreatedPipelines]()
+		{
+			if (!RayTracer->IsPipelineReady() || !RayTracer2->IsPipelineReady())
+			{
+				return false;
+			}
+
+			TestTrue(TEXT("NumCreatedPipelines"), Compushady::RayTracerPipelineCache::GetNumCreatedPipelines() - NumCreatedPipelines <= 1);
+
+			// already in the cache, so immediately ready
+			FString ErrorMessages;
+			TArray<uint8> RayGenCode;
+			TArray<uint8> MissCode;
+			TArray<uint8> HitGroupCode;
+			Compushady::StringToShaderCode(CompushadyRayTracerTestRayGen, RayGenCode);
+			Compushady::StringToShaderCode(CompushadyRayTracerTestMiss, MissCode);
+			Compushady::StringToShaderCode(CompushadyRayTracerTestHitGroup, HitGroupCode);
+
+			TStrongObjectPtr<UCompushadyRayTracer> RayTracer3(NewObject<UCompushadyRayTracer>());
+			TestTrue(TEXT("RayTracer3->InitFromHLSL"), RayTracer3->InitFromHLSL(RayGenCode, "main", MissCode, "main", HitGroupCode, "main", ErrorMessages));
+			TestTrue(TEXT("RayTracer3->IsPipelineReady()"), RayTracer3->IsPipelineReady());
+			TestTrue(TEXT("NumCreatedPipelines"), Compushady::RayTracerPipelineCache::GetNumCreatedPipelines() - NumCreatedPipelines <= 1);
+			return true;
+		}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRayTracerTest_PipelineCacheFailure, "Compushady.RayTracer.PipelineCacheFailure", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRayTracerTest_PipelineCacheFailure::RunTest(const FString& Parameters)
+{
+	const Compushady::FCompushadyRayTracerPipelineKey Key = CompushadyRayTracerTestUniqueKey();
+
+	TSharedRef<int32> NumFailures = MakeShared<int32>(0);
+
+	Compushady::RayTracerPipelineCache::GetOrCreate(Key, [](FRHICommandListImmediate& RHICmdList)
+		{
+			return nullptr;
+		},
+		[NumFailures](FRayTracingPipelineState* PipelineState)
+		{
+			if (!PipelineState)
+			{
+				(*NumFailures)++;
+			}
+		});
+
+	const int64 NumCreatedPipelines = Compushady::RayTracerPipelineCache::GetNumCreatedPipelines();
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Key, NumFailures, NumCreatedPipelines]()
+		{
+			if (*NumFailures == 0)
+			{
+				return false;
+			}
+
+			// failures are not cached
+			Compushady::RayTracerPipelineCache::GetOrCreate(Key, [](FRHICommandListImmediate& RHICmdList)
+				{
+					return nullptr;
+				},
+				[](FRayTracingPipelineState* PipelineState)
+				{
+				});
+
+			TestEqual(TEXT("NumCreatedPipelines"), Compushady::RayTracerPipelineCache::GetNumCreatedPipelines() - NumCreatedPipelines, 1);
+			return true;
+		}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyRayTracerTest_QueuedDispatches, "Compushady.RayTracer.QueuedDispatches", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyRayTracerTest_QueuedDispatches::RunTest(const FString& Parameters)
+{
+	TStrongObjectPtr<UCompushadyRayTracer> RayTracer(NewObject<UCompushadyRayTracer>());
+
+	FCompushadySignaled Signal;
+	Signal.BindUFunction(RayTracer.Get(), TEXT("StoreLastSignal"));
+
+	// not initialized
+	RayTracer->DispatchRays({}, FIntVector(1, 1, 1), Signal);
+	TestFalse(TEXT("RayTracer->bLastSuccess"), RayTracer->bLastSuccess);
+	TestEqual(TEXT("RayTracer->NumStoredSignals"), RayTracer->NumStoredSignals, 1);
+
+	// the pipeline creation will fail, so the dispatches can be checked without ray tracing support
+	RayTracer->RequestPipelineState(CompushadyRayTracerTestUniqueKey(), [](FRHICommandListImmediate& RHICmdList)
+		{
+			return nullptr;
+		});
+
+	RayTracer->DispatchRays({}, FIntVector(1, 1, 1), Signal);
+	RayTracer->DispatchRays({}, FIntVector(2, 1, 1), Signal);
+	RayTracer->DispatchRays({}, FIntVector(3, 1, 1), Signal);
+
+	TestFalse(TEXT("RayTracer->IsPipelineReady()"), RayTracer->IsPipelineReady());
+	TestEqual(TEXT("RayTracer->GetNumQueuedDispatches()"), RayTracer->GetNumQueuedDispatches(), 3);
+	TestEqual(TEXT("RayTracer->NumStoredSignals"), RayTracer->NumStoredSignals, 1);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, RayTracer]()
+		{
+			if (RayTracer->GetNumQueuedDispatches() > 0)
+			{
+				return false;
+			}
+
+			// every queued dispatch must be signaled
+			TestEqual(TEXT("RayTracer->NumStoredSignals"), RayTracer->NumStoredSignals, 4);
+			TestFalse(TEXT("RayTracer->bLastSuccess"), RayTracer->bLastSuccess);
+			TestEqual(TEXT("RayTracer->LastErrorMessages"), RayTracer->LastErrorMessages, "Unable to create RayTracer Pipeline State");
+			return true;
+		}));
+
+	return true;
+}
+
+#endif
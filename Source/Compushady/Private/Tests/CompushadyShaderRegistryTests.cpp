@@ -0,0 +1,114 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyShaderRegistry.h"
+#include "Misc/AutomationTest.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyShaderRegistryTest_Deduplicate, "Compushady.ShaderRegistry.Deduplicate", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyShaderRegistryTest_Deduplicate::RunTest(const FString& Parameters)
+{
+	// the Guid ensures the shader is not already registered by another test
+	const FString Code = FString::Printf(TEXT("RWBuffer<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = 0x%08x; }"), FGuid::NewGuid().A);
+
+	const int64 NumCreatedShaders = Compushady::ShaderRegistry::GetNumCreatedShaders();
+
+	TArray<TStrongObjectPtr<UCompushadyCompute>> Computes;
+	for (int32 Index = 0; Index < 100; Index++)
+	{
+		FString ErrorMessages;
+		UCompushadyCompute* Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code, ErrorMessages, "main");
+		if (!TestNotNull(TEXT("Compute"), Compute))
+		{
+			return true;
+		}
+		Computes.Add(TStrongObjectPtr<UCompushadyCompute>(Compute));
+	}
+
+	TestEqual(TEXT("NumCreatedShaders"), Compushady::ShaderRegistry::GetNumCreatedShaders() - NumCreatedShaders, 1);
+
+	FRHIComputeShader* ComputeShader = Computes[0]->GetRHI().GetReference();
+	for (const TStrongObjectPtr<UCompushadyCompute>& Compute : Computes)
+	{
+		TestTrue(TEXT("SameShader"), Compute->GetRHI().GetReference() == ComputeShader);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyShaderRegistryTest_DifferentShaders, "Compushady.ShaderRegistry.DifferentShaders", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyShaderRegistryTest_DifferentShaders::RunTest(const FString& Parameters)
+{
+	const uint32 Value = FGuid::NewGuid().A;
+	const FString Code0 = FString::Printf(TEXT("RWBuffer<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = 0x%08x; }"), Value);
+	const FString Code1 = FString::Printf(TEXT("RWBuffer<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = 0x%08x; }"), Value + 1);
+
+	FString ErrorMessages;
+	TStrongObjectPtr<UCompushadyCompute> Compute0(UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code0, ErrorMessages, "main"));
+	TStrongObjectPtr<UCompushadyCompute> Compute1(UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code1, ErrorMessages, "main"));
+
+	TestTrue(TEXT("DifferentShaders"), Compute0->GetRHI().GetReference() != Compute1->GetRHI().GetReference());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyShaderRegistryTest_Leak, "Compushady.ShaderRegistry.Leak", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyShaderRegistryTest_Leak::RunTest(const FString& Parameters)
+{
+	const FString Code = FString::Printf(TEXT("RWBuffer<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = 0x%08x; }"), FGuid::NewGuid().A);
+
+	FSHAHash Hash;
+	{
+		TArray<FComputeShaderRHIRef> ComputeShaders;
+		for (int32 Index = 0; Index < 100; Index++)
+		{
+			TArray<uint8> ShaderCode;
+			Compushady::StringToShaderCode(Code, ShaderCode);
+			FCompushadyResourceBindings ResourceBindings;
+			FIntVector ThreadGroupSize;
+			FString ErrorMessages;
+			ComputeShaders.Add(Compushady::Utils::CreateComputeShaderFromHLSL(ShaderCode, "main", ResourceBindings, ThreadGroupSize, ErrorMessages));
+		}
+
+		Hash = ComputeShaders[0]->GetHash();
+
+		// still referenced
+		Compushady::ShaderRegistry::Purge();
+		TestTrue(TEXT("Contains"), Compushady::ShaderRegistry::Contains(SF_Compute, Hash));
+	}
+
+	Compushady::ShaderRegistry::Purge();
+	TestFalse(TEXT("Contains"), Compushady::ShaderRegistry::Contains(SF_Compute, Hash));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyShaderRegistryTest_LeakCompute, "Compushady.ShaderRegistry.LeakCompute", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyShaderRegistryTest_LeakCompute::RunTest(const FString& Parameters)
+{
+	const FString Code = FString::Printf(TEXT("RWBuffer<uint> Output; [numthreads(1,1,1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = 0x%08x; }"), FGuid::NewGuid().A);
+
+	FSHAHash Hash;
+	{
+		TArray<TStrongObjectPtr<UCompushadyCompute>> Computes;
+		for (int32 Index = 0; Index < 100; Index++)
+		{
+			FString ErrorMessages;
+			Computes.Add(TStrongObjectPtr<UCompushadyCompute>(UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString(Code, ErrorMessages, "main")));
+		}
+		Hash = Computes[0]->GetRHI()->GetHash();
+	}
+
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+	Compushady::ShaderRegistry::Purge();
+	TestFalse(TEXT("Contains"), Compushady::ShaderRegistry::Contains(SF_Compute, Hash));
+
+	return true;
+}
+
+#endif
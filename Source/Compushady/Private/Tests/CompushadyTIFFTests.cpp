@@ -0,0 +1,576 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyTIFF.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace CompushadyTIFFTests
+{
+	struct FTIFFPage
+	{
+		uint32 Width = 0;
+		uint32 Height = 0;
+		uint16 NumComponents = 0;
+		uint16 BitsPerComponent = 0;
+		uint16 SampleFormat = 0;
+		uint16 Compression = 0;
+		uint16 Predictor = 1;
+		bool bTiled = false;
+		FString ImageDescription;
+		TArray<uint8> Pixels;
+	};
+
+	static uint64 ReadValue(const TArray<uint8>& Data, const uint64 Offset, const int32 Size)
+	{
+		uint64 Value = 0;
+		if (Offset + Size <= static_cast<uint64>(Data.Num()))
+		{
+			FMemory::Memcpy(&Value, Data.GetData() + Offset, Size);
+		}
+		return Value;
+	}
+
+	static bool LZWDecompress(const uint8* Data, const int64 Size, TArray<uint8>& Output)
+	{
+		TArray<TArray<uint8>> Table;
+		int32 CodeWidth = 9;
+		int32 Previous = -1;
+		int64 BitOffset = 0;
+
+		auto ResetTable = [&]()
+			{
+				Table.SetNum(258);
+				for (int32 Index = 0; Index < 256; Index++)
+				{
+					Table[Index] = { static_cast<uint8>(Index) };
+				}
+				CodeWidth = 9;
+				Previous = -1;
+			};
+
+		ResetTable();
+
+		for (;;)
+		{
+			if (BitOffset + CodeWidth > Size * 8)
+			{
+				return false;
+			}
+
+			uint32 Code = 0;
+			for (int32 Bit = 0; Bit < CodeWidth; Bit++, BitOffset++)
+			{
+				Code = (Code << 1) | ((Data[BitOffset >> 3] >> (7 - (BitOffset & 7))) & 1);
+			}
+
+			if (Code == 257)
+			{
+				return true;
+			}
+
+			if (Code == 256)
+			{
+				ResetTable();
+				continue;
+			}
+
+			if (Previous < 0)
+			{
+				if (Code > 255)
+				{
+					return false;
+				}
+				Output.Add(static_cast<uint8>(Code));
+				Previous = Code;
+				continue;
+			}
+
+			TArray<uint8> Entry;
+			if (Code < static_cast<uint32>(Table.Num()))
+			{
+				Entry = Table[Code];
+			}
+			else if (Code == static_cast<uint32>(Table.Num()))
+			{
+				Entry = Table[Previous];
+				Entry.Add(Table[Previous][0]);
+			}
+			else
+			{
+				return false;
+			}
+
+			TArray<uint8> NewEntry = Table[Previous];
+			NewEntry.Add(Entry[0]);
+			Table.Add(MoveTemp(NewEntry));
+
+			Output.Append(Entry);
+			Previous = Code;
+
+			// early change
+			if (Table.Num() >= (1 << CodeWidth) - 1 && CodeWidth < 12)
+			{
+				CodeWidth++;
+			}
+		}
+	}
+
+	static void UndoPredictor(uint8* Row, const uint32 Width, const FTIFFPage& Page)
+	{
+		const uint32 NumSamples = Width * Page.NumComponents;
+		if (Page.Predictor == 2)
+		{
+			for (uint32 Index = Page.NumComponents; Index < NumSamples; Index++)
+			{
+				if (Page.BitsPerComponent == 8)
+				{
+					Row[Index] += Row[Index - Page.NumComponents];
+				}
+				else if (Page.BitsPerComponent == 16)
+				{
+					reinterpret_cast<uint16*>(Row)[Index] += reinterpret_cast<uint16*>(Row)[Index - Page.NumComponents];
+				}
+				else
+				{
+					reinterpret_cast<uint32*>(Row)[Index] += reinterpret_cast<uint32*>(Row)[Index - Page.NumComponents];
+				}
+			}
+		}
+		else if (Page.Predictor == 3)
+		{
+			const uint32 BytesPerComponent = Page.BitsPerComponent / 8;
+			const uint32 RowSize = NumSamples * BytesPerComponent;
+			for (uint32 Index = Page.NumComponents; Index < RowSize; Index++)
+			{
+				Row[Index] += Row[Index - Page.NumComponents];
+			}
+
+			TArray<uint8> Planes(Row, RowSize);
+			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+			{
+				for (uint32 ByteIndex = 0; ByteIndex < BytesPerComponent; ByteIndex++)
+				{
+					Row[SampleIndex * BytesPerComponent + (BytesPerComponent - 1 - ByteIndex)] = Planes[ByteIndex * NumSamples + SampleIndex];
+				}
+			}
+		}
+	}
+
+	/* Minimal reader supporting the subset of TIFF/BigTIFF produced by FCompushadyTIFFWriter */
+	static bool ReadTIFF(const TArray<uint8>& Data, TArray<FTIFFPage>& Pages)
+	{
+		if (Data.Num() < 16 || Data[0] != 'I' || Data[1] != 'I')
+		{
+			return false;
+		}
+
+		const uint16 Version = static_cast<uint16>(ReadValue(Data, 2, 2));
+		if (Version != 42 && Version != 43)
+		{
+			return false;
+		}
+
+		const bool bBigTIFF = Version == 43;
+		const int32 FieldSize = bBigTIFF ? 8 : 4;
+		uint64 IFDOffset = ReadValue(Data, bBigTIFF ? 8 : 4, FieldSize);
+
+		while (IFDOffset != 0)
+		{
+			const uint64 NumEntries = ReadValue(Data, IFDOffset, bBigTIFF ? 8 : 2);
+			const uint64 EntriesOffset = IFDOffset + (bBigTIFF ? 8 : 2);
+			const uint64 EntrySize = bBigTIFF ? 20 : 12;
+			if (NumEntries == 0 || EntriesOffset + NumEntries * EntrySize + FieldSize > static_cast<uint64>(Data.Num()))
+			{
+				return false;
+			}
+
+			TMap<uint16, TArray<uint64>> Tags;
+			for (uint64 EntryIndex = 0; EntryIndex < NumEntries; EntryIndex++)
+			{
+				const uint64 EntryOffset = EntriesOffset + EntryIndex * EntrySize;
+				const uint16 Tag = static_cast<uint16>(ReadValue(Data, EntryOffset, 2));
+				const uint16 Type = static_cast<uint16>(ReadValue(Data, EntryOffset + 2, 2));
+				const uint64 Count = ReadValue(Data, EntryOffset + 4, bBigTIFF ? 8 : 4);
+				const uint64 FieldOffset = EntryOffset + (bBigTIFF ? 12 : 8);
+
+				int32 TypeSize = 0;
+				switch (Type)
+				{
+				case 2:
+					TypeSize = 1;
+					break;
+				case 3:
+					TypeSize = 2;
+					break;
+				case 4:
+					TypeSize = 4;
+					break;
+				case 5:
+				case 16:
+					TypeSize = 8;
+					break;
+				default:
+					return false;
+				}
+
+				const uint64 ValuesOffset = Count * TypeSize <= static_cast<uint64>(FieldSize) ? FieldOffset : ReadValue(Data, FieldOffset, FieldSize);
+				if (ValuesOffset + Count * TypeSize > static_cast<uint64>(Data.Num()))
+				{
+					return false;
+				}
+
+				TArray<uint64>& Values = Tags.Add(Tag);
+				for (uint64 ValueIndex = 0; ValueIndex < Count; ValueIndex++)
+				{
+					Values.Add(ReadValue(Data, ValuesOffset + ValueIndex * TypeSize, TypeSize));
+				}
+			}
+
+			for (const uint16 RequiredTag : { 0x100, 0x101, 0x102, 0x103, 0x115, 0x153 })
+			{
+				if (!Tags.Contains(RequiredTag))
+				{
+					return false;
+				}
+			}
+
+			FTIFFPage& Page = Pages.AddDefaulted_GetRef();
+			Page.Width = static_cast<uint32>(Tags[0x100][0]);
+			Page.Height = static_cast<uint32>(Tags[0x101][0]);
+			Page.BitsPerComponent = static_cast<uint16>(Tags[0x102][0]);
+			Page.Compression = static_cast<uint16>(Tags[0x103][0]);
+			Page.NumComponents = static_cast<uint16>(Tags[0x115][0]);
+			Page.SampleFormat = static_cast<uint16>(Tags[0x153][0]);
+			Page.bTiled = Tags.Contains(0x142);
+			if (Tags.Contains(0x13d))
+			{
+				Page.Predictor = static_cast<uint16>(Tags[0x13d][0]);
+			}
+			if (Tags.Contains(0x10e))
+			{
+				TArray<uint8> ASCII;
+				for (const uint64 Char : Tags[0x10e])
+				{
+					ASCII.Add(static_cast<uint8>(Char));
+				}
+				Page.ImageDescription = UTF8_TO_TCHAR(reinterpret_cast<const char*>(ASCII.GetData()));
+			}
+
+			const uint32 PixelSize = Page.NumComponents * Page.BitsPerComponent / 8;
+			const uint32 ChunkWidth = Page.bTiled ? static_cast<uint32>(Tags[0x142][0]) : Page.Width;
+			const uint32 ChunkHeight = static_cast<uint32>(Page.bTiled ? Tags[0x143][0] : Tags[0x116][0]);
+			const uint32 ChunksAcross = FMath::DivideAndRoundUp(Page.Width, ChunkWidth);
+			const TArray<uint64>& ChunkOffsets = Tags[Page.bTiled ? 0x144 : 0x111];
+			const TArray<uint64>& ChunkByteCounts = Tags[Page.bTiled ? 0x145 : 0x117];
+			if (ChunkOffsets.Num() != static_cast<int32>(ChunksAcross * FMath::DivideAndRoundUp(Page.Height, ChunkHeight)) || ChunkByteCounts.Num() != ChunkOffsets.Num())
+			{
+				return false;
+			}
+
+			Page.Pixels.AddZeroed(Page.Width * Page.Height * PixelSize);
+
+			for (int32 ChunkIndex = 0; ChunkIndex < ChunkOffsets.Num(); ChunkIndex++)
+			{
+				const uint32 ChunkX = (ChunkIndex % ChunksAcross) * ChunkWidth;
+				const uint32 ChunkY = (ChunkIndex / ChunksAcross) * ChunkHeight;
+				const uint32 NumRows = Page.bTiled ? ChunkHeight : FMath::Min(ChunkHeight, Page.Height - ChunkY);
+				const uint32 ChunkRowSize = ChunkWidth * PixelSize;
+
+				if (ChunkOffsets[ChunkIndex] + ChunkByteCounts[ChunkIndex] > static_cast<uint64>(Data.Num()))
+				{
+					return false;
+				}
+
+				const uint8* Compressed = Data.GetData() + ChunkOffsets[ChunkIndex];
+				const int32 CompressedSize = static_cast<int32>(ChunkByteCounts[ChunkIndex]);
+
+				TArray<uint8> Chunk;
+				if (Page.Compression == 1)
+				{
+					Chunk.Append(Compressed, CompressedSize);
+				}
+				else if (Page.Compression == 5)
+				{
+					if (!LZWDecompress(Compressed, CompressedSize, Chunk))
+					{
+						return false;
+					}
+				}
+				else if (Page.Compression == 8)
+				{
+					Chunk.SetNumUninitialized(ChunkRowSize * NumRows);
+					if (!FCompression::UncompressMemory(NAME_Zlib, Chunk.GetData(), Chunk.Num(), Compressed, CompressedSize))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					return false;
+				}
+
+				if (Chunk.Num() != static_cast<int32>(ChunkRowSize * NumRows))
+				{
+					return false;
+				}
+
+				for (uint32 Y = 0; Y < NumRows && ChunkY + Y < Page.Height; Y++)
+				{
+					uint8* Row = Chunk.GetData() + Y * ChunkRowSize;
+					UndoPredictor(Row, ChunkWidth, Page);
+					FMemory::Memcpy(Page.Pixels.GetData() + ((ChunkY + Y) * Page.Width + ChunkX) * PixelSize, Row, FMath::Min(ChunkWidth, Page.Width - ChunkX) * PixelSize);
+				}
+			}
+
+			IFDOffset = ReadValue(Data, EntriesOffset + NumEntries * EntrySize, FieldSize);
+		}
+
+		return Pages.Num() > 0;
+	}
+
+	/* Pixels with some structure (so that predictors and compression have something to work on) plus noise */
+	static TArray<uint8> MakePixels(const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const int32 Stride, const int32 Seed)
+	{
+		FRandomStream RandomStream(Seed);
+		const int32 PixelSize = GPixelFormats[PixelFormat].BlockBytes;
+		const int32 NumComponents = GPixelFormats[PixelFormat].NumComponents;
+
+		TArray<uint8> Pixels;
+		Pixels.AddZeroed(Stride * Height);
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				uint8* Pixel = Pixels.GetData() + Y * Stride + X * PixelSize;
+				for (int32 Component = 0; Component < NumComponents; Component++)
+				{
+					const float Value = FMath::Sin(X * 0.1f + Component) * FMath::Cos(Y * 0.07f) + RandomStream.FRandRange(-0.01f, 0.01f);
+					switch (PixelSize / NumComponents)
+					{
+					case 1:
+						Pixel[Component] = static_cast<uint8>((Value + 1) * 127);
+						break;
+					case 2:
+						if (PixelFormat == EPixelFormat::PF_FloatRGBA)
+						{
+							reinterpret_cast<FFloat16*>(Pixel)[Component] = FFloat16(Value);
+						}
+						else
+						{
+							reinterpret_cast<uint16*>(Pixel)[Component] = static_cast<uint16>((Value + 1) * 32767);
+						}
+						break;
+					default:
+						reinterpret_cast<float*>(Pixel)[Component] = Value;
+						break;
+					}
+				}
+			}
+		}
+		return Pixels;
+	}
+
+	static bool ComparePixels(const TArray<uint8>& Pixels, const int32 Stride, const FTIFFPage& Page)
+	{
+		const int32 RowSize = Page.Width * Page.NumComponents * Page.BitsPerComponent / 8;
+		for (uint32 Y = 0; Y < Page.Height; Y++)
+		{
+			if (FMemory::Memcmp(Pixels.GetData() + Y * Stride, Page.Pixels.GetData() + Y * RowSize, RowSize) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyTIFFTest_LZW, "Compushady.TIFF.LZW", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyTIFFTest_LZW::RunTest(const FString& Parameters)
+{
+	FRandomStream RandomStream(17);
+
+	// repetitive data fills the 12 bits table multiple times, noise grows the codes quickly
+	TArray<uint8> Repetitive;
+	TArray<uint8> Noise;
+	for (int32 Index = 0; Index < 1024 * 1024; Index++)
+	{
+		Repetitive.Add(static_cast<uint8>((Index / 7) % 13 + (RandomStream.RandRange(0, 3) == 0)));
+		Noise.Add(static_cast<uint8>(RandomStream.RandRange(0, 255)));
+	}
+
+	for (const TArray<uint8>& Data : { TArray<uint8>(), TArray<uint8>({ 42 }), Repetitive, Noise })
+	{
+		TArray<uint8> Compressed;
+		Compushady::TIFF::LZWCompress(Data.GetData(), Data.Num(), Compressed);
+
+		TArray<uint8> Decompressed;
+		TestTrue(FString::Printf(TEXT("LZWDecompress %d"), Data.Num()), CompushadyTIFFTests::LZWDecompress(Compressed.GetData(), Compressed.Num(), Decompressed));
+		TestTrue(FString::Printf(TEXT("Decompressed == Data %d"), Data.Num()), Decompressed == Data);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyTIFFTest_RoundTrip, "Compushady.TIFF.RoundTrip", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyTIFFTest_RoundTrip::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyTIFFTests;
+
+	// odd sizes, so that tiles are padded and strips are truncated
+	constexpr int32 Width = 77;
+	constexpr int32 Height = 45;
+
+	for (const EPixelFormat PixelFormat : { EPixelFormat::PF_R8G8B8A8, EPixelFormat::PF_R16G16B16A16_UINT, EPixelFormat::PF_R32_FLOAT, EPixelFormat::PF_FloatRGBA })
+	{
+		const int32 Stride = Width * GPixelFormats[PixelFormat].BlockBytes + 12;
+		const TArray<uint8> Pixels = MakePixels(Width, Height, PixelFormat, Stride, static_cast<int32>(PixelFormat));
+
+		TArray<uint8> Uncompressed;
+		TestTrue(TEXT("GenerateTIFF"), Compushady::Utils::GenerateTIFF(Pixels.GetData(), Stride, Width, Height, PixelFormat, "", Uncompressed));
+
+		for (const ECompushadyTIFFCompression Compression : { ECompushadyTIFFCompression::None, ECompushadyTIFFCompression::LZW, ECompushadyTIFFCompression::Deflate })
+		{
+			for (const bool bPredictor : { false, true })
+			{
+				for (const int32 TileSize : { 0, 16, 32 })
+				{
+					FCompushadyTIFFConfig Config;
+					Config.Compression = Compression;
+					Config.bPredictor = bPredictor;
+					Config.TileSize = TileSize;
+					Config.RowsPerStrip = 10;
+
+					const FString Name = FString::Printf(TEXT("%s Compression %d Predictor %d TileSize %d"), GPixelFormats[PixelFormat].Name, static_cast<int32>(Compression), bPredictor ? 1 : 0, TileSize);
+
+					TArray<uint8> TIFFData;
+					if (!TestTrue(*FString::Printf(TEXT("GenerateTIFF %s"), *Name), Compushady::Utils::GenerateTIFF(Pixels.GetData(), Stride, Width, Height, PixelFormat, "Compushady", Config, TIFFData)))
+					{
+						continue;
+					}
+
+					TArray<FTIFFPage> Pages;
+					if (!TestTrue(*FString::Printf(TEXT("ReadTIFF %s"), *Name), ReadTIFF(TIFFData, Pages)))
+					{
+						continue;
+					}
+
+					TestEqual(*FString::Printf(TEXT("Pages.Num() %s"), *Name), Pages.Num(), 1);
+					TestEqual(*FString::Printf(TEXT("Width %s"), *Name), Pages[0].Width, static_cast<uint32>(Width));
+					TestEqual(*FString::Printf(TEXT("Height %s"), *Name), Pages[0].Height, static_cast<uint32>(Height));
+					TestEqual(*FString::Printf(TEXT("bTiled %s"), *Name), Pages[0].bTiled, TileSize > 0);
+					TestEqual(*FString::Printf(TEXT("ImageDescription %s"), *Name), Pages[0].ImageDescription, FString("Compushady"));
+					TestTrue(*FString::Printf(TEXT("Pixels %s"), *Name), ComparePixels(Pixels, Stride, Pages[0]));
+
+					// noisy float data may not shrink, smooth 8 bit data always does
+					if (Compression != ECompushadyTIFFCompression::None && bPredictor && PixelFormat == EPixelFormat::PF_R8G8B8A8)
+					{
+						TestTrue(*FString::Printf(TEXT("Compressed %s"), *Name), TIFFData.Num() < Uncompressed.Num());
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyTIFFTest_MultiPage, "Compushady.TIFF.MultiPage", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyTIFFTest_MultiPage::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyTIFFTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyTIFFTest.tiff"));
+
+	for (const bool bBigTIFF : { false, true })
+	{
+		FCompushadyTIFFConfig Config;
+		Config.Compression = ECompushadyTIFFCompression::Deflate;
+		Config.bPredictor = true;
+		Config.TileSize = 16;
+		Config.bBigTIFF = bBigTIFF;
+
+		constexpr int32 NumPages = 5;
+		constexpr int32 Width = 200;
+		constexpr int32 Height = 150;
+		const int32 Stride = Width * sizeof(float);
+
+		TArray<TArray<uint8>> Slices;
+
+		FString ErrorMessages;
+		TSharedPtr<Compushady::TIFF::FCompushadyTIFFWriter> Writer = Compushady::TIFF::FCompushadyTIFFWriter::Create(Filename, Config, ErrorMessages);
+		if (!TestTrue(TEXT("Create"), Writer.IsValid()))
+		{
+			return true;
+		}
+
+		for (int32 PageIndex = 0; PageIndex < NumPages; PageIndex++)
+		{
+			Slices.Add(MakePixels(Width, Height, EPixelFormat::PF_R32_FLOAT, Stride, PageIndex));
+			TestTrue(TEXT("AddPage"), Writer->AddPage(Slices[PageIndex].GetData(), Stride, Width, Height, EPixelFormat::PF_R32_FLOAT, PageIndex == 0 ? TEXT("Volume") : TEXT(""), ErrorMessages));
+			TestEqual(TEXT("GetNumPages"), Writer->GetNumPages(), PageIndex + 1);
+		}
+
+		const int64 WrittenBytes = Writer->GetWrittenBytes();
+		TestTrue(TEXT("Close"), Writer->Close(ErrorMessages));
+		TestFalse(TEXT("AddPage (closed)"), Writer->AddPage(Slices[0].GetData(), Stride, Width, Height, EPixelFormat::PF_R32_FLOAT, TEXT(""), ErrorMessages));
+
+		TArray<uint8> FileData;
+		if (!TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename)))
+		{
+			return true;
+		}
+
+		TestEqual(TEXT("WrittenBytes"), WrittenBytes, static_cast<int64>(FileData.Num()));
+		TestEqual(TEXT("Version"), static_cast<int32>(ReadValue(FileData, 2, 2)), bBigTIFF ? 43 : 42);
+
+		TArray<FTIFFPage> Pages;
+		if (!TestTrue(TEXT("ReadTIFF"), ReadTIFF(FileData, Pages)))
+		{
+			return true;
+		}
+
+		if (TestEqual(TEXT("Pages.Num()"), Pages.Num(), NumPages))
+		{
+			TestEqual(TEXT("ImageDescription"), Pages[0].ImageDescription, FString("Volume"));
+			for (int32 PageIndex = 0; PageIndex < NumPages; PageIndex++)
+			{
+				TestEqual(TEXT("Predictor"), Pages[PageIndex].Predictor, static_cast<uint16>(3));
+				TestTrue(FString::Printf(TEXT("Pixels %d"), PageIndex), ComparePixels(Slices[PageIndex], Stride, Pages[PageIndex]));
+			}
+		}
+
+		IFileManager::Get().Delete(*Filename);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyTIFFTest_InvalidConfig, "Compushady.TIFF.InvalidConfig", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyTIFFTest_InvalidConfig::RunTest(const FString& Parameters)
+{
+	const TArray<uint8> Pixels = CompushadyTIFFTests::MakePixels(8, 8, EPixelFormat::PF_R8G8B8A8, 32, 0);
+
+	FCompushadyTIFFConfig Config;
+	Config.TileSize = 20;
+
+	FString ErrorMessages;
+	TArray<uint8> TIFFData;
+	FMemoryWriter MemoryWriter(TIFFData);
+	Compushady::TIFF::FCompushadyTIFFWriter Writer(MemoryWriter, Config);
+	TestFalse(TEXT("AddPage (TileSize)"), Writer.AddPage(Pixels.GetData(), 32, 8, 8, EPixelFormat::PF_R8G8B8A8, TEXT(""), ErrorMessages));
+	TestFalse(TEXT("AddPage (BC1)"), Writer.AddPage(Pixels.GetData(), 32, 8, 8, EPixelFormat::PF_DXT1, TEXT(""), ErrorMessages));
+	TestEqual(TEXT("GetNumPages"), Writer.GetNumPages(), 0);
+
+	return true;
+}
+
+#endif
@@ -267,4 +267,60 @@ bool FCompushadyUAVTest_Texture3DSlice0::RunTest(const FString& Parameters)
 	return true;
 }
 
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyUAVTest_VersionPropagation, "Compushady.UAV.VersionPropagation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyUAVTest_VersionPropagation::RunTest(const FString& Parameters)
+{
+	FString ErrorMessages;
+	UCompushadyCompute* Compute = UCompushadyFunctionLibrary::CreateCompushadyComputeFromHLSLString("RWBuffer<uint> Output; [numthreads(1, 1, 1)] void main(uint3 tid : SV_DispatchThreadID) { Output[tid.x] = tid.x; }", ErrorMessages, "main");
+	if (!TestNotNull(TEXT("Compute"), Compute))
+	{
+		return true;
+	}
+
+	UCompushadyUAV* UAV = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName, 32, EPixelFormat::PF_R32_UINT);
+
+	// an SRV created from the UAV shares its version
+	UCompushadySRV* SRV = UCompushadyFunctionLibrary::CreateCompushadySRVFromResource(UAV, 0, 0, 1, 1, EPixelFormat::PF_R32_UINT);
+	if (!TestNotNull(TEXT("SRV"), SRV))
+	{
+		return true;
+	}
+
+	const int64 Version = UAV->GetVersion();
+	TestEqual(TEXT("SRV->GetVersion()"), SRV->GetVersion(), Version);
+
+	UAV->MapWriteAndExecuteSync([](void* Data)
+		{
+			FMemory::Memzero(Data, 32);
+			return true;
+		});
+	TestEqual(TEXT("Upload UAV->GetVersion()"), UAV->GetVersion(), Version + 1);
+	TestEqual(TEXT("Upload SRV->GetVersion()"), SRV->GetVersion(), Version + 1);
+
+	UAV->ClearBufferWithIntSync(0);
+	TestEqual(TEXT("Clear SRV->GetVersion()"), SRV->GetVersion(), Version + 2);
+
+	FCompushadyResourceArray ResourceArray;
+	ResourceArray.UAVs = { UAV };
+	TestTrue(TEXT("DispatchSync"), Compute->DispatchSync(ResourceArray, FIntVector(8, 1, 1), ErrorMessages));
+	TestEqual(TEXT("Dispatch SRV->GetVersion()"), SRV->GetVersion(), Version + 3);
+
+	// reads do not change the version
+	UAV->MapReadAndExecuteSync([](const void* Data)
+		{
+			return true;
+		});
+	TestEqual(TEXT("Readback UAV->GetVersion()"), UAV->GetVersion(), Version + 3);
+
+	// a different buffer has its own version
+	UCompushadyUAV* OtherUAV = UCompushadyFunctionLibrary::CreateCompushadyUAVBuffer(TestName + "_", 32, EPixelFormat::PF_R32_UINT);
+	const int64 OtherVersion = OtherUAV->GetVersion();
+	OtherUAV->ClearBufferWithIntSync(0);
+	TestEqual(TEXT("OtherUAV->GetVersion()"), OtherUAV->GetVersion(), OtherVersion + 1);
+	TestEqual(TEXT("UAV->GetVersion()"), UAV->GetVersion(), Version + 3);
+
+	return true;
+}
+
 #endif
@@ -0,0 +1,561 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyVideoEncoder.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace CompushadyVideoEncoderTests
+{
+	const TArray<uint8> H264SPS = { 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9 };
+	const TArray<uint8> H264PPS = { 0x68, 0xEB, 0xE3 };
+	const TArray<uint8> H264IDR = { 0x65, 0x88, 0x84, 0x00, 0x33 };
+	const TArray<uint8> H264P = { 0x41, 0x9A, 0x02 };
+
+	const TArray<uint8> H265VPS = { 0x40, 0x01, 0x0C, 0x01 };
+	// profile_tier_level contains emulation prevention bytes
+	const TArray<uint8> H265SPS = { 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5D, 0xA0 };
+	const TArray<uint8> H265PPS = { 0x44, 0x01, 0xC1 };
+	const TArray<uint8> H265IDR = { 0x26, 0x01, 0xAF, 0x00, 0x10 };
+
+	static TArray<uint8> MakeAnnexB(const TArray<TArray<uint8>>& NALUnits)
+	{
+		TArray<uint8> AnnexB;
+		for (int32 Index = 0; Index < NALUnits.Num(); Index++)
+		{
+			// mix 4 and 3 bytes start codes
+			if (Index == 0)
+			{
+				AnnexB.Add(0);
+			}
+			AnnexB.Append({ 0, 0, 1 });
+			AnnexB.Append(NALUnits[Index]);
+		}
+		return AnnexB;
+	}
+
+	static Compushady::Video::FCompushadyVideoPacket MakePacket(const TArray<uint8>& AnnexB, const uint64 Timestamp, const bool bKeyFrame)
+	{
+		Compushady::Video::FCompushadyVideoPacket Packet;
+		Packet.Data = MakeShareable(new uint8[AnnexB.Num()], [](uint8* Ptr) { delete[] Ptr; });
+		FMemory::Memcpy(Packet.Data.Get(), AnnexB.GetData(), AnnexB.Num());
+		Packet.Size = AnnexB.Num();
+		Packet.Timestamp = Timestamp;
+		Packet.FrameSize = FIntPoint(64, 32);
+		Packet.bKeyFrame = bKeyFrame;
+		return Packet;
+	}
+
+	static uint32 ReadU32(const TArray<uint8>& Data, const int32 Offset)
+	{
+		return (static_cast<uint32>(Data[Offset]) << 24) | (static_cast<uint32>(Data[Offset + 1]) << 16) | (static_cast<uint32>(Data[Offset + 2]) << 8) | Data[Offset + 3];
+	}
+
+	/* Offset of the first box of the given type between Start and End (INDEX_NONE if not found) */
+	static int32 FindBox(const TArray<uint8>& Data, const int32 Start, const int32 End, const char* Type)
+	{
+		int32 Offset = Start;
+		while (Offset + 8 <= End)
+		{
+			const uint32 Size = ReadU32(Data, Offset);
+			if (Size < 8 || Offset + static_cast<int32>(Size) > End)
+			{
+				return INDEX_NONE;
+			}
+			if (FMemory::Memcmp(Data.GetData() + Offset + 4, Type, 4) == 0)
+			{
+				return Offset;
+			}
+			Offset += Size;
+		}
+		return INDEX_NONE;
+	}
+
+	class FTestEncoderBackend : public Compushady::Video::ICompushadyVideoEncoderBackend
+	{
+	public:
+		bool ApplySettings(const Compushady::Video::FCompushadyVideoEncoderSettings& Settings) override
+		{
+			NumApplies++;
+			if (bFail)
+			{
+				return false;
+			}
+			AppliedSettings = Settings;
+			return true;
+		}
+
+		int32 NumApplies = 0;
+		bool bFail = false;
+		Compushady::Video::FCompushadyVideoEncoderSettings AppliedSettings;
+	};
+
+	/* Follows a path of plain container boxes */
+	static int32 FindBoxPath(const TArray<uint8>& Data, const TArray<const char*>& Path)
+	{
+		int32 Start = 0;
+		int32 End = Data.Num();
+		int32 Box = INDEX_NONE;
+		for (const char* Type : Path)
+		{
+			Box = FindBox(Data, Start, End, Type);
+			if (Box == INDEX_NONE)
+			{
+				return INDEX_NONE;
+			}
+			Start = Box + 8;
+			End = Box + ReadU32(Data, Box);
+		}
+		return Box;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_AnnexB, "Compushady.VideoEncoder.AnnexB", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_AnnexB::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	const TArray<uint8> AnnexB = MakeAnnexB({ H264SPS, H264PPS, H264IDR });
+
+	TArray<TArrayView<const uint8>> NALUnits;
+	Compushady::Video::ParseAnnexB(AnnexB.GetData(), AnnexB.Num(), NALUnits);
+
+	if (!TestEqual(TEXT("NALUnits.Num()"), NALUnits.Num(), 3))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("NALUnits[0].Num()"), NALUnits[0].Num(), H264SPS.Num());
+	TestEqual(TEXT("NALUnits[2].Num()"), NALUnits[2].Num(), H264IDR.Num());
+	TestEqual(TEXT("NALUnits[2][4]"), NALUnits[2][4], H264IDR[4]);
+
+	TestEqual(TEXT("GetNALUnitType(SPS)"), Compushady::Video::GetNALUnitType(NALUnits[0], false), static_cast<uint8>(7));
+	TestEqual(TEXT("GetNALUnitType(PPS)"), Compushady::Video::GetNALUnitType(NALUnits[1], false), static_cast<uint8>(8));
+	TestTrue(TEXT("IsKeyFrameNALUnit(IDR)"), Compushady::Video::IsKeyFrameNALUnit(NALUnits[2], false));
+	TestFalse(TEXT("IsKeyFrameNALUnit(P)"), Compushady::Video::IsKeyFrameNALUnit(H264P, false));
+
+	TestEqual(TEXT("GetNALUnitType(H265 VPS)"), Compushady::Video::GetNALUnitType(H265VPS, true), static_cast<uint8>(32));
+	TestEqual(TEXT("GetNALUnitType(H265 SPS)"), Compushady::Video::GetNALUnitType(H265SPS, true), static_cast<uint8>(33));
+	TestTrue(TEXT("IsKeyFrameNALUnit(H265 IDR)"), Compushady::Video::IsKeyFrameNALUnit(H265IDR, true));
+
+	Compushady::Video::FCompushadyVideoParameterSets ParameterSets;
+	TestTrue(TEXT("ParameterSets.Extract"), ParameterSets.Extract(NALUnits, false));
+	TestTrue(TEXT("ParameterSets.SPS"), ParameterSets.SPS == H264SPS);
+	TestTrue(TEXT("ParameterSets.PPS"), ParameterSets.PPS == H264PPS);
+	TestTrue(TEXT("ParameterSets.IsValid(H264)"), ParameterSets.IsValid(false));
+	TestFalse(TEXT("ParameterSets.IsValid(H265)"), ParameterSets.IsValid(true));
+
+	TArray<uint8> RBSP;
+	Compushady::Video::NALUnitToRBSP(H265SPS, RBSP);
+	TestEqual(TEXT("RBSP.Num()"), RBSP.Num(), H265SPS.Num() - 3);
+	TestEqual(TEXT("RBSP[14]"), RBSP[14], static_cast<uint8>(0x5D));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FMP4InitSegmentH264, "Compushady.VideoEncoder.FMP4InitSegmentH264", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FMP4InitSegmentH264::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	Compushady::Video::FCompushadyVideoParameterSets ParameterSets;
+	ParameterSets.SPS = H264SPS;
+	ParameterSets.PPS = H264PPS;
+
+	Compushady::Video::FCompushadyFMP4Muxer Muxer(false, 1920, 1080, 60000, 1000);
+
+	TArray<uint8> Output;
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("WriteInitSegment"), Muxer.WriteInitSegment(ParameterSets, Output, ErrorMessages)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("ftyp"), FindBox(Output, 0, Output.Num(), "ftyp"), 0);
+	const int32 MOOV = FindBox(Output, 0, Output.Num(), "moov");
+	if (!TestNotEqual(TEXT("moov"), MOOV, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+	TestEqual(TEXT("moov size"), MOOV + static_cast<int32>(ReadU32(Output, MOOV)), Output.Num());
+
+	const int32 MVHD = FindBoxPath(Output, { "moov", "mvhd" });
+	TestEqual(TEXT("mvhd timescale"), ReadU32(Output, MVHD + 20), 60000u);
+
+	const int32 TKHD = FindBoxPath(Output, { "moov", "trak", "tkhd" });
+	TestEqual(TEXT("tkhd width"), ReadU32(Output, TKHD + 84), 1920u << 16);
+	TestEqual(TEXT("tkhd height"), ReadU32(Output, TKHD + 88), 1080u << 16);
+
+	TestNotEqual(TEXT("trex"), FindBoxPath(Output, { "moov", "mvex", "trex" }), static_cast<int32>(INDEX_NONE));
+
+	const int32 STSD = FindBoxPath(Output, { "moov", "trak", "mdia", "minf", "stbl", "stsd" });
+	if (!TestNotEqual(TEXT("stsd"), STSD, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+
+	// full box header and entry_count
+	const int32 AVC1 = FindBox(Output, STSD + 16, STSD + ReadU32(Output, STSD), "avc1");
+	if (!TestNotEqual(TEXT("avc1"), AVC1, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+
+	// visual sample entry fields
+	const int32 AVCC = FindBox(Output, AVC1 + 8 + 78, AVC1 + ReadU32(Output, AVC1), "avcC");
+	if (!TestNotEqual(TEXT("avcC"), AVCC, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("avcC size"), ReadU32(Output, AVCC), 32u);
+	TestEqual(TEXT("avcC profile"), Output[AVCC + 9], static_cast<uint8>(0x64));
+	TestEqual(TEXT("avcC level"), Output[AVCC + 11], static_cast<uint8>(0x1F));
+	TestEqual(TEXT("avcC lengthSizeMinusOne"), Output[AVCC + 12] & 0x03, 3);
+	TestEqual(TEXT("avcC SPS[0]"), Output[AVCC + 16], H264SPS[0]);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FMP4InitSegmentH265, "Compushady.VideoEncoder.FMP4InitSegmentH265", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FMP4InitSegmentH265::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	Compushady::Video::FCompushadyVideoParameterSets ParameterSets;
+	ParameterSets.SPS = H265SPS;
+	ParameterSets.PPS = H265PPS;
+
+	Compushady::Video::FCompushadyFMP4Muxer Muxer(true, 1280, 720, 30000, 1000);
+
+	TArray<uint8> Output;
+	FString ErrorMessages;
+	TestFalse(TEXT("WriteInitSegment (no VPS)"), Muxer.WriteInitSegment(ParameterSets, Output, ErrorMessages));
+
+	ParameterSets.VPS = H265VPS;
+	if (!TestTrue(TEXT("WriteInitSegment"), Muxer.WriteInitSegment(ParameterSets, Output, ErrorMessages)))
+	{
+		return true;
+	}
+
+	const int32 STSD = FindBoxPath(Output, { "moov", "trak", "mdia", "minf", "stbl", "stsd" });
+	const int32 HVC1 = STSD != INDEX_NONE ? FindBox(Output, STSD + 16, STSD + ReadU32(Output, STSD), "hvc1") : INDEX_NONE;
+	const int32 HVCC = HVC1 != INDEX_NONE ? FindBox(Output, HVC1 + 8 + 78, HVC1 + ReadU32(Output, HVC1), "hvcC") : INDEX_NONE;
+	if (!TestNotEqual(TEXT("hvcC"), HVCC, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+
+	// the profile_tier_level is copied from the unescaped SPS
+	TestEqual(TEXT("hvcC profile"), Output[HVCC + 9], static_cast<uint8>(0x01));
+	TestEqual(TEXT("hvcC compatibility"), ReadU32(Output, HVCC + 10), 0x60000000u);
+	TestEqual(TEXT("hvcC constraints"), Output[HVCC + 14], static_cast<uint8>(0x90));
+	TestEqual(TEXT("hvcC level"), Output[HVCC + 20], static_cast<uint8>(0x5D));
+	TestEqual(TEXT("hvcC lengthSizeMinusOne"), Output[HVCC + 29] & 0x03, 3);
+	TestEqual(TEXT("hvcC numOfArrays"), Output[HVCC + 30], static_cast<uint8>(3));
+	TestEqual(TEXT("hvcC VPS array"), Output[HVCC + 31], static_cast<uint8>(0x80 | 32));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FMP4Fragment, "Compushady.VideoEncoder.FMP4Fragment", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FMP4Fragment::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	const TArray<uint8> AnnexB = MakeAnnexB({ H264SPS, H264PPS, H264IDR });
+	TArray<TArrayView<const uint8>> NALUnits;
+	Compushady::Video::ParseAnnexB(AnnexB.GetData(), AnnexB.Num(), NALUnits);
+
+	Compushady::Video::FCompushadyFMP4Muxer Muxer(false, 64, 32, 60000, 1000);
+
+	TArray<uint8> Output;
+	Muxer.WriteFragment(NALUnits, 3000, true, Output);
+
+	TestEqual(TEXT("moof"), FindBox(Output, 0, Output.Num(), "moof"), 0);
+	const int32 MDAT = FindBox(Output, 0, Output.Num(), "mdat");
+	if (!TestNotEqual(TEXT("mdat"), MDAT, static_cast<int32>(INDEX_NONE)))
+	{
+		return true;
+	}
+
+	TestEqual(TEXT("mfhd sequence_number"), ReadU32(Output, FindBoxPath(Output, { "moof", "mfhd" }) + 12), 1u);
+
+	const int32 TFDT = FindBoxPath(Output, { "moof", "traf", "tfdt" });
+	TestEqual(TEXT("tfdt version"), Output[TFDT + 8], static_cast<uint8>(1));
+	TestEqual(TEXT("tfdt baseMediaDecodeTime"), ReadU32(Output, TFDT + 16), 3000u);
+
+	const int32 TRUN = FindBoxPath(Output, { "moof", "traf", "trun" });
+	TestEqual(TEXT("trun sample_count"), ReadU32(Output, TRUN + 12), 1u);
+	TestEqual(TEXT("trun data_offset"), ReadU32(Output, TRUN + 16), static_cast<uint32>(MDAT + 8));
+	TestEqual(TEXT("trun sample_duration"), ReadU32(Output, TRUN + 20), 1000u);
+	TestEqual(TEXT("trun sample_size"), ReadU32(Output, TRUN + 24), static_cast<uint32>(4 + H264IDR.Num()));
+	TestEqual(TEXT("trun sample_flags"), ReadU32(Output, TRUN + 28), 0x02000000u);
+
+	// parameter sets live in the avcC, only the IDR is in the sample
+	TestEqual(TEXT("mdat size"), ReadU32(Output, MDAT), static_cast<uint32>(8 + 4 + H264IDR.Num()));
+	TestEqual(TEXT("mdat NAL unit length"), ReadU32(Output, MDAT + 8), static_cast<uint32>(H264IDR.Num()));
+	TestEqual(TEXT("mdat NAL unit type"), Output[MDAT + 12], H264IDR[0]);
+
+	const TArray<uint8> DeltaAnnexB = MakeAnnexB({ H264P });
+	NALUnits.Empty();
+	Compushady::Video::ParseAnnexB(DeltaAnnexB.GetData(), DeltaAnnexB.Num(), NALUnits);
+
+	Output.Empty();
+	Muxer.WriteFragment(NALUnits, 4000, false, Output);
+	TestEqual(TEXT("mfhd sequence_number (delta)"), ReadU32(Output, FindBoxPath(Output, { "moof", "mfhd" }) + 12), 2u);
+	TestEqual(TEXT("trun sample_flags (delta)"), ReadU32(Output, FindBoxPath(Output, { "moof", "traf", "trun" }) + 28), 0x01010000u);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FileSink, "Compushady.VideoEncoder.FileSink", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FileSink::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	const TArray<uint8> KeyFrame = MakeAnnexB({ H264SPS, H264PPS, H264IDR });
+	const TArray<uint8> DeltaFrame = MakeAnnexB({ H264P });
+
+	const FString AnnexBFilename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyVideoEncoderTest.h264"));
+	const FString FMP4Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyVideoEncoderTest.mp4"));
+
+	FString ErrorMessages;
+	for (const ECompushadyVideoContainer Container : { ECompushadyVideoContainer::AnnexB, ECompushadyVideoContainer::FragmentedMP4 })
+	{
+		const FString& Filename = Container == ECompushadyVideoContainer::AnnexB ? AnnexBFilename : FMP4Filename;
+		TSharedPtr<Compushady::Video::FCompushadyVideoFileSink> Sink = Compushady::Video::FCompushadyVideoFileSink::Create(Filename, Container, false, 60, 16, ErrorMessages);
+		if (!TestTrue(TEXT("Sink"), Sink.IsValid()))
+		{
+			return true;
+		}
+
+		// the stream must start with a keyframe
+		TestFalse(TEXT("Enqueue (leading delta frame)"), Sink->Enqueue(MakePacket(DeltaFrame, 0, false)));
+		TestTrue(TEXT("Enqueue (keyframe)"), Sink->Enqueue(MakePacket(KeyFrame, 1, true)));
+		TestTrue(TEXT("Enqueue (delta frame)"), Sink->Enqueue(MakePacket(DeltaFrame, 2, false)));
+
+		Sink->Close();
+
+		const FCompushadyVideoRecordingStats Stats = Sink->GetStats();
+		TestEqual(TEXT("Stats.DroppedPackets"), Stats.DroppedPackets, 1LL);
+		TestEqual(TEXT("Stats.WrittenPackets"), Stats.WrittenPackets, 2LL);
+		TestEqual(TEXT("Stats.QueuedPackets"), Stats.QueuedPackets, 0);
+		TestTrue(TEXT("Stats.PeakQueuedPackets"), Stats.PeakQueuedPackets >= 1);
+
+		TArray<uint8> FileData;
+		TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename));
+		TestEqual(TEXT("Stats.WrittenBytes"), Stats.WrittenBytes, static_cast<int64>(FileData.Num()));
+
+		if (Container == ECompushadyVideoContainer::AnnexB)
+		{
+			TArray<uint8> Expected = KeyFrame;
+			Expected.Append(DeltaFrame);
+			TestTrue(TEXT("AnnexB FileData"), FileData == Expected);
+		}
+		else
+		{
+			TestEqual(TEXT("ftyp"), FindBox(FileData, 0, FileData.Num(), "ftyp"), 0);
+			const int32 FirstMOOF = FindBox(FileData, 0, FileData.Num(), "moof");
+			if (TestNotEqual(TEXT("moof"), FirstMOOF, static_cast<int32>(INDEX_NONE)))
+			{
+				// the second fragment starts one frame later
+				const int32 FirstMDAT = FindBox(FileData, FirstMOOF, FileData.Num(), "mdat");
+				const int32 SecondMOOF = FindBox(FileData, FirstMDAT, FileData.Num(), "moof");
+				if (TestNotEqual(TEXT("second moof"), SecondMOOF, static_cast<int32>(INDEX_NONE)))
+				{
+					const int32 TFDT = FindBox(FileData, FindBox(FileData, SecondMOOF + 8, FileData.Num(), "traf") + 8, FileData.Num(), "tfdt");
+					TestEqual(TEXT("second tfdt"), ReadU32(FileData, TFDT + 16), 1000u);
+				}
+			}
+		}
+
+		IFileManager::Get().Delete(*Filename);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_ConfigStateMachine, "Compushady.VideoEncoder.ConfigStateMachine", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_ConfigStateMachine::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyVideoEncoderTests;
+
+	Compushady::Video::FCompushadyVideoEncoderSettings Settings;
+	Settings.Codec = ECompushadyVideoEncoderCodec::H265Main;
+
+	Compushady::Video::FCompushadyVideoEncoderConfig Config;
+	Config.Initialize(Settings);
+	TestTrue(TEXT("IsDirty (initialized)"), Config.IsDirty());
+
+	FTestEncoderBackend Backend;
+	bool bKeyFrame = true;
+
+	// applied once with the first frame
+	Config.SetResolution(1920, 1080);
+	TestTrue(TEXT("Update (first frame)"), Config.Update(Backend, bKeyFrame));
+	TestFalse(TEXT("bKeyFrame (first frame)"), bKeyFrame);
+	TestEqual(TEXT("Backend.NumApplies (first frame)"), Backend.NumApplies, 1);
+	TestTrue(TEXT("Backend.AppliedSettings.Codec"), Backend.AppliedSettings.Codec == ECompushadyVideoEncoderCodec::H265Main);
+	TestEqual(TEXT("Backend.AppliedSettings.Width"), Backend.AppliedSettings.Width, 1920);
+
+	// and never again while nothing changes
+	for (int32 Frame = 0; Frame < 10; Frame++)
+	{
+		Config.SetResolution(1920, 1080);
+		Config.Update(Backend, bKeyFrame);
+	}
+	TestEqual(TEXT("Backend.NumApplies (same settings)"), Backend.NumApplies, 1);
+	TestFalse(TEXT("IsDirty (same settings)"), Config.IsDirty());
+
+	// keyframe requests do not touch the configuration
+	Config.RequestKeyFrame();
+	TestTrue(TEXT("Update (keyframe)"), Config.Update(Backend, bKeyFrame));
+	TestTrue(TEXT("bKeyFrame (requested)"), bKeyFrame);
+	TestEqual(TEXT("Backend.NumApplies (keyframe)"), Backend.NumApplies, 1);
+	Config.Update(Backend, bKeyFrame);
+	TestFalse(TEXT("bKeyFrame (consumed)"), bKeyFrame);
+
+	Config.SetBitrate(5000000, 8000000);
+	TestTrue(TEXT("Update (bitrate)"), Config.Update(Backend, bKeyFrame));
+	TestFalse(TEXT("bKeyFrame (bitrate)"), bKeyFrame);
+	TestEqual(TEXT("Backend.NumApplies (bitrate)"), Backend.NumApplies, 2);
+	TestEqual(TEXT("Backend.AppliedSettings.TargetBitrate"), Backend.AppliedSettings.TargetBitrate, 5000000);
+
+	// new resolution, new parameter sets
+	Config.SetResolution(1280, 720);
+	TestTrue(TEXT("Update (resolution)"), Config.Update(Backend, bKeyFrame));
+	TestTrue(TEXT("bKeyFrame (resolution)"), bKeyFrame);
+	TestEqual(TEXT("Backend.NumApplies (resolution)"), Backend.NumApplies, 3);
+	TestEqual(TEXT("Backend.AppliedSettings.Height"), Backend.AppliedSettings.Height, 720);
+
+	// failures are retried and do not consume the keyframe request
+	Backend.bFail = true;
+	Config.SetBitrate(1000000, 2000000);
+	Config.RequestKeyFrame();
+	TestFalse(TEXT("Update (failure)"), Config.Update(Backend, bKeyFrame));
+	TestTrue(TEXT("IsDirty (failure)"), Config.IsDirty());
+
+	Backend.bFail = false;
+	TestTrue(TEXT("Update (retry)"), Config.Update(Backend, bKeyFrame));
+	TestTrue(TEXT("bKeyFrame (retry)"), bKeyFrame);
+	TestEqual(TEXT("Backend.NumApplies (retry)"), Backend.NumApplies, 5);
+	TestEqual(TEXT("Config.GetNumApplies"), Config.GetNumApplies(), 4);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FramePool, "Compushady.VideoEncoder.FramePool", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FramePool::RunTest(const FString& Parameters)
+{
+	Compushady::Video::TCompushadyVideoFramePool<int32> FramePool;
+	FramePool.Reset(3);
+
+	TestEqual(TEXT("Acquire(0)"), FramePool.Acquire(0), 0);
+	FramePool.GetResource(0) = MakeShared<int32>(100);
+	TestEqual(TEXT("Acquire(1)"), FramePool.Acquire(1), 1);
+	TestEqual(TEXT("Acquire(2)"), FramePool.Acquire(2), 2);
+
+	// the encoder is still busy with all of the frames
+	TestEqual(TEXT("Acquire(3) (exhausted)"), FramePool.Acquire(3), static_cast<int32>(INDEX_NONE));
+	TestEqual(TEXT("NumInFlight (exhausted)"), FramePool.NumInFlight(), 3);
+
+	// the packet of frame 1 implies frame 0 is done too
+	FramePool.Release(1);
+	TestEqual(TEXT("NumInFlight (released)"), FramePool.NumInFlight(), 1);
+
+	TestEqual(TEXT("Acquire(3)"), FramePool.Acquire(3), 0);
+	TestTrue(TEXT("GetResource(0) (reused)"), FramePool.GetResource(0).IsValid() && *FramePool.GetResource(0) == 100);
+	TestEqual(TEXT("Acquire(4)"), FramePool.Acquire(4), 1);
+
+	FramePool.Cancel(1);
+	TestEqual(TEXT("NumInFlight (cancelled)"), FramePool.NumInFlight(), 2);
+
+	Compushady::Video::TCompushadyVideoFramePool<int32> EmptyFramePool;
+	EmptyFramePool.Reset(0);
+	TestEqual(TEXT("Acquire(0) (empty)"), EmptyFramePool.Acquire(0), static_cast<int32>(INDEX_NONE));
+
+	FramePool.ReleaseAll();
+	TestEqual(TEXT("NumInFlight (all released)"), FramePool.NumInFlight(), 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyVideoEncoderTest_FramePoolNoDequeue, "Compushady.VideoEncoder.FramePoolNoDequeue", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyVideoEncoderTest_FramePoolNoDequeue::RunTest(const FString& Parameters)
+{
+	Compushady::Video::TCompushadyVideoFramePool<int32> FramePool;
+	FramePool.Reset(3);
+
+	for (uint64 Timestamp = 0; Timestamp < 3; Timestamp++)
+	{
+		TestEqual(FString::Printf(TEXT("Acquire(%llu)"), Timestamp), FramePool.Acquire(Timestamp), static_cast<int32>(Timestamp));
+	}
+
+	// busy frames are never handed out again, whatever their age
+	for (uint64 Timestamp = 3; Timestamp < 10; Timestamp++)
+	{
+		TestEqual(FString::Printf(TEXT("Acquire(%llu) (busy)"), Timestamp), FramePool.Acquire(Timestamp), static_cast<int32>(INDEX_NONE));
+	}
+	TestEqual(TEXT("NumInFlight"), FramePool.NumInFlight(), 3);
+
+	// a late packet releases only the frames up to its timestamp (frames dropped by the encoder included)
+	FramePool.Release(1);
+	TestEqual(TEXT("NumInFlight (released)"), FramePool.NumInFlight(), 1);
+	TestEqual(TEXT("Acquire(10)"), FramePool.Acquire(10), 0);
+	TestEqual(TEXT("Acquire(11)"), FramePool.Acquire(11), 1);
+	TestEqual(TEXT("Acquire(12) (busy)"), FramePool.Acquire(12), static_cast<int32>(INDEX_NONE));
+
+	// the caller never dequeues, EncodeFrame drains the encoder packets to free the input frames
+	UCompushadyVideoEncoder* VideoEncoder = NewObject<UCompushadyVideoEncoder>();
+	if (!VideoEncoder->Initialize(ECompushadyVideoEncoderCodec::H264Main, ECompushadyVideoEncoderQuality::Default, ECompushadyVideoEncoderLatency::Default, 3))
+	{
+		AddInfo(TEXT("Hardware video encoding is not available, skipping the encoder frames"));
+		return true;
+	}
+
+	UCompushadyUAV* FrameUAV = UCompushadyFunctionLibrary::CreateCompushadyUAVTexture2D("FramePoolNoDequeue", 64, 64, EPixelFormat::PF_B8G8R8A8);
+	if (!TestNotNull(TEXT("FrameUAV"), FrameUAV))
+	{
+		return false;
+	}
+
+	for (int32 FrameIndex = 0; FrameIndex < 10; FrameIndex++)
+	{
+		// a frame can still be in flight when the encoder has not returned its packet yet
+		bool bEncoded = false;
+		for (int32 Attempt = 0; Attempt < 100 && !bEncoded; Attempt++)
+		{
+			bEncoded = VideoEncoder->EncodeFrame(FrameUAV, FrameIndex == 0);
+			if (!bEncoded)
+			{
+				FPlatformProcess::Sleep(0.01f);
+			}
+		}
+		TestTrue(FString::Printf(TEXT("EncodeFrame(%d)"), FrameIndex), bEncoded);
+	}
+
+	// the packets drained while acquiring the frames are not lost
+	TArray<uint8> FrameData;
+	int32 NumPackets = 0;
+	while (VideoEncoder->DequeueEncodedFrame(FrameData))
+	{
+		NumPackets++;
+	}
+	TestTrue(TEXT("NumPackets"), NumPackets >= 7);
+
+	return true;
+}
+
+#endif
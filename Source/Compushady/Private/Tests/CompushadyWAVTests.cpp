@@ -0,0 +1,440 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "CompushadyFunctionLibrary.h"
+#include "CompushadyWAVRecorder.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace CompushadyWAVTests
+{
+	template<typename T>
+	static T ReadValue(const TArray<uint8>& Data, const int32 Offset)
+	{
+		T Value = 0;
+		if (Offset + static_cast<int32>(sizeof(T)) <= Data.Num())
+		{
+			FMemory::Memcpy(&Value, Data.GetData() + Offset, sizeof(T));
+		}
+		return Value;
+	}
+
+	static bool HasFourCC(const TArray<uint8>& Data, const int32 Offset, const char* FourCC)
+	{
+		return Offset + 4 <= Data.Num() && FMemory::Memcmp(Data.GetData() + Offset, FourCC, 4) == 0;
+	}
+
+	/* Returns the offset of the chunk payload or INDEX_NONE */
+	static int32 FindChunk(const TArray<uint8>& Data, const char* FourCC, uint32& ChunkSize)
+	{
+		int32 Offset = 12;
+		while (Offset + 8 <= Data.Num())
+		{
+			ChunkSize = ReadValue<uint32>(Data, Offset + 4);
+			if (HasFourCC(Data, Offset, FourCC))
+			{
+				return Offset + 8;
+			}
+			Offset += 8 + ChunkSize + (ChunkSize & 1);
+		}
+		return INDEX_NONE;
+	}
+
+	static int32 ReadSample(const uint8* Data, const int32 BytesPerSample)
+	{
+		if (BytesPerSample == 1)
+		{
+			return static_cast<int32>(*Data) - 128;
+		}
+
+		int32 Value = 0;
+		FMemory::Memcpy(&Value, Data, BytesPerSample);
+		// sign extension
+		const int32 Shift = (4 - BytesPerSample) * 8;
+		return (Value << Shift) >> Shift;
+	}
+
+	static TArray<float> MakeSamples(const int32 NumSamples, const int32 Seed)
+	{
+		FRandomStream RandomStream(Seed);
+		TArray<float> Samples;
+		for (int32 Index = 0; Index < NumSamples; Index++)
+		{
+			Samples.Add(RandomStream.FRandRange(-1.1f, 1.1f));
+		}
+		return Samples;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Header, "Compushady.WAV.Header", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Header::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	TArray<uint8> Header;
+	Compushady::WAV::WriteHeader(Header, 48000, 2, ECompushadyWAVFormat::PCM16, 4000);
+
+	uint32 ChunkSize = 0;
+	TestTrue(TEXT("RIFF"), HasFourCC(Header, 0, "RIFF"));
+	TestEqual(TEXT("RIFF Size"), ReadValue<uint32>(Header, 4), static_cast<uint32>(Header.Num() - 8 + 4000));
+	TestTrue(TEXT("WAVE"), HasFourCC(Header, 8, "WAVE"));
+	TestTrue(TEXT("JUNK"), FindChunk(Header, "JUNK", ChunkSize) != INDEX_NONE && ChunkSize == 28);
+
+	const int32 Fmt = FindChunk(Header, "fmt ", ChunkSize);
+	if (TestTrue(TEXT("fmt"), Fmt != INDEX_NONE))
+	{
+		TestEqual(TEXT("fmt Size"), ChunkSize, 16u);
+		TestEqual(TEXT("Format"), ReadValue<uint16>(Header, Fmt), static_cast<uint16>(1));
+		TestEqual(TEXT("Channels"), ReadValue<uint16>(Header, Fmt + 2), static_cast<uint16>(2));
+		TestEqual(TEXT("SampleRate"), ReadValue<uint32>(Header, Fmt + 4), 48000u);
+		TestEqual(TEXT("ByteRate"), ReadValue<uint32>(Header, Fmt + 8), 48000u * 4);
+		TestEqual(TEXT("BlockAlign"), ReadValue<uint16>(Header, Fmt + 12), static_cast<uint16>(4));
+		TestEqual(TEXT("BitsPerSample"), ReadValue<uint16>(Header, Fmt + 14), static_cast<uint16>(16));
+	}
+
+	const int32 DataChunk = FindChunk(Header, "data", ChunkSize);
+	TestEqual(TEXT("data"), DataChunk, Header.Num());
+	TestEqual(TEXT("data Size"), ChunkSize, 4000u);
+
+	// more than 16 bits or 2 channels require WAVE_FORMAT_EXTENSIBLE
+	for (const ECompushadyWAVFormat WAVFormat : { ECompushadyWAVFormat::PCM24, ECompushadyWAVFormat::Float })
+	{
+		Compushady::WAV::WriteHeader(Header, 44100, 6, WAVFormat, 6 * 4 * 100);
+		const int32 ExtensibleFmt = FindChunk(Header, "fmt ", ChunkSize);
+		if (TestTrue(TEXT("fmt (Extensible)"), ExtensibleFmt != INDEX_NONE))
+		{
+			TestEqual(TEXT("fmt Size (Extensible)"), ChunkSize, 40u);
+			TestEqual(TEXT("Format (Extensible)"), ReadValue<uint16>(Header, ExtensibleFmt), static_cast<uint16>(0xFFFE));
+			TestEqual(TEXT("SubFormat (Extensible)"), ReadValue<uint16>(Header, ExtensibleFmt + 24), static_cast<uint16>(WAVFormat == ECompushadyWAVFormat::Float ? 3 : 1));
+		}
+	}
+
+	// RF64 keeps the same header size
+	TArray<uint8> SmallHeader;
+	Compushady::WAV::WriteHeader(SmallHeader, 48000, 2, ECompushadyWAVFormat::PCM32, 0);
+
+	const uint64 HugeDataSize = 5ULL * 1024 * 1024 * 1024;
+	Compushady::WAV::WriteHeader(Header, 48000, 2, ECompushadyWAVFormat::PCM32, HugeDataSize);
+	TestEqual(TEXT("RF64 Header Size"), Header.Num(), SmallHeader.Num());
+	TestTrue(TEXT("RF64"), HasFourCC(Header, 0, "RF64"));
+	TestEqual(TEXT("RF64 RIFF Size"), ReadValue<uint32>(Header, 4), MAX_uint32);
+
+	const int32 DS64 = FindChunk(Header, "ds64", ChunkSize);
+	if (TestTrue(TEXT("ds64"), DS64 != INDEX_NONE))
+	{
+		TestEqual(TEXT("ds64 RIFF Size"), ReadValue<uint64>(Header, DS64), static_cast<uint64>(Header.Num() - 8) + HugeDataSize);
+		TestEqual(TEXT("ds64 Data Size"), ReadValue<uint64>(Header, DS64 + 8), HugeDataSize);
+		TestEqual(TEXT("ds64 Sample Count"), ReadValue<uint64>(Header, DS64 + 16), HugeDataSize / 8);
+	}
+
+	FindChunk(Header, "data", ChunkSize);
+	TestEqual(TEXT("RF64 data Size"), ChunkSize, MAX_uint32);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Conversion, "Compushady.WAV.Conversion", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Conversion::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	// 7 samples, so that the vector tail is used too
+	const float Samples[] = { 0.0f, 0.5f, -1.0f, 1.0f, 2.0f, -2.0f, -0.25f };
+
+	struct FExpected
+	{
+		ECompushadyWAVFormat WAVFormat;
+		int32 Values[7];
+	};
+
+	const FExpected Expected[] =
+	{
+		{ ECompushadyWAVFormat::PCM8, { 0, 64, -128, 127, 127, -128, -32 } },
+		{ ECompushadyWAVFormat::PCM16, { 0, 16384, -32768, 32767, 32767, -32768, -8192 } },
+		{ ECompushadyWAVFormat::PCM24, { 0, 4194304, -8388608, 8388607, 8388607, -8388608, -2097152 } },
+		{ ECompushadyWAVFormat::PCM32, { 0, 1073741824, MIN_int32, 2147483520, 2147483520, MIN_int32, -536870912 } },
+	};
+
+	for (const FExpected& Entry : Expected)
+	{
+		const int32 BytesPerSample = Compushady::WAV::GetBytesPerSample(Entry.WAVFormat);
+		TArray<uint8> Output;
+		Output.SetNumZeroed(7 * BytesPerSample);
+		Compushady::WAV::ConvertSamples(Samples, 7, 1, 0, Entry.WAVFormat, nullptr, Output.GetData());
+
+		for (int32 Index = 0; Index < 7; Index++)
+		{
+			TestEqual(*FString::Printf(TEXT("Format %d Sample %d"), static_cast<int32>(Entry.WAVFormat), Index), ReadSample(Output.GetData() + Index * BytesPerSample, BytesPerSample), Entry.Values[Index]);
+		}
+	}
+
+	TArray<uint8> FloatOutput;
+	FloatOutput.SetNumZeroed(sizeof(Samples));
+	Compushady::WAV::ConvertSamples(Samples, 7, 1, 0, ECompushadyWAVFormat::Float, nullptr, FloatOutput.GetData());
+	TestTrue(TEXT("Float"), FMemory::Memcmp(FloatOutput.GetData(), Samples, sizeof(Samples)) == 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Dither, "Compushady.WAV.Dither", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Dither::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	const TArray<float> Samples = MakeSamples(1001, 3);
+
+	TArray<uint8> Plain;
+	Plain.SetNumZeroed(Samples.Num() * 2);
+	Compushady::WAV::ConvertSamples(Samples.GetData(), Samples.Num(), 1, 0, ECompushadyWAVFormat::PCM16, nullptr, Plain.GetData());
+
+	Compushady::WAV::FCompushadyWAVDither Dither;
+	TArray<uint8> Dithered;
+	Dithered.SetNumZeroed(Samples.Num() * 2);
+	Compushady::WAV::ConvertSamples(Samples.GetData(), Samples.Num(), 1, 0, ECompushadyWAVFormat::PCM16, &Dither, Dithered.GetData());
+
+	// TPDF noise is within +-1 LSB
+	int32 NumChanged = 0;
+	bool bInRange = true;
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+	{
+		const int32 Difference = ReadSample(Dithered.GetData() + Index * 2, 2) - ReadSample(Plain.GetData() + Index * 2, 2);
+		bInRange &= FMath::Abs(Difference) <= 1;
+		NumChanged += Difference != 0 ? 1 : 0;
+	}
+
+	TestTrue(TEXT("Dither Range"), bInRange);
+	TestTrue(TEXT("Dither Applied"), NumChanged > 0);
+
+	// the state advances, so the next block gets different noise
+	TArray<uint8> Dithered2;
+	Dithered2.SetNumZeroed(Samples.Num() * 2);
+	Compushady::WAV::ConvertSamples(Samples.GetData(), Samples.Num(), 1, 0, ECompushadyWAVFormat::PCM16, &Dither, Dithered2.GetData());
+	TestTrue(TEXT("Dither State"), FMemory::Memcmp(Dithered.GetData(), Dithered2.GetData(), Dithered.Num()) != 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Planar, "Compushady.WAV.Planar", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Planar::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	constexpr int32 NumFrames = 37;
+	constexpr int32 PlanarPitch = 40;
+
+	for (const int32 NumChannels : { 1, 2, 3, 6 })
+	{
+		const TArray<float> Planar = MakeSamples(PlanarPitch * NumChannels, NumChannels);
+
+		TArray<float> Interleaved;
+		Interleaved.SetNumZeroed(NumFrames * NumChannels);
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			for (int32 Channel = 0; Channel < NumChannels; Channel++)
+			{
+				Interleaved[Frame * NumChannels + Channel] = Planar[Channel * PlanarPitch + Frame];
+			}
+		}
+
+		for (const ECompushadyWAVFormat WAVFormat : { ECompushadyWAVFormat::PCM8, ECompushadyWAVFormat::PCM16, ECompushadyWAVFormat::PCM24, ECompushadyWAVFormat::PCM32, ECompushadyWAVFormat::Float })
+		{
+			const int32 Size = NumFrames * NumChannels * Compushady::WAV::GetBytesPerSample(WAVFormat);
+
+			TArray<uint8> FromInterleaved;
+			FromInterleaved.SetNumZeroed(Size);
+			Compushady::WAV::ConvertSamples(Interleaved.GetData(), NumFrames, NumChannels, 0, WAVFormat, nullptr, FromInterleaved.GetData());
+
+			TArray<uint8> FromPlanar;
+			FromPlanar.SetNumZeroed(Size);
+			Compushady::WAV::ConvertSamples(Planar.GetData(), NumFrames, NumChannels, PlanarPitch, WAVFormat, nullptr, FromPlanar.GetData());
+
+			TestTrue(*FString::Printf(TEXT("Channels %d Format %d"), NumChannels, static_cast<int32>(WAVFormat)), FromInterleaved == FromPlanar);
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Writer, "Compushady.WAV.Writer", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Writer::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	// PCM8 mono has an odd data size, so the padding is tested too
+	for (const ECompushadyWAVFormat WAVFormat : { ECompushadyWAVFormat::PCM8, ECompushadyWAVFormat::PCM24, ECompushadyWAVFormat::Float })
+	{
+		constexpr int32 NumChannels = 1;
+		const TArray<float> Samples = MakeSamples(40001, 7);
+		const int32 BytesPerSample = Compushady::WAV::GetBytesPerSample(WAVFormat);
+
+		TArray<uint8> WAVData;
+		FMemoryWriter MemoryWriter(WAVData);
+		Compushady::WAV::FCompushadyWAVWriter Writer(MemoryWriter, 22050, NumChannels, WAVFormat, false);
+
+		// blocks of different sizes, bigger than the conversion chunk too
+		FString ErrorMessages;
+		int32 Frame = 0;
+		for (const int32 BlockSize : { 1, 100, 20000, 19900 })
+		{
+			TestTrue(TEXT("Write"), Writer.Write(Samples.GetData() + Frame, BlockSize, 0, ErrorMessages));
+			Frame += BlockSize;
+		}
+
+		TestEqual(TEXT("GetNumFrames"), Writer.GetNumFrames(), static_cast<int64>(Samples.Num()));
+		TestTrue(TEXT("Close"), Writer.Close(ErrorMessages));
+		TestFalse(TEXT("Write (closed)"), Writer.Write(Samples.GetData(), 1, 0, ErrorMessages));
+		TestFalse(TEXT("IsRF64"), Writer.IsRF64());
+
+		const int32 DataSize = Samples.Num() * NumChannels * BytesPerSample;
+		TArray<uint8> Expected;
+		Expected.SetNumZeroed(DataSize);
+		Compushady::WAV::ConvertSamples(Samples.GetData(), Samples.Num(), NumChannels, 0, WAVFormat, nullptr, Expected.GetData());
+
+		uint32 ChunkSize = 0;
+		const int32 DataChunk = FindChunk(WAVData, "data", ChunkSize);
+		if (!TestTrue(TEXT("data"), DataChunk != INDEX_NONE))
+		{
+			continue;
+		}
+
+		TestEqual(TEXT("data Size"), ChunkSize, static_cast<uint32>(DataSize));
+		TestEqual(TEXT("File Size"), WAVData.Num(), DataChunk + DataSize + (DataSize & 1));
+		TestEqual(TEXT("RIFF Size"), ReadValue<uint32>(WAVData, 4), static_cast<uint32>(WAVData.Num() - 8));
+		TestTrue(TEXT("Samples"), FMemory::Memcmp(WAVData.GetData() + DataChunk, Expected.GetData(), DataSize) == 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_Recorder, "Compushady.WAV.Recorder", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_Recorder::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyWAVTest.wav"));
+
+	UCompushadyWAVRecorder* Recorder = NewObject<UCompushadyWAVRecorder>();
+
+	FString ErrorMessages;
+	TestFalse(TEXT("AppendSamples (not open)"), Recorder->AppendSamples({ 0.0f }, ErrorMessages));
+	TestFalse(TEXT("Open (invalid channels)"), Recorder->Open(Filename, 48000, 0, ErrorMessages));
+
+	constexpr int32 NumChannels = 2;
+	constexpr int32 NumBlocks = 16;
+	constexpr int32 BlockFrames = 512;
+
+	// planar blocks, as a compute shader would write them
+	if (!TestTrue(TEXT("Open"), Recorder->Open(Filename, 48000, NumChannels, ErrorMessages, ECompushadyWAVFormat::PCM16, true, false)))
+	{
+		return true;
+	}
+
+	TestFalse(TEXT("AppendSamples (odd)"), Recorder->AppendSamples({ 0.0f, 0.0f, 0.0f }, ErrorMessages));
+
+	TArray<float> Interleaved;
+	for (int32 Block = 0; Block < NumBlocks; Block++)
+	{
+		const TArray<float> Planar = MakeSamples(BlockFrames * NumChannels, Block);
+		TestTrue(TEXT("AppendSamples"), Recorder->AppendSamples(Planar, ErrorMessages));
+		for (int32 Frame = 0; Frame < BlockFrames; Frame++)
+		{
+			Interleaved.Add(Planar[Frame]);
+			Interleaved.Add(Planar[BlockFrames + Frame]);
+		}
+	}
+
+	TestTrue(TEXT("Close"), Recorder->Close(ErrorMessages));
+	TestFalse(TEXT("IsOpen"), Recorder->IsOpen());
+
+	TArray<uint8> FileData;
+	if (!TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename)))
+	{
+		return true;
+	}
+
+	TArray<uint8> Expected;
+	Expected.SetNumZeroed(Interleaved.Num() * 2);
+	Compushady::WAV::ConvertSamples(Interleaved.GetData(), NumBlocks * BlockFrames, NumChannels, 0, ECompushadyWAVFormat::PCM16, nullptr, Expected.GetData());
+
+	uint32 ChunkSize = 0;
+	const int32 DataChunk = FindChunk(FileData, "data", ChunkSize);
+	if (TestTrue(TEXT("data"), DataChunk != INDEX_NONE))
+	{
+		TestEqual(TEXT("data Size"), ChunkSize, static_cast<uint32>(Expected.Num()));
+		TestTrue(TEXT("Samples"), DataChunk + Expected.Num() <= FileData.Num() && FMemory::Memcmp(FileData.GetData() + DataChunk, Expected.GetData(), Expected.Num()) == 0);
+	}
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompushadyWAVTest_RecorderBuffer, "Compushady.WAV.RecorderBuffer", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompushadyWAVTest_RecorderBuffer::RunTest(const FString& Parameters)
+{
+	using namespace CompushadyWAVTests;
+
+	const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("CompushadyWAVTestBuffer.wav"));
+
+	constexpr int32 NumChannels = 2;
+	constexpr int32 BlockFrames = 256;
+	constexpr int32 HeadSamples = 4;
+
+	// the block is in the middle of the buffer
+	const TArray<float> BufferSamples = MakeSamples(HeadSamples + BlockFrames * NumChannels + 8, 1);
+	UCompushadySRV* SRV = UCompushadyFunctionLibrary::CreateCompushadySRVBufferFromFloatArray("RecorderBuffer", BufferSamples, EPixelFormat::PF_R32_FLOAT);
+	if (!TestNotNull(TEXT("SRV"), SRV))
+	{
+		return true;
+	}
+
+	UCompushadyWAVRecorder* Recorder = NewObject<UCompushadyWAVRecorder>();
+
+	FString ErrorMessages;
+	if (!TestTrue(TEXT("Open"), Recorder->Open(Filename, 48000, NumChannels, ErrorMessages, ECompushadyWAVFormat::Float)))
+	{
+		return true;
+	}
+
+	// the readback completes after the AppendSamples call, the file keeps the call order
+	Recorder->AppendBuffer(SRV, HeadSamples * sizeof(float), BlockFrames, FCompushadySignaled());
+	const TArray<float> Tail = MakeSamples(BlockFrames * NumChannels, 2);
+	TestTrue(TEXT("AppendSamples"), Recorder->AppendSamples(Tail, ErrorMessages));
+
+	TestTrue(TEXT("Close"), Recorder->Close(ErrorMessages));
+
+	TArray<float> Expected;
+	Expected.Append(BufferSamples.GetData() + HeadSamples, BlockFrames * NumChannels);
+	Expected.Append(Tail);
+
+	TArray<uint8> FileData;
+	if (!TestTrue(TEXT("LoadFileToArray"), FFileHelper::LoadFileToArray(FileData, *Filename)))
+	{
+		return true;
+	}
+
+	uint32 ChunkSize = 0;
+	const int32 DataChunk = FindChunk(FileData, "data", ChunkSize);
+	if (TestTrue(TEXT("data"), DataChunk != INDEX_NONE))
+	{
+		const int32 ExpectedSize = Expected.Num() * sizeof(float);
+		TestEqual(TEXT("data Size"), ChunkSize, static_cast<uint32>(ExpectedSize));
+		TestTrue(TEXT("Samples"), DataChunk + ExpectedSize <= FileData.Num() && FMemory::Memcmp(FileData.GetData() + DataChunk, Expected.GetData(), ExpectedSize) == 0);
+	}
+
+	IFileManager::Get().Delete(*Filename);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,231 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CompushadyTypes.h"
+#include "UObject/NoExportTypes.h"
+#include "CompushadyAccelerationStructure.generated.h"
+
+class UCompushadyAccelerationStructure;
+class UCompushadySRV;
+
+USTRUCT(BlueprintType)
+struct FCompushadyAccelerationStructureTriangles
+{
+	GENERATED_BODY()
+
+	/* float3 positions */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	UCompushadyResource* VertexBuffer = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int64 VertexOffset = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 VertexStride = 12;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 NumVertices = 0;
+
+	/* optional, uint16 or uint32 indices (based on the buffer stride) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	UCompushadyResource* IndexBuffer = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int64 IndexOffset = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 NumIndices = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bOpaque = true;
+};
+
+USTRUCT(BlueprintType)
+struct FCompushadyAccelerationStructureAABBs
+{
+	GENERATED_BODY()
+
+	/* float3 min, float3 max */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	UCompushadyResource* AABBBuffer = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int64 Offset = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 Stride = 24;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 NumAABBs = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bOpaque = true;
+};
+
+USTRUCT(BlueprintType)
+struct FCompushadyAccelerationStructureInstance
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	UCompushadyAccelerationStructure* BLAS = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	FTransform Transform;
+
+	/* 24 bits, InstanceID() in the shaders */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 InstanceID = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	uint8 Mask = 0xFF;
+
+	/* 24 bits */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 HitGroupIndex = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bForceOpaque = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bTriangleCullDisable = false;
+};
+
+namespace Compushady
+{
+	namespace AccelerationStructure
+	{
+		constexpr uint32 MaxInstanceID = (1 << 24) - 1;
+		constexpr uint32 MaxHitGroupIndex = (1 << 24) - 1;
+
+		// same values of D3D12_RAYTRACING_INSTANCE_FLAGS and VkGeometryInstanceFlagBitsKHR
+		constexpr uint32 InstanceFlagTriangleCullDisable = 0x1;
+		constexpr uint32 InstanceFlagForceOpaque = 0x4;
+
+		/* Native (D3D12 and Vulkan share the same layout) instance descriptor, the expected format of TLAS instance buffers */
+		struct FCompushadyInstanceDesc
+		{
+			float Transform[3][4];
+			uint32 InstanceIDAndMask;
+			uint32 HitGroupIndexAndFlags;
+			uint64 AccelerationStructureAddress;
+		};
+
+		static_assert(sizeof(FCompushadyInstanceDesc) == 64, "FCompushadyInstanceDesc must be 64 bytes");
+
+		COMPUSHADY_API void PackInstance(const FCompushadyAccelerationStructureInstance& Instance, const uint64 AccelerationStructureAddress, FCompushadyInstanceDesc& InstanceDesc);
+
+		COMPUSHADY_API bool ValidateTriangles(const FCompushadyAccelerationStructureTriangles& Triangles, const int64 VertexBufferSize, const int64 IndexBufferSize, const int32 IndexStride, FString& ErrorMessages);
+		COMPUSHADY_API bool ValidateAABBs(const FCompushadyAccelerationStructureAABBs& AABBs, const int64 AABBBufferSize, FString& ErrorMessages);
+		COMPUSHADY_API bool ValidateInstance(const FCompushadyAccelerationStructureInstance& Instance, FString& ErrorMessages);
+		COMPUSHADY_API bool ValidateInstanceBuffer(const int64 InstanceBufferSize, const int64 Offset, const int32 NumInstances, FString& ErrorMessages);
+	}
+}
+
+/**
+ * BLAS (from triangles or AABBs) or TLAS (from instances) built from Compushady buffers.
+ * GPU builds are available on Unreal Engine 5.3+, on older versions
+ * (or without RHI ray tracing support) the Initialize functions fail.
+ */
+UCLASS(BlueprintType)
+class COMPUSHADY_API UCompushadyAccelerationStructure : public UObject, public ICompushadyPipeline
+{
+	GENERATED_BODY()
+
+public:
+	/* Checks if acceleration structures can be built with the current engine and RHI */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	static bool IsSupported(FString& ErrorMessages);
+
+	/* bInAllowUpdate enables Refit() at the cost of a slightly slower tracing */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeBLASFromTriangles(const TArray<FCompushadyAccelerationStructureTriangles>& Geometries, const bool bInAllowUpdate, FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeBLASFromAABBs(const TArray<FCompushadyAccelerationStructureAABBs>& Geometries, const bool bInAllowUpdate, FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeTLAS(const TArray<FCompushadyAccelerationStructureInstance>& Instances, FString& ErrorMessages);
+
+	/* InstanceBuffer contains native instance descriptors (see Compushady::AccelerationStructure::FCompushadyInstanceDesc), generally written by a compute shader */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeTLASFromInstanceBuffer(UCompushadyResource* InstanceBuffer, const int64 Offset, const int32 InNumInstances, const TArray<UCompushadyAccelerationStructure*>& InReferencedBLASes, FString& ErrorMessages);
+
+	/* Full build */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void Build(const FCompushadySignaled& OnSignaled);
+
+	/* Updates the BLAS in place after its vertices/AABBs have been changed (the topology must not change) */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void Refit(const FCompushadySignaled& OnSignaled);
+
+	/* Repacks the instances (same number of the initialization) and rebuilds the TLAS */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void UpdateInstances(const TArray<FCompushadyAccelerationStructureInstance>& Instances, const FCompushadySignaled& OnSignaled);
+
+	/* The TLAS view for binding to shaders (valid after the first build) */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	UCompushadySRV* GetSRV() const;
+
+	/* GPU address of the BLAS (valid after the first build), for filling instance descriptors in shaders */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int64 GetGPUAddress() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsTLAS() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsBuilt() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsRunning() const;
+
+	/* The following block is mainly used for unit testing */
+	UFUNCTION()
+	void StoreLastSignal(bool bSuccess, const FString& ErrorMessage);
+
+	bool bLastSuccess = false;
+	FString LastErrorMessages;
+
+	/* end of testing block */
+
+protected:
+	UFUNCTION()
+	void OnBuildSignaled(bool bSuccess, const FString& ErrorMessage);
+
+	void Build_Internal(const bool bUpdate, const FCompushadySignaled& OnSignaled);
+	bool InitializeTLAS_Internal(const int32 InNumInstances, const TArray<UCompushadyAccelerationStructure*>& InReferencedBLASes, FString& ErrorMessages);
+	bool PackInstances(const TArray<FCompushadyAccelerationStructureInstance>& Instances, TArray<Compushady::AccelerationStructure::FCompushadyInstanceDesc>& InstanceDescs, FString& ErrorMessages);
+
+	bool bIsTLAS = false;
+	bool bAllowUpdate = false;
+	bool bBuilt = false;
+	bool bInitialized = false;
+	/* set by the render thread when the RHI objects could not be created */
+	bool bBuildFailed = false;
+
+	FCompushadySignaled PendingOnSignaled;
+
+	/* BLAS inputs are kept alive as long as the acceleration structure */
+	UPROPERTY()
+	TArray<UCompushadyResource*> Inputs;
+
+	UPROPERTY()
+	TArray<UCompushadyAccelerationStructure*> ReferencedBLASes;
+
+	UPROPERTY()
+	UCompushadySRV* SRV = nullptr;
+
+	FBufferRHIRef ScratchBufferRHIRef;
+	FBufferRHIRef InstanceBufferRHIRef;
+	int64 InstanceBufferOffset = 0;
+	int32 NumInstances = 0;
+
+#if RHI_RAYTRACING
+	FRayTracingGeometryRHIRef GeometryRHIRef;
+	FRayTracingSceneRHIRef SceneRHIRef;
+	FBufferRHIRef SceneBufferRHIRef;
+#endif
+};
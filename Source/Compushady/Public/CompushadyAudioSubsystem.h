@@ -8,6 +8,53 @@
 #include "AudioBusSubsystem.h"
 #include "CompushadyAudioSubsystem.generated.h"
 
+namespace Compushady
+{
+	namespace Audio
+	{
+		/*
+		 * Fixed capacity single producer/single consumer ring of interleaved audio blocks.
+		 * The memory is allocated only at construction, producer and consumer can live on different threads.
+		 */
+		class COMPUSHADY_API FCompushadyAudioBlockRing
+		{
+		public:
+			FCompushadyAudioBlockRing(const int32 InNumBlocks, const int32 InBlockSize);
+
+			/* Producer side, returns nullptr when the ring is full */
+			float* BeginWrite();
+			void EndWrite();
+
+			/* Consumer side, returns nullptr when the ring is empty */
+			const float* BeginRead() const;
+			void EndRead();
+
+			int32 Num() const;
+			int32 GetNumBlocks() const { return NumBlocks; }
+			int32 GetBlockSize() const { return BlockSize; }
+
+		protected:
+			TArray<float> Samples;
+			int32 NumBlocks;
+			int32 BlockSize;
+			std::atomic<uint32> ReadIndex{ 0 };
+			std::atomic<uint32> WriteIndex{ 0 };
+		};
+
+		/* Converts interleaved frames to one row per channel (PlanarPitch is in samples, not bytes) */
+		COMPUSHADY_API void Deinterleave(const float* Interleaved, float* Planar, const int32 NumFrames, const int32 NumChannels, const int32 PlanarPitch);
+	}
+}
+
+struct FCompushadyAudioTexture
+{
+	FTextureRHIRef TextureRHIRef;
+	Audio::FPatchOutputStrongPtr PatchOutputStrongPtr;
+	TSharedPtr<Compushady::Audio::FCompushadyAudioBlockRing, ESPMode::ThreadSafe> Ring;
+	int32 NumFrames = 0;
+	int32 NumChannels = 0;
+};
+
 /**
  * 
  */
@@ -26,5 +73,5 @@ public:
 	bool ShouldCreateSubsystem(UObject* Outer) const override;
 
 protected:
-	TMap<TWeakObjectPtr<UCompushadyResource>, Audio::FPatchOutputStrongPtr> RegisteredAudioTextures;
+	TMap<TWeakObjectPtr<UCompushadyResource>, FCompushadyAudioTexture> RegisteredAudioTextures;
 };
@@ -8,8 +8,16 @@
 #include "CompushadyTypes.h"
 #include "CompushadyShader.h"
 #include "CompushadyCompute.h"
+#include "CompushadyRDG.h"
 #include "CompushadyBlendable.generated.h"
 
+UENUM(BlueprintType)
+enum class ECompushadyBlendableUpsampleFilter : uint8
+{
+	Bilinear,
+	EdgeAware
+};
+
 USTRUCT(BlueprintType)
 struct COMPUSHADY_API FCompushadyBlendableMatricesConfig
 {
@@ -44,6 +52,16 @@ struct COMPUSHADY_API FCompushadyBlendableMatricesConfig
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
 	int32 TimeFloatOffset = -1;
+
+	/* matrices of the previous frame of the view (the current ones on the first frame and after a camera cut) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 PreviousViewMatrixOffset = -1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 PreviousProjectionMatrixOffset = -1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 PreviousViewProjectionMatrixOffset = -1;
 };
 
 USTRUCT(BlueprintType)
@@ -64,6 +82,329 @@ public:
 	virtual void Disable() = 0;
 };
 
+namespace Compushady
+{
+	namespace Blendable
+	{
+		struct FCompushadyBlendablePassDesc
+		{
+			ECompushadyPostProcessLocation PostProcessLocation = ECompushadyPostProcessLocation::AfterTonemapping;
+			bool bCompute = false;
+			TArray<Compushady::RDG::FCompushadyRDGResourceAccess> Accesses;
+		};
+
+		/*
+		 * Splits the (ordered) blendables in render graph passes (as indices into Blendables).
+		 * Consecutive compute blendables at the same location share a single pass unless a resource
+		 * would be read by one of them and written by another (the graph would need a barrier in between).
+		 */
+		COMPUSHADY_API void BuildPassGroups(const TArray<FCompushadyBlendablePassDesc>& Blendables, TArray<TArray<int32>>& Groups);
+
+		struct FCompushadyBlendableViewData
+		{
+			FMatrix ViewMatrix = FMatrix::Identity;
+			FMatrix ProjectionMatrix = FMatrix::Identity;
+			FMatrix InverseViewMatrix = FMatrix::Identity;
+			FMatrix InverseProjectionMatrix = FMatrix::Identity;
+			FMatrix ViewProjectionMatrix = FMatrix::Identity;
+			FMatrix InverseViewProjectionMatrix = FMatrix::Identity;
+			FVector ViewOrigin = FVector::ZeroVector;
+			FIntPoint ScreenSize = FIntPoint::ZeroValue;
+			float DeltaTime = 0;
+			float Time = 0;
+			FMatrix PreviousViewMatrix = FMatrix::Identity;
+			FMatrix PreviousProjectionMatrix = FMatrix::Identity;
+			FMatrix PreviousViewProjectionMatrix = FMatrix::Identity;
+		};
+
+		/* Size of the render target of a blendable running at ResolutionScale (never smaller than 1x1) */
+		COMPUSHADY_API FIntPoint GetScaledSize(const FIntPoint& Size, const float ResolutionScale);
+
+		/*
+		 * Writes the view data in CBVData at the offsets of MatricesConfig (offsets out of the buffer are ignored).
+		 * ScreenSize is the scaled one, the matrices do not change as the scaled render target covers the same view.
+		 */
+		COMPUSHADY_API void FillMatrices(TArray<uint8>& CBVData, const FCompushadyBlendableMatricesConfig& MatricesConfig, const FCompushadyBlendableViewData& ViewData, const float ResolutionScale);
+
+		/* History textures are bound as the History0..History3 scene textures */
+		constexpr int32 MaxHistoryBuffers = 4;
+
+		enum class ECompushadyBlendableHistoryUpdate : uint8
+		{
+			/* same size and format, the valid history targets can be sampled */
+			Reused,
+			/* camera cut, the targets are kept but their contents are discarded */
+			Invalidated,
+			/* new view or size/format change, the previous targets are released to the pool */
+			Reallocated
+		};
+
+		/*
+		 * Per view history ring of a blendable, Targets[0] is the output of the previous frame.
+		 * It is owned by the render thread, TargetType is a template argument only for testing the pooling logic without a GPU.
+		 */
+		template<typename TargetType>
+		class TCompushadyBlendableHistory
+		{
+		public:
+			struct FView
+			{
+				FIntPoint Size = FIntPoint::ZeroValue;
+				EPixelFormat Format = PF_Unknown;
+				TArray<TargetType> Targets;
+				/* the target receiving the output of the current frame, it becomes Targets[0] on the next frame */
+				TargetType PendingTarget;
+				/* only the first NumValid targets have meaningful contents */
+				int32 NumValid = 0;
+				ECompushadyBlendableHistoryUpdate LastUpdate = ECompushadyBlendableHistoryUpdate::Reallocated;
+				uint32 FrameNumber = MAX_uint32;
+				uint32 MatricesFrameNumber = MAX_uint32;
+				uint32 LastSeenFrameNumber = 0;
+				bool bHasMatrices = false;
+				FMatrix ViewMatrix = FMatrix::Identity;
+				FMatrix ProjectionMatrix = FMatrix::Identity;
+				FMatrix ViewProjectionMatrix = FMatrix::Identity;
+				FMatrix PreviousViewMatrix = FMatrix::Identity;
+				FMatrix PreviousProjectionMatrix = FMatrix::Identity;
+				FMatrix PreviousViewProjectionMatrix = FMatrix::Identity;
+			};
+
+			void SetNumBuffers(const int32 InNumBuffers)
+			{
+				NumBuffers = FMath::Clamp(InNumBuffers, 0, MaxHistoryBuffers);
+			}
+
+			int32 GetNumBuffers() const
+			{
+				return NumBuffers;
+			}
+
+			/* Commits the output of the previous frame and validates the history against the current size, format and camera cut (only the first call of a frame counts) */
+			ECompushadyBlendableHistoryUpdate BeginFrame(const uint32 ViewKey, const FIntPoint& Size, const EPixelFormat Format, const bool bCameraCut, const uint32 FrameNumber)
+			{
+				FView& View = FindOrAddView(ViewKey, FrameNumber);
+				if (View.FrameNumber == FrameNumber)
+				{
+					return View.LastUpdate;
+				}
+				View.FrameNumber = FrameNumber;
+
+				if (View.PendingTarget)
+				{
+					View.Targets.Insert(MoveTemp(View.PendingTarget), 0);
+					View.PendingTarget = TargetType();
+					View.NumValid++;
+				}
+
+				while (View.Targets.Num() > NumBuffers)
+				{
+					View.Targets.Pop();
+				}
+				View.NumValid = FMath::Min(View.NumValid, View.Targets.Num());
+
+				if (View.Size != Size || View.Format != Format)
+				{
+					View.Targets.Empty();
+					View.NumValid = 0;
+					View.Size = Size;
+					View.Format = Format;
+					View.LastUpdate = ECompushadyBlendableHistoryUpdate::Reallocated;
+				}
+				else if (bCameraCut)
+				{
+					View.NumValid = 0;
+					View.LastUpdate = ECompushadyBlendableHistoryUpdate::Invalidated;
+				}
+				else
+				{
+					View.LastUpdate = ECompushadyBlendableHistoryUpdate::Reused;
+				}
+
+				return View.LastUpdate;
+			}
+
+			/*
+			 * The slot receiving the output of the current frame (call it after the history has been read).
+			 * When the ring is full the oldest target is recycled (bRecycled), otherwise the caller must allocate a new target into it.
+			 */
+			TargetType* AcquireTarget(const uint32 ViewKey, bool& bRecycled)
+			{
+				bRecycled = false;
+				TUniquePtr<FView>* View = Views.Find(ViewKey);
+				if (!View || NumBuffers == 0)
+				{
+					return nullptr;
+				}
+
+				if ((*View)->PendingTarget)
+				{
+					bRecycled = true;
+				}
+				else if ((*View)->Targets.Num() >= NumBuffers)
+				{
+					(*View)->PendingTarget = (*View)->Targets.Pop();
+					(*View)->NumValid = FMath::Min((*View)->NumValid, (*View)->Targets.Num());
+					bRecycled = true;
+				}
+
+				return &(*View)->PendingTarget;
+			}
+
+			/* Fills the previous matrices of ViewData and stores the current ones for the next frame */
+			void UpdateViewMatrices(const uint32 ViewKey, const bool bCameraCut, const uint32 FrameNumber, FCompushadyBlendableViewData& ViewData)
+			{
+				FView& View = FindOrAddView(ViewKey, FrameNumber);
+				if (View.MatricesFrameNumber != FrameNumber)
+				{
+					View.MatricesFrameNumber = FrameNumber;
+					const bool bUseCurrent = !View.bHasMatrices || bCameraCut;
+					View.PreviousViewMatrix = bUseCurrent ? ViewData.ViewMatrix : View.ViewMatrix;
+					View.PreviousProjectionMatrix = bUseCurrent ? ViewData.ProjectionMatrix : View.ProjectionMatrix;
+					View.PreviousViewProjectionMatrix = bUseCurrent ? ViewData.ViewProjectionMatrix : View.ViewProjectionMatrix;
+					View.ViewMatrix = ViewData.ViewMatrix;
+					View.ProjectionMatrix = ViewData.ProjectionMatrix;
+					View.ViewProjectionMatrix = ViewData.ViewProjectionMatrix;
+					View.bHasMatrices = true;
+				}
+
+				ViewData.PreviousViewMatrix = View.PreviousViewMatrix;
+				ViewData.PreviousProjectionMatrix = View.PreviousProjectionMatrix;
+				ViewData.PreviousViewProjectionMatrix = View.PreviousViewProjectionMatrix;
+			}
+
+			/* Releases the views not rendered in the last MaxAge frames (closed viewports, scene captures...) */
+			void RemoveStaleViews(const uint32 FrameNumber, const uint32 MaxAge)
+			{
+				for (auto It = Views.CreateIterator(); It; ++It)
+				{
+					if (FrameNumber - It->Value->LastSeenFrameNumber > MaxAge)
+					{
+						It.RemoveCurrent();
+					}
+				}
+			}
+
+			const FView* FindView(const uint32 ViewKey) const
+			{
+				const TUniquePtr<FView>* View = Views.Find(ViewKey);
+				return View ? View->Get() : nullptr;
+			}
+
+			int32 NumViews() const
+			{
+				return Views.Num();
+			}
+
+		protected:
+			FView& FindOrAddView(const uint32 ViewKey, const uint32 FrameNumber)
+			{
+				TUniquePtr<FView>& View = Views.FindOrAdd(ViewKey);
+				if (!View)
+				{
+					View = MakeUnique<FView>();
+				}
+				View->LastSeenFrameNumber = FrameNumber;
+				return *View;
+			}
+
+			int32 NumBuffers = 0;
+			// views are heap allocated as the render graph extracts the new targets directly into PendingTarget
+			TMap<uint32, TUniquePtr<FView>> Views;
+		};
+
+		/* Hash of the bound resources, their versions and the contents of the CBVs (scene textures are not tracked) */
+		COMPUSHADY_API uint32 GetResourcesSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed = 0);
+
+		/* The CBVs part of GetResourcesSignature (reads the CBVs data, so game thread only) */
+		COMPUSHADY_API uint32 GetCBVsSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed = 0);
+
+		/* The SRVs/UAVs part of GetResourcesSignature (safe on the render thread) */
+		COMPUSHADY_API uint32 GetResourceVersionsSignature(const FCompushadyResourceArray& ResourceArray, const uint32 Seed = 0);
+
+		/*
+		 * Per view cached outputs of a dirty driven blendable, a view is executed only when the signature of its inputs changes
+		 * or when the cached target is not valid (new view, size/format change). Like the history it is owned by the render thread.
+		 */
+		template<typename TargetType>
+		class TCompushadyBlendableOutputCache
+		{
+		public:
+			struct FView
+			{
+				FIntPoint Size = FIntPoint::ZeroValue;
+				EPixelFormat Format = PF_Unknown;
+				TargetType Target;
+				uint32 Signature = 0;
+				bool bValid = false;
+				uint32 LastSeenFrameNumber = 0;
+			};
+
+			/* Returns true if the view must be executed (the previous target is released on size/format change) */
+			bool BeginFrame(const uint32 ViewKey, const FIntPoint& Size, const EPixelFormat Format, const uint32 Signature, const uint32 FrameNumber)
+			{
+				TUniquePtr<FView>& View = Views.FindOrAdd(ViewKey);
+				if (!View)
+				{
+					View = MakeUnique<FView>();
+				}
+				View->LastSeenFrameNumber = FrameNumber;
+
+				if (View->Size != Size || View->Format != Format)
+				{
+					View->Size = Size;
+					View->Format = Format;
+					View->Target = TargetType();
+					View->bValid = false;
+				}
+
+				return !View->bValid || View->Signature != Signature;
+			}
+
+			/* Marks the cached output as valid for Signature (the signature of the inputs after the execution) */
+			void EndFrame(const uint32 ViewKey, const uint32 Signature)
+			{
+				if (TUniquePtr<FView>* View = Views.Find(ViewKey))
+				{
+					(*View)->Signature = Signature;
+					(*View)->bValid = true;
+				}
+			}
+
+			TargetType* GetTarget(const uint32 ViewKey)
+			{
+				TUniquePtr<FView>* View = Views.Find(ViewKey);
+				return View ? &(*View)->Target : nullptr;
+			}
+
+			void RemoveStaleViews(const uint32 FrameNumber, const uint32 MaxAge)
+			{
+				for (auto It = Views.CreateIterator(); It; ++It)
+				{
+					if (FrameNumber - It->Value->LastSeenFrameNumber > MaxAge)
+					{
+						It.RemoveCurrent();
+					}
+				}
+			}
+
+			const FView* FindView(const uint32 ViewKey) const
+			{
+				const TUniquePtr<FView>* View = Views.Find(ViewKey);
+				return View ? View->Get() : nullptr;
+			}
+
+			int32 NumViews() const
+			{
+				return Views.Num();
+			}
+
+		protected:
+			// views are heap allocated as the render graph extracts the new targets directly into Target
+			TMap<uint32, TUniquePtr<FView>> Views;
+		};
+	}
+}
+
 /**
  *
  */
@@ -101,6 +442,31 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	bool UpdateComputeResourcesByMapAdvanced(const TMap<FString, TScriptInterface<ICompushadyBindable>>& InResourceMap, const FIntVector& InXYZ, const FCompushadyBlendableMatricesConfig& BlendableMatricesConfig, FString& ErrorMessages);
 
+	/*
+	 * Full screen pixel shaders (without a custom vertex shader) are rendered into a render target scaled by InResolutionScale and then upsampled to the view.
+	 * Compute blendables only get the scaled ScreenSize (they write to their own UAVs, so the dispatch size is still up to the user).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool SetResolutionScale(const float InResolutionScale, const ECompushadyBlendableUpsampleFilter InUpsampleFilter, FString& ErrorMessages);
+
+	/*
+	 * Keeps the last InNumHistoryBuffers outputs of the blendable (per view) bound to the History0..HistoryN SRVs (missing History entries of the maps are filled automatically).
+	 * The output is the render target for pixel shaders and the first (texture) UAV for compute. Only AddToBlitter blendables have history.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool SetHistory(const int32 InNumHistoryBuffers, FString& ErrorMessages);
+
+	/*
+	 * Dirty driven blendables are executed only when their inputs change: bound resources versions, CBVs contents, view matrices or a MarkDirty() call.
+	 * Full screen pixel shaders render into a cached target (written to the view every frame), compute blendables just skip the dispatch.
+	 * Scene textures (except the history ones) cannot be bound, time and delta time are not tracked. Only AddToBlitter blendables can be dirty driven.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool SetDirtyDriven(const bool bInDirtyDriven, FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void MarkDirty();
+
 	UFUNCTION(BlueprintCallable, meta = (WorldContext = "WorldContextObject"), Category = "Compushady")
 	FGuid AddToBlitter(UObject* WorldContextObject, const int32 Priority = 0, class ACompushadyBlitterActor* BlitterActor = nullptr);
 
@@ -140,4 +506,18 @@ protected:
 	int32 NumInstances = 0;
 
 	FCompushadyBlendableRasterizerConfig RasterizerConfig;
+
+	float ResolutionScale = 1;
+	ECompushadyBlendableUpsampleFilter UpsampleFilter = ECompushadyBlendableUpsampleFilter::Bilinear;
+
+	FPixelShaderRHIRef UpsamplePixelShaderRef = nullptr;
+	FCompushadyResourceBindings UpsampleResourceBindings;
+	FUniformBufferLayoutRHIRef UpsampleUniformBufferLayoutRef;
+
+	int32 NumHistoryBuffers = 0;
+
+	bool CreateUpsamplePixelShader(const ECompushadyBlendableUpsampleFilter InUpsampleFilter, FString& ErrorMessages);
+
+	bool bDirtyDriven = false;
+	TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> DirtyCounter = MakeShared<FThreadSafeCounter, ESPMode::ThreadSafe>();
 };
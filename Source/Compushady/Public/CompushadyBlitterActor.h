@@ -9,6 +9,77 @@
 
 class ICompushadyTransientBlendable;
 
+struct FCompushadyBlitterDrawable
+{
+	FGuid Guid;
+	FTextureRHIRef Texture;
+	FShaderResourceViewRHIRef SRV;
+	FVector4 Quad;
+	ECompushadyKeepAspectRatio AspectRatio;
+	int32 Priority;
+
+	FCompushadyBlitterDrawable()
+	{
+		Guid = FGuid::NewGuid();
+		Texture = nullptr;
+		SRV = nullptr;
+		Quad = FVector4::Zero();
+		AspectRatio = ECompushadyKeepAspectRatio::None;
+		Priority = 0;
+	}
+};
+
+namespace Compushady
+{
+	namespace Blitter
+	{
+		// must match the blitter shaders
+		constexpr int32 MaxInstancesPerDraw = 64;
+		constexpr int32 MaxTexturesPerDraw = 16;
+
+		/* A group of drawables rendered with a single instanced draw */
+		struct FCompushadyBlitterBatch
+		{
+			// in draw order
+			TArray<int32> DrawableIndices;
+			// texture slot of each drawable (same size of DrawableIndices)
+			TArray<int32> TextureSlots;
+			// index of the first drawable using each texture slot
+			TArray<int32> TextureDrawableIndices;
+		};
+
+		/*
+		 * Sorts drawables by priority (lower priorities are drawn first, equal priorities keep insertion order)
+		 * and groups them in batches honoring the per-draw instances and textures limits.
+		 * A MaxInstances of 1 generates a draw per drawable (the unbatched path).
+		 */
+		COMPUSHADY_API void BuildBatches(const TArray<int32>& Priorities, const TArray<UPTRINT>& TextureKeys, TArray<FCompushadyBlitterBatch>& Batches, const int32 MaxInstances = MaxInstancesPerDraw);
+
+		/* The blitter shaders and states, shared by all of the passes of a blitter */
+		class COMPUSHADY_API FCompushadyBlitterPipeline
+		{
+		public:
+			/* Game thread */
+			bool Initialize(FString& ErrorMessages);
+
+			/* Alpha blends the drawables over RenderTarget, returns the number of draw calls */
+			int32 Rasterize_RenderThread(const TCHAR* PassName, FRHICommandList& RHICmdList, const FIntRect& ViewRect, FTextureRHIRef RenderTarget, const TArray<FCompushadyBlitterDrawable>& Drawables, const int32 MaxInstances = MaxInstancesPerDraw);
+
+		protected:
+			FVertexShaderRHIRef VertexShaderRef;
+			FCompushadyResourceBindings VSResourceBindings;
+
+			FPixelShaderRHIRef PixelShaderRef;
+			FCompushadyResourceBindings PSResourceBindings;
+
+			FUniformBufferLayoutRHIRef UniformBufferLayoutRef;
+			FUniformBufferRHIRef UniformBufferRef;
+			FSamplerStateRHIRef SamplerStateRef;
+			TArray<int32> PSTextureSlots;
+		};
+	}
+}
+
 UCLASS()
 class COMPUSHADY_API ACompushadyBlitterActor : public AActor
 {
@@ -27,13 +98,13 @@ public:
 	virtual void Tick(float DeltaTime) override;
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	FGuid AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid AddDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	FGuid AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid AddBeforePostProcessingDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	FGuid AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid AddAfterMotionBlurDrawable(UCompushadyResource* Resource, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	void RemoveDrawable(const FGuid& Guid);
@@ -0,0 +1,225 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "CompushadyTypes.h"
+#include "RenderingThread.h"
+#include "Tickable.h"
+#include "CompushadyBrickedVolume.generated.h"
+
+class UCompushadySRV;
+class UCompushadyUAV;
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyBrickedVolumeStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 ResidentBricks = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 LoadedBricks = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 EvictedBricks = 0;
+
+	// requests not served because the pool was full of bricks requested in the same update (or because of MaxBricks)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 DroppedRequests = 0;
+
+	// bricks that could not be read from the file
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 FailedBricks = 0;
+};
+
+namespace Compushady
+{
+	namespace Bricks
+	{
+		/* Brick and pool slot addressing, all of the coordinates are in bricks unless specified */
+		struct COMPUSHADY_API FCompushadyBrickLayout
+		{
+			FIntVector VolumeSize = FIntVector::ZeroValue;
+			int32 BrickSize = 0;
+			FIntVector NumBricks = FIntVector::ZeroValue;
+			FIntVector PoolSize = FIntVector::ZeroValue;
+
+			static bool Create(const FIntVector& VolumeSize, const int32 BrickSize, const FIntVector& PoolSize, FCompushadyBrickLayout& Layout, FString& ErrorMessages);
+
+			int32 GetNumBricks() const { return NumBricks.X * NumBricks.Y * NumBricks.Z; }
+			int32 GetNumSlots() const { return PoolSize.X * PoolSize.Y * PoolSize.Z; }
+
+			int32 GetBrickIndex(const FIntVector& Brick) const;
+			FIntVector GetBrickCoordinates(const int32 BrickIndex) const;
+			FIntVector GetSlotCoordinates(const int32 Slot) const;
+
+			/* Voxels of the brick inside the volume (bricks at the volume edges are partially filled) */
+			FIntVector GetBrickOrigin(const int32 BrickIndex) const;
+			FIntVector GetBrickExtent(const int32 BrickIndex) const;
+
+			/* Bit 31: resident, bits 0-9/10-19/20-29: pool slot coordinates. 0 for non resident bricks */
+			uint32 GetPageTableEntry(const int32 Slot) const;
+		};
+
+		struct FCompushadyBrickLoad
+		{
+			int32 Brick = INDEX_NONE;
+			int32 Slot = INDEX_NONE;
+			// the brick previously in the slot (INDEX_NONE for free slots)
+			int32 EvictedBrick = INDEX_NONE;
+		};
+
+		/* CPU side page table with LRU slot replacement */
+		class COMPUSHADY_API FCompushadyBrickCache
+		{
+		public:
+			FCompushadyBrickCache(const FCompushadyBrickLayout& InLayout);
+
+			/*
+			 * Resident requested bricks are refreshed first, then the missing ones get the least recently used slots.
+			 * Bricks requested in the same call are never evicted by each other.
+			 */
+			void ProcessRequests(const TArray<int32>& Requests, const int32 MaxLoads, TArray<FCompushadyBrickLoad>& Loads);
+
+			/* Makes the brick non resident, its slot is the first to be reused */
+			void Release(const int32 Brick);
+
+			int32 GetSlot(const int32 Brick) const { return BrickToSlot[Brick]; }
+			int32 GetBrick(const int32 Slot) const { return SlotToBrick[Slot]; }
+			uint32 GetPageTableEntry(const int32 Brick) const { return PageTable[Brick]; }
+			const TArray<uint32>& GetPageTable() const { return PageTable; }
+
+			/* The smallest box of page table entries containing Bricks (for a single texture region update) */
+			void GetPageTableRegion(const TArray<int32>& Bricks, FIntVector& RegionOrigin, FIntVector& RegionSize, TArray<uint32>& Entries) const;
+
+			/* From the least to the most recently used */
+			TArray<int32> GetLRUBricks() const;
+
+			int32 GetNumResident() const { return NumResident; }
+			int64 GetNumDropped() const { return NumDropped; }
+			int64 GetNumEvicted() const { return NumEvicted; }
+
+		protected:
+			void Unlink(const int32 Slot);
+			void PushFront(const int32 Slot);
+
+			FCompushadyBrickLayout Layout;
+
+			TArray<int32> BrickToSlot;
+			TArray<int32> SlotToBrick;
+			TArray<uint32> PageTable;
+
+			// the LRU list of used slots, Head is the most recently used
+			TArray<int32> SlotPrev;
+			TArray<int32> SlotNext;
+			TArray<uint64> SlotBatch;
+			int32 Head = INDEX_NONE;
+			int32 Tail = INDEX_NONE;
+			TArray<int32> FreeSlots;
+			uint64 Batch = 0;
+
+			int32 NumResident = 0;
+			int64 NumDropped = 0;
+			int64 NumEvicted = 0;
+		};
+
+		/* Reads bricks from a raw volume file, voxels outside of the volume are zeroed */
+		class COMPUSHADY_API FCompushadyBrickSource
+		{
+		public:
+			static TSharedPtr<FCompushadyBrickSource> Create(const FString& Filename, const int64 Offset, const FCompushadyBrickLayout& Layout, const EPixelFormat PixelFormat, const bool bBigEndian, FString& ErrorMessages);
+
+			FCompushadyBrickSource(const FCompushadyBrickSource&) = delete;
+			FCompushadyBrickSource& operator=(const FCompushadyBrickSource&) = delete;
+
+			/* Output must be BrickSize^3 texels */
+			bool ReadBrick(const int32 BrickIndex, uint8* Output, FString& ErrorMessages);
+
+			int64 GetBrickDataSize() const;
+
+		protected:
+			FCompushadyBrickSource() = default;
+
+			TUniquePtr<FArchive> Archive;
+			int64 Offset = 0;
+			FCompushadyBrickLayout Layout;
+			EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
+			bool bBigEndian = false;
+		};
+
+		struct FCompushadyBrickStreamer;
+	}
+}
+
+/**
+ * Sparse streaming of volumes bigger than the GPU memory.
+ * The volume is split in bricks, a pool texture keeps the resident ones and a page table texture (one R32_UINT texel per brick)
+ * maps bricks to pool slots. Shaders flag the missing bricks (any non zero value) in the request buffer (one uint per brick),
+ * the requests are read back and the bricks are loaded in the least recently used slots.
+ */
+UCLASS(BlueprintType)
+class COMPUSHADY_API UCompushadyBrickedVolume : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	void BeginDestroy() override;
+	bool IsReadyForFinishDestroy() override;
+
+	void Tick(float DeltaTime) override;
+	TStatId GetStatId() const override;
+	bool IsTickable() const override;
+	bool IsTickableInEditor() const override { return true; }
+	bool IsTickableWhenPaused() const override { return true; }
+
+	/* PoolSize is the number of bricks (per axis) kept on the GPU */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeFromFile(const FString& Name, const FString& Filename, const FIntVector VolumeSize, const EPixelFormat PixelFormat, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages, const int64 Offset = 0);
+
+	/* Only raw encoded NRRD files with a single data file can be randomly accessed */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool InitializeFromNRRDFile(const FString& Name, const FString& Filename, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages);
+
+	/*
+	 * The requests are read back without stalling (the readback is polled on the following frames), the bricks are loaded on the thread pool
+	 * and uploaded (clearing the request buffer) from the game thread. Up to 3 updates can be in flight. MaxBricks <= 0 means no limit
+	 */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void UpdateFromRequests(const int32 MaxBricks, const FCompushadySignaled& OnSignaled);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool UpdateFromRequestsSync(const int32 MaxBricks, FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsStreaming() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FIntVector GetNumBricks() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int32 GetBrickSize() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FCompushadyBrickedVolumeStats GetStats() const;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	UCompushadySRV* BrickPool;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	UCompushadySRV* PageTable;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	UCompushadyUAV* RequestBuffer;
+
+protected:
+	bool Initialize(const FString& Name, const FString& Filename, const int64 Offset, const FIntVector VolumeSize, const EPixelFormat PixelFormat, const bool bBigEndian, const int32 BrickSize, const FIntVector PoolSize, FString& ErrorMessages);
+
+	TSharedPtr<Compushady::Bricks::FCompushadyBrickStreamer, ESPMode::ThreadSafe> Streamer;
+
+	/* Readbacks still in flight when the volume is destroyed */
+	FRenderCommandFence DestroyFence;
+};
@@ -0,0 +1,169 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Compushady.h"
+#include "Commandlets/Commandlet.h"
+#include "HAL/PlatformProcess.h"
+#include "CompushadyCompileWorker.generated.h"
+
+namespace Compushady
+{
+	enum class ECompushadyCompileJobLanguage : uint8
+	{
+		HLSL,
+		GLSL
+	};
+
+	enum class ECompushadyCompileWorkerStatus : uint8
+	{
+		Completed,
+		Crashed,
+		TimedOut,
+		Unavailable
+	};
+
+	struct COMPUSHADY_API FCompushadyCompileJob
+	{
+		ECompushadyCompileJobLanguage Language = ECompushadyCompileJobLanguage::HLSL;
+		TArray<uint8> ShaderCode;
+		FString EntryPoint;
+		FString TargetProfile;
+		bool bSPIRV = false;
+		bool bValidate = false;
+
+		bool Serialize(FArchive& Ar);
+	};
+
+	struct COMPUSHADY_API FCompushadyCompileJobResult
+	{
+		bool bSuccess = false;
+		TArray<uint8> ByteCode;
+		FString ErrorMessages;
+
+		bool Serialize(FArchive& Ar);
+	};
+
+	struct COMPUSHADY_API FCompushadyCompileWorkerConfig
+	{
+		// if empty, the current executable is relaunched with -run=CompushadyCompileWorker (editor builds only).
+		// Cooked and Shipping builds require a standalone worker speaking the commandlet protocol (-JobDir, -Semaphore, -ParentPID),
+		// like an uncooked editor build with "Project.uproject -run=CompushadyCompileWorker" in ExtraArguments
+		FString Executable;
+		FString ExtraArguments;
+		// 0 means one worker per physical core (minus one for the game thread)
+		int32 NumWorkers = 0;
+		// the compile timeout starts when the job is submitted to a ready worker
+		double TimeoutSeconds = 30;
+		// maximum time for a (re)launched worker to signal it is ready, workers are launched (and waited for) in the background
+		double StartupTimeoutSeconds = 120;
+		// maximum wait for a ready worker (all busy or still starting), then the job is reported as Unavailable
+		double AcquireTimeoutSeconds = 10;
+		// a worker is relaunched after compiling this number of jobs (0 disables recycling)
+		int32 MaxJobsPerWorker = 256;
+		// compile in-process when a worker cannot be launched or started (crashes and timeouts of jobs are never retried in-process)
+		bool bFallbackToInProcess = true;
+	};
+
+	class COMPUSHADY_API FCompushadyCompileWorkerPool
+	{
+	public:
+		FCompushadyCompileWorkerPool(const FCompushadyCompileWorkerConfig& InConfig);
+		~FCompushadyCompileWorkerPool();
+
+		FCompushadyCompileWorkerPool(const FCompushadyCompileWorkerPool&) = delete;
+		FCompushadyCompileWorkerPool& operator=(const FCompushadyCompileWorkerPool&) = delete;
+
+		/* Waits (up to AcquireTimeoutSeconds) for a ready worker, then until the job is completed, the worker dies or the timeout expires */
+		ECompushadyCompileWorkerStatus Compile(const FCompushadyCompileJob& Job, FCompushadyCompileJobResult& Result);
+
+		/* Launches the idle workers in the background, without waiting for them */
+		void LaunchWorkers();
+
+		bool CompileWithFallback(const FCompushadyCompileJob& Job, TArray<uint8>& ByteCode, FString& ErrorMessages);
+
+		int32 GetNumWorkers() const
+		{
+			return Workers.Num();
+		}
+
+		int32 GetNumLaunchedProcesses() const
+		{
+			return NumLaunchedProcesses;
+		}
+
+		/* Idle workers ready to accept a job */
+		int32 GetNumReadyWorkers();
+
+		const FCompushadyCompileWorkerConfig& GetConfig() const
+		{
+			return Config;
+		}
+
+	protected:
+		struct FWorker
+		{
+			FProcHandle ProcHandle;
+			FString JobDirectory;
+			// signaled by the parent when a job (or the quit request) is available
+			FPlatformProcess::FSemaphore* JobSemaphore = nullptr;
+			// signaled by the worker when it is ready and whenever a result is available
+			FPlatformProcess::FSemaphore* ResultSemaphore = nullptr;
+			int32 CompletedJobs = 0;
+			int32 NumLaunches = 0;
+			bool bBusy = false;
+			// owned by the launching thread until it is ready (or failed)
+			bool bLaunching = false;
+			bool bLaunchFailed = false;
+		};
+
+		/* INDEX_NONE when no worker is ready within AcquireTimeoutSeconds (or none can be launched) */
+		int32 AcquireWorker();
+		void ReleaseWorker(const int32 WorkerIndex);
+		/* Must be called with WorkersLock held */
+		void LaunchWorkerAsync(const int32 WorkerIndex);
+		bool LaunchWorker(const int32 WorkerIndex);
+		void KillWorker(FWorker& Worker);
+		bool IsWorkerAlive(FWorker& Worker);
+		/* Waits for the worker semaphore, false if the worker exits or the timeout expires */
+		bool WaitForWorker(FWorker& Worker, const double TimeoutSeconds);
+
+		FCompushadyCompileWorkerConfig Config;
+		FString PoolDirectory;
+		TArray<FWorker> Workers;
+		FCriticalSection WorkersLock;
+		FEvent* WorkerReleasedEvent = nullptr;
+		TAtomic<int32> NumLaunchedProcesses = 0;
+		TAtomic<int32> NumLaunching = 0;
+		TAtomic<bool> bShuttingDown = false;
+	};
+
+	namespace CompileWorker
+	{
+		/* Validates the worker executable (required outside of the editor) and launches the workers in the background */
+		COMPUSHADY_API bool Enable(const FCompushadyCompileWorkerConfig& Config, FString& ErrorMessages);
+		COMPUSHADY_API void Disable();
+		COMPUSHADY_API bool IsEnabled();
+		COMPUSHADY_API bool Compile(const FCompushadyCompileJob& Job, TArray<uint8>& ByteCode, FString& ErrorMessages);
+
+		COMPUSHADY_API bool ExecuteJob(const FCompushadyCompileJob& Job, FCompushadyCompileJobResult& Result);
+
+		/* Only editor (uncooked) builds can relaunch themselves as the worker commandlet */
+		COMPUSHADY_API bool CanRunCommandlet();
+	}
+}
+
+/**
+ * The child process side of the compile worker pool: waits for jobs in its directory, compiles and writes back the results.
+ */
+UCLASS()
+class COMPUSHADY_API UCompushadyCompileWorkerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCompushadyCompileWorkerCommandlet();
+
+	int32 Main(const FString& Params) override;
+};
@@ -20,7 +20,8 @@ class COMPUSHADY_API UCompushadyCompute : public UObject, public ICompushadyPipe
 	GENERATED_BODY()
 
 public:
-	bool InitFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FString& ErrorMessages);
+	/* use a Shader Model 6.5 TargetProfile (cs_6_5) for inline ray tracing (RayQuery) */
+	bool InitFromHLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FString& ErrorMessages, const FString& TargetProfile = "cs_6_0");
 
 	bool InitFromGLSL(const TArray<uint8>& ShaderCode, const FString& EntryPoint, FString& ErrorMessages);
 
@@ -133,14 +133,15 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadyUAV* CreateCompushadyUAVStructuredBuffer(const FString& Name, const int64 Size, const int32 Stride);
 
+	/* NumMips <= 0 allocates the full mip chain, the mips can be filled with GenerateMips */
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	static UCompushadyUAV* CreateCompushadyUAVTexture2D(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format);
+	static UCompushadyUAV* CreateCompushadyUAVTexture2D(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format, const int32 NumMips = 1);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadyUAV* CreateCompushadyUAVSharedTexture2D(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	static UCompushadyUAV* CreateCompushadyUAVTexture3D(const FString& Name, const int32 Width, const int32 Height, const int32 Depth, const EPixelFormat Format);
+	static UCompushadyUAV* CreateCompushadyUAVTexture3D(const FString& Name, const int32 Width, const int32 Height, const int32 Depth, const EPixelFormat Format, const int32 NumMips = 1);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadyUAV* CreateCompushadyUAVTexture2DArray(const FString& Name, const int32 Width, const int32 Height, const int32 Slices, const EPixelFormat Format);
@@ -163,8 +164,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadySRV* CreateCompushadySRVTexture3D(const FString& Name, const int32 Width, const int32 Height, const int32 Depth, const EPixelFormat Format);
 
+	/* NumMips <= 0 generates the full mip chain (with a Box filter) */
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	static UCompushadySRV* CreateCompushadySRVTexture2DFromImageFile(const FString& Name, const FString& Filename);
+	static UCompushadySRV* CreateCompushadySRVTexture2DFromImageFile(const FString& Name, const FString& Filename, const int32 NumMips = 1);
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadySRV* CreateCompushadySRVTexture2DFromRandomStream(const FString& Name, const int32 Width, const int32 Height, const EPixelFormat Format, const FRandomStream& RandomStream);
@@ -221,7 +223,7 @@ public:
 	static UCompushadyUAV* CreateCompushadyUAVFromRenderTargetVolume(UTextureRenderTargetVolume* RenderTargetVolume);
 
 	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "FileLoaderConfig", AdvancedDisplay = "FileLoaderConfig"), Category = "Compushady")
-	static UCompushadyCompute* CreateCompushadyComputeFromHLSLFile(const FString& Filename, FString& ErrorMessages, const FString& EntryPoint = "main", const FCompushadyFileLoaderConfig& FileLoaderConfig = FCompushadyFileLoaderConfig());
+	static UCompushadyCompute* CreateCompushadyComputeFromHLSLFile(const FString& Filename, FString& ErrorMessages, const FString& EntryPoint = "main", const FCompushadyFileLoaderConfig& FileLoaderConfig = FCompushadyFileLoaderConfig(), const FString& TargetProfile = "cs_6_0");
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadyCompute* CreateCompushadyComputeFromSPIRVFile(const FString& Filename, FString& ErrorMessages);
@@ -263,7 +265,7 @@ public:
 	static UCompushadyCompute* CreateCompushadyComputeFromGLSLFile(const FString& Filename, FString& ErrorMessages, const FString& EntryPoint = "main", const FCompushadyFileLoaderConfig& FileLoaderConfig = FCompushadyFileLoaderConfig());
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	static UCompushadyCompute* CreateCompushadyComputeFromHLSLString(const FString& ShaderSource, FString& ErrorMessages, const FString& EntryPoint = "main");
+	static UCompushadyCompute* CreateCompushadyComputeFromHLSLString(const FString& ShaderSource, FString& ErrorMessages, const FString& EntryPoint = "main", const FString& TargetProfile = "cs_6_0");
 
 	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "RasterizerConfig"), Category = "Compushady")
 	static UCompushadyRasterizer* CreateCompushadyVSPSRasterizerFromHLSLString(const FString& VertexShaderSource, const FString& PixelShaderSource, const FCompushadyRasterizerConfig& RasterizerConfig, FString& ErrorMessages, const FString& VertexShaderEntryPoint = "main", const FString& PixelShaderEntryPoint = "main");
@@ -275,7 +277,7 @@ public:
 	static UCompushadyRayTracer* CreateCompushadyRayTracerFromHLSLString(const FString& RayGenShaderSource, const FString& RayHitShaderSource, const FString& RayMissShaderSource, FString& ErrorMessages, const FString& RayGenShaderEntryPoint = "main", const FString& RayHitShaderEntryPoint = "main", const FString& RayMissShaderEntryPoint = "main");
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	static UCompushadyCompute* CreateCompushadyComputeFromHLSLShaderAsset(UCompushadyShader* ShaderAsset, FString& ErrorMessages, const FString& EntryPoint = "main");
+	static UCompushadyCompute* CreateCompushadyComputeFromHLSLShaderAsset(UCompushadyShader* ShaderAsset, FString& ErrorMessages, const FString& EntryPoint = "main", const FString& TargetProfile = "cs_6_0");
 
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadySoundWave* CreateCompushadyUAVSoundWave(const FString& Name, const float Duration, const int32 SampleRate = 48000, const int32 NumChannels = 2, UAudioBus* AudioBus = nullptr);
@@ -313,6 +315,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	static UCompushadySRV* CreateCompushadySRVFromResource(UCompushadyResource* Resource, const int32 Slice, const int32 MipLevel, const int32 NumSlices = 1, const int32 NumMips = 1, const EPixelFormat PixelFormat = EPixelFormat::PF_Unknown);
 
+	/* UAV of a single mip of a texture created with the UAV flag */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	static UCompushadyUAV* CreateCompushadyUAVFromResource(UCompushadyResource* Resource, const int32 MipLevel);
+
 	UFUNCTION(BlueprintCallable, meta = (WorldContext = "WorldContextObject"), Category = "Compushady")
 	static UCompushadySRV* CreateCompushadySRVFromWorldSceneAccelerationStructure(UObject* WorldContextObject);
 
@@ -0,0 +1,158 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "CompushadyOrderedWriter.h"
+#include "CompushadyTypes.h"
+#include "RenderingThread.h"
+#include "Tickable.h"
+#include "CompushadyImageExporter.generated.h"
+
+UENUM(BlueprintType)
+enum class ECompushadyImageFormat : uint8
+{
+	PNG,
+	TIFF,
+	EXR,
+};
+
+UENUM(BlueprintType)
+enum class ECompushadyImageExportPolicy : uint8
+{
+	// frames exceeding the in-flight limit are discarded
+	Drop,
+	// the caller waits for a free slot
+	Block,
+};
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyImageExporterStats
+{
+	GENERATED_BODY()
+
+	// frames waiting for the GPU, the encoder or the file write
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 InFlightFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 PeakInFlightFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 DroppedFrames = 0;
+
+	// encoding or file write errors
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 FailedFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenBytes = 0;
+};
+
+namespace Compushady
+{
+	namespace Image
+	{
+		struct FCompushadyImageExportReadbacks;
+
+		struct FCompushadyImageExportFrame
+		{
+			FString Filename;
+			FString ImageDescription;
+			TArray64<uint8> Pixels;
+			int32 Stride = 0;
+			int32 Width = 0;
+			int32 Height = 0;
+			EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
+		};
+
+		COMPUSHADY_API bool IsSupportedPixelFormat(const ECompushadyImageFormat Format, const EPixelFormat PixelFormat);
+
+		COMPUSHADY_API bool EncodeImage(const void* Data, const int32 Stride, const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const ECompushadyImageFormat Format, const FString& ImageDescription, TArray64<uint8>& Output, FString& ErrorMessages);
+
+		/*
+		 * Encodes frames on the thread pool and writes them in acquisition order.
+		 * Acquire() reserves one of the MaxInFlight slots of the ordered writer, the slot is released when the file is written.
+		 */
+		class COMPUSHADY_API FCompushadyImageExportQueue : public TSharedFromThis<FCompushadyImageExportQueue, ESPMode::ThreadSafe>
+		{
+		public:
+			FCompushadyImageExportQueue(const ECompushadyImageFormat InFormat, const int32 InMaxInFlight, const ECompushadyImageExportPolicy InPolicy);
+
+			FCompushadyImageExportQueue(const FCompushadyImageExportQueue&) = delete;
+			FCompushadyImageExportQueue& operator=(const FCompushadyImageExportQueue&) = delete;
+
+			/* Returns false if the frame has been dropped (never with the Block policy), must be called from a single thread */
+			bool Acquire(uint64& Sequence);
+			/* Releases an acquired slot without writing anything */
+			void Cancel(const uint64 Sequence);
+			/* Can be called from any thread, the frames are written in the order of their Acquire() */
+			void Submit(const uint64 Sequence, FCompushadyImageExportFrame&& Frame);
+
+			/* Waits for all of the acquired frames to be written */
+			void Flush();
+
+			int32 NumInFlight() const { return Writer.NumQueued(); }
+			int32 GetMaxInFlight() const { return Writer.GetMaxQueued(); }
+			ECompushadyImageFormat GetFormat() const { return Format; }
+			ECompushadyImageExportPolicy GetPolicy() const { return Policy; }
+			FCompushadyImageExporterStats GetStats() const;
+
+		protected:
+			ECompushadyImageFormat Format;
+			ECompushadyImageExportPolicy Policy;
+
+			// filename and encoded image (empty on encoding errors)
+			TCompushadyOrderedWriter<TPair<FString, TArray64<uint8>>> Writer;
+		};
+	}
+}
+
+/**
+ * Asynchronous texture export to image files.
+ * Textures are copied to a ring of readbacks, encoded on the thread pool and written in order,
+ * so frame sequences can be dumped without stalling the GPU.
+ * The readbacks are polled every tick, so the last frames are written even if nothing else is exported.
+ */
+UCLASS(BlueprintType)
+class COMPUSHADY_API UCompushadyImageExporter : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	void BeginDestroy() override;
+	bool IsReadyForFinishDestroy() override;
+
+	void Tick(float DeltaTime) override;
+	TStatId GetStatId() const override;
+	bool IsTickable() const override;
+	bool IsTickableInEditor() const override { return true; }
+	bool IsTickableWhenPaused() const override { return true; }
+
+	/* MaxInFlight bounds the frames between ExportTexture and the file write */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool Initialize(const ECompushadyImageFormat Format, FString& ErrorMessages, const int32 MaxInFlight = 8, const ECompushadyImageExportPolicy Policy = ECompushadyImageExportPolicy::Drop, const int32 NumReadbacks = 3);
+
+	/* Returns false on errors or when the frame has been dropped */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool ExportTexture(UCompushadyResource* Resource, const FString& Filename, FString& ErrorMessages, const FString& ImageDescription = "");
+
+	/* Waits for all of the exported frames to be written */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void Flush();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FCompushadyImageExporterStats GetStats() const;
+
+protected:
+	TSharedPtr<Compushady::Image::FCompushadyImageExportQueue, ESPMode::ThreadSafe> Queue;
+	TSharedPtr<Compushady::Image::FCompushadyImageExportReadbacks, ESPMode::ThreadSafe> Readbacks;
+
+	/* Frames still in the readbacks when the exporter is destroyed */
+	FRenderCommandFence DestroyFence;
+};
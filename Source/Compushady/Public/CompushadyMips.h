@@ -0,0 +1,72 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CompushadyTypes.h"
+
+namespace Compushady
+{
+	namespace Mips
+	{
+		/* Number of mips of the full chain (down to 1x1x1) */
+		COMPUSHADY_API int32 GetNumMips(const FIntVector& Size);
+
+		/* NumMips <= 0 means the full chain, bigger values are clamped to it */
+		COMPUSHADY_API int32 ClampNumMips(const FIntVector& Size, const int32 NumMips);
+
+		/* Sizes are rounded down (as in D3D/Vulkan), every axis is at least 1 */
+		COMPUSHADY_API FIntVector GetMipSize(const FIntVector& Size, const int32 MipLevel);
+
+		/*
+		 * Number of mips generated by a single dispatch starting from BaseMip (NumMips is the total number of mips of the texture).
+		 * Box/Min/Max generate up to 12 2D (4 3D) levels at once while the parent levels reduced in groupshared memory are even,
+		 * Kaiser (which reads outside of the 2x2 footprint) always generates a single level.
+		 */
+		COMPUSHADY_API int32 GetNumDispatchMips(const FIntVector& Size, const bool bVolume, const int32 BaseMip, const int32 NumMips, const ECompushadyMipFilter Filter);
+
+		/* Normalized weights of the outer (X) and inner (Y) taps of the 4 taps Kaiser windowed sinc */
+		COMPUSHADY_API FVector2f GetKaiserWeights(const float Beta = 4);
+
+		/*
+		 * CPU reference of the compute downsampler, Size is the size of the parent mip (Z is 1 for 2D textures).
+		 * Every child texel covers 2 parent texels per axis, the last one covers 3 of them when the parent size is odd.
+		 */
+		COMPUSHADY_API bool Downsample(const TArray<FLinearColor>& Pixels, const FIntVector& Size, const ECompushadyMipFilter Filter, TArray<FLinearColor>& Output, FIntVector& OutputSize);
+
+		/* Only 2D and 3D textures with the UAV flag, more than one mip and a float (or normalized) format */
+		COMPUSHADY_API bool CanGenerateMips(FRHITexture* Texture, FString& ErrorMessages);
+
+		/* Compute generation of the whole mip chain of a texture from its first mip */
+		class COMPUSHADY_API FCompushadyMipGenerator
+		{
+		public:
+			/* Game thread */
+			bool Initialize(FString& ErrorMessages);
+
+			void Generate_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Texture, const ECompushadyMipFilter Filter);
+
+			/* Game thread, the shaders are compiled on the first call and shared by all of the textures */
+			static TSharedPtr<FCompushadyMipGenerator, ESPMode::ThreadSafe> Get(FString& ErrorMessages);
+
+		protected:
+			struct FCompushadyMipShader
+			{
+				FComputeShaderRHIRef ComputeShaderRef;
+				FCompushadyResourceBindings ResourceBindings;
+				FIntVector ThreadGroupSize;
+			};
+
+			bool CompileShader(const TCHAR* EntryPoint, FCompushadyMipShader& Shader, FString& ErrorMessages);
+			void Dispatch_RenderThread(FRHICommandList& RHICmdList, const FCompushadyMipShader& Shader, FRHIShaderResourceView* Source, TFunction<FUnorderedAccessViewRHIRef(const int32)> UAVFunction, const FIntVector& BaseSize, const int32 NumLevels, const ECompushadyMipFilter Filter, const FIntVector& NumGroups);
+
+			FCompushadyMipShader Downsample2D;
+			FCompushadyMipShader Downsample3D;
+			FCompushadyMipShader Kaiser2D;
+			FCompushadyMipShader Kaiser3D;
+			FUniformBufferLayoutRHIRef UniformBufferLayoutRef;
+			FBufferRHIRef CounterBufferRHIRef;
+			FUnorderedAccessViewRHIRef CounterUAVRHIRef;
+		};
+	}
+}
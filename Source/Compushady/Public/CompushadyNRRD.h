@@ -0,0 +1,97 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CompushadyTypes.h"
+
+namespace Compushady
+{
+	namespace NRRD
+	{
+		enum class ECompushadyNRRDEncoding : uint8
+		{
+			Raw,
+			GZIP,
+			BZIP2
+		};
+
+		struct COMPUSHADY_API FCompushadyNRRDHeader
+		{
+			uint32 Width = 0;
+			uint32 Height = 1;
+			uint32 Depth = 1;
+			EPixelFormat PixelFormat = EPixelFormat::PF_Unknown;
+			ECompushadyNRRDEncoding Encoding = ECompushadyNRRDEncoding::Raw;
+			bool bBigEndian = false;
+			int64 LineSkip = 0;
+			/* -1 (raw encoding only) means the data is at the end of the file */
+			int64 ByteSkip = 0;
+			/* Full paths of the detached data files (every one with the same share of the volume), empty for attached data */
+			TArray<FString> DataFiles;
+			/* Attached data only: the header file and the offset of the data in it */
+			FString Filename;
+			int64 DataOffset = 0;
+
+			int64 GetSliceSize() const;
+			int64 GetDataSize() const;
+		};
+
+		/* Parses .nrrd (attached) and .nhdr (detached) headers, reading only the header bytes */
+		COMPUSHADY_API bool ParseHeader(const FString& Filename, FCompushadyNRRDHeader& Header, FString& ErrorMessages);
+
+		/* Raw data in a single file only: the file and the offset of the first voxel, for random access */
+		COMPUSHADY_API bool GetRawDataLocation(const FCompushadyNRRDHeader& Header, FString& DataFilename, int64& Offset, FString& ErrorMessages);
+
+		/* In place byte swap of 2, 4 or 8 bytes elements, 16 bytes at a time with vector shifts */
+		COMPUSHADY_API void SwapEndianness(uint8* Data, const int64 NumElements, const int32 ElementSize);
+
+		/* Sequential decoder of a compressed (or raw) byte stream, compressed data is pulled in small chunks */
+		class COMPUSHADY_API FCompushadyNRRDStream
+		{
+		public:
+			virtual ~FCompushadyNRRDStream() = default;
+
+			/* Reads exactly Size bytes */
+			virtual bool Read(uint8* Output, const int64 Size, FString& ErrorMessages) = 0;
+
+			bool Skip(const int64 Size, FString& ErrorMessages);
+
+			/* Archive must stay valid for the stream lifetime, the compressed data ends at End (or at the end of the archive) */
+			static TUniquePtr<FCompushadyNRRDStream> Create(const ECompushadyNRRDEncoding Encoding, FArchive& Archive, const int64 End = -1);
+		};
+
+		/*
+		 * Streaming NRRD volume reader, slices are decoded on demand (in native endianness)
+		 * so the peak memory is bounded by the slices requested at once.
+		 */
+		class COMPUSHADY_API FCompushadyNRRDReader
+		{
+		public:
+			static TSharedPtr<FCompushadyNRRDReader> Create(const FString& Filename, FString& ErrorMessages);
+
+			FCompushadyNRRDReader(const FCompushadyNRRDReader&) = delete;
+			FCompushadyNRRDReader& operator=(const FCompushadyNRRDReader&) = delete;
+
+			const FCompushadyNRRDHeader& GetHeader() const { return Header; }
+			int32 GetNextSlice() const { return NextSlice; }
+
+			/* Output must be at least NumSlices * GetSliceSize() bytes */
+			bool ReadSlices(uint8* Output, const int32 NumSlices, FString& ErrorMessages);
+
+		protected:
+			FCompushadyNRRDReader() = default;
+
+			bool OpenDataFile(const int32 DataFileIndex, FString& ErrorMessages);
+
+			FCompushadyNRRDHeader Header;
+			int32 NextSlice = 0;
+
+			int32 DataFileIndex = -1;
+			int64 DataFileSize = 0;
+			int64 DataFileRemaining = 0;
+			TUniquePtr<FArchive> Archive;
+			TUniquePtr<FCompushadyNRRDStream> Stream;
+		};
+	}
+}
@@ -0,0 +1,252 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Event.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include <atomic>
+
+namespace Compushady
+{
+	/*
+	 * Writes items from a dedicated thread in sequence order.
+	 * Every item reserves a sequence (at most MaxQueued items are reserved and not yet written) and can be submitted later,
+	 * from any thread and in any order (e.g. after being encoded on the thread pool), the writer thread restores the order.
+	 * Reserve (with bWait) and Flush wait on the writer, so they must be called from a single thread.
+	 */
+	template<typename ItemType>
+	class TCompushadyOrderedWriter : public FRunnable
+	{
+	public:
+		/* Returns false on failure, WrittenBytes are added to the stats */
+		using FWriteFunction = TFunction<bool(ItemType& Item, int64& WrittenBytes)>;
+
+		TCompushadyOrderedWriter(const int32 InMaxQueued, FWriteFunction InWriteFunction) : MaxQueued(FMath::Max(InMaxQueued, 1)), WriteFunction(MoveTemp(InWriteFunction))
+		{
+			WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+			WrittenEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		}
+
+		~TCompushadyOrderedWriter()
+		{
+			Close();
+			FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+			FPlatformProcess::ReturnSynchEventToPool(WrittenEvent);
+		}
+
+		TCompushadyOrderedWriter(const TCompushadyOrderedWriter&) = delete;
+		TCompushadyOrderedWriter& operator=(const TCompushadyOrderedWriter&) = delete;
+
+		bool Start(const TCHAR* ThreadName, FString& ErrorMessages)
+		{
+			Thread = FRunnableThread::Create(this, ThreadName);
+			if (!Thread)
+			{
+				ErrorMessages = "Unable to create the writer thread";
+				return false;
+			}
+			return true;
+		}
+
+		/* Returns false (and counts the item as dropped) when MaxQueued items are pending and bWait is false */
+		bool Reserve(uint64& Sequence, const bool bWait)
+		{
+			int32 CurrentQueued = Queued.load();
+			for (;;)
+			{
+				if (CurrentQueued >= MaxQueued)
+				{
+					if (!bWait || !Thread)
+					{
+						Dropped++;
+						return false;
+					}
+					WrittenEvent->Wait();
+					CurrentQueued = Queued.load();
+					continue;
+				}
+
+				if (Queued.compare_exchange_weak(CurrentQueued, CurrentQueued + 1))
+				{
+					break;
+				}
+			}
+
+			int32 CurrentPeak = PeakQueued.load();
+			while (CurrentQueued + 1 > CurrentPeak && !PeakQueued.compare_exchange_weak(CurrentPeak, CurrentQueued + 1))
+			{
+			}
+
+			Sequence = NextSequence++;
+			return true;
+		}
+
+		void Submit(const uint64 Sequence, ItemType&& Item)
+		{
+			Incoming.Enqueue(TPair<uint64, TOptional<ItemType>>(Sequence, TOptional<ItemType>(MoveTemp(Item))));
+			WorkEvent->Trigger();
+		}
+
+		/* The reserved item will never be submitted, its slot is released immediately and the following items are not blocked by it */
+		void Cancel(const uint64 Sequence)
+		{
+			Dropped++;
+			Queued--;
+			WrittenEvent->Trigger();
+			Incoming.Enqueue(TPair<uint64, TOptional<ItemType>>(Sequence, TOptional<ItemType>()));
+			WorkEvent->Trigger();
+		}
+
+		/* Reserve and Submit, without waiting */
+		bool Enqueue(ItemType&& Item)
+		{
+			uint64 Sequence = 0;
+			if (!Reserve(Sequence, false))
+			{
+				return false;
+			}
+			Submit(Sequence, MoveTemp(Item));
+			return true;
+		}
+
+		/* Waits for all of the reserved items to be written (or cancelled) */
+		void Flush()
+		{
+			if (!Thread)
+			{
+				return;
+			}
+
+			while (Queued.load() > 0)
+			{
+				WrittenEvent->Wait();
+			}
+		}
+
+		/* Writes the remaining items, then stops the writer thread */
+		void Close()
+		{
+			if (!Thread)
+			{
+				return;
+			}
+
+			Flush();
+			Stop();
+			Thread->WaitForCompletion();
+			delete Thread;
+			Thread = nullptr;
+		}
+
+		/* Items dropped before being reserved (e.g. all of the readbacks in flight) */
+		void AddDropped()
+		{
+			Dropped++;
+		}
+
+		int32 NumQueued() const { return Queued.load(); }
+		int32 GetMaxQueued() const { return MaxQueued; }
+		int32 GetPeakQueued() const { return PeakQueued.load(); }
+		int64 GetNumDropped() const { return Dropped.load(); }
+		int64 GetNumFailed() const { return Failed.load(); }
+		int64 GetNumWritten() const { return Written.load(); }
+		int64 GetWrittenBytes() const { return WrittenBytes.load(); }
+
+		uint32 Run() override
+		{
+			while (!bStopping.load())
+			{
+				WorkEvent->Wait();
+				Drain();
+			}
+
+			// items submitted before Close()
+			Drain();
+
+			return 0;
+		}
+
+		void Stop() override
+		{
+			bStopping = true;
+			WorkEvent->Trigger();
+		}
+
+	protected:
+		void Drain()
+		{
+			TPair<uint64, TOptional<ItemType>> Entry;
+			while (Incoming.Dequeue(Entry))
+			{
+				// in order items skip the reorder map
+				if (Entry.Key != NextWriteSequence)
+				{
+					Pending.Add(Entry.Key, MoveTemp(Entry.Value));
+					continue;
+				}
+
+				Write(Entry.Value);
+
+				while (TOptional<ItemType>* NextItem = Pending.Find(NextWriteSequence))
+				{
+					TOptional<ItemType> Item = MoveTemp(*NextItem);
+					Pending.Remove(NextWriteSequence);
+					Write(Item);
+				}
+			}
+		}
+
+		void Write(TOptional<ItemType>& Item)
+		{
+			NextWriteSequence++;
+
+			// cancelled items already released their slot
+			if (!Item.IsSet())
+			{
+				return;
+			}
+
+			int64 ItemBytes = 0;
+			if (WriteFunction(Item.GetValue(), ItemBytes))
+			{
+				Written++;
+				WrittenBytes += ItemBytes;
+			}
+			else
+			{
+				Failed++;
+			}
+			// release the item memory as soon as possible
+			Item.Reset();
+
+			Queued--;
+			WrittenEvent->Trigger();
+		}
+
+		int32 MaxQueued;
+		FWriteFunction WriteFunction;
+
+		TQueue<TPair<uint64, TOptional<ItemType>>, EQueueMode::Mpsc> Incoming;
+		FEvent* WorkEvent = nullptr;
+		FEvent* WrittenEvent = nullptr;
+		FRunnableThread* Thread = nullptr;
+		std::atomic<bool> bStopping{ false };
+
+		// reserving thread only
+		uint64 NextSequence = 0;
+
+		// writer thread only
+		TMap<uint64, TOptional<ItemType>> Pending;
+		uint64 NextWriteSequence = 0;
+
+		std::atomic<int32> Queued{ 0 };
+		std::atomic<int32> PeakQueued{ 0 };
+		std::atomic<int64> Dropped{ 0 };
+		std::atomic<int64> Failed{ 0 };
+		std::atomic<int64> Written{ 0 };
+		std::atomic<int64> WrittenBytes{ 0 };
+	};
+}
@@ -0,0 +1,53 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CompushadyTypes.h"
+#include "RenderGraphBuilder.h"
+
+class UCompushadyCompute;
+
+/*
+ * Compushady bindings are not known at compile time, so instead of a generated parameter struct
+ * the textures and buffers behind the views are declared through access arrays.
+ */
+BEGIN_SHADER_PARAMETER_STRUCT(FCompushadyRDGComputePassParameters, COMPUSHADY_API)
+	RDG_TEXTURE_ACCESS_ARRAY(TextureAccesses)
+	RDG_BUFFER_ACCESS_ARRAY(BufferAccesses)
+END_SHADER_PARAMETER_STRUCT()
+
+namespace Compushady
+{
+	/*
+	 * C++ API for mixing Compushady pipelines with the engine passes in the same render graph.
+	 * Everything here must be called from the render thread.
+	 */
+	namespace RDG
+	{
+		struct FCompushadyRDGResourceAccess
+		{
+			FTextureRHIRef TextureRHIRef;
+			FBufferRHIRef BufferRHIRef;
+			ERHIAccess Access = ERHIAccess::Unknown;
+		};
+
+		/*
+		 * Textures and buffers (deduplicated) referenced by the ResourceArray views, a resource used by both an SRV and an UAV gets the UAV access.
+		 * Scene textures are rejected unless bSkipSceneTextures is set (the caller is expected to declare the engine textures by itself).
+		 */
+		COMPUSHADY_API bool CollectResourceAccesses(const FCompushadyResourceArray& ResourceArray, TArray<FCompushadyRDGResourceAccess>& Accesses, FString& ErrorMessages, const ERHIAccess SRVAccess = ERHIAccess::SRVCompute, const ERHIAccess UAVAccess = ERHIAccess::UAVCompute, const bool bSkipSceneTextures = false);
+
+		/* Registers the resources as external RDG resources (reusing the already registered ones) and declares their accesses */
+		COMPUSHADY_API FCompushadyRDGComputePassParameters* CreatePassParameters(FRDGBuilder& GraphBuilder, const TArray<FCompushadyRDGResourceAccess>& Accesses);
+
+		COMPUSHADY_API FRDGTextureRef RegisterExternalTexture(FRDGBuilder& GraphBuilder, FRHITexture* Texture);
+		COMPUSHADY_API FRDGBufferRef RegisterExternalBuffer(FRDGBuilder& GraphBuilder, FRHIBuffer* Buffer);
+
+		/*
+		 * Adds a compute dispatch as an RDG compute pass with declared resources, so RDG manages the barriers and can cull it.
+		 * The RHI resources are captured when the pass is added, the UObjects are not referenced anymore after the call.
+		 */
+		COMPUSHADY_API bool AddComputePass(FRDGBuilder& GraphBuilder, UCompushadyCompute* Compute, const FCompushadyResourceArray& ResourceArray, const FIntVector& XYZ, FString& ErrorMessages);
+	}
+}
@@ -10,6 +10,55 @@
 #include "RHICommandList.h"
 #include "CompushadyRasterizer.generated.h"
 
+class FGraphicsPipelineState;
+
+/*
+ * The render target related part of a graphics pipeline state initializer (the shaders and the
+ * rasterizer config are fixed for the whole life of a rasterizer pipeline)
+ */
+struct FCompushadyRasterizerPipelineStateKey
+{
+	FCompushadyRasterizerPipelineStateKey();
+	FCompushadyRasterizerPipelineStateKey(const FGraphicsPipelineStateInitializer& PipelineStateInitializer);
+
+	bool operator==(const FCompushadyRasterizerPipelineStateKey& Other) const;
+
+	friend uint32 GetTypeHash(const FCompushadyRasterizerPipelineStateKey& Key)
+	{
+		return Key.Hash;
+	}
+
+	uint64 RenderTargetFlags[MaxSimultaneousRenderTargets];
+	uint64 DepthStencilTargetFlag;
+	uint32 RenderTargetsEnabled;
+	uint32 DepthStencilAccess;
+	uint16 NumSamples;
+	uint8 RenderTargetFormats[MaxSimultaneousRenderTargets];
+	uint8 DepthStencilTargetFormat;
+	uint8 DepthTargetLoadAction;
+	uint8 DepthTargetStoreAction;
+	uint8 StencilTargetLoadAction;
+	uint8 StencilTargetStoreAction;
+	uint32 Hash;
+};
+
+/*
+ * Render thread owned cache of the pipeline state initializers (with the render targets applied) of a rasterizer.
+ * Pipeline states are always resolved through the engine pipeline state cache, the resolved pointer is reused only
+ * within the same render thread frame (the engine can release unused pipeline states between frames)
+ */
+struct FCompushadyRasterizerPipelineStateCache
+{
+	FGraphicsPipelineState* GetPipelineState(FRHICommandList& RHICmdList, const FGraphicsPipelineStateInitializer& Initializer);
+	void Precache(FRHICommandList& RHICmdList, const FGraphicsPipelineStateInitializer& Initializer);
+	void Reset();
+
+	TMap<FCompushadyRasterizerPipelineStateKey, FGraphicsPipelineStateInitializer> Initializers;
+	FCompushadyRasterizerPipelineStateKey LastKey;
+	FGraphicsPipelineState* LastPipelineState = nullptr;
+	uint64 LastFrameCounter = 0;
+};
+
 /**
  *
  */
@@ -46,6 +95,14 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "VSResourceArray,PSResourceArray,RTVs,RasterizeConfig,OnSignaled"), Category = "Compushady")
 	void DrawIndirect(const FCompushadyResourceArray& VSResourceArray, const FCompushadyResourceArray& PSResourceArray, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, UCompushadyResource* CommandBuffer, const int32 Offset, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled);
 
+	/* Draws all of the items in a single render pass (resources are rebound only when they change between items) */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "DrawItems,RTVs,RasterizeConfig,OnSignaled"), Category = "Compushady")
+	void DrawBatch(const TArray<FCompushadyDrawItem>& DrawItems, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled);
+
+	/* Issues NumDraws indirect draws (with 16 bytes stride) from CommandBuffer in a single render pass */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "VSResourceArray,PSResourceArray,RTVs,RasterizeConfig,OnSignaled"), Category = "Compushady")
+	void DrawIndirectBatch(const FCompushadyResourceArray& VSResourceArray, const FCompushadyResourceArray& PSResourceArray, const TArray<UCompushadyRTV*> RTVs, UCompushadyDSV* DSV, UCompushadyResource* CommandBuffer, const int32 Offset, const int32 NumDraws, const FCompushadyRasterizeConfig& RasterizeConfig, const FCompushadySignaled& OnSignaled);
+
 	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "RTVs,OnSignaled"), Category = "Compushady")
 	void Clear(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV, const FCompushadySignaled& OnSignaled);
 
@@ -55,6 +112,23 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	bool IsRunning() const;
 
+	/* Builds in background the pipeline states for the formats of the specified RTVs and DSV, so the first draw on them will not hitch */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "RTVs"), Category = "Compushady")
+	void PrecachePipelineStates(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV);
+
+	/* Binds the pipeline state matching the current render pass (must be called between BeginRenderPass and EndRenderPass) */
+	void SetGraphicsPipelineState_RenderThread(FRHICommandList& RHICmdList, const uint32 StencilValue);
+
+	int32 GetNumCachedPipelineStates_RenderThread() const
+	{
+		return PipelineStateCache->Initializers.Num();
+	}
+
+	void DrawBatch_RenderThread(FRHICommandListImmediate& RHICmdList, const TArray<FCompushadyDrawItem>& DrawItems, const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const FCompushadyRasterizeConfig& RasterizeConfig);
+
+	/* When false, the pipeline state is looked up in the global engine cache at every draw (mainly for benchmarking) */
+	bool bUsePipelineStateCache = true;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadonly, Category = "Compushady")
 	FCompushadyResourceBindings VSResourceBindings;
 
@@ -70,6 +144,8 @@ public:
 
 	bool bLastSuccess = false;
 	FString LastErrorMessages;
+	/* incremented (on the render thread) whenever a render pass for drawing is started */
+	int32 NumRenderPasses = 0;
 
 	/* end of testing block */
 
@@ -82,6 +158,9 @@ protected:
 	bool SetupRenderTargets(const TArray<UCompushadyRTV*>& RTVs, UCompushadyDSV* DSV, TStaticArray<FRHITexture*, 8>& RenderTargets, int32& RenderTargetsEnabled, FRHITexture*& DepthStencilTexture);
 	void SetupRasterization_RenderThread(FRHICommandListImmediate& RHICmdList, const FCompushadyRasterizeConfig& RasterizeConfig, const int32 Width, const int32 Height);
 
+	void ResetPipelineStateCache();
+
+	static bool GetRenderPassInfo(const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const ERenderTargetActions ColorAction, const EDepthStencilTargetActions DepthStencilAction, FRHIRenderPassInfo& Info, uint32& Width, uint32& Height);
 	static bool BeginRenderPass_RenderThread(const TCHAR* Name, FRHICommandListImmediate& RHICmdList, const TStaticArray<FRHITexture*, 8>& RenderTargets, const int32 RenderTargetsEnabled, FRHITexture* DepthStencilTexture, const ERenderTargetActions ColorAction, const EDepthStencilTargetActions DepthStencilAction, uint32& Width, uint32& Height);
 
 	FVertexShaderRHIRef VertexShaderRef;
@@ -89,5 +168,8 @@ protected:
 	FMeshShaderRHIRef MeshShaderRef;
 	FGraphicsPipelineStateInitializer PipelineStateInitializer;
 
+	/* Render thread only (render commands capture the shared reference, never the rasterizer) */
+	TSharedRef<FCompushadyRasterizerPipelineStateCache, ESPMode::ThreadSafe> PipelineStateCache = MakeShared<FCompushadyRasterizerPipelineStateCache, ESPMode::ThreadSafe>();
+
 	int32 DrawDenominator = 0;
 };
@@ -0,0 +1,208 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "CompushadyOrderedWriter.h"
+#include "CompushadyTypes.h"
+#include "RenderingThread.h"
+#include "CompushadyRawVideoWriter.generated.h"
+
+class IFileHandle;
+
+UENUM(BlueprintType)
+enum class ECompushadyYUVFormat : uint8
+{
+	I420 UMETA(DisplayName = "I420 (Y, U and V planes)"),
+	NV12 UMETA(DisplayName = "NV12 (Y and interleaved UV planes)"),
+};
+
+UENUM(BlueprintType)
+enum class ECompushadyYUVMatrix : uint8
+{
+	BT601 UMETA(DisplayName = "BT.601"),
+	BT709 UMETA(DisplayName = "BT.709"),
+};
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyRawVideoStats
+{
+	GENERATED_BODY()
+
+	// frames waiting for the GPU readback or for the writer thread
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 QueuedFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 PeakQueuedFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 DroppedFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenBytes = 0;
+};
+
+namespace Compushady
+{
+	namespace Video
+	{
+		struct FCompushadyRawVideoCapture;
+
+		/*
+		 * Limited range (16-235 luma, 16-240 chroma) conversion rows for gamma encoded RGB in the 0-1 range.
+		 * xyz are the RGB weights, w is the offset, the result is in the 0-1 range too.
+		 */
+		struct COMPUSHADY_API FCompushadyYUVCoefficients
+		{
+			FVector4f Y;
+			FVector4f U;
+			FVector4f V;
+
+			static FCompushadyYUVCoefficients Get(const ECompushadyYUVMatrix Matrix);
+		};
+
+		/* Plane layout of a converted frame, rows are padded to Pitch bytes (luma) */
+		struct COMPUSHADY_API FCompushadyYUVFrameLayout
+		{
+			int32 Width = 0;
+			int32 Height = 0;
+			int32 Pitch = 0;
+			ECompushadyYUVFormat Format = ECompushadyYUVFormat::I420;
+
+			FCompushadyYUVFrameLayout() = default;
+			FCompushadyYUVFrameLayout(const int32 InWidth, const int32 InHeight, const ECompushadyYUVFormat InFormat, const int32 PitchAlignment = 1);
+
+			/* 4:2:0 subsampling requires even sizes */
+			bool IsValid() const;
+
+			/* Half the luma pitch for I420, the same for the interleaved NV12 plane */
+			int32 GetChromaPitch() const;
+			int64 GetLumaSize() const;
+			/* U for I420, UV for NV12 */
+			int64 GetChromaOffset() const;
+			/* V for I420, INDEX_NONE for NV12 */
+			int64 GetSecondChromaOffset() const;
+			int64 GetFrameSize() const;
+		};
+
+		COMPUSHADY_API void RGBToYUV(const FLinearColor& Color, const ECompushadyYUVMatrix Matrix, uint8& OutY, uint8& OutU, uint8& OutV);
+
+		/* CPU reference of the compute conversion, each chroma sample is the average of a 2x2 block */
+		COMPUSHADY_API bool ConvertRGBToYUV(const FLinearColor* Pixels, const FCompushadyYUVFrameLayout& Layout, const ECompushadyYUVMatrix Matrix, uint8* Output);
+
+		COMPUSHADY_API void WriteY4MHeader(const int32 Width, const int32 Height, const int32 FrameRate, TArray<uint8>& Output);
+
+		/* Appends a FRAME with tightly packed I420 planes (NV12 frames are deinterleaved) */
+		COMPUSHADY_API void WriteY4MFrame(const uint8* Frame, const FCompushadyYUVFrameLayout& Layout, TArray<uint8>& Output);
+
+		/*
+		 * Compute conversion from any texture (UAV, render target) to YUV.
+		 * The packed output is a Buffer<uint> with the FCompushadyYUVFrameLayout planes (Pitch must be a multiple of 8),
+		 * the texture output writes the luma and chroma planes of an NV12 texture through R8/R8G8 views.
+		 */
+		class COMPUSHADY_API FCompushadyYUVConverter
+		{
+		public:
+			/* Game thread, bLinearSource applies the sRGB transfer function before the matrix */
+			bool Initialize(const ECompushadyYUVMatrix InMatrix, const bool bInLinearSource, const bool bToTexture, FString& ErrorMessages);
+
+			void ConvertToBuffer_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, FRHIUnorderedAccessView* Output, const FCompushadyYUVFrameLayout& Layout);
+			void ConvertToTexture_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, FRHIUnorderedAccessView* LumaOutput, FRHIUnorderedAccessView* ChromaOutput, const FIntPoint Size);
+
+			ECompushadyYUVMatrix GetMatrix() const { return Matrix; }
+
+		protected:
+			void Dispatch_RenderThread(FRHICommandList& RHICmdList, FRHITexture* Source, TFunction<FUnorderedAccessViewRHIRef(const int32)> UAVFunction, const FCompushadyYUVFrameLayout& Layout, const FIntPoint NumBlocks);
+
+			FComputeShaderRHIRef ComputeShaderRef;
+			FCompushadyResourceBindings ResourceBindings;
+			FIntVector ThreadGroupSize;
+			FUniformBufferLayoutRHIRef UniformBufferLayoutRef;
+			FUniformBufferRHIRef UniformBufferRef;
+			ECompushadyYUVMatrix Matrix = ECompushadyYUVMatrix::BT709;
+			bool bLinearSource = false;
+		};
+
+		/* Writes I420/NV12 frames (as produced by the compute conversion) to a .y4m file from the ordered writer thread */
+		class COMPUSHADY_API FCompushadyRawVideoFileSink
+		{
+		public:
+			static TSharedPtr<FCompushadyRawVideoFileSink> Create(const FString& Filename, const FCompushadyYUVFrameLayout& Layout, const int32 FrameRate, const int32 MaxQueuedFrames, FString& ErrorMessages);
+
+			~FCompushadyRawVideoFileSink();
+
+			FCompushadyRawVideoFileSink(const FCompushadyRawVideoFileSink&) = delete;
+			FCompushadyRawVideoFileSink& operator=(const FCompushadyRawVideoFileSink&) = delete;
+
+			/* Producer side, returns false if the frame has been dropped */
+			bool Enqueue(TArray<uint8>&& Frame);
+
+			/* Writes the remaining frames, then closes the file */
+			void Close();
+
+			FCompushadyRawVideoStats GetStats() const;
+
+			/* Frames dropped before reaching the sink (e.g. all of the readbacks in flight) */
+			void AddDroppedFrame() { Writer->AddDropped(); }
+
+		protected:
+			FCompushadyRawVideoFileSink() = default;
+
+			bool WriteFrame(const TArray<uint8>& Frame, int64& WrittenBytes);
+
+			FCompushadyYUVFrameLayout Layout;
+			int64 HeaderSize = 0;
+
+			TUniquePtr<IFileHandle> FileHandle;
+			TUniquePtr<TCompushadyOrderedWriter<TArray<uint8>>> Writer;
+
+			// writer thread only
+			TArray<uint8> WriteBuffer;
+		};
+	}
+}
+
+/**
+ * Lossless YUV capture of Compushady textures to .y4m files.
+ * The conversion runs on the GPU, the planes are read back through a ring of readbacks (without stalling the render thread)
+ * and written by a dedicated thread.
+ */
+UCLASS(BlueprintType)
+class COMPUSHADY_API UCompushadyRawVideoWriter : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	void BeginDestroy() override;
+	bool IsReadyForFinishDestroy() override;
+
+	/* bLinearSource must be set for linear (float) textures, NumReadbacks is the number of frames the GPU can be ahead of the writer */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool Open(const FString& Filename, const int32 Width, const int32 Height, FString& ErrorMessages, const int32 FrameRate = 60, const ECompushadyYUVMatrix Matrix = ECompushadyYUVMatrix::BT709, const bool bLinearSource = false, const int32 NumReadbacks = 3, const int32 MaxQueuedFrames = 16);
+
+	/* Frames are dropped (and counted in the stats) instead of stalling when the readbacks or the writer thread fall behind */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool WriteFrame(UCompushadyResource* FrameResource, FString& ErrorMessages);
+
+	/* Waits for the frames in flight, then closes the file */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void Close();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsOpen() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FCompushadyRawVideoStats GetStats() const;
+
+protected:
+	TSharedPtr<Compushady::Video::FCompushadyRawVideoCapture, ESPMode::ThreadSafe> Capture;
+
+	/* Frames still in the readbacks when the writer is destroyed */
+	FRenderCommandFence DestroyFence;
+};
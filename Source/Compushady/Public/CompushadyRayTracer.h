@@ -8,6 +8,70 @@
 #include "RHICommandList.h"
 #include "CompushadyRayTracer.generated.h"
 
+namespace Compushady
+{
+	struct FCompushadyRayTracerPipelineKey
+	{
+		FSHAHash RayGenHash;
+		FSHAHash RayMissHash;
+		FSHAHash RayHitGroupHash;
+
+		bool operator==(const FCompushadyRayTracerPipelineKey& Other) const
+		{
+			return RayGenHash == Other.RayGenHash && RayMissHash == Other.RayMissHash && RayHitGroupHash == Other.RayHitGroupHash;
+		}
+
+		friend uint32 GetTypeHash(const FCompushadyRayTracerPipelineKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.RayGenHash), GetTypeHash(Key.RayMissHash)), GetTypeHash(Key.RayHitGroupHash));
+		}
+	};
+
+	/*
+	 * Process-wide cache of ray tracing pipelines keyed by the hashes of their shaders.
+	 * Pipelines are created on the render thread without flushing the game thread.
+	 */
+	namespace RayTracerPipelineCache
+	{
+		/*
+		 * OnReady is always called on the game thread (with nullptr on failure), immediately if the pipeline is already available.
+		 * Concurrent requests for the same key wait for the same creation.
+		 */
+		COMPUSHADY_API void GetOrCreate(const FCompushadyRayTracerPipelineKey& Key, TFunction<FRayTracingPipelineState* (FRHICommandListImmediate&)> CreateFunction, TFunction<void(FRayTracingPipelineState*)> OnReady);
+
+		/* Number of pipelines currently held by the cache */
+		COMPUSHADY_API int32 GetNumPipelines();
+		/* Total number of pipeline creations started since startup */
+		COMPUSHADY_API int64 GetNumCreatedPipelines();
+
+		/* Forgets all of the pipelines (called on module shutdown) */
+		COMPUSHADY_API void Flush();
+	}
+}
+
+enum class ECompushadyRayTracerPipelineStatus : uint8
+{
+	None,
+	Pending,
+	Ready,
+	Failed
+};
+
+USTRUCT()
+struct FCompushadyRayTracerQueuedDispatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FCompushadyResourceArray ResourceArray;
+
+	UPROPERTY()
+	FIntVector XYZ = FIntVector::ZeroValue;
+
+	UPROPERTY()
+	FCompushadySignaled OnSignaled;
+};
+
 /**
  *
  */
@@ -25,6 +89,20 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	bool IsRunning() const;
 
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsPipelineReady() const;
+
+	/* OnSignaled is triggered as soon as the pipeline creation is completed (or immediately if it is already completed) */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void WaitForPipeline(const FCompushadySignaled& OnSignaled);
+
+	/* Starts the asynchronous creation of the pipeline, dispatches issued before it is ready are queued */
+	void RequestPipelineState(const Compushady::FCompushadyRayTracerPipelineKey& Key, TFunction<FRayTracingPipelineState* (FRHICommandListImmediate&)> CreateFunction);
+
+	int32 GetNumQueuedDispatches() const;
+
+	void OnSignalReceived() override;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadonly, Category = "Compushady")
 	FCompushadyResourceBindings RayGenResourceBindings;
 
@@ -40,6 +118,8 @@ public:
 
 	bool bLastSuccess = false;
 	FString LastErrorMessages;
+	int32 NumStoredSignals = 0;
+	int32 NumBindingsUpdates = 0;
 
 	/* end of testing block */
 
@@ -50,6 +130,22 @@ protected:
 	FRayTracingShaderRHIRef RayGenShaderRef;
 	FRayTracingShaderRHIRef RayMissShaderRef;
 	FRayTracingShaderRHIRef RayHitGroupShaderRef;
-	FRayTracingPipelineStateInitializer PipelineStateInitializer;
 	FRayTracingPipelineState* PipelineState = nullptr;
+
+	ECompushadyRayTracerPipelineStatus PipelineStatus = ECompushadyRayTracerPipelineStatus::None;
+	TArray<FCompushadySignaled> PipelineWaiters;
+
+	UPROPERTY()
+	TArray<FCompushadyRayTracerQueuedDispatch> QueuedDispatches;
+
+	void OnPipelineStateReady(FRayTracingPipelineState* InPipelineState);
+	void DispatchNextQueued();
+	void DispatchRays_Internal(const FCompushadyResourceArray& ResourceArray, const FIntVector XYZ, const FCompushadySignaled& OnSignaled);
+
+#if COMPUSHADY_UE_VERSION >= 53 && RHI_RAYTRACING
+	// bindings are rebuilt only when the resources change between dispatches
+	FRayTracingShaderBindings CachedBindings_RenderThread;
+	TArray<TRefCountPtr<FRHIResource>> CachedBindingsResources_RenderThread;
+	bool bCachedBindingsValid_RenderThread = false;
+#endif
 };
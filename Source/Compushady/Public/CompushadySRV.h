@@ -22,15 +22,20 @@ public:
 	bool InitializeFromStructuredBuffer(FBufferRHIRef InBufferRHIRef);
 	bool InitializeFromSceneTexture(const ECompushadySceneTexture InSceneTexture);
 	bool InitializeFromWorldSceneAccelerationStructure(UWorld* World);
+	bool InitializeFromAccelerationStructure(FShaderResourceViewRHIRef InSRVRHIRef, const FRHITransitionInfo& InRHITransitionInfo);
 	
 	FShaderResourceViewRHIRef GetRHI() const;
 	TPair<FShaderResourceViewRHIRef, FTextureRHIRef> GetRHI(const FCompushadySceneTextures& SceneTextures) const;
 
 	bool IsSceneTexture() const;
+	ECompushadySceneTexture GetSceneTexture() const;
+	bool IsAccelerationStructure() const;
 
 protected:
 	FShaderResourceViewRHIRef SRVRHIRef;
 
 	ECompushadySceneTexture SceneTexture = ECompushadySceneTexture::None;
+
+	bool bIsAccelerationStructure = false;
 	
 };
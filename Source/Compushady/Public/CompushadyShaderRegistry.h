@@ -0,0 +1,36 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+namespace Compushady
+{
+	/*
+	 * Process-wide registry of RHI shaders keyed by the hash of their final (Unreal-wrapped) bytecode.
+	 * Identical shaders (even from different Compushady objects) share the same RHI object, and as the
+	 * engine's PipelineStateCache is keyed by the RHI shaders, the pipeline states are shared too.
+	 */
+	namespace ShaderRegistry
+	{
+		COMPUSHADY_API FVertexShaderRHIRef GetOrCreateVertexShader(const TArray<uint8>& Blob, const FSHAHash& Hash);
+		COMPUSHADY_API FPixelShaderRHIRef GetOrCreatePixelShader(const TArray<uint8>& Blob, const FSHAHash& Hash);
+		COMPUSHADY_API FComputeShaderRHIRef GetOrCreateComputeShader(const TArray<uint8>& Blob, const FSHAHash& Hash);
+		COMPUSHADY_API FMeshShaderRHIRef GetOrCreateMeshShader(const TArray<uint8>& Blob, const FSHAHash& Hash);
+#if RHI_RAYTRACING
+		COMPUSHADY_API FRayTracingShaderRHIRef GetOrCreateRayTracingShader(const TArray<uint8>& Blob, const FSHAHash& Hash, const EShaderFrequency Frequency);
+#endif
+
+		/* Number of shaders currently held by the registry */
+		COMPUSHADY_API int32 GetNumShaders();
+		/* Total number of RHI shaders created by the registry since startup */
+		COMPUSHADY_API int64 GetNumCreatedShaders();
+		COMPUSHADY_API bool Contains(const EShaderFrequency Frequency, const FSHAHash& Hash);
+
+		/* Releases the shaders not referenced anymore outside of the registry, returns the number of released shaders */
+		COMPUSHADY_API int32 Purge();
+		/* Releases all of the shaders (called on module shutdown) */
+		COMPUSHADY_API void Flush();
+	}
+}
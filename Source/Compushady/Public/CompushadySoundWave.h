@@ -7,6 +7,64 @@
 #include "CompushadyUAV.h"
 #include "CompushadySoundWave.generated.h"
 
+namespace Compushady
+{
+	namespace Audio
+	{
+		/*
+		 * Ring of audio chunks moving from the game thread (submit) to the render thread (complete, once the readback is ready)
+		 * and finally to the audio thread (pop). Playback starts only when LatencyChunks are completed and goes back to buffering after an underrun.
+		 */
+		class COMPUSHADY_API FCompushadyAudioStreamRing
+		{
+		public:
+			FCompushadyAudioStreamRing(const int32 InNumChunks, const int32 InChunkSamples, const int32 InLatencyChunks);
+
+			/* Game thread, returns INDEX_NONE (and counts a dropped chunk) when all of the chunks are in use */
+			int32 Submit();
+
+			/* Render thread, the oldest submitted chunk still waiting for its data */
+			int32 GetNextPendingChunk() const;
+			float* GetChunkData(const int32 ChunkIndex);
+			void Complete();
+
+			/* Audio thread, always fills NumSamples (with silence for the missing ones) and returns the number of streamed samples */
+			int32 Pop(float* OutSamples, const int32 NumSamples);
+
+			int32 NumPending() const;
+			int32 NumCompleted() const;
+			bool IsBuffering() const { return bBuffering.load(); }
+
+			int32 GetNumChunks() const { return NumChunks; }
+			int32 GetChunkSamples() const { return ChunkSamples; }
+			int32 GetLatencyChunks() const { return LatencyChunks; }
+
+			int64 GetNumUnderruns() const { return NumUnderruns.load(); }
+			int64 GetNumUnderrunSamples() const { return NumUnderrunSamples.load(); }
+			int64 GetNumDroppedChunks() const { return NumDroppedChunks.load(); }
+
+		protected:
+			TArray<float> Samples;
+			int32 NumChunks;
+			int32 ChunkSamples;
+			int32 LatencyChunks;
+
+			std::atomic<uint32> SubmitIndex{ 0 };
+			std::atomic<uint32> CompleteIndex{ 0 };
+			std::atomic<uint32> ReadIndex{ 0 };
+			// only accessed by the audio thread
+			int32 ReadOffset = 0;
+			std::atomic<bool> bBuffering{ true };
+
+			std::atomic<int64> NumUnderruns{ 0 };
+			std::atomic<int64> NumUnderrunSamples{ 0 };
+			std::atomic<int64> NumDroppedChunks{ 0 };
+		};
+
+		struct FCompushadyAudioStream;
+	}
+}
+
 /**
  *
  */
@@ -17,6 +75,7 @@ class COMPUSHADY_API UCompushadySoundWave : public USoundWaveProcedural
 
 public:
 	Audio::EAudioMixerStreamDataFormat::Type GetGeneratedPCMDataFormat() const override { return Audio::EAudioMixerStreamDataFormat::Float; }
+	int32 OnGeneratePCMAudio(TArray<uint8>& OutAudio, int32 NumSamples) override;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadonly, Category = "Compushady")
 	UCompushadyUAV* UAV;
@@ -45,6 +104,32 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	bool IsPlaying();
+
+	/*
+	 * In streaming mode UpdateSamples does not wait for the GPU: the UAV is copied into one of NumChunks readback buffers
+	 * and the completed chunks are consumed directly by the audio callback after LatencyTarget seconds of audio have been buffered.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool StartStreaming(const int32 NumChunks, const float LatencyTarget, FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void StopStreaming();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsStreaming() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int64 GetStreamingUnderruns() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int64 GetStreamingDroppedChunks() const;
+
 protected:
 	TArray<uint8> TempData;
+
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> GetStream() const;
+
+	// the audio thread grabs its own reference under the lock
+	mutable FCriticalSection StreamLock;
+	TSharedPtr<Compushady::Audio::FCompushadyAudioStream, ESPMode::ThreadSafe> Stream;
 };
@@ -0,0 +1,66 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CompushadyTypes.h"
+
+namespace Compushady
+{
+	namespace TIFF
+	{
+		COMPUSHADY_API bool GetSampleLayout(const EPixelFormat PixelFormat, uint16& NumComponents, uint16& BitsPerComponent, uint16& SampleFormat);
+
+		/* TIFF flavour of LZW (MSB first codes, early change) */
+		COMPUSHADY_API void LZWCompress(const uint8* Data, const int64 Size, TArray<uint8>& Output);
+
+		/* Applies (in place) the horizontal predictor (2) to integer rows or the floating point predictor (3) to float rows */
+		COMPUSHADY_API void ApplyPredictor(uint8* Row, TArray<uint8>& Scratch, const uint32 Width, const uint16 NumComponents, const uint16 BitsPerComponent, const uint16 SampleFormat);
+
+		struct FCompushadyTIFFEntry
+		{
+			uint16 Tag;
+			uint16 Type;
+			uint64 Count;
+			TArray<uint8> Value;
+		};
+
+		/*
+		 * Streaming TIFF/BigTIFF writer.
+		 * Every AddPage() appends a page: strips/tiles are encoded in parallel batches and written as soon as a batch is ready,
+		 * so only a few chunks (and never the whole file) live in memory.
+		 */
+		class COMPUSHADY_API FCompushadyTIFFWriter
+		{
+		public:
+			static TSharedPtr<FCompushadyTIFFWriter> Create(const FString& Filename, const FCompushadyTIFFConfig& Config, FString& ErrorMessages);
+
+			/* InArchive must be seekable and positioned at its beginning */
+			FCompushadyTIFFWriter(FArchive& InArchive, const FCompushadyTIFFConfig& InConfig);
+			~FCompushadyTIFFWriter();
+
+			FCompushadyTIFFWriter(const FCompushadyTIFFWriter&) = delete;
+			FCompushadyTIFFWriter& operator=(const FCompushadyTIFFWriter&) = delete;
+
+			bool AddPage(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString& ImageDescription, FString& ErrorMessages);
+			bool Close(FString& ErrorMessages);
+
+			int32 GetNumPages() const { return NumPages; }
+			int64 GetWrittenBytes() const { return WrittenBytes; }
+
+		protected:
+			bool CheckOffset(const uint64 Value, FString& ErrorMessages) const;
+			void WritePadding();
+			bool WriteIFD(TArray<FCompushadyTIFFEntry>& Entries, FString& ErrorMessages);
+
+			FArchive* Archive = nullptr;
+			TUniquePtr<FArchive> OwnedArchive;
+			FCompushadyTIFFConfig Config;
+
+			int64 NextIFDPointerPosition = 0;
+			int64 WrittenBytes = 0;
+			int32 NumPages = 0;
+			bool bClosed = false;
+		};
+	}
+}
@@ -114,6 +114,10 @@ struct FCompushadyResourceBinding
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadonly, Category = "Compushady")
 	FString Name;
+
+	/* the slot expects a ray tracing acceleration structure (RaytracingAccelerationStructure) */
+	UPROPERTY(VisibleAnywhere, BlueprintReadonly, Category = "Compushady")
+	bool bIsAccelerationStructure = false;
 };
 
 USTRUCT(BlueprintType)
@@ -213,6 +217,10 @@ enum class ECompushadySceneTexture : uint8
 	CustomDepth,
 	CustomStencil,
 	Velocity,
+	History0,
+	History1,
+	History2,
+	History3,
 	Max
 };
 
@@ -232,9 +240,73 @@ enum class ECompushadyWAVFormat : uint8
 	PCM16,
 	PCM32,
 	PCM8,
+	Float,
+	PCM24
+};
+
+UENUM(BlueprintType)
+enum class ECompushadyTIFFCompression : uint8
+{
+	None,
+	LZW,
+	Deflate
+};
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyTIFFConfig
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	ECompushadyTIFFCompression Compression = ECompushadyTIFFCompression::None;
+
+	// horizontal differencing (floating point predictor for float formats), ignored without compression
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bPredictor = false;
+
+	// 0 for strips, otherwise the size of the square tiles (multiple of 16)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 TileSize = 0;
+
+	// 0 for about 1MB per strip
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 RowsPerStrip = 0;
+
+	// 64 bit offsets, required for files bigger than 4GB
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	bool bBigTIFF = false;
+};
+
+UENUM(BlueprintType)
+enum class ECompushadyEXRPixelType : uint8
+{
+	Half,
 	Float
 };
 
+UENUM(BlueprintType)
+enum class ECompushadyEXRCompression : uint8
+{
+	None,
+	// zlib, one scanline per block
+	ZIPS,
+	// zlib, 16 scanlines per block
+	ZIP,
+	// wavelet + huffman, 32 scanlines per block, better ratios on noisy (rendered) float data
+	PIZ
+};
+
+UENUM(BlueprintType)
+enum class ECompushadyMipFilter : uint8
+{
+	Box,
+	// 4 taps Kaiser windowed sinc, sharper than Box
+	Kaiser,
+	// conservative pyramids (like hi-z depth buffers)
+	Min,
+	Max
+};
+
 struct FCompushadySceneTextures
 {
 	TStaticArray<TPair<FShaderResourceViewRHIRef, FTextureRHIRef>, (uint32)ECompushadySceneTexture::Max> Textures;
@@ -346,6 +418,27 @@ struct COMPUSHADY_API FCompushadyRasterizeConfig
 
 };
 
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyDrawItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	FCompushadyResourceArray VSResourceArray;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	FCompushadyResourceArray PSResourceArray;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 NumVertices = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 NumInstances = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Compushady")
+	int32 FirstVertex = 0;
+};
+
 UENUM()
 enum ECompushadySamplerAddressMode : uint8
 {
@@ -505,6 +598,11 @@ protected:
 	TArray<TStrongObjectPtr<UObject>> CurrentTrackedResources;
 };
 
+namespace Compushady
+{
+	struct FCompushadyResourceVersion;
+}
+
 UCLASS(Abstract, BlueprintType)
 class COMPUSHADY_API UCompushadyResource : public UObject, public ICompushadyBindable, public ICompushadySignalable
 {
@@ -544,11 +642,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	bool ReadbackTextureToPNGFileSync(const FString& Filename, FString& ErrorMessages);
 
+	/* 3D textures and texture arrays are written as a multi-page TIFF (one page per slice) */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "Config"), Category = "Compushady")
+	bool ReadbackTextureToTIFFFileSync(const FString& Filename, const FString& ImageDescription, FString& ErrorMessages, const FCompushadyTIFFConfig& Config = FCompushadyTIFFConfig());
+
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void ReadbackTextureToEXRFile(const FString& Filename, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, const FCompushadySignaled& OnSignaled);
+
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	bool ReadbackTextureToTIFFFileSync(const FString& Filename, const FString& ImageDescription, FString& ErrorMessages);
+	bool ReadbackTextureToEXRFileSync(const FString& Filename, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, FString& ErrorMessages);
 
+	/* The buffer is interpreted as Width x Height pixels of a float PixelFormat starting at Offset */
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
-	bool ReadbackBufferToWAVFileSync(const FString& Filename, const int64 Offset, const int64 Size, const int32 SampleRate, const int32 NumChannels, const EPixelFormat PixelFormat, const ECompushadyWAVFormat WAVFormat, FString& ErrorMessages);
+	bool ReadbackBufferToEXRFileSync(const FString& Filename, const int64 Offset, const int32 Width, const int32 Height, const EPixelFormat PixelFormat, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, FString& ErrorMessages);
+
+	/* The buffer contains float samples, interleaved or (bPlanar) one plane per channel */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool ReadbackBufferToWAVFileSync(const FString& Filename, const int64 Offset, const int64 Size, const int32 SampleRate, const int32 NumChannels, const EPixelFormat PixelFormat, const ECompushadyWAVFormat WAVFormat, FString& ErrorMessages, const bool bPlanar = false, const bool bDither = true);
 
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "CopyInfo", AutoCreateRefTerm = "OnSignaled,CopyInfo"), Category = "Compushady")
 	void CopyToRenderTarget2D(UTextureRenderTarget2D* RenderTarget, const FCompushadySignaled& OnSignaled, const FCompushadyTextureCopyInfo& CopyInfo);
@@ -565,6 +675,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	bool CopyToBufferSync(UCompushadyResource* DestinationBuffer, const int64 Size, const int64 DestinationOffset, const int64 SourceOffset, FString& ErrorMessages);
 
+	/* Fills all of the mips of a 2D or 3D texture (created with the UAV flag) from the first one */
+	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "OnSignaled"), Category = "Compushady")
+	void GenerateMips(const ECompushadyMipFilter Filter, const FCompushadySignaled& OnSignaled);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool GenerateMipsSync(const ECompushadyMipFilter Filter, FString& ErrorMessages);
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	FIntVector GetTextureThreadGroupSize(const FIntVector XYZ, const bool bUseNumSlicesForZ) const;
 
@@ -583,17 +700,20 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	int32 GetTextureNumSlices() const;
 
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int32 GetTextureNumMips() const;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
 	EPixelFormat GetTexturePixelFormat() const;
 
 	UFUNCTION(BlueprintCallable, meta = (WorldContext = "WorldContextObject"), Category = "Compushady")
-	FGuid Draw(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid Draw(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	UFUNCTION(BlueprintCallable, meta = (WorldContext = "WorldContextObject"), Category = "Compushady")
-	FGuid DrawBeforePostProcessing(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid DrawBeforePostProcessing(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	UFUNCTION(BlueprintCallable, meta = (WorldContext = "WorldContextObject"), Category = "Compushady")
-	FGuid DrawAfterMotionBlur(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio);
+	FGuid DrawAfterMotionBlur(UObject* WorldContextObject, const FVector4 Quad, const ECompushadyKeepAspectRatio KeepAspectRatio, const int32 Priority = 0);
 
 	FTextureRHIRef GetTextureRHI() const;
 	FBufferRHIRef GetBufferRHI() const;
@@ -633,8 +753,25 @@ public:
 	bool UpdateTextureSliceSyncWithFunction(const uint8* Ptr, const int64 Size, const int32 Slice, TFunction<void(FRHICommandListImmediate& RHICmdList, void* Data, const uint32 SourcePitch, const uint32 DestPitch)> InFunction);
 
 	bool MapTextureSliceAndExecuteSync(TFunction<void(const void*, const int32)> InFunction, const int32 Slice);
+	bool MapTextureSliceAndExecute_RenderThread(FRHICommandListImmediate& RHICmdList, TFunction<void(const void*, const int32)> InFunction, const int32 Slice);
+
+	/*
+	 * Incremented on every write (dispatches, draws, copies, uploads and clears), owned by the resource and shared with the views created from it
+	 * (CreateCompushadySRVFromResource/CreateCompushadyUAVFromResource).
+	 * The increment happens on the render thread when the write is submitted, so it is visible to the game thread only after a sync call.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	int64 GetVersion() const;
+
+	void IncrementVersion();
+
+	/* Uses the version counter of Resource (only if both are on the same texture or buffer) */
+	void ShareVersionCounter(const UCompushadyResource* Resource);
 
 protected:
+	TSharedPtr<Compushady::FCompushadyResourceVersion, ESPMode::ThreadSafe> GetVersionCounter() const;
+	FRHIResource* GetVersionedRHIResource() const;
+
 	FTextureRHIRef TextureRHIRef;
 	FBufferRHIRef BufferRHIRef;
 	FStagingBufferRHIRef StagingBufferRHIRef;
@@ -643,6 +780,8 @@ protected:
 	FTextureRHIRef ReadbackTextureRHIRef;
 	TArray<uint8> ReadbackCacheBytes;
 	TArray<float> ReadbackCacheFloats;
+	mutable TSharedPtr<Compushady::FCompushadyResourceVersion, ESPMode::ThreadSafe> VersionCounter;
+	mutable FRHIResource* VersionCounterRHIResource = nullptr;
 };
 
 namespace Compushady
@@ -694,6 +833,9 @@ namespace Compushady
 		COMPUSHADY_API void FillRasterizerPipelineStateInitializer(const FCompushadyRasterizerConfig& RasterizerConfig, FGraphicsPipelineStateInitializer& PipelineStateInitializer);
 
 		COMPUSHADY_API bool GenerateTIFF(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString ImageDescription, TArray<uint8>& IFD);
+		COMPUSHADY_API bool GenerateTIFF(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const FString ImageDescription, const FCompushadyTIFFConfig& Config, TArray<uint8>& IFD);
+		COMPUSHADY_API bool IsEXRPixelFormat(const EPixelFormat PixelFormat);
+		COMPUSHADY_API bool GenerateEXR(const void* Data, const int32 Stride, const uint32 Width, const uint32 Height, const EPixelFormat PixelFormat, const ECompushadyEXRPixelType PixelType, const ECompushadyEXRCompression Compression, TArray64<uint8>& EXR, FString& ErrorMessages);
 		COMPUSHADY_API bool LoadNRRD(const FString& Filename, TArray64<uint8>& SlicesData, int64& Offset, uint32& Width, uint32& Height, uint32& Depth, EPixelFormat& PixelFormat);
 		COMPUSHADY_API bool GZIPDecompress(const TArray<uint8>& Data, TArray<uint8>& UncompressedData);
 
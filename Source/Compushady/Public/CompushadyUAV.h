@@ -17,6 +17,7 @@ class COMPUSHADY_API UCompushadyUAV : public UCompushadyResource
 
 public:
 	bool InitializeFromTexture(FTextureRHIRef InTextureRHIRef);
+	bool InitializeFromTextureMip(FTextureRHIRef InTextureRHIRef, const int32 MipLevel);
 	bool InitializeFromBuffer(FBufferRHIRef InBufferRHIRef, const EPixelFormat PixelFormat);
 	bool InitializeFromStructuredBuffer(FBufferRHIRef InBufferRHIRef);
 
@@ -5,9 +5,12 @@
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "CompushadyTypes.h"
+#include "CompushadyOrderedWriter.h"
+#include "CompushadyRawVideoWriter.h"
 #include "CompushadyVideoEncoder.generated.h"
 
 struct FCompushadyVideoEncoder;
+class IFileHandle;
 
 UENUM(BlueprintType)
 enum class ECompushadyVideoEncoderCodec : uint8
@@ -36,6 +39,291 @@ enum class ECompushadyVideoEncoderLatency : uint8
 	UltraLow
 };
 
+UENUM(BlueprintType)
+enum class ECompushadyVideoContainer : uint8
+{
+	AnnexB UMETA(DisplayName = "Annex-B Elementary Stream"),
+	FragmentedMP4 UMETA(DisplayName = "Fragmented MP4"),
+};
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyVideoRecordingStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 QueuedPackets = 0;
+
+	// highest number of packets waiting for the writer thread
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 PeakQueuedPackets = 0;
+
+	// packets dropped because the queue was full (or because they depended on a dropped packet)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 DroppedPackets = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenPackets = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenBytes = 0;
+};
+
+namespace Compushady
+{
+	namespace Video
+	{
+		/* Splits an Annex-B byte stream on its start codes, the views point into Data */
+		COMPUSHADY_API void ParseAnnexB(const uint8* Data, const int64 Size, TArray<TArrayView<const uint8>>& NALUnits);
+
+		COMPUSHADY_API uint8 GetNALUnitType(const TArrayView<const uint8> NALUnit, const bool bH265);
+
+		/* IDR for H.264, IRAP for H.265 */
+		COMPUSHADY_API bool IsKeyFrameNALUnit(const TArrayView<const uint8> NALUnit, const bool bH265);
+
+		/* Removes the emulation prevention bytes */
+		COMPUSHADY_API void NALUnitToRBSP(const TArrayView<const uint8> NALUnit, TArray<uint8>& RBSP);
+
+		struct COMPUSHADY_API FCompushadyVideoParameterSets
+		{
+			TArray<uint8> VPS;
+			TArray<uint8> SPS;
+			TArray<uint8> PPS;
+
+			/* Updates the parameter sets found in the NAL units, returns true if any of them was found */
+			bool Extract(const TArray<TArrayView<const uint8>>& NALUnits, const bool bH265);
+
+			bool IsValid(const bool bH265) const;
+		};
+
+		struct COMPUSHADY_API FCompushadyVideoPacket
+		{
+			// Annex-B data as returned by the encoder
+			TSharedPtr<uint8> Data;
+			int64 Size = 0;
+			uint64 Timestamp = 0;
+			FIntPoint FrameSize = FIntPoint::ZeroValue;
+			bool bKeyFrame = false;
+		};
+
+		struct COMPUSHADY_API FCompushadyVideoEncoderSettings
+		{
+			ECompushadyVideoEncoderCodec Codec = ECompushadyVideoEncoderCodec::H264Main;
+			ECompushadyVideoEncoderQuality Quality = ECompushadyVideoEncoderQuality::Default;
+			ECompushadyVideoEncoderLatency Latency = ECompushadyVideoEncoderLatency::Default;
+			int32 Width = 0;
+			int32 Height = 0;
+			// 0 keeps the encoder defaults
+			int32 TargetBitrate = 0;
+			int32 MaxBitrate = 0;
+
+			bool operator==(const FCompushadyVideoEncoderSettings& Other) const;
+			bool operator!=(const FCompushadyVideoEncoderSettings& Other) const { return !(*this == Other); }
+		};
+
+		/* Whatever applies the settings to the actual encoder (the hardware one or a stand-in for tests) */
+		class COMPUSHADY_API ICompushadyVideoEncoderBackend
+		{
+		public:
+			virtual ~ICompushadyVideoEncoderBackend() = default;
+			virtual bool ApplySettings(const FCompushadyVideoEncoderSettings& Settings) = 0;
+		};
+
+		/*
+		 * Tracks the requested encoder settings and pushes them to the backend only when they change.
+		 * Resolution changes also force a keyframe, as the parameter sets change with them.
+		 */
+		class COMPUSHADY_API FCompushadyVideoEncoderConfig
+		{
+		public:
+			void Initialize(const FCompushadyVideoEncoderSettings& InSettings);
+
+			void SetResolution(const int32 Width, const int32 Height);
+			void SetBitrate(const int32 TargetBitrate, const int32 MaxBitrate);
+			void RequestKeyFrame();
+
+			/* To be called before every frame, applies the pending changes and consumes the keyframe request */
+			bool Update(ICompushadyVideoEncoderBackend& Backend, bool& bOutForceKeyFrame);
+
+			bool IsDirty() const;
+			const FCompushadyVideoEncoderSettings& GetSettings() const { return Settings; }
+			int32 GetNumApplies() const { return NumApplies; }
+
+		protected:
+			FCompushadyVideoEncoderSettings Settings;
+			FCompushadyVideoEncoderSettings AppliedSettings;
+			bool bApplied = false;
+			bool bKeyFrameRequested = false;
+			int32 NumApplies = 0;
+		};
+
+		/*
+		 * Ring of encoder input frames, a frame is reused as soon as the encoder returned the packet of its timestamp.
+		 * Frames still in flight are never handed out, Acquire fails until a packet releases them.
+		 */
+		template<typename ResourceType>
+		class TCompushadyVideoFramePool
+		{
+		public:
+			void Reset(const int32 NumFrames)
+			{
+				Frames.Empty(NumFrames);
+				Frames.AddDefaulted(NumFrames);
+				NextFrame = 0;
+			}
+
+			/* Returns INDEX_NONE when the encoder is still reading all of the frames */
+			int32 Acquire(const uint64 Timestamp)
+			{
+				for (int32 Index = 0; Index < Frames.Num(); Index++)
+				{
+					const int32 FrameIndex = (NextFrame + Index) % Frames.Num();
+					if (!Frames[FrameIndex].bInFlight)
+					{
+						return Use(FrameIndex, Timestamp);
+					}
+				}
+
+				return INDEX_NONE;
+			}
+
+			/* Packets are returned in order, so every frame up to Timestamp can be reused */
+			void Release(const uint64 Timestamp)
+			{
+				for (FFrame& Frame : Frames)
+				{
+					if (Frame.bInFlight && Frame.Timestamp <= Timestamp)
+					{
+						Frame.bInFlight = false;
+					}
+				}
+			}
+
+			/* The frame has not been sent to the encoder */
+			void Cancel(const int32 FrameIndex)
+			{
+				Frames[FrameIndex].bInFlight = false;
+			}
+
+			void ReleaseAll()
+			{
+				for (FFrame& Frame : Frames)
+				{
+					Frame.bInFlight = false;
+				}
+			}
+
+			TSharedPtr<ResourceType>& GetResource(const int32 FrameIndex)
+			{
+				return Frames[FrameIndex].Resource;
+			}
+
+			int32 Num() const
+			{
+				return Frames.Num();
+			}
+
+			int32 NumInFlight() const
+			{
+				int32 InFlight = 0;
+				for (const FFrame& Frame : Frames)
+				{
+					InFlight += Frame.bInFlight ? 1 : 0;
+				}
+				return InFlight;
+			}
+
+		protected:
+			struct FFrame
+			{
+				TSharedPtr<ResourceType> Resource;
+				uint64 Timestamp = 0;
+				bool bInFlight = false;
+			};
+
+			int32 Use(const int32 FrameIndex, const uint64 Timestamp)
+			{
+				Frames[FrameIndex].bInFlight = true;
+				Frames[FrameIndex].Timestamp = Timestamp;
+				NextFrame = (FrameIndex + 1) % Frames.Num();
+				return FrameIndex;
+			}
+
+			TArray<FFrame> Frames;
+			int32 NextFrame = 0;
+		};
+
+		/* Fragmented MP4 (ISO BMFF) writer, every packet becomes a moof/mdat fragment */
+		class COMPUSHADY_API FCompushadyFMP4Muxer
+		{
+		public:
+			FCompushadyFMP4Muxer(const bool bInH265, const int32 InWidth, const int32 InHeight, const uint32 InTimescale, const uint32 InFrameDuration);
+
+			/* ftyp and moov (with the avcC/hvcC built from the parameter sets) */
+			bool WriteInitSegment(const FCompushadyVideoParameterSets& ParameterSets, TArray<uint8>& Output, FString& ErrorMessages);
+
+			/* The NAL units are stored length prefixed, parameter sets and access unit delimiters are skipped */
+			void WriteFragment(const TArray<TArrayView<const uint8>>& NALUnits, const uint64 DecodeTime, const bool bKeyFrame, TArray<uint8>& Output);
+
+			uint32 GetTimescale() const { return Timescale; }
+			uint32 GetFrameDuration() const { return FrameDuration; }
+
+		protected:
+			bool bH265;
+			int32 Width;
+			int32 Height;
+			uint32 Timescale;
+			uint32 FrameDuration;
+			uint32 SequenceNumber = 0;
+		};
+
+		/*
+		 * Writes the encoded packets to a file from the ordered writer thread.
+		 * Packets are moved (not copied) to the bounded writer queue,
+		 * when the queue is full the packet is dropped, and so are the following ones until the next keyframe.
+		 */
+		class COMPUSHADY_API FCompushadyVideoFileSink
+		{
+		public:
+			static TSharedPtr<FCompushadyVideoFileSink> Create(const FString& Filename, const ECompushadyVideoContainer Container, const bool bH265, const int32 FrameRate, const int32 MaxQueuedPackets, FString& ErrorMessages);
+
+			~FCompushadyVideoFileSink();
+
+			FCompushadyVideoFileSink(const FCompushadyVideoFileSink&) = delete;
+			FCompushadyVideoFileSink& operator=(const FCompushadyVideoFileSink&) = delete;
+
+			/* Producer side, returns false if the packet has been dropped */
+			bool Enqueue(FCompushadyVideoPacket&& Packet);
+
+			/* Writes the remaining packets, then closes the file */
+			void Close();
+
+			FCompushadyVideoRecordingStats GetStats() const;
+
+		protected:
+			FCompushadyVideoFileSink() = default;
+
+			bool WritePacket(const FCompushadyVideoPacket& Packet, int64& WrittenBytes);
+
+			ECompushadyVideoContainer Container = ECompushadyVideoContainer::AnnexB;
+			bool bH265 = false;
+			int32 FrameRate = 0;
+
+			TUniquePtr<IFileHandle> FileHandle;
+			TUniquePtr<TCompushadyOrderedWriter<FCompushadyVideoPacket>> Writer;
+
+			// producer only
+			bool bWaitForKeyFrame = true;
+
+			// writer thread only
+			TUniquePtr<FCompushadyFMP4Muxer> Muxer;
+			FCompushadyVideoParameterSets ParameterSets;
+			uint64 FirstTimestamp = 0;
+			TArray<uint8> WriteBuffer;
+		};
+	}
+}
+
 /**
  * 
  */
@@ -48,19 +336,55 @@ public:
 
 	~UCompushadyVideoEncoder();
 
-	bool Initialize(const ECompushadyVideoEncoderCodec Codec, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency);
+	bool Initialize(const ECompushadyVideoEncoderCodec Codec, const ECompushadyVideoEncoderQuality Quality, const ECompushadyVideoEncoderLatency Latency, const int32 NumInputFrames = 3);
 
 	UFUNCTION(BlueprintCallable, Category="Compushady")
 	bool EncodeFrame(UCompushadyResource* FrameResource, const bool bForceKeyFrame);
 
+	/* Bitrates are in bits per second, the change is applied with the next frame */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void SetBitrate(const int32 TargetBitrate, const int32 MaxBitrate);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void RequestKeyFrame();
+
+	/* Converts the frames to NV12 with a compute shader instead of passing RGB to the encoder (requires the D3D12 RHI) */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool SetNativeYUV(const bool bEnable, const ECompushadyYUVMatrix Matrix, FString& ErrorMessages, const bool bLinearSource = false);
+
 	UFUNCTION(BlueprintCallable, Category = "Compushady")
 	bool DequeueEncodedFrame(TArray<uint8>& FrameData);
 
 	bool DequeueEncodedFrame(uint8* FrameData, int32& FrameDataSize);
 
+	/* While recording, the encoded packets go straight to the file writer thread and DequeueEncodedFrame does not return them */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool StartRecording(const FString& Filename, const ECompushadyVideoContainer Container, FString& ErrorMessages, const int32 FrameRate = 60, const int32 MaxQueuedPackets = 64);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void StopRecording();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsRecording() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FCompushadyVideoRecordingStats GetRecordingStats() const;
+
 protected:
 
+	void DequeueEncodedFramesToSink();
+
 	TSharedPtr<FCompushadyVideoEncoder> VideoEncoder;
 
+	Compushady::Video::FCompushadyVideoEncoderConfig EncoderConfig;
+
+	TSharedPtr<Compushady::Video::FCompushadyYUVConverter, ESPMode::ThreadSafe> YUVConverter;
+
+	TSharedPtr<Compushady::Video::FCompushadyVideoFileSink> Sink;
+
+	FIntPoint FrameSize = FIntPoint::ZeroValue;
+
+	bool bH265 = false;
+
 	uint32 Timestamp;
 };
@@ -0,0 +1,184 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "CompushadyOrderedWriter.h"
+#include "CompushadyTypes.h"
+#include "RenderingThread.h"
+#include "Tickable.h"
+#include "CompushadyWAVRecorder.generated.h"
+
+USTRUCT(BlueprintType)
+struct COMPUSHADY_API FCompushadyWAVRecorderStats
+{
+	GENERATED_BODY()
+
+	// blocks read back from the GPU and waiting for the writer
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int32 QueuedBlocks = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 FailedBlocks = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Compushady")
+	int64 WrittenBytes = 0;
+};
+
+namespace Compushady
+{
+	namespace WAV
+	{
+		COMPUSHADY_API int32 GetBytesPerSample(const ECompushadyWAVFormat WAVFormat);
+
+		/*
+		 * The header always reserves the ds64 space with a JUNK chunk, so that it can be promoted to RF64 in place.
+		 * When the RIFF size does not fit 32 bits, the sizes are set to 0xFFFFFFFF and the JUNK chunk becomes ds64.
+		 */
+		COMPUSHADY_API void WriteHeader(TArray<uint8>& Header, const int32 SampleRate, const int32 NumChannels, const ECompushadyWAVFormat WAVFormat, const uint64 DataSize);
+
+		/* TPDF dither state, four interleaved LCG lanes */
+		struct COMPUSHADY_API FCompushadyWAVDither
+		{
+			uint32 Lanes[4] = { 0x12345678, 0x9ABCDEF1, 0x2468ACE0, 0x13579BDF };
+		};
+
+		/*
+		 * Converts float samples (-1 to 1) to interleaved WAV samples.
+		 * PlanarPitch is the distance (in samples) between channel planes, 0 for interleaved input.
+		 * Integer formats are scaled, dithered (not PCM32, beyond float precision) and clamped 4 samples at a time.
+		 */
+		COMPUSHADY_API void ConvertSamples(const float* Samples, const int64 NumFrames, const int32 NumChannels, const int64 PlanarPitch, const ECompushadyWAVFormat WAVFormat, FCompushadyWAVDither* Dither, uint8* Output);
+
+		/* Streaming WAV/RF64 writer, the sizes are patched on Close() */
+		class COMPUSHADY_API FCompushadyWAVWriter
+		{
+		public:
+			static TSharedPtr<FCompushadyWAVWriter> Create(const FString& Filename, const int32 SampleRate, const int32 NumChannels, const ECompushadyWAVFormat WAVFormat, const bool bDither, FString& ErrorMessages);
+
+			/* InArchive must be seekable and positioned at its beginning */
+			FCompushadyWAVWriter(FArchive& InArchive, const int32 InSampleRate, const int32 InNumChannels, const ECompushadyWAVFormat InWAVFormat, const bool bDither);
+			~FCompushadyWAVWriter();
+
+			FCompushadyWAVWriter(const FCompushadyWAVWriter&) = delete;
+			FCompushadyWAVWriter& operator=(const FCompushadyWAVWriter&) = delete;
+
+			bool Write(const float* Samples, const int64 NumFrames, const int64 PlanarPitch, FString& ErrorMessages);
+			bool Close(FString& ErrorMessages);
+
+			int32 GetNumChannels() const { return NumChannels; }
+			int64 GetNumFrames() const { return NumFrames; }
+			int64 GetDataSize() const { return DataSize; }
+			bool IsRF64() const { return bRF64; }
+
+		protected:
+			FArchive* Archive = nullptr;
+			TUniquePtr<FArchive> OwnedArchive;
+
+			int32 SampleRate = 0;
+			int32 NumChannels = 0;
+			ECompushadyWAVFormat WAVFormat = ECompushadyWAVFormat::PCM16;
+			TOptional<FCompushadyWAVDither> Dither;
+
+			int32 HeaderSize = 0;
+			int64 NumFrames = 0;
+			int64 DataSize = 0;
+			bool bRF64 = false;
+			bool bClosed = false;
+
+			TArray<uint8> ConversionBuffer;
+		};
+
+		struct FCompushadyWAVCapture;
+
+		/* Writes the blocks from the ordered writer thread, in reservation order */
+		class COMPUSHADY_API FCompushadyWAVSink
+		{
+		public:
+			FCompushadyWAVSink(TSharedPtr<FCompushadyWAVWriter> InWriter, const bool bInPlanar);
+			~FCompushadyWAVSink();
+
+			FCompushadyWAVSink(const FCompushadyWAVSink&) = delete;
+			FCompushadyWAVSink& operator=(const FCompushadyWAVSink&) = delete;
+
+			bool Start(FString& ErrorMessages);
+
+			/* Blocks are written in the order of their Reserve(), which must be called from a single thread */
+			bool Reserve(uint64& Sequence);
+			/* Planar blocks have NumFrames samples per channel plane, can be called from any thread */
+			void Submit(const uint64 Sequence, TArray<float>&& Samples, const int64 NumFrames);
+			/* The block will never be submitted (e.g. lost readback) */
+			void Cancel(const uint64 Sequence);
+
+			/* Waits for the queued blocks, then patches the header */
+			bool Close(FString& ErrorMessages);
+
+			int32 GetNumChannels() const { return Writer->GetNumChannels(); }
+			int32 NumQueued() const { return Blocks.NumQueued(); }
+			FCompushadyWAVRecorderStats GetStats() const;
+
+		protected:
+			bool WriteBlock(TPair<TArray<float>, int64>& Block, int64& WrittenBytes);
+
+			TSharedPtr<FCompushadyWAVWriter> Writer;
+			bool bPlanar = false;
+
+			TCompushadyOrderedWriter<TPair<TArray<float>, int64>> Blocks;
+
+			std::atomic<int64> WrittenFrames{ 0 };
+		};
+	}
+}
+
+/**
+ * Streaming recording of GPU generated audio to WAV (RF64 above 4GB) files.
+ * Blocks of float samples are read back from Compushady buffers (polled on the following frames, without stalling),
+ * converted and appended by a writer thread, so a long render never needs a single huge buffer.
+ */
+UCLASS(BlueprintType)
+class COMPUSHADY_API UCompushadyWAVRecorder : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	void BeginDestroy() override;
+	bool IsReadyForFinishDestroy() override;
+
+	void Tick(float DeltaTime) override;
+	TStatId GetStatId() const override;
+	bool IsTickable() const override;
+	bool IsTickableInEditor() const override { return true; }
+	bool IsTickableWhenPaused() const override { return true; }
+
+	/* bPlanar expects the blocks as one plane per channel (the GPU friendly layout) instead of interleaved frames */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool Open(const FString& Filename, const int32 SampleRate, const int32 NumChannels, FString& ErrorMessages, const ECompushadyWAVFormat WAVFormat = ECompushadyWAVFormat::PCM16, const bool bPlanar = false, const bool bDither = true);
+
+	/* Reads back NumFrames of float samples starting at Offset (bytes), OnSignaled is called (and the buffer can be reused) when the readback is complete */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	void AppendBuffer(UCompushadyResource* Resource, const int64 Offset, const int64 NumFrames, const FCompushadySignaled& OnSignaled);
+
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool AppendSamples(const TArray<float>& Samples, FString& ErrorMessages);
+
+	/* Waits for the blocks in flight, then finalizes the file */
+	UFUNCTION(BlueprintCallable, Category = "Compushady")
+	bool Close(FString& ErrorMessages);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	bool IsOpen() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Compushady")
+	FCompushadyWAVRecorderStats GetStats() const;
+
+protected:
+	TSharedPtr<Compushady::WAV::FCompushadyWAVCapture, ESPMode::ThreadSafe> Capture;
+
+	/* Readbacks still in flight when the recorder is destroyed */
+	FRenderCommandFence DestroyFence;
+};
@@ -0,0 +1,25 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+using UnrealBuildTool;
+
+/* OpenEXR reports errors with exceptions, so they are enabled only for this module */
+public class CompushadyOpenEXR : ModuleRules
+{
+    public CompushadyOpenEXR(ReadOnlyTargetRules Target) : base(Target)
+    {
+        PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+        bUseUnity = false;
+
+        PublicDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Core",
+            }
+            );
+
+        // same platforms as the EXR ImageWrapper
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "Imath", "UEOpenExr");
+
+        bEnableExceptions = true;
+    }
+}
@@ -0,0 +1,124 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#include "CompushadyOpenEXR.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "ImfChannelList.h"
+#include "ImfFrameBuffer.h"
+#include "ImfHeader.h"
+#include "ImfIO.h"
+#include "ImfOutputFile.h"
+THIRD_PARTY_INCLUDES_END
+
+#define LOCTEXT_NAMESPACE "FCompushadyOpenEXRModule"
+
+namespace Compushady
+{
+	namespace OpenEXR
+	{
+		class FCompushadyEXROutputStream : public Imf::OStream
+		{
+		public:
+			FCompushadyEXROutputStream(TArray64<uint8>& InData) : Imf::OStream("CompushadyEXR"), Data(InData)
+			{
+			}
+
+			void write(const char Bytes[], int NumBytes) override
+			{
+				if (Position + NumBytes > Data.Num())
+				{
+					Data.SetNumUninitialized(Position + NumBytes);
+				}
+				FMemory::Memcpy(Data.GetData() + Position, Bytes, NumBytes);
+				Position += NumBytes;
+			}
+
+			uint64_t tellp() override
+			{
+				return Position;
+			}
+
+			void seekp(uint64_t NewPosition) override
+			{
+				Position = static_cast<int64>(NewPosition);
+			}
+
+		protected:
+			TArray64<uint8>& Data;
+			int64 Position = 0;
+		};
+	}
+}
+
+bool Compushady::OpenEXR::EncodeEXR(const void* Data, const int64 RowStride, const uint32 Width, const uint32 Height, const int32 NumComponents, const bool bHalf, const ECompushadyOpenEXRCompression Compression, const int32 NumThreads, TArray64<uint8>& EXR, FString& ErrorMessages)
+{
+	if (NumComponents < 1 || NumComponents > 4)
+	{
+		ErrorMessages = FString::Printf(TEXT("Invalid number of EXR channels %d"), NumComponents);
+		return false;
+	}
+
+	Imf::Compression EXRCompression = Imf::NO_COMPRESSION;
+	switch (Compression)
+	{
+	case ECompushadyOpenEXRCompression::ZIPS:
+		EXRCompression = Imf::ZIPS_COMPRESSION;
+		break;
+	case ECompushadyOpenEXRCompression::ZIP:
+		EXRCompression = Imf::ZIP_COMPRESSION;
+		break;
+	case ECompushadyOpenEXRCompression::PIZ:
+		EXRCompression = Imf::PIZ_COMPRESSION;
+		break;
+	default:
+		break;
+	}
+
+	static const char* ChannelNames[] = { "R", "G", "B", "A" };
+	const Imf::PixelType PixelType = bHalf ? Imf::HALF : Imf::FLOAT;
+	const int64 SampleSize = bHalf ? sizeof(FFloat16) : sizeof(float);
+	const uint8* Pixels = reinterpret_cast<const uint8*>(Data);
+
+	try
+	{
+		Imf::Header Header(static_cast<int>(Width), static_cast<int>(Height));
+		Header.compression() = EXRCompression;
+
+		Imf::FrameBuffer FrameBuffer;
+		for (int32 Component = 0; Component < NumComponents; Component++)
+		{
+			Header.channels().insert(ChannelNames[Component], Imf::Channel(PixelType));
+			FrameBuffer.insert(ChannelNames[Component], Imf::Slice(PixelType, const_cast<char*>(reinterpret_cast<const char*>(Pixels + Component * SampleSize)), NumComponents * SampleSize, RowStride));
+		}
+
+		EXR.Empty();
+		FCompushadyEXROutputStream Stream(EXR);
+		Imf::OutputFile File(Stream, Header, FMath::Max(NumThreads, 0));
+		File.setFrameBuffer(FrameBuffer);
+		File.writePixels(static_cast<int>(Height));
+	}
+	catch (const std::exception& Exception)
+	{
+		ErrorMessages = FString::Printf(TEXT("Unable to encode EXR: %s"), UTF8_TO_TCHAR(Exception.what()));
+		return false;
+	}
+	catch (...)
+	{
+		ErrorMessages = "Unable to encode EXR";
+		return false;
+	}
+
+	return true;
+}
+
+void FCompushadyOpenEXRModule::StartupModule()
+{
+}
+
+void FCompushadyOpenEXRModule::ShutdownModule()
+{
+}
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FCompushadyOpenEXRModule, CompushadyOpenEXR)
@@ -0,0 +1,35 @@
+// Copyright 2023-2024 - Roberto De Ioris.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+class FCompushadyOpenEXRModule : public IModuleInterface
+{
+public:
+
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+};
+
+enum class ECompushadyOpenEXRCompression : uint8
+{
+	None,
+	ZIPS,
+	ZIP,
+	PIZ
+};
+
+namespace Compushady
+{
+	namespace OpenEXR
+	{
+		/*
+		 * Encodes interleaved R, RG, RGB or RGBA samples (already in the output type), no exception escapes this module.
+		 * NumThreads is the per-file number of line buffers, the OpenEXR global thread count is never changed.
+		 */
+		COMPUSHADYOPENEXR_API bool EncodeEXR(const void* Data, const int64 RowStride, const uint32 Width, const uint32 Height, const int32 NumComponents, const bool bHalf, const ECompushadyOpenEXRCompression Compression, const int32 NumThreads, TArray64<uint8>& EXR, FString& ErrorMessages);
+	}
+}